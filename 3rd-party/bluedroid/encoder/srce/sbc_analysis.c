@@ -157,8 +157,10 @@
 #pragma arm section zidata = "sbc_s32_analysis_section"
 #endif
 static SINT32   s32DCTY[16]  = {0};
-static SINT32   s32X[ENC_VX_BUFFER_SIZE/2];
-static SINT16   *s16X=(SINT16*) s32X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+/* BK4BTSTACK_CHANGE START */
+/* filter history is stored in SBC_ENC_PARAMS, s16X points to the one of the current encoder */
+static SINT16   *s16X;      /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
+/* BK4BTSTACK_CHANGE END */
 #if (SBC_USE_ARM_PRAGMA==TRUE)
 #pragma arm section zidata
 #endif
@@ -936,6 +938,11 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
     ps16PcmBuf = pstrEncParams->ps16NextPcmBuffer;
 
     ps32SbBuf  = pstrEncParams->s32SbBuffer;
+    /* BK4BTSTACK_CHANGE START */
+    s16X = (SINT16*) pstrEncParams->as32AnalysisX;
+    ShiftCounter = pstrEncParams->s16ShiftCounter;
+    EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
     Offset2=(SINT32)(EncMaxShiftCounter+40);
     
     for (s32Blk=0; s32Blk <s32NumOfBlocks; s32Blk++)
@@ -995,6 +1002,9 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+    /* BK4BTSTACK_CHANGE START */
+    pstrEncParams->s16ShiftCounter = ShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
 }
 
 /* //////////////////////////////////////////////////////////////////////////////////////////////////////////////////// */
@@ -1029,6 +1039,11 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
     ps16PcmBuf = pstrEncParams->ps16NextPcmBuffer;
 
     ps32SbBuf  = pstrEncParams->s32SbBuffer;
+    /* BK4BTSTACK_CHANGE START */
+    s16X = (SINT16*) pstrEncParams->as32AnalysisX;
+    ShiftCounter = pstrEncParams->s16ShiftCounter;
+    EncMaxShiftCounter = pstrEncParams->s16MaxShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
     Offset2=(SINT32)(EncMaxShiftCounter+80);
     for (s32Blk=0; s32Blk <s32NumOfBlocks; s32Blk++)
     {
@@ -1099,10 +1114,16 @@ void SbcAnalysisFilter8 (SBC_ENC_PARAMS *pstrEncParams)
             }
         }
     }
+    /* BK4BTSTACK_CHANGE START */
+    pstrEncParams->s16ShiftCounter = ShiftCounter;
+    /* BK4BTSTACK_CHANGE END */
 }
 
-void SbcAnalysisInit (void)
+/* BK4BTSTACK_CHANGE START */
+void SbcAnalysisInit (SBC_ENC_PARAMS *pstrEncParams)
 {
-    memset(s16X,0,ENC_VX_BUFFER_SIZE*sizeof(SINT16));
+    memset(pstrEncParams->as32AnalysisX,0,sizeof(pstrEncParams->as32AnalysisX));
+    pstrEncParams->s16ShiftCounter=0;
     ShiftCounter=0;
 }
+/* BK4BTSTACK_CHANGE END */
@@ -408,7 +408,10 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS *pstrEncParams)
     // APPL_TRACE_EVENT("SBC_Encoder_Init : bitrate %d, bitpool %d",
     //         pstrEncParams->u16BitRate, pstrEncParams->s16BitPool);
 
-    SbcAnalysisInit();
+    /* BK4BTSTACK_CHANGE START */
+    pstrEncParams->s16MaxShiftCounter = EncMaxShiftCounter;
+    SbcAnalysisInit(pstrEncParams);
+    /* BK4BTSTACK_CHANGE END */
 
     memset(&sbc_prtc_cb, 0, sizeof(tSBC_PRTC_CB));
     sbc_prtc_cb.base = 6 + pstrEncParams->s16NumOfChannels*pstrEncParams->s16NumOfSubBands/2;
@@ -2456,9 +2456,13 @@ void sm_mbedtls_allocator_free(void * data);
 
 /* ECP options */
 //#define MBEDTLS_ECP_MAX_BITS             521 /**< Maximum bit size of groups */
+#ifndef MBEDTLS_ECP_WINDOW_SIZE
 #define MBEDTLS_ECP_WINDOW_SIZE            1 /**< Maximum window size used - 1 == uses double and add to save RAM */
+#endif
 #define MBEDTLS_ECP_MUL_NAIVE_SAFE         0 /**< Enable use of temporary point for window size == 1 - adds ~100 bytes but makes branches independ from n */ 
+#ifndef MBEDTLS_ECP_FIXED_POINT_OPTIM
 #define MBEDTLS_ECP_FIXED_POINT_OPTIM      0 /**< Enable fixed-point speed-up */
+#endif
 
 /* Entropy options */
 //#define MBEDTLS_ENTROPY_MAX_SOURCES                20 /**< Maximum number of sources supported */
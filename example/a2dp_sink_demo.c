@@ -64,12 +64,12 @@
 #endif
 
 #ifdef HAVE_AUDIO_DMA
-#include "btstack_ring_buffer.h"
+#include "classic/a2dp_sink_jitter_buffer.h"
 #include "hal_audio_dma.h"
 #endif
 
 #ifdef HAVE_PORTAUDIO
-#include "btstack_ring_buffer.h"
+#include "btstack_spsc_ring_buffer.h"
 #include <portaudio.h>
 #endif
 
@@ -79,7 +79,7 @@
 #define STORE_SBC_TO_WAV_FILE 
 #endif
 
-#if defined(HAVE_PORTAUDIO) || defined(STORE_SBC_TO_WAV_FILE) || defined(HAVE_AUDIO_DMA)
+#if defined(HAVE_PORTAUDIO) || defined(STORE_SBC_TO_WAV_FILE)
 #define DECODE_SBC
 #endif
 
@@ -93,30 +93,25 @@ static btstack_sbc_decoder_state_t state;
 static btstack_sbc_mode_t mode = SBC_MODE_STANDARD;
 #endif
 
-#if defined(HAVE_PORTAUDIO) || defined (HAVE_AUDIO_DMA)
+#ifdef HAVE_PORTAUDIO
 #define PREBUFFER_MS        200
 static int audio_stream_started = 0;
 static int audio_stream_paused = 0;
-static btstack_ring_buffer_t ring_buffer;
 #endif
 
+// Audio DMA - playback via jitter buffer, DMA interrupt only hands over buffers filled by run loop
 #ifdef HAVE_AUDIO_DMA
-// below 30: add samples, 30-40: fine, above 40: drop samples
-#define OPTIMAL_FRAMES_MIN 30
-#define OPTIMAL_FRAMES_MAX 40
-#define ADDITIONAL_FRAMES  10
-#define DMA_AUDIO_FRAMES 128
-#define DMA_MAX_FILL_FRAMES 1
-#define NUM_AUDIO_BUFFERS 2
-
-static uint16_t audio_samples[(DMA_AUDIO_FRAMES + DMA_MAX_FILL_FRAMES)*2*NUM_AUDIO_BUFFERS];
-static uint16_t audio_samples_len[NUM_AUDIO_BUFFERS];
-static uint8_t ring_buffer_storage[(OPTIMAL_FRAMES_MAX + ADDITIONAL_FRAMES) * MAX_SBC_FRAME_SIZE];
-static const uint16_t silent_buffer[DMA_AUDIO_FRAMES*2];
+#define JITTER_BUFFER_MS    250
+#define DMA_AUDIO_FRAMES    128
+#define NUM_AUDIO_BUFFERS   3
+
+static a2dp_sink_jitter_buffer_t jitter_buffer;
+static uint8_t jitter_buffer_storage[JITTER_BUFFER_MS * 48 * BYTES_PER_FRAME];   // up to 48 kHz
+static int16_t audio_samples[DMA_AUDIO_FRAMES * NUM_CHANNELS * NUM_AUDIO_BUFFERS];
+static const int16_t silent_buffer[DMA_AUDIO_FRAMES * NUM_CHANNELS];
 static volatile int playback_buffer;
-static int write_buffer;
-static uint8_t sbc_frame_size;
-static int sbc_samples_fix;
+static volatile int write_buffer;
+static uint32_t jitter_buffer_report_ms;
 #endif
 
 // PortAdudio - live playback
@@ -127,7 +122,8 @@ static int sbc_samples_fix;
 #define PREBUFFER_BYTES     (PREBUFFER_MS*SAMPLE_RATE/1000*BYTES_PER_FRAME)
 static PaStream * stream;
 static uint8_t ring_buffer_storage[2*PREBUFFER_BYTES];
-static btstack_ring_buffer_t ring_buffer;
+// written by stack thread, read by PortAudio thread
+static btstack_spsc_ring_buffer_t ring_buffer;
 static int total_num_samples = 0;
 #endif
 
@@ -224,7 +220,7 @@ static int patestCallback( const void *inputBuffer, void *outputBuffer,
     // fill with silence while paused
     if (audio_stream_paused){
 
-        if (btstack_ring_buffer_bytes_available(&ring_buffer) < PREBUFFER_BYTES){
+        if (btstack_spsc_ring_buffer_bytes_available(&ring_buffer) < PREBUFFER_BYTES){
             // printf("PA: silence\n");
             memset(outputBuffer, 0, bytes_to_copy);
             return 0;
@@ -235,8 +231,7 @@ static int patestCallback( const void *inputBuffer, void *outputBuffer,
     }
 
     // get data from ringbuffer
-    uint32_t bytes_read = 0;
-    btstack_ring_buffer_read(&ring_buffer, outputBuffer, bytes_to_copy, &bytes_read);
+    uint32_t bytes_read = btstack_spsc_ring_buffer_read(&ring_buffer, outputBuffer, bytes_to_copy);
     bytes_to_copy -= bytes_read;
 
     // fill with 0 if not enough
@@ -253,30 +248,18 @@ static int next_buffer(int current){
 	if (current == NUM_AUDIO_BUFFERS-1) return 0;
 	return current + 1;
 }
-static uint8_t * start_of_buffer(int num){
-	return (uint8_t *) &audio_samples[num * DMA_AUDIO_FRAMES * 2];
+static int16_t * start_of_buffer(int num){
+	return &audio_samples[num * DMA_AUDIO_FRAMES * NUM_CHANNELS];
 }
 void hal_audio_dma_done(void){
-	if (audio_stream_paused){
-		hal_audio_dma_play((const uint8_t *) silent_buffer, DMA_AUDIO_FRAMES*4);
-		return;
-	}
-	// next buffer
+	// play next buffer if filled, silence otherwise
 	int next_playback_buffer = next_buffer(playback_buffer);
-	uint8_t * playback_data;
 	if (next_playback_buffer == write_buffer){
-
-		// TODO: stop codec while playing silence when getting 'stream paused'
-
-		// start playing silence
-		audio_stream_paused = 1;
-		hal_audio_dma_play((const uint8_t *) silent_buffer, DMA_AUDIO_FRAMES*4);
-		printf("%6u - paused - bytes in buffer %u\n", (int) btstack_run_loop_get_time_ms(), btstack_ring_buffer_bytes_available(&ring_buffer));
+		hal_audio_dma_play((const uint8_t *) silent_buffer, DMA_AUDIO_FRAMES * BYTES_PER_FRAME);
 		return;
 	}
 	playback_buffer = next_playback_buffer;
-	playback_data = start_of_buffer(playback_buffer);
-	hal_audio_dma_play(playback_data, audio_samples_len[playback_buffer]);
+	hal_audio_dma_play((const uint8_t *) start_of_buffer(playback_buffer), DMA_AUDIO_FRAMES * BYTES_PER_FRAME);
     // btstack_run_loop_embedded_trigger();
 }
 #endif
@@ -296,7 +279,7 @@ static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, i
     total_num_samples+=num_samples*num_channels;
 
     // store pcm samples in ringbuffer
-    btstack_ring_buffer_write(&ring_buffer, (uint8_t *)data, num_samples*num_channels*2);
+    btstack_spsc_ring_buffer_write(&ring_buffer, (uint8_t *)data, num_samples*num_channels*2);
 
     if (!audio_stream_started){
         audio_stream_paused  = 1;
@@ -316,58 +299,27 @@ static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, i
 
 #ifdef HAVE_AUDIO_DMA
 
-static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
-    UNUSED(sample_rate);
-    UNUSED(context);
-    total_num_samples+=num_samples*num_channels;
-
-    // store in ring buffer
-    uint8_t * write_data = start_of_buffer(write_buffer);
-    uint16_t len = num_samples*num_channels*2;
-    memcpy(write_data, data, len);
-    audio_samples_len[write_buffer] = len;
-
-    // add/drop audio frame to fix drift
-    if (sbc_samples_fix > 0){
-        memcpy(write_data + len, write_data + len - 4, 4);
-        audio_samples_len[write_buffer] += 4;
-    }
-    if (sbc_samples_fix < 0){
-        audio_samples_len[write_buffer] -= 4;
-    }
-
-    write_buffer = next_buffer(write_buffer);
-}
-
 static void hal_audio_dma_process(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
 	UNUSED(ds);
 	UNUSED(callback_type);
 
 	if (!media_initialized) return;
 
-	int trigger_resume = 0;
-	if (audio_stream_paused) {
-		if (sbc_frame_size && btstack_ring_buffer_bytes_available(&ring_buffer) >= OPTIMAL_FRAMES_MIN * sbc_frame_size){
-			trigger_resume = 1;
-			// reset buffers
-			playback_buffer = NUM_AUDIO_BUFFERS - 1;
-			write_buffer = 0;
-		} else {
-			return;
-		}
-	}
-
-	while (playback_buffer != write_buffer && btstack_ring_buffer_bytes_available(&ring_buffer) >= sbc_frame_size ){
-		uint8_t frame[MAX_SBC_FRAME_SIZE];
-	    uint32_t bytes_read = 0;
-	    btstack_ring_buffer_read(&ring_buffer, frame, sbc_frame_size, &bytes_read);
-	    btstack_sbc_decoder_process_data(&state, 0, frame, sbc_frame_size);
+	// fill all buffers not used by DMA, keeps one buffer in between
+	while (next_buffer(write_buffer) != playback_buffer){
+		a2dp_sink_jitter_buffer_read(&jitter_buffer, start_of_buffer(write_buffer), DMA_AUDIO_FRAMES);
+		write_buffer = next_buffer(write_buffer);
 	}
 
-	if (trigger_resume){
-		printf("%6u - resume\n", (int) btstack_run_loop_get_time_ms());
-		audio_stream_paused = 0;
-	}
+	// report
+	uint32_t now = btstack_run_loop_get_time_ms();
+	if ((int32_t)(now - jitter_buffer_report_ms) < 5000) return;
+	jitter_buffer_report_ms = now;
+	a2dp_sink_jitter_buffer_statistics_t stats;
+	a2dp_sink_jitter_buffer_get_statistics(&jitter_buffer, &stats);
+	printf("%6u - depth %u/%u frames, jitter %u, drift %d ppm, lost %u, late %u, concealed %u, underruns %u\n", (int) now,
+		(int) stats.buffer_depth, (int) stats.target_depth, (int) stats.jitter, (int) stats.drift_ppm,
+		(int) stats.packets_lost, (int) stats.packets_late, (int) stats.frames_concealed, (int) stats.underruns);
 }
 
 #endif
@@ -420,16 +372,18 @@ static int media_processing_init(avdtp_media_codec_configuration_sbc_t configura
     }
 #endif
 #ifdef HAVE_AUDIO_DMA
-    audio_stream_paused  = 1;
+    a2dp_sink_jitter_buffer_init(&jitter_buffer, configuration.sampling_frequency, jitter_buffer_storage, sizeof(jitter_buffer_storage));
+    playback_buffer = 0;
+    write_buffer = 1;
     hal_audio_dma_init(configuration.sampling_frequency);
     hal_audio_dma_set_audio_played(&hal_audio_dma_done);
     // start playing silence
-    hal_audio_dma_done();
+    hal_audio_dma_play((const uint8_t *) silent_buffer, DMA_AUDIO_FRAMES * BYTES_PER_FRAME);
 #endif
 
- #if defined(HAVE_PORTAUDIO) || defined (HAVE_AUDIO_DMA)
+#ifdef HAVE_PORTAUDIO
     memset(ring_buffer_storage, 0, sizeof(ring_buffer_storage));
-    btstack_ring_buffer_init(&ring_buffer, ring_buffer_storage, sizeof(ring_buffer_storage));
+    btstack_spsc_ring_buffer_init(&ring_buffer, ring_buffer_storage, sizeof(ring_buffer_storage));
     audio_stream_started = 0;
 #endif 
     media_initialized = 1;
@@ -451,11 +405,8 @@ static void media_processing_close(void){
     fclose(sbc_file);
 #endif     
 
-#if defined(HAVE_PORTAUDIO) || defined (HAVE_AUDIO_DMA)
-    audio_stream_started = 0;
-#endif
-
 #ifdef HAVE_PORTAUDIO
+    audio_stream_started = 0;
     PaError err = Pa_StopStream(stream);
     if (err != paNoError){
         printf("Error stopping the stream: \"%s\"\n",  Pa_GetErrorText(err));
@@ -521,11 +472,6 @@ static void handle_l2cap_media_data_packet(avdtp_stream_endpoint_t * stream_endp
     sbc_header.num_frames = packet[pos] & 0x0f;
     pos++;
 
-#ifdef HAVE_AUDIO_DMA
-    // store sbc frame size for buffer management
-    sbc_frame_size = (size-pos)/ sbc_header.num_frames;
-#endif
-    
     UNUSED(sbc_header);
     // printf("SBC HEADER: num_frames %u, fragmented %u, start %u, stop %u\n", sbc_header.num_frames, sbc_header.fragmentation, sbc_header.starting_packet, sbc_header.last_packet);
     // printf_hexdump( packet+pos, size-pos );
@@ -535,21 +481,8 @@ static void handle_l2cap_media_data_packet(avdtp_stream_endpoint_t * stream_endp
 #endif
 
 #ifdef HAVE_AUDIO_DMA
-    btstack_ring_buffer_write(&ring_buffer,  packet+pos, size-pos);
-
-    // decide on audio sync drift based on number of sbc frames in queue
-    int sbc_frames_in_buffer = btstack_ring_buffer_bytes_available(&ring_buffer) / sbc_frame_size;
-    if (sbc_frames_in_buffer < OPTIMAL_FRAMES_MIN){
-    	sbc_samples_fix = 1;	// duplicate last sample
-    } else if (sbc_frames_in_buffer <= OPTIMAL_FRAMES_MAX){
-    	sbc_samples_fix = 0;	// nothing to do
-    } else {
-    	sbc_samples_fix = -1;	// drop last sample
-    }
-
-    // dump
-    printf("%6u %03u %d\n",  (int) btstack_run_loop_get_time_ms(), sbc_frames_in_buffer, sbc_samples_fix);
-
+    // jitter buffer parses RTP header itself
+    a2dp_sink_jitter_buffer_put_media_packet(&jitter_buffer, packet, size);
 #endif
 
 #ifdef STORE_SBC_TO_SBC_FILE
@@ -66,7 +66,7 @@
 #endif
 
 #ifdef HAVE_PORTAUDIO
-#include "btstack_ring_buffer.h"
+#include "btstack_spsc_ring_buffer.h"
 #include <portaudio.h>
 #endif
 
@@ -94,7 +94,6 @@ static btstack_sbc_mode_t mode = SBC_MODE_STANDARD;
 #define PREBUFFER_MS        200
 static int audio_stream_started = 0;
 static int audio_stream_paused = 0;
-static btstack_ring_buffer_t ring_buffer;
 #endif
 
 #ifdef HAVE_AUDIO_DMA
@@ -106,6 +105,8 @@ static btstack_ring_buffer_t ring_buffer;
 #define DMA_MAX_FILL_FRAMES 1
 #define NUM_AUDIO_BUFFERS 2
 
+static btstack_ring_buffer_t ring_buffer;
+
 static uint16_t audio_samples[(DMA_AUDIO_FRAMES + DMA_MAX_FILL_FRAMES)*2*NUM_AUDIO_BUFFERS];
 static uint16_t audio_samples_len[NUM_AUDIO_BUFFERS];
 static uint8_t ring_buffer_storage[(OPTIMAL_FRAMES_MAX + ADDITIONAL_FRAMES) * MAX_SBC_FRAME_SIZE];
@@ -124,7 +125,8 @@ static int sbc_samples_fix;
 #define PREBUFFER_BYTES     (PREBUFFER_MS*SAMPLE_RATE/1000*BYTES_PER_FRAME)
 static PaStream * stream;
 static uint8_t ring_buffer_storage[2*PREBUFFER_BYTES];
-static btstack_ring_buffer_t ring_buffer;
+// written by stack thread, read by PortAudio thread
+static btstack_spsc_ring_buffer_t ring_buffer;
 static int total_num_samples = 0;
 #endif
 
@@ -217,7 +219,7 @@ static int patestCallback( const void *inputBuffer, void *outputBuffer,
     // fill with silence while paused
     if (audio_stream_paused){
 
-        if (btstack_ring_buffer_bytes_available(&ring_buffer) < PREBUFFER_BYTES){
+        if (btstack_spsc_ring_buffer_bytes_available(&ring_buffer) < PREBUFFER_BYTES){
             // printf("PA: silence\n");
             memset(outputBuffer, 0, bytes_to_copy);
             return 0;
@@ -228,8 +230,7 @@ static int patestCallback( const void *inputBuffer, void *outputBuffer,
     }
 
     // get data from ringbuffer
-    uint32_t bytes_read = 0;
-    btstack_ring_buffer_read(&ring_buffer, outputBuffer, bytes_to_copy, &bytes_read);
+    uint32_t bytes_read = btstack_spsc_ring_buffer_read(&ring_buffer, outputBuffer, bytes_to_copy);
     bytes_to_copy -= bytes_read;
 
     // fill with 0 if not enough
@@ -289,7 +290,7 @@ static void handle_pcm_data(int16_t * data, int num_samples, int num_channels, i
     total_num_samples+=num_samples*num_channels;
 
     // store pcm samples in ringbuffer
-    btstack_ring_buffer_write(&ring_buffer, (uint8_t *)data, num_samples*num_channels*2);
+    btstack_spsc_ring_buffer_write(&ring_buffer, (uint8_t *)data, num_samples*num_channels*2);
 
     if (!audio_stream_started){
         audio_stream_paused  = 1;
@@ -422,7 +423,11 @@ static int media_processing_init(avdtp_media_codec_configuration_sbc_t configura
 
  #if defined(HAVE_PORTAUDIO) || defined (HAVE_AUDIO_DMA)
     memset(ring_buffer_storage, 0, sizeof(ring_buffer_storage));
+#ifdef HAVE_PORTAUDIO
+    btstack_spsc_ring_buffer_init(&ring_buffer, ring_buffer_storage, sizeof(ring_buffer_storage));
+#else
     btstack_ring_buffer_init(&ring_buffer, ring_buffer_storage, sizeof(ring_buffer_storage));
+#endif
     audio_stream_started = 0;
 #endif 
     media_initialized = 1;
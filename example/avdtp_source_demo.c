@@ -53,6 +53,7 @@
 #include "l2cap.h"
 #include "btstack_stdin.h"
 #include "classic/a2dp_source.h"
+#include "classic/a2dp_source_scheduler.h"
 #include "classic/avdtp_source.h"
 #include "classic/avdtp_util.h"
 #include "classic/btstack_sbc.h"
@@ -64,7 +65,8 @@
 #define NUM_CHANNELS        2
 #define A2DP_SAMPLE_RATE         44100
 #define BYTES_PER_AUDIO_SAMPLE   (2*NUM_CHANNELS)
-#define FILL_AUDIO_BUFFER_TIMEOUT_MS 10 
+#define MEDIA_QUEUE_NUM_PACKETS  4
+#define MAX_MEDIA_PAYLOAD_SIZE   1021
 
 #ifndef M_PI
 #define M_PI  3.14159265
@@ -119,23 +121,13 @@ static uint8_t media_sbc_codec_configuration[4];
 typedef struct {
     uint16_t a2dp_cid;
     uint8_t  local_seid;
-    
-    uint32_t time_audio_data_sent; // ms
-    uint32_t acc_num_missed_samples;
-    uint32_t samples_ready;
-    btstack_timer_source_t fill_audio_buffer_timer;
-    uint8_t  streaming;
-                            
-    int      max_media_payload_size;
-    
-    uint8_t  sbc_storage[1030];
-    uint16_t sbc_storage_count;
-    uint8_t  sbc_ready_to_send;
-
 } a2dp_media_sending_context_t;
 
 static a2dp_media_sending_context_t media_tracker;
 
+// send queue for media scheduler
+static uint8_t media_queue_storage[MEDIA_QUEUE_NUM_PACKETS * (MAX_MEDIA_PAYLOAD_SIZE + 8)];
+
 static paTestData sin_data;
 
 static int hxcmod_initialized = 0;
@@ -147,9 +139,13 @@ stream_data_source_t data_source = STREAM_SINE;
 
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 
-static void a2dp_fill_audio_buffer_timer_start(a2dp_media_sending_context_t * context);
-static void a2dp_fill_audio_buffer_timer_stop(a2dp_media_sending_context_t * context);
-static void a2dp_fill_audio_buffer_timer_pause(a2dp_media_sending_context_t * context);
+static void dump_media_statistics(void){
+    a2dp_source_scheduler_statistics_t stats;
+    a2dp_source_scheduler_get_statistics(&stats);
+    printf(" --- application --- sent %u packets, %u bytes, catch-up %u, skipped %u frames, queue max %u/%u, bitpool %u (%u changes)\n",
+        (int) stats.packets_sent, (int) stats.bytes_sent, (int) stats.catch_up_packets, (int) stats.frames_skipped,
+        stats.max_queue_depth, stats.queue_size, stats.bitpool, stats.bitpool_changes);
+}
 
 static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(channel);
@@ -171,30 +167,21 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
                         case A2DP_SUBEVENT_STREAM_START_ACCEPTED:
                             if (local_seid != media_tracker.local_seid) break;
                             if (!a2dp_source_stream_endpoint_ready(media_tracker.local_seid)) break;
-                            a2dp_fill_audio_buffer_timer_start(&media_tracker);
+                            // media scheduler encodes and sends audio paced by media clock
+                            a2dp_source_scheduler_start(media_tracker.local_seid);
                             printf(" --- application ---  A2DP_SUBEVENT_STREAM_START_ACCEPTED, local seid %d\n", media_tracker.local_seid);
                             break;
-                        
-                        case A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW:{
-                            if (local_seid != media_tracker.local_seid) break;
 
-                            int num_bytes_in_frame = btstack_sbc_encoder_sbc_buffer_length();
-                            int bytes_in_storage = media_tracker.sbc_storage_count;
-                            uint8_t num_frames = bytes_in_storage / num_bytes_in_frame;
-                            
-                            a2dp_source_stream_send_media_payload(media_tracker.local_seid, media_tracker.sbc_storage, bytes_in_storage, num_frames, 0);
-                            media_tracker.sbc_storage_count = 0;
-                            media_tracker.sbc_ready_to_send = 0;
-                            break;        
-                        }
                         case A2DP_SUBEVENT_STREAM_SUSPENDED:
                             printf(" --- application ---  A2DP_SUBEVENT_STREAM_SUSPENDED, local seid %d\n", media_tracker.local_seid);
-                            a2dp_fill_audio_buffer_timer_pause(&media_tracker);
+                            a2dp_source_scheduler_stop();
+                            dump_media_statistics();
                             break;
 
                         case A2DP_SUBEVENT_STREAM_RELEASED:
                             printf(" --- application ---  A2DP_SUBEVENT_STREAM_RELEASED, local seid %d\n", media_tracker.local_seid);
-                            a2dp_fill_audio_buffer_timer_stop(&media_tracker);
+                            a2dp_source_scheduler_stop();
+                            dump_media_statistics();
                             break;
                         default:
                             printf(" --- application ---  not implemented\n");
@@ -249,7 +236,8 @@ static void produce_mod_audio(int16_t * pcm_buffer, int num_samples_to_write){
     hxcmod_fillbuffer(&mod_context, (unsigned short *) &pcm_buffer[0], num_samples_to_write, &trkbuf);
 }
 
-static void produce_audio(int16_t * pcm_buffer, int num_samples){
+static void produce_audio(int16_t * pcm_buffer, int num_samples, void * context){
+    UNUSED(context);
     switch (data_source){
         case STREAM_SINE:
             produce_sine_audio(pcm_buffer, &sin_data, num_samples);
@@ -260,88 +248,6 @@ static void produce_audio(int16_t * pcm_buffer, int num_samples){
     }    
 }
 
-static int fill_sbc_audio_buffer(a2dp_media_sending_context_t * context){
-    // perform sbc encodin
-    int total_num_bytes_read = 0;
-    int num_audio_samples_per_sbc_buffer = btstack_sbc_encoder_num_audio_frames();
-    while (context->samples_ready >= num_audio_samples_per_sbc_buffer
-        && (context->max_media_payload_size - context->sbc_storage_count) >= btstack_sbc_encoder_sbc_buffer_length()){
-
-        uint8_t pcm_frame[256*BYTES_PER_AUDIO_SAMPLE];
-
-        produce_audio((int16_t *) pcm_frame, num_audio_samples_per_sbc_buffer);
-        btstack_sbc_encoder_process_data((int16_t *) pcm_frame);
-        
-        uint16_t sbc_frame_size = btstack_sbc_encoder_sbc_buffer_length(); 
-        uint8_t * sbc_frame = btstack_sbc_encoder_sbc_buffer();
-        
-        total_num_bytes_read += num_audio_samples_per_sbc_buffer;
-        memcpy(&context->sbc_storage[context->sbc_storage_count], sbc_frame, sbc_frame_size);
-        context->sbc_storage_count += sbc_frame_size;
-        context->samples_ready -= num_audio_samples_per_sbc_buffer;
-    }
-    return total_num_bytes_read;
-}
-
-static void avdtp_fill_audio_buffer_timeout_handler(btstack_timer_source_t * timer){
-    a2dp_media_sending_context_t * context = (a2dp_media_sending_context_t *) btstack_run_loop_get_timer_context(timer);
-    btstack_run_loop_set_timer(&context->fill_audio_buffer_timer, FILL_AUDIO_BUFFER_TIMEOUT_MS); 
-    btstack_run_loop_add_timer(&context->fill_audio_buffer_timer);
-    uint32_t now = btstack_run_loop_get_time_ms();
-
-    uint32_t update_period_ms = FILL_AUDIO_BUFFER_TIMEOUT_MS;
-    if (context->time_audio_data_sent > 0){
-        update_period_ms = now - context->time_audio_data_sent;
-    } 
-
-    uint32_t num_samples = (update_period_ms * A2DP_SAMPLE_RATE) / 1000;
-    context->acc_num_missed_samples += (update_period_ms * A2DP_SAMPLE_RATE) % 1000;
-    
-    while (context->acc_num_missed_samples >= 1000){
-        num_samples++;
-        context->acc_num_missed_samples -= 1000;
-    }
-    context->time_audio_data_sent = now;
-    context->samples_ready += num_samples;
-
-    if (context->sbc_ready_to_send) return;
-
-    fill_sbc_audio_buffer(context);
-
-    if ((context->sbc_storage_count + btstack_sbc_encoder_sbc_buffer_length()) > context->max_media_payload_size){
-        // schedule sending
-        context->sbc_ready_to_send = 1;
-        a2dp_source_stream_endpoint_request_can_send_now(context->local_seid);
-    }
-}
-
-static void a2dp_fill_audio_buffer_timer_start(a2dp_media_sending_context_t * context){
-    context->max_media_payload_size = a2dp_max_media_payload_size(context->local_seid);
-    context->sbc_storage_count = 0;
-    context->sbc_ready_to_send = 0;
-    context->streaming = 1;
-    btstack_run_loop_remove_timer(&context->fill_audio_buffer_timer);
-    btstack_run_loop_set_timer_handler(&context->fill_audio_buffer_timer, avdtp_fill_audio_buffer_timeout_handler);
-    btstack_run_loop_set_timer_context(&context->fill_audio_buffer_timer, context);
-    btstack_run_loop_set_timer(&context->fill_audio_buffer_timer, FILL_AUDIO_BUFFER_TIMEOUT_MS); 
-    btstack_run_loop_add_timer(&context->fill_audio_buffer_timer);
-}
-
-static void a2dp_fill_audio_buffer_timer_stop(a2dp_media_sending_context_t * context){
-    context->time_audio_data_sent = 0;
-    context->acc_num_missed_samples = 0;
-    context->samples_ready = 0;
-    context->streaming = 1;
-    context->sbc_storage_count = 0;
-    context->sbc_ready_to_send = 0;
-    btstack_run_loop_remove_timer(&context->fill_audio_buffer_timer);
-} 
-
-static void a2dp_fill_audio_buffer_timer_pause(a2dp_media_sending_context_t * context){
-    // context->time_audio_data_sent = 0;
-    btstack_run_loop_remove_timer(&context->fill_audio_buffer_timer);
-} 
-
 static void stdin_process(char cmd){
     switch (cmd){
         case 'c':
@@ -393,6 +299,10 @@ int btstack_main(int argc, const char * argv[]){
     //#ifndef SMG_BI
     local_seid = a2dp_source_create_stream_endpoint(AVDTP_AUDIO, AVDTP_CODEC_SBC, media_sbc_codec_capabilities, sizeof(media_sbc_codec_capabilities), media_sbc_codec_configuration, sizeof(media_sbc_codec_configuration));
 
+    // Initialize media scheduler
+    a2dp_source_scheduler_init(media_queue_storage, sizeof(media_queue_storage));
+    a2dp_source_scheduler_set_pcm_callback(&produce_audio, NULL);
+
     // Initialize SDP 
     sdp_init();
     memset(sdp_avdtp_source_service_buffer, 0, sizeof(sdp_avdtp_source_service_buffer));
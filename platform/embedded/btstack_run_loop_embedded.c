@@ -52,6 +52,12 @@
  *  the idle hook gets called if no data source did indicate that it needs to be
  *  called right away.
  *
+ *  With ENABLE_EMBEDDED_TICKLESS, there's no periodic tick. Instead, a one-shot alarm
+ *  is programmed via hal_time_ms_set_alarm() for the next timer deadline before going
+ *  to sleep. Timers that expire within the timer slack window after the first one
+ *  are coalesced: the alarm is set to the latest of them, so they get processed
+ *  with a single wakeup.
+ *
  */
 
 
@@ -64,6 +70,7 @@
 #include "btstack_debug.h"
 
 #include <stddef.h> // NULL
+#include <string.h> // memset
 
 #ifdef HAVE_EMBEDDED_TIME_MS
 #include "hal_time_ms.h"
@@ -77,6 +84,16 @@
 #define TIMER_SUPPORT
 #endif
 
+#if defined(ENABLE_EMBEDDED_TICKLESS) && !defined(HAVE_EMBEDDED_TIME_MS)
+#error "ENABLE_EMBEDDED_TICKLESS requires HAVE_EMBEDDED_TIME_MS"
+#endif
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+#ifndef EMBEDDED_TICKLESS_TIMER_SLACK_MS
+#define EMBEDDED_TICKLESS_TIMER_SLACK_MS 0
+#endif
+#endif
+
 static const btstack_run_loop_t btstack_run_loop_embedded;
 
 // the run loop
@@ -92,6 +109,17 @@ static volatile uint32_t system_ticks;
 
 static int trigger_event_received = 0;
 
+// set by tick handler or alarm handler to attribute wakeups
+static volatile int timer_wakeup;
+
+static btstack_run_loop_embedded_statistics_t statistics;
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+static uint32_t timer_slack_ms;
+static volatile int alarm_active;
+static uint32_t alarm_time_ms;
+#endif
+
 /**
  * Add data_source to run_loop
  */
@@ -195,6 +223,59 @@ static void btstack_run_loop_embedded_dump_timer(void){
 #endif
 }
 
+static uint32_t btstack_run_loop_embedded_get_time_ms(void);
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+// latest timeout within slack window of first timer, timer list must not be empty
+static uint32_t btstack_run_loop_embedded_next_deadline(void){
+    btstack_timer_source_t * ts = (btstack_timer_source_t *) timers;
+    uint32_t deadline = ts->timeout;
+    uint32_t latest   = deadline + timer_slack_ms;
+    for (ts = (btstack_timer_source_t *) ts->item.next; ts ; ts = (btstack_timer_source_t *) ts->item.next){
+        // list is sorted
+        if ((int32_t)(ts->timeout - latest) > 0) break;
+        deadline = ts->timeout;
+    }
+    return deadline;
+}
+
+static void btstack_run_loop_embedded_alarm_handler(void){
+    alarm_active = 0;
+    timer_wakeup = 1;
+    trigger_event_received = 1;
+}
+
+static void btstack_run_loop_embedded_update_alarm(void){
+    if (!timers){
+        if (alarm_active){
+            alarm_active = 0;
+            hal_time_ms_clear_alarm();
+        }
+        return;
+    }
+    uint32_t deadline = btstack_run_loop_embedded_next_deadline();
+    if (alarm_active && alarm_time_ms == deadline) return;
+    alarm_time_ms = deadline;
+    alarm_active = 1;
+    statistics.alarms_programmed++;
+    hal_time_ms_set_alarm(deadline);
+}
+#endif
+
+// called with IRQs disabled
+static void btstack_run_loop_embedded_sleep(void){
+    uint32_t sleep_start_ms = btstack_run_loop_embedded_get_time_ms();
+    timer_wakeup = 0;
+    statistics.sleeps++;
+    hal_cpu_enable_irqs_and_sleep();
+    statistics.time_asleep_ms += btstack_run_loop_embedded_get_time_ms() - sleep_start_ms;
+    if (timer_wakeup){
+        statistics.wakeups_by_timer++;
+    } else {
+        statistics.wakeups_by_other++;
+    }
+}
+
 static void btstack_run_loop_embedded_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callback_types){
     ds->flags |= callback_types;
 }
@@ -209,6 +290,8 @@ static void btstack_run_loop_embedded_disable_data_source_callbacks(btstack_data
 void btstack_run_loop_embedded_execute_once(void) {
     btstack_data_source_t *ds;
 
+    statistics.iterations++;
+
     // process data sources
     btstack_data_source_t *next;
     for (ds = (btstack_data_source_t *) data_sources; ds != NULL ; ds = next){
@@ -228,23 +311,34 @@ void btstack_run_loop_embedded_execute_once(void) {
 #endif
 
     // process timers
+    uint32_t timers_processed = 0;
     while (timers) {
         btstack_timer_source_t *ts = (btstack_timer_source_t *) timers;
         uint32_t timeout_low = ts->timeout;
         int      timeout_high = btstack_run_loop_embedded_reconstruct_higher_bits(now, timeout_low);
         if (timeout_high > 0 || ((timeout_high == 0) && (timeout_low > now))) break;
         btstack_run_loop_remove_timer(ts);
+        timers_processed++;
         ts->process(ts);
     }
+    if (timers_processed){
+        statistics.timers_processed += timers_processed;
+        statistics.timers_coalesced += timers_processed - 1;
+    }
 #endif
-    
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+    // a deadline in the past triggers the alarm right away
+    btstack_run_loop_embedded_update_alarm();
+#endif
+
     // disable IRQs and check if run loop iteration has been requested. if not, go to sleep
     hal_cpu_disable_irqs();
     if (trigger_event_received){
         trigger_event_received = 0;
         hal_cpu_enable_irqs();
     } else {
-        hal_cpu_enable_irqs_and_sleep();
+        btstack_run_loop_embedded_sleep();
     }
 }
 
@@ -260,6 +354,7 @@ static void btstack_run_loop_embedded_execute(void) {
 #ifdef HAVE_EMBEDDED_TICK
 static void btstack_run_loop_embedded_tick_handler(void){
     system_ticks++;
+    timer_wakeup = 1;
     trigger_event_received = 1;
 }
 
@@ -290,6 +385,20 @@ void btstack_run_loop_embedded_trigger(void){
     trigger_event_received = 1;
 }
 
+void btstack_run_loop_embedded_get_statistics(btstack_run_loop_embedded_statistics_t * run_loop_statistics){
+    *run_loop_statistics = statistics;
+}
+
+void btstack_run_loop_embedded_reset_statistics(void){
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+void btstack_run_loop_embedded_set_timer_slack(uint32_t slack_ms){
+    timer_slack_ms = slack_ms;
+}
+#endif
+
 static void btstack_run_loop_embedded_init(void){
     data_sources = NULL;
 
@@ -302,6 +411,14 @@ static void btstack_run_loop_embedded_init(void){
     hal_tick_init();
     hal_tick_set_handler(&btstack_run_loop_embedded_tick_handler);
 #endif
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+    timer_slack_ms = EMBEDDED_TICKLESS_TIMER_SLACK_MS;
+    alarm_active = 0;
+    hal_time_ms_set_alarm_handler(&btstack_run_loop_embedded_alarm_handler);
+#endif
+
+    btstack_run_loop_embedded_reset_statistics();
 }
 
 /**
@@ -55,7 +55,18 @@
 #if defined __cplusplus
 extern "C" {
 #endif
-	
+
+typedef struct {
+    uint32_t iterations;         // calls to btstack_run_loop_embedded_execute_once
+    uint32_t sleeps;             // times MCU entered sleep
+    uint32_t wakeups_by_timer;   // wakeups by tick or alarm
+    uint32_t wakeups_by_other;   // wakeups by other IRQs
+    uint32_t time_asleep_ms;     // 0 without HAVE_EMBEDDED_TICK or HAVE_EMBEDDED_TIME_MS
+    uint32_t timers_processed;
+    uint32_t timers_coalesced;   // timers processed in the same iteration as an earlier one
+    uint32_t alarms_programmed;  // ENABLE_EMBEDDED_TICKLESS only
+} btstack_run_loop_embedded_statistics_t;
+
 /**
  * Provide btstack_run_loop_embedded instance 
  */
@@ -82,6 +93,25 @@ void btstack_run_loop_embedded_trigger(void);
  */
 void btstack_run_loop_embedded_execute_once(void);
 
+/**
+ * @brief Get sleep and wakeup statistics since init or last reset
+ * @param statistics
+ */
+void btstack_run_loop_embedded_get_statistics(btstack_run_loop_embedded_statistics_t * statistics);
+
+/**
+ * @brief Reset sleep and wakeup statistics
+ */
+void btstack_run_loop_embedded_reset_statistics(void);
+
+#ifdef ENABLE_EMBEDDED_TICKLESS
+/**
+ * @brief Set timer slack for tickless mode. Timers may fire up to slack_ms late to share a wakeup with later timers.
+ * @param slack_ms, default EMBEDDED_TICKLESS_TIMER_SLACK_MS
+ */
+void btstack_run_loop_embedded_set_timer_slack(uint32_t slack_ms);
+#endif
+
 /* API_END */
 
 #if defined __cplusplus
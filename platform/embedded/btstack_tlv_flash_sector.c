@@ -47,6 +47,11 @@
 // - Len: 32 bit
 // - Value: Len in bytes
 
+// Deleted tags are stored with Len = 0.
+// At init, the current bank is walked once to build a RAM directory of the latest entry per tag.
+// Lookups and migration use the directory. If there are more than MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS
+// tags, the remaining ones are found by scanning the bank.
+
 #define BTSTACK_TLV_HEADER_LEN 8
 static const char * btstack_tlv_header_magic = "BTstack";
 
@@ -80,7 +85,8 @@ static int btstack_tlv_flash_sector_iterator_has_next(btstack_tlv_flash_sector_t
 
 static void tlv_iterator_fetch_next(btstack_tlv_flash_sector_t * self, tlv_iterator_t * it){
 	it->offset += 8 + it->len;
-	if (it->offset >= self->hal_flash_sector_impl->get_size(self->hal_flash_sector_context)) {
+	// no room for another entry header
+	if (it->offset + 8 > self->hal_flash_sector_impl->get_size(self->hal_flash_sector_context)) {
 		it->tag = 0xffffffff;
 		it->len = 0;
 		return;
@@ -116,60 +122,153 @@ static void btstack_tlv_flash_sector_write_header(btstack_tlv_flash_sector_t * s
 	self->hal_flash_sector_impl->write(self->hal_flash_sector_context, bank, 0, header, BTSTACK_TLV_HEADER_LEN);
 }
 
-static void btstack_tlv_flash_sector_migrate(btstack_tlv_flash_sector_t * self){
+// Directory: latest entry of each tag in current bank, sorted by tag
+
+// @returns index of tag or -(insert position + 1) if not found
+static int btstack_tlv_flash_sector_directory_find(btstack_tlv_flash_sector_t * self, uint32_t tag){
+	int low  = 0;
+	int high = self->directory_size - 1;
+	while (low <= high){
+		int mid = (low + high) / 2;
+		uint32_t mid_tag = self->directory[mid].tag;
+		if (mid_tag == tag) return mid;
+		if (mid_tag < tag){
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return -(low + 1);
+}
 
-	int next_bank = 1 - self->current_bank;
+// track latest entry for tag, len == 0 marks deleted tag
+static void btstack_tlv_flash_sector_directory_update(btstack_tlv_flash_sector_t * self, uint32_t tag, uint32_t offset, uint32_t len){
+	int index = btstack_tlv_flash_sector_directory_find(self, tag);
+	if (index >= 0){
+		if (len == 0){
+			// remove
+			memmove(&self->directory[index], &self->directory[index+1], (self->directory_size - index - 1) * sizeof(btstack_tlv_flash_sector_directory_entry_t));
+			self->directory_size--;
+			return;
+		}
+		self->directory[index].offset = offset;
+		self->directory[index].len    = len;
+		return;
+	}
+	if (len == 0) return;
+	if (self->directory_size == MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS){
+		if (!self->directory_overflow){
+			log_info("directory full, tag %x only stored in flash", tag);
+		}
+		self->directory_overflow = 1;
+		return;
+	}
+	index = -index - 1;
+	memmove(&self->directory[index+1], &self->directory[index], (self->directory_size - index) * sizeof(btstack_tlv_flash_sector_directory_entry_t));
+	self->directory[index].tag    = tag;
+	self->directory[index].offset = offset;
+	self->directory[index].len    = len;
+	self->directory_size++;
+}
 
-	// @TODO erase might not be needed - resp. already been performed
-	self->hal_flash_sector_impl->erase(self->hal_flash_sector_context, next_bank);
-	int next_write_pos = 8;
+// walk current bank once, sets directory and write offset
+static void btstack_tlv_flash_sector_directory_build(btstack_tlv_flash_sector_t * self){
+	self->directory_size = 0;
+	self->directory_overflow = 0;
+	tlv_iterator_t it;
+	btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
+	while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
+		btstack_tlv_flash_sector_directory_update(self, it.tag, it.offset, it.len);
+		tlv_iterator_fetch_next(self, &it);
+	}
+	self->write_offset = it.offset;
+}
 
+// find latest entry for tag in flash, only needed if directory overflowed
+// @returns offset of entry or 0 if not found
+static uint32_t btstack_tlv_flash_sector_find_latest(btstack_tlv_flash_sector_t * self, uint32_t tag, uint32_t * tag_len){
+	uint32_t tag_index = 0;
 	tlv_iterator_t it;
 	btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
 	while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
-		// check if already exist in next bank
-		int found = 0;
-		tlv_iterator_t next_it;
-		btstack_tlv_flash_sector_iterator_init(self, &next_it, next_bank);
-		while (btstack_tlv_flash_sector_iterator_has_next(self, &next_it)){
-			if (next_it.tag == it.tag){
-				found = 1;
-				break;
-			}
-			tlv_iterator_fetch_next(self, &next_it);
+		if (it.tag == tag){
+			tag_index = it.offset;
+			*tag_len  = it.len;
 		}
-		log_info("tag %x in next bank %u", it.tag, found);
-		if (found) {
-			tlv_iterator_fetch_next(self, &it);
-			continue;
+		tlv_iterator_fetch_next(self, &it);
+	}
+	return tag_index;
+}
+
+// @returns offset of entry or 0 if not found
+static uint32_t btstack_tlv_flash_sector_lookup(btstack_tlv_flash_sector_t * self, uint32_t tag, uint32_t * tag_len){
+	int index = btstack_tlv_flash_sector_directory_find(self, tag);
+	if (index >= 0){
+		*tag_len = self->directory[index].len;
+		return self->directory[index].offset;
+	}
+	if (!self->directory_overflow) return 0;
+	self->statistics.directory_misses++;
+	return btstack_tlv_flash_sector_find_latest(self, tag, tag_len);
+}
+
+static void btstack_tlv_flash_sector_erase(btstack_tlv_flash_sector_t * self, int bank){
+	self->hal_flash_sector_impl->erase(self->hal_flash_sector_context, bank);
+	self->statistics.erase_count[bank]++;
+}
+
+static void btstack_tlv_flash_sector_copy(btstack_tlv_flash_sector_t * self, uint32_t tag_index, int next_bank, uint32_t next_write_pos, uint32_t bytes_to_copy){
+	log_info("migrate %u len %u -> %u", tag_index, bytes_to_copy, next_write_pos);
+	self->statistics.bytes_written += bytes_to_copy;
+	uint8_t copy_buffer[32];
+	while (bytes_to_copy){
+		int bytes_this_iteration = btstack_min(bytes_to_copy, sizeof(copy_buffer));
+		self->hal_flash_sector_impl->read(self->hal_flash_sector_context, self->current_bank, tag_index, copy_buffer, bytes_this_iteration);
+		self->hal_flash_sector_impl->write(self->hal_flash_sector_context, next_bank, next_write_pos, copy_buffer, bytes_this_iteration);
+		tag_index      += bytes_this_iteration;
+		next_write_pos += bytes_this_iteration;
+		bytes_to_copy  -= bytes_this_iteration;
+	}
+}
+
+// copy latest value of all tags into other bank, deleted tags are dropped
+static void btstack_tlv_flash_sector_migrate(btstack_tlv_flash_sector_t * self){
+
+	int next_bank = 1 - self->current_bank;
+
+	btstack_tlv_flash_sector_erase(self, next_bank);
+	uint32_t next_write_pos = BTSTACK_TLV_HEADER_LEN;
+
+	if (!self->directory_overflow){
+		// single pass over directory, offsets are updated in place
+		int i;
+		for (i=0;i<self->directory_size;i++){
+			btstack_tlv_flash_sector_directory_entry_t * entry = &self->directory[i];
+			uint32_t bytes_to_copy = 8 + entry->len;
+			btstack_tlv_flash_sector_copy(self, entry->offset, next_bank, next_write_pos, bytes_to_copy);
+			entry->offset   = next_write_pos;
+			next_write_pos += bytes_to_copy;
 		}
-	
-		// finde latest value for this one
-		uint32_t tag_index = 0;
-		uint32_t tag_len   = 0;
-		tlv_iterator_t scan_it;
-		btstack_tlv_flash_sector_iterator_init(self, &scan_it, self->current_bank);
-		while (btstack_tlv_flash_sector_iterator_has_next(self, &scan_it)){
-			if (scan_it.tag == it.tag){
-				tag_index = scan_it.offset;
-				tag_len   = scan_it.len;
+	} else {
+		// copy entries that are the latest for their tag
+		tlv_iterator_t it;
+		btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
+		while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
+			uint32_t tag_len = 0;
+			uint32_t tag_index;
+			int index = btstack_tlv_flash_sector_directory_find(self, it.tag);
+			if (index >= 0){
+				tag_index = self->directory[index].offset;
+				tag_len   = self->directory[index].len;
+			} else {
+				tag_index = btstack_tlv_flash_sector_find_latest(self, it.tag, &tag_len);
 			}
-			tlv_iterator_fetch_next(self, &scan_it);
-		}
-		// copy
-		int bytes_to_copy = 8 + tag_len;
-		log_info("migrate %u len %u -> %u", tag_index, bytes_to_copy, next_write_pos);
-		uint8_t copy_buffer[32];
-		while (bytes_to_copy){
-			int bytes_this_iteration = btstack_min(bytes_to_copy, sizeof(copy_buffer));
-			self->hal_flash_sector_impl->read(self->hal_flash_sector_context, self->current_bank, tag_index, copy_buffer, bytes_this_iteration);
-			self->hal_flash_sector_impl->write(self->hal_flash_sector_context, next_bank, next_write_pos, copy_buffer, bytes_this_iteration);
-			tag_index      += bytes_this_iteration;
-			next_write_pos += bytes_this_iteration;
-			bytes_to_copy  -= bytes_this_iteration;
+			if (tag_index == it.offset && tag_len){
+				btstack_tlv_flash_sector_copy(self, tag_index, next_bank, next_write_pos, 8 + tag_len);
+				next_write_pos += 8 + tag_len;
+			}
+			tlv_iterator_fetch_next(self, &it);
 		}
-
-		tlv_iterator_fetch_next(self, &it);
 	}
 
 	// prepare new one
@@ -178,6 +277,12 @@ static void btstack_tlv_flash_sector_migrate(btstack_tlv_flash_sector_t * self){
 	btstack_tlv_flash_sector_write_header(self, next_bank, (epoch_buffer + 1) & 3);
 	self->current_bank = next_bank;
 	self->write_offset = next_write_pos;
+	self->statistics.migrations++;
+
+	if (self->directory_overflow){
+		// fewer tags might fit now
+		btstack_tlv_flash_sector_directory_build(self);
+	}
 }
 
 /**
@@ -191,20 +296,10 @@ static int btstack_tlv_flash_sector_get_tag(void * context, uint32_t tag, uint8_
 
 	btstack_tlv_flash_sector_t * self = (btstack_tlv_flash_sector_t *) context;
 
-	uint32_t tag_index = 0;
 	uint32_t tag_len   = 0;
-	tlv_iterator_t it;
-	btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
-	while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
-		log_info("Offset %u, tag %x", it.offset, it.tag);
-		if (it.tag == tag){
-			log_info("Found tag '%x' at position %u", tag, it.offset);
-			tag_index = it.offset;
-			tag_len   = it.len;
-		}
-		tlv_iterator_fetch_next(self, &it);
-	}
+	uint32_t tag_index = btstack_tlv_flash_sector_lookup(self, tag, &tag_len);
 	if (tag_index == 0) return 0;
+	log_info("Found tag '%x' at position %u", tag, tag_index);
 	if (!buffer) return tag_len;
 	int copy_size = btstack_min(buffer_size, tag_len);
 	self->hal_flash_sector_impl->read(self->hal_flash_sector_context, self->current_bank, tag_index + 8, buffer, copy_size);
@@ -221,9 +316,15 @@ static void btstack_tlv_flash_sector_store_tag(void * context, uint32_t tag, con
 
 	btstack_tlv_flash_sector_t * self = (btstack_tlv_flash_sector_t *) context;
 
-	if (self->write_offset + 8 + data_size > self->hal_flash_sector_impl->get_size(self->hal_flash_sector_context)){
+	uint32_t bank_size = self->hal_flash_sector_impl->get_size(self->hal_flash_sector_context);
+	if (self->write_offset + 8 + data_size > bank_size){
 		btstack_tlv_flash_sector_migrate(self);
 	}
+	if (self->write_offset + 8 + data_size > bank_size){
+		log_error("store tag '%x' failed, no space left", tag);
+		return;
+	}
+
 	// prepare entry
 	uint8_t entry[8];
 	big_endian_store_32(entry, 0, tag);
@@ -232,12 +333,18 @@ static void btstack_tlv_flash_sector_store_tag(void * context, uint32_t tag, con
 	log_info("write '%x', len %u at %u", tag, data_size, self->write_offset);
 
 	// write value first
-	self->hal_flash_sector_impl->write(self->hal_flash_sector_context, self->current_bank, self->write_offset + 8, data, data_size);
+	if (data_size){
+		self->hal_flash_sector_impl->write(self->hal_flash_sector_context, self->current_bank, self->write_offset + 8, data, data_size);
+	}
 
 	// then entry
 	self->hal_flash_sector_impl->write(self->hal_flash_sector_context, self->current_bank, self->write_offset, entry, sizeof(entry));
 
+	btstack_tlv_flash_sector_directory_update(self, tag, self->write_offset, data_size);
+
 	self->write_offset += sizeof(entry) + data_size;
+	self->statistics.entries_written++;
+	self->statistics.bytes_written += sizeof(entry) + data_size;
 }
 
 /**
@@ -261,6 +368,7 @@ const btstack_tlv_t * btstack_tlv_flash_sector_init_instance(btstack_tlv_flash_s
 
 	self->hal_flash_sector_impl    = hal_flash_sector_impl;
 	self->hal_flash_sector_context = hal_flash_sector_context;
+	memset(&self->statistics, 0, sizeof(self->statistics));
 
 	// find current bank and erase both if none found
 	int current_bank = btstack_tlv_flash_sector_get_latest_bank(self);
@@ -268,22 +376,44 @@ const btstack_tlv_t * btstack_tlv_flash_sector_init_instance(btstack_tlv_flash_s
 	if (current_bank < 0){
 		log_info("erase both banks");
 		// erase both to get into stable state
-		hal_flash_sector_impl->erase(hal_flash_sector_context, 0);
-		hal_flash_sector_impl->erase(hal_flash_sector_context, 1);
+		btstack_tlv_flash_sector_erase(self, 0);
+		btstack_tlv_flash_sector_erase(self, 1);
 		current_bank = 0;
 		btstack_tlv_flash_sector_write_header(self, current_bank, 0);	// epoch = 0;
 	}
 	self->current_bank = current_bank;
 
-	// find write offset
-	tlv_iterator_t it;
-	btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
-	while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
-		tlv_iterator_fetch_next(self, &it);
-	}
-	self->write_offset = it.offset;
-	log_info("write offset %u", self->write_offset);
+	// build directory and find write offset
+	btstack_tlv_flash_sector_directory_build(self);
+	log_info("write offset %u, %u tags", self->write_offset, self->directory_size);
 
 	return &btstack_tlv_flash_sector;
 }
 
+/**
+ * Get usage and wear statistics
+ */
+void btstack_tlv_flash_sector_get_statistics(btstack_tlv_flash_sector_t * self, btstack_tlv_flash_sector_statistics_t * statistics){
+	*statistics = self->statistics;
+	statistics->bytes_free = self->hal_flash_sector_impl->get_size(self->hal_flash_sector_context) - self->write_offset;
+	uint32_t bytes_live = 0;
+	if (!self->directory_overflow){
+		int i;
+		for (i=0;i<self->directory_size;i++){
+			bytes_live += 8 + self->directory[i].len;
+		}
+	} else {
+		tlv_iterator_t it;
+		btstack_tlv_flash_sector_iterator_init(self, &it, self->current_bank);
+		while (btstack_tlv_flash_sector_iterator_has_next(self, &it)){
+			uint32_t tag_len = 0;
+			uint32_t tag_index = btstack_tlv_flash_sector_find_latest(self, it.tag, &tag_len);
+			if (tag_index == it.offset && tag_len){
+				bytes_live += 8 + tag_len;
+			}
+			tlv_iterator_fetch_next(self, &it);
+		}
+	}
+	statistics->bytes_live  = bytes_live;
+	statistics->bytes_stale = self->write_offset - BTSTACK_TLV_HEADER_LEN - bytes_live;
+}
@@ -40,6 +40,7 @@
 #define __BTSTACK_TLV_FLASH_SECTOR_H
 
 #include <stdint.h>
+#include "btstack_config.h"
 #include "btstack_tlv.h"
 #include "hal_flash_sector.h"
 
@@ -47,11 +48,38 @@
 extern "C" {
 #endif
 
+// Number of tags tracked in RAM, lookups of additional tags scan the flash bank
+#ifndef MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS
+#define MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS 16
+#endif
+
+typedef struct {
+	uint32_t tag;
+	uint32_t offset;	// of latest entry in current bank
+	uint32_t len;
+} btstack_tlv_flash_sector_directory_entry_t;
+
+typedef struct {
+	uint32_t erase_count[HAL_FLASH_SECTOR_NUM];	// since init
+	uint32_t migrations;
+	uint32_t entries_written;
+	uint32_t bytes_written;		// entries and migrated data
+	uint32_t directory_misses;	// lookups that scanned the flash bank
+	uint32_t bytes_live;		// current bank, latest entries of valid tags
+	uint32_t bytes_stale;		// current bank, outdated and deleted entries
+	uint32_t bytes_free;		// current bank
+} btstack_tlv_flash_sector_statistics_t;
+
 typedef struct {
 	const hal_flash_sector_t * hal_flash_sector_impl;
 	void * hal_flash_sector_context;
 	int current_bank;
 	int write_offset;
+	// directory sorted by tag
+	btstack_tlv_flash_sector_directory_entry_t directory[MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS];
+	int directory_size;
+	int directory_overflow;
+	btstack_tlv_flash_sector_statistics_t statistics;
 } btstack_tlv_flash_sector_t;
 
 /**
@@ -62,6 +90,13 @@ typedef struct {
  */
 const btstack_tlv_t * btstack_tlv_flash_sector_init_instance(btstack_tlv_flash_sector_t * context, const hal_flash_sector_t * hal_flash_sector_impl, void * hal_flash_sector_context);
 
+/**
+ * Get usage and wear statistics
+ * @param context btstack_tlv_flash_sector_t
+ * @param statistics
+ */
+void btstack_tlv_flash_sector_get_statistics(btstack_tlv_flash_sector_t * context, btstack_tlv_flash_sector_statistics_t * statistics);
+
 #if defined __cplusplus
 }
 #endif
@@ -81,7 +81,7 @@ static void hal_flash_sector_memory_write(void * context, int bank, uint32_t off
 #ifdef BTSTACK_TEST
 	int i;
 	for (i=0;i<size;i++){
-		if (self->banks[bank][offset] != 0xff){
+		if (self->banks[bank][offset+i] != 0xff){
 			printf("Error: offset %u written twice!\n", offset+i);
 			exit(10);
 			return;			
@@ -53,6 +53,27 @@ extern "C" {
 
 uint32_t hal_time_ms(void);
 
+// one-shot alarm, only required for ENABLE_EMBEDDED_TICKLESS
+
+/**
+ * @brief Set handler for alarm, called from IRQ context
+ * @param alarm_handler
+ */
+void hal_time_ms_set_alarm_handler(void (*alarm_handler)(void));
+
+/**
+ * @brief Program one-shot alarm, replaces active alarm. Alarm handler has to be called as soon as
+ *        hal_time_ms() reaches alarm_time_ms, or right away if it is already in the past.
+ *        The MCU needs to be able to wake up from sleep for this.
+ * @param alarm_time_ms absolute time
+ */
+void hal_time_ms_set_alarm(uint32_t alarm_time_ms);
+
+/**
+ * @brief Cancel active alarm
+ */
+void hal_time_ms_clear_alarm(void);
+
 #if defined __cplusplus
 }
 #endif
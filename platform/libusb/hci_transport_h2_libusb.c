@@ -58,6 +58,9 @@
 #include <string.h>
 #include <unistd.h>   /* UNIX standard function definitions */
 #include <sys/types.h>
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 #include <libusb.h>
 
@@ -67,16 +70,51 @@
 #include "hci.h"
 #include "hci_transport.h"
 
+#ifndef POLLIN
+#define POLLIN  0x0001
+#define POLLOUT 0x0004
+#endif
+
 #if (USB_VENDOR_ID != 0) && (USB_PRODUCT_ID != 0)
 #define HAVE_USB_VENDOR_ID_AND_PRODUCT_ID
 #endif
 
+// number of in-flight transfers per endpoint, can be increased in btstack_config.h for higher throughput
+#ifdef HCI_TRANSPORT_USB_ACL_IN_BUFFER_COUNT
+#define ACL_IN_BUFFER_COUNT HCI_TRANSPORT_USB_ACL_IN_BUFFER_COUNT
+#else
 #define ACL_IN_BUFFER_COUNT    3
+#endif
+#ifdef HCI_TRANSPORT_USB_EVENT_IN_BUFFER_COUNT
+#define EVENT_IN_BUFFER_COUNT HCI_TRANSPORT_USB_EVENT_IN_BUFFER_COUNT
+#else
 #define EVENT_IN_BUFFER_COUNT  3
+#endif
+#ifdef HCI_TRANSPORT_USB_SCO_IN_BUFFER_COUNT
+#define SCO_IN_BUFFER_COUNT HCI_TRANSPORT_USB_SCO_IN_BUFFER_COUNT
+#else
 #define SCO_IN_BUFFER_COUNT   10
+#endif
 
+// only used if libusb doesn't provide pollfds, e.g. on Windows
 #define ASYNC_POLLING_INTERVAL_MS 1
 
+// max number of file descriptors provided by libusb: event, timer and one per open device
+#define USB_MAX_POLLFDS (4 + HCI_TRANSPORT_USB_MAX_DEVICES)
+
+// number of USB Bluetooth devices that can be open at the same time, one per HCI controller
+#ifndef HCI_TRANSPORT_USB_MAX_DEVICES
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+#define HCI_TRANSPORT_USB_MAX_DEVICES MAX_NR_HCI_CONTROLLERS
+#else
+#define HCI_TRANSPORT_USB_MAX_DEVICES 1
+#endif
+#endif
+
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 4
+#error "HCI_TRANSPORT_USB_MAX_DEVICES > 4 not supported"
+#endif
+
 //
 // Bluetooth USB Transport Alternate Settings:
 //
@@ -97,6 +135,12 @@ static const int alt_setting_16_bit[] = {2,4,5};
 // One complete SCO packet with 24 frames every 3 frames (== 3 ms)
 #define NUM_ISO_PACKETS (3)
 
+// for mSBC (transparent air mode) with ALT_SETTING 1, an SCO packet with 60 bytes payload every 7 frames (== 7 ms)
+#define NUM_ISO_PACKETS_MSBC (7)
+
+// outgoing SCO packets are sent with as many isochronous packets as needed
+#define MAX_NUM_ISO_PACKETS (8)
+
 static const uint16_t iso_packet_size_for_alt_setting[] = {
     0,
     9,
@@ -119,10 +163,6 @@ static const uint16_t iso_packet_size_for_alt_setting[] = {
 // seems to be the max depth for USB 3
 #define USB_MAX_PATH_LEN 7
 
-// prototypes
-static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size); 
-static int usb_close(void);    
-
 typedef enum {
     LIB_USB_CLOSED = 0,
     LIB_USB_OPENED,
@@ -137,121 +177,158 @@ typedef enum {
     H2_W4_PAYLOAD,
 } H2_SCO_STATE;
 
-static libusb_state_t libusb_state = LIB_USB_CLOSED;
+#ifdef ENABLE_SCO_OVER_HCI
+#ifdef _WIN32
+#error "SCO not working on Win32 (Windows 8, libusb 1.0.19, Zadic WinUSB), please uncomment ENABLE_SCO_OVER_HCI in btstack-config.h for now"
+#endif
+#endif
+
+// state of a single USB Bluetooth device
+typedef struct {
 
-// single instance
-static hci_transport_t * hci_transport_usb = NULL;
+    libusb_state_t libusb_state;
 
-static void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size) = dummy_handler;
+    void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
 
-// libusb
+    // libusb
 #ifndef HAVE_USB_VENDOR_ID_AND_PRODUCT_ID
-static struct libusb_device_descriptor desc;
-static libusb_device        * dev;
+    struct libusb_device_descriptor desc;
+    libusb_device        * dev;
 #endif
-static libusb_device_handle * handle;
+    libusb_device_handle * handle;
 
-static struct libusb_transfer *command_out_transfer;
-static struct libusb_transfer *acl_out_transfer;
-static struct libusb_transfer *event_in_transfer[EVENT_IN_BUFFER_COUNT];
-static struct libusb_transfer *acl_in_transfer[ACL_IN_BUFFER_COUNT];
+    struct libusb_transfer *command_out_transfer;
+    struct libusb_transfer *acl_out_transfer;
+    struct libusb_transfer *event_in_transfer[EVENT_IN_BUFFER_COUNT];
+    struct libusb_transfer *acl_in_transfer[ACL_IN_BUFFER_COUNT];
 
 #ifdef ENABLE_SCO_OVER_HCI
-
-#ifdef _WIN32
-#error "SCO not working on Win32 (Windows 8, libusb 1.0.19, Zadic WinUSB), please uncomment ENABLE_SCO_OVER_HCI in btstack-config.h for now"
+    // incoming SCO
+    H2_SCO_STATE sco_state;
+    uint8_t  sco_buffer[255+3 + SCO_PACKET_SIZE];
+    uint16_t sco_read_pos;
+    uint16_t sco_bytes_to_read;
+    struct  libusb_transfer *sco_in_transfer[SCO_IN_BUFFER_COUNT];
+    uint8_t hci_sco_in_buffer[SCO_IN_BUFFER_COUNT][SCO_PACKET_SIZE]; 
+
+    // outgoing SCO
+    uint8_t  sco_out_ring_buffer[SCO_OUT_BUFFER_SIZE];
+    int      sco_ring_write;  // packet idx
+    int      sco_out_transfers_active;
+    struct libusb_transfer *sco_out_transfers[SCO_OUT_BUFFER_COUNT];
+    int      sco_out_transfers_in_flight[SCO_OUT_BUFFER_COUNT];
+
+    // pause/resume
+    uint16_t sco_voice_setting;
+    int      sco_num_connections;
+    int      sco_shutdown;
+
+    // dynamic SCO configuration
+    uint16_t iso_packet_size;
+    int      num_iso_packets;
 #endif
 
-// incoming SCO
-static H2_SCO_STATE sco_state;
-static uint8_t  sco_buffer[255+3 + SCO_PACKET_SIZE];
-static uint16_t sco_read_pos;
-static uint16_t sco_bytes_to_read;
-static struct  libusb_transfer *sco_in_transfer[SCO_IN_BUFFER_COUNT];
-static uint8_t hci_sco_in_buffer[SCO_IN_BUFFER_COUNT][SCO_PACKET_SIZE]; 
-
-// outgoing SCO
-static uint8_t  sco_out_ring_buffer[SCO_OUT_BUFFER_SIZE];
-static int      sco_ring_write;  // packet idx
-static int      sco_out_transfers_active;
-static struct libusb_transfer *sco_out_transfers[SCO_OUT_BUFFER_COUNT];
-static int      sco_out_transfers_in_flight[SCO_OUT_BUFFER_COUNT];
-
-// pause/resume
-static uint16_t sco_voice_setting;
-static int      sco_num_connections;
-static int      sco_shutdown;
-
-// dynamic SCO configuration
-static uint16_t iso_packet_size;
+    // outgoing buffer for HCI Command packets
+    uint8_t hci_cmd_buffer[3 + 256 + LIBUSB_CONTROL_SETUP_SIZE];
 
-#endif
+    // incoming buffer for HCI Events and ACL Packets
+    uint8_t hci_event_in_buffer[EVENT_IN_BUFFER_COUNT][HCI_ACL_BUFFER_SIZE]; // bigger than largest packet
+    uint8_t hci_acl_in_buffer[ACL_IN_BUFFER_COUNT][HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_BUFFER_SIZE]; 
 
-// outgoing buffer for HCI Command packets
-static uint8_t hci_cmd_buffer[3 + 256 + LIBUSB_CONTROL_SETUP_SIZE];
+    // For (ab)use as a linked list of received packets
+    struct libusb_transfer *handle_packet;
 
-// incoming buffer for HCI Events and ACL Packets
-static uint8_t hci_event_in_buffer[EVENT_IN_BUFFER_COUNT][HCI_ACL_BUFFER_SIZE]; // bigger than largest packet
-static uint8_t hci_acl_in_buffer[ACL_IN_BUFFER_COUNT][HCI_INCOMING_PRE_BUFFER_SIZE + HCI_ACL_BUFFER_SIZE]; 
+    int usb_acl_out_active;
+    int usb_command_active;
+
+    // endpoint addresses
+    int event_in_addr;
+    int acl_in_addr;
+    int acl_out_addr;
+    int sco_in_addr;
+    int sco_out_addr;
+
+    // device path
+    int usb_path_len;
+    uint8_t usb_path[USB_MAX_PATH_LEN];
+
+} usb_device_t;
+
+// prototypes
+static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size); 
+static int usb_close(usb_device_t * usb);
 
-// For (ab)use as a linked list of received packets
-static struct libusb_transfer *handle_packet;
+static usb_device_t usb_devices[HCI_TRANSPORT_USB_MAX_DEVICES];
 
+// shared by all devices, as libusb events are handled for the default context
+static int usb_devices_active;
 static int doing_pollfds;
+static int usb_handle_timeouts;
 static int num_pollfds;
-static btstack_data_source_t * pollfd_data_sources;
+static btstack_data_source_t pollfd_data_sources[USB_MAX_POLLFDS];
 static btstack_timer_source_t usb_timer;
 static int usb_timer_active;
 
-static int usb_acl_out_active = 0;
-static int usb_command_active = 0;
-
-// endpoint addresses
-static int event_in_addr;
-static int acl_in_addr;
-static int acl_out_addr;
-static int sco_in_addr;
-static int sco_out_addr;
-
-// device path
-static int usb_path_len;
-static uint8_t usb_path[USB_MAX_PATH_LEN];
+// statistics
+static uint32_t usb_num_wakeups;
+static uint32_t usb_num_transfers;
 
 
 #ifdef ENABLE_SCO_OVER_HCI
-static void sco_ring_init(void){
-    sco_ring_write = 0;
-    sco_out_transfers_active = 0;
+static void sco_ring_init(usb_device_t * usb){
+    usb->sco_ring_write = 0;
+    usb->sco_out_transfers_active = 0;
 }
-static int sco_ring_have_space(void){
-    return sco_out_transfers_active < SCO_OUT_BUFFER_COUNT;
+static int sco_ring_have_space(usb_device_t * usb){
+    return usb->sco_out_transfers_active < SCO_OUT_BUFFER_COUNT;
 }
 #endif
 
-void hci_transport_usb_set_path(int len, uint8_t * port_numbers){
-    if (len > USB_MAX_PATH_LEN || !port_numbers){
-        log_error("hci_transport_usb_set_path: len or port numbers invalid");
+static usb_device_t * usb_device_for_index(int device_index){
+    if (device_index < 0 || device_index >= HCI_TRANSPORT_USB_MAX_DEVICES) return NULL;
+    return &usb_devices[device_index];
+}
+
+// transfers are mapped to their device via the device handle, as user_data is used for the packet list
+static usb_device_t * usb_device_for_transfer(struct libusb_transfer *transfer){
+    int i;
+    for (i=0;i<HCI_TRANSPORT_USB_MAX_DEVICES;i++){
+        usb_device_t * usb = &usb_devices[i];
+        if (usb->libusb_state == LIB_USB_CLOSED) continue;
+        if (usb->handle == transfer->dev_handle) return usb;
+    }
+    return NULL;
+}
+
+void hci_transport_usb_set_path_for_device(int device_index, int len, uint8_t * port_numbers){
+    usb_device_t * usb = usb_device_for_index(device_index);
+    if (!usb || len > USB_MAX_PATH_LEN || !port_numbers){
+        log_error("hci_transport_usb_set_path: device index, len or port numbers invalid");
         return;
     } 
-    usb_path_len = len;
-    memcpy(usb_path, port_numbers, len);
+    usb->usb_path_len = len;
+    memcpy(usb->usb_path, port_numbers, len);
+}
+
+void hci_transport_usb_set_path(int len, uint8_t * port_numbers){
+    hci_transport_usb_set_path_for_device(0, len, port_numbers);
 }
 
 //
-static void queue_transfer(struct libusb_transfer *transfer){
+static void queue_transfer(usb_device_t * usb, struct libusb_transfer *transfer){
 
     // log_info("queue_transfer %p, endpoint %x size %u", transfer, transfer->endpoint, transfer->actual_length);
 
     transfer->user_data = NULL;
 
     // insert first element
-    if (handle_packet == NULL) {
-        handle_packet = transfer;
+    if (usb->handle_packet == NULL) {
+        usb->handle_packet = transfer;
         return;
     }
 
     // Walk to end of list and add current packet there
-    struct libusb_transfer *temp = handle_packet;
+    struct libusb_transfer *temp = usb->handle_packet;
     while (temp->user_data) {
         temp = (struct libusb_transfer*)temp->user_data;
     }
@@ -262,40 +339,46 @@ LIBUSB_CALL static void async_callback(struct libusb_transfer *transfer){
 
     int c;
 
+    usb_device_t * usb = usb_device_for_transfer(transfer);
+    if (!usb){
+        log_error("async_callback: no device for transfer %p", transfer);
+        return;
+    }
+
     // identify and free transfers as part of shutdown
 #ifdef ENABLE_SCO_OVER_HCI
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED || sco_shutdown) {
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED || usb->sco_shutdown) {
         for (c=0;c<SCO_IN_BUFFER_COUNT;c++){
-            if (transfer == sco_in_transfer[c]){
+            if (transfer == usb->sco_in_transfer[c]){
                 libusb_free_transfer(transfer);
-                sco_in_transfer[c] = 0;
+                usb->sco_in_transfer[c] = 0;
                 return;
             }
         }
 
         for (c=0;c<SCO_OUT_BUFFER_COUNT;c++){
-            if (transfer == sco_out_transfers[c]){
-                sco_out_transfers_in_flight[c] = 0;
+            if (transfer == usb->sco_out_transfers[c]){
+                usb->sco_out_transfers_in_flight[c] = 0;
                 libusb_free_transfer(transfer);
-                sco_out_transfers[c] = 0;
+                usb->sco_out_transfers[c] = 0;
                 return;
             }
         }
     }
 #endif
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) {
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) {
         for (c=0;c<EVENT_IN_BUFFER_COUNT;c++){
-            if (transfer == event_in_transfer[c]){
+            if (transfer == usb->event_in_transfer[c]){
                 libusb_free_transfer(transfer);
-                event_in_transfer[c] = 0;
+                usb->event_in_transfer[c] = 0;
                 return;
             }
         }
         for (c=0;c<ACL_IN_BUFFER_COUNT;c++){
-            if (transfer == acl_in_transfer[c]){
+            if (transfer == usb->acl_in_transfer[c]){
                 libusb_free_transfer(transfer);
-                acl_in_transfer[c] = 0;
+                usb->acl_in_transfer[c] = 0;
                 return;
             }
         }
@@ -305,8 +388,8 @@ LIBUSB_CALL static void async_callback(struct libusb_transfer *transfer){
 #ifdef ENABLE_SCO_OVER_HCI
     // mark SCO OUT transfer as done
     for (c=0;c<SCO_OUT_BUFFER_COUNT;c++){
-        if (transfer == sco_out_transfers[c]){
-            sco_out_transfers_in_flight[c] = 0;
+        if (transfer == usb->sco_out_transfers[c]){
+            usb->sco_out_transfers_in_flight[c] = 0;
         }
     }
 #endif
@@ -315,10 +398,10 @@ LIBUSB_CALL static void async_callback(struct libusb_transfer *transfer){
     // log_info("begin async_callback endpoint %x, status %x, actual length %u", transfer->endpoint, transfer->status, transfer->actual_length );
 
     if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
-        queue_transfer(transfer);
+        queue_transfer(usb, transfer);
     } else if (transfer->status == LIBUSB_TRANSFER_STALL){
         log_info("-> Transfer stalled, trying again");
-        r = libusb_clear_halt(handle, transfer->endpoint);
+        r = libusb_clear_halt(usb->handle, transfer->endpoint);
         if (r) {
             log_error("Error rclearing halt %d", r);
         }
@@ -339,23 +422,33 @@ LIBUSB_CALL static void async_callback(struct libusb_transfer *transfer){
 
 
 #ifdef ENABLE_SCO_OVER_HCI
-static int usb_send_sco_packet(uint8_t *packet, int size){
+static int usb_send_sco_packet(usb_device_t * usb, uint8_t *packet, int size){
     int r;
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
 
     // log_info("usb_send_acl_packet enter, size %u", size);
 
+    // send complete packet, e.g. 63 bytes for mSBC require 7 iso packets with alt setting 1
+    int num_iso_packets = (size + usb->iso_packet_size - 1) / usb->iso_packet_size;
+    if (num_iso_packets < usb->num_iso_packets){
+        num_iso_packets = usb->num_iso_packets;
+    }
+    if (size > SCO_PACKET_SIZE || num_iso_packets > MAX_NUM_ISO_PACKETS){
+        log_error("usb_send_sco_packet: packet size %u too large for iso packet size %u", size, usb->iso_packet_size);
+        return -1;
+    }
+
     // store packet in free slot
-    int tranfer_index = sco_ring_write;
-    uint8_t * data = &sco_out_ring_buffer[tranfer_index * SCO_PACKET_SIZE];
+    int tranfer_index = usb->sco_ring_write;
+    uint8_t * data = &usb->sco_out_ring_buffer[tranfer_index * SCO_PACKET_SIZE];
     memcpy(data, packet, size);
 
     // setup transfer
-    // log_info("usb_send_sco_packet: size %u, max size %u, iso packet size %u", size, NUM_ISO_PACKETS * iso_packet_size, iso_packet_size);
-    struct libusb_transfer * sco_transfer = sco_out_transfers[tranfer_index];
-    libusb_fill_iso_transfer(sco_transfer, handle, sco_out_addr, data, NUM_ISO_PACKETS * iso_packet_size, NUM_ISO_PACKETS, async_callback, NULL, 0);
-    libusb_set_iso_packet_lengths(sco_transfer, iso_packet_size);
+    // log_info("usb_send_sco_packet: size %u, num iso packets %u, iso packet size %u", size, num_iso_packets, iso_packet_size);
+    struct libusb_transfer * sco_transfer = usb->sco_out_transfers[tranfer_index];
+    libusb_fill_iso_transfer(sco_transfer, usb->handle, usb->sco_out_addr, data, num_iso_packets * usb->iso_packet_size, num_iso_packets, async_callback, NULL, 0);
+    libusb_set_iso_packet_lengths(sco_transfer, usb->iso_packet_size);
     r = libusb_submit_transfer(sco_transfer);
     if (r < 0) {
         log_error("Error submitting sco transfer, %d", r);
@@ -363,86 +456,86 @@ static int usb_send_sco_packet(uint8_t *packet, int size){
     }
 
     // mark slot as full
-    sco_ring_write++;
-    if (sco_ring_write == SCO_OUT_BUFFER_COUNT){
-        sco_ring_write = 0;
+    usb->sco_ring_write++;
+    if (usb->sco_ring_write == SCO_OUT_BUFFER_COUNT){
+        usb->sco_ring_write = 0;
     }
-    sco_out_transfers_active++;
-    sco_out_transfers_in_flight[tranfer_index] = 1;
+    usb->sco_out_transfers_active++;
+    usb->sco_out_transfers_in_flight[tranfer_index] = 1;
 
     // log_info("H2: queued packet at index %u, num active %u", tranfer_index, sco_out_transfers_active);
 
     // notify upper stack that provided buffer can be used again
     uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
-    packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+    usb->packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
 
     // and if we have more space for SCO packets
-    if (sco_ring_have_space()) {
+    if (sco_ring_have_space(usb)) {
         uint8_t event_sco[] = { HCI_EVENT_SCO_CAN_SEND_NOW, 0};
-        packet_handler(HCI_EVENT_PACKET, &event_sco[0], sizeof(event_sco));
+        usb->packet_handler(HCI_EVENT_PACKET, &event_sco[0], sizeof(event_sco));
     }
     return 0;
 }
 
-static void sco_state_machine_init(void){
-    sco_state = H2_W4_SCO_HEADER;
-    sco_read_pos = 0;
-    sco_bytes_to_read = 3;
+static void sco_state_machine_init(usb_device_t * usb){
+    usb->sco_state = H2_W4_SCO_HEADER;
+    usb->sco_read_pos = 0;
+    usb->sco_bytes_to_read = 3;
 }
 
-static void handle_isochronous_data(uint8_t * buffer, uint16_t size){
+static void handle_isochronous_data(usb_device_t * usb, uint8_t * buffer, uint16_t size){
     while (size){
-        if (size < sco_bytes_to_read){
+        if (size < usb->sco_bytes_to_read){
             // just store incomplete data
-            memcpy(&sco_buffer[sco_read_pos], buffer, size);
-            sco_read_pos      += size;
-            sco_bytes_to_read -= size;
+            memcpy(&usb->sco_buffer[usb->sco_read_pos], buffer, size);
+            usb->sco_read_pos      += size;
+            usb->sco_bytes_to_read -= size;
             return;
         }
         // copy requested data
-        memcpy(&sco_buffer[sco_read_pos], buffer, sco_bytes_to_read);
-        sco_read_pos += sco_bytes_to_read;
-        buffer       += sco_bytes_to_read;
-        size         -= sco_bytes_to_read;
+        memcpy(&usb->sco_buffer[usb->sco_read_pos], buffer, usb->sco_bytes_to_read);
+        usb->sco_read_pos += usb->sco_bytes_to_read;
+        buffer            += usb->sco_bytes_to_read;
+        size              -= usb->sco_bytes_to_read;
 
         // chunk read successfully, next action
-        switch (sco_state){
+        switch (usb->sco_state){
             case H2_W4_SCO_HEADER:
-                sco_state = H2_W4_PAYLOAD;
-                sco_bytes_to_read = sco_buffer[2];
+                usb->sco_state = H2_W4_PAYLOAD;
+                usb->sco_bytes_to_read = usb->sco_buffer[2];
                 break;
             case H2_W4_PAYLOAD:
                 // packet complete
-                packet_handler(HCI_SCO_DATA_PACKET, sco_buffer, sco_read_pos);
-                sco_state_machine_init();
+                usb->packet_handler(HCI_SCO_DATA_PACKET, usb->sco_buffer, usb->sco_read_pos);
+                sco_state_machine_init(usb);
                 break;
         }
     }
 }
 #endif
 
-static void handle_completed_transfer(struct libusb_transfer *transfer){
+static void handle_completed_transfer(usb_device_t * usb, struct libusb_transfer *transfer){
 
     int resubmit = 0;
     int signal_done = 0;
 
-    if (transfer->endpoint == event_in_addr) {
-        packet_handler(HCI_EVENT_PACKET, transfer-> buffer, transfer->actual_length);
+    if (transfer->endpoint == usb->event_in_addr) {
+        usb->packet_handler(HCI_EVENT_PACKET, transfer-> buffer, transfer->actual_length);
         resubmit = 1;
-    } else if (transfer->endpoint == acl_in_addr) {
+    } else if (transfer->endpoint == usb->acl_in_addr) {
         // log_info("-> acl");
-        packet_handler(HCI_ACL_DATA_PACKET, transfer-> buffer, transfer->actual_length);
+        usb->packet_handler(HCI_ACL_DATA_PACKET, transfer-> buffer, transfer->actual_length);
         resubmit = 1;
     } else if (transfer->endpoint == 0){
         // log_info("command done, size %u", transfer->actual_length);
-        usb_command_active = 0;
+        usb->usb_command_active = 0;
         signal_done = 1;
-    } else if (transfer->endpoint == acl_out_addr){
+    } else if (transfer->endpoint == usb->acl_out_addr){
         // log_info("acl out done, size %u", transfer->actual_length);
-        usb_acl_out_active = 0;
+        usb->usb_acl_out_active = 0;
         signal_done = 1;
 #ifdef ENABLE_SCO_OVER_HCI
-    } else if (transfer->endpoint == sco_in_addr) {
+    } else if (transfer->endpoint == usb->sco_in_addr) {
         // log_info("handle_completed_transfer for SCO IN! num packets %u", transfer->NUM_ISO_PACKETS);
         int i;
         for (i = 0; i < transfer->num_iso_packets; i++) {
@@ -455,10 +548,10 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
             uint8_t * data = libusb_get_iso_packet_buffer_simple(transfer, i);
             // printf_hexdump(data, pack->actual_length);
             // log_info("handle_isochronous_data,size %u/%u", pack->length, pack->actual_length);
-            handle_isochronous_data(data, pack->actual_length);
+            handle_isochronous_data(usb, data, pack->actual_length);
         }
         resubmit = 1;
-    } else if (transfer->endpoint == sco_out_addr){
+    } else if (transfer->endpoint == usb->sco_out_addr){
         int i;
         for (i = 0; i < transfer->num_iso_packets; i++) {
             struct libusb_iso_packet_descriptor *pack = &transfer->iso_packet_desc[i];
@@ -472,12 +565,12 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
         //     transfer->iso_packet_desc[2].actual_length, transfer->iso_packet_desc[2].length, transfer->iso_packet_desc[2].status);
         // notify upper layer if there's space for new SCO packets
 
-        if (sco_ring_have_space()) {
+        if (sco_ring_have_space(usb)) {
             uint8_t event[] = { HCI_EVENT_SCO_CAN_SEND_NOW, 0};
-            packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+            usb->packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
         }
         // decrease tab
-        sco_out_transfers_active--;
+        usb->sco_out_transfers_active--;
         // log_info("H2: sco out complete, num active num active %u", sco_out_transfers_active);
 #endif
     } else {
@@ -487,10 +580,10 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
     if (signal_done){
         // notify upper stack that provided buffer can be used again
         uint8_t event[] = { HCI_EVENT_TRANSPORT_PACKET_SENT, 0};
-        packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
+        usb->packet_handler(HCI_EVENT_PACKET, &event[0], sizeof(event));
     }
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
 
     if (resubmit){
         // Re-submit transfer 
@@ -502,12 +595,54 @@ static void handle_completed_transfer(struct libusb_transfer *transfer){
     }   
 }
 
+static void usb_process_packets(usb_device_t * usb){
+
+    // Handle any packet in the order that they were received
+    while (usb->handle_packet) {
+        // log_info("handle packet %p, endpoint %x, status %x", handle_packet, handle_packet->endpoint, handle_packet->status);
+        void * next = usb->handle_packet->user_data;
+        usb_num_transfers++;
+        handle_completed_transfer(usb, usb->handle_packet);
+        // handle case where libusb_close might be called by hci packet handler        
+        if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+
+        // Move to next in the list of packets to handle
+        if (next) {
+            usb->handle_packet = (struct libusb_transfer*)next;
+        } else {
+            usb->handle_packet = NULL;
+        }
+    }
+}
+
+// libusb timeouts are handled by a run loop timer if libusb doesn't provide a timerfd
+static void usb_update_timeout(void){
+    if (!doing_pollfds || !usb_handle_timeouts) return;
+
+    if (usb_timer_active){
+        btstack_run_loop_remove_timer(&usb_timer);
+        usb_timer_active = 0;
+    }
+
+    if (!usb_devices_active) return;
+
+    struct timeval tv;
+    if (libusb_get_next_timeout(NULL, &tv) != 1) return;
+
+    uint32_t msec = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+    btstack_run_loop_set_timer(&usb_timer, msec);
+    btstack_run_loop_add_timer(&usb_timer);
+    usb_timer_active = 1;
+}
+
 static void usb_process_ds(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type) {
 
     UNUSED(ds);
     UNUSED(callback_type);
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+    if (!usb_devices_active) return;
+
+    usb_num_wakeups++;
 
     // log_info("begin usb_process_ds");
     // always handling an event as we're called when data is ready
@@ -515,21 +650,14 @@ static void usb_process_ds(btstack_data_source_t *ds, btstack_data_source_callba
     memset(&tv, 0, sizeof(struct timeval));
     libusb_handle_events_timeout(NULL, &tv);
 
-    // Handle any packet in the order that they were received
-    while (handle_packet) {
-        // log_info("handle packet %p, endpoint %x, status %x", handle_packet, handle_packet->endpoint, handle_packet->status);
-        void * next = handle_packet->user_data;
-        handle_completed_transfer(handle_packet);
-        // handle case where libusb_close might be called by hci packet handler        
-        if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
-
-        // Move to next in the list of packets to handle
-        if (next) {
-            handle_packet = (struct libusb_transfer*)next;
-        } else {
-            handle_packet = NULL;
-        }
+    int i;
+    for (i=0;i<HCI_TRANSPORT_USB_MAX_DEVICES;i++){
+        usb_device_t * usb = &usb_devices[i];
+        if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) continue;
+        usb_process_packets(usb);
     }
+
+    usb_update_timeout();
     // log_info("end usb_process_ds");
 }
 
@@ -542,11 +670,17 @@ static void usb_process_ts(btstack_timer_source_t *timer) {
     // timer is deactive, when timer callback gets called
     usb_timer_active = 0;
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return;
+    if (!usb_devices_active) return;
 
-    // actually handled the packet in the pollfds function
+    // handle libusb timeout or poll for completed transfers
     usb_process_ds((struct btstack_data_source *) NULL, DATA_SOURCE_CALLBACK_READ);
 
+    // pollfds: timer for next libusb timeout has been set by usb_process_ds
+    if (doing_pollfds) return;
+
+    // device might have been closed by the hci packet handler
+    if (!usb_devices_active || usb_timer_active) return;
+
     // Get the amount of time until next event is due
     long msec = ASYNC_POLLING_INTERVAL_MS;
 
@@ -558,6 +692,115 @@ static void usb_process_ts(btstack_timer_source_t *timer) {
     return;
 }
 
+static void usb_pollfd_add(int fd, short events){
+    if (num_pollfds >= USB_MAX_POLLFDS){
+        log_error("usb_pollfd_add: no data source for fd %d, increase USB_MAX_POLLFDS", fd);
+        return;
+    }
+    btstack_data_source_t *ds = &pollfd_data_sources[num_pollfds++];
+    btstack_run_loop_set_data_source_fd(ds, fd);
+    btstack_run_loop_set_data_source_handler(ds, &usb_process_ds);
+    // Linux usbfs signals completed transfers as writable
+    if (events & POLLIN){
+        btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
+    }
+    if (events & POLLOUT){
+        btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_WRITE);
+    }
+    btstack_run_loop_add_data_source(ds);
+    log_info("pollfd added: fd %d, events %x", fd, events);
+}
+
+static void usb_pollfd_remove(int fd){
+    int r;
+    for (r = 0 ; r < num_pollfds ; r++) {
+        if (pollfd_data_sources[r].fd != fd) continue;
+        btstack_run_loop_remove_data_source(&pollfd_data_sources[r]);
+        // move last data source into free slot
+        num_pollfds--;
+        if (r < num_pollfds){
+            btstack_run_loop_remove_data_source(&pollfd_data_sources[num_pollfds]);
+            pollfd_data_sources[r] = pollfd_data_sources[num_pollfds];
+            btstack_run_loop_add_data_source(&pollfd_data_sources[r]);
+        }
+        log_info("pollfd removed: fd %d", fd);
+        return;
+    }
+}
+
+LIBUSB_CALL static void usb_pollfd_added_cb(int fd, short events, void * user_data){
+    UNUSED(user_data);
+    usb_pollfd_add(fd, events);
+}
+
+LIBUSB_CALL static void usb_pollfd_removed_cb(int fd, void * user_data){
+    UNUSED(user_data);
+    usb_pollfd_remove(fd);
+}
+
+// start processing libusb events when the first device becomes active
+static void usb_processing_start(void){
+    usb_devices_active++;
+    if (usb_devices_active > 1) return;
+
+    usb_num_wakeups = 0;
+    usb_num_transfers = 0;
+
+    // use pollfds if supported, e.g. not on Windows
+    const struct libusb_pollfd ** pollfd = libusb_get_pollfds(NULL);
+    doing_pollfds = pollfd != NULL;
+
+    if (doing_pollfds) {
+        // timerfd on Linux allows to handle timeouts via pollfds
+        usb_handle_timeouts = !libusb_pollfds_handle_timeouts(NULL);
+        log_info("Async using pollfds, handle timeouts %u:", usb_handle_timeouts);
+
+        num_pollfds = 0;
+        int r;
+        for (r = 0 ; pollfd[r] ; r++) {
+            usb_pollfd_add(pollfd[r]->fd, pollfd[r]->events);
+        }
+        free(pollfd);
+
+        // track file descriptors of devices opened later on
+        libusb_set_pollfd_notifiers(NULL, &usb_pollfd_added_cb, &usb_pollfd_removed_cb, NULL);
+
+        usb_timer.process = usb_process_ts;
+        usb_update_timeout();
+    } else {
+        log_info("Async using timers:");
+
+        usb_timer.process = usb_process_ts;
+        btstack_run_loop_set_timer(&usb_timer, ASYNC_POLLING_INTERVAL_MS);
+        btstack_run_loop_add_timer(&usb_timer);
+        usb_timer_active = 1;
+    }
+}
+
+// stop processing libusb events after the last device was closed
+static void usb_processing_stop(void){
+    usb_devices_active--;
+    if (usb_devices_active > 0) return;
+
+    log_info("libusb processing stopped: %u wakeups, %u completed transfers", usb_num_wakeups, usb_num_transfers);
+
+    if(usb_timer_active) {
+        btstack_run_loop_remove_timer(&usb_timer);
+        usb_timer_active = 0;
+    }
+
+    if (doing_pollfds){
+        libusb_set_pollfd_notifiers(NULL, NULL, NULL, NULL);
+        int r;
+        for (r = 0 ; r < num_pollfds ; r++) {
+            btstack_data_source_t *ds = &pollfd_data_sources[r];
+            btstack_run_loop_remove_data_source(ds);
+        }
+        num_pollfds = 0;
+        doing_pollfds = 0;
+    }
+}
+
 #ifndef HAVE_USB_VENDOR_ID_AND_PRODUCT_ID
 
 // list of known devices, using VendorID/ProductID tuples
@@ -580,18 +823,29 @@ static int is_known_bt_device(uint16_t vendor_id, uint16_t product_id){
     return 0;
 }
 
-static void scan_for_bt_endpoints(void) {
+// check if USB device is already used by another transport instance
+static int is_device_in_use(libusb_device * device){
+    int i;
+    for (i=0;i<HCI_TRANSPORT_USB_MAX_DEVICES;i++){
+        usb_device_t * usb = &usb_devices[i];
+        if (!usb->handle) continue;
+        if (libusb_get_device(usb->handle) == device) return 1;
+    }
+    return 0;
+}
+
+static void scan_for_bt_endpoints(usb_device_t * usb) {
     int r;
 
-    event_in_addr = 0;
-    acl_in_addr = 0;
-    acl_out_addr = 0;
-    sco_out_addr = 0;
-    sco_in_addr = 0;
+    usb->event_in_addr = 0;
+    usb->acl_in_addr = 0;
+    usb->acl_out_addr = 0;
+    usb->sco_out_addr = 0;
+    usb->sco_in_addr = 0;
 
     // get endpoints from interface descriptor
     struct libusb_config_descriptor *config_descriptor;
-    r = libusb_get_active_config_descriptor(dev, &config_descriptor);
+    r = libusb_get_active_config_descriptor(usb->dev, &config_descriptor);
 
     int num_interfaces = config_descriptor->bNumInterfaces;
     log_info("active configuration has %u interfaces", num_interfaces);
@@ -609,30 +863,30 @@ static void scan_for_bt_endpoints(void) {
 
             switch (endpoint->bmAttributes & 0x3){
                 case LIBUSB_TRANSFER_TYPE_INTERRUPT:
-                    if (event_in_addr) continue;
-                    event_in_addr = endpoint->bEndpointAddress;
-                    log_info("-> using 0x%2.2X for HCI Events", event_in_addr);
+                    if (usb->event_in_addr) continue;
+                    usb->event_in_addr = endpoint->bEndpointAddress;
+                    log_info("-> using 0x%2.2X for HCI Events", usb->event_in_addr);
                     break;
                 case LIBUSB_TRANSFER_TYPE_BULK:
                     if (endpoint->bEndpointAddress & 0x80) {
-                        if (acl_in_addr) continue;
-                        acl_in_addr = endpoint->bEndpointAddress;
-                        log_info("-> using 0x%2.2X for ACL Data In", acl_in_addr);
+                        if (usb->acl_in_addr) continue;
+                        usb->acl_in_addr = endpoint->bEndpointAddress;
+                        log_info("-> using 0x%2.2X for ACL Data In", usb->acl_in_addr);
                     } else {
-                        if (acl_out_addr) continue;
-                        acl_out_addr = endpoint->bEndpointAddress;
-                        log_info("-> using 0x%2.2X for ACL Data Out", acl_out_addr);
+                        if (usb->acl_out_addr) continue;
+                        usb->acl_out_addr = endpoint->bEndpointAddress;
+                        log_info("-> using 0x%2.2X for ACL Data Out", usb->acl_out_addr);
                     }
                     break;
                 case LIBUSB_TRANSFER_TYPE_ISOCHRONOUS:
                     if (endpoint->bEndpointAddress & 0x80) {
-                        if (sco_in_addr) continue;
-                        sco_in_addr = endpoint->bEndpointAddress;
-                        log_info("-> using 0x%2.2X for SCO Data In", sco_in_addr);
+                        if (usb->sco_in_addr) continue;
+                        usb->sco_in_addr = endpoint->bEndpointAddress;
+                        log_info("-> using 0x%2.2X for SCO Data In", usb->sco_in_addr);
                     } else {
-                        if (sco_out_addr) continue;
-                        sco_out_addr = endpoint->bEndpointAddress;
-                        log_info("-> using 0x%2.2X for SCO Data Out", sco_out_addr);
+                        if (usb->sco_out_addr) continue;
+                        usb->sco_out_addr = endpoint->bEndpointAddress;
+                        log_info("-> using 0x%2.2X for SCO Data Out", usb->sco_out_addr);
                     }
                     break;
                 default:
@@ -644,39 +898,41 @@ static void scan_for_bt_endpoints(void) {
 }
 
 // returns index of found device or -1
-static int scan_for_bt_device(libusb_device **devs, int start_index) {
+static int scan_for_bt_device(usb_device_t * usb, libusb_device **devs, int start_index) {
     int i;
     for (i = start_index; devs[i] ; i++){
-        dev = devs[i];
-        int r = libusb_get_device_descriptor(dev, &desc);
+        usb->dev = devs[i];
+        int r = libusb_get_device_descriptor(usb->dev, &usb->desc);
         if (r < 0) {
             log_error("failed to get device descriptor");
             return 0;
         }
         
         log_info("%04x:%04x (bus %d, device %d) - class %x subclass %x protocol %x ",
-               desc.idVendor, desc.idProduct,
-               libusb_get_bus_number(dev), libusb_get_device_address(dev),
-               desc.bDeviceClass, desc.bDeviceSubClass, desc.bDeviceProtocol);
+               usb->desc.idVendor, usb->desc.idProduct,
+               libusb_get_bus_number(usb->dev), libusb_get_device_address(usb->dev),
+               usb->desc.bDeviceClass, usb->desc.bDeviceSubClass, usb->desc.bDeviceProtocol);
+
+        // skip devices opened by other transport instances
+        if (is_device_in_use(usb->dev)) continue;
         
         // Detect USB Dongle based Class, Subclass, and Protocol
         // The class code (bDeviceClass) is 0xE0 – Wireless Controller. 
         // The SubClass code (bDeviceSubClass) is 0x01 – RF Controller. 
         // The Protocol code (bDeviceProtocol) is 0x01 – Bluetooth programming.
         // if (desc.bDeviceClass == 0xe0 && desc.bDeviceSubClass == 0x01 && desc.bDeviceProtocol == 0x01){
-        if (desc.bDeviceClass == 0xE0 && desc.bDeviceSubClass == 0x01 && desc.bDeviceProtocol == 0x01) {
+        if (usb->desc.bDeviceClass == 0xE0 && usb->desc.bDeviceSubClass == 0x01 && usb->desc.bDeviceProtocol == 0x01) {
             return i;
         }
 
         // Detect USB Dongle based on whitelist
-        if (is_known_bt_device(desc.idVendor, desc.idProduct)) {
+        if (is_known_bt_device(usb->desc.idVendor, usb->desc.idProduct)) {
             return i;
         }
     }
     return -1;
 }
 #endif
-
 static int prepare_device(libusb_device_handle * aHandle){
 
     // print device path
@@ -781,27 +1037,34 @@ static libusb_device_handle * try_open_device(libusb_device * device){
 
 #ifdef ENABLE_SCO_OVER_HCI
 
-static int usb_sco_start(void){
+static int usb_sco_start(usb_device_t * usb){
 
     printf("usb_sco_start\n");
     log_info("usb_sco_start");
 
-    sco_state_machine_init();
-    sco_ring_init();
+    sco_state_machine_init(usb);
+    sco_ring_init(usb);
 
     int alt_setting;
-    if (sco_voice_setting & 0x0020){
+    if (usb->sco_voice_setting & 0x0020){
         // 16-bit PCM  
-        alt_setting = alt_setting_16_bit[sco_num_connections-1];
+        alt_setting = alt_setting_16_bit[usb->sco_num_connections-1];
     } else {
         // 8-bit PCM or mSBC
-        alt_setting = alt_setting_8_bit[sco_num_connections-1];
+        alt_setting = alt_setting_8_bit[usb->sco_num_connections-1];
     }
     // derive iso packet size from alt setting
-    iso_packet_size = iso_packet_size_for_alt_setting[alt_setting];
+    usb->iso_packet_size = iso_packet_size_for_alt_setting[alt_setting];
+
+    // receive one mSBC packet per transfer
+    if ((usb->sco_voice_setting & 0x0003) == 0x0003 && (NUM_ISO_PACKETS_MSBC * usb->iso_packet_size) <= SCO_PACKET_SIZE){
+        usb->num_iso_packets = NUM_ISO_PACKETS_MSBC;
+    } else {
+        usb->num_iso_packets = NUM_ISO_PACKETS;
+    }
 
     log_info("Switching to setting %u on interface 1..", alt_setting);
-    int r = libusb_set_interface_alt_setting(handle, 1, alt_setting); 
+    int r = libusb_set_interface_alt_setting(usb->handle, 1, alt_setting); 
     if (r < 0) {
         log_error("Error setting alternative setting %u for interface 1: %s\n", alt_setting, libusb_error_name(r));
         return r;
@@ -810,51 +1073,51 @@ static int usb_sco_start(void){
     // incoming
     int c;
     for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
-        sco_in_transfer[c] = libusb_alloc_transfer(NUM_ISO_PACKETS); // isochronous transfers SCO in
-        if (!sco_in_transfer[c]) {
-            usb_close();
+        usb->sco_in_transfer[c] = libusb_alloc_transfer(usb->num_iso_packets); // isochronous transfers SCO in
+        if (!usb->sco_in_transfer[c]) {
+            usb_close(usb);
             return LIBUSB_ERROR_NO_MEM;
         }
         // configure sco_in handlers
-        libusb_fill_iso_transfer(sco_in_transfer[c], handle, sco_in_addr, 
-            hci_sco_in_buffer[c], NUM_ISO_PACKETS * iso_packet_size, NUM_ISO_PACKETS, async_callback, NULL, 0);
-        libusb_set_iso_packet_lengths(sco_in_transfer[c], iso_packet_size);
-        r = libusb_submit_transfer(sco_in_transfer[c]);
+        libusb_fill_iso_transfer(usb->sco_in_transfer[c], usb->handle, usb->sco_in_addr, 
+            usb->hci_sco_in_buffer[c], usb->num_iso_packets * usb->iso_packet_size, usb->num_iso_packets, async_callback, NULL, 0);
+        libusb_set_iso_packet_lengths(usb->sco_in_transfer[c], usb->iso_packet_size);
+        r = libusb_submit_transfer(usb->sco_in_transfer[c]);
         if (r) {
             log_error("Error submitting isochronous in transfer %d", r);
-            usb_close();
+            usb_close(usb);
             return r;
         }
     }
 
     // outgoing
     for (c=0; c < SCO_OUT_BUFFER_COUNT ; c++){
-        sco_out_transfers[c] = libusb_alloc_transfer(NUM_ISO_PACKETS); // 1 isochronous transfers SCO out - up to 3 parts
-        sco_out_transfers_in_flight[c] = 0;
+        usb->sco_out_transfers[c] = libusb_alloc_transfer(MAX_NUM_ISO_PACKETS); // 1 isochronous transfers SCO out - up to 8 parts
+        usb->sco_out_transfers_in_flight[c] = 0;
     }
     return 0;
 }
 
-static void usb_sco_stop(void){
+static void usb_sco_stop(usb_device_t * usb){
 
     printf("usb_sco_stop\n");
 
     log_info("usb_sco_stop");
-    sco_shutdown = 1;
+    usb->sco_shutdown = 1;
 
     libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_ERROR);
 
     int c;
     for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
-        libusb_cancel_transfer(sco_in_transfer[c]);
+        libusb_cancel_transfer(usb->sco_in_transfer[c]);
     }
 
     for (c = 0; c < SCO_OUT_BUFFER_COUNT ; c++){
-        if (sco_out_transfers_in_flight[c]) {
-            libusb_cancel_transfer(sco_out_transfers[c]);
+        if (usb->sco_out_transfers_in_flight[c]) {
+            libusb_cancel_transfer(usb->sco_out_transfers[c]);
         } else {
-            libusb_free_transfer(sco_out_transfers[c]);
-            sco_out_transfers[c] = 0;
+            libusb_free_transfer(usb->sco_out_transfers[c]);
+            usb->sco_out_transfers[c] = 0;
         }
     }
 
@@ -869,7 +1132,7 @@ static void usb_sco_stop(void){
 
         // Cancel all synchronous transfer
         for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
-            if (sco_in_transfer[c]){
+            if (usb->sco_in_transfer[c]){
                 completed = 0;
                 break;
             }
@@ -878,17 +1141,17 @@ static void usb_sco_stop(void){
         if (!completed) continue;
 
         for (c=0; c < SCO_OUT_BUFFER_COUNT ; c++){
-            if (sco_out_transfers[c]){
+            if (usb->sco_out_transfers[c]){
                 completed = 0;
                 break;
             }
         }
     }
-    sco_shutdown = 0;
+    usb->sco_shutdown = 0;
     libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_WARNING);
 
     log_info("Switching to setting %u on interface 1..", 0);
-    int r = libusb_set_interface_alt_setting(handle, 1, 0); 
+    int r = libusb_set_interface_alt_setting(usb->handle, 1, 0); 
     if (r < 0) {
         log_error("Error setting alternative setting %u for interface 1: %s", 0, libusb_error_name(r));
         return;
@@ -901,23 +1164,23 @@ static void usb_sco_stop(void){
 
 #endif
 
-static int usb_open(void){
+static int usb_open(usb_device_t * usb){
     int r;
 
-    handle_packet = NULL;
+    usb->handle_packet = NULL;
 
     // default endpoint addresses
-    event_in_addr = 0x81; // EP1, IN interrupt
-    acl_in_addr =   0x82; // EP2, IN bulk
-    acl_out_addr =  0x02; // EP2, OUT bulk
-    sco_in_addr  =  0x83; // EP3, IN isochronous
-    sco_out_addr =  0x03; // EP3, OUT isochronous    
+    usb->event_in_addr = 0x81; // EP1, IN interrupt
+    usb->acl_in_addr =   0x82; // EP2, IN bulk
+    usb->acl_out_addr =  0x02; // EP2, OUT bulk
+    usb->sco_in_addr  =  0x83; // EP3, IN isochronous
+    usb->sco_out_addr =  0x03; // EP3, OUT isochronous    
 
-    // USB init
+    // USB init, default context is reference counted by libusb
     r = libusb_init(NULL);
     if (r < 0) return -1;
 
-    libusb_state = LIB_USB_OPENED;
+    usb->libusb_state = LIB_USB_OPENED;
 
     // configure debug level
     libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_WARNING);
@@ -926,18 +1189,18 @@ static int usb_open(void){
 
     // Use a specified device
     log_info("Want vend: %04x, prod: %04x", USB_VENDOR_ID, USB_PRODUCT_ID);
-    handle = libusb_open_device_with_vid_pid(NULL, USB_VENDOR_ID, USB_PRODUCT_ID);
+    usb->handle = libusb_open_device_with_vid_pid(NULL, USB_VENDOR_ID, USB_PRODUCT_ID);
 
-    if (!handle){
+    if (!usb->handle){
         log_error("libusb_open_device_with_vid_pid failed!");
-        usb_close();
+        usb_close(usb);
         return -1;
     }
-    log_info("libusb open %d, handle %p", r, handle);
+    log_info("libusb open %d, handle %p", r, usb->handle);
 
-    r = prepare_device(handle);
+    r = prepare_device(usb->handle);
     if (r < 0){
-        usb_close();
+        usb_close(usb);
         return -1;
     }
 
@@ -949,34 +1212,39 @@ static int usb_open(void){
     log_info("Scanning for USB Bluetooth device");
     num_devices = libusb_get_device_list(NULL, &devs);
     if (num_devices < 0) {
-        usb_close();
+        usb_close(usb);
         return -1;
     }
 
-    dev = NULL;
+    usb->dev = NULL;
 
-    if (usb_path_len){
+    if (usb->usb_path_len){
         int i;
         for (i=0;i<num_devices;i++){
             uint8_t port_numbers[USB_MAX_PATH_LEN];
             int len = libusb_get_port_numbers(devs[i], port_numbers, USB_MAX_PATH_LEN);
-            if (len != usb_path_len) continue;
-            if (memcmp(usb_path, port_numbers, len) == 0){
+            if (len != usb->usb_path_len) continue;
+            if (memcmp(usb->usb_path, port_numbers, len) == 0){
                 log_info("USB device found at specified path");
-                handle = try_open_device(devs[i]);
-                if (!handle) continue;
+                usb->handle = try_open_device(devs[i]);
+                if (!usb->handle) continue;
 
-                r = prepare_device(handle);
-                if (r < 0) continue;
+                r = prepare_device(usb->handle);
+                if (r < 0) {
+                    usb->handle = NULL;
+                    continue;
+                }
 
-                dev = devs[i];
-                libusb_state = LIB_USB_INTERFACE_CLAIMED;
+                usb->dev = devs[i];
+                usb->libusb_state = LIB_USB_INTERFACE_CLAIMED;
                 break;
             };
         }
-        if (!handle){
+        if (!usb->handle){
             log_error("USB device with given path not found");
             printf("USB device with given path not found\n");
+            libusb_free_device_list(devs, 1);
+            usb_close(usb);
             return -1;
         }
     } else {
@@ -984,168 +1252,125 @@ static int usb_open(void){
         int deviceIndex = -1;
         while (1){
             // look for next Bluetooth dongle
-            deviceIndex = scan_for_bt_device(devs, deviceIndex+1);
+            deviceIndex = scan_for_bt_device(usb, devs, deviceIndex+1);
             if (deviceIndex < 0) break;
 
             log_info("USB Bluetooth device found, index %u", deviceIndex);
 
-            handle = try_open_device(devs[deviceIndex]);
-            if (!handle) continue;
+            usb->handle = try_open_device(devs[deviceIndex]);
+            if (!usb->handle) continue;
 
-            r = prepare_device(handle);
-            if (r < 0) continue;
+            r = prepare_device(usb->handle);
+            if (r < 0) {
+                usb->handle = NULL;
+                continue;
+            }
 
-            dev = devs[deviceIndex];
-            libusb_state = LIB_USB_INTERFACE_CLAIMED;
+            usb->dev = devs[deviceIndex];
+            usb->libusb_state = LIB_USB_INTERFACE_CLAIMED;
             break;
         }
     }
 
     libusb_free_device_list(devs, 1);
 
-    if (handle == 0){
+    if (usb->handle == 0){
         log_error("No USB Bluetooth device found");
+        usb_close(usb);
         return -1;
     }
 
-    scan_for_bt_endpoints();
+    scan_for_bt_endpoints(usb);
 
 #endif
     
     // allocate transfer handlers
     int c;
     for (c = 0 ; c < EVENT_IN_BUFFER_COUNT ; c++) {
-        event_in_transfer[c] = libusb_alloc_transfer(0); // 0 isochronous transfers Events
-        if (!event_in_transfer[c]) {
-            usb_close();
+        usb->event_in_transfer[c] = libusb_alloc_transfer(0); // 0 isochronous transfers Events
+        if (!usb->event_in_transfer[c]) {
+            usb_close(usb);
             return LIBUSB_ERROR_NO_MEM;
         }
     }
     for (c = 0 ; c < ACL_IN_BUFFER_COUNT ; c++) {
-        acl_in_transfer[c]  =  libusb_alloc_transfer(0); // 0 isochronous transfers ACL in
-        if (!acl_in_transfer[c]) {
-            usb_close();
+        usb->acl_in_transfer[c]  =  libusb_alloc_transfer(0); // 0 isochronous transfers ACL in
+        if (!usb->acl_in_transfer[c]) {
+            usb_close(usb);
             return LIBUSB_ERROR_NO_MEM;
         }
     }
 
-    command_out_transfer = libusb_alloc_transfer(0);
-    acl_out_transfer     = libusb_alloc_transfer(0);
+    usb->command_out_transfer = libusb_alloc_transfer(0);
+    usb->acl_out_transfer     = libusb_alloc_transfer(0);
 
     // TODO check for error
 
-    libusb_state = LIB_USB_TRANSFERS_ALLOCATED;
+    usb->libusb_state = LIB_USB_TRANSFERS_ALLOCATED;
 
     for (c = 0 ; c < EVENT_IN_BUFFER_COUNT ; c++) {
         // configure event_in handlers
-        libusb_fill_interrupt_transfer(event_in_transfer[c], handle, event_in_addr, 
-                hci_event_in_buffer[c], HCI_ACL_BUFFER_SIZE, async_callback, NULL, 0) ;
-        r = libusb_submit_transfer(event_in_transfer[c]);
+        libusb_fill_interrupt_transfer(usb->event_in_transfer[c], usb->handle, usb->event_in_addr, 
+                usb->hci_event_in_buffer[c], HCI_ACL_BUFFER_SIZE, async_callback, NULL, 0) ;
+        r = libusb_submit_transfer(usb->event_in_transfer[c]);
         if (r) {
             log_error("Error submitting interrupt transfer %d", r);
-            usb_close();
+            usb_close(usb);
             return r;
         }
     }
 
     for (c = 0 ; c < ACL_IN_BUFFER_COUNT ; c++) {
         // configure acl_in handlers
-        libusb_fill_bulk_transfer(acl_in_transfer[c], handle, acl_in_addr, 
-                hci_acl_in_buffer[c] + HCI_INCOMING_PRE_BUFFER_SIZE, HCI_ACL_BUFFER_SIZE, async_callback, NULL, 0) ;
-        r = libusb_submit_transfer(acl_in_transfer[c]);
+        libusb_fill_bulk_transfer(usb->acl_in_transfer[c], usb->handle, usb->acl_in_addr, 
+                usb->hci_acl_in_buffer[c] + HCI_INCOMING_PRE_BUFFER_SIZE, HCI_ACL_BUFFER_SIZE, async_callback, NULL, 0) ;
+        r = libusb_submit_transfer(usb->acl_in_transfer[c]);
         if (r) {
             log_error("Error submitting bulk in transfer %d", r);
-            usb_close();
+            usb_close(usb);
             return r;
         }
  
      }
 
-    // Check for pollfds functionality
-    doing_pollfds = libusb_pollfds_handle_timeouts(NULL);
-    
-    // NOTE: using pollfds doesn't work on Linux, so it is disable until further investigation here
-    doing_pollfds = 0;
-
-    if (doing_pollfds) {
-        log_info("Async using pollfds:");
-
-        const struct libusb_pollfd ** pollfd = libusb_get_pollfds(NULL);
-        for (num_pollfds = 0 ; pollfd[num_pollfds] ; num_pollfds++);
-        pollfd_data_sources = (btstack_data_source_t *)malloc(sizeof(btstack_data_source_t) * num_pollfds);
-        if (!pollfd_data_sources){
-            log_error("Cannot allocate data sources for pollfds");
-            usb_close();
-            return 1;            
-        }
-        for (r = 0 ; r < num_pollfds ; r++) {
-            btstack_data_source_t *ds = &pollfd_data_sources[r];
-            btstack_run_loop_set_data_source_fd(ds, pollfd[r]->fd);
-            btstack_run_loop_set_data_source_handler(ds, &usb_process_ds);
-            btstack_run_loop_enable_data_source_callbacks(ds, DATA_SOURCE_CALLBACK_READ);
-            btstack_run_loop_add_data_source(ds);
-            log_info("%u: %p fd: %u, events %x", r, pollfd[r], pollfd[r]->fd, pollfd[r]->events);
-        }
-        free(pollfd);
-    } else {
-        log_info("Async using timers:");
-
-        usb_timer.process = usb_process_ts;
-        btstack_run_loop_set_timer(&usb_timer, ASYNC_POLLING_INTERVAL_MS);
-        btstack_run_loop_add_timer(&usb_timer);
-        usb_timer_active = 1;
-    }
+    // start event processing, shared by all devices
+    usb_processing_start();
 
     return 0;
 }
 
-static int usb_close(void){
+static int usb_close(usb_device_t * usb){
     int c;
     int completed = 0;
 
-    switch (libusb_state){
+    switch (usb->libusb_state){
         case LIB_USB_CLOSED:
             break;
 
         case LIB_USB_TRANSFERS_ALLOCATED:
-            libusb_state = LIB_USB_INTERFACE_CLAIMED;
+            usb->libusb_state = LIB_USB_INTERFACE_CLAIMED;
 
-            if(usb_timer_active) {
-                btstack_run_loop_remove_timer(&usb_timer);
-                usb_timer_active = 0;
-            }
-
-            if (doing_pollfds){
-                int r;
-                for (r = 0 ; r < num_pollfds ; r++) {
-                    btstack_data_source_t *ds = &pollfd_data_sources[r];
-                    btstack_run_loop_remove_data_source(ds);
-                }
-                free(pollfd_data_sources);
-                pollfd_data_sources = NULL;
-                num_pollfds = 0;
-                doing_pollfds = 0;
-            }
+            usb_processing_stop();
 
         case LIB_USB_INTERFACE_CLAIMED:
             // Cancel all transfers, ignore warnings for this
             libusb_set_debug(NULL, LIBUSB_LOG_LEVEL_ERROR);
             for (c = 0 ; c < EVENT_IN_BUFFER_COUNT ; c++) {
-                libusb_cancel_transfer(event_in_transfer[c]);
+                libusb_cancel_transfer(usb->event_in_transfer[c]);
             }
             for (c = 0 ; c < ACL_IN_BUFFER_COUNT ; c++) {
-                libusb_cancel_transfer(acl_in_transfer[c]);
+                libusb_cancel_transfer(usb->acl_in_transfer[c]);
             }
 #ifdef ENABLE_SCO_OVER_HCI
             for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
-                libusb_cancel_transfer(sco_in_transfer[c]);
+                libusb_cancel_transfer(usb->sco_in_transfer[c]);
             }
             for (c = 0; c < SCO_OUT_BUFFER_COUNT ; c++){
-                if (sco_out_transfers_in_flight[c]) {
-                    libusb_cancel_transfer(sco_out_transfers[c]);
+                if (usb->sco_out_transfers_in_flight[c]) {
+                    libusb_cancel_transfer(usb->sco_out_transfers[c]);
                 } else {
-                    libusb_free_transfer(sco_out_transfers[c]);
-                    sco_out_transfers[c] = 0;
+                    libusb_free_transfer(usb->sco_out_transfers[c]);
+                    usb->sco_out_transfers[c] = 0;
                 }
             }
 #endif
@@ -1159,7 +1384,7 @@ static int usb_close(void){
                 // check if all done
                 completed = 1;
                 for (c=0;c<EVENT_IN_BUFFER_COUNT;c++){
-                    if (event_in_transfer[c]) {
+                    if (usb->event_in_transfer[c]) {
                         completed = 0;
                         break;
                     }
@@ -1168,7 +1393,7 @@ static int usb_close(void){
                 if (!completed) continue;
 
                 for (c=0;c<ACL_IN_BUFFER_COUNT;c++){
-                    if (acl_in_transfer[c]) {
+                    if (usb->acl_in_transfer[c]) {
                         completed = 0;
                         break;
                     }
@@ -1179,7 +1404,7 @@ static int usb_close(void){
 
                 // Cancel all synchronous transfer
                 for (c = 0 ; c < SCO_IN_BUFFER_COUNT ; c++) {
-                    if (sco_in_transfer[c]){
+                    if (usb->sco_in_transfer[c]){
                         completed = 0;
                         break;
                     }
@@ -1188,7 +1413,7 @@ static int usb_close(void){
                 if (!completed) continue;
 
                 for (c=0; c < SCO_OUT_BUFFER_COUNT ; c++){
-                    if (sco_out_transfers[c]){
+                    if (usb->sco_out_transfers[c]){
                         completed = 0;
                         break;
                     }
@@ -1197,47 +1422,48 @@ static int usb_close(void){
             }
 
             // finally release interface
-            libusb_release_interface(handle, 0);
+            libusb_release_interface(usb->handle, 0);
 #ifdef ENABLE_SCO_OVER_HCI
-            libusb_release_interface(handle, 1);
+            libusb_release_interface(usb->handle, 1);
 #endif
             log_info("Libusb shutdown complete");
 
         case LIB_USB_DEVICE_OPENDED:
-            libusb_close(handle);
+            if (usb->handle){
+                libusb_close(usb->handle);
+            }
 
         case LIB_USB_OPENED:
             libusb_exit(NULL);
     }
 
-    libusb_state = LIB_USB_CLOSED;
-    handle = NULL;
+    usb->libusb_state = LIB_USB_CLOSED;
+    usb->handle = NULL;
 
     return 0;
 }
 
-static int usb_send_cmd_packet(uint8_t *packet, int size){
+static int usb_send_cmd_packet(usb_device_t * usb, uint8_t *packet, int size){
     int r;
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
 
     // async
-    libusb_fill_control_setup(hci_cmd_buffer, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE, 0, 0, 0, size);
-    memcpy(hci_cmd_buffer + LIBUSB_CONTROL_SETUP_SIZE, packet, size);
+    libusb_fill_control_setup(usb->hci_cmd_buffer, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE, 0, 0, 0, size);
+    memcpy(usb->hci_cmd_buffer + LIBUSB_CONTROL_SETUP_SIZE, packet, size);
 
     // prepare transfer
     int completed = 0;
-    libusb_fill_control_transfer(command_out_transfer, handle, hci_cmd_buffer, async_callback, &completed, 0);
-    command_out_transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+    libusb_fill_control_transfer(usb->command_out_transfer, usb->handle, usb->hci_cmd_buffer, async_callback, &completed, 0);
 
     // update stata before submitting transfer
-    usb_command_active = 1;
+    usb->usb_command_active = 1;
 
     // submit transfer
-    r = libusb_submit_transfer(command_out_transfer);
+    r = libusb_submit_transfer(usb->command_out_transfer);
     
     if (r < 0) {
-        usb_command_active = 0;
+        usb->usb_command_active = 0;
         log_error("Error submitting cmd transfer %d", r);
         return -1;
     }
@@ -1245,25 +1471,25 @@ static int usb_send_cmd_packet(uint8_t *packet, int size){
     return 0;
 }
 
-static int usb_send_acl_packet(uint8_t *packet, int size){
+static int usb_send_acl_packet(usb_device_t * usb, uint8_t *packet, int size){
     int r;
 
-    if (libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
+    if (usb->libusb_state != LIB_USB_TRANSFERS_ALLOCATED) return -1;
 
     // log_info("usb_send_acl_packet enter, size %u", size);
     
     // prepare transfer
     int completed = 0;
-    libusb_fill_bulk_transfer(acl_out_transfer, handle, acl_out_addr, packet, size,
+    libusb_fill_bulk_transfer(usb->acl_out_transfer, usb->handle, usb->acl_out_addr, packet, size,
         async_callback, &completed, 0);
-    acl_out_transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
+    usb->acl_out_transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
 
     // update stata before submitting transfer
-    usb_acl_out_active = 1;
+    usb->usb_acl_out_active = 1;
 
-    r = libusb_submit_transfer(acl_out_transfer);
+    r = libusb_submit_transfer(usb->acl_out_transfer);
     if (r < 0) {
-        usb_acl_out_active = 0;
+        usb->usb_acl_out_active = 0;
         log_error("Error submitting acl transfer, %d", r);
         return -1;
     }
@@ -1271,30 +1497,30 @@ static int usb_send_acl_packet(uint8_t *packet, int size){
     return 0;
 }
 
-static int usb_can_send_packet_now(uint8_t packet_type){
+static int usb_can_send_packet_now(usb_device_t * usb, uint8_t packet_type){
     switch (packet_type){
         case HCI_COMMAND_DATA_PACKET:
-            return !usb_command_active;
+            return !usb->usb_command_active;
         case HCI_ACL_DATA_PACKET:
-            return !usb_acl_out_active;
+            return !usb->usb_acl_out_active;
 #ifdef ENABLE_SCO_OVER_HCI
         case HCI_SCO_DATA_PACKET:
-            return sco_ring_have_space();
+            return sco_ring_have_space(usb);
 #endif
         default:
             return 0;
     }
 }
 
-static int usb_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+static int usb_send_packet(usb_device_t * usb, uint8_t packet_type, uint8_t * packet, int size){
     switch (packet_type){
         case HCI_COMMAND_DATA_PACKET:
-            return usb_send_cmd_packet(packet, size);
+            return usb_send_cmd_packet(usb, packet, size);
         case HCI_ACL_DATA_PACKET:
-            return usb_send_acl_packet(packet, size);
+            return usb_send_acl_packet(usb, packet, size);
 #ifdef ENABLE_SCO_OVER_HCI
         case HCI_SCO_DATA_PACKET:
-            return usb_send_sco_packet(packet, size);
+            return usb_send_sco_packet(usb, packet, size);
 #endif
         default:
             return -1;
@@ -1302,25 +1528,25 @@ static int usb_send_packet(uint8_t packet_type, uint8_t * packet, int size){
 }
 
 #ifdef ENABLE_SCO_OVER_HCI
-static void usb_set_sco_config(uint16_t voice_setting, int num_connections){
+static void usb_set_sco_config(usb_device_t * usb, uint16_t voice_setting, int num_connections){
     log_info("usb_set_sco_config: voice settings 0x%04x, num connections %u", voice_setting, num_connections);
 
-    if (num_connections != sco_num_connections){
-        sco_voice_setting = voice_setting;
-        if (sco_num_connections){
-            usb_sco_stop();
+    if (num_connections != usb->sco_num_connections){
+        usb->sco_voice_setting = voice_setting;
+        if (usb->sco_num_connections){
+            usb_sco_stop(usb);
         }
-        sco_num_connections = num_connections;
+        usb->sco_num_connections = num_connections;
         if (num_connections){
-            usb_sco_start();
+            usb_sco_start(usb);
         }
     }
 }
 #endif
 
-static void usb_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+static void usb_register_packet_handler(usb_device_t * usb, void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
     log_info("registering packet handler");
-    packet_handler = handler;
+    usb->packet_handler = handler;
 }
 
 static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
@@ -1329,20 +1555,77 @@ static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
     UNUSED(size);
 }
 
-// get usb singleton
-const hci_transport_t * hci_transport_usb_instance(void) {
-    if (!hci_transport_usb) {
-        hci_transport_usb = (hci_transport_t*) malloc( sizeof(hci_transport_t));
-        memset(hci_transport_usb, 0, sizeof(hci_transport_t));
-        hci_transport_usb->name                          = "H2_LIBUSB";
-        hci_transport_usb->open                          = usb_open;
-        hci_transport_usb->close                         = usb_close;
-        hci_transport_usb->register_packet_handler       = usb_register_packet_handler;
-        hci_transport_usb->can_send_packet_now           = usb_can_send_packet_now;
-        hci_transport_usb->send_packet                   = usb_send_packet;
+// hci_transport_t doesn't provide a context, so each device gets its own set of functions
+#ifdef ENABLE_SCO_OVER_HCI
+#define USB_DEVICE_SET_SCO_CONFIG(index) \
+static void usb_set_sco_config_##index(uint16_t voice_setting, int num_connections){ \
+    usb_set_sco_config(&usb_devices[index], voice_setting, num_connections); \
+}
+#else
+#define USB_DEVICE_SET_SCO_CONFIG(index)
+#endif
+
+#define USB_DEVICE_FUNCTIONS(index) \
+static int usb_open_##index(void){ \
+    return usb_open(&usb_devices[index]); \
+} \
+static int usb_close_##index(void){ \
+    return usb_close(&usb_devices[index]); \
+} \
+static void usb_register_packet_handler_##index(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){ \
+    usb_register_packet_handler(&usb_devices[index], handler); \
+} \
+static int usb_can_send_packet_now_##index(uint8_t packet_type){ \
+    return usb_can_send_packet_now(&usb_devices[index], packet_type); \
+} \
+static int usb_send_packet_##index(uint8_t packet_type, uint8_t * packet, int size){ \
+    return usb_send_packet(&usb_devices[index], packet_type, packet, size); \
+} \
+USB_DEVICE_SET_SCO_CONFIG(index)
+
+USB_DEVICE_FUNCTIONS(0)
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 1
+USB_DEVICE_FUNCTIONS(1)
+#endif
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 2
+USB_DEVICE_FUNCTIONS(2)
+#endif
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 3
+USB_DEVICE_FUNCTIONS(3)
+#endif
+
 #ifdef ENABLE_SCO_OVER_HCI
-        hci_transport_usb->set_sco_config                = usb_set_sco_config;
+#define USB_DEVICE_TRANSPORT(index) { "H2_LIBUSB", NULL, usb_open_##index, usb_close_##index, usb_register_packet_handler_##index, \
+    usb_can_send_packet_now_##index, usb_send_packet_##index, NULL, NULL, usb_set_sco_config_##index }
+#else
+#define USB_DEVICE_TRANSPORT(index) { "H2_LIBUSB", NULL, usb_open_##index, usb_close_##index, usb_register_packet_handler_##index, \
+    usb_can_send_packet_now_##index, usb_send_packet_##index, NULL, NULL, NULL }
+#endif
+
+static const hci_transport_t usb_device_transports[HCI_TRANSPORT_USB_MAX_DEVICES] = {
+    USB_DEVICE_TRANSPORT(0),
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 1
+    USB_DEVICE_TRANSPORT(1),
+#endif
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 2
+    USB_DEVICE_TRANSPORT(2),
+#endif
+#if HCI_TRANSPORT_USB_MAX_DEVICES > 3
+    USB_DEVICE_TRANSPORT(3),
 #endif
+};
+
+// get usb instance for device index
+const hci_transport_t * hci_transport_usb_instance_for_device(int device_index) {
+    usb_device_t * usb = usb_device_for_index(device_index);
+    if (!usb) return NULL;
+    if (!usb->packet_handler) {
+        usb->packet_handler = dummy_handler;
     }
-    return hci_transport_usb;
+    return &usb_device_transports[device_index];
+}
+
+// get usb singleton
+const hci_transport_t * hci_transport_usb_instance(void) {
+    return hci_transport_usb_instance_for_device(0);
 }
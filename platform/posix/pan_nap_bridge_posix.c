@@ -0,0 +1,582 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "pan_nap_bridge_posix.c"
+
+/*
+ *  pan_nap_bridge_posix.c
+ *
+ *  Bridge BNEP channels of a PAN NAP service to a TAP network interface
+ *
+ *  Frames from the TAP interface are read directly into the outgoing L2CAP buffer and
+ *  sent as BNEP General Ethernet packets. Received BNEP frames are re-assembled in place
+ *  by BNEP and written to the TAP interface without extra copy.
+ *
+ *  Frames to unknown unicast addresses, broadcast and multicast frames are copied and sent
+ *  to all BNEP channels. Reading from the TAP interface is paused while any channel cannot send.
+ *
+ *  Frames received on a BNEP channel for a PANU connected via another channel are forwarded
+ *  to that channel. Broadcast, multicast and unknown unicast frames are written to the TAP
+ *  interface and forwarded to all other channels. Forwarded frames share the copy buffer with
+ *  the TAP flood frame and are dropped while it is in use.
+ */
+
+#include "btstack_config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#ifdef __APPLE__
+#include <net/if.h>
+#include <net/if_types.h>
+#include <netinet/if_ether.h>
+#endif
+
+#ifdef __linux
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#endif
+
+#include "pan_nap_bridge_posix.h"
+
+#include "bluetooth_sdp.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "classic/bnep.h"
+#include "gap.h"
+#include "hci.h"
+
+#ifndef PAN_NAP_BRIDGE_MAX_CHANNELS
+#define PAN_NAP_BRIDGE_MAX_CHANNELS 7
+#endif
+
+#ifndef PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES
+#define PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES 32
+#endif
+
+// limit number of frames read from TAP in a single run loop iteration
+#ifndef PAN_NAP_BRIDGE_MAX_FRAMES_PER_READ
+#define PAN_NAP_BRIDGE_MAX_FRAMES_PER_READ 8
+#endif
+
+// Ethernet frame has to fit into L2CAP payload after BNEP packet type
+#define PAN_NAP_BRIDGE_MAX_FRAME_SIZE (HCI_ACL_PAYLOAD_SIZE - L2CAP_HEADER_SIZE - 1)
+
+#define ETHERNET_HEADER_SIZE 14
+
+// Ethernet header, 1500 bytes payload and 802.1Q tag
+#define ETHERNET_MAX_FRAME_SIZE 1518
+
+typedef struct {
+    uint16_t bnep_cid;          // 0 = unused
+    uint8_t  flood_pending;
+} pan_nap_bridge_channel_t;
+
+// remote Ethernet addresses learned from received frames
+typedef struct {
+    bd_addr_t addr;
+    uint16_t  bnep_cid;         // 0 = unused
+} pan_nap_bridge_address_t;
+
+#ifdef __APPLE__
+// tuntaposx provides fixed set of tapX devices
+static const char * tap_dev = "/dev/tap0";
+#endif
+
+#ifdef __linux
+// Linux uses single control device to bring up tunX or tapX interface
+static const char * tap_dev = "/dev/net/tun";
+#endif
+
+static char tap_dev_name[16];
+static int  tap_fd = -1;
+static btstack_data_source_t tap_data_source;
+static int  tap_reading_paused;
+
+static pan_nap_bridge_channel_t pan_nap_bridge_channels[PAN_NAP_BRIDGE_MAX_CHANNELS];
+static pan_nap_bridge_address_t pan_nap_bridge_addresses[PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES];
+static int pan_nap_bridge_addresses_next;
+
+static uint8_t  flood_frame[PAN_NAP_BRIDGE_MAX_FRAME_SIZE];
+
+// receives part of TAP frame that doesn't fit into BNEP packet, frame gets dropped
+static uint8_t  tap_overflow[ETHERNET_MAX_FRAME_SIZE];
+static uint16_t flood_frame_len;
+
+static bd_addr_t pan_nap_bridge_local_addr;
+
+static btstack_packet_handler_t pan_nap_bridge_client_handler;
+static pan_nap_bridge_stats_t   pan_nap_bridge_stats;
+
+static int pan_nap_bridge_tap_alloc(char *dev, bd_addr_t bd_addr){
+    struct ifreq ifr;
+    int fd_dev;
+    int fd_socket;
+
+    if( (fd_dev = open(tap_dev, O_RDWR)) < 0 ) {
+        log_error("TAP: Error opening %s: %s", tap_dev, strerror(errno));
+        return -1;
+    }
+
+#ifdef __linux
+    memset(&ifr, 0, sizeof(ifr));
+
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    if( *dev ) {
+        strncpy(ifr.ifr_name, dev, IFNAMSIZ - 1);
+    }
+
+    if (ioctl(fd_dev, TUNSETIFF, (void *) &ifr) < 0) {
+        log_error("TAP: Error setting device name: %s", strerror(errno));
+        close(fd_dev);
+        return -1;
+    }
+    strcpy(dev, ifr.ifr_name);
+#endif
+
+    fd_socket = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (fd_socket < 0) {
+        close(fd_dev);
+        log_error("TAP: Error opening netlink socket: %s", strerror(errno));
+        return -1;
+    }
+
+    // Configure the MAC address of the newly created device to the local bd_address
+    memset (&ifr, 0, sizeof(struct ifreq));
+    strcpy(ifr.ifr_name, dev);
+#ifdef __linux
+    ifr.ifr_hwaddr.sa_family = ARPHRD_ETHER;
+    memcpy(ifr.ifr_hwaddr.sa_data, bd_addr, sizeof(bd_addr_t));
+    if (ioctl(fd_socket, SIOCSIFHWADDR, &ifr) == -1) {
+        close(fd_dev);
+        close(fd_socket);
+        log_error("TAP: Error setting hw addr: %s", strerror(errno));
+        return -1;
+    }
+#endif
+#ifdef __APPLE__
+    ifr.ifr_addr.sa_len = ETHER_ADDR_LEN;
+    ifr.ifr_addr.sa_family = AF_LINK;
+    (void)memcpy(ifr.ifr_addr.sa_data, bd_addr, ETHER_ADDR_LEN);
+    if (ioctl(fd_socket, SIOCSIFLLADDR, &ifr) == -1) {
+        close(fd_dev);
+        close(fd_socket);
+        log_error("TAP: Error setting hw addr: %s", strerror(errno));
+        return -1;
+    }
+#endif
+
+    // Bring the interface up
+    if (ioctl(fd_socket, SIOCGIFFLAGS, &ifr) == -1) {
+        close(fd_dev);
+        close(fd_socket);
+        log_error("TAP: Error reading interface flags: %s", strerror(errno));
+        return -1;
+    }
+
+    if ((ifr.ifr_flags & IFF_UP) == 0) {
+        ifr.ifr_flags |= IFF_UP;
+        if (ioctl(fd_socket, SIOCSIFFLAGS, &ifr) == -1) {
+            close(fd_dev);
+            close(fd_socket);
+            log_error("TAP: Error set IFF_UP: %s", strerror(errno));
+            return -1;
+        }
+    }
+
+    close(fd_socket);
+
+    // several frames are read per data source callback
+    fcntl(fd_dev, F_SETFL, fcntl(fd_dev, F_GETFL) | O_NONBLOCK);
+
+    return fd_dev;
+}
+
+static pan_nap_bridge_channel_t * pan_nap_bridge_channel_for_bnep_cid(uint16_t bnep_cid){
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        if (pan_nap_bridge_channels[i].bnep_cid == bnep_cid) return &pan_nap_bridge_channels[i];
+    }
+    return NULL;
+}
+
+static void pan_nap_bridge_learn_address(const uint8_t * addr, uint16_t bnep_cid){
+    int i;
+    // ignore multicast source
+    if (addr[0] & 0x01) return;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES;i++){
+        pan_nap_bridge_address_t * entry = &pan_nap_bridge_addresses[i];
+        if (entry->bnep_cid == 0) continue;
+        if (memcmp(entry->addr, addr, sizeof(bd_addr_t)) != 0) continue;
+        entry->bnep_cid = bnep_cid;
+        return;
+    }
+    // replace round robin
+    pan_nap_bridge_address_t * entry = &pan_nap_bridge_addresses[pan_nap_bridge_addresses_next];
+    pan_nap_bridge_addresses_next = (pan_nap_bridge_addresses_next + 1) % PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES;
+    memcpy(entry->addr, addr, sizeof(bd_addr_t));
+    entry->bnep_cid = bnep_cid;
+}
+
+static void pan_nap_bridge_forget_addresses(uint16_t bnep_cid){
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES;i++){
+        if (pan_nap_bridge_addresses[i].bnep_cid != bnep_cid) continue;
+        pan_nap_bridge_addresses[i].bnep_cid = 0;
+    }
+}
+
+// @returns bnep_cid for unicast destination or 0 if frame needs to be sent to all channels
+static uint16_t pan_nap_bridge_lookup_destination(const uint8_t * addr){
+    int i;
+    if (addr[0] & 0x01) return 0;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_LEARNED_ADDRESSES;i++){
+        pan_nap_bridge_address_t * entry = &pan_nap_bridge_addresses[i];
+        if (entry->bnep_cid == 0) continue;
+        if (memcmp(entry->addr, addr, sizeof(bd_addr_t)) == 0) return entry->bnep_cid;
+    }
+    return 0;
+}
+
+// @returns bnep_cid of a channel that cannot send now or 0 if all can send
+static uint16_t pan_nap_bridge_get_blocked_channel(void){
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        pan_nap_bridge_channel_t * channel = &pan_nap_bridge_channels[i];
+        if (channel->bnep_cid == 0) continue;
+        if (channel->flood_pending) return channel->bnep_cid;
+        if (!bnep_can_send_packet_now(channel->bnep_cid)) return channel->bnep_cid;
+    }
+    return 0;
+}
+
+static uint16_t pan_nap_bridge_get_any_channel(void){
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        if (pan_nap_bridge_channels[i].bnep_cid) return pan_nap_bridge_channels[i].bnep_cid;
+    }
+    return 0;
+}
+
+static void pan_nap_bridge_pause_tap_reading(uint16_t blocked_bnep_cid){
+    if (!tap_reading_paused){
+        tap_reading_paused = 1;
+        pan_nap_bridge_stats.tap_read_stalls++;
+        btstack_run_loop_disable_data_source_callbacks(&tap_data_source, DATA_SOURCE_CALLBACK_READ);
+    }
+    bnep_request_can_send_now_event(blocked_bnep_cid);
+}
+
+static void pan_nap_bridge_resume_tap_reading(void){
+    if (!tap_reading_paused) return;
+    uint16_t blocked_bnep_cid = pan_nap_bridge_get_blocked_channel();
+    if (blocked_bnep_cid){
+        bnep_request_can_send_now_event(blocked_bnep_cid);
+        return;
+    }
+    tap_reading_paused = 0;
+    btstack_run_loop_enable_data_source_callbacks(&tap_data_source, DATA_SOURCE_CALLBACK_READ);
+}
+
+static int pan_nap_bridge_flood_pending(void){
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        if (pan_nap_bridge_channels[i].bnep_cid == 0) continue;
+        if (pan_nap_bridge_channels[i].flood_pending) return 1;
+    }
+    return 0;
+}
+
+static void pan_nap_bridge_send_flood_frame(void){
+    uint16_t blocked_bnep_cid = 0;
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        pan_nap_bridge_channel_t * channel = &pan_nap_bridge_channels[i];
+        if (channel->bnep_cid == 0) continue;
+        if (!channel->flood_pending) continue;
+        if (!bnep_can_send_packet_now(channel->bnep_cid)) {
+            blocked_bnep_cid = channel->bnep_cid;
+            continue;
+        }
+        channel->flood_pending = 0;
+        bnep_send(channel->bnep_cid, flood_frame, flood_frame_len);
+    }
+    // BNEP_EVENT_CAN_SEND_NOW continues with remaining channels
+    if (blocked_bnep_cid){
+        bnep_request_can_send_now_event(blocked_bnep_cid);
+    }
+}
+
+static void pan_nap_bridge_write_to_tap(uint8_t * frame, uint16_t len){
+    if (tap_fd < 0) {
+        pan_nap_bridge_stats.frames_dropped++;
+        return;
+    }
+    int rc = write(tap_fd, frame, len);
+    if (rc != len){
+        pan_nap_bridge_stats.frames_dropped++;
+        return;
+    }
+    pan_nap_bridge_stats.frames_to_tap++;
+    pan_nap_bridge_stats.bytes_to_tap += len;
+}
+
+// forward frame received on source channel to destination channel or to all other channels if dest_bnep_cid == 0
+static void pan_nap_bridge_forward_frame(uint16_t source_bnep_cid, uint16_t dest_bnep_cid, const uint8_t * frame, uint16_t len){
+    // send unicast directly if it doesn't overtake a pending flood frame
+    if (dest_bnep_cid){
+        pan_nap_bridge_channel_t * channel = pan_nap_bridge_channel_for_bnep_cid(dest_bnep_cid);
+        if (!channel) return;
+        if (!channel->flood_pending && bnep_can_send_packet_now(dest_bnep_cid)){
+            bnep_send(dest_bnep_cid, (uint8_t *) frame, len);
+            pan_nap_bridge_stats.frames_forwarded++;
+            return;
+        }
+    }
+
+    // copy frame, shared with TAP flood frame
+    if (pan_nap_bridge_flood_pending() || len > sizeof(flood_frame)){
+        pan_nap_bridge_stats.frames_dropped++;
+        return;
+    }
+    int num_destinations = 0;
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_CHANNELS;i++){
+        pan_nap_bridge_channel_t * channel = &pan_nap_bridge_channels[i];
+        if (channel->bnep_cid == 0) continue;
+        if (channel->bnep_cid == source_bnep_cid) continue;
+        if (dest_bnep_cid && channel->bnep_cid != dest_bnep_cid) continue;
+        channel->flood_pending = 1;
+        num_destinations++;
+    }
+    if (num_destinations == 0) return;
+    memcpy(flood_frame, frame, len);
+    flood_frame_len = len;
+    pan_nap_bridge_stats.frames_forwarded++;
+    pan_nap_bridge_send_flood_frame();
+}
+
+static void pan_nap_bridge_handle_frame(uint16_t source_bnep_cid, uint8_t * frame, uint16_t len){
+    // frame for us
+    if (memcmp(frame, pan_nap_bridge_local_addr, sizeof(bd_addr_t)) == 0){
+        pan_nap_bridge_write_to_tap(frame, len);
+        return;
+    }
+    // frame for PANU connected via other channel
+    uint16_t dest_bnep_cid = pan_nap_bridge_lookup_destination(frame);
+    if (dest_bnep_cid == source_bnep_cid){
+        pan_nap_bridge_stats.frames_dropped++;
+        return;
+    }
+    if (dest_bnep_cid){
+        pan_nap_bridge_forward_frame(source_bnep_cid, dest_bnep_cid, frame, len);
+        return;
+    }
+    // broadcast, multicast or unknown unicast: send to TAP and all other channels
+    pan_nap_bridge_write_to_tap(frame, len);
+    pan_nap_bridge_forward_frame(source_bnep_cid, 0, frame, len);
+}
+
+static void pan_nap_bridge_process_tap(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(ds);
+    UNUSED(callback_type);
+    int i;
+    for (i=0;i<PAN_NAP_BRIDGE_MAX_FRAMES_PER_READ;i++){
+
+        uint16_t blocked_bnep_cid = pan_nap_bridge_get_blocked_channel();
+        if (blocked_bnep_cid){
+            pan_nap_bridge_pause_tap_reading(blocked_bnep_cid);
+            return;
+        }
+
+        // read frame directly into outgoing buffer
+        uint16_t any_bnep_cid = pan_nap_bridge_get_any_channel();
+        if (any_bnep_cid == 0) {
+            // no channel, drop frame
+            if (read(tap_fd, flood_frame, sizeof(flood_frame)) <= 0) return;
+            pan_nap_bridge_stats.frames_dropped++;
+            continue;
+        }
+        if (bnep_reserve_packet_buffer(any_bnep_cid)){
+            pan_nap_bridge_pause_tap_reading(any_bnep_cid);
+            return;
+        }
+        uint8_t * frame = bnep_get_outgoing_ethernet_frame_buffer();
+        struct iovec iov[2];
+        iov[0].iov_base = frame;
+        iov[0].iov_len  = PAN_NAP_BRIDGE_MAX_FRAME_SIZE;
+        iov[1].iov_base = tap_overflow;
+        iov[1].iov_len  = sizeof(tap_overflow);
+        ssize_t len = readv(tap_fd, iov, 2);
+        if (len <= 0){
+            bnep_release_packet_buffer();
+            return;
+        }
+        pan_nap_bridge_stats.frames_from_tap++;
+        pan_nap_bridge_stats.bytes_from_tap += len;
+        if (len < ETHERNET_HEADER_SIZE){
+            bnep_release_packet_buffer();
+            pan_nap_bridge_stats.frames_dropped++;
+            continue;
+        }
+        if (len > PAN_NAP_BRIDGE_MAX_FRAME_SIZE){
+            log_error("pan_nap_bridge: drop TAP frame of %u bytes, max %u - increase HCI_ACL_PAYLOAD_SIZE or lower TAP MTU",
+                (unsigned int) len, (unsigned int) PAN_NAP_BRIDGE_MAX_FRAME_SIZE);
+            bnep_release_packet_buffer();
+            pan_nap_bridge_stats.frames_dropped++;
+            continue;
+        }
+
+        uint16_t bnep_cid = pan_nap_bridge_lookup_destination(frame);
+        if (bnep_cid){
+            bnep_send_prepared(bnep_cid, len);
+            continue;
+        }
+
+        // send copy to all channels
+        memcpy(flood_frame, frame, len);
+        flood_frame_len = len;
+        bnep_release_packet_buffer();
+        pan_nap_bridge_stats.frames_flooded++;
+        int j;
+        for (j=0;j<PAN_NAP_BRIDGE_MAX_CHANNELS;j++){
+            if (pan_nap_bridge_channels[j].bnep_cid == 0) continue;
+            pan_nap_bridge_channels[j].flood_pending = 1;
+        }
+        pan_nap_bridge_send_flood_frame();
+    }
+}
+
+static void pan_nap_bridge_open_tap(void){
+    if (tap_fd >= 0) return;
+    tap_fd = pan_nap_bridge_tap_alloc(tap_dev_name, pan_nap_bridge_local_addr);
+    if (tap_fd < 0) return;
+    log_info("TAP device \"%s\" allocated", tap_dev_name);
+    tap_reading_paused = 0;
+    btstack_run_loop_set_data_source_fd(&tap_data_source, tap_fd);
+    btstack_run_loop_set_data_source_handler(&tap_data_source, &pan_nap_bridge_process_tap);
+    btstack_run_loop_enable_data_source_callbacks(&tap_data_source, DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_add_data_source(&tap_data_source);
+}
+
+static void pan_nap_bridge_handle_event(uint8_t * packet){
+    pan_nap_bridge_channel_t * channel;
+    uint16_t bnep_cid;
+    switch (hci_event_packet_get_type(packet)){
+        case BNEP_EVENT_CHANNEL_OPENED:
+            if (bnep_event_channel_opened_get_status(packet)) break;
+            channel = pan_nap_bridge_channel_for_bnep_cid(0);
+            if (!channel){
+                log_error("pan_nap_bridge: no free channel, increase PAN_NAP_BRIDGE_MAX_CHANNELS");
+                break;
+            }
+            channel->bnep_cid = bnep_event_channel_opened_get_bnep_cid(packet);
+            channel->flood_pending = 0;
+            gap_local_bd_addr(pan_nap_bridge_local_addr);
+            pan_nap_bridge_open_tap();
+            break;
+        case BNEP_EVENT_CHANNEL_CLOSED:
+            bnep_cid = bnep_event_channel_closed_get_bnep_cid(packet);
+            channel = pan_nap_bridge_channel_for_bnep_cid(bnep_cid);
+            if (!channel) break;
+            channel->bnep_cid = 0;
+            channel->flood_pending = 0;
+            pan_nap_bridge_forget_addresses(bnep_cid);
+            pan_nap_bridge_resume_tap_reading();
+            break;
+        case BNEP_EVENT_CAN_SEND_NOW:
+            pan_nap_bridge_send_flood_frame();
+            pan_nap_bridge_resume_tap_reading();
+            break;
+        default:
+            break;
+    }
+}
+
+static void pan_nap_bridge_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            pan_nap_bridge_handle_event(packet);
+            break;
+        case BNEP_DATA_PACKET:
+            if (size < ETHERNET_HEADER_SIZE) break;
+            pan_nap_bridge_learn_address(&packet[6], channel);
+            // frame has been re-assembled in place by BNEP
+            pan_nap_bridge_handle_frame(channel, packet, size);
+            break;
+        default:
+            break;
+    }
+    if (!pan_nap_bridge_client_handler) return;
+    (*pan_nap_bridge_client_handler)(packet_type, channel, packet, size);
+}
+
+uint8_t pan_nap_bridge_init(const char * dev_name, uint16_t max_frame_size){
+    memset(tap_dev_name, 0, sizeof(tap_dev_name));
+    strncpy(tap_dev_name, dev_name, sizeof(tap_dev_name) - 1);
+    memset(pan_nap_bridge_channels, 0, sizeof(pan_nap_bridge_channels));
+    memset(pan_nap_bridge_addresses, 0, sizeof(pan_nap_bridge_addresses));
+    pan_nap_bridge_addresses_next = 0;
+    pan_nap_bridge_reset_stats();
+    return bnep_register_service(&pan_nap_bridge_packet_handler, BLUETOOTH_SERVICE_CLASS_NAP, max_frame_size);
+}
+
+void pan_nap_bridge_register_packet_handler(btstack_packet_handler_t handler){
+    pan_nap_bridge_client_handler = handler;
+}
+
+void pan_nap_bridge_get_stats(pan_nap_bridge_stats_t * stats){
+    *stats = pan_nap_bridge_stats;
+}
+
+void pan_nap_bridge_reset_stats(void){
+    memset(&pan_nap_bridge_stats, 0, sizeof(pan_nap_bridge_stats));
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  pan_nap_bridge_posix.h
+ *
+ *  Bridge BNEP channels of a PAN NAP service to a TAP network interface
+ */
+
+#ifndef __PAN_NAP_BRIDGE_POSIX_H
+#define __PAN_NAP_BRIDGE_POSIX_H
+
+#include <stdint.h>
+#include "btstack_defines.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t frames_to_tap;
+    uint32_t bytes_to_tap;
+    uint32_t frames_from_tap;
+    uint32_t bytes_from_tap;
+    uint32_t frames_flooded;
+    uint32_t frames_forwarded;  // frames received on a BNEP channel and sent to other channels
+    uint32_t frames_dropped;
+    uint32_t tap_read_stalls;   // TAP reading paused as BNEP channels could not send
+} pan_nap_bridge_stats_t;
+
+/* API_START */
+
+/**
+ * @brief Register BNEP NAP service and bridge all its channels to a TAP interface.
+ * @note TAP interface is created with the local BD_ADDR when the first BNEP channel is opened
+ * @param tap_dev_name name of TAP interface, e.g. "bnep%d" on Linux, "tap0" on OS X
+ * @param max_frame_size for BNEP service, at least 1691
+ * @return status
+ */
+uint8_t pan_nap_bridge_init(const char * tap_dev_name, uint16_t max_frame_size);
+
+/**
+ * @brief Register handler for BNEP events
+ * @param handler
+ */
+void pan_nap_bridge_register_packet_handler(btstack_packet_handler_t handler);
+
+/**
+ * @brief Get throughput counters
+ * @param stats
+ */
+void pan_nap_bridge_get_stats(pan_nap_bridge_stats_t * stats);
+
+/**
+ * @brief Reset throughput counters
+ */
+void pan_nap_bridge_reset_stats(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __PAN_NAP_BRIDGE_POSIX_H
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "sm_ecdh_engine_posix.c"
+
+/*
+ *  sm_ecdh_engine_posix.c
+ *
+ *  ECDH engine for the Security Manager that runs EC keypair generation and
+ *  DHKey calculation on a worker thread
+ *
+ *  The run loop only copies the input and returns. The worker thread performs the
+ *  P-256 operation and signals completion through a pipe that is registered as
+ *  data source, so results are copied and done callbacks are called on the run loop thread.
+ *
+ *  DHKey calculations are handled before keypair requests. While idle, the worker thread
+ *  fills a pool of keypairs so that a new keypair, e.g. for keypair rotation, is ready without delay.
+ */
+
+#include "btstack_config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sm_ecdh_engine_posix.h"
+
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+
+// without HAVE_MALLOC, SM provides mbedtls with a static allocator that is not thread-safe
+#if defined(USE_MBEDTLS_FOR_ECDH) && !defined(HAVE_MALLOC)
+#error "ECDH engine requires HAVE_MALLOC when USE_MBEDTLS_FOR_ECDH is defined"
+#endif
+
+#ifndef SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE
+#define SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE 4
+#endif
+
+typedef struct {
+    uint8_t public_key[64];
+    uint8_t private_key[32];
+} sm_ecdh_keypair_t;
+
+// shared with worker thread, protected by sm_ecdh_mutex
+static pthread_mutex_t   sm_ecdh_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    sm_ecdh_cond  = PTHREAD_COND_INITIALIZER;
+static int               sm_ecdh_worker_stop;
+
+static int               sm_ecdh_keypair_requested;
+static int               sm_ecdh_keypair_complete;
+static sm_ecdh_keypair_t sm_ecdh_keypair;
+
+static int               sm_ecdh_dhkey_requested;
+static int               sm_ecdh_dhkey_complete;
+static uint8_t           sm_ecdh_dhkey_public_key[64];
+static uint8_t           sm_ecdh_dhkey_private_key[32];
+static uint8_t           sm_ecdh_dhkey[32];
+
+static sm_ecdh_keypair_t sm_ecdh_keypair_pool[SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE];
+static int               sm_ecdh_keypair_pool_count;
+
+static sm_ecdh_engine_posix_stats_t sm_ecdh_stats;
+
+// run loop thread only
+static int               sm_ecdh_running;
+static pthread_t         sm_ecdh_worker;
+static int               sm_ecdh_pipe[2];
+static int               sm_ecdh_random_fd = -1;
+static btstack_data_source_t sm_ecdh_data_source;
+
+static uint8_t *         sm_ecdh_keypair_public_key_buffer;
+static uint8_t *         sm_ecdh_keypair_private_key_buffer;
+static void           (* sm_ecdh_keypair_done)(void);
+static uint8_t *         sm_ecdh_dhkey_buffer;
+static void           (* sm_ecdh_dhkey_done)(void);
+
+static int sm_ecdh_engine_posix_rng(uint8_t * buffer, unsigned size){
+    while (size){
+        ssize_t bytes_read = read(sm_ecdh_random_fd, buffer, size);
+        if (bytes_read < 0 && errno == EINTR) continue;
+        if (bytes_read <= 0) return 0;
+        buffer += bytes_read;
+        size   -= bytes_read;
+    }
+    return 1;
+}
+
+static void sm_ecdh_engine_posix_notify(void){
+    uint8_t token = 0;
+    while (write(sm_ecdh_pipe[1], &token, 1) < 0 && errno == EINTR);
+}
+
+static void * sm_ecdh_engine_posix_worker(void * context){
+    UNUSED(context);
+    uint8_t public_key[64];
+    uint8_t private_key[32];
+    uint8_t dhkey[32];
+    sm_ecdh_keypair_t keypair;
+
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    while (!sm_ecdh_worker_stop){
+
+        if (sm_ecdh_dhkey_requested){
+            memcpy(public_key,  sm_ecdh_dhkey_public_key,  64);
+            memcpy(private_key, sm_ecdh_dhkey_private_key, 32);
+            pthread_mutex_unlock(&sm_ecdh_mutex);
+            sm_ecdh_calculate_dhkey(public_key, private_key, dhkey);
+            pthread_mutex_lock(&sm_ecdh_mutex);
+            memcpy(sm_ecdh_dhkey, dhkey, 32);
+            sm_ecdh_dhkey_requested = 0;
+            sm_ecdh_dhkey_complete  = 1;
+            sm_ecdh_stats.dhkeys_calculated++;
+            sm_ecdh_engine_posix_notify();
+            continue;
+        }
+
+        if (sm_ecdh_keypair_requested && sm_ecdh_keypair_pool_count){
+            sm_ecdh_keypair = sm_ecdh_keypair_pool[--sm_ecdh_keypair_pool_count];
+            sm_ecdh_keypair_requested = 0;
+            sm_ecdh_keypair_complete  = 1;
+            sm_ecdh_stats.keypairs_from_pool++;
+            sm_ecdh_engine_posix_notify();
+            continue;
+        }
+
+        if (sm_ecdh_keypair_requested || sm_ecdh_keypair_pool_count < SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE){
+            pthread_mutex_unlock(&sm_ecdh_mutex);
+            int ok = sm_ecdh_generate_keypair(keypair.public_key, keypair.private_key, &sm_ecdh_engine_posix_rng);
+            pthread_mutex_lock(&sm_ecdh_mutex);
+            if (!ok){
+                log_error("sm_ecdh_engine_posix: keypair generation failed");
+                // don't spin if random source fails
+                if (!sm_ecdh_keypair_requested){
+                    pthread_cond_wait(&sm_ecdh_cond, &sm_ecdh_mutex);
+                }
+                continue;
+            }
+            sm_ecdh_stats.keypairs_generated++;
+            if (sm_ecdh_keypair_requested){
+                sm_ecdh_keypair = keypair;
+                sm_ecdh_keypair_requested = 0;
+                sm_ecdh_keypair_complete  = 1;
+                sm_ecdh_engine_posix_notify();
+            } else {
+                sm_ecdh_keypair_pool[sm_ecdh_keypair_pool_count++] = keypair;
+            }
+            continue;
+        }
+
+        pthread_cond_wait(&sm_ecdh_cond, &sm_ecdh_mutex);
+    }
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+    return NULL;
+}
+
+static void sm_ecdh_engine_posix_process(btstack_data_source_t * ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(callback_type);
+    uint8_t tokens[16];
+    while (read(ds->fd, tokens, sizeof(tokens)) > 0);
+
+    void (*keypair_done)(void) = NULL;
+    void (*dhkey_done)(void)   = NULL;
+
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    if (sm_ecdh_keypair_complete){
+        sm_ecdh_keypair_complete = 0;
+        memcpy(sm_ecdh_keypair_public_key_buffer,  sm_ecdh_keypair.public_key,  64);
+        memcpy(sm_ecdh_keypair_private_key_buffer, sm_ecdh_keypair.private_key, 32);
+        keypair_done = sm_ecdh_keypair_done;
+    }
+    if (sm_ecdh_dhkey_complete){
+        sm_ecdh_dhkey_complete = 0;
+        memcpy(sm_ecdh_dhkey_buffer, sm_ecdh_dhkey, 32);
+        dhkey_done = sm_ecdh_dhkey_done;
+    }
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+
+    // callbacks may start new operations
+    if (dhkey_done){
+        (*dhkey_done)();
+    }
+    if (keypair_done){
+        (*keypair_done)();
+    }
+}
+
+static void sm_ecdh_engine_posix_generate_keypair(uint8_t * public_key, uint8_t * private_key, void (*done)(void)){
+    sm_ecdh_keypair_public_key_buffer  = public_key;
+    sm_ecdh_keypair_private_key_buffer = private_key;
+    sm_ecdh_keypair_done = done;
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    if (sm_ecdh_keypair_requested || sm_ecdh_keypair_complete){
+        log_error("sm_ecdh_engine_posix: keypair generation already active");
+    }
+    sm_ecdh_keypair_requested = 1;
+    pthread_cond_signal(&sm_ecdh_cond);
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+}
+
+static void sm_ecdh_engine_posix_calculate_dhkey(const uint8_t * public_key, const uint8_t * private_key, uint8_t * dhkey, void (*done)(void)){
+    sm_ecdh_dhkey_buffer = dhkey;
+    sm_ecdh_dhkey_done = done;
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    if (sm_ecdh_dhkey_requested || sm_ecdh_dhkey_complete){
+        log_error("sm_ecdh_engine_posix: dhkey calculation already active");
+    }
+    memcpy(sm_ecdh_dhkey_public_key,  public_key,  64);
+    memcpy(sm_ecdh_dhkey_private_key, private_key, 32);
+    sm_ecdh_dhkey_requested = 1;
+    pthread_cond_signal(&sm_ecdh_cond);
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+}
+
+static const sm_ecdh_engine_t sm_ecdh_engine_posix = {
+    &sm_ecdh_engine_posix_generate_keypair,
+    &sm_ecdh_engine_posix_calculate_dhkey,
+};
+
+static int sm_ecdh_engine_posix_init(void){
+    sm_ecdh_random_fd = open("/dev/urandom", O_RDONLY);
+    if (sm_ecdh_random_fd < 0){
+        log_error("sm_ecdh_engine_posix: cannot open /dev/urandom");
+        return -1;
+    }
+    if (pipe(sm_ecdh_pipe)){
+        log_error("sm_ecdh_engine_posix: cannot create pipe");
+        close(sm_ecdh_random_fd);
+        return -1;
+    }
+    fcntl(sm_ecdh_pipe[0], F_SETFL, fcntl(sm_ecdh_pipe[0], F_GETFL) | O_NONBLOCK);
+
+    sm_ecdh_worker_stop        = 0;
+    sm_ecdh_keypair_requested  = 0;
+    sm_ecdh_keypair_complete   = 0;
+    sm_ecdh_dhkey_requested    = 0;
+    sm_ecdh_dhkey_complete     = 0;
+    sm_ecdh_keypair_pool_count = 0;
+    if (pthread_create(&sm_ecdh_worker, NULL, &sm_ecdh_engine_posix_worker, NULL)){
+        log_error("sm_ecdh_engine_posix: cannot create worker thread");
+        close(sm_ecdh_pipe[0]);
+        close(sm_ecdh_pipe[1]);
+        close(sm_ecdh_random_fd);
+        return -1;
+    }
+
+    btstack_run_loop_set_data_source_fd(&sm_ecdh_data_source, sm_ecdh_pipe[0]);
+    btstack_run_loop_set_data_source_handler(&sm_ecdh_data_source, &sm_ecdh_engine_posix_process);
+    btstack_run_loop_enable_data_source_callbacks(&sm_ecdh_data_source, DATA_SOURCE_CALLBACK_READ);
+    btstack_run_loop_add_data_source(&sm_ecdh_data_source);
+    sm_ecdh_running = 1;
+    return 0;
+}
+
+const sm_ecdh_engine_t * sm_ecdh_engine_posix_instance(void){
+    if (!sm_ecdh_running && sm_ecdh_engine_posix_init()) return NULL;
+    return &sm_ecdh_engine_posix;
+}
+
+void sm_ecdh_engine_posix_deinit(void){
+    if (!sm_ecdh_running) return;
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    sm_ecdh_worker_stop = 1;
+    pthread_cond_signal(&sm_ecdh_cond);
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+    pthread_join(sm_ecdh_worker, NULL);
+
+    btstack_run_loop_remove_data_source(&sm_ecdh_data_source);
+    close(sm_ecdh_pipe[0]);
+    close(sm_ecdh_pipe[1]);
+    close(sm_ecdh_random_fd);
+    sm_ecdh_random_fd = -1;
+    sm_ecdh_running = 0;
+    log_info("sm_ecdh_engine_posix: %u keypairs generated, %u from pool, %u dhkeys calculated",
+        sm_ecdh_stats.keypairs_generated, sm_ecdh_stats.keypairs_from_pool, sm_ecdh_stats.dhkeys_calculated);
+}
+
+void sm_ecdh_engine_posix_get_stats(sm_ecdh_engine_posix_stats_t * stats){
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    *stats = sm_ecdh_stats;
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+}
+
+void sm_ecdh_engine_posix_reset_stats(void){
+    pthread_mutex_lock(&sm_ecdh_mutex);
+    memset(&sm_ecdh_stats, 0, sizeof(sm_ecdh_stats));
+    pthread_mutex_unlock(&sm_ecdh_mutex);
+}
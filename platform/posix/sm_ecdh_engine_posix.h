@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  sm_ecdh_engine_posix.h
+ *
+ *  ECDH engine for the Security Manager that runs EC keypair generation and
+ *  DHKey calculation on a worker thread
+ *
+ *  With USE_MBEDTLS_FOR_ECDH, HAVE_MALLOC is required as the worker thread and the
+ *  run loop thread use mbedtls concurrently.
+ */
+
+#ifndef __SM_ECDH_ENGINE_POSIX_H
+#define __SM_ECDH_ENGINE_POSIX_H
+
+#include <stdint.h>
+#include "ble/sm.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t keypairs_generated;    // by worker thread, including pool refills
+    uint32_t keypairs_from_pool;
+    uint32_t dhkeys_calculated;
+} sm_ecdh_engine_posix_stats_t;
+
+/* API_START */
+
+/**
+ * @brief Get ECDH engine instance. Starts worker thread on first call.
+ * @note Idle worker thread fills pool of SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE keypairs
+ * @return engine for sm_set_ecdh_engine or NULL if worker thread could not be started
+ */
+const sm_ecdh_engine_t * sm_ecdh_engine_posix_instance(void);
+
+/**
+ * @brief Stop worker thread. Pending operations are dropped.
+ */
+void sm_ecdh_engine_posix_deinit(void);
+
+/**
+ * @brief Get operation counters
+ * @param stats
+ */
+void sm_ecdh_engine_posix_get_stats(sm_ecdh_engine_posix_stats_t * stats);
+
+/**
+ * @brief Reset operation counters
+ */
+void sm_ecdh_engine_posix_reset_stats(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __SM_ECDH_ENGINE_POSIX_H
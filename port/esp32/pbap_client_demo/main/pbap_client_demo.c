@@ -50,6 +50,7 @@
 #include "btstack_event.h"
 #include "classic/goep_client.h"
 #include "classic/pbap_client.h"
+#include "classic/vcard_parser.h"
 
 #ifdef HAVE_BTSTACK_STDIN
 #include "btstack_stdin.h"
@@ -69,6 +70,32 @@ static const char * remote_addr_string = "30-85-A9-54-2E-78";
 static btstack_packet_callback_registration_t hci_event_callback_registration;
 static uint16_t pbap_cid;
 
+// contacts are reported while phonebook is received
+static vcard_parser_t vcard_parser;
+static char vcard_line_buffer[256];
+
+static void vcard_handler(void * context, vcard_parser_event_t event, const vcard_parser_property_t * property){
+    (void)context;
+    switch (event){
+        case VCARD_PARSER_EVENT_PROPERTY:
+            if (strcmp(property->name, "FN") == 0 || strcmp(property->name, "TEL") == 0){
+                printf("%s: %s%s\n", property->name, property->value, property->truncated ? "..." : "");
+            }
+            break;
+        case VCARD_PARSER_EVENT_CONTACT_END:
+            printf("---\n");
+            break;
+        default:
+            break;
+    }
+}
+
+static void pull_phonebook(void){
+    printf("[+] Pull phonebook\n");
+    vcard_parser_init(&vcard_parser, vcard_line_buffer, sizeof(vcard_line_buffer), &vcard_handler, NULL);
+    pbap_pull_phonebook(pbap_cid);
+}
+
 #ifdef HAVE_BTSTACK_STDIN
 
 // Testig User Interface 
@@ -103,7 +130,7 @@ static void stdin_process(char c){
             pbap_set_phonebook(pbap_cid, "SIM1/telecom/pb");
             break;
         case 'd':
-            pbap_pull_phonebook(pbap_cid);
+            pull_phonebook();
             break;
         case 'e':
             pbap_disconnect(pbap_cid);
@@ -117,8 +144,6 @@ static void stdin_process(char c){
 // packet handler for interactive console
 static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(channel);
-    UNUSED(size);
-    int i;
     switch (packet_type){
         case HCI_EVENT_PACKET:
             switch (hci_event_packet_get_type(packet)) {
@@ -137,6 +162,7 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
                             printf("[+] Connection closed\n");
                             break;
                         case PBAP_SUBEVENT_OPERATION_COMPLETED:
+                            vcard_parser_finalize(&vcard_parser);
                             printf("[+] Operation complete\n");
                             break;
                         default:
@@ -148,9 +174,7 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             }
             break;
         case PBAP_DATA_PACKET:
-            for (i=0;i<size;i++){
-                printf("%c", packet[i]);
-            }
+            vcard_parser_process_data(&vcard_parser, packet, size);
             break;
         default:
             break;
@@ -161,8 +185,6 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
 // packet handler for emdded system with fixed operation sequence
 static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(channel);
-    UNUSED(size);
-    int i;
     switch (packet_type){
         case HCI_EVENT_PACKET:
             switch (hci_event_packet_get_type(packet)) {
@@ -177,15 +199,15 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
                     switch (hci_event_pbap_meta_get_subevent_code(packet)){
                         case PBAP_SUBEVENT_CONNECTION_OPENED:
                             printf("[+] Connected\n");
-                            printf("[+] Pull phonebook\n");
-                            pbap_pull_phonebook(pbap_cid);
+                            pull_phonebook();
                             break;
                         case PBAP_SUBEVENT_CONNECTION_CLOSED:
                             printf("[+] Connection closed\n");
                             break;
                         case PBAP_SUBEVENT_OPERATION_COMPLETED:
+                            vcard_parser_finalize(&vcard_parser);
                             printf("[+] Operation complete\n");
-                            printf("[+] Pull Phonebook complete\n");
+                            printf("[+] Pull Phonebook complete, %u contacts\n", (unsigned int) vcard_parser_get_num_contacts(&vcard_parser));
                             pbap_disconnect(pbap_cid);
                             break;
                         default:
@@ -197,9 +219,7 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
             }
             break;
         case PBAP_DATA_PACKET:
-            for (i=0;i<size;i++){
-                printf("%c", packet[i]);
-            }
+            vcard_parser_process_data(&vcard_parser, packet, size);
             break;
         default:
             break;
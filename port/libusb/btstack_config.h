@@ -26,5 +26,6 @@
 // BTstack configuration. buffers, sizes, ...
 #define HCI_ACL_PAYLOAD_SIZE (1691 + 4)
 #define HCI_INCOMING_PRE_BUFFER_SIZE 14 // sizeof BNEP header, avoid memcpy
+#define HCI_TRANSPORT_USB_ACL_IN_BUFFER_COUNT 8
 
 #endif
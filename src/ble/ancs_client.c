@@ -110,6 +110,7 @@ static uint16_t ancs_attribute_len;
 
 static btstack_packet_handler_t client_handler;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+static btstack_event_mask_t hci_event_mask;
 
 void ancs_client_register_callback(btstack_packet_handler_t handler){
     client_handler = handler; 
@@ -349,5 +350,10 @@ static void handle_hci_event(uint8_t packet_type, uint16_t channel, uint8_t *pac
 
 void ancs_client_init(void){
     hci_event_callback_registration.callback = &handle_hci_event;
+    btstack_event_mask_clear(&hci_event_mask);
+    btstack_event_mask_add_le_subevent(&hci_event_mask, HCI_SUBEVENT_LE_CONNECTION_COMPLETE);
+    btstack_event_mask_add_event(&hci_event_mask, HCI_EVENT_ENCRYPTION_CHANGE);
+    btstack_event_mask_add_event(&hci_event_mask, HCI_EVENT_DISCONNECTION_COMPLETE);
+    hci_event_callback_registration.event_mask = &hci_event_mask;
     hci_add_event_handler(&hci_event_callback_registration);
 }
@@ -69,6 +69,7 @@ static void att_run_for_context(att_server_t * att_server);
 
 // global
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+static btstack_event_mask_t                   hci_event_mask;
 static btstack_packet_callback_registration_t sm_event_callback_registration;
 static btstack_packet_handler_t               att_client_packet_handler = NULL;
 static btstack_linked_list_t                  can_send_now_clients;
@@ -459,6 +460,12 @@ void att_server_init(uint8_t const * db, att_read_callback_t read_callback, att_
 
     // register for HCI Events
     hci_event_callback_registration.callback = &att_event_packet_handler;
+    btstack_event_mask_clear(&hci_event_mask);
+    btstack_event_mask_add_le_subevent(&hci_event_mask, HCI_SUBEVENT_LE_CONNECTION_COMPLETE);
+    btstack_event_mask_add_event(&hci_event_mask, HCI_EVENT_ENCRYPTION_CHANGE);
+    btstack_event_mask_add_event(&hci_event_mask, HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE);
+    btstack_event_mask_add_event(&hci_event_mask, HCI_EVENT_DISCONNECTION_COMPLETE);
+    hci_event_callback_registration.event_mask = &hci_event_mask;
     hci_add_event_handler(&hci_event_callback_registration);
 
     // register for SM events
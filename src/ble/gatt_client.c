@@ -65,6 +65,7 @@
 static btstack_linked_list_t gatt_client_connections;
 static btstack_linked_list_t gatt_client_value_listeners;
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+static btstack_event_mask_t hci_event_mask;
 static uint8_t  pts_suppress_mtu_exchange;
 
 static void gatt_client_att_packet_handler(uint8_t packet_type, uint16_t handle, uint8_t *packet, uint16_t size);
@@ -89,6 +90,10 @@ void gatt_client_init(void){
 
     // regsister for HCI Events
     hci_event_callback_registration.callback = &gatt_client_hci_event_packet_handler;
+    // L2CAP_EVENT_CAN_SEND_NOW is requested when needed, no need to track completed packets
+    btstack_event_mask_set_all_except_reports(&hci_event_mask);
+    btstack_event_mask_remove_event(&hci_event_mask, HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS);
+    hci_event_callback_registration.event_mask = &hci_event_mask;
     hci_add_event_handler(&hci_event_callback_registration);
 
     // and ATT Client PDUs
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "le_scan_engine.c"
+
+/*
+ *  le_scan_engine.c
+ */
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ble/le_scan_engine.h"
+
+#include "ad_parser.h"
+#include "bluetooth_data_types.h"
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+
+// max number of slots inspected for duplicate lookup
+#define LE_SCAN_ENGINE_MAX_PROBES 8
+
+// event type, address type, address, rssi, num aggregated, data length
+#define LE_SCAN_REPORT_HEADER_SIZE 11
+
+// rssi value for 'not available'
+#define LE_SCAN_RSSI_NOT_AVAILABLE 127
+
+typedef struct {
+    uint32_t hash;              // 0 = unused
+    uint32_t window_start_ms;
+    int16_t  rssi_sum;          // of suppressed reports
+    uint8_t  num_rssi;
+    uint8_t  num_suppressed;
+} le_scan_duplicate_entry_t;
+
+static int                       le_scan_engine_active;
+static btstack_packet_handler_t  le_scan_engine_packet_handler;
+static btstack_linked_list_t     le_scan_engine_filters;
+static uint32_t                  le_scan_engine_duplicate_window_ms;
+static int8_t                    le_scan_engine_rssi_threshold;
+static le_scan_engine_statistics_t le_scan_engine_statistics;
+
+static le_scan_duplicate_entry_t le_scan_engine_duplicates[LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE];
+
+// batch
+static uint8_t                   le_scan_engine_max_reports;
+static uint16_t                  le_scan_engine_max_delay_ms;
+static btstack_timer_source_t    le_scan_engine_batch_timer;
+static int                       le_scan_engine_batch_timer_active;
+static uint8_t                   le_scan_engine_event[2 + 255];
+static uint16_t                  le_scan_engine_event_pos;
+
+static void le_scan_engine_emit_batch(void){
+    if (le_scan_engine_batch_timer_active){
+        btstack_run_loop_remove_timer(&le_scan_engine_batch_timer);
+        le_scan_engine_batch_timer_active = 0;
+    }
+    if (le_scan_engine_event[2] == 0) return;
+    le_scan_engine_event[1] = le_scan_engine_event_pos - 2;
+    le_scan_engine_statistics.num_events_emitted++;
+    if (le_scan_engine_packet_handler){
+        (*le_scan_engine_packet_handler)(HCI_EVENT_PACKET, 0, le_scan_engine_event, le_scan_engine_event_pos);
+    }
+    le_scan_engine_event[2] = 0;
+    le_scan_engine_event_pos = 3;
+}
+
+static void le_scan_engine_batch_timeout_handler(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    le_scan_engine_batch_timer_active = 0;
+    le_scan_engine_emit_batch();
+}
+
+static void le_scan_engine_deliver(uint8_t event_type, uint8_t address_type, const uint8_t * address, int8_t rssi,
+    uint8_t num_aggregated, uint8_t data_length, const uint8_t * data){
+
+    // flush if report does not fit
+    if ((le_scan_engine_event_pos + LE_SCAN_REPORT_HEADER_SIZE + data_length) > (int) sizeof(le_scan_engine_event)){
+        le_scan_engine_emit_batch();
+    }
+
+    uint8_t * report = &le_scan_engine_event[le_scan_engine_event_pos];
+    report[0] = event_type;
+    report[1] = address_type;
+    memcpy(&report[2], address, 6);
+    report[8] = (uint8_t) rssi;
+    report[9] = num_aggregated;
+    report[10] = data_length;
+    memcpy(&report[LE_SCAN_REPORT_HEADER_SIZE], data, data_length);
+    le_scan_engine_event_pos += LE_SCAN_REPORT_HEADER_SIZE + data_length;
+    le_scan_engine_event[2]++;
+    le_scan_engine_statistics.num_reports_delivered++;
+
+    if (le_scan_engine_event[2] >= le_scan_engine_max_reports || le_scan_engine_max_delay_ms == 0){
+        le_scan_engine_emit_batch();
+        return;
+    }
+    if (!le_scan_engine_batch_timer_active){
+        btstack_run_loop_set_timer_handler(&le_scan_engine_batch_timer, le_scan_engine_batch_timeout_handler);
+        btstack_run_loop_set_timer(&le_scan_engine_batch_timer, le_scan_engine_max_delay_ms);
+        btstack_run_loop_add_timer(&le_scan_engine_batch_timer);
+        le_scan_engine_batch_timer_active = 1;
+    }
+}
+
+// FNV-1a
+static uint32_t le_scan_engine_hash(uint8_t event_type, uint8_t address_type, const uint8_t * address, uint8_t data_length, const uint8_t * data){
+    uint32_t hash = 2166136261u;
+    int i;
+    hash = (hash ^ event_type)   * 16777619u;
+    hash = (hash ^ address_type) * 16777619u;
+    for (i = 0; i < 6; i++){
+        hash = (hash ^ address[i]) * 16777619u;
+    }
+    for (i = 0; i < data_length; i++){
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    // 0 marks unused entry
+    if (hash == 0) hash = 1;
+    return hash;
+}
+
+static int le_scan_engine_window_expired(le_scan_duplicate_entry_t * entry, uint32_t now){
+    return (uint32_t)(now - entry->window_start_ms) >= le_scan_engine_duplicate_window_ms;
+}
+
+// returns entry for hash or NULL if it was not seen before. in that case, a new entry has been added
+static le_scan_duplicate_entry_t * le_scan_engine_duplicate_lookup(uint32_t hash, uint32_t now){
+    le_scan_duplicate_entry_t * victim = NULL;
+    uint32_t index = hash;
+    int i;
+    for (i = 0; i < LE_SCAN_ENGINE_MAX_PROBES; i++, index++){
+        le_scan_duplicate_entry_t * entry = &le_scan_engine_duplicates[index & (LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE - 1)];
+        if (entry->hash == hash) return entry;
+        if (entry->hash == 0){
+            // end of probe sequence, use free entry unless an expired one was found
+            if (!victim || !le_scan_engine_window_expired(victim, now)){
+                victim = entry;
+            }
+            break;
+        }
+        // prefer expired entries, otherwise replace oldest
+        if (!victim){
+            victim = entry;
+            continue;
+        }
+        int victim_expired = le_scan_engine_window_expired(victim, now);
+        int entry_expired  = le_scan_engine_window_expired(entry, now);
+        if (victim_expired && !entry_expired) continue;
+        if (entry_expired && !victim_expired){
+            victim = entry;
+            continue;
+        }
+        if ((int32_t)(entry->window_start_ms - victim->window_start_ms) < 0){
+            victim = entry;
+        }
+    }
+    memset(victim, 0, sizeof(le_scan_duplicate_entry_t));
+    victim->hash = hash;
+    victim->window_start_ms = now;
+    return NULL;
+}
+
+// check that AD structures don't exceed data length before using ad_parser
+static int le_scan_engine_ad_data_valid(uint8_t data_length, const uint8_t * data){
+    int offset = 0;
+    while (offset < data_length){
+        uint8_t len = data[offset];
+        // zero length marks end of significant part
+        if (len == 0) return 1;
+        if (offset + 1 + len > data_length) return 0;
+        offset += 1 + len;
+    }
+    return 1;
+}
+
+static int le_scan_engine_contains_manufacturer(uint8_t data_length, const uint8_t * data, uint16_t company_id){
+    ad_context_t context;
+    for (ad_iterator_init(&context, data_length, data) ; ad_iterator_has_more(&context) ; ad_iterator_next(&context)){
+        if (data[context.offset] == 0) break;
+        if (ad_iterator_get_data_type(&context) != BLUETOOTH_DATA_TYPE_MANUFACTURER_SPECIFIC_DATA) continue;
+        if (ad_iterator_get_data_len(&context) < 2) continue;
+        if (little_endian_read_16(ad_iterator_get_data(&context), 0) == company_id) return 1;
+    }
+    return 0;
+}
+
+static int le_scan_engine_filter_matches(le_scan_filter_t * filter, const uint8_t * address, uint8_t data_length, const uint8_t * data){
+    bd_addr_t report_address;
+    switch (filter->type){
+        case LE_SCAN_FILTER_TYPE_UUID16:
+            return ad_data_contains_uuid16(data_length, data, filter->uuid16);
+        case LE_SCAN_FILTER_TYPE_UUID128:
+            return ad_data_contains_uuid128(data_length, data, filter->uuid128);
+        case LE_SCAN_FILTER_TYPE_MANUFACTURER_ID:
+            return le_scan_engine_contains_manufacturer(data_length, data, filter->company_id);
+        case LE_SCAN_FILTER_TYPE_ADDRESS:
+            reverse_bd_addr(address, report_address);
+            return bd_addr_cmp(report_address, filter->address) == 0;
+        default:
+            return 0;
+    }
+}
+
+static int le_scan_engine_filters_match(const uint8_t * address, uint8_t data_length, const uint8_t * data){
+    if (btstack_linked_list_empty(&le_scan_engine_filters)) return 1;
+    if (!le_scan_engine_ad_data_valid(data_length, data)) return 0;
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &le_scan_engine_filters);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        le_scan_filter_t * filter = (le_scan_filter_t *) btstack_linked_list_iterator_next(&it);
+        if (le_scan_engine_filter_matches(filter, address, data_length, data)) return 1;
+    }
+    return 0;
+}
+
+void le_scan_engine_handle_advertising_report(uint8_t event_type, uint8_t address_type, const uint8_t * address, int8_t rssi, uint8_t data_length, const uint8_t * data){
+    le_scan_engine_statistics.num_reports_received++;
+
+    if (rssi != LE_SCAN_RSSI_NOT_AVAILABLE && rssi < le_scan_engine_rssi_threshold){
+        le_scan_engine_statistics.num_reports_filtered++;
+        return;
+    }
+    if (!le_scan_engine_filters_match(address, data_length, data)){
+        le_scan_engine_statistics.num_reports_filtered++;
+        return;
+    }
+
+    uint8_t num_aggregated = 1;
+    if (le_scan_engine_duplicate_window_ms){
+        uint32_t now  = btstack_run_loop_get_time_ms();
+        uint32_t hash = le_scan_engine_hash(event_type, address_type, address, data_length, data);
+        le_scan_duplicate_entry_t * entry = le_scan_engine_duplicate_lookup(hash, now);
+        if (entry){
+            if (!le_scan_engine_window_expired(entry, now)){
+                // suppress, but remember for next delivery
+                le_scan_engine_statistics.num_reports_suppressed++;
+                if (entry->num_suppressed < 254){
+                    entry->num_suppressed++;
+                    if (rssi != LE_SCAN_RSSI_NOT_AVAILABLE){
+                        entry->rssi_sum += rssi;
+                        entry->num_rssi++;
+                    }
+                }
+                return;
+            }
+            // new window: report average rssi and number of reports since last delivery
+            if (entry->num_rssi){
+                if (rssi != LE_SCAN_RSSI_NOT_AVAILABLE){
+                    entry->rssi_sum += rssi;
+                    entry->num_rssi++;
+                }
+                rssi = (int8_t) (entry->rssi_sum / entry->num_rssi);
+            }
+            num_aggregated = entry->num_suppressed + 1;
+            entry->window_start_ms = now;
+            entry->rssi_sum = 0;
+            entry->num_rssi = 0;
+            entry->num_suppressed = 0;
+        }
+    }
+
+    le_scan_engine_deliver(event_type, address_type, address, rssi, num_aggregated, data_length, data);
+}
+
+void le_scan_engine_init(void){
+    le_scan_engine_active = 0;
+    le_scan_engine_packet_handler = NULL;
+    le_scan_engine_filters = NULL;
+    le_scan_engine_duplicate_window_ms = 0;
+    le_scan_engine_rssi_threshold = -127;
+    le_scan_engine_max_reports = 1;
+    le_scan_engine_max_delay_ms = 0;
+    if (le_scan_engine_batch_timer_active){
+        btstack_run_loop_remove_timer(&le_scan_engine_batch_timer);
+        le_scan_engine_batch_timer_active = 0;
+    }
+    le_scan_engine_event[0] = GAP_EVENT_ADVERTISING_REPORT_BATCH;
+    le_scan_engine_event[2] = 0;
+    le_scan_engine_event_pos = 3;
+    memset(&le_scan_engine_statistics, 0, sizeof(le_scan_engine_statistics));
+    le_scan_engine_reset_duplicates();
+}
+
+void le_scan_engine_register_packet_handler(btstack_packet_handler_t handler){
+    le_scan_engine_packet_handler = handler;
+}
+
+void le_scan_engine_enable(int enabled){
+    if (!enabled){
+        le_scan_engine_emit_batch();
+    }
+    le_scan_engine_active = enabled;
+}
+
+int le_scan_engine_enabled(void){
+    return le_scan_engine_active;
+}
+
+void le_scan_engine_set_duplicate_window(uint32_t window_ms){
+    le_scan_engine_duplicate_window_ms = window_ms;
+    le_scan_engine_reset_duplicates();
+}
+
+void le_scan_engine_set_batch_parameters(uint8_t max_reports, uint16_t max_delay_ms){
+    if (max_reports == 0){
+        max_reports = 1;
+    }
+    le_scan_engine_emit_batch();
+    le_scan_engine_max_reports = max_reports;
+    le_scan_engine_max_delay_ms = max_delay_ms;
+}
+
+void le_scan_engine_set_rssi_threshold(int8_t rssi_threshold){
+    le_scan_engine_rssi_threshold = rssi_threshold;
+}
+
+static void le_scan_engine_add_filter(le_scan_filter_t * filter, le_scan_filter_type_t type){
+    filter->type = type;
+    btstack_linked_list_add_tail(&le_scan_engine_filters, (btstack_linked_item_t *) filter);
+}
+
+void le_scan_engine_add_uuid16_filter(le_scan_filter_t * filter, uint16_t uuid16){
+    filter->uuid16 = uuid16;
+    le_scan_engine_add_filter(filter, LE_SCAN_FILTER_TYPE_UUID16);
+}
+
+void le_scan_engine_add_uuid128_filter(le_scan_filter_t * filter, const uint8_t * uuid128){
+    filter->uuid128 = uuid128;
+    le_scan_engine_add_filter(filter, LE_SCAN_FILTER_TYPE_UUID128);
+}
+
+void le_scan_engine_add_manufacturer_filter(le_scan_filter_t * filter, uint16_t company_id){
+    filter->company_id = company_id;
+    le_scan_engine_add_filter(filter, LE_SCAN_FILTER_TYPE_MANUFACTURER_ID);
+}
+
+void le_scan_engine_add_address_filter(le_scan_filter_t * filter, bd_addr_t address){
+    bd_addr_copy(filter->address, address);
+    le_scan_engine_add_filter(filter, LE_SCAN_FILTER_TYPE_ADDRESS);
+}
+
+void le_scan_engine_remove_filter(le_scan_filter_t * filter){
+    btstack_linked_list_remove(&le_scan_engine_filters, (btstack_linked_item_t *) filter);
+}
+
+void le_scan_engine_flush(void){
+    le_scan_engine_emit_batch();
+}
+
+void le_scan_engine_reset_duplicates(void){
+    memset(le_scan_engine_duplicates, 0, sizeof(le_scan_engine_duplicates));
+}
+
+void le_scan_engine_get_statistics(le_scan_engine_statistics_t * statistics){
+    *statistics = le_scan_engine_statistics;
+}
+
+// GAP_EVENT_ADVERTISING_REPORT_BATCH iterator
+void le_scan_report_iterator_init(le_scan_report_iterator_t * it, const uint8_t * event){
+    it->event = event;
+    it->offset = 3;
+    it->num_remaining = event[2];
+}
+
+int le_scan_report_iterator_has_more(const le_scan_report_iterator_t * it){
+    return it->num_remaining > 0;
+}
+
+void le_scan_report_iterator_next(le_scan_report_iterator_t * it){
+    it->offset += LE_SCAN_REPORT_HEADER_SIZE + it->event[it->offset + 10];
+    it->num_remaining--;
+}
+
+uint8_t le_scan_report_iterator_get_advertising_event_type(const le_scan_report_iterator_t * it){
+    return it->event[it->offset];
+}
+
+uint8_t le_scan_report_iterator_get_address_type(const le_scan_report_iterator_t * it){
+    return it->event[it->offset + 1];
+}
+
+void le_scan_report_iterator_get_address(const le_scan_report_iterator_t * it, bd_addr_t address){
+    reverse_bd_addr(&it->event[it->offset + 2], address);
+}
+
+int8_t le_scan_report_iterator_get_rssi(const le_scan_report_iterator_t * it){
+    return (int8_t) it->event[it->offset + 8];
+}
+
+uint8_t le_scan_report_iterator_get_num_aggregated(const le_scan_report_iterator_t * it){
+    return it->event[it->offset + 9];
+}
+
+uint8_t le_scan_report_iterator_get_data_length(const le_scan_report_iterator_t * it){
+    return it->event[it->offset + 10];
+}
+
+const uint8_t * le_scan_report_iterator_get_data(const le_scan_report_iterator_t * it){
+    return &it->event[it->offset + LE_SCAN_REPORT_HEADER_SIZE];
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  le_scan_engine.h
+ *
+ *  Host-side processing of LE Advertising Reports for dense environments:
+ *  filtering, duplicate suppression with RSSI aggregation, and batched delivery
+ */
+
+#ifndef __LE_SCAN_ENGINE_H
+#define __LE_SCAN_ENGINE_H
+
+#include <stdint.h>
+#include "btstack_config.h"
+#include "btstack_defines.h"
+#include "btstack_linked_list.h"
+#include "bluetooth.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// size of duplicate table, must be a power of two
+#ifndef LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE
+#define LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE 64
+#endif
+
+typedef enum {
+    LE_SCAN_FILTER_TYPE_UUID16 = 0,
+    LE_SCAN_FILTER_TYPE_UUID128,
+    LE_SCAN_FILTER_TYPE_MANUFACTURER_ID,
+    LE_SCAN_FILTER_TYPE_ADDRESS,
+} le_scan_filter_type_t;
+
+typedef struct {
+    btstack_linked_item_t item;
+    le_scan_filter_type_t type;
+    uint16_t        uuid16;
+    const uint8_t * uuid128;
+    uint16_t        company_id;
+    bd_addr_t       address;
+} le_scan_filter_t;
+
+typedef struct {
+    uint32_t num_reports_received;
+    uint32_t num_reports_filtered;
+    uint32_t num_reports_suppressed;
+    uint32_t num_reports_delivered;
+    uint32_t num_events_emitted;
+} le_scan_engine_statistics_t;
+
+// iterator over reports in GAP_EVENT_ADVERTISING_REPORT_BATCH
+typedef struct {
+    const uint8_t * event;
+    uint16_t        offset;
+    uint8_t         num_remaining;
+} le_scan_report_iterator_t;
+
+/* API_START */
+
+/**
+ * @brief Init LE Scan Engine. Use before gap_start_scan.
+ */
+void le_scan_engine_init(void);
+
+/**
+ * @brief Register packet handler for GAP_EVENT_ADVERTISING_REPORT_BATCH events.
+ * @param handler
+ */
+void le_scan_engine_register_packet_handler(btstack_packet_handler_t handler);
+
+/**
+ * @brief Enable/disable LE Scan Engine. If enabled, advertising reports are delivered
+ *        via GAP_EVENT_ADVERTISING_REPORT_BATCH instead of GAP_EVENT_ADVERTISING_REPORT
+ * @param enabled
+ */
+void le_scan_engine_enable(int enabled);
+
+/**
+ * @brief Suppress reports with same address, type, and data within time window.
+ *        Suppressed reports are counted and their RSSI averaged into the next delivered report.
+ * @param window_ms or 0 to deliver all reports
+ */
+void le_scan_engine_set_duplicate_window(uint32_t window_ms);
+
+/**
+ * @brief Configure batched delivery
+ * @param max_reports per event, 1 for immediate delivery
+ * @param max_delay_ms before pending reports are delivered
+ */
+void le_scan_engine_set_batch_parameters(uint8_t max_reports, uint16_t max_delay_ms);
+
+/**
+ * @brief Drop reports with RSSI below threshold
+ * @param rssi_threshold in dBm, -127 accepts all
+ */
+void le_scan_engine_set_rssi_threshold(int8_t rssi_threshold);
+
+/**
+ * @brief Only deliver reports advertising a 16-bit Service UUID. Filters are combined with OR.
+ * @param filter storage
+ * @param uuid16
+ */
+void le_scan_engine_add_uuid16_filter(le_scan_filter_t * filter, uint16_t uuid16);
+
+/**
+ * @brief Only deliver reports advertising a 128-bit Service UUID. Filters are combined with OR.
+ * @param filter storage
+ * @param uuid128 in big endian, needs to stay valid
+ */
+void le_scan_engine_add_uuid128_filter(le_scan_filter_t * filter, const uint8_t * uuid128);
+
+/**
+ * @brief Only deliver reports with Manufacturer Specific Data of given company. Filters are combined with OR.
+ * @param filter storage
+ * @param company_id
+ */
+void le_scan_engine_add_manufacturer_filter(le_scan_filter_t * filter, uint16_t company_id);
+
+/**
+ * @brief Only deliver reports from given address. Filters are combined with OR.
+ * @param filter storage
+ * @param address
+ */
+void le_scan_engine_add_address_filter(le_scan_filter_t * filter, bd_addr_t address);
+
+/**
+ * @brief Remove filter
+ * @param filter
+ */
+void le_scan_engine_remove_filter(le_scan_filter_t * filter);
+
+/**
+ * @brief Deliver pending reports now
+ */
+void le_scan_engine_flush(void);
+
+/**
+ * @brief Forget all seen advertisers
+ */
+void le_scan_engine_reset_duplicates(void);
+
+/**
+ * @brief Get statistics
+ * @param statistics
+ */
+void le_scan_engine_get_statistics(le_scan_engine_statistics_t * statistics);
+
+/**
+ * @brief Iterate over reports in GAP_EVENT_ADVERTISING_REPORT_BATCH
+ */
+void            le_scan_report_iterator_init(le_scan_report_iterator_t * it, const uint8_t * event);
+int             le_scan_report_iterator_has_more(const le_scan_report_iterator_t * it);
+void            le_scan_report_iterator_next(le_scan_report_iterator_t * it);
+uint8_t         le_scan_report_iterator_get_advertising_event_type(const le_scan_report_iterator_t * it);
+uint8_t         le_scan_report_iterator_get_address_type(const le_scan_report_iterator_t * it);
+void            le_scan_report_iterator_get_address(const le_scan_report_iterator_t * it, bd_addr_t address);
+int8_t          le_scan_report_iterator_get_rssi(const le_scan_report_iterator_t * it);
+uint8_t         le_scan_report_iterator_get_num_aggregated(const le_scan_report_iterator_t * it);
+uint8_t         le_scan_report_iterator_get_data_length(const le_scan_report_iterator_t * it);
+const uint8_t * le_scan_report_iterator_get_data(const le_scan_report_iterator_t * it);
+
+/**
+ * @brief Process single advertising report, called by HCI
+ * @note address in little endian as in HCI LE Advertising Report
+ */
+void le_scan_engine_handle_advertising_report(uint8_t event_type, uint8_t address_type, const uint8_t * address, int8_t rssi, uint8_t data_length, const uint8_t * data);
+
+/**
+ * @brief Check if LE Scan Engine handles advertising reports, called by HCI
+ */
+int le_scan_engine_enabled(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __LE_SCAN_ENGINE_H
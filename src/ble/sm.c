@@ -79,10 +79,12 @@
 #ifdef HAVE_HCI_CONTROLLER_DHKEY_SUPPORT
 #error "Support for DHKEY Support in HCI Controller not implemented yet. Please use software implementation" 
 #else
-// #define USE_MBEDTLS_FOR_ECDH
+// define USE_MBEDTLS_FOR_ECDH in btstack_config.h to use mbedtls instead of micro-ecc
+#ifndef USE_MBEDTLS_FOR_ECDH
 #define USE_MICROECC_FOR_ECDH
 #endif
 #endif
+#endif
 
 // Software ECDH implementation provided by mbedtls
 #ifdef USE_MBEDTLS_FOR_ECDH
@@ -175,7 +177,8 @@ typedef enum {
 } ec_key_generation_state_t;
 
 typedef enum {
-    SM_STATE_VAR_DHKEY_COMMAND_RECEIVED = 1 << 0
+    SM_STATE_VAR_DHKEY_COMMAND_RECEIVED = 1 << 0,
+    SM_STATE_VAR_DHKEY_CALCULATED       = 1 << 1,
 } sm_state_var_t;
 
 //
@@ -263,6 +266,7 @@ static void * sm_random_context;
 
 // to receive hci events
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+static btstack_event_mask_t hci_event_mask;
 
 /* to dispatch sm event */
 static btstack_linked_list_t sm_event_handlers;
@@ -272,6 +276,16 @@ static btstack_linked_list_t sm_event_handlers;
 static ec_key_generation_state_t ec_key_generation_state;
 static uint8_t ec_d[32];
 static uint8_t ec_q[64];
+
+// optional ECDH engine for asynchronous key generation and DHKey calculation
+static const sm_ecdh_engine_t * sm_ecdh_engine;
+static uint8_t          sm_ecdh_dhkey_active;
+static hci_con_handle_t sm_ecdh_dhkey_con_handle;
+static uint8_t          sm_ecdh_dhkey[32];
+
+// generate new EC keypair after number of pairings
+static uint16_t sm_ec_keypair_rotation_pairings;
+static uint16_t sm_ec_keypair_num_pairings;
 #endif
 
 // Software ECDH implementation provided by mbedtls
@@ -283,9 +297,23 @@ static mbedtls_ecp_group   mbedtls_ec_group;
 // 1300 bytes with 23 allocations
 // #define MBEDTLS_ALLOC_BUFFER_SIZE (1300+23*sizeof(void *))
 // NAIVE Method with safe cond assignments (without safe cond, order changes and allocations fail)
-#define MBEDTLS_ALLOC_BUFFER_SIZE (700+18*sizeof(void *))
+// 680 bytes with 18 allocations + size class fragmentation of arena allocator
+#define MBEDTLS_ALLOC_BUFFER_SIZE (820+18*sizeof(void *))
 static uint8_t mbedtls_memory_buffer[MBEDTLS_ALLOC_BUFFER_SIZE]; 
 #endif
+
+// release all bignums of an ECDH operation at once
+static void sm_mbedtls_scope_begin(void){
+#ifndef HAVE_MALLOC
+    sm_mbedtls_allocator_scope_begin();
+#endif
+}
+
+static void sm_mbedtls_scope_end(void){
+#ifndef HAVE_MALLOC
+    sm_mbedtls_allocator_scope_end();
+#endif
+}
 #endif
 
 //
@@ -748,6 +776,7 @@ static void sm_dispatch_event(uint8_t packet_type, uint16_t channel, uint8_t * p
     btstack_linked_list_iterator_init(&it, &sm_event_handlers);
     while (btstack_linked_list_iterator_has_next(&it)){
         btstack_packet_callback_registration_t * entry = (btstack_packet_callback_registration_t*) btstack_linked_list_iterator_next(&it);
+        if (entry->event_mask && !btstack_event_mask_matches(entry->event_mask, packet)) continue;
         entry->callback(packet_type, 0, packet, size);
     }
 }
@@ -1161,11 +1190,29 @@ static int sm_key_distribution_all_received(sm_connection_t * sm_conn){
     return recv_flags == setup->sm_key_distribution_received_set;
 }
 
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+static void sm_ec_keypair_rotation_pairing_done(void){
+    if (!sm_ec_keypair_rotation_pairings) return;
+    if (!sm_ecdh_engine) return;
+    if (sm_have_ec_keypair) return;
+    if (ec_key_generation_state != EC_KEY_GENERATION_DONE) return;
+    if (!setup->sm_use_secure_connections) return;
+    sm_ec_keypair_num_pairings++;
+    if (sm_ec_keypair_num_pairings < sm_ec_keypair_rotation_pairings) return;
+    log_info("sm: generate new EC keypair after %u pairings", sm_ec_keypair_num_pairings);
+    sm_ec_keypair_num_pairings = 0;
+    ec_key_generation_state = EC_KEY_GENERATION_ACTIVE;
+}
+#endif
+
 static void sm_done_for_handle(hci_con_handle_t con_handle){
     if (sm_active_connection_handle == con_handle){
         sm_timeout_stop();
         sm_active_connection_handle = HCI_CON_HANDLE_INVALID;
         log_info("sm: connection 0x%x released setup context", con_handle);
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+        sm_ec_keypair_rotation_pairing_done();
+#endif
     }
 }
 
@@ -1201,13 +1248,13 @@ static void sm_init_setup(sm_connection_t * sm_conn){
     if (IS_RESPONDER(sm_conn->sm_role)){
         // slave
         local_packet = &setup->sm_s_pres;
-        gap_le_get_own_address(&setup->sm_s_addr_type, setup->sm_s_address);
+        gap_le_get_own_address_for_con_handle(sm_conn->sm_handle, &setup->sm_s_addr_type, setup->sm_s_address);
         setup->sm_m_addr_type = sm_conn->sm_peer_addr_type;
         memcpy(setup->sm_m_address, sm_conn->sm_peer_address, 6);
     } else {
         // master
         local_packet = &setup->sm_m_preq;
-        gap_le_get_own_address(&setup->sm_m_addr_type, setup->sm_m_address);
+        gap_le_get_own_address_for_con_handle(sm_conn->sm_handle, &setup->sm_m_addr_type, setup->sm_m_address);
         setup->sm_s_addr_type = sm_conn->sm_peer_addr_type;
         memcpy(setup->sm_s_address, sm_conn->sm_peer_address, 6);
 
@@ -1590,38 +1637,40 @@ static const uint8_t f5_key_id[] = { 0x62, 0x74, 0x6c, 0x65 };
 static const uint8_t f5_length[] = { 0x01, 0x00};  
 
 static void sm_sc_calculate_dhkey(sm_key256_t dhkey){
-    memset(dhkey, 0, 32);
-#ifdef USE_MBEDTLS_FOR_ECDH
-    // da * Pb
-    mbedtls_mpi d;
-    mbedtls_ecp_point Q;
-    mbedtls_ecp_point DH;
-    mbedtls_mpi_init(&d);
-    mbedtls_ecp_point_init(&Q);
-    mbedtls_ecp_point_init(&DH);
-    mbedtls_mpi_read_binary(&d, ec_d, 32);
-    mbedtls_mpi_read_binary(&Q.X, &setup->sm_peer_q[0] , 32);
-    mbedtls_mpi_read_binary(&Q.Y, &setup->sm_peer_q[32], 32);
-    mbedtls_mpi_lset(&Q.Z, 1);
-    mbedtls_ecp_mul(&mbedtls_ec_group, &DH, &d, &Q, NULL, NULL);
-    mbedtls_mpi_write_binary(&DH.X, dhkey, 32);
-    mbedtls_ecp_point_free(&DH);
-    mbedtls_mpi_free(&d);
-    mbedtls_ecp_point_free(&Q);
-#endif
-#ifdef USE_MICROECC_FOR_ECDH
-#if uECC_SUPPORTS_secp256r1
-    // standard version
-    uECC_shared_secret(setup->sm_peer_q, ec_d, dhkey, uECC_secp256r1());
-#else
-    // static version
-    uECC_shared_secret(setup->sm_peer_q, ec_d, dhkey);
-#endif
-#endif
+    if (setup->sm_state_vars & SM_STATE_VAR_DHKEY_CALCULATED){
+        // provided by ECDH engine
+        memcpy(dhkey, sm_ecdh_dhkey, 32);
+    } else {
+        sm_ecdh_calculate_dhkey(setup->sm_peer_q, ec_d, dhkey);
+    }
     log_info("dhkey");
     log_info_hexdump(dhkey, 32);
 }
 
+static void sm_sc_dhkey_calculated(void){
+    sm_ecdh_dhkey_active = 0;
+    // ignore result if pairing was aborted in the meantime
+    sm_connection_t * sm_conn = sm_get_connection_for_handle(sm_ecdh_dhkey_con_handle);
+    if (sm_conn && sm_active_connection_handle == sm_ecdh_dhkey_con_handle && sm_conn->sm_engine_state == SM_SC_W4_CALCULATE_DHKEY){
+        setup->sm_state_vars |= SM_STATE_VAR_DHKEY_CALCULATED;
+        sm_conn->sm_engine_state = SM_SC_W2_CALCULATE_F5_SALT;
+    }
+    sm_run();
+}
+
+static void sm_sc_start_calculating_dhkey(sm_connection_t * sm_conn){
+    sm_ecdh_dhkey_active = 1;
+    sm_ecdh_dhkey_con_handle = sm_conn->sm_handle;
+    sm_conn->sm_engine_state = SM_SC_W4_CALCULATE_DHKEY;
+    (*sm_ecdh_engine->calculate_dhkey)(setup->sm_peer_q, ec_d, sm_ecdh_dhkey, &sm_sc_dhkey_calculated);
+}
+
+static void sm_ec_keypair_generated(void){
+    ec_key_generation_state = EC_KEY_GENERATION_DONE;
+    sm_log_ec_keypair();
+    sm_run();
+}
+
 static void f5_calculate_salt(sm_connection_t * sm_conn){
     // calculate DHKEY
     sm_key256_t dhkey;
@@ -1917,6 +1966,10 @@ static void sm_run(void){
     }
 
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
+    if (ec_key_generation_state == EC_KEY_GENERATION_ACTIVE && sm_ecdh_engine){
+        ec_key_generation_state = EC_KEY_GENERATION_W4_KEY;
+        (*sm_ecdh_engine->generate_keypair)(ec_q, ec_d, &sm_ec_keypair_generated);
+    }
     if (ec_key_generation_state == EC_KEY_GENERATION_ACTIVE){
 #ifndef HAVE_HCI_CONTROLLER_DHKEY_SUPPORT
         sm_random_start(NULL);
@@ -2245,6 +2298,12 @@ static void sm_run(void){
                 sm_sc_calculate_f6_to_verify_dhkey_check(connection);
                 break;
             case SM_SC_W2_CALCULATE_F5_SALT:
+                if (sm_ecdh_engine && !(setup->sm_state_vars & SM_STATE_VAR_DHKEY_CALCULATED)){
+                    // wait for DHKey calculation of aborted pairing
+                    if (sm_ecdh_dhkey_active) break;
+                    sm_sc_start_calculating_dhkey(connection);
+                    break;
+                }
                 if (!sm_cmac_ready()) break;
                 connection->sm_engine_state = SM_SC_W4_CALCULATE_F5_SALT;
                 f5_calculate_salt(connection);
@@ -2300,6 +2359,8 @@ static void sm_run(void){
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
 
             case SM_SC_SEND_PUBLIC_KEY_COMMAND: {
+                // wait for new EC keypair
+                if (ec_key_generation_state != EC_KEY_GENERATION_DONE) break;
                 uint8_t buffer[65];
                 buffer[0] = SM_CODE_PAIRING_PUBLIC_KEY;
                 //
@@ -2607,7 +2668,7 @@ static void sm_run(void){
                     bd_addr_t local_address;
                     uint8_t buffer[8];
                     buffer[0] = SM_CODE_IDENTITY_ADDRESS_INFORMATION;
-                    gap_le_get_own_address(&buffer[1], local_address);
+                    gap_le_get_own_address_for_con_handle(connection->sm_handle, &buffer[1], local_address);
                     reverse_bd_addr(local_address, &buffer[2]);
                     l2cap_send_connectionless(connection->sm_handle, L2CAP_CID_SECURITY_MANAGER_PROTOCOL, (uint8_t*) buffer, sizeof(buffer));
                     sm_timeout_reset(connection);
@@ -2873,6 +2934,7 @@ static void sm_handle_random_result(uint8_t * data){
 
             // generate EC key
 #ifdef USE_MBEDTLS_FOR_ECDH
+            sm_mbedtls_scope_begin();
             mbedtls_mpi d;
             mbedtls_ecp_point P;
             mbedtls_mpi_init(&d);
@@ -2884,6 +2946,7 @@ static void sm_handle_random_result(uint8_t * data){
             mbedtls_mpi_write_binary(&d, ec_d, 32);
             mbedtls_ecp_point_free(&P);
             mbedtls_mpi_free(&d);
+            sm_mbedtls_scope_end();
 #endif
 
 #ifdef USE_MICROECC_FOR_ECDH
@@ -3494,6 +3557,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             err = 0;
 
 #ifdef USE_MBEDTLS_FOR_ECDH
+            sm_mbedtls_scope_begin();
             mbedtls_ecp_point Q;
             mbedtls_ecp_point_init( &Q );
             mbedtls_mpi_read_binary(&Q.X, &setup->sm_peer_q[0], 32);
@@ -3501,6 +3565,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
             mbedtls_mpi_lset(&Q.Z, 1);
             err = mbedtls_ecp_check_pubkey(&mbedtls_ec_group, &Q);
             mbedtls_ecp_point_free( & Q);
+            sm_mbedtls_scope_end();
 #endif
 #ifdef USE_MICROECC_FOR_ECDH
 #if uECC_SUPPORTS_secp256r1
@@ -3597,6 +3662,7 @@ static void sm_pdu_handler(uint8_t packet_type, hci_con_handle_t con_handle, uin
 
         case SM_SC_W2_CALCULATE_G2:
         case SM_SC_W4_CALCULATE_G2:
+        case SM_SC_W4_CALCULATE_DHKEY:
         case SM_SC_W2_CALCULATE_F5_SALT:
         case SM_SC_W4_CALCULATE_F5_SALT:
         case SM_SC_W2_CALCULATE_F5_MACKEY:
@@ -3817,6 +3883,10 @@ void sm_init(void){
 
     // register for HCI Events from HCI
     hci_event_callback_registration.callback = &sm_event_packet_handler;
+    // L2CAP_EVENT_CAN_SEND_NOW is requested when needed, no need to track completed packets
+    btstack_event_mask_set_all_except_reports(&hci_event_mask);
+    btstack_event_mask_remove_event(&hci_event_mask, HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS);
+    hci_event_callback_registration.event_mask = &hci_event_mask;
     hci_add_event_handler(&hci_event_callback_registration);
 
     // and L2CAP PDUs + L2CAP_EVENT_CAN_SEND_NOW
@@ -3887,6 +3957,105 @@ void sm_test_use_fixed_ec_keypair(void){
 #endif
 }
 
+void sm_set_ecdh_engine(const sm_ecdh_engine_t * engine){
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+    sm_ecdh_engine = engine;
+#else
+    UNUSED(engine);
+#endif
+}
+
+void sm_set_ec_keypair_rotation(uint16_t num_pairings){
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+    sm_ec_keypair_rotation_pairings = num_pairings;
+    sm_ec_keypair_num_pairings = 0;
+#else
+    UNUSED(num_pairings);
+#endif
+}
+
+int sm_ecdh_generate_keypair(uint8_t * public_key, uint8_t * private_key, int (*rng)(uint8_t * buffer, unsigned size)){
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+    int tries;
+    for (tries = 0; tries < 16 ; tries++){
+        if (!(*rng)(private_key, 32)) return 0;
+#ifdef USE_MBEDTLS_FOR_ECDH
+        sm_mbedtls_scope_begin();
+        mbedtls_mpi d;
+        mbedtls_ecp_point P;
+        mbedtls_mpi_init(&d);
+        mbedtls_ecp_point_init(&P);
+        mbedtls_mpi_read_binary(&d, private_key, 32);
+        int ok = mbedtls_ecp_check_privkey(&mbedtls_ec_group, &d) == 0
+              && mbedtls_ecp_mul(&mbedtls_ec_group, &P, &d, &mbedtls_ec_group.G, NULL, NULL) == 0;
+        if (ok){
+            mbedtls_mpi_write_binary(&P.X, &public_key[0],  32);
+            mbedtls_mpi_write_binary(&P.Y, &public_key[32], 32);
+        }
+        mbedtls_ecp_point_free(&P);
+        mbedtls_mpi_free(&d);
+        sm_mbedtls_scope_end();
+        if (ok) return 1;
+#endif
+#ifdef USE_MICROECC_FOR_ECDH
+        // uECC_make_key uses global rng, compute public key for given private key instead
+#if uECC_SUPPORTS_secp256r1
+        if (uECC_compute_public_key(private_key, public_key, uECC_secp256r1())) return 1;
+#else
+        if (uECC_compute_public_key(private_key, public_key)) return 1;
+#endif
+#endif
+    }
+    return 0;
+#else
+    UNUSED(public_key);
+    UNUSED(private_key);
+    UNUSED(rng);
+    return 0;
+#endif
+}
+
+int sm_ecdh_calculate_dhkey(const uint8_t * public_key, const uint8_t * private_key, uint8_t * dhkey){
+    memset(dhkey, 0, 32);
+#ifdef ENABLE_LE_SECURE_CONNECTIONS
+    int ok = 0;
+#ifdef USE_MBEDTLS_FOR_ECDH
+    // da * Pb
+    sm_mbedtls_scope_begin();
+    mbedtls_mpi d;
+    mbedtls_ecp_point Q;
+    mbedtls_ecp_point DH;
+    mbedtls_mpi_init(&d);
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_ecp_point_init(&DH);
+    mbedtls_mpi_read_binary(&d, private_key, 32);
+    mbedtls_mpi_read_binary(&Q.X, &public_key[0] , 32);
+    mbedtls_mpi_read_binary(&Q.Y, &public_key[32], 32);
+    mbedtls_mpi_lset(&Q.Z, 1);
+    ok = mbedtls_ecp_mul(&mbedtls_ec_group, &DH, &d, &Q, NULL, NULL) == 0;
+    mbedtls_mpi_write_binary(&DH.X, dhkey, 32);
+    mbedtls_ecp_point_free(&DH);
+    mbedtls_mpi_free(&d);
+    mbedtls_ecp_point_free(&Q);
+    sm_mbedtls_scope_end();
+#endif
+#ifdef USE_MICROECC_FOR_ECDH
+#if uECC_SUPPORTS_secp256r1
+    // standard version
+    ok = uECC_shared_secret(public_key, private_key, dhkey, uECC_secp256r1());
+#else
+    // static version
+    ok = uECC_shared_secret(public_key, private_key, dhkey);
+#endif
+#endif
+    return ok;
+#else
+    UNUSED(public_key);
+    UNUSED(private_key);
+    return 0;
+#endif
+}
+
 static sm_connection_t * sm_get_connection_for_handle(hci_con_handle_t con_handle){
     hci_connection_t * hci_con = hci_connection_for_handle(con_handle);
     if (!hci_con) return NULL;
@@ -53,6 +53,14 @@ typedef struct {
     bd_addr_type_t address_type;
 } sm_lookup_entry_t;
 
+// ECDH engine for EC keypair generation and DHKey calculation on P-256
+typedef struct {
+    // generate keypair: public_key 64 bytes, private_key 32 bytes
+    void (*generate_keypair)(uint8_t * public_key, uint8_t * private_key, void (*done)(void));
+    // calculate dhkey: public_key 64 bytes, private_key 32 bytes, dhkey 32 bytes
+    void (*calculate_dhkey)(const uint8_t * public_key, const uint8_t * private_key, uint8_t * dhkey, void (*done)(void));
+} sm_ecdh_engine_t;
+
 static inline uint8_t sm_pairing_packet_get_code(sm_pairing_packet_t packet){
     return packet[0];
 }
@@ -290,6 +298,38 @@ int sm_le_device_index(hci_con_handle_t con_handle );
  */
 void sm_use_fixed_ec_keypair(uint8_t * qx, uint8_t * qy, uint8_t * d);
 
+/**
+ * @brief Use ECDH engine for EC keypair generation and DHKey calculation, e.g. on a worker thread
+ * @note Engine copies input on call, writes result and calls done from the run loop thread
+ * @param engine or NULL to calculate synchronously
+ */
+void sm_set_ecdh_engine(const sm_ecdh_engine_t * engine);
+
+/**
+ * @brief Generate new EC keypair after given number of LE Secure Connections pairings
+ * @note Requires ECDH engine, ignored if fixed keypair is used
+ * @param num_pairings or 0 to keep keypair
+ */
+void sm_set_ec_keypair_rotation(uint16_t num_pairings);
+
+/**
+ * @brief Generate EC keypair on P-256. Does not access SM state, can be used by ECDH engine
+ * @param public_key 64 bytes
+ * @param private_key 32 bytes
+ * @param rng returns 1 if buffer was filled with random data
+ * @return 1 if ok
+ */
+int sm_ecdh_generate_keypair(uint8_t * public_key, uint8_t * private_key, int (*rng)(uint8_t * buffer, unsigned size));
+
+/**
+ * @brief Calculate DHKey on P-256. Does not access SM state, can be used by ECDH engine
+ * @param public_key 64 bytes of remote public key
+ * @param private_key 32 bytes
+ * @param dhkey 32 bytes
+ * @return 1 if ok
+ */
+int sm_ecdh_calculate_dhkey(const uint8_t * public_key, const uint8_t * private_key, uint8_t * dhkey);
+
 /* API_END */
 
 // PTS testing
@@ -37,15 +37,29 @@
 
 #define __BTSTACK_FILE__ "sm_mbedtls_allocator.c"
 
+/*
+ *  sm_mbedtls_allocator.c
+ *
+ *  Arena allocator for mbedtls bignum operations used by the Security Manager
+ *
+ *  Blocks are taken from the end of the used area (bump allocation). Freed blocks are put
+ *  on a free list per size class (multiple of 8 bytes) and reused for the next allocation
+ *  of the same size, which is the common case as mbedtls grows its mpis in small steps.
+ *  Blocks larger than the biggest size class are kept on a single first-fit list.
+ *
+ *  The Security Manager wraps each ECDH operation in sm_mbedtls_allocator_scope_begin/end.
+ *  At the end of the scope, all blocks allocated within are released by resetting the bump
+ *  offset, so there's no fragmentation carried over from one ECDH operation to the next.
+ */
+
 #include "btstack_config.h"
 
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
 
 #include "sm_mbedtls_allocator.h"
 #include "btstack_util.h"
-#include "btstack_debug.h" 
+#include "btstack_debug.h"
 
 #ifdef ENABLE_LE_SECURE_CONNECTIONS
 #ifdef HAVE_HCI_CONTROLLER_DHKEY_SUPPORT
@@ -59,320 +73,203 @@
 #include "mbedtls/config.h"
 
 #ifndef HAVE_MALLOC
-// #define DEBUG_ALLOCATIONS
-
-size_t mbed_memory_allocated_current;
-size_t mbed_memory_allocated_max;
-size_t mbed_memory_space_max;
-size_t mbed_memory_max;
-size_t mbed_memory_smallest_buffer = 0xfffffff;
-unsigned int mbed_memory_num_allocations;
 
-#define NUM_SIZES 150
-int current_individual_allocation[NUM_SIZES];
-int max_individual_allocation[NUM_SIZES];
-int max_total_allocation[NUM_SIZES];
+// free lists for blocks with 8, 16, .. (NUM_SIZE_CLASSES-1) * 8 bytes of data
+#ifndef SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES
+#define SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES 32
+#endif
 
-// customized allocator for use with BTstack's Security Manager
-// assumptions:
-// - allocations are multiple of 8
-// - smallest allocation is 8
+// block header stores size of block incl. header, keeps data aligned to pointer size
+#define SM_ALLOCATOR_HEADER_SIZE   sizeof(void *)
+#define SM_ALLOCATOR_LARGE_CLASS   0
 
-static uint32_t   sm_allocator_size;
 static uint8_t  * sm_allocator_buffer;
-static uint32_t   sm_allocator_used;
+static uint32_t   sm_allocator_size;
+static uint32_t   sm_allocator_bump;
 
-static sm_allocator_node_t * sm_mbedtls_node_for_offset(uint32_t offset){
-    if (offset > sm_allocator_size){
-        printf("Error! offset %u\n", offset);
-    }
-    return (sm_allocator_node_t *) (sm_allocator_buffer + offset);
+// offset of first free block per size class, 0 == empty. next offset is stored in free block
+static uint32_t   sm_allocator_free_lists[SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES];
+
+static int        sm_allocator_scope_active;
+static uint32_t   sm_allocator_scope_mark;
+static uint32_t   sm_allocator_scope_allocations;
+
+static sm_mbedtls_allocator_stats_t sm_allocator_stats;
+
+static inline uint32_t sm_allocator_block_size(uint32_t offset){
+    return *(uint32_t *) &sm_allocator_buffer[offset];
 }
 
-static void dump_allocations(void){
-    size_t overhead = mbed_memory_num_allocations * sizeof(void*); 
-    printf("SM Per Block - Summary: Allocations %u. Current %lu (+ %zu = %zu used), Max %lu.\n", 
-        mbed_memory_num_allocations, 
-        mbed_memory_allocated_current, overhead, mbed_memory_allocated_current + overhead,
-        mbed_memory_allocated_max);
-    int i;
-    unsigned int total = 0;
-    printf("- current    : [ ");
-    for (i=0;i<sizeof(current_individual_allocation) / sizeof(int);i++){
-        printf("%02u ", current_individual_allocation[i]);
-        total += current_individual_allocation[i] * i * 8;
-        if (i == 16) {
-            printf(" - ");
-            i = 40;
-        }
-        if (i == 46) {
-            printf(" - ");
-            i = 140;
-        }
-    }
-    printf(" = %u\n", total);
-    printf("- current max: [ ");
-    total = 0;
-    for (i=0;i<sizeof(max_individual_allocation) / sizeof(int);i++){
-        printf("%02u ", max_individual_allocation[i]);
-        total += max_individual_allocation[i] * i * 8;
-        if (i == 16) {
-            printf(" - ");
-            i = 40;
-        }
-        if (i == 46) {
-            printf(" - ");
-            i = 140;
-        }
-    }
-    printf(" = %u\n", total);
-    printf("- total   max: [ ");
-    total = 0;
-    for (i=0;i<sizeof(max_total_allocation) / sizeof(int);i++){
-        printf("%02u ", max_total_allocation[i]);
-        total += max_total_allocation[i] * i * 8;
-        if (i == 16) {
-            printf(" - ");
-            i = 40;
-        }
-        if (i == 46) {
-            printf(" - ");
-            i = 140;
-        }
-    }
-    printf(" = %u\n", total);
+static inline uint32_t * sm_allocator_block_next(uint32_t offset){
+    return (uint32_t *) &sm_allocator_buffer[offset + SM_ALLOCATOR_HEADER_SIZE];
 }
 
-void sm_mbedtls_allocator_status(void){
-#ifdef DEBUG_ALLOCATIONS
-    uint32_t current_pos = 0;
-    sm_allocator_node_t * current = sm_mbedtls_node_for_offset(current_pos);
-    int i = 1;
-    size_t bytes_free = 0;
-    printf("SM Status:\n");
-    while (1){
-        printf("- SM ALLOC: Free %u: pos %u, size %u, next %u\n", i++, current_pos, current->size, current->next);
-        bytes_free += current->size;
-        current_pos = current->next;
-        current = sm_mbedtls_node_for_offset(current_pos);
-        if (current_pos == 0) break;
-    }
-    size_t overhead = mbed_memory_num_allocations * sizeof(void*); 
-    printf("- Summary: Allocations %u. Current %lu (+ %zu = %zu used), Max %lu. Free %zu. Total: %zu\n", 
-        mbed_memory_num_allocations, 
-        mbed_memory_allocated_current, overhead, mbed_memory_allocated_current + overhead,
-        mbed_memory_allocated_max, bytes_free, bytes_free + mbed_memory_allocated_current + overhead );
+static inline int sm_allocator_size_class(uint32_t block_size){
+    uint32_t size_class = (block_size - SM_ALLOCATOR_HEADER_SIZE) / 8;
+    if (size_class >= SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES) return SM_ALLOCATOR_LARGE_CLASS;
+    return (int) size_class;
+}
 
-    dump_allocations();
-#endif
+static uint32_t sm_allocator_pop(int size_class){
+    uint32_t offset = sm_allocator_free_lists[size_class];
+    if (offset){
+        sm_allocator_free_lists[size_class] = *sm_allocator_block_next(offset);
+    }
+    return offset;
 }
 
-static inline void sm_mbedtls_allocator_update_max(){
-#if 1
-    uint32_t current_pos = 0;
-    sm_allocator_node_t * current = sm_mbedtls_node_for_offset(current_pos);
-    while (1){
-        if (current_pos + 8 > mbed_memory_space_max) {
-            mbed_memory_space_max = current_pos + 8;
-            printf("SM Alloc: space used %zu (%zu data + %u allocations)\n", mbed_memory_space_max, mbed_memory_allocated_current, mbed_memory_num_allocations);
+// first fit on list of large blocks
+static uint32_t sm_allocator_pop_large(uint32_t block_size){
+    uint32_t * link = &sm_allocator_free_lists[SM_ALLOCATOR_LARGE_CLASS];
+    while (*link){
+        uint32_t offset = *link;
+        if (sm_allocator_block_size(offset) >= block_size){
+            *link = *sm_allocator_block_next(offset);
+            return offset;
         }
-        current_pos = current->next;
-        current = sm_mbedtls_node_for_offset(current_pos);
-        if (current_pos == 0) break;
+        link = sm_allocator_block_next(offset);
     }
-#endif
+    return 0;
 }
 
+static uint32_t sm_allocator_get_block(uint32_t block_size){
+    int size_class = sm_allocator_size_class(block_size);
+    uint32_t offset;
 
-
-void * sm_mbedtls_allocator_calloc(size_t count, size_t size){
-    size_t num_bytes = count * size;
-    size_t total = num_bytes + sizeof(void *);
-    mbed_memory_allocated_current += num_bytes;
-    mbed_memory_smallest_buffer = btstack_min(mbed_memory_smallest_buffer, num_bytes);
-    mbed_memory_num_allocations++;
-
-    // printf("SM Alloc %zu bytes\n", num_bytes);
-
-    // if (num_bytes > 1000){
-    //     printf("big alloc!\n");
-    // }
-
-    int index = num_bytes / 8;
-    current_individual_allocation[index]++;
- 
-    if (current_individual_allocation[index] > max_individual_allocation[index]){
-        max_individual_allocation[index] = current_individual_allocation[index];
-        dump_allocations();
+    // same size
+    if (size_class == SM_ALLOCATOR_LARGE_CLASS){
+        offset = sm_allocator_pop_large(block_size);
+    } else {
+        offset = sm_allocator_pop(size_class);
     }
-    // mbed_memory_allocated_max   = btstack_max(mbed_memory_allocated_max, mbed_memory_allocated_current);
-    if (mbed_memory_allocated_current > mbed_memory_allocated_max){
-        memcpy(max_total_allocation, current_individual_allocation, sizeof(max_total_allocation));
-        mbed_memory_allocated_max = mbed_memory_allocated_current;
-        dump_allocations();
+    if (offset) return offset;
+
+    // bump
+    if (sm_allocator_bump + block_size <= sm_allocator_size){
+        offset = sm_allocator_bump;
+        sm_allocator_bump += block_size;
+        *(uint32_t *) &sm_allocator_buffer[offset] = block_size;
+        sm_allocator_stats.arena_used = sm_allocator_bump;
+        sm_allocator_stats.arena_max  = btstack_max(sm_allocator_stats.arena_max, sm_allocator_bump);
+        return offset;
     }
 
-    uint32_t prev_pos, current_pos, node_pos;
-    sm_allocator_node_t * prev, * current, * node;
-
-    // find exact block
-    prev_pos = 0;
-    prev    = sm_mbedtls_node_for_offset(prev_pos);
-    current_pos = prev->next;
-    while (current_pos){
-        current = sm_mbedtls_node_for_offset(current_pos);
-        if (current->size == total){
-            prev->next = current->next;
-            memset(current, 0, total);
-            *(uint32_t*)current = total;
-            sm_mbedtls_allocator_update_max();
-#ifdef DEBUG_ALLOCATIONS
-            printf("sm_mbedtls_allocator_calloc(%zu,%zu) = total %zu -> pos %u\n", count, size, total, current_pos);
-#endif
-            sm_mbedtls_allocator_status();
-            return &sm_allocator_buffer[current_pos + sizeof(void *)];
+    // larger free block
+    if (size_class != SM_ALLOCATOR_LARGE_CLASS){
+        int i;
+        for (i = size_class + 1; i < SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES; i++){
+            offset = sm_allocator_pop(i);
+            if (offset) return offset;
         }
-        // next
-        prev = current;
-        prev_pos = current_pos;
-        current_pos = current->next;
+        offset = sm_allocator_pop_large(block_size);
     }
-    // find first large enough block
-    prev_pos = 0;
-    prev    = sm_mbedtls_node_for_offset(prev_pos);
-    current_pos = prev->next;
-    while (current_pos){
-        current = sm_mbedtls_node_for_offset(current_pos);
-        if (current->size > total){
-#ifdef DEBUG_ALLOCATIONS
-            printf("sm_mbedtls_allocator_calloc splitting block at %u, size %u (prev %u)\n", current_pos, current->size, prev_pos);
-#endif
-            node_pos = current_pos + total;
-            node = sm_mbedtls_node_for_offset(node_pos);
-            node->next = current->next;
-            node->size = current->size - total;
-#ifdef DEBUG_ALLOCATIONS
-            printf("sm_mbedtls_allocator_calloc new block at %u, size %u\n", node_pos, node->size);
-#endif
-            prev->next = node_pos;
-            memset(current, 0, total);
-            *(uint32_t*)current = total;
-            sm_mbedtls_allocator_update_max();
-#ifdef DEBUG_ALLOCATIONS
-            printf("sm_mbedtls_allocator_calloc(%zu,%zu) = total %zu -> pos %u\n", count, size, total, current_pos);
-#endif
-            sm_mbedtls_allocator_status();
-            return &sm_allocator_buffer[current_pos + sizeof(void *)];
-        }
-        // next
-        prev = current;
-        prev_pos = current_pos;
-        current_pos = current->next;
+    return offset;
+}
+
+void * sm_mbedtls_allocator_calloc(size_t count, size_t size){
+    size_t num_bytes = count * size;
+    // round up to multiple of 8, at least 8 to store free list link
+    uint32_t block_size = SM_ALLOCATOR_HEADER_SIZE + (btstack_max(num_bytes, 1) + 7) / 8 * 8;
+
+    uint32_t offset = sm_allocator_get_block(block_size);
+    if (!offset){
+        sm_allocator_stats.allocations_failed++;
+        log_error("sm_mbedtls_allocator_calloc error, no free chunk found to allocate %u bytes", (unsigned int) num_bytes);
+        return NULL;
     }
 
-#ifdef DEBUG_ALLOCATIONS
-    // failed to allocate
-    printf("sm_mbedtls_allocator_calloc error, no free chunk found!\n");
-    exit(10);
-#else
-    log_error("sm_mbedtls_allocator_calloc error, no free chunk found to allocate %zu bytes\n", total);
-    return 0;
-#endif
+    if (sm_allocator_scope_active && offset >= sm_allocator_scope_mark){
+        sm_allocator_scope_allocations++;
+    }
+    uint32_t data_size = sm_allocator_block_size(offset) - SM_ALLOCATOR_HEADER_SIZE;
+    sm_allocator_stats.bytes_current += data_size;
+    sm_allocator_stats.bytes_max = btstack_max(sm_allocator_stats.bytes_max, sm_allocator_stats.bytes_current);
+    sm_allocator_stats.allocations_current++;
+    sm_allocator_stats.allocations_total++;
+
+    void * data = &sm_allocator_buffer[offset + SM_ALLOCATOR_HEADER_SIZE];
+    memset(data, 0, data_size);
+    return data;
 }
 
 void sm_mbedtls_allocator_free(void * data){
-    uint32_t prev_pos, current_pos, next_pos;
-    sm_allocator_node_t * current, * prev, * next;
-    current = (sm_allocator_node_t*) (((uint8_t *) data) - sizeof(void *));
-    current_pos = ((uint8_t *) current) - ((uint8_t *) sm_allocator_buffer);
-    size_t total = *(uint32_t*) current;
-    size_t num_bytes = total - sizeof(void *);
-    mbed_memory_allocated_current -= num_bytes;
-    mbed_memory_num_allocations--;
-  
-    int index = num_bytes / 8;
-    current_individual_allocation[index]--;
-
-    // printf("SM Free %zu bytes\n", num_bytes);
- 
-
-#ifdef DEBUG_ALLOCATIONS
-    printf("sm_mbedtls_allocator_free: pos %u, total %zu\n", current_pos, total);
-#endif
-    // find previous node
-    prev_pos = 0;
-    prev = sm_mbedtls_node_for_offset(prev_pos);
-    while (prev->next < current_pos){
-        prev_pos = prev->next;
-        prev = sm_mbedtls_node_for_offset(prev_pos);
+    if (!data) return;
+    uint32_t offset = ((uint8_t *) data) - sm_allocator_buffer - SM_ALLOCATOR_HEADER_SIZE;
+    uint32_t block_size = sm_allocator_block_size(offset);
+
+    if (sm_allocator_scope_active && offset >= sm_allocator_scope_mark){
+        sm_allocator_scope_allocations--;
     }
+    sm_allocator_stats.bytes_current -= block_size - SM_ALLOCATOR_HEADER_SIZE;
+    sm_allocator_stats.allocations_current--;
+
+    // last block, return to arena
+    if (offset + block_size == sm_allocator_bump){
+        sm_allocator_bump = offset;
+        sm_allocator_stats.arena_used = sm_allocator_bump;
+        return;
+    }
+
+    int size_class = sm_allocator_size_class(block_size);
+    *sm_allocator_block_next(offset) = sm_allocator_free_lists[size_class];
+    sm_allocator_free_lists[size_class] = offset;
+}
 
-    // setup new node
-    current->next = prev->next;
-    current->size = total;
-    prev->next = current_pos;
+void sm_mbedtls_allocator_scope_begin(void){
+    sm_allocator_scope_active = 1;
+    sm_allocator_scope_mark = sm_allocator_bump;
+    sm_allocator_scope_allocations = 0;
+}
 
-    // merge with previous ?
-#ifdef DEBUG_ALLOCATIONS
-    printf("sm_mbedtls_allocator_free: prev %u, %u\n", prev_pos, prev->size);
-#endif
-    if (prev_pos + prev->size == current_pos){
-#ifdef DEBUG_ALLOCATIONS
-        printf("sm_mbedtls_allocator_free: merge with previous\n");
-#endif
-        prev->size += current->size;
-        prev->next  = current->next;
-        current = prev;
-        current_pos = prev_pos;
+void sm_mbedtls_allocator_scope_end(void){
+    if (!sm_allocator_scope_active) return;
+    sm_allocator_scope_active = 0;
+    if (sm_allocator_scope_allocations){
+        // e.g. cached comb table in ecp group
+        log_info("sm_mbedtls_allocator: %u blocks still allocated, keep arena", (unsigned int) sm_allocator_scope_allocations);
+        return;
     }
-
-    // merge with next node?
-    next_pos = current->next;
-    if (current_pos + current->size == next_pos){
-        next = sm_mbedtls_node_for_offset(next_pos);
-#ifdef DEBUG_ALLOCATIONS
-        printf("sm_mbedtls_allocator_free: merge with next at pos %u, size %u\n", next_pos, next->size);
-#endif
-        current->size += next->size;
-        current->next  = next->next;
+    // drop all free blocks above mark and reset bump offset
+    int i;
+    for (i = 0; i < SM_MBEDTLS_ALLOCATOR_NUM_SIZE_CLASSES; i++){
+        uint32_t * link = &sm_allocator_free_lists[i];
+        while (*link){
+            if (*link >= sm_allocator_scope_mark){
+                *link = *sm_allocator_block_next(*link);
+            } else {
+                link = sm_allocator_block_next(*link);
+            }
+        }
     }
-    sm_mbedtls_allocator_status();
+    sm_allocator_bump = sm_allocator_scope_mark;
+    sm_allocator_stats.arena_used = sm_allocator_bump;
 }
 
-void sm_mbedtls_allocator_init(uint8_t * buffer, uint32_t size){
-    sm_allocator_buffer = buffer;
-    sm_allocator_size = size;
-    sm_allocator_node_t * anchor = sm_mbedtls_node_for_offset(0);
-    anchor->next = sizeof(sm_allocator_node_t);
-    anchor->size = 0;
-    sm_allocator_node_t * first = sm_mbedtls_node_for_offset(anchor->next);
-    first->next = 0;
-    first->size = size - sizeof(sm_allocator_node_t);
-    sm_allocator_used = 2 * sizeof(sm_allocator_node_t);
-    sm_mbedtls_allocator_status();
+void sm_mbedtls_allocator_get_stats(sm_mbedtls_allocator_stats_t * stats){
+    *stats = sm_allocator_stats;
 }
 
-#if 0
-void * sm_mbedtls_allocator_calloc(size_t count, size_t size){
-    size_t total = count * size;
-    mbed_memory_allocated_current += total;
-    mbed_memory_allocated_max = btstack_max(mbed_memory_allocated_max, mbed_memory_allocated_current);
-    mbed_memory_smallest_buffer = btstack_min(mbed_memory_smallest_buffer, total);
-    mbed_memory_num_allocations++;
-    void * result = calloc(4 + total, 1);
-    *(uint32_t*) result = total;    
-    printf("sm_mbedtls_allocator_calloc(%zu, %zu) -> res %p. Total %lu, Max %lu, Smallest %lu, Count %u\n", count, size, result, mbed_memory_allocated_current, mbed_memory_allocated_max, mbed_memory_smallest_buffer, mbed_memory_num_allocations);
-    return ((uint8_t *) result) + 4;
+void sm_mbedtls_allocator_status(void){
+    log_info("sm_mbedtls_allocator: %u allocations (%u total, %u failed), %u bytes (max %u), arena %u of %u bytes (max %u)",
+        (unsigned int) sm_allocator_stats.allocations_current, (unsigned int) sm_allocator_stats.allocations_total,
+        (unsigned int) sm_allocator_stats.allocations_failed,
+        (unsigned int) sm_allocator_stats.bytes_current, (unsigned int) sm_allocator_stats.bytes_max,
+        (unsigned int) sm_allocator_stats.arena_used, (unsigned int) sm_allocator_stats.arena_size,
+        (unsigned int) sm_allocator_stats.arena_max);
 }
 
-void sm_mbedtls_allocator_free(void * data){
-    void * orig = ((uint8_t *) data) - 4;
-    size_t total = *(uint32_t *)orig;
-    mbed_memory_allocated_current -= total;
-    mbed_memory_num_allocations--;
-    printf("sm_mbedtls_allocator_free(%p) - %zu bytes. Total %lu, Count %u\n", data, total, mbed_memory_allocated_current, mbed_memory_num_allocations);
-    free(orig);
+void sm_mbedtls_allocator_init(uint8_t * buffer, uint32_t size){
+    sm_allocator_buffer = buffer;
+    sm_allocator_size   = size;
+    // offset 0 marks empty free list
+    sm_allocator_bump   = SM_ALLOCATOR_HEADER_SIZE;
+    sm_allocator_scope_active = 0;
+    memset(sm_allocator_free_lists, 0, sizeof(sm_allocator_free_lists));
+    memset(&sm_allocator_stats, 0, sizeof(sm_allocator_stats));
+    sm_allocator_stats.arena_size = size;
+    sm_allocator_stats.arena_used = sm_allocator_bump;
+    sm_allocator_stats.arena_max  = sm_allocator_bump;
 }
-#endif
+
 #endif
 #endif
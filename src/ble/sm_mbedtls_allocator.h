@@ -45,14 +45,45 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 
-typedef struct sm_allocator_node {
-    uint32_t next;  // offset from sm_allocator_buffer, 0 == last item
-    uint32_t size;  // size of free chunk incl. header
-} sm_allocator_node_t;
+typedef struct {
+    uint32_t bytes_current;         // data of allocated blocks
+    uint32_t bytes_max;
+    uint32_t arena_used;            // incl. block headers and blocks on free lists
+    uint32_t arena_max;
+    uint32_t arena_size;
+    uint32_t allocations_current;
+    uint32_t allocations_total;
+    uint32_t allocations_failed;
+} sm_mbedtls_allocator_stats_t;
 
+/**
+ * @brief Init allocator with memory buffer
+ * @param buffer
+ * @param size
+ */
 void sm_mbedtls_allocator_init(uint8_t * buffer, uint32_t size);
+
+/**
+ * @brief Log usage statistics
+ */
 void sm_mbedtls_allocator_status(void);
 
+/**
+ * @brief Get usage statistics
+ * @param stats
+ */
+void sm_mbedtls_allocator_get_stats(sm_mbedtls_allocator_stats_t * stats);
+
+/**
+ * @brief Start single ECDH operation
+ */
+void sm_mbedtls_allocator_scope_begin(void);
+
+/**
+ * @brief End ECDH operation. If all blocks allocated since scope begin were freed, they're released at once
+ */
+void sm_mbedtls_allocator_scope_end(void);
+
 void * sm_mbedtls_allocator_calloc(size_t count, size_t size);
 void   sm_mbedtls_allocator_free(void * data);
 
@@ -60,4 +91,4 @@ void   sm_mbedtls_allocator_free(void * data);
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif // __SM_MBEDTLS_ALLOCATOR_H
@@ -662,6 +662,7 @@ typedef enum {
 #define L2CAP_CID_SECURITY_MANAGER_PROTOCOL 0x0006
 
 // L2CAP Configuration Result Codes
+#define L2CAP_CONF_RESULT_UNACCEPTABLE_PARAMETERS 0x0001
 #define L2CAP_CONF_RESULT_UNKNOWN_OPTIONS   0x0003
 
 // L2CAP Reject Result Codes
@@ -57,10 +57,18 @@
 // packet handler
 typedef void (*btstack_packet_handler_t) (uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
 
+// event mask: one bit per event code and one bit per LE Meta subevent
+typedef struct {
+    uint8_t events[32];
+    uint8_t le_subevents[32];
+} btstack_event_mask_t;
+
 // packet callback supporting multiple registrations
 typedef struct {
     btstack_linked_item_t    item;
     btstack_packet_handler_t callback;
+    // optional: only events in mask are delivered, NULL for all events
+    const btstack_event_mask_t * event_mask;
 } btstack_packet_callback_registration_t;
 
 // context callback supporting multiple registrations
@@ -610,6 +618,17 @@ typedef uint8_t sm_key_t[16];
  */
 #define SDP_EVENT_QUERY_SERVICE_RECORD_HANDLE                    0x95
 
+/**
+ * @format 2222LV
+ * @param record_id
+ * @param attribute_id
+ * @param attribute_length
+ * @param data_offset
+ * @param data_len
+ * @param data
+ */
+#define SDP_EVENT_QUERY_ATTRIBUTE_DATA                           0x96
+
 /**
  * @format H1
  * @param handle
@@ -955,6 +974,13 @@ typedef uint8_t sm_key_t[16];
  */
 #define GAP_EVENT_INQUIRY_COMPLETE                            0xE4
 
+/**
+ * @brief Advertising reports processed by LE Scan Engine, use le_scan_report_iterator_* to access reports
+ * @format 1
+ * @param num_reports
+ */
+#define GAP_EVENT_ADVERTISING_REPORT_BATCH                    0xE5
+
 
 // Meta Events, see below for sub events
 #define HCI_EVENT_HSP_META                                 0xE8
@@ -1718,6 +1718,61 @@ static inline uint32_t sdp_event_query_service_record_handle_get_record_handle(c
     return little_endian_read_32(event, 6);
 }
 
+/**
+ * @brief Get field record_id from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return record_id
+ * @note: btstack_type 2
+ */
+static inline uint16_t sdp_event_query_attribute_data_get_record_id(const uint8_t * event){
+    return little_endian_read_16(event, 2);
+}
+/**
+ * @brief Get field attribute_id from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return attribute_id
+ * @note: btstack_type 2
+ */
+static inline uint16_t sdp_event_query_attribute_data_get_attribute_id(const uint8_t * event){
+    return little_endian_read_16(event, 4);
+}
+/**
+ * @brief Get field attribute_length from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return attribute_length
+ * @note: btstack_type 2
+ */
+static inline uint16_t sdp_event_query_attribute_data_get_attribute_length(const uint8_t * event){
+    return little_endian_read_16(event, 6);
+}
+/**
+ * @brief Get field data_offset from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return data_offset
+ * @note: btstack_type 2
+ */
+static inline uint16_t sdp_event_query_attribute_data_get_data_offset(const uint8_t * event){
+    return little_endian_read_16(event, 8);
+}
+/**
+ * @brief Get field data_len from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return data_len
+ * @note: btstack_type L
+ */
+static inline int sdp_event_query_attribute_data_get_data_len(const uint8_t * event){
+    return little_endian_read_16(event, 10);
+}
+/**
+ * @brief Get field data from event SDP_EVENT_QUERY_ATTRIBUTE_DATA
+ * @param event packet
+ * @return data
+ * @note: btstack_type V
+ */
+static inline const uint8_t * sdp_event_query_attribute_data_get_data(const uint8_t * event){
+    return &event[12];
+}
+
 #ifdef ENABLE_BLE
 /**
  * @brief Get field handle from event GATT_EVENT_QUERY_COMPLETE
@@ -3036,6 +3091,16 @@ static inline uint8_t gap_event_inquiry_complete_get_status(const uint8_t * even
     return event[2];
 }
 
+/**
+ * @brief Get field num_reports from event GAP_EVENT_ADVERTISING_REPORT_BATCH
+ * @param event packet
+ * @return num_reports
+ * @note: btstack_type 1
+ */
+static inline uint8_t gap_event_advertising_report_batch_get_num_reports(const uint8_t * event){
+    return event[2];
+}
+
 /**
  * @brief Get field status from event HCI_SUBEVENT_LE_CONNECTION_COMPLETE
  * @param event packet
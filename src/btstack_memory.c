@@ -35,6 +35,7 @@
  *
  */
 
+
 #define __BTSTACK_FILE__ "btstack_memory.c"
 
 
@@ -49,9 +50,66 @@
 
 #include "btstack_memory.h"
 #include "btstack_memory_pool.h"
+#include "btstack_debug.h"
 
 #include <stdlib.h>
 
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+#include "btstack_run_loop.h"
+
+#ifdef __GNUC__
+#define BTSTACK_MEMORY_CALL_SITE __builtin_return_address(0)
+#else
+#define BTSTACK_MEMORY_CALL_SITE NULL
+#endif
+
+static btstack_memory_trace_entry_t btstack_memory_trace_entries[MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+static uint16_t btstack_memory_trace_index;
+static uint16_t btstack_memory_trace_num_entries;
+
+static void btstack_memory_trace_add(const char * type, btstack_memory_trace_operation_t operation, void * block, void * call_site){
+    btstack_memory_trace_entry_t * entry = &btstack_memory_trace_entries[btstack_memory_trace_index];
+    entry->timestamp_ms = btstack_run_loop_get_time_ms();
+    entry->type = type;
+    entry->block = block;
+    entry->call_site = call_site;
+    entry->operation = operation;
+    btstack_memory_trace_index++;
+    if (btstack_memory_trace_index == MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES){
+        btstack_memory_trace_index = 0;
+    }
+    if (btstack_memory_trace_num_entries < MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES){
+        btstack_memory_trace_num_entries++;
+    }
+}
+
+// macro to capture return address in the public get/free function itself
+#define BTSTACK_MEMORY_TRACE(type, operation, block) btstack_memory_trace_add(type, operation, block, BTSTACK_MEMORY_CALL_SITE)
+#else
+#define BTSTACK_MEMORY_TRACE(type, operation, block)
+#endif
+
+#ifdef HAVE_MALLOC
+static void * btstack_memory_malloc(btstack_memory_pool_stats_t * stats, size_t size){
+    void * buffer = malloc(size);
+    if (!buffer){
+        stats->num_allocation_failures++;
+        return NULL;
+    }
+    stats->num_used++;
+    if (stats->num_used > stats->max_num_used){
+        stats->max_num_used = stats->num_used;
+    }
+    return buffer;
+}
+
+static void btstack_memory_free(btstack_memory_pool_stats_t * stats, void * buffer){
+    if (!buffer) return;
+    stats->num_used--;
+    free(buffer);
+}
+#endif
+
 
 
 // MARK: hci_connection_t
@@ -66,11 +124,15 @@
 #ifdef MAX_NR_HCI_CONNECTIONS
 #if MAX_NR_HCI_CONNECTIONS > 0
 static hci_connection_t hci_connection_storage[MAX_NR_HCI_CONNECTIONS];
+static uint8_t hci_connection_used_blocks[(MAX_NR_HCI_CONNECTIONS + 7) / 8];
 static btstack_memory_pool_t hci_connection_pool;
 hci_connection_t * btstack_memory_hci_connection_get(void){
-    return (hci_connection_t *) btstack_memory_pool_get(&hci_connection_pool);
+    hci_connection_t * hci_connection = (hci_connection_t *) btstack_memory_pool_get(&hci_connection_pool);
+    BTSTACK_MEMORY_TRACE("hci_connection", BTSTACK_MEMORY_TRACE_GET, hci_connection);
+    return hci_connection;
 }
 void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
+    BTSTACK_MEMORY_TRACE("hci_connection", BTSTACK_MEMORY_TRACE_FREE, hci_connection);
     btstack_memory_pool_free(&hci_connection_pool, hci_connection);
 }
 #else
@@ -83,11 +145,15 @@ void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t hci_connection_stats = { "hci_connection", 0, 0, 0, 0 };
 hci_connection_t * btstack_memory_hci_connection_get(void){
-    return (hci_connection_t*) malloc(sizeof(hci_connection_t));
+    hci_connection_t * hci_connection = (hci_connection_t*) btstack_memory_malloc(&hci_connection_stats, sizeof(hci_connection_t));
+    BTSTACK_MEMORY_TRACE("hci_connection", BTSTACK_MEMORY_TRACE_GET, hci_connection);
+    return hci_connection;
 }
 void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
-    free(hci_connection);
+    BTSTACK_MEMORY_TRACE("hci_connection", BTSTACK_MEMORY_TRACE_FREE, hci_connection);
+    btstack_memory_free(&hci_connection_stats, hci_connection);
 }
 #endif
 
@@ -105,11 +171,15 @@ void btstack_memory_hci_connection_free(hci_connection_t *hci_connection){
 #ifdef MAX_NR_L2CAP_SERVICES
 #if MAX_NR_L2CAP_SERVICES > 0
 static l2cap_service_t l2cap_service_storage[MAX_NR_L2CAP_SERVICES];
+static uint8_t l2cap_service_used_blocks[(MAX_NR_L2CAP_SERVICES + 7) / 8];
 static btstack_memory_pool_t l2cap_service_pool;
 l2cap_service_t * btstack_memory_l2cap_service_get(void){
-    return (l2cap_service_t *) btstack_memory_pool_get(&l2cap_service_pool);
+    l2cap_service_t * l2cap_service = (l2cap_service_t *) btstack_memory_pool_get(&l2cap_service_pool);
+    BTSTACK_MEMORY_TRACE("l2cap_service", BTSTACK_MEMORY_TRACE_GET, l2cap_service);
+    return l2cap_service;
 }
 void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
+    BTSTACK_MEMORY_TRACE("l2cap_service", BTSTACK_MEMORY_TRACE_FREE, l2cap_service);
     btstack_memory_pool_free(&l2cap_service_pool, l2cap_service);
 }
 #else
@@ -122,11 +192,15 @@ void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t l2cap_service_stats = { "l2cap_service", 0, 0, 0, 0 };
 l2cap_service_t * btstack_memory_l2cap_service_get(void){
-    return (l2cap_service_t*) malloc(sizeof(l2cap_service_t));
+    l2cap_service_t * l2cap_service = (l2cap_service_t*) btstack_memory_malloc(&l2cap_service_stats, sizeof(l2cap_service_t));
+    BTSTACK_MEMORY_TRACE("l2cap_service", BTSTACK_MEMORY_TRACE_GET, l2cap_service);
+    return l2cap_service;
 }
 void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
-    free(l2cap_service);
+    BTSTACK_MEMORY_TRACE("l2cap_service", BTSTACK_MEMORY_TRACE_FREE, l2cap_service);
+    btstack_memory_free(&l2cap_service_stats, l2cap_service);
 }
 #endif
 
@@ -143,11 +217,15 @@ void btstack_memory_l2cap_service_free(l2cap_service_t *l2cap_service){
 #ifdef MAX_NR_L2CAP_CHANNELS
 #if MAX_NR_L2CAP_CHANNELS > 0
 static l2cap_channel_t l2cap_channel_storage[MAX_NR_L2CAP_CHANNELS];
+static uint8_t l2cap_channel_used_blocks[(MAX_NR_L2CAP_CHANNELS + 7) / 8];
 static btstack_memory_pool_t l2cap_channel_pool;
 l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
-    return (l2cap_channel_t *) btstack_memory_pool_get(&l2cap_channel_pool);
+    l2cap_channel_t * l2cap_channel = (l2cap_channel_t *) btstack_memory_pool_get(&l2cap_channel_pool);
+    BTSTACK_MEMORY_TRACE("l2cap_channel", BTSTACK_MEMORY_TRACE_GET, l2cap_channel);
+    return l2cap_channel;
 }
 void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
+    BTSTACK_MEMORY_TRACE("l2cap_channel", BTSTACK_MEMORY_TRACE_FREE, l2cap_channel);
     btstack_memory_pool_free(&l2cap_channel_pool, l2cap_channel);
 }
 #else
@@ -160,11 +238,15 @@ void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t l2cap_channel_stats = { "l2cap_channel", 0, 0, 0, 0 };
 l2cap_channel_t * btstack_memory_l2cap_channel_get(void){
-    return (l2cap_channel_t*) malloc(sizeof(l2cap_channel_t));
+    l2cap_channel_t * l2cap_channel = (l2cap_channel_t*) btstack_memory_malloc(&l2cap_channel_stats, sizeof(l2cap_channel_t));
+    BTSTACK_MEMORY_TRACE("l2cap_channel", BTSTACK_MEMORY_TRACE_GET, l2cap_channel);
+    return l2cap_channel;
 }
 void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
-    free(l2cap_channel);
+    BTSTACK_MEMORY_TRACE("l2cap_channel", BTSTACK_MEMORY_TRACE_FREE, l2cap_channel);
+    btstack_memory_free(&l2cap_channel_stats, l2cap_channel);
 }
 #endif
 
@@ -182,11 +264,15 @@ void btstack_memory_l2cap_channel_free(l2cap_channel_t *l2cap_channel){
 #ifdef MAX_NR_RFCOMM_MULTIPLEXERS
 #if MAX_NR_RFCOMM_MULTIPLEXERS > 0
 static rfcomm_multiplexer_t rfcomm_multiplexer_storage[MAX_NR_RFCOMM_MULTIPLEXERS];
+static uint8_t rfcomm_multiplexer_used_blocks[(MAX_NR_RFCOMM_MULTIPLEXERS + 7) / 8];
 static btstack_memory_pool_t rfcomm_multiplexer_pool;
 rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void){
-    return (rfcomm_multiplexer_t *) btstack_memory_pool_get(&rfcomm_multiplexer_pool);
+    rfcomm_multiplexer_t * rfcomm_multiplexer = (rfcomm_multiplexer_t *) btstack_memory_pool_get(&rfcomm_multiplexer_pool);
+    BTSTACK_MEMORY_TRACE("rfcomm_multiplexer", BTSTACK_MEMORY_TRACE_GET, rfcomm_multiplexer);
+    return rfcomm_multiplexer;
 }
 void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multiplexer){
+    BTSTACK_MEMORY_TRACE("rfcomm_multiplexer", BTSTACK_MEMORY_TRACE_FREE, rfcomm_multiplexer);
     btstack_memory_pool_free(&rfcomm_multiplexer_pool, rfcomm_multiplexer);
 }
 #else
@@ -199,11 +285,15 @@ void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multipl
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t rfcomm_multiplexer_stats = { "rfcomm_multiplexer", 0, 0, 0, 0 };
 rfcomm_multiplexer_t * btstack_memory_rfcomm_multiplexer_get(void){
-    return (rfcomm_multiplexer_t*) malloc(sizeof(rfcomm_multiplexer_t));
+    rfcomm_multiplexer_t * rfcomm_multiplexer = (rfcomm_multiplexer_t*) btstack_memory_malloc(&rfcomm_multiplexer_stats, sizeof(rfcomm_multiplexer_t));
+    BTSTACK_MEMORY_TRACE("rfcomm_multiplexer", BTSTACK_MEMORY_TRACE_GET, rfcomm_multiplexer);
+    return rfcomm_multiplexer;
 }
 void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multiplexer){
-    free(rfcomm_multiplexer);
+    BTSTACK_MEMORY_TRACE("rfcomm_multiplexer", BTSTACK_MEMORY_TRACE_FREE, rfcomm_multiplexer);
+    btstack_memory_free(&rfcomm_multiplexer_stats, rfcomm_multiplexer);
 }
 #endif
 
@@ -220,11 +310,15 @@ void btstack_memory_rfcomm_multiplexer_free(rfcomm_multiplexer_t *rfcomm_multipl
 #ifdef MAX_NR_RFCOMM_SERVICES
 #if MAX_NR_RFCOMM_SERVICES > 0
 static rfcomm_service_t rfcomm_service_storage[MAX_NR_RFCOMM_SERVICES];
+static uint8_t rfcomm_service_used_blocks[(MAX_NR_RFCOMM_SERVICES + 7) / 8];
 static btstack_memory_pool_t rfcomm_service_pool;
 rfcomm_service_t * btstack_memory_rfcomm_service_get(void){
-    return (rfcomm_service_t *) btstack_memory_pool_get(&rfcomm_service_pool);
+    rfcomm_service_t * rfcomm_service = (rfcomm_service_t *) btstack_memory_pool_get(&rfcomm_service_pool);
+    BTSTACK_MEMORY_TRACE("rfcomm_service", BTSTACK_MEMORY_TRACE_GET, rfcomm_service);
+    return rfcomm_service;
 }
 void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
+    BTSTACK_MEMORY_TRACE("rfcomm_service", BTSTACK_MEMORY_TRACE_FREE, rfcomm_service);
     btstack_memory_pool_free(&rfcomm_service_pool, rfcomm_service);
 }
 #else
@@ -237,11 +331,15 @@ void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t rfcomm_service_stats = { "rfcomm_service", 0, 0, 0, 0 };
 rfcomm_service_t * btstack_memory_rfcomm_service_get(void){
-    return (rfcomm_service_t*) malloc(sizeof(rfcomm_service_t));
+    rfcomm_service_t * rfcomm_service = (rfcomm_service_t*) btstack_memory_malloc(&rfcomm_service_stats, sizeof(rfcomm_service_t));
+    BTSTACK_MEMORY_TRACE("rfcomm_service", BTSTACK_MEMORY_TRACE_GET, rfcomm_service);
+    return rfcomm_service;
 }
 void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
-    free(rfcomm_service);
+    BTSTACK_MEMORY_TRACE("rfcomm_service", BTSTACK_MEMORY_TRACE_FREE, rfcomm_service);
+    btstack_memory_free(&rfcomm_service_stats, rfcomm_service);
 }
 #endif
 
@@ -258,11 +356,15 @@ void btstack_memory_rfcomm_service_free(rfcomm_service_t *rfcomm_service){
 #ifdef MAX_NR_RFCOMM_CHANNELS
 #if MAX_NR_RFCOMM_CHANNELS > 0
 static rfcomm_channel_t rfcomm_channel_storage[MAX_NR_RFCOMM_CHANNELS];
+static uint8_t rfcomm_channel_used_blocks[(MAX_NR_RFCOMM_CHANNELS + 7) / 8];
 static btstack_memory_pool_t rfcomm_channel_pool;
 rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
-    return (rfcomm_channel_t *) btstack_memory_pool_get(&rfcomm_channel_pool);
+    rfcomm_channel_t * rfcomm_channel = (rfcomm_channel_t *) btstack_memory_pool_get(&rfcomm_channel_pool);
+    BTSTACK_MEMORY_TRACE("rfcomm_channel", BTSTACK_MEMORY_TRACE_GET, rfcomm_channel);
+    return rfcomm_channel;
 }
 void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
+    BTSTACK_MEMORY_TRACE("rfcomm_channel", BTSTACK_MEMORY_TRACE_FREE, rfcomm_channel);
     btstack_memory_pool_free(&rfcomm_channel_pool, rfcomm_channel);
 }
 #else
@@ -275,11 +377,15 @@ void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t rfcomm_channel_stats = { "rfcomm_channel", 0, 0, 0, 0 };
 rfcomm_channel_t * btstack_memory_rfcomm_channel_get(void){
-    return (rfcomm_channel_t*) malloc(sizeof(rfcomm_channel_t));
+    rfcomm_channel_t * rfcomm_channel = (rfcomm_channel_t*) btstack_memory_malloc(&rfcomm_channel_stats, sizeof(rfcomm_channel_t));
+    BTSTACK_MEMORY_TRACE("rfcomm_channel", BTSTACK_MEMORY_TRACE_GET, rfcomm_channel);
+    return rfcomm_channel;
 }
 void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
-    free(rfcomm_channel);
+    BTSTACK_MEMORY_TRACE("rfcomm_channel", BTSTACK_MEMORY_TRACE_FREE, rfcomm_channel);
+    btstack_memory_free(&rfcomm_channel_stats, rfcomm_channel);
 }
 #endif
 
@@ -297,11 +403,15 @@ void btstack_memory_rfcomm_channel_free(rfcomm_channel_t *rfcomm_channel){
 #ifdef MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES
 #if MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES > 0
 static btstack_link_key_db_memory_entry_t btstack_link_key_db_memory_entry_storage[MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES];
+static uint8_t btstack_link_key_db_memory_entry_used_blocks[(MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES + 7) / 8];
 static btstack_memory_pool_t btstack_link_key_db_memory_entry_pool;
 btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_entry_get(void){
-    return (btstack_link_key_db_memory_entry_t *) btstack_memory_pool_get(&btstack_link_key_db_memory_entry_pool);
+    btstack_link_key_db_memory_entry_t * btstack_link_key_db_memory_entry = (btstack_link_key_db_memory_entry_t *) btstack_memory_pool_get(&btstack_link_key_db_memory_entry_pool);
+    BTSTACK_MEMORY_TRACE("btstack_link_key_db_memory_entry", BTSTACK_MEMORY_TRACE_GET, btstack_link_key_db_memory_entry);
+    return btstack_link_key_db_memory_entry;
 }
 void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_memory_entry_t *btstack_link_key_db_memory_entry){
+    BTSTACK_MEMORY_TRACE("btstack_link_key_db_memory_entry", BTSTACK_MEMORY_TRACE_FREE, btstack_link_key_db_memory_entry);
     btstack_memory_pool_free(&btstack_link_key_db_memory_entry_pool, btstack_link_key_db_memory_entry);
 }
 #else
@@ -314,11 +424,15 @@ void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_me
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t btstack_link_key_db_memory_entry_stats = { "btstack_link_key_db_memory_entry", 0, 0, 0, 0 };
 btstack_link_key_db_memory_entry_t * btstack_memory_btstack_link_key_db_memory_entry_get(void){
-    return (btstack_link_key_db_memory_entry_t*) malloc(sizeof(btstack_link_key_db_memory_entry_t));
+    btstack_link_key_db_memory_entry_t * btstack_link_key_db_memory_entry = (btstack_link_key_db_memory_entry_t*) btstack_memory_malloc(&btstack_link_key_db_memory_entry_stats, sizeof(btstack_link_key_db_memory_entry_t));
+    BTSTACK_MEMORY_TRACE("btstack_link_key_db_memory_entry", BTSTACK_MEMORY_TRACE_GET, btstack_link_key_db_memory_entry);
+    return btstack_link_key_db_memory_entry;
 }
 void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_memory_entry_t *btstack_link_key_db_memory_entry){
-    free(btstack_link_key_db_memory_entry);
+    BTSTACK_MEMORY_TRACE("btstack_link_key_db_memory_entry", BTSTACK_MEMORY_TRACE_FREE, btstack_link_key_db_memory_entry);
+    btstack_memory_free(&btstack_link_key_db_memory_entry_stats, btstack_link_key_db_memory_entry);
 }
 #endif
 
@@ -336,11 +450,15 @@ void btstack_memory_btstack_link_key_db_memory_entry_free(btstack_link_key_db_me
 #ifdef MAX_NR_BNEP_SERVICES
 #if MAX_NR_BNEP_SERVICES > 0
 static bnep_service_t bnep_service_storage[MAX_NR_BNEP_SERVICES];
+static uint8_t bnep_service_used_blocks[(MAX_NR_BNEP_SERVICES + 7) / 8];
 static btstack_memory_pool_t bnep_service_pool;
 bnep_service_t * btstack_memory_bnep_service_get(void){
-    return (bnep_service_t *) btstack_memory_pool_get(&bnep_service_pool);
+    bnep_service_t * bnep_service = (bnep_service_t *) btstack_memory_pool_get(&bnep_service_pool);
+    BTSTACK_MEMORY_TRACE("bnep_service", BTSTACK_MEMORY_TRACE_GET, bnep_service);
+    return bnep_service;
 }
 void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
+    BTSTACK_MEMORY_TRACE("bnep_service", BTSTACK_MEMORY_TRACE_FREE, bnep_service);
     btstack_memory_pool_free(&bnep_service_pool, bnep_service);
 }
 #else
@@ -353,11 +471,15 @@ void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t bnep_service_stats = { "bnep_service", 0, 0, 0, 0 };
 bnep_service_t * btstack_memory_bnep_service_get(void){
-    return (bnep_service_t*) malloc(sizeof(bnep_service_t));
+    bnep_service_t * bnep_service = (bnep_service_t*) btstack_memory_malloc(&bnep_service_stats, sizeof(bnep_service_t));
+    BTSTACK_MEMORY_TRACE("bnep_service", BTSTACK_MEMORY_TRACE_GET, bnep_service);
+    return bnep_service;
 }
 void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
-    free(bnep_service);
+    BTSTACK_MEMORY_TRACE("bnep_service", BTSTACK_MEMORY_TRACE_FREE, bnep_service);
+    btstack_memory_free(&bnep_service_stats, bnep_service);
 }
 #endif
 
@@ -374,11 +496,15 @@ void btstack_memory_bnep_service_free(bnep_service_t *bnep_service){
 #ifdef MAX_NR_BNEP_CHANNELS
 #if MAX_NR_BNEP_CHANNELS > 0
 static bnep_channel_t bnep_channel_storage[MAX_NR_BNEP_CHANNELS];
+static uint8_t bnep_channel_used_blocks[(MAX_NR_BNEP_CHANNELS + 7) / 8];
 static btstack_memory_pool_t bnep_channel_pool;
 bnep_channel_t * btstack_memory_bnep_channel_get(void){
-    return (bnep_channel_t *) btstack_memory_pool_get(&bnep_channel_pool);
+    bnep_channel_t * bnep_channel = (bnep_channel_t *) btstack_memory_pool_get(&bnep_channel_pool);
+    BTSTACK_MEMORY_TRACE("bnep_channel", BTSTACK_MEMORY_TRACE_GET, bnep_channel);
+    return bnep_channel;
 }
 void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
+    BTSTACK_MEMORY_TRACE("bnep_channel", BTSTACK_MEMORY_TRACE_FREE, bnep_channel);
     btstack_memory_pool_free(&bnep_channel_pool, bnep_channel);
 }
 #else
@@ -391,11 +517,15 @@ void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t bnep_channel_stats = { "bnep_channel", 0, 0, 0, 0 };
 bnep_channel_t * btstack_memory_bnep_channel_get(void){
-    return (bnep_channel_t*) malloc(sizeof(bnep_channel_t));
+    bnep_channel_t * bnep_channel = (bnep_channel_t*) btstack_memory_malloc(&bnep_channel_stats, sizeof(bnep_channel_t));
+    BTSTACK_MEMORY_TRACE("bnep_channel", BTSTACK_MEMORY_TRACE_GET, bnep_channel);
+    return bnep_channel;
 }
 void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
-    free(bnep_channel);
+    BTSTACK_MEMORY_TRACE("bnep_channel", BTSTACK_MEMORY_TRACE_FREE, bnep_channel);
+    btstack_memory_free(&bnep_channel_stats, bnep_channel);
 }
 #endif
 
@@ -413,11 +543,15 @@ void btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel){
 #ifdef MAX_NR_HFP_CONNECTIONS
 #if MAX_NR_HFP_CONNECTIONS > 0
 static hfp_connection_t hfp_connection_storage[MAX_NR_HFP_CONNECTIONS];
+static uint8_t hfp_connection_used_blocks[(MAX_NR_HFP_CONNECTIONS + 7) / 8];
 static btstack_memory_pool_t hfp_connection_pool;
 hfp_connection_t * btstack_memory_hfp_connection_get(void){
-    return (hfp_connection_t *) btstack_memory_pool_get(&hfp_connection_pool);
+    hfp_connection_t * hfp_connection = (hfp_connection_t *) btstack_memory_pool_get(&hfp_connection_pool);
+    BTSTACK_MEMORY_TRACE("hfp_connection", BTSTACK_MEMORY_TRACE_GET, hfp_connection);
+    return hfp_connection;
 }
 void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
+    BTSTACK_MEMORY_TRACE("hfp_connection", BTSTACK_MEMORY_TRACE_FREE, hfp_connection);
     btstack_memory_pool_free(&hfp_connection_pool, hfp_connection);
 }
 #else
@@ -430,11 +564,15 @@ void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t hfp_connection_stats = { "hfp_connection", 0, 0, 0, 0 };
 hfp_connection_t * btstack_memory_hfp_connection_get(void){
-    return (hfp_connection_t*) malloc(sizeof(hfp_connection_t));
+    hfp_connection_t * hfp_connection = (hfp_connection_t*) btstack_memory_malloc(&hfp_connection_stats, sizeof(hfp_connection_t));
+    BTSTACK_MEMORY_TRACE("hfp_connection", BTSTACK_MEMORY_TRACE_GET, hfp_connection);
+    return hfp_connection;
 }
 void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
-    free(hfp_connection);
+    BTSTACK_MEMORY_TRACE("hfp_connection", BTSTACK_MEMORY_TRACE_FREE, hfp_connection);
+    btstack_memory_free(&hfp_connection_stats, hfp_connection);
 }
 #endif
 
@@ -452,11 +590,15 @@ void btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection){
 #ifdef MAX_NR_SERVICE_RECORD_ITEMS
 #if MAX_NR_SERVICE_RECORD_ITEMS > 0
 static service_record_item_t service_record_item_storage[MAX_NR_SERVICE_RECORD_ITEMS];
+static uint8_t service_record_item_used_blocks[(MAX_NR_SERVICE_RECORD_ITEMS + 7) / 8];
 static btstack_memory_pool_t service_record_item_pool;
 service_record_item_t * btstack_memory_service_record_item_get(void){
-    return (service_record_item_t *) btstack_memory_pool_get(&service_record_item_pool);
+    service_record_item_t * service_record_item = (service_record_item_t *) btstack_memory_pool_get(&service_record_item_pool);
+    BTSTACK_MEMORY_TRACE("service_record_item", BTSTACK_MEMORY_TRACE_GET, service_record_item);
+    return service_record_item;
 }
 void btstack_memory_service_record_item_free(service_record_item_t *service_record_item){
+    BTSTACK_MEMORY_TRACE("service_record_item", BTSTACK_MEMORY_TRACE_FREE, service_record_item);
     btstack_memory_pool_free(&service_record_item_pool, service_record_item);
 }
 #else
@@ -469,11 +611,107 @@ void btstack_memory_service_record_item_free(service_record_item_t *service_reco
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t service_record_item_stats = { "service_record_item", 0, 0, 0, 0 };
 service_record_item_t * btstack_memory_service_record_item_get(void){
-    return (service_record_item_t*) malloc(sizeof(service_record_item_t));
+    service_record_item_t * service_record_item = (service_record_item_t*) btstack_memory_malloc(&service_record_item_stats, sizeof(service_record_item_t));
+    BTSTACK_MEMORY_TRACE("service_record_item", BTSTACK_MEMORY_TRACE_GET, service_record_item);
+    return service_record_item;
 }
 void btstack_memory_service_record_item_free(service_record_item_t *service_record_item){
-    free(service_record_item);
+    BTSTACK_MEMORY_TRACE("service_record_item", BTSTACK_MEMORY_TRACE_FREE, service_record_item);
+    btstack_memory_free(&service_record_item_stats, service_record_item);
+}
+#endif
+
+
+// MARK: sdp_server_connection_t
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_SDP_SERVER_CONNECTIONS)
+    #if defined(MAX_NO_SDP_SERVER_CONNECTIONS)
+        #error "Deprecated MAX_NO_SDP_SERVER_CONNECTIONS defined instead of MAX_NR_SDP_SERVER_CONNECTIONS. Please update your btstack_config.h to use MAX_NR_SDP_SERVER_CONNECTIONS."
+    #else
+        #define MAX_NR_SDP_SERVER_CONNECTIONS 0
+    #endif
+#endif
+
+#ifdef MAX_NR_SDP_SERVER_CONNECTIONS
+#if MAX_NR_SDP_SERVER_CONNECTIONS > 0
+static sdp_server_connection_t sdp_server_connection_storage[MAX_NR_SDP_SERVER_CONNECTIONS];
+static uint8_t sdp_server_connection_used_blocks[(MAX_NR_SDP_SERVER_CONNECTIONS + 7) / 8];
+static btstack_memory_pool_t sdp_server_connection_pool;
+sdp_server_connection_t * btstack_memory_sdp_server_connection_get(void){
+    sdp_server_connection_t * sdp_server_connection = (sdp_server_connection_t *) btstack_memory_pool_get(&sdp_server_connection_pool);
+    BTSTACK_MEMORY_TRACE("sdp_server_connection", BTSTACK_MEMORY_TRACE_GET, sdp_server_connection);
+    return sdp_server_connection;
+}
+void btstack_memory_sdp_server_connection_free(sdp_server_connection_t *sdp_server_connection){
+    BTSTACK_MEMORY_TRACE("sdp_server_connection", BTSTACK_MEMORY_TRACE_FREE, sdp_server_connection);
+    btstack_memory_pool_free(&sdp_server_connection_pool, sdp_server_connection);
+}
+#else
+sdp_server_connection_t * btstack_memory_sdp_server_connection_get(void){
+    return NULL;
+}
+void btstack_memory_sdp_server_connection_free(sdp_server_connection_t *sdp_server_connection){
+    // silence compiler warning about unused parameter in a portable way
+    (void) sdp_server_connection;
+};
+#endif
+#elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t sdp_server_connection_stats = { "sdp_server_connection", 0, 0, 0, 0 };
+sdp_server_connection_t * btstack_memory_sdp_server_connection_get(void){
+    sdp_server_connection_t * sdp_server_connection = (sdp_server_connection_t*) btstack_memory_malloc(&sdp_server_connection_stats, sizeof(sdp_server_connection_t));
+    BTSTACK_MEMORY_TRACE("sdp_server_connection", BTSTACK_MEMORY_TRACE_GET, sdp_server_connection);
+    return sdp_server_connection;
+}
+void btstack_memory_sdp_server_connection_free(sdp_server_connection_t *sdp_server_connection){
+    BTSTACK_MEMORY_TRACE("sdp_server_connection", BTSTACK_MEMORY_TRACE_FREE, sdp_server_connection);
+    btstack_memory_free(&sdp_server_connection_stats, sdp_server_connection);
+}
+#endif
+
+
+// MARK: sdp_client_connection_t
+#if !defined(HAVE_MALLOC) && !defined(MAX_NR_SDP_CLIENT_CONNECTIONS)
+    #if defined(MAX_NO_SDP_CLIENT_CONNECTIONS)
+        #error "Deprecated MAX_NO_SDP_CLIENT_CONNECTIONS defined instead of MAX_NR_SDP_CLIENT_CONNECTIONS. Please update your btstack_config.h to use MAX_NR_SDP_CLIENT_CONNECTIONS."
+    #else
+        #define MAX_NR_SDP_CLIENT_CONNECTIONS 0
+    #endif
+#endif
+
+#ifdef MAX_NR_SDP_CLIENT_CONNECTIONS
+#if MAX_NR_SDP_CLIENT_CONNECTIONS > 0
+static sdp_client_connection_t sdp_client_connection_storage[MAX_NR_SDP_CLIENT_CONNECTIONS];
+static uint8_t sdp_client_connection_used_blocks[(MAX_NR_SDP_CLIENT_CONNECTIONS + 7) / 8];
+static btstack_memory_pool_t sdp_client_connection_pool;
+sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void){
+    sdp_client_connection_t * sdp_client_connection = (sdp_client_connection_t *) btstack_memory_pool_get(&sdp_client_connection_pool);
+    BTSTACK_MEMORY_TRACE("sdp_client_connection", BTSTACK_MEMORY_TRACE_GET, sdp_client_connection);
+    return sdp_client_connection;
+}
+void btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection){
+    BTSTACK_MEMORY_TRACE("sdp_client_connection", BTSTACK_MEMORY_TRACE_FREE, sdp_client_connection);
+    btstack_memory_pool_free(&sdp_client_connection_pool, sdp_client_connection);
+}
+#else
+sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void){
+    return NULL;
+}
+void btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection){
+    // silence compiler warning about unused parameter in a portable way
+    (void) sdp_client_connection;
+};
+#endif
+#elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t sdp_client_connection_stats = { "sdp_client_connection", 0, 0, 0, 0 };
+sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void){
+    sdp_client_connection_t * sdp_client_connection = (sdp_client_connection_t*) btstack_memory_malloc(&sdp_client_connection_stats, sizeof(sdp_client_connection_t));
+    BTSTACK_MEMORY_TRACE("sdp_client_connection", BTSTACK_MEMORY_TRACE_GET, sdp_client_connection);
+    return sdp_client_connection;
+}
+void btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection){
+    BTSTACK_MEMORY_TRACE("sdp_client_connection", BTSTACK_MEMORY_TRACE_FREE, sdp_client_connection);
+    btstack_memory_free(&sdp_client_connection_stats, sdp_client_connection);
 }
 #endif
 
@@ -491,11 +729,15 @@ void btstack_memory_service_record_item_free(service_record_item_t *service_reco
 #ifdef MAX_NR_AVDTP_STREAM_ENDPOINTS
 #if MAX_NR_AVDTP_STREAM_ENDPOINTS > 0
 static avdtp_stream_endpoint_t avdtp_stream_endpoint_storage[MAX_NR_AVDTP_STREAM_ENDPOINTS];
+static uint8_t avdtp_stream_endpoint_used_blocks[(MAX_NR_AVDTP_STREAM_ENDPOINTS + 7) / 8];
 static btstack_memory_pool_t avdtp_stream_endpoint_pool;
 avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void){
-    return (avdtp_stream_endpoint_t *) btstack_memory_pool_get(&avdtp_stream_endpoint_pool);
+    avdtp_stream_endpoint_t * avdtp_stream_endpoint = (avdtp_stream_endpoint_t *) btstack_memory_pool_get(&avdtp_stream_endpoint_pool);
+    BTSTACK_MEMORY_TRACE("avdtp_stream_endpoint", BTSTACK_MEMORY_TRACE_GET, avdtp_stream_endpoint);
+    return avdtp_stream_endpoint;
 }
 void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_stream_endpoint){
+    BTSTACK_MEMORY_TRACE("avdtp_stream_endpoint", BTSTACK_MEMORY_TRACE_FREE, avdtp_stream_endpoint);
     btstack_memory_pool_free(&avdtp_stream_endpoint_pool, avdtp_stream_endpoint);
 }
 #else
@@ -508,11 +750,15 @@ void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_st
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t avdtp_stream_endpoint_stats = { "avdtp_stream_endpoint", 0, 0, 0, 0 };
 avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void){
-    return (avdtp_stream_endpoint_t*) malloc(sizeof(avdtp_stream_endpoint_t));
+    avdtp_stream_endpoint_t * avdtp_stream_endpoint = (avdtp_stream_endpoint_t*) btstack_memory_malloc(&avdtp_stream_endpoint_stats, sizeof(avdtp_stream_endpoint_t));
+    BTSTACK_MEMORY_TRACE("avdtp_stream_endpoint", BTSTACK_MEMORY_TRACE_GET, avdtp_stream_endpoint);
+    return avdtp_stream_endpoint;
 }
 void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_stream_endpoint){
-    free(avdtp_stream_endpoint);
+    BTSTACK_MEMORY_TRACE("avdtp_stream_endpoint", BTSTACK_MEMORY_TRACE_FREE, avdtp_stream_endpoint);
+    btstack_memory_free(&avdtp_stream_endpoint_stats, avdtp_stream_endpoint);
 }
 #endif
 
@@ -530,11 +776,15 @@ void btstack_memory_avdtp_stream_endpoint_free(avdtp_stream_endpoint_t *avdtp_st
 #ifdef MAX_NR_AVDTP_CONNECTIONS
 #if MAX_NR_AVDTP_CONNECTIONS > 0
 static avdtp_connection_t avdtp_connection_storage[MAX_NR_AVDTP_CONNECTIONS];
+static uint8_t avdtp_connection_used_blocks[(MAX_NR_AVDTP_CONNECTIONS + 7) / 8];
 static btstack_memory_pool_t avdtp_connection_pool;
 avdtp_connection_t * btstack_memory_avdtp_connection_get(void){
-    return (avdtp_connection_t *) btstack_memory_pool_get(&avdtp_connection_pool);
+    avdtp_connection_t * avdtp_connection = (avdtp_connection_t *) btstack_memory_pool_get(&avdtp_connection_pool);
+    BTSTACK_MEMORY_TRACE("avdtp_connection", BTSTACK_MEMORY_TRACE_GET, avdtp_connection);
+    return avdtp_connection;
 }
 void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
+    BTSTACK_MEMORY_TRACE("avdtp_connection", BTSTACK_MEMORY_TRACE_FREE, avdtp_connection);
     btstack_memory_pool_free(&avdtp_connection_pool, avdtp_connection);
 }
 #else
@@ -547,11 +797,15 @@ void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t avdtp_connection_stats = { "avdtp_connection", 0, 0, 0, 0 };
 avdtp_connection_t * btstack_memory_avdtp_connection_get(void){
-    return (avdtp_connection_t*) malloc(sizeof(avdtp_connection_t));
+    avdtp_connection_t * avdtp_connection = (avdtp_connection_t*) btstack_memory_malloc(&avdtp_connection_stats, sizeof(avdtp_connection_t));
+    BTSTACK_MEMORY_TRACE("avdtp_connection", BTSTACK_MEMORY_TRACE_GET, avdtp_connection);
+    return avdtp_connection;
 }
 void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
-    free(avdtp_connection);
+    BTSTACK_MEMORY_TRACE("avdtp_connection", BTSTACK_MEMORY_TRACE_FREE, avdtp_connection);
+    btstack_memory_free(&avdtp_connection_stats, avdtp_connection);
 }
 #endif
 
@@ -569,11 +823,15 @@ void btstack_memory_avdtp_connection_free(avdtp_connection_t *avdtp_connection){
 #ifdef MAX_NR_AVRCP_CONNECTIONS
 #if MAX_NR_AVRCP_CONNECTIONS > 0
 static avrcp_connection_t avrcp_connection_storage[MAX_NR_AVRCP_CONNECTIONS];
+static uint8_t avrcp_connection_used_blocks[(MAX_NR_AVRCP_CONNECTIONS + 7) / 8];
 static btstack_memory_pool_t avrcp_connection_pool;
 avrcp_connection_t * btstack_memory_avrcp_connection_get(void){
-    return (avrcp_connection_t *) btstack_memory_pool_get(&avrcp_connection_pool);
+    avrcp_connection_t * avrcp_connection = (avrcp_connection_t *) btstack_memory_pool_get(&avrcp_connection_pool);
+    BTSTACK_MEMORY_TRACE("avrcp_connection", BTSTACK_MEMORY_TRACE_GET, avrcp_connection);
+    return avrcp_connection;
 }
 void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
+    BTSTACK_MEMORY_TRACE("avrcp_connection", BTSTACK_MEMORY_TRACE_FREE, avrcp_connection);
     btstack_memory_pool_free(&avrcp_connection_pool, avrcp_connection);
 }
 #else
@@ -586,11 +844,15 @@ void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t avrcp_connection_stats = { "avrcp_connection", 0, 0, 0, 0 };
 avrcp_connection_t * btstack_memory_avrcp_connection_get(void){
-    return (avrcp_connection_t*) malloc(sizeof(avrcp_connection_t));
+    avrcp_connection_t * avrcp_connection = (avrcp_connection_t*) btstack_memory_malloc(&avrcp_connection_stats, sizeof(avrcp_connection_t));
+    BTSTACK_MEMORY_TRACE("avrcp_connection", BTSTACK_MEMORY_TRACE_GET, avrcp_connection);
+    return avrcp_connection;
 }
 void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
-    free(avrcp_connection);
+    BTSTACK_MEMORY_TRACE("avrcp_connection", BTSTACK_MEMORY_TRACE_FREE, avrcp_connection);
+    btstack_memory_free(&avrcp_connection_stats, avrcp_connection);
 }
 #endif
 
@@ -609,11 +871,15 @@ void btstack_memory_avrcp_connection_free(avrcp_connection_t *avrcp_connection){
 #ifdef MAX_NR_GATT_CLIENTS
 #if MAX_NR_GATT_CLIENTS > 0
 static gatt_client_t gatt_client_storage[MAX_NR_GATT_CLIENTS];
+static uint8_t gatt_client_used_blocks[(MAX_NR_GATT_CLIENTS + 7) / 8];
 static btstack_memory_pool_t gatt_client_pool;
 gatt_client_t * btstack_memory_gatt_client_get(void){
-    return (gatt_client_t *) btstack_memory_pool_get(&gatt_client_pool);
+    gatt_client_t * gatt_client = (gatt_client_t *) btstack_memory_pool_get(&gatt_client_pool);
+    BTSTACK_MEMORY_TRACE("gatt_client", BTSTACK_MEMORY_TRACE_GET, gatt_client);
+    return gatt_client;
 }
 void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
+    BTSTACK_MEMORY_TRACE("gatt_client", BTSTACK_MEMORY_TRACE_FREE, gatt_client);
     btstack_memory_pool_free(&gatt_client_pool, gatt_client);
 }
 #else
@@ -626,11 +892,15 @@ void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t gatt_client_stats = { "gatt_client", 0, 0, 0, 0 };
 gatt_client_t * btstack_memory_gatt_client_get(void){
-    return (gatt_client_t*) malloc(sizeof(gatt_client_t));
+    gatt_client_t * gatt_client = (gatt_client_t*) btstack_memory_malloc(&gatt_client_stats, sizeof(gatt_client_t));
+    BTSTACK_MEMORY_TRACE("gatt_client", BTSTACK_MEMORY_TRACE_GET, gatt_client);
+    return gatt_client;
 }
 void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
-    free(gatt_client);
+    BTSTACK_MEMORY_TRACE("gatt_client", BTSTACK_MEMORY_TRACE_FREE, gatt_client);
+    btstack_memory_free(&gatt_client_stats, gatt_client);
 }
 #endif
 
@@ -647,11 +917,15 @@ void btstack_memory_gatt_client_free(gatt_client_t *gatt_client){
 #ifdef MAX_NR_WHITELIST_ENTRIES
 #if MAX_NR_WHITELIST_ENTRIES > 0
 static whitelist_entry_t whitelist_entry_storage[MAX_NR_WHITELIST_ENTRIES];
+static uint8_t whitelist_entry_used_blocks[(MAX_NR_WHITELIST_ENTRIES + 7) / 8];
 static btstack_memory_pool_t whitelist_entry_pool;
 whitelist_entry_t * btstack_memory_whitelist_entry_get(void){
-    return (whitelist_entry_t *) btstack_memory_pool_get(&whitelist_entry_pool);
+    whitelist_entry_t * whitelist_entry = (whitelist_entry_t *) btstack_memory_pool_get(&whitelist_entry_pool);
+    BTSTACK_MEMORY_TRACE("whitelist_entry", BTSTACK_MEMORY_TRACE_GET, whitelist_entry);
+    return whitelist_entry;
 }
 void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
+    BTSTACK_MEMORY_TRACE("whitelist_entry", BTSTACK_MEMORY_TRACE_FREE, whitelist_entry);
     btstack_memory_pool_free(&whitelist_entry_pool, whitelist_entry);
 }
 #else
@@ -664,11 +938,15 @@ void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t whitelist_entry_stats = { "whitelist_entry", 0, 0, 0, 0 };
 whitelist_entry_t * btstack_memory_whitelist_entry_get(void){
-    return (whitelist_entry_t*) malloc(sizeof(whitelist_entry_t));
+    whitelist_entry_t * whitelist_entry = (whitelist_entry_t*) btstack_memory_malloc(&whitelist_entry_stats, sizeof(whitelist_entry_t));
+    BTSTACK_MEMORY_TRACE("whitelist_entry", BTSTACK_MEMORY_TRACE_GET, whitelist_entry);
+    return whitelist_entry;
 }
 void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
-    free(whitelist_entry);
+    BTSTACK_MEMORY_TRACE("whitelist_entry", BTSTACK_MEMORY_TRACE_FREE, whitelist_entry);
+    btstack_memory_free(&whitelist_entry_stats, whitelist_entry);
 }
 #endif
 
@@ -685,11 +963,15 @@ void btstack_memory_whitelist_entry_free(whitelist_entry_t *whitelist_entry){
 #ifdef MAX_NR_SM_LOOKUP_ENTRIES
 #if MAX_NR_SM_LOOKUP_ENTRIES > 0
 static sm_lookup_entry_t sm_lookup_entry_storage[MAX_NR_SM_LOOKUP_ENTRIES];
+static uint8_t sm_lookup_entry_used_blocks[(MAX_NR_SM_LOOKUP_ENTRIES + 7) / 8];
 static btstack_memory_pool_t sm_lookup_entry_pool;
 sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void){
-    return (sm_lookup_entry_t *) btstack_memory_pool_get(&sm_lookup_entry_pool);
+    sm_lookup_entry_t * sm_lookup_entry = (sm_lookup_entry_t *) btstack_memory_pool_get(&sm_lookup_entry_pool);
+    BTSTACK_MEMORY_TRACE("sm_lookup_entry", BTSTACK_MEMORY_TRACE_GET, sm_lookup_entry);
+    return sm_lookup_entry;
 }
 void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
+    BTSTACK_MEMORY_TRACE("sm_lookup_entry", BTSTACK_MEMORY_TRACE_FREE, sm_lookup_entry);
     btstack_memory_pool_free(&sm_lookup_entry_pool, sm_lookup_entry);
 }
 #else
@@ -702,11 +984,15 @@ void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t sm_lookup_entry_stats = { "sm_lookup_entry", 0, 0, 0, 0 };
 sm_lookup_entry_t * btstack_memory_sm_lookup_entry_get(void){
-    return (sm_lookup_entry_t*) malloc(sizeof(sm_lookup_entry_t));
+    sm_lookup_entry_t * sm_lookup_entry = (sm_lookup_entry_t*) btstack_memory_malloc(&sm_lookup_entry_stats, sizeof(sm_lookup_entry_t));
+    BTSTACK_MEMORY_TRACE("sm_lookup_entry", BTSTACK_MEMORY_TRACE_GET, sm_lookup_entry);
+    return sm_lookup_entry;
 }
 void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
-    free(sm_lookup_entry);
+    BTSTACK_MEMORY_TRACE("sm_lookup_entry", BTSTACK_MEMORY_TRACE_FREE, sm_lookup_entry);
+    btstack_memory_free(&sm_lookup_entry_stats, sm_lookup_entry);
 }
 #endif
 
@@ -715,56 +1001,320 @@ void btstack_memory_sm_lookup_entry_free(sm_lookup_entry_t *sm_lookup_entry){
 // init
 void btstack_memory_init(void){
 #if MAX_NR_HCI_CONNECTIONS > 0
-    btstack_memory_pool_create(&hci_connection_pool, hci_connection_storage, MAX_NR_HCI_CONNECTIONS, sizeof(hci_connection_t));
+    btstack_memory_pool_create(&hci_connection_pool, hci_connection_storage, MAX_NR_HCI_CONNECTIONS, sizeof(hci_connection_t), hci_connection_used_blocks);
 #endif
 #if MAX_NR_L2CAP_SERVICES > 0
-    btstack_memory_pool_create(&l2cap_service_pool, l2cap_service_storage, MAX_NR_L2CAP_SERVICES, sizeof(l2cap_service_t));
+    btstack_memory_pool_create(&l2cap_service_pool, l2cap_service_storage, MAX_NR_L2CAP_SERVICES, sizeof(l2cap_service_t), l2cap_service_used_blocks);
 #endif
 #if MAX_NR_L2CAP_CHANNELS > 0
-    btstack_memory_pool_create(&l2cap_channel_pool, l2cap_channel_storage, MAX_NR_L2CAP_CHANNELS, sizeof(l2cap_channel_t));
+    btstack_memory_pool_create(&l2cap_channel_pool, l2cap_channel_storage, MAX_NR_L2CAP_CHANNELS, sizeof(l2cap_channel_t), l2cap_channel_used_blocks);
 #endif
 #if MAX_NR_RFCOMM_MULTIPLEXERS > 0
-    btstack_memory_pool_create(&rfcomm_multiplexer_pool, rfcomm_multiplexer_storage, MAX_NR_RFCOMM_MULTIPLEXERS, sizeof(rfcomm_multiplexer_t));
+    btstack_memory_pool_create(&rfcomm_multiplexer_pool, rfcomm_multiplexer_storage, MAX_NR_RFCOMM_MULTIPLEXERS, sizeof(rfcomm_multiplexer_t), rfcomm_multiplexer_used_blocks);
 #endif
 #if MAX_NR_RFCOMM_SERVICES > 0
-    btstack_memory_pool_create(&rfcomm_service_pool, rfcomm_service_storage, MAX_NR_RFCOMM_SERVICES, sizeof(rfcomm_service_t));
+    btstack_memory_pool_create(&rfcomm_service_pool, rfcomm_service_storage, MAX_NR_RFCOMM_SERVICES, sizeof(rfcomm_service_t), rfcomm_service_used_blocks);
 #endif
 #if MAX_NR_RFCOMM_CHANNELS > 0
-    btstack_memory_pool_create(&rfcomm_channel_pool, rfcomm_channel_storage, MAX_NR_RFCOMM_CHANNELS, sizeof(rfcomm_channel_t));
+    btstack_memory_pool_create(&rfcomm_channel_pool, rfcomm_channel_storage, MAX_NR_RFCOMM_CHANNELS, sizeof(rfcomm_channel_t), rfcomm_channel_used_blocks);
 #endif
 #if MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES > 0
-    btstack_memory_pool_create(&btstack_link_key_db_memory_entry_pool, btstack_link_key_db_memory_entry_storage, MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES, sizeof(btstack_link_key_db_memory_entry_t));
+    btstack_memory_pool_create(&btstack_link_key_db_memory_entry_pool, btstack_link_key_db_memory_entry_storage, MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES, sizeof(btstack_link_key_db_memory_entry_t), btstack_link_key_db_memory_entry_used_blocks);
 #endif
 #if MAX_NR_BNEP_SERVICES > 0
-    btstack_memory_pool_create(&bnep_service_pool, bnep_service_storage, MAX_NR_BNEP_SERVICES, sizeof(bnep_service_t));
+    btstack_memory_pool_create(&bnep_service_pool, bnep_service_storage, MAX_NR_BNEP_SERVICES, sizeof(bnep_service_t), bnep_service_used_blocks);
 #endif
 #if MAX_NR_BNEP_CHANNELS > 0
-    btstack_memory_pool_create(&bnep_channel_pool, bnep_channel_storage, MAX_NR_BNEP_CHANNELS, sizeof(bnep_channel_t));
+    btstack_memory_pool_create(&bnep_channel_pool, bnep_channel_storage, MAX_NR_BNEP_CHANNELS, sizeof(bnep_channel_t), bnep_channel_used_blocks);
 #endif
 #if MAX_NR_HFP_CONNECTIONS > 0
-    btstack_memory_pool_create(&hfp_connection_pool, hfp_connection_storage, MAX_NR_HFP_CONNECTIONS, sizeof(hfp_connection_t));
+    btstack_memory_pool_create(&hfp_connection_pool, hfp_connection_storage, MAX_NR_HFP_CONNECTIONS, sizeof(hfp_connection_t), hfp_connection_used_blocks);
 #endif
 #if MAX_NR_SERVICE_RECORD_ITEMS > 0
-    btstack_memory_pool_create(&service_record_item_pool, service_record_item_storage, MAX_NR_SERVICE_RECORD_ITEMS, sizeof(service_record_item_t));
+    btstack_memory_pool_create(&service_record_item_pool, service_record_item_storage, MAX_NR_SERVICE_RECORD_ITEMS, sizeof(service_record_item_t), service_record_item_used_blocks);
+#endif
+#if MAX_NR_SDP_SERVER_CONNECTIONS > 0
+    btstack_memory_pool_create(&sdp_server_connection_pool, sdp_server_connection_storage, MAX_NR_SDP_SERVER_CONNECTIONS, sizeof(sdp_server_connection_t), sdp_server_connection_used_blocks);
+#endif
+#if MAX_NR_SDP_CLIENT_CONNECTIONS > 0
+    btstack_memory_pool_create(&sdp_client_connection_pool, sdp_client_connection_storage, MAX_NR_SDP_CLIENT_CONNECTIONS, sizeof(sdp_client_connection_t), sdp_client_connection_used_blocks);
 #endif
 #if MAX_NR_AVDTP_STREAM_ENDPOINTS > 0
-    btstack_memory_pool_create(&avdtp_stream_endpoint_pool, avdtp_stream_endpoint_storage, MAX_NR_AVDTP_STREAM_ENDPOINTS, sizeof(avdtp_stream_endpoint_t));
+    btstack_memory_pool_create(&avdtp_stream_endpoint_pool, avdtp_stream_endpoint_storage, MAX_NR_AVDTP_STREAM_ENDPOINTS, sizeof(avdtp_stream_endpoint_t), avdtp_stream_endpoint_used_blocks);
 #endif
 #if MAX_NR_AVDTP_CONNECTIONS > 0
-    btstack_memory_pool_create(&avdtp_connection_pool, avdtp_connection_storage, MAX_NR_AVDTP_CONNECTIONS, sizeof(avdtp_connection_t));
+    btstack_memory_pool_create(&avdtp_connection_pool, avdtp_connection_storage, MAX_NR_AVDTP_CONNECTIONS, sizeof(avdtp_connection_t), avdtp_connection_used_blocks);
 #endif
 #if MAX_NR_AVRCP_CONNECTIONS > 0
-    btstack_memory_pool_create(&avrcp_connection_pool, avrcp_connection_storage, MAX_NR_AVRCP_CONNECTIONS, sizeof(avrcp_connection_t));
+    btstack_memory_pool_create(&avrcp_connection_pool, avrcp_connection_storage, MAX_NR_AVRCP_CONNECTIONS, sizeof(avrcp_connection_t), avrcp_connection_used_blocks);
 #endif
 #ifdef ENABLE_BLE
 #if MAX_NR_GATT_CLIENTS > 0
-    btstack_memory_pool_create(&gatt_client_pool, gatt_client_storage, MAX_NR_GATT_CLIENTS, sizeof(gatt_client_t));
+    btstack_memory_pool_create(&gatt_client_pool, gatt_client_storage, MAX_NR_GATT_CLIENTS, sizeof(gatt_client_t), gatt_client_used_blocks);
 #endif
 #if MAX_NR_WHITELIST_ENTRIES > 0
-    btstack_memory_pool_create(&whitelist_entry_pool, whitelist_entry_storage, MAX_NR_WHITELIST_ENTRIES, sizeof(whitelist_entry_t));
+    btstack_memory_pool_create(&whitelist_entry_pool, whitelist_entry_storage, MAX_NR_WHITELIST_ENTRIES, sizeof(whitelist_entry_t), whitelist_entry_used_blocks);
 #endif
 #if MAX_NR_SM_LOOKUP_ENTRIES > 0
-    btstack_memory_pool_create(&sm_lookup_entry_pool, sm_lookup_entry_storage, MAX_NR_SM_LOOKUP_ENTRIES, sizeof(sm_lookup_entry_t));
+    btstack_memory_pool_create(&sm_lookup_entry_pool, sm_lookup_entry_storage, MAX_NR_SM_LOOKUP_ENTRIES, sizeof(sm_lookup_entry_t), sm_lookup_entry_used_blocks);
 #endif
 #endif
 }
+
+// stats
+int btstack_memory_get_stats(btstack_memory_pool_stats_t * stats, int max_num_stats){
+    int num_stats = 0;
+#ifdef MAX_NR_HCI_CONNECTIONS
+#if MAX_NR_HCI_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&hci_connection_pool, "hci_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = hci_connection_stats;
+    }
+#endif
+#ifdef MAX_NR_L2CAP_SERVICES
+#if MAX_NR_L2CAP_SERVICES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&l2cap_service_pool, "l2cap_service", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = l2cap_service_stats;
+    }
+#endif
+#ifdef MAX_NR_L2CAP_CHANNELS
+#if MAX_NR_L2CAP_CHANNELS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&l2cap_channel_pool, "l2cap_channel", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = l2cap_channel_stats;
+    }
+#endif
+#ifdef MAX_NR_RFCOMM_MULTIPLEXERS
+#if MAX_NR_RFCOMM_MULTIPLEXERS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&rfcomm_multiplexer_pool, "rfcomm_multiplexer", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = rfcomm_multiplexer_stats;
+    }
+#endif
+#ifdef MAX_NR_RFCOMM_SERVICES
+#if MAX_NR_RFCOMM_SERVICES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&rfcomm_service_pool, "rfcomm_service", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = rfcomm_service_stats;
+    }
+#endif
+#ifdef MAX_NR_RFCOMM_CHANNELS
+#if MAX_NR_RFCOMM_CHANNELS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&rfcomm_channel_pool, "rfcomm_channel", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = rfcomm_channel_stats;
+    }
+#endif
+#ifdef MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES
+#if MAX_NR_BTSTACK_LINK_KEY_DB_MEMORY_ENTRIES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&btstack_link_key_db_memory_entry_pool, "btstack_link_key_db_memory_entry", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = btstack_link_key_db_memory_entry_stats;
+    }
+#endif
+#ifdef MAX_NR_BNEP_SERVICES
+#if MAX_NR_BNEP_SERVICES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&bnep_service_pool, "bnep_service", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = bnep_service_stats;
+    }
+#endif
+#ifdef MAX_NR_BNEP_CHANNELS
+#if MAX_NR_BNEP_CHANNELS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&bnep_channel_pool, "bnep_channel", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = bnep_channel_stats;
+    }
+#endif
+#ifdef MAX_NR_HFP_CONNECTIONS
+#if MAX_NR_HFP_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&hfp_connection_pool, "hfp_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = hfp_connection_stats;
+    }
+#endif
+#ifdef MAX_NR_SERVICE_RECORD_ITEMS
+#if MAX_NR_SERVICE_RECORD_ITEMS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&service_record_item_pool, "service_record_item", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = service_record_item_stats;
+    }
+#endif
+#ifdef MAX_NR_SDP_SERVER_CONNECTIONS
+#if MAX_NR_SDP_SERVER_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&sdp_server_connection_pool, "sdp_server_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = sdp_server_connection_stats;
+    }
+#endif
+#ifdef MAX_NR_SDP_CLIENT_CONNECTIONS
+#if MAX_NR_SDP_CLIENT_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&sdp_client_connection_pool, "sdp_client_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = sdp_client_connection_stats;
+    }
+#endif
+#ifdef MAX_NR_AVDTP_STREAM_ENDPOINTS
+#if MAX_NR_AVDTP_STREAM_ENDPOINTS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&avdtp_stream_endpoint_pool, "avdtp_stream_endpoint", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = avdtp_stream_endpoint_stats;
+    }
+#endif
+#ifdef MAX_NR_AVDTP_CONNECTIONS
+#if MAX_NR_AVDTP_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&avdtp_connection_pool, "avdtp_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = avdtp_connection_stats;
+    }
+#endif
+#ifdef MAX_NR_AVRCP_CONNECTIONS
+#if MAX_NR_AVRCP_CONNECTIONS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&avrcp_connection_pool, "avrcp_connection", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = avrcp_connection_stats;
+    }
+#endif
+#ifdef ENABLE_BLE
+#ifdef MAX_NR_GATT_CLIENTS
+#if MAX_NR_GATT_CLIENTS > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&gatt_client_pool, "gatt_client", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = gatt_client_stats;
+    }
+#endif
+#ifdef MAX_NR_WHITELIST_ENTRIES
+#if MAX_NR_WHITELIST_ENTRIES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&whitelist_entry_pool, "whitelist_entry", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = whitelist_entry_stats;
+    }
+#endif
+#ifdef MAX_NR_SM_LOOKUP_ENTRIES
+#if MAX_NR_SM_LOOKUP_ENTRIES > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&sm_lookup_entry_pool, "sm_lookup_entry", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = sm_lookup_entry_stats;
+    }
+#endif
+#endif
+    (void) stats;
+    (void) max_num_stats;
+    return num_stats;
+}
+
+void btstack_memory_log_stats(void){
+    btstack_memory_pool_stats_t stats[19];
+    int num_stats = btstack_memory_get_stats(stats, 19);
+    int i;
+    for (i = 0; i < num_stats; i++){
+        // count is 0 for types allocated via malloc
+        HCI_DUMP_LOG(LOG_LEVEL_INFO, "%s: %u of %u used, max %u, %u allocations failed", stats[i].name,
+            stats[i].num_used, stats[i].count, stats[i].max_num_used, stats[i].num_allocation_failures);
+    }
+}
+
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+int btstack_memory_trace_get_entries(btstack_memory_trace_entry_t * entries, int max_num_entries){
+    int num_entries = btstack_memory_trace_num_entries;
+    int index;
+    int i;
+    if (num_entries > max_num_entries){
+        num_entries = max_num_entries;
+    }
+    // start with oldest of the most recent num_entries entries
+    index = btstack_memory_trace_index + MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES - num_entries;
+    for (i = 0; i < num_entries; i++){
+        entries[i] = btstack_memory_trace_entries[(index + i) % MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+    }
+    return num_entries;
+}
+
+void btstack_memory_trace_log(void){
+    int num_entries = btstack_memory_trace_num_entries;
+    int index = btstack_memory_trace_index + MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES - num_entries;
+    int i;
+    for (i = 0; i < num_entries; i++){
+        btstack_memory_trace_entry_t * entry = &btstack_memory_trace_entries[(index + i) % MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+        HCI_DUMP_LOG(LOG_LEVEL_INFO, "%u ms: %s %s %p from %p", (unsigned int) entry->timestamp_ms,
+            entry->operation == BTSTACK_MEMORY_TRACE_GET ? "get" : "free", entry->type, entry->block, entry->call_site);
+    }
+}
+#endif
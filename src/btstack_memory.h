@@ -52,6 +52,7 @@ extern "C" {
 #endif
 
 #include "btstack_config.h"
+#include "btstack_memory_pool.h"
     
 // Core
 #include "hci.h"
@@ -63,6 +64,7 @@ extern "C" {
 #include "classic/btstack_link_key_db.h"
 #include "classic/btstack_link_key_db_memory.h"
 #include "classic/rfcomm.h"
+#include "classic/sdp_client.h"
 #include "classic/sdp_server.h"
 #include "classic/avdtp_sink.h"
 #include "classic/avdtp_source.h"
@@ -74,6 +76,27 @@ extern "C" {
 #include "ble/sm.h"
 #endif
 
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+
+#ifndef MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES
+#define MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES 32
+#endif
+
+typedef enum {
+    BTSTACK_MEMORY_TRACE_GET = 0,
+    BTSTACK_MEMORY_TRACE_FREE,
+} btstack_memory_trace_operation_t;
+
+typedef struct {
+    uint32_t     timestamp_ms;
+    const char * type;
+    void       * block;       // NULL for failed allocation
+    void       * call_site;   // return address into caller of get/free, NULL if not supported by compiler
+    uint8_t      operation;   // btstack_memory_trace_operation_t
+} btstack_memory_trace_entry_t;
+
+#endif
+
 /* API_START */
 
 /**
@@ -81,6 +104,36 @@ extern "C" {
  */
 void btstack_memory_init(void);
 
+/**
+ * @brief Get usage statistics of BTstack memory pools
+ * @param stats array for pool statistics
+ * @param max_num_stats size of stats array
+ * @return number of memory pools stored in stats
+ */
+int btstack_memory_get_stats(btstack_memory_pool_stats_t * stats, int max_num_stats);
+
+/**
+ * @brief Log usage statistics of BTstack memory pools to HCI dump
+ */
+void btstack_memory_log_stats(void);
+
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+
+/**
+ * @brief Get allocation trace, oldest entry first
+ * @param entries array for trace entries
+ * @param max_num_entries size of entries array
+ * @return number of trace entries stored in entries
+ */
+int btstack_memory_trace_get_entries(btstack_memory_trace_entry_t * entries, int max_num_entries);
+
+/**
+ * @brief Log allocation trace to HCI dump
+ */
+void btstack_memory_trace_log(void);
+
+#endif
+
 /* API_END */
 
 // hci_connection
@@ -115,9 +168,13 @@ void   btstack_memory_bnep_channel_free(bnep_channel_t *bnep_channel);
 hfp_connection_t * btstack_memory_hfp_connection_get(void);
 void   btstack_memory_hfp_connection_free(hfp_connection_t *hfp_connection);
 
-// service_record_item
+// service_record_item, sdp_server_connection, sdp_client_connection
 service_record_item_t * btstack_memory_service_record_item_get(void);
 void   btstack_memory_service_record_item_free(service_record_item_t *service_record_item);
+sdp_server_connection_t * btstack_memory_sdp_server_connection_get(void);
+void   btstack_memory_sdp_server_connection_free(sdp_server_connection_t *sdp_server_connection);
+sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void);
+void   btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection);
 
 // avdtp_stream_endpoint
 avdtp_stream_endpoint_t * btstack_memory_avdtp_stream_endpoint_get(void);
@@ -42,58 +42,87 @@
  *
  *  Fixed-size block allocation
  *
- *  Free blocks are kept in singly linked list
+ *  Free blocks are kept in singly linked list, allocated blocks are tracked in bitmap
  *
  */
 
 #include "btstack_memory_pool.h"
 
 #include <stddef.h>
+#include <string.h>
 #include "btstack_debug.h"
 
 typedef struct node {
     struct node * next;
 } node_t;
 
-void btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size){
-    node_t *free_blocks = (node_t*) pool;
-    char   *mem_ptr = (char *) storage;
+void btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size, uint8_t * used_blocks){
+    memset(pool, 0, sizeof(btstack_memory_pool_t));
+    pool->storage     = (uint8_t *) storage;
+    pool->count       = count;
+    pool->block_size  = block_size;
+    pool->used_blocks = used_blocks;
+    memset(used_blocks, 0, (count + 7) / 8);
+
+    // create singly linked list of all available blocks, first block at head
+    node_t * next = NULL;
     int i;
-    
-    // create singly linked list of all available blocks
-    free_blocks->next = NULL;
-    for (i = 0 ; i < count ; i++){
-        btstack_memory_pool_free(pool, mem_ptr);
-        mem_ptr += block_size;
+    for (i = count - 1 ; i >= 0 ; i--){
+        node_t * node = (node_t *) &pool->storage[i * block_size];
+        node->next = next;
+        next = node;
     }
+    pool->free_blocks = next;
 }
 
 void * btstack_memory_pool_get(btstack_memory_pool_t *pool){
-    node_t *free_blocks = (node_t*) pool;
-    
-    if (!free_blocks->next) return NULL;
-    
+    node_t * node = (node_t *) pool->free_blocks;
+    if (!node) {
+        pool->num_allocation_failures++;
+        return NULL;
+    }
+
     // remove first
-    node_t *node      = free_blocks->next;
-    free_blocks->next = node->next;
-    
+    pool->free_blocks = node->next;
+
+    // mark as used
+    int index = ((uint8_t *) node - pool->storage) / pool->block_size;
+    pool->used_blocks[index >> 3] |= 1 << (index & 7);
+    pool->num_used++;
+    if (pool->num_used > pool->max_num_used){
+        pool->max_num_used = pool->num_used;
+    }
     return (void*) node;
 }
 
 void btstack_memory_pool_free(btstack_memory_pool_t *pool, void * block){
-    node_t *free_blocks = (node_t*) pool;
-    node_t *node        = (node_t*) block;
+    node_t * node = (node_t*) block;
 
-    // raise error and abort if node already in list
-    node_t * it;
-    for (it = free_blocks->next; it ; it = it->next){
-        if (it == node) {
-            log_error("btstack_memory_pool_free: block %p freed twice for pool %p", block, pool);
-            return;
-        }
+    // raise error and abort if block does not belong to pool or is not in use
+    uint8_t * block_ptr = (uint8_t *) block;
+    if (block_ptr < pool->storage || block_ptr >= &pool->storage[pool->count * pool->block_size]
+    ||  ((block_ptr - pool->storage) % pool->block_size) != 0){
+        log_error("btstack_memory_pool_free: block %p not part of pool %p", block, pool);
+        return;
+    }
+    int index = (block_ptr - pool->storage) / pool->block_size;
+    uint8_t mask = 1 << (index & 7);
+    if ((pool->used_blocks[index >> 3] & mask) == 0){
+        log_error("btstack_memory_pool_free: block %p freed twice for pool %p", block, pool);
+        return;
     }
+    pool->used_blocks[index >> 3] &= ~mask;
+    pool->num_used--;
 
     // add block as node to list
-    node->next          = free_blocks->next;
-    free_blocks->next   = node;
+    node->next        = (node_t *) pool->free_blocks;
+    pool->free_blocks = node;
+}
+
+void btstack_memory_pool_get_stats(btstack_memory_pool_t *pool, const char * name, btstack_memory_pool_stats_t * stats){
+    stats->name     = name;
+    stats->count    = pool->count;
+    stats->num_used = pool->num_used;
+    stats->max_num_used = pool->max_num_used;
+    stats->num_allocation_failures = pool->num_allocation_failures;
 }
@@ -42,21 +42,45 @@
  *
  *  @Assumption block_size >= sizeof(void *)
  *  @Assumption size of storage >= count * block_size
+ *  @Assumption size of used_blocks >= (count + 7) / 8
  *
- *  @Note minimal implementation, no error checking/handling
+ *  @Note get and free take constant time, double frees are detected with an occupancy bitmap
  */
 
 #ifndef __btstack_memory_pool_H
 #define __btstack_memory_pool_H
 
+#include <stdint.h>
+
 #if defined __cplusplus
 extern "C" {
 #endif
 
-typedef void * btstack_memory_pool_t;
+typedef struct {
+    // singly linked list of free blocks
+    void    * free_blocks;
+    // blocks
+    uint8_t * storage;
+    uint16_t  count;
+    uint16_t  block_size;
+    // occupancy bitmap, one bit per block
+    uint8_t * used_blocks;
+    // statistics
+    uint16_t  num_used;
+    uint16_t  max_num_used;
+    uint16_t  num_allocation_failures;
+} btstack_memory_pool_t;
+
+typedef struct {
+    const char * name;
+    uint16_t count;
+    uint16_t num_used;
+    uint16_t max_num_used;
+    uint16_t num_allocation_failures;
+} btstack_memory_pool_stats_t;
 
-// initialize memory pool with with given storage, block size and count
-void   btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size);
+// initialize memory pool with with given storage, block size and count, and bitmap with (count + 7) / 8 bytes
+void   btstack_memory_pool_create(btstack_memory_pool_t *pool, void * storage, int count, int block_size, uint8_t * used_blocks);
 
 // get free block from pool, @returns NULL or pointer to block
 void * btstack_memory_pool_get(btstack_memory_pool_t *pool);
@@ -64,6 +88,9 @@ void * btstack_memory_pool_get(btstack_memory_pool_t *pool);
 // return previously reserved block to memory pool
 void   btstack_memory_pool_free(btstack_memory_pool_t *pool, void * block);
 
+// get usage statistics
+void   btstack_memory_pool_get_stats(btstack_memory_pool_t *pool, const char * name, btstack_memory_pool_stats_t * stats);
+
 #if defined __cplusplus
 }
 #endif
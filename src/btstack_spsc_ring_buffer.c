@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "btstack_spsc_ring_buffer.c"
+
+/*
+ *  btstack_spsc_ring_buffer.c
+ *
+ *  Read and write positions run from 0 to 2 * size - 1. This allows to use all
+ *  bytes of the storage without a 'full' flag that would be shared between
+ *  producer and consumer. Each position is only written by its owner, the other
+ *  side reads it with acquire semantics after the owner published it with release
+ *  semantics, so the payload is visible before the position update.
+ */
+
+#include <string.h>
+
+#include "btstack_spsc_ring_buffer.h"
+
+#define ERROR_CODE_MEMORY_CAPACITY_EXCEEDED 0x07
+
+#if defined(__ATOMIC_ACQUIRE)
+// GCC >= 4.7 / clang
+#define SPSC_LOAD_ACQUIRE(pos)       __atomic_load_n(&(pos), __ATOMIC_ACQUIRE)
+#define SPSC_STORE_RELEASE(pos, val) __atomic_store_n(&(pos), (val), __ATOMIC_RELEASE)
+#else
+// single-core MCUs: volatile access is sufficient between main loop and IRQ handler
+#define SPSC_LOAD_ACQUIRE(pos)       (pos)
+#define SPSC_STORE_RELEASE(pos, val) ((pos) = (val))
+#endif
+
+static uint32_t btstack_spsc_ring_buffer_used(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t read_position, uint32_t write_position){
+    if (write_position >= read_position) return write_position - read_position;
+    return write_position + 2 * ring_buffer->size - read_position;
+}
+
+static uint32_t btstack_spsc_ring_buffer_index(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t position){
+    if (position < ring_buffer->size) return position;
+    return position - ring_buffer->size;
+}
+
+static uint32_t btstack_spsc_ring_buffer_advance(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t position, uint32_t len){
+    position += len;
+    if (position >= 2 * ring_buffer->size){
+        position -= 2 * ring_buffer->size;
+    }
+    return position;
+}
+
+void btstack_spsc_ring_buffer_init(btstack_spsc_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size){
+    ring_buffer->storage = storage;
+    ring_buffer->size = storage_size;
+    ring_buffer->read_position = 0;
+    ring_buffer->write_position = 0;
+}
+
+uint32_t btstack_spsc_ring_buffer_bytes_available(btstack_spsc_ring_buffer_t * ring_buffer){
+    uint32_t read_position  = SPSC_LOAD_ACQUIRE(ring_buffer->read_position);
+    uint32_t write_position = SPSC_LOAD_ACQUIRE(ring_buffer->write_position);
+    return btstack_spsc_ring_buffer_used(ring_buffer, read_position, write_position);
+}
+
+uint32_t btstack_spsc_ring_buffer_bytes_free(btstack_spsc_ring_buffer_t * ring_buffer){
+    return ring_buffer->size - btstack_spsc_ring_buffer_bytes_available(ring_buffer);
+}
+
+// producer side
+
+uint8_t * btstack_spsc_ring_buffer_reserve(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t * contiguous_len){
+    uint32_t write_position = ring_buffer->write_position;
+    uint32_t read_position  = SPSC_LOAD_ACQUIRE(ring_buffer->read_position);
+    uint32_t bytes_free = ring_buffer->size - btstack_spsc_ring_buffer_used(ring_buffer, read_position, write_position);
+    if (bytes_free == 0){
+        *contiguous_len = 0;
+        return NULL;
+    }
+    uint32_t write_index = btstack_spsc_ring_buffer_index(ring_buffer, write_position);
+    uint32_t bytes_till_end = ring_buffer->size - write_index;
+    *contiguous_len = bytes_free < bytes_till_end ? bytes_free : bytes_till_end;
+    return &ring_buffer->storage[write_index];
+}
+
+void btstack_spsc_ring_buffer_commit(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t len){
+    uint32_t write_position = btstack_spsc_ring_buffer_advance(ring_buffer, ring_buffer->write_position, len);
+    SPSC_STORE_RELEASE(ring_buffer->write_position, write_position);
+}
+
+int btstack_spsc_ring_buffer_write(btstack_spsc_ring_buffer_t * ring_buffer, const uint8_t * data, uint32_t data_length){
+    if (btstack_spsc_ring_buffer_bytes_free(ring_buffer) < data_length){
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+    // at most two chunks, publish once at the end
+    uint32_t write_position = ring_buffer->write_position;
+    while (data_length){
+        uint32_t write_index = btstack_spsc_ring_buffer_index(ring_buffer, write_position);
+        uint32_t bytes_till_end = ring_buffer->size - write_index;
+        uint32_t bytes_to_copy = data_length < bytes_till_end ? data_length : bytes_till_end;
+        memcpy(&ring_buffer->storage[write_index], data, bytes_to_copy);
+        write_position = btstack_spsc_ring_buffer_advance(ring_buffer, write_position, bytes_to_copy);
+        data += bytes_to_copy;
+        data_length -= bytes_to_copy;
+    }
+    SPSC_STORE_RELEASE(ring_buffer->write_position, write_position);
+    return 0;
+}
+
+// consumer side
+
+const uint8_t * btstack_spsc_ring_buffer_peek(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t * contiguous_len){
+    uint32_t read_position  = ring_buffer->read_position;
+    uint32_t write_position = SPSC_LOAD_ACQUIRE(ring_buffer->write_position);
+    uint32_t bytes_available = btstack_spsc_ring_buffer_used(ring_buffer, read_position, write_position);
+    if (bytes_available == 0){
+        *contiguous_len = 0;
+        return NULL;
+    }
+    uint32_t read_index = btstack_spsc_ring_buffer_index(ring_buffer, read_position);
+    uint32_t bytes_till_end = ring_buffer->size - read_index;
+    *contiguous_len = bytes_available < bytes_till_end ? bytes_available : bytes_till_end;
+    return &ring_buffer->storage[read_index];
+}
+
+void btstack_spsc_ring_buffer_consume(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t len){
+    uint32_t read_position = btstack_spsc_ring_buffer_advance(ring_buffer, ring_buffer->read_position, len);
+    SPSC_STORE_RELEASE(ring_buffer->read_position, read_position);
+}
+
+uint32_t btstack_spsc_ring_buffer_read(btstack_spsc_ring_buffer_t * ring_buffer, uint8_t * buffer, uint32_t length){
+    uint32_t bytes_read = 0;
+    while (bytes_read < length){
+        uint32_t contiguous_len;
+        const uint8_t * data = btstack_spsc_ring_buffer_peek(ring_buffer, &contiguous_len);
+        if (!data) break;
+        uint32_t bytes_to_copy = length - bytes_read;
+        if (bytes_to_copy > contiguous_len){
+            bytes_to_copy = contiguous_len;
+        }
+        memcpy(&buffer[bytes_read], data, bytes_to_copy);
+        btstack_spsc_ring_buffer_consume(ring_buffer, bytes_to_copy);
+        bytes_read += bytes_to_copy;
+    }
+    return bytes_read;
+}
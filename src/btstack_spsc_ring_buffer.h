@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  btstack_spsc_ring_buffer.h
+ *
+ *  Lock-free single-producer / single-consumer ring buffer
+ *
+ *  One thread (or IRQ handler) may write, another one may read without
+ *  additional locking. Data is accessed in place via reserve/commit on the
+ *  producer side and peek/consume on the consumer side.
+ */
+
+#ifndef __BTSTACK_SPSC_RING_BUFFER_H
+#define __BTSTACK_SPSC_RING_BUFFER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct btstack_spsc_ring_buffer {
+    uint8_t  * storage;
+    uint32_t size;
+    // positions run modulo 2 * size to distinguish full from empty
+    volatile uint32_t read_position;    // only modified by consumer
+    volatile uint32_t write_position;   // only modified by producer
+} btstack_spsc_ring_buffer_t;
+
+/**
+ * Init ring buffer. Must not be called while producer or consumer are active.
+ * @param ring_buffer object
+ * @param storage
+ * @param storage_size in bytes, max 0x7fffffff
+ */
+void btstack_spsc_ring_buffer_init(btstack_spsc_ring_buffer_t * ring_buffer, uint8_t * storage, uint32_t storage_size);
+
+/**
+ * Get number of bytes available for read. Safe to call from producer and consumer.
+ * @param ring_buffer object
+ * @return number of bytes available for read
+ */
+uint32_t btstack_spsc_ring_buffer_bytes_available(btstack_spsc_ring_buffer_t * ring_buffer);
+
+/**
+ * Get free space available for write. Safe to call from producer and consumer.
+ * @param ring_buffer object
+ * @return number of bytes available for write
+ */
+uint32_t btstack_spsc_ring_buffer_bytes_free(btstack_spsc_ring_buffer_t * ring_buffer);
+
+/**
+ * Producer: get contiguous free space for in-place write
+ * @note free space may wrap around, call again after commit to get the remainder
+ * @param ring_buffer object
+ * @param contiguous_len number of bytes that can be written at returned address
+ * @return write address, NULL if buffer is full
+ */
+uint8_t * btstack_spsc_ring_buffer_reserve(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t * contiguous_len);
+
+/**
+ * Producer: make bytes written at reserved address available to consumer
+ * @param ring_buffer object
+ * @param len <= contiguous_len returned by reserve
+ */
+void btstack_spsc_ring_buffer_commit(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t len);
+
+/**
+ * Consumer: get contiguous data for in-place read
+ * @note data may wrap around, call again after consume to get the remainder
+ * @param ring_buffer object
+ * @param contiguous_len number of bytes that can be read at returned address
+ * @return read address, NULL if buffer is empty
+ */
+const uint8_t * btstack_spsc_ring_buffer_peek(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t * contiguous_len);
+
+/**
+ * Consumer: release bytes returned by peek to producer
+ * @param ring_buffer object
+ * @param len <= contiguous_len returned by peek
+ */
+void btstack_spsc_ring_buffer_consume(btstack_spsc_ring_buffer_t * ring_buffer, uint32_t len);
+
+/**
+ * Producer: copy bytes into ring buffer
+ * @param ring_buffer object
+ * @param data to store
+ * @param data_length
+ * @return 0 if ok, ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if not enough space in buffer
+ */
+int btstack_spsc_ring_buffer_write(btstack_spsc_ring_buffer_t * ring_buffer, const uint8_t * data, uint32_t data_length);
+
+/**
+ * Consumer: copy bytes from ring buffer
+ * @param ring_buffer object
+ * @param buffer to store read data
+ * @param length to read
+ * @return number of bytes read
+ */
+uint32_t btstack_spsc_ring_buffer_read(btstack_spsc_ring_buffer_t * ring_buffer, uint8_t * buffer, uint32_t length);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __BTSTACK_SPSC_RING_BUFFER_H
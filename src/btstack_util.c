@@ -353,4 +353,53 @@ uint32_t btstack_atoi(const char *str){
         val = (val * 10) + (uint8_t)(chr - '0');
         str++;
     }
-}
\ No newline at end of file
+}
+
+void btstack_event_mask_clear(btstack_event_mask_t * event_mask){
+    memset(event_mask, 0, sizeof(btstack_event_mask_t));
+}
+
+void btstack_event_mask_set_all(btstack_event_mask_t * event_mask){
+    memset(event_mask, 0xff, sizeof(btstack_event_mask_t));
+}
+
+void btstack_event_mask_add_event(btstack_event_mask_t * event_mask, uint8_t event_code){
+    event_mask->events[event_code >> 3] |= 1 << (event_code & 7);
+    if (event_code != HCI_EVENT_LE_META) return;
+    memset(event_mask->le_subevents, 0xff, sizeof(event_mask->le_subevents));
+}
+
+void btstack_event_mask_remove_event(btstack_event_mask_t * event_mask, uint8_t event_code){
+    event_mask->events[event_code >> 3] &= ~(1 << (event_code & 7));
+    if (event_code != HCI_EVENT_LE_META) return;
+    memset(event_mask->le_subevents, 0, sizeof(event_mask->le_subevents));
+}
+
+void btstack_event_mask_add_le_subevent(btstack_event_mask_t * event_mask, uint8_t subevent_code){
+    event_mask->events[HCI_EVENT_LE_META >> 3] |= 1 << (HCI_EVENT_LE_META & 7);
+    event_mask->le_subevents[subevent_code >> 3] |= 1 << (subevent_code & 7);
+}
+
+void btstack_event_mask_remove_le_subevent(btstack_event_mask_t * event_mask, uint8_t subevent_code){
+    event_mask->le_subevents[subevent_code >> 3] &= ~(1 << (subevent_code & 7));
+}
+
+void btstack_event_mask_set_all_except_reports(btstack_event_mask_t * event_mask){
+    btstack_event_mask_set_all(event_mask);
+    btstack_event_mask_remove_event(event_mask, HCI_EVENT_INQUIRY_RESULT);
+    btstack_event_mask_remove_event(event_mask, HCI_EVENT_INQUIRY_RESULT_WITH_RSSI);
+    btstack_event_mask_remove_event(event_mask, HCI_EVENT_EXTENDED_INQUIRY_RESPONSE);
+    btstack_event_mask_remove_event(event_mask, GAP_EVENT_INQUIRY_RESULT);
+    btstack_event_mask_remove_le_subevent(event_mask, HCI_SUBEVENT_LE_ADVERTISING_REPORT);
+    btstack_event_mask_remove_le_subevent(event_mask, HCI_SUBEVENT_LE_DIRECT_ADVERTISING_REPORT);
+    btstack_event_mask_remove_event(event_mask, GAP_EVENT_ADVERTISING_REPORT);
+    btstack_event_mask_remove_event(event_mask, GAP_EVENT_ADVERTISING_REPORT_BATCH);
+}
+
+int btstack_event_mask_matches(const btstack_event_mask_t * event_mask, const uint8_t * event){
+    uint8_t event_code = event[0];
+    if ((event_mask->events[event_code >> 3] & (1 << (event_code & 7))) == 0) return 0;
+    if (event_code != HCI_EVENT_LE_META) return 1;
+    uint8_t subevent_code = event[2];
+    return (event_mask->le_subevents[subevent_code >> 3] & (1 << (subevent_code & 7))) != 0;
+}
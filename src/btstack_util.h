@@ -253,6 +253,60 @@ int  uuid_has_bluetooth_prefix(const uint8_t * uuid128);
  */
 uint32_t btstack_atoi(const char *str);
 
+/**
+ * @brief Clear event mask
+ * @param event_mask
+ */
+void btstack_event_mask_clear(btstack_event_mask_t * event_mask);
+
+/**
+ * @brief Set all events and LE Meta subevents in event mask
+ * @param event_mask
+ */
+void btstack_event_mask_set_all(btstack_event_mask_t * event_mask);
+
+/**
+ * @brief Add event to event mask. For HCI_EVENT_LE_META, all subevents are added
+ * @param event_mask
+ * @param event_code
+ */
+void btstack_event_mask_add_event(btstack_event_mask_t * event_mask, uint8_t event_code);
+
+/**
+ * @brief Remove event from event mask. For HCI_EVENT_LE_META, all subevents are removed
+ * @param event_mask
+ * @param event_code
+ */
+void btstack_event_mask_remove_event(btstack_event_mask_t * event_mask, uint8_t event_code);
+
+/**
+ * @brief Add LE Meta subevent to event mask
+ * @param event_mask
+ * @param subevent_code
+ */
+void btstack_event_mask_add_le_subevent(btstack_event_mask_t * event_mask, uint8_t subevent_code);
+
+/**
+ * @brief Remove LE Meta subevent from event mask
+ * @param event_mask
+ * @param subevent_code
+ */
+void btstack_event_mask_remove_le_subevent(btstack_event_mask_t * event_mask, uint8_t subevent_code);
+
+/**
+ * @brief Set all events in event mask except for high-rate LE Advertising Reports and Inquiry Results
+ * @param event_mask
+ */
+void btstack_event_mask_set_all_except_reports(btstack_event_mask_t * event_mask);
+
+/**
+ * @brief Check if event is contained in event mask
+ * @param event_mask
+ * @param event packet
+ * @return 1 if event should be delivered
+ */
+int  btstack_event_mask_matches(const btstack_event_mask_t * event_mask, const uint8_t * event);
+
 /* API_END */
 
 #if defined __cplusplus
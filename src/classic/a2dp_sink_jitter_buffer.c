@@ -0,0 +1,467 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "a2dp_sink_jitter_buffer.c"
+
+/*
+ * a2dp_sink_jitter_buffer.c
+ *
+ * Data flow: media packet -> SBC decoder -> PLC blocks -> PCM ring buffer -> resampler -> audio driver
+ *
+ * Lost audio is filled in by the writer when a gap in the RTP sequence numbers is detected, or by
+ * the reader when the buffer runs empty. Audio concealed by the reader is owed by the source and
+ * dropped from the next packets, so the playback stays in sync with the source timeline.
+ *
+ * The buffer depth is averaged over about one second and fed into a PI controller that adjusts
+ * the resampling ratio. Its integral term converges to the clock drift between source and sink.
+ */
+
+#include <string.h>
+
+#include "btstack_debug.h"
+#include "btstack_util.h"
+#include "classic/a2dp_sink_jitter_buffer.h"
+
+#define RTP_HEADER_SIZE 12
+#define BYTES_PER_FRAME (2 * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS)
+
+// default configuration
+#define DEFAULT_MIN_TARGET_MS       40
+#define DEFAULT_MAX_TARGET_MS       200
+#define DEFAULT_MAX_CONCEALMENT_MS  100
+
+// target depth = one media packet + TARGET_JITTER_FACTOR * jitter
+#define TARGET_JITTER_FACTOR 4
+
+// concealed audio is faded out after a number of consecutive PLC blocks
+#define PLC_FADE_OUT_START_BLOCKS 8
+#define PLC_FADE_OUT_BLOCKS       8
+
+// controller: depth error is corrected within CONTROLLER_PROPORTIONAL_TIME_S,
+// drift estimate integrates over CONTROLLER_INTEGRAL_TIME_S
+#define CONTROLLER_PROPORTIONAL_TIME_S 10
+#define CONTROLLER_INTEGRAL_TIME_S     30
+#define CONTROLLER_MAX_CORRECTION_PPM  5000
+
+#define Q31_ONE 0x80000000u
+
+static uint32_t jitter_buffer_frames_for_ms(a2dp_sink_jitter_buffer_t * jitter_buffer, uint32_t time_ms){
+    return jitter_buffer->sample_rate * time_ms / 1000;
+}
+
+static uint32_t jitter_buffer_depth(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    return btstack_ring_buffer_bytes_available(&jitter_buffer->pcm_buffer) / BYTES_PER_FRAME + jitter_buffer->plc_block_fill;
+}
+
+static int32_t jitter_buffer_clamp(int32_t value, int32_t limit){
+    if (value >  limit) return  limit;
+    if (value < -limit) return -limit;
+    return value;
+}
+
+// PLC
+
+static void jitter_buffer_plc_reset(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    int channel;
+    for (channel = 0; channel < A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS; channel++){
+        btstack_sbc_plc_init(&jitter_buffer->plc_state[channel]);
+        jitter_buffer->last_sample[channel] = 0;
+    }
+    jitter_buffer->plc_block_fill = 0;
+    jitter_buffer->plc_block_missing = 0;
+    jitter_buffer->plc_bad_blocks = 0;
+}
+
+static int32_t jitter_buffer_plc_gain_q15(uint16_t bad_blocks){
+    if (bad_blocks <= PLC_FADE_OUT_START_BLOCKS) return 1 << 15;
+    uint16_t fade_blocks = bad_blocks - PLC_FADE_OUT_START_BLOCKS;
+    if (fade_blocks >= PLC_FADE_OUT_BLOCKS) return 0;
+    return (PLC_FADE_OUT_BLOCKS - fade_blocks) * (1 << 15) / PLC_FADE_OUT_BLOCKS;
+}
+
+static void jitter_buffer_plc_process_block(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    int16_t in[SBC_FS];
+    int16_t out[SBC_FS];
+    int16_t zero_input_response[SBC_OLAL];
+    int16_t * block = jitter_buffer->plc_block;
+    int channel;
+    int i;
+
+    if (!jitter_buffer->plc_block_missing && jitter_buffer->plc_bad_blocks >= PLC_FADE_OUT_START_BLOCKS + PLC_FADE_OUT_BLOCKS){
+        // resume after silence without cross-fading from stale history
+        jitter_buffer_plc_reset(jitter_buffer);
+    }
+
+    for (channel = 0; channel < A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS; channel++){
+        for (i = 0; i < SBC_FS; i++){
+            in[i] = block[i * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS + channel];
+        }
+        if (jitter_buffer->plc_block_missing){
+            // the decoder's zero input response is not available for A2DP, approximate it by the received
+            // audio at the start of the block or by holding the last sample
+            int16_t sample = jitter_buffer->last_sample[channel];
+            for (i = 0; i < SBC_OLAL; i++){
+                if (i < jitter_buffer->plc_block_missing - 1){
+                    sample = in[i];
+                }
+                zero_input_response[i] = sample;
+            }
+            btstack_sbc_plc_bad_frame(&jitter_buffer->plc_state[channel], zero_input_response, out);
+        } else {
+            btstack_sbc_plc_good_frame(&jitter_buffer->plc_state[channel], in, out);
+        }
+        for (i = 0; i < SBC_FS; i++){
+            block[i * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS + channel] = out[i];
+        }
+    }
+
+    if (jitter_buffer->plc_block_missing){
+        // fade out long concealment
+        int32_t gain_start = jitter_buffer_plc_gain_q15(jitter_buffer->plc_bad_blocks);
+        jitter_buffer->plc_bad_blocks++;
+        int32_t gain_end   = jitter_buffer_plc_gain_q15(jitter_buffer->plc_bad_blocks);
+        if (gain_end < (1 << 15)){
+            for (i = 0; i < SBC_FS; i++){
+                int32_t gain = gain_start + (gain_end - gain_start) * i / SBC_FS;
+                for (channel = 0; channel < A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS; channel++){
+                    int16_t * sample = &block[i * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS + channel];
+                    *sample = (int16_t) ((*sample * gain) >> 15);
+                }
+            }
+        }
+    } else {
+        jitter_buffer->plc_bad_blocks = 0;
+    }
+
+    for (channel = 0; channel < A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS; channel++){
+        jitter_buffer->last_sample[channel] = block[(SBC_FS - 1) * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS + channel];
+    }
+
+    if (btstack_ring_buffer_bytes_free(&jitter_buffer->pcm_buffer) < SBC_FS * BYTES_PER_FRAME){
+        jitter_buffer->statistics.frames_dropped += SBC_FS;
+    } else {
+        btstack_ring_buffer_write(&jitter_buffer->pcm_buffer, (uint8_t *) block, SBC_FS * BYTES_PER_FRAME);
+    }
+    jitter_buffer->plc_block_fill = 0;
+    jitter_buffer->plc_block_missing = 0;
+}
+
+static void jitter_buffer_push_frames(a2dp_sink_jitter_buffer_t * jitter_buffer, const int16_t * pcm, uint32_t num_frames){
+    jitter_buffer->write_position += num_frames;
+    while (num_frames){
+        uint32_t frames_to_copy = btstack_min(num_frames, SBC_FS - jitter_buffer->plc_block_fill);
+        memcpy(&jitter_buffer->plc_block[jitter_buffer->plc_block_fill * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS], pcm, frames_to_copy * BYTES_PER_FRAME);
+        pcm += frames_to_copy * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS;
+        num_frames -= frames_to_copy;
+        jitter_buffer->plc_block_fill += frames_to_copy;
+        if (jitter_buffer->plc_block_fill == SBC_FS){
+            jitter_buffer_plc_process_block(jitter_buffer);
+        }
+    }
+}
+
+// a block with missing audio is concealed completely, plc_block_missing stores 1 + index of first missing frame
+static void jitter_buffer_push_missing_frames(a2dp_sink_jitter_buffer_t * jitter_buffer, uint32_t num_frames){
+    jitter_buffer->write_position += num_frames;
+    jitter_buffer->statistics.frames_concealed += num_frames;
+    while (num_frames){
+        uint32_t frames_to_add = btstack_min(num_frames, SBC_FS - jitter_buffer->plc_block_fill);
+        if (!jitter_buffer->plc_block_missing){
+            jitter_buffer->plc_block_missing = jitter_buffer->plc_block_fill + 1;
+        }
+        num_frames -= frames_to_add;
+        jitter_buffer->plc_block_fill += frames_to_add;
+        if (jitter_buffer->plc_block_fill == SBC_FS){
+            jitter_buffer_plc_process_block(jitter_buffer);
+        }
+    }
+}
+
+// Writer
+
+static void jitter_buffer_handle_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    UNUSED(sample_rate);
+    a2dp_sink_jitter_buffer_t * jitter_buffer = (a2dp_sink_jitter_buffer_t *) context;
+    int i;
+
+    jitter_buffer->frames_in_packet += num_samples;
+
+    // decoder always provides stereo output, duplicate left channel for mono streams
+    if (num_channels == 1){
+        for (i = 0; i < num_samples; i++){
+            data[i * 2 + 1] = data[i * 2];
+        }
+    }
+
+    // drop audio that has been concealed already
+    uint32_t frames_to_drop = btstack_min(jitter_buffer->frames_owed, num_samples);
+    jitter_buffer->frames_owed -= frames_to_drop;
+    if (frames_to_drop == (uint32_t) num_samples) return;
+
+    jitter_buffer_push_frames(jitter_buffer, &data[frames_to_drop * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS], num_samples - frames_to_drop);
+    jitter_buffer->frames_concealed_in_row = 0;
+}
+
+static void jitter_buffer_update_jitter(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    // transit time measured with local audio clock, see RFC 3550, A.8
+    int32_t transit = (int32_t) (jitter_buffer->clock - (jitter_buffer->write_position - jitter_buffer->frames_owed));
+    if (jitter_buffer->playing && jitter_buffer->last_transit != INT32_MIN){
+        int32_t d = transit - jitter_buffer->last_transit;
+        if (d < 0) d = -d;
+        jitter_buffer->jitter_q4 += d - ((jitter_buffer->jitter_q4 + 8) >> 4);
+    }
+    jitter_buffer->last_transit = jitter_buffer->playing ? transit : INT32_MIN;
+
+    uint32_t target = jitter_buffer->frames_per_packet + TARGET_JITTER_FACTOR * (jitter_buffer->jitter_q4 >> 4);
+    if (target < jitter_buffer->min_target_depth) target = jitter_buffer->min_target_depth;
+    if (target > jitter_buffer->max_target_depth) target = jitter_buffer->max_target_depth;
+    jitter_buffer->target_depth = target;
+}
+
+void a2dp_sink_jitter_buffer_put_media_packet(a2dp_sink_jitter_buffer_t * jitter_buffer, uint8_t * packet, uint16_t size){
+    if (size < RTP_HEADER_SIZE + 1) return;
+
+    uint8_t  csrc_count      = packet[0] & 0x0f;
+    uint8_t  extension       = packet[0] & 0x10;
+    uint16_t sequence_number = big_endian_read_16(packet, 2);
+    uint32_t timestamp       = big_endian_read_32(packet, 4);
+    uint16_t pos = RTP_HEADER_SIZE + csrc_count * 4;
+    if (extension){
+        if (pos + 4 > size) return;
+        pos += 4 + big_endian_read_16(packet, pos + 2) * 4;
+    }
+    if (pos + 1 > size) return;
+
+    // SBC media payload header, fragmented SBC frames are not supported
+    uint8_t sbc_header = packet[pos++];
+    if (sbc_header & 0x80) return;
+
+    jitter_buffer->statistics.packets_received++;
+
+    if (jitter_buffer->rtp_valid){
+        int16_t sequence_delta = (int16_t) (sequence_number - jitter_buffer->next_sequence_number);
+        if (sequence_delta < 0){
+            jitter_buffer->statistics.packets_late++;
+            return;
+        }
+        if (sequence_delta == 0){
+            // timestamps are in samples if they advance by the number of frames of the last packet
+            jitter_buffer->timestamp_in_samples = timestamp == jitter_buffer->next_timestamp;
+        } else {
+            jitter_buffer->statistics.packets_lost += sequence_delta;
+            uint32_t missing_frames = sequence_delta * jitter_buffer->frames_per_packet;
+            uint32_t timestamp_delta = timestamp - jitter_buffer->next_timestamp;
+            if (jitter_buffer->timestamp_in_samples && timestamp_delta <= 2 * missing_frames){
+                missing_frames = timestamp_delta;
+            }
+            // audio concealed during underrun covers lost packets first
+            uint32_t frames_owed = btstack_min(jitter_buffer->frames_owed, missing_frames);
+            jitter_buffer->frames_owed -= frames_owed;
+            missing_frames -= frames_owed;
+            if (missing_frames > jitter_buffer->max_concealment){
+                log_info("jitter buffer: %u frames lost, restart", (unsigned int) missing_frames);
+                jitter_buffer->frames_owed = 0;
+            } else if (jitter_buffer->playing || btstack_ring_buffer_bytes_available(&jitter_buffer->pcm_buffer) || jitter_buffer->plc_block_fill){
+                jitter_buffer_push_missing_frames(jitter_buffer, missing_frames);
+            }
+        }
+    }
+
+    jitter_buffer_update_jitter(jitter_buffer);
+
+    // decode, drops audio that has been concealed already
+    uint32_t frames_owed = jitter_buffer->frames_owed;
+    jitter_buffer->frames_in_packet = 0;
+    btstack_sbc_decoder_process_data(&jitter_buffer->decoder, 0, &packet[pos], size - pos);
+    if (frames_owed && frames_owed >= jitter_buffer->frames_in_packet){
+        jitter_buffer->statistics.packets_late++;
+    }
+    if (jitter_buffer->frames_in_packet){
+        jitter_buffer->frames_per_packet = jitter_buffer->frames_in_packet;
+    }
+
+    jitter_buffer->rtp_valid = 1;
+    jitter_buffer->next_sequence_number = sequence_number + 1;
+    jitter_buffer->next_timestamp = timestamp + jitter_buffer->frames_in_packet;
+}
+
+// Reader
+
+static void jitter_buffer_stop(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    jitter_buffer->playing = 0;
+    jitter_buffer->statistics.underruns++;
+    jitter_buffer->frames_owed = 0;
+    jitter_buffer->frames_concealed_in_row = 0;
+    jitter_buffer->last_transit = INT32_MIN;
+    jitter_buffer_plc_reset(jitter_buffer);
+    // drop concealed audio
+    btstack_ring_buffer_init(&jitter_buffer->pcm_buffer, jitter_buffer->pcm_buffer.storage, jitter_buffer->pcm_buffer.size);
+}
+
+static void jitter_buffer_update_correction(a2dp_sink_jitter_buffer_t * jitter_buffer, uint16_t num_frames){
+    // average depth over about one second
+    int64_t depth_q8 = (int64_t) jitter_buffer_depth(jitter_buffer) << 8;
+    jitter_buffer->depth_average_q8 += (depth_q8 - jitter_buffer->depth_average_q8) * num_frames / (int64_t) jitter_buffer->sample_rate;
+
+    // PI controller, proportional part in ppm
+    int64_t error_q8 = jitter_buffer->depth_average_q8 - ((int64_t) jitter_buffer->target_depth << 8);
+    int64_t proportional_ppm_q8 = error_q8 * 1000000 / ((int64_t) jitter_buffer->sample_rate * CONTROLLER_PROPORTIONAL_TIME_S);
+    int64_t drift_ppm_q8 = jitter_buffer->drift_ppm_q8 + proportional_ppm_q8 * num_frames / ((int64_t) jitter_buffer->sample_rate * CONTROLLER_INTEGRAL_TIME_S);
+    jitter_buffer->drift_ppm_q8 = jitter_buffer_clamp((int32_t) drift_ppm_q8, CONTROLLER_MAX_CORRECTION_PPM << 8);
+    int32_t correction_ppm_q8 = jitter_buffer_clamp((int32_t) jitter_buffer_clamp((int32_t) proportional_ppm_q8, CONTROLLER_MAX_CORRECTION_PPM << 8) + jitter_buffer->drift_ppm_q8, CONTROLLER_MAX_CORRECTION_PPM << 8);
+    jitter_buffer->correction_ppm = correction_ppm_q8 >> 8;
+}
+
+// linear interpolation between consecutive frames, input holds num_input + 1 frames
+static void jitter_buffer_resample(const int16_t * input, int16_t * output, uint16_t num_frames, uint32_t phase, uint32_t step){
+    uint64_t position = phase;
+    uint16_t i;
+    for (i = 0; i < num_frames; i++){
+        uint32_t index    = (uint32_t) (position >> 31);
+        int32_t  fraction = (int32_t) ((position >> 16) & 0x7fff);
+        const int16_t * frame = &input[index * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS];
+        output[0] = (int16_t) (frame[0] + (((frame[2] - frame[0]) * fraction) >> 15));
+        output[1] = (int16_t) (frame[1] + (((frame[3] - frame[1]) * fraction) >> 15));
+        output   += A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS;
+        position += step;
+    }
+}
+
+static void jitter_buffer_read_chunk(a2dp_sink_jitter_buffer_t * jitter_buffer, int16_t * pcm, uint16_t num_frames){
+    // start playback when target depth has been reached
+    if (!jitter_buffer->playing){
+        if (jitter_buffer_depth(jitter_buffer) < jitter_buffer->target_depth || btstack_ring_buffer_bytes_available(&jitter_buffer->pcm_buffer) < BYTES_PER_FRAME){
+            memset(pcm, 0, num_frames * BYTES_PER_FRAME);
+            return;
+        }
+        uint32_t bytes_read;
+        btstack_ring_buffer_read(&jitter_buffer->pcm_buffer, (uint8_t *) jitter_buffer->resample_buffer, BYTES_PER_FRAME, &bytes_read);
+        jitter_buffer->playing = 1;
+        jitter_buffer->phase = 0;
+        jitter_buffer->depth_average_q8 = (int64_t) jitter_buffer->target_depth << 8;
+        log_info("jitter buffer: start playback, target %u frames", (unsigned int) jitter_buffer->target_depth);
+    }
+
+    // step per output frame in Q31, source faster than audio clock -> consume more input frames
+    uint32_t step = Q31_ONE + (int32_t) ((int64_t) jitter_buffer->correction_ppm * Q31_ONE / 1000000);
+    uint32_t num_input_frames = (uint32_t) (((uint64_t) jitter_buffer->phase + (uint64_t) num_frames * step) >> 31);
+
+    // conceal missing audio
+    uint32_t frames_available = btstack_ring_buffer_bytes_available(&jitter_buffer->pcm_buffer) / BYTES_PER_FRAME;
+    while (frames_available < num_input_frames){
+        if (jitter_buffer->frames_concealed_in_row >= jitter_buffer->max_concealment){
+            log_info("jitter buffer: underrun");
+            jitter_buffer_stop(jitter_buffer);
+            memset(pcm, 0, num_frames * BYTES_PER_FRAME);
+            return;
+        }
+        uint32_t missing_frames = SBC_FS - jitter_buffer->plc_block_fill;
+        jitter_buffer->frames_owed += missing_frames;
+        jitter_buffer->frames_concealed_in_row += missing_frames;
+        jitter_buffer_push_missing_frames(jitter_buffer, missing_frames);
+        frames_available = btstack_ring_buffer_bytes_available(&jitter_buffer->pcm_buffer) / BYTES_PER_FRAME;
+    }
+
+    // resample, first frame in resample buffer is last frame of previous chunk
+    uint32_t bytes_read;
+    btstack_ring_buffer_read(&jitter_buffer->pcm_buffer, (uint8_t *) &jitter_buffer->resample_buffer[A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS], num_input_frames * BYTES_PER_FRAME, &bytes_read);
+    jitter_buffer_resample(jitter_buffer->resample_buffer, pcm, num_frames, jitter_buffer->phase, step);
+    memcpy(jitter_buffer->resample_buffer, &jitter_buffer->resample_buffer[num_input_frames * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS], BYTES_PER_FRAME);
+    jitter_buffer->phase = (uint32_t) (jitter_buffer->phase + num_frames * step) & (Q31_ONE - 1);
+
+    jitter_buffer_update_correction(jitter_buffer, num_frames);
+}
+
+void a2dp_sink_jitter_buffer_read(a2dp_sink_jitter_buffer_t * jitter_buffer, int16_t * pcm, uint16_t num_frames){
+    while (num_frames){
+        uint16_t frames_to_read = btstack_min(num_frames, A2DP_SINK_JITTER_BUFFER_READ_CHUNK);
+        jitter_buffer_read_chunk(jitter_buffer, pcm, frames_to_read);
+        jitter_buffer->clock += frames_to_read;
+        pcm += frames_to_read * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS;
+        num_frames -= frames_to_read;
+    }
+}
+
+// API
+
+void a2dp_sink_jitter_buffer_init(a2dp_sink_jitter_buffer_t * jitter_buffer, uint32_t sample_rate, uint8_t * storage, uint32_t storage_size){
+    memset(jitter_buffer, 0, sizeof(a2dp_sink_jitter_buffer_t));
+    jitter_buffer->sample_rate = sample_rate;
+    jitter_buffer->last_transit = INT32_MIN;
+    btstack_ring_buffer_init(&jitter_buffer->pcm_buffer, storage, storage_size);
+    btstack_sbc_decoder_init(&jitter_buffer->decoder, SBC_MODE_STANDARD, &jitter_buffer_handle_pcm_data, jitter_buffer);
+    jitter_buffer_plc_reset(jitter_buffer);
+    a2dp_sink_jitter_buffer_set_target_range(jitter_buffer, DEFAULT_MIN_TARGET_MS, DEFAULT_MAX_TARGET_MS);
+    a2dp_sink_jitter_buffer_set_max_concealment(jitter_buffer, DEFAULT_MAX_CONCEALMENT_MS);
+}
+
+void a2dp_sink_jitter_buffer_set_target_range(a2dp_sink_jitter_buffer_t * jitter_buffer, uint16_t min_target_ms, uint16_t max_target_ms){
+    jitter_buffer->min_target_depth = jitter_buffer_frames_for_ms(jitter_buffer, min_target_ms);
+    jitter_buffer->max_target_depth = jitter_buffer_frames_for_ms(jitter_buffer, max_target_ms);
+    // keep room for one packet above target
+    uint32_t storage_frames = jitter_buffer->pcm_buffer.size / BYTES_PER_FRAME;
+    if (jitter_buffer->max_target_depth + SBC_FS > storage_frames){
+        log_error("jitter buffer: storage for %u frames too small for max target %u", (unsigned int) storage_frames, (unsigned int) jitter_buffer->max_target_depth);
+        jitter_buffer->max_target_depth = storage_frames > 2 * SBC_FS ? storage_frames - 2 * SBC_FS : SBC_FS;
+    }
+    if (jitter_buffer->min_target_depth > jitter_buffer->max_target_depth){
+        jitter_buffer->min_target_depth = jitter_buffer->max_target_depth;
+    }
+    jitter_buffer->target_depth = jitter_buffer->min_target_depth;
+}
+
+void a2dp_sink_jitter_buffer_set_max_concealment(a2dp_sink_jitter_buffer_t * jitter_buffer, uint16_t max_concealment_ms){
+    jitter_buffer->max_concealment = jitter_buffer_frames_for_ms(jitter_buffer, max_concealment_ms);
+}
+
+int a2dp_sink_jitter_buffer_is_playing(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    return jitter_buffer->playing;
+}
+
+void a2dp_sink_jitter_buffer_get_statistics(a2dp_sink_jitter_buffer_t * jitter_buffer, a2dp_sink_jitter_buffer_statistics_t * statistics){
+    *statistics = jitter_buffer->statistics;
+    statistics->buffer_depth   = jitter_buffer_depth(jitter_buffer);
+    statistics->target_depth   = jitter_buffer->target_depth;
+    statistics->jitter         = jitter_buffer->jitter_q4 >> 4;
+    statistics->drift_ppm      = jitter_buffer->drift_ppm_q8 / 256;
+    statistics->correction_ppm = jitter_buffer->correction_ppm;
+}
+
+void a2dp_sink_jitter_buffer_reset_statistics(a2dp_sink_jitter_buffer_t * jitter_buffer){
+    memset(&jitter_buffer->statistics, 0, sizeof(a2dp_sink_jitter_buffer_statistics_t));
+}
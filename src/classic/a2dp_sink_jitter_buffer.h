@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ * a2dp_sink_jitter_buffer.h
+ *
+ * Playback buffer for A2DP Sink
+ *
+ * Decodes SBC media packets as received via avdtp_sink_register_media_handler and provides
+ * a continuous PCM stream to the audio driver:
+ * - RTP sequence numbers and timestamps are used to detect lost and late packets
+ * - lost audio is concealed with the SBC packet loss concealment (btstack_sbc_plc)
+ * - the target buffer depth follows the measured packet jitter
+ * - the clock drift between source and local audio clock is estimated and compensated
+ *   by fractional resampling
+ *
+ * PCM data is stereo, interleaved, in host endianess. All functions must be called from
+ * the same context, usually the BTstack run loop. A DMA interrupt should only hand over
+ * buffers, see example/a2dp_sink_demo.c.
+ */
+
+#ifndef __A2DP_SINK_JITTER_BUFFER_H
+#define __A2DP_SINK_JITTER_BUFFER_H
+
+#include <stdint.h>
+#include "btstack_ring_buffer.h"
+#include "classic/btstack_sbc.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#define A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS    2
+#define A2DP_SINK_JITTER_BUFFER_READ_CHUNK      128    // max audio frames resampled at once
+
+typedef struct {
+    uint32_t packets_received;
+    uint32_t packets_lost;          // detected by gaps in RTP sequence numbers
+    uint32_t packets_late;          // dropped as their audio was already concealed or played
+    uint32_t frames_concealed;      // audio frames generated by packet loss concealment
+    uint32_t frames_dropped;        // audio frames dropped as buffer was full
+    uint32_t underruns;             // playback restarted with prebuffering
+    uint32_t buffer_depth;          // audio frames
+    uint32_t target_depth;          // audio frames
+    uint32_t jitter;                // audio frames, RFC 3550 interarrival jitter
+    int32_t  drift_ppm;             // estimated clock drift between source and audio clock
+    int32_t  correction_ppm;        // current resampling correction
+} a2dp_sink_jitter_buffer_statistics_t;
+
+typedef struct {
+    // private
+    btstack_sbc_decoder_state_t decoder;
+    btstack_ring_buffer_t pcm_buffer;
+    uint32_t sample_rate;
+
+    // configuration in audio frames
+    uint32_t min_target_depth;
+    uint32_t max_target_depth;
+    uint32_t max_concealment;
+
+    // packet loss concealment in blocks of SBC_FS audio frames
+    btstack_sbc_plc_state_t plc_state[A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS];
+    int16_t  plc_block[SBC_FS * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS];
+    uint16_t plc_block_fill;
+    uint8_t  plc_block_missing;     // 1 + index of first missing audio frame, 0 if complete
+    uint16_t plc_bad_blocks;
+    int16_t  last_sample[A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS];
+
+    // RTP
+    uint8_t  rtp_valid;
+    uint8_t  timestamp_in_samples;
+    uint16_t next_sequence_number;
+    uint32_t next_timestamp;
+    uint16_t frames_per_packet;
+    uint16_t frames_in_packet;
+    uint32_t frames_owed;           // concealed during underrun, dropped from next packets
+    uint32_t frames_concealed_in_row;
+
+    // playout
+    uint8_t  playing;
+    uint32_t clock;                 // audio frames played
+    uint32_t write_position;        // audio frames received or concealed
+    int32_t  last_transit;
+    uint32_t jitter_q4;
+    uint32_t target_depth;
+    int64_t  depth_average_q8;
+    int32_t  drift_ppm_q8;
+    int32_t  correction_ppm;
+
+    // resampler, Q31 phase
+    uint32_t phase;
+    int16_t  resample_buffer[(A2DP_SINK_JITTER_BUFFER_READ_CHUNK + 4) * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS];
+
+    a2dp_sink_jitter_buffer_statistics_t statistics;
+} a2dp_sink_jitter_buffer_t;
+
+/* API_START */
+
+/**
+ * @brief Init jitter buffer
+ * @param jitter_buffer
+ * @param sample_rate of the configured SBC stream
+ * @param storage for decoded audio, should hold at least max_target_ms plus one media packet
+ * @param storage_size in bytes
+ */
+void a2dp_sink_jitter_buffer_init(a2dp_sink_jitter_buffer_t * jitter_buffer, uint32_t sample_rate, uint8_t * storage, uint32_t storage_size);
+
+/**
+ * @brief Set range for adaptive target buffer depth, default: 40 - 200 ms
+ * @param jitter_buffer
+ * @param min_target_ms
+ * @param max_target_ms
+ */
+void a2dp_sink_jitter_buffer_set_target_range(a2dp_sink_jitter_buffer_t * jitter_buffer, uint16_t min_target_ms, uint16_t max_target_ms);
+
+/**
+ * @brief Set max duration of concealed audio before playback is stopped and restarted with prebuffering, default: 100 ms
+ * @param jitter_buffer
+ * @param max_concealment_ms
+ */
+void a2dp_sink_jitter_buffer_set_max_concealment(a2dp_sink_jitter_buffer_t * jitter_buffer, uint16_t max_concealment_ms);
+
+/**
+ * @brief Add media packet with RTP header and SBC payload
+ * @param jitter_buffer
+ * @param packet
+ * @param size
+ */
+void a2dp_sink_jitter_buffer_put_media_packet(a2dp_sink_jitter_buffer_t * jitter_buffer, uint8_t * packet, uint16_t size);
+
+/**
+ * @brief Get audio for playback, silence while prebuffering
+ * @param jitter_buffer
+ * @param pcm buffer for num_frames stereo audio frames
+ * @param num_frames
+ */
+void a2dp_sink_jitter_buffer_read(a2dp_sink_jitter_buffer_t * jitter_buffer, int16_t * pcm, uint16_t num_frames);
+
+/**
+ * @brief Check if playback is active, i.e. not prebuffering
+ * @param jitter_buffer
+ * @return 1 if playing
+ */
+int a2dp_sink_jitter_buffer_is_playing(a2dp_sink_jitter_buffer_t * jitter_buffer);
+
+/**
+ * @brief Get statistics
+ * @param jitter_buffer
+ * @param statistics
+ */
+void a2dp_sink_jitter_buffer_get_statistics(a2dp_sink_jitter_buffer_t * jitter_buffer, a2dp_sink_jitter_buffer_statistics_t * statistics);
+
+/**
+ * @brief Reset counters in statistics
+ * @param jitter_buffer
+ */
+void a2dp_sink_jitter_buffer_reset_statistics(a2dp_sink_jitter_buffer_t * jitter_buffer);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __A2DP_SINK_JITTER_BUFFER_H
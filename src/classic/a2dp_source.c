@@ -82,6 +82,7 @@ static a2dp_state_t app_state = A2DP_IDLE;
 static avdtp_stream_endpoint_context_t sc;
 static uint16_t avdtp_cid = 0;
 static int next_remote_sep_index_to_query = 0;
+static btstack_packet_handler_t a2dp_source_media_packet_handler;
 
 static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
 
@@ -282,12 +283,19 @@ static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packe
                             sc.block_length = avdtp_subevent_signaling_media_codec_sbc_configuration_get_block_length(packet);
                             sc.subbands = avdtp_subevent_signaling_media_codec_sbc_configuration_get_subbands(packet);
                             sc.allocation_method = avdtp_subevent_signaling_media_codec_sbc_configuration_get_allocation_method(packet) - 1;
+                            sc.min_bitpool_value = avdtp_subevent_signaling_media_codec_sbc_configuration_get_min_bitpool_value(packet);
                             sc.max_bitpool_value = avdtp_subevent_signaling_media_codec_sbc_configuration_get_max_bitpool_value(packet);
                             // TODO: deal with reconfigure: avdtp_subevent_signaling_media_codec_sbc_configuration_get_reconfigure(packet);
                             break;
                         }  
                         case AVDTP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW: 
-                            a2dp_streaming_emit_can_send_media_packet_now(a2dp_source_context.a2dp_callback, avdtp_cid, 0);
+                            int_seid = avdtp_subevent_streaming_can_send_media_packet_now_get_int_seid(packet);
+                            if (a2dp_source_media_packet_handler){
+                                // media scheduler is sending
+                                a2dp_streaming_emit_can_send_media_packet_now(a2dp_source_media_packet_handler, avdtp_cid, int_seid);
+                                break;
+                            }
+                            a2dp_streaming_emit_can_send_media_packet_now(a2dp_source_context.a2dp_callback, avdtp_cid, int_seid);
                             break;
                         
                         case AVDTP_SUBEVENT_SIGNALING_ACCEPT:
@@ -469,7 +477,7 @@ uint8_t a2dp_source_stream_endpoint_ready(uint8_t local_seid){
 }
 
 
-static void a2dp_source_setup_media_header(uint8_t * media_packet, int size, int *offset, uint8_t marker, uint16_t sequence_number){
+static void a2dp_source_setup_media_header(uint8_t * media_packet, int size, int *offset, uint8_t marker, uint16_t sequence_number, uint32_t timestamp){
     if (size < AVDTP_MEDIA_PAYLOAD_HEADER_SIZE){
         log_error("small outgoing buffer");
         return;
@@ -481,7 +489,6 @@ static void a2dp_source_setup_media_header(uint8_t * media_packet, int size, int
     uint8_t  csrc_count = 0;
     uint8_t  payload_type = 0x60;
     // uint16_t sequence_number = stream_endpoint->sequence_number;
-    uint32_t timestamp = btstack_run_loop_get_time_ms();
     uint32_t ssrc = 0x11223344;
 
     // rtp header (min size 12B)
@@ -535,7 +542,7 @@ static void a2dp_source_copy_media_payload(uint8_t * media_packet, int size, int
     *offset = pos;
 }
 
-int a2dp_source_stream_send_media_payload(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker){
+int a2dp_source_stream_send_media_payload_with_timestamp(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker, uint32_t timestamp){
     avdtp_stream_endpoint_t * stream_endpoint = avdtp_stream_endpoint_for_seid(int_seid, &a2dp_source_context);
     if (!stream_endpoint) {
         log_error("no stream_endpoint found for seid %d", int_seid);
@@ -553,9 +560,26 @@ int a2dp_source_stream_send_media_payload(uint8_t int_seid, uint8_t * storage, i
     l2cap_reserve_packet_buffer();
     uint8_t * media_packet = l2cap_get_outgoing_buffer();
     //int size = l2cap_get_remote_mtu_for_local_cid(stream_endpoint->l2cap_media_cid);
-    a2dp_source_setup_media_header(media_packet, size, &offset, marker, stream_endpoint->sequence_number);
+    a2dp_source_setup_media_header(media_packet, size, &offset, marker, stream_endpoint->sequence_number, timestamp);
     a2dp_source_copy_media_payload(media_packet, size, &offset, storage, num_bytes_to_copy, num_frames);
     stream_endpoint->sequence_number++;
     l2cap_send_prepared(stream_endpoint->l2cap_media_cid, offset);
     return size;
 }
+
+int a2dp_source_stream_send_media_payload(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker){
+    return a2dp_source_stream_send_media_payload_with_timestamp(int_seid, storage, num_bytes_to_copy, num_frames, marker, btstack_run_loop_get_time_ms());
+}
+
+void a2dp_source_register_media_packet_handler(btstack_packet_handler_t callback){
+    a2dp_source_media_packet_handler = callback;
+}
+
+uint8_t a2dp_source_stream_sbc_configuration(uint8_t int_seid, uint32_t * sampling_frequency, uint8_t * min_bitpool_value, uint8_t * max_bitpool_value){
+    if (!sc.local_stream_endpoint || avdtp_stream_endpoint_seid(sc.local_stream_endpoint) != int_seid) return 0;
+    if (!sc.sampling_frequency) return 0;
+    *sampling_frequency = sc.sampling_frequency;
+    *min_bitpool_value  = sc.min_bitpool_value;
+    *max_bitpool_value  = sc.max_bitpool_value;
+    return 1;
+}
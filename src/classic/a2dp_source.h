@@ -116,8 +116,26 @@ void 	a2dp_source_stream_endpoint_request_can_send_now(uint8_t local_seid);
 
 int  	a2dp_source_stream_send_media_payload(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker);
 
+/**
+ * @brief Send media payload with RTP timestamp, e.g. in audio samples
+ * @param int_seid
+ * @param storage with SBC frames
+ * @param num_bytes_to_copy
+ * @param num_frames number of SBC frames
+ * @param marker
+ * @param timestamp
+ * @return 0 on error
+ */
+int  	a2dp_source_stream_send_media_payload_with_timestamp(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker, uint32_t timestamp);
+
 /* API_END */
 
+// used by a2dp_source_scheduler: receive A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW instead of app
+void    a2dp_source_register_media_packet_handler(btstack_packet_handler_t callback);
+
+// used by a2dp_source_scheduler: SBC configuration of stream, returns 0 if not configured
+uint8_t a2dp_source_stream_sbc_configuration(uint8_t int_seid, uint32_t * sampling_frequency, uint8_t * min_bitpool_value, uint8_t * max_bitpool_value);
+
 #if defined __cplusplus
 }
 #endif
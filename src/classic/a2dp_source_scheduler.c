@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "a2dp_source_scheduler.c"
+
+/*
+ * a2dp_source_scheduler.c
+ *
+ * SBC frames are encoded as soon as their audio is due according to the media clock, i.e. the
+ * local time since start, and collected in the packet at the tail of the send queue. A packet is
+ * queued when the next frame does not fit into the media MTU. The timer is set to the time when
+ * the current packet will be complete.
+ *
+ * Packets are sent on A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW. If they are not sent in
+ * time, the queue fills up and the bitpool is lowered. If the queue is full, encoding stops until
+ * audio is older than the max latency, which is then skipped.
+ */
+
+#include <string.h>
+
+#include "btstack.h"
+#include "classic/a2dp_source.h"
+#include "classic/a2dp_source_scheduler.h"
+#include "classic/btstack_sbc.h"
+
+#define SCHEDULER_DEFAULT_MAX_LATENCY_MS    100
+
+// queue slot: payload length (2), num SBC frames (1), reserved (1), RTP timestamp (4), payload
+#define SCHEDULER_SLOT_HEADER_SIZE          8
+
+// SBC media payload header: 4 bit number of frames
+#define SCHEDULER_MAX_SBC_FRAMES_PER_PACKET 15
+#define SCHEDULER_MAX_AUDIO_FRAMES_PER_SBC_FRAME 128
+
+// bitpool adaptation
+#define SCHEDULER_BITPOOL_INTERVAL_MS       1000
+#define SCHEDULER_BITPOOL_DECREASE_STEP     4
+#define SCHEDULER_BITPOOL_INCREASE_STEP     2
+#define SCHEDULER_BITPOOL_INCREASE_INTERVALS 5
+#define SCHEDULER_CONGESTION_QUEUE_DEPTH    2
+
+static struct {
+    // send queue
+    uint8_t *  storage;
+    uint32_t   storage_size;
+    uint16_t   slot_size;
+    uint16_t   queue_size;
+    uint16_t   queue_head;
+    uint16_t   queue_count;
+
+    // packet at tail of queue
+    uint16_t   packet_len;
+    uint8_t    packet_num_frames;
+    uint32_t   packet_timestamp;
+
+    // pcm source
+    void (*pcm_callback)(int16_t * pcm, int num_frames, void * context);
+    void *     pcm_context;
+    btstack_ring_buffer_t * pcm_ring_buffer;
+
+    // stream
+    uint8_t    local_seid;
+    uint8_t    streaming;
+    uint8_t    can_send_now_requested;
+    uint32_t   sample_rate;
+    uint16_t   max_payload_size;
+    uint16_t   frames_per_sbc_frame;
+    uint16_t   sbc_frame_len;
+    uint16_t   max_latency_ms;
+
+    // media clock
+    btstack_timer_source_t timer;
+    uint32_t   start_ms;
+    uint32_t   frames_encoded;
+
+    // bitpool adaptation
+    uint8_t    min_bitpool;
+    uint8_t    max_bitpool;
+    uint8_t    bitpool;
+    uint8_t    congested;
+    uint8_t    intervals_without_congestion;
+    uint32_t   interval_start_ms;
+
+    a2dp_source_scheduler_statistics_t statistics;
+} scheduler;
+
+static void a2dp_source_scheduler_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
+
+// send queue
+
+static uint8_t * a2dp_source_scheduler_slot(uint16_t index){
+    return &scheduler.storage[(index % scheduler.queue_size) * scheduler.slot_size];
+}
+
+static void a2dp_source_scheduler_request_can_send_now(void){
+    if (scheduler.can_send_now_requested) return;
+    if (!scheduler.queue_count) return;
+    scheduler.can_send_now_requested = 1;
+    a2dp_source_stream_endpoint_request_can_send_now(scheduler.local_seid);
+}
+
+static void a2dp_source_scheduler_queue_packet(void){
+    uint8_t * slot = a2dp_source_scheduler_slot(scheduler.queue_head + scheduler.queue_count);
+    little_endian_store_16(slot, 0, scheduler.packet_len);
+    slot[2] = scheduler.packet_num_frames;
+    slot[3] = 0;
+    little_endian_store_32(slot, 4, scheduler.packet_timestamp);
+    scheduler.queue_count++;
+    scheduler.packet_len = 0;
+    scheduler.packet_num_frames = 0;
+    if (scheduler.queue_count > scheduler.statistics.max_queue_depth){
+        scheduler.statistics.max_queue_depth = scheduler.queue_count;
+    }
+}
+
+static void a2dp_source_scheduler_send_packet(void){
+    uint8_t * slot = a2dp_source_scheduler_slot(scheduler.queue_head);
+    uint16_t len   = little_endian_read_16(slot, 0);
+    a2dp_source_stream_send_media_payload_with_timestamp(scheduler.local_seid, &slot[SCHEDULER_SLOT_HEADER_SIZE], len, slot[2], 0, little_endian_read_32(slot, 4));
+    scheduler.queue_head = (scheduler.queue_head + 1) % scheduler.queue_size;
+    scheduler.queue_count--;
+    scheduler.statistics.packets_sent++;
+    scheduler.statistics.bytes_sent += len;
+}
+
+// encoder
+
+static void a2dp_source_scheduler_read_pcm(int16_t * pcm, int num_frames){
+    if (scheduler.pcm_callback){
+        (*scheduler.pcm_callback)(pcm, num_frames, scheduler.pcm_context);
+        return;
+    }
+    uint32_t bytes_to_read = num_frames * 4;
+    uint32_t bytes_read = 0;
+    if (scheduler.pcm_ring_buffer){
+        btstack_ring_buffer_read(scheduler.pcm_ring_buffer, (uint8_t *) pcm, bytes_to_read, &bytes_read);
+    }
+    if (bytes_read < bytes_to_read){
+        memset(((uint8_t *) pcm) + bytes_read, 0, bytes_to_read - bytes_read);
+        scheduler.statistics.pcm_underruns++;
+    }
+}
+
+static void a2dp_source_scheduler_skip_pcm(uint32_t num_frames){
+    scheduler.statistics.frames_skipped += num_frames;
+    scheduler.frames_encoded += num_frames;
+    // audio from callback is produced on demand, drop audio captured into ring buffer meanwhile
+    if (!scheduler.pcm_ring_buffer || scheduler.pcm_callback) return;
+    while (num_frames){
+        uint8_t  buffer[64];
+        uint32_t bytes_read = 0;
+        uint32_t bytes_to_read = btstack_min(num_frames * 4, sizeof(buffer));
+        btstack_ring_buffer_read(scheduler.pcm_ring_buffer, buffer, bytes_to_read, &bytes_read);
+        if (bytes_read < bytes_to_read) break;
+        num_frames -= bytes_read / 4;
+    }
+}
+
+static int a2dp_source_scheduler_packet_capacity(void){
+    // number of SBC frames in a packet for current frame size
+    if (!scheduler.sbc_frame_len) return 1;
+    int num_frames = (scheduler.max_payload_size - 1) / scheduler.sbc_frame_len;
+    return btstack_max(1, btstack_min(num_frames, SCHEDULER_MAX_SBC_FRAMES_PER_PACKET));
+}
+
+static void a2dp_source_scheduler_encode_frame(void){
+    int16_t pcm[SCHEDULER_MAX_AUDIO_FRAMES_PER_SBC_FRAME * 2];
+    a2dp_source_scheduler_read_pcm(pcm, scheduler.frames_per_sbc_frame);
+    btstack_sbc_encoder_process_data(pcm);
+
+    if (scheduler.packet_num_frames == 0){
+        scheduler.packet_timestamp = scheduler.frames_encoded;
+    }
+    uint16_t sbc_frame_len = btstack_sbc_encoder_sbc_buffer_length();
+    uint8_t * payload = a2dp_source_scheduler_slot(scheduler.queue_head + scheduler.queue_count) + SCHEDULER_SLOT_HEADER_SIZE;
+    memcpy(&payload[scheduler.packet_len], btstack_sbc_encoder_sbc_buffer(), sbc_frame_len);
+    scheduler.packet_len += sbc_frame_len;
+    scheduler.packet_num_frames++;
+    scheduler.sbc_frame_len = sbc_frame_len;
+    scheduler.frames_encoded += scheduler.frames_per_sbc_frame;
+}
+
+// bitpool adaptation
+
+static void a2dp_source_scheduler_set_bitpool(uint8_t bitpool){
+    if (bitpool == scheduler.bitpool) return;
+    log_info("a2dp source scheduler: bitpool %u -> %u", scheduler.bitpool, bitpool);
+    scheduler.bitpool = bitpool;
+    scheduler.statistics.bitpool_changes++;
+    btstack_sbc_encoder_set_bitpool(bitpool);
+}
+
+static void a2dp_source_scheduler_adapt_bitpool(uint32_t now){
+    // packets from previous media clock ticks still waiting
+    if (scheduler.queue_count >= SCHEDULER_CONGESTION_QUEUE_DEPTH){
+        scheduler.congested = 1;
+    }
+    if ((int32_t)(now - scheduler.interval_start_ms) < SCHEDULER_BITPOOL_INTERVAL_MS) return;
+    scheduler.interval_start_ms = now;
+
+    if (scheduler.congested){
+        scheduler.congested = 0;
+        scheduler.intervals_without_congestion = 0;
+        int bitpool = scheduler.bitpool - SCHEDULER_BITPOOL_DECREASE_STEP;
+        a2dp_source_scheduler_set_bitpool(btstack_max(bitpool, scheduler.min_bitpool));
+        return;
+    }
+    scheduler.intervals_without_congestion++;
+    if (scheduler.intervals_without_congestion < SCHEDULER_BITPOOL_INCREASE_INTERVALS) return;
+    scheduler.intervals_without_congestion = 0;
+    int bitpool = scheduler.bitpool + SCHEDULER_BITPOOL_INCREASE_STEP;
+    a2dp_source_scheduler_set_bitpool(btstack_min(bitpool, scheduler.max_bitpool));
+}
+
+// media clock
+
+static void a2dp_source_scheduler_timer_handler(btstack_timer_source_t * timer){
+    UNUSED(timer);
+    if (!scheduler.streaming) return;
+
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint32_t frames_due = (uint32_t) ((uint64_t) (now - scheduler.start_ms) * scheduler.sample_rate / 1000);
+
+    a2dp_source_scheduler_adapt_bitpool(now);
+
+    // skip audio older than max latency
+    uint32_t max_latency_frames = scheduler.max_latency_ms * scheduler.sample_rate / 1000;
+    int32_t  frames_late = (int32_t) (frames_due - scheduler.frames_encoded);
+    uint32_t frames_to_skip = 0;
+    if (frames_late > (int32_t) max_latency_frames){
+        frames_to_skip = (frames_late - max_latency_frames) / scheduler.frames_per_sbc_frame * scheduler.frames_per_sbc_frame;
+    }
+    if (frames_to_skip){
+        if (scheduler.packet_num_frames){
+            // keep RTP timestamps within packet consistent
+            if (scheduler.queue_count < scheduler.queue_size - 1){
+                a2dp_source_scheduler_queue_packet();
+            } else {
+                scheduler.statistics.frames_skipped += scheduler.packet_num_frames * scheduler.frames_per_sbc_frame;
+                scheduler.packet_len = 0;
+                scheduler.packet_num_frames = 0;
+            }
+        }
+        log_debug("a2dp source scheduler: skip %u frames", (unsigned int) frames_to_skip);
+        a2dp_source_scheduler_skip_pcm(frames_to_skip);
+    }
+
+    // encode due audio, tail slot of queue must be free
+    int packets_queued = 0;
+    while ((int32_t) (frames_due - scheduler.frames_encoded) >= (int32_t) scheduler.frames_per_sbc_frame){
+        if (scheduler.queue_count >= scheduler.queue_size - 1) break;
+        a2dp_source_scheduler_encode_frame();
+        if (scheduler.packet_num_frames >= a2dp_source_scheduler_packet_capacity() || scheduler.packet_len + scheduler.sbc_frame_len > scheduler.max_payload_size - 1){
+            a2dp_source_scheduler_queue_packet();
+            packets_queued++;
+        }
+    }
+    if (packets_queued > 1){
+        scheduler.statistics.catch_up_packets += packets_queued - 1;
+    }
+    a2dp_source_scheduler_request_can_send_now();
+
+    // wake up when current packet is complete
+    uint32_t frames_missing = (a2dp_source_scheduler_packet_capacity() - scheduler.packet_num_frames) * scheduler.frames_per_sbc_frame;
+    uint32_t next_ms = scheduler.start_ms + (uint32_t) (((uint64_t) (scheduler.frames_encoded + frames_missing) * 1000 + scheduler.sample_rate - 1) / scheduler.sample_rate);
+    int32_t  timeout_ms = (int32_t) (next_ms - now);
+    if (timeout_ms < 1){
+        // queue full, check again after one SBC frame
+        timeout_ms = btstack_max(1, scheduler.frames_per_sbc_frame * 1000 / scheduler.sample_rate);
+    }
+    btstack_run_loop_set_timer(&scheduler.timer, timeout_ms);
+    btstack_run_loop_add_timer(&scheduler.timer);
+}
+
+static void a2dp_source_scheduler_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_A2DP_META) return;
+    if (packet[2] != A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW) return;
+
+    scheduler.can_send_now_requested = 0;
+    if (!scheduler.streaming) return;
+    if (!scheduler.queue_count) return;
+    a2dp_source_scheduler_send_packet();
+    a2dp_source_scheduler_request_can_send_now();
+}
+
+// API
+
+void a2dp_source_scheduler_init(uint8_t * storage, uint32_t storage_size){
+    memset(&scheduler, 0, sizeof(scheduler));
+    scheduler.storage = storage;
+    scheduler.storage_size = storage_size;
+    scheduler.max_latency_ms = SCHEDULER_DEFAULT_MAX_LATENCY_MS;
+}
+
+void a2dp_source_scheduler_set_pcm_callback(void (*callback)(int16_t * pcm, int num_frames, void * context), void * context){
+    scheduler.pcm_callback = callback;
+    scheduler.pcm_context  = context;
+}
+
+void a2dp_source_scheduler_set_pcm_ring_buffer(btstack_ring_buffer_t * ring_buffer){
+    scheduler.pcm_ring_buffer = ring_buffer;
+}
+
+void a2dp_source_scheduler_set_max_latency(uint16_t max_latency_ms){
+    scheduler.max_latency_ms = max_latency_ms;
+}
+
+uint8_t a2dp_source_scheduler_start(uint8_t local_seid){
+    uint32_t sample_rate;
+    uint8_t  min_bitpool;
+    uint8_t  max_bitpool;
+    if (!a2dp_source_stream_sbc_configuration(local_seid, &sample_rate, &min_bitpool, &max_bitpool)) return ERROR_CODE_COMMAND_DISALLOWED;
+    int max_payload_size = a2dp_max_media_payload_size(local_seid);
+    if (max_payload_size <= 1) return ERROR_CODE_COMMAND_DISALLOWED;
+
+    scheduler.slot_size  = SCHEDULER_SLOT_HEADER_SIZE + max_payload_size;
+    scheduler.queue_size = scheduler.storage_size / scheduler.slot_size;
+    if (scheduler.queue_size < 2){
+        log_error("a2dp source scheduler: storage for %u packets too small", scheduler.queue_size);
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
+    scheduler.local_seid = local_seid;
+    scheduler.sample_rate = sample_rate;
+    scheduler.max_payload_size = max_payload_size;
+    scheduler.frames_per_sbc_frame = btstack_sbc_encoder_num_audio_frames();
+    scheduler.sbc_frame_len = 0;
+    scheduler.min_bitpool = min_bitpool;
+    scheduler.max_bitpool = max_bitpool;
+    scheduler.bitpool = max_bitpool;
+    btstack_sbc_encoder_set_bitpool(max_bitpool);
+    scheduler.congested = 0;
+    scheduler.intervals_without_congestion = 0;
+    scheduler.queue_head = 0;
+    scheduler.queue_count = 0;
+    scheduler.packet_len = 0;
+    scheduler.packet_num_frames = 0;
+    scheduler.can_send_now_requested = 0;
+    scheduler.frames_encoded = 0;
+    scheduler.start_ms = btstack_run_loop_get_time_ms();
+    scheduler.interval_start_ms = scheduler.start_ms;
+    scheduler.streaming = 1;
+
+    log_info("a2dp source scheduler: start, %u Hz, max payload %u, bitpool %u-%u, queue %u packets",
+        (unsigned int) sample_rate, max_payload_size, min_bitpool, max_bitpool, scheduler.queue_size);
+
+    a2dp_source_register_media_packet_handler(&a2dp_source_scheduler_packet_handler);
+    btstack_run_loop_remove_timer(&scheduler.timer);
+    btstack_run_loop_set_timer_handler(&scheduler.timer, &a2dp_source_scheduler_timer_handler);
+    btstack_run_loop_set_timer(&scheduler.timer, 1);
+    btstack_run_loop_add_timer(&scheduler.timer);
+    return ERROR_CODE_SUCCESS;
+}
+
+void a2dp_source_scheduler_stop(void){
+    if (!scheduler.streaming) return;
+    scheduler.streaming = 0;
+    btstack_run_loop_remove_timer(&scheduler.timer);
+    a2dp_source_register_media_packet_handler(NULL);
+}
+
+void a2dp_source_scheduler_get_statistics(a2dp_source_scheduler_statistics_t * statistics){
+    *statistics = scheduler.statistics;
+    statistics->queue_depth = scheduler.queue_count;
+    statistics->queue_size  = scheduler.queue_size ? scheduler.queue_size - 1 : 0;
+    statistics->bitpool     = scheduler.bitpool;
+}
+
+void a2dp_source_scheduler_reset_statistics(void){
+    memset(&scheduler.statistics, 0, sizeof(scheduler.statistics));
+}
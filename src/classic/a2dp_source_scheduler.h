@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ * a2dp_source_scheduler.h
+ *
+ * Media scheduler for A2DP Source
+ *
+ * Pulls PCM audio from a callback or ring buffer, encodes as many SBC frames as fit into
+ * the media MTU and sends the media packets paced by the local media clock:
+ * - packets are encoded when their audio is due, the timer is aligned to the next packet
+ * - after a delay, e.g. by ACL congestion, queued packets are sent back-to-back to catch up,
+ *   audio that is too late is skipped
+ * - the SBC bitpool is lowered while packets pile up in the send queue and raised again
+ *   when the link keeps up
+ *
+ * PCM data is stereo, interleaved, in host endianess. The SBC encoder is configured by
+ * a2dp_source.c when the stream is opened.
+ */
+
+#ifndef __A2DP_SOURCE_SCHEDULER_H
+#define __A2DP_SOURCE_SCHEDULER_H
+
+#include <stdint.h>
+#include "btstack_ring_buffer.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t packets_sent;
+    uint32_t bytes_sent;
+    uint32_t catch_up_packets;      // packets sent back-to-back after a delay
+    uint32_t frames_skipped;        // audio frames skipped as they were too late
+    uint32_t pcm_underruns;         // ring buffer did not provide enough audio, silence was sent
+    uint16_t queue_depth;           // media packets waiting to be sent
+    uint16_t max_queue_depth;
+    uint16_t queue_size;
+    uint16_t bitpool_changes;
+    uint8_t  bitpool;
+} a2dp_source_scheduler_statistics_t;
+
+/* API_START */
+
+/**
+ * @brief Init media scheduler
+ * @param storage for send queue incl. packet being encoded, holds storage_size / (max media payload size + 8) media packets
+ * @param storage_size in bytes
+ */
+void a2dp_source_scheduler_init(uint8_t * storage, uint32_t storage_size);
+
+/**
+ * @brief Provide PCM audio by callback, called when audio is due for encoding
+ * @param callback with buffer for num_frames stereo audio frames
+ * @param context
+ */
+void a2dp_source_scheduler_set_pcm_callback(void (*callback)(int16_t * pcm, int num_frames, void * context), void * context);
+
+/**
+ * @brief Provide PCM audio via ring buffer, e.g. filled by audio capture, silence is sent on underrun
+ * @param ring_buffer
+ */
+void a2dp_source_scheduler_set_pcm_ring_buffer(btstack_ring_buffer_t * ring_buffer);
+
+/**
+ * @brief Set max delay before audio is skipped, default: 100 ms
+ * @param max_latency_ms
+ */
+void a2dp_source_scheduler_set_max_latency(uint16_t max_latency_ms);
+
+/**
+ * @brief Start sending media packets, call after A2DP_SUBEVENT_STREAM_START_ACCEPTED
+ * @param local_seid
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_COMMAND_DISALLOWED if stream is not ready
+ */
+uint8_t a2dp_source_scheduler_start(uint8_t local_seid);
+
+/**
+ * @brief Stop sending media packets, call on A2DP_SUBEVENT_STREAM_SUSPENDED or A2DP_SUBEVENT_STREAM_RELEASED
+ */
+void a2dp_source_scheduler_stop(void);
+
+/**
+ * @brief Get statistics
+ * @param statistics
+ */
+void a2dp_source_scheduler_get_statistics(a2dp_source_scheduler_statistics_t * statistics);
+
+/**
+ * @brief Reset counters in statistics
+ */
+void a2dp_source_scheduler_reset_statistics(void);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __A2DP_SOURCE_SCHEDULER_H
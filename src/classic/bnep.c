@@ -394,28 +394,97 @@ void bnep_request_can_send_now_event(uint16_t bnep_cid)
 }
 
 
+/* Sort filter ranges by start and merge overlapping or adjacent ones, allows for binary search in bnep_filter_protocol */
+static void bnep_compile_net_filter(bnep_channel_t *channel)
+{
+    int i;
+    int j;
+
+    /* Insertion sort, filter lists are short */
+    for (i = 1; i < channel->net_filter_count; i++) {
+        bnep_net_filter_t filter = channel->net_filter[i];
+        for (j = i; j > 0 && channel->net_filter[j-1].range_start > filter.range_start; j--) {
+            channel->net_filter[j] = channel->net_filter[j-1];
+        }
+        channel->net_filter[j] = filter;
+    }
+
+    if (channel->net_filter_count == 0) return;
+
+    j = 0;
+    for (i = 1; i < channel->net_filter_count; i++) {
+        bnep_net_filter_t *last = &channel->net_filter[j];
+        if ((uint32_t) channel->net_filter[i].range_start <= (uint32_t) last->range_end + 1) {
+            if (channel->net_filter[i].range_end > last->range_end) {
+                last->range_end = channel->net_filter[i].range_end;
+            }
+            continue;
+        }
+        channel->net_filter[++j] = channel->net_filter[i];
+    }
+    channel->net_filter_count = j + 1;
+}
+
+/* Sort multicast address ranges by start address and merge overlapping ones, allows for binary search in bnep_filter_multicast */
+static void bnep_compile_multicast_filter(bnep_channel_t *channel)
+{
+    int i;
+    int j;
+
+    for (i = 1; i < channel->multicast_filter_count; i++) {
+        bnep_multi_filter_t filter = channel->multicast_filter[i];
+        for (j = i; j > 0 && memcmp(channel->multicast_filter[j-1].addr_start, filter.addr_start, ETHER_ADDR_LEN) > 0; j--) {
+            channel->multicast_filter[j] = channel->multicast_filter[j-1];
+        }
+        channel->multicast_filter[j] = filter;
+    }
+
+    if (channel->multicast_filter_count == 0) return;
+
+    j = 0;
+    for (i = 1; i < channel->multicast_filter_count; i++) {
+        bnep_multi_filter_t *last = &channel->multicast_filter[j];
+        if (memcmp(channel->multicast_filter[i].addr_start, last->addr_end, ETHER_ADDR_LEN) <= 0) {
+            if (memcmp(channel->multicast_filter[i].addr_end, last->addr_end, ETHER_ADDR_LEN) > 0) {
+                memcpy(last->addr_end, channel->multicast_filter[i].addr_end, ETHER_ADDR_LEN);
+            }
+            continue;
+        }
+        channel->multicast_filter[++j] = channel->multicast_filter[i];
+    }
+    channel->multicast_filter_count = j + 1;
+}
+
 static int bnep_filter_protocol(bnep_channel_t *channel, uint16_t network_protocol_type)
 {
-	int i;
-    
+    int left;
+    int right;
+
     if (channel->net_filter_count == 0) {
         /* No filter set */
         return 1;
     }
 
-    for (i = 0; i < channel->net_filter_count; i ++) {
-        if ((network_protocol_type >= channel->net_filter[i].range_start) &&
-            (network_protocol_type <= channel->net_filter[i].range_end)) {
-            return 1;
+    /* Find last range with range_start <= network_protocol_type */
+    left  = 0;
+    right = channel->net_filter_count - 1;
+    while (left < right) {
+        int middle = (left + right + 1) / 2;
+        if (channel->net_filter[middle].range_start <= network_protocol_type) {
+            left = middle;
+        } else {
+            right = middle - 1;
         }
     }
 
-    return 0;
+    return (network_protocol_type >= channel->net_filter[left].range_start) &&
+           (network_protocol_type <= channel->net_filter[left].range_end);
 }
 
 static int bnep_filter_multicast(bnep_channel_t *channel, bd_addr_t addr_dest)
 {
-	int i;
+    int left;
+    int right;
 
     /* Check if the multicast flag is set int the destination address */
 	if ((addr_dest[0] & 0x01) == 0x00) {
@@ -428,14 +497,20 @@ static int bnep_filter_multicast(bnep_channel_t *channel, bd_addr_t addr_dest)
         return 1;
     }
 
-	for (i = 0; i < channel->multicast_filter_count; i ++) {
-		if ((memcmp(addr_dest, channel->multicast_filter[i].addr_start, sizeof(bd_addr_t)) >= 0) &&
-		    (memcmp(addr_dest, channel->multicast_filter[i].addr_end, sizeof(bd_addr_t)) <= 0)) {
-			return 1;
+    /* Find last range with addr_start <= addr_dest */
+    left  = 0;
+    right = channel->multicast_filter_count - 1;
+    while (left < right) {
+        int middle = (left + right + 1) / 2;
+        if (memcmp(channel->multicast_filter[middle].addr_start, addr_dest, sizeof(bd_addr_t)) <= 0) {
+            left = middle;
+        } else {
+            right = middle - 1;
         }
-	}
+    }
 
-	return 0;
+    return (memcmp(addr_dest, channel->multicast_filter[left].addr_start, sizeof(bd_addr_t)) >= 0) &&
+           (memcmp(addr_dest, channel->multicast_filter[left].addr_end,   sizeof(bd_addr_t)) <= 0);
 }
 
 
@@ -567,6 +642,104 @@ int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len)
 }
 
 
+/* Reserve outgoing buffer for bnep_send_prepared */
+int bnep_reserve_packet_buffer(uint16_t bnep_cid)
+{
+    bnep_channel_t *channel = bnep_channel_for_l2cap_cid(bnep_cid);
+    if (channel == NULL) {
+        log_error("bnep_reserve_packet_buffer cid 0x%02x doesn't exist!", bnep_cid);
+        return 1;
+    }
+
+    if (channel->state != BNEP_CHANNEL_STATE_CONNECTED) {
+        return BNEP_CHANNEL_NOT_CONNECTED;
+    }
+
+    if (!l2cap_can_send_packet_now(channel->l2cap_cid)) {
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+
+    l2cap_reserve_packet_buffer();
+    return 0;
+}
+
+void bnep_release_packet_buffer(void)
+{
+    l2cap_release_packet_buffer();
+}
+
+/* The BNEP General Ethernet header is the packet type followed by the Ethernet header */
+uint8_t * bnep_get_outgoing_ethernet_frame_buffer(void)
+{
+    return l2cap_get_outgoing_buffer() + 1;
+}
+
+/* Send Ethernet frame stored in outgoing buffer as BNEP General Ethernet packet */
+int bnep_send_prepared(uint16_t bnep_cid, uint16_t len)
+{
+    bnep_channel_t *channel;
+    uint8_t        *bnep_out_buffer = l2cap_get_outgoing_buffer();
+    uint8_t        *packet = bnep_out_buffer + 1;
+    uint16_t        pos = 2 * sizeof(bd_addr_t);
+    uint16_t        payload_len;
+    uint16_t        network_protocol_type;
+    int             err;
+
+    channel = bnep_channel_for_l2cap_cid(bnep_cid);
+    if (channel == NULL) {
+        log_error("bnep_send_prepared cid 0x%02x doesn't exist!", bnep_cid);
+        l2cap_release_packet_buffer();
+        return 1;
+    }
+
+    if (len < pos + sizeof(uint16_t)) {
+        l2cap_release_packet_buffer();
+        return 0;
+    }
+
+    network_protocol_type = big_endian_read_16(packet, pos);
+    pos += sizeof(uint16_t);
+    payload_len = len - pos;
+
+    if (network_protocol_type == ETHERTYPE_VLAN) {	/* IEEE 802.1Q tag header */
+        if (payload_len < 4) {
+            /* Omit this packet */
+            l2cap_release_packet_buffer();
+            return 0;
+        }
+        /* The "real" network protocol type is 4 bytes ahead in a VLAN packet */
+        network_protocol_type = big_endian_read_16(packet, pos + 2);
+    }
+
+    /* Check network protocol and multicast filters before sending */
+    if (!bnep_filter_protocol(channel, network_protocol_type) ||
+        !bnep_filter_multicast(channel, packet)) {
+        if (big_endian_read_16(packet, 2 * sizeof(bd_addr_t)) == ETHERTYPE_VLAN) {
+            /* Send IEE802.1Q tag header without ethernet payload, see bnep_send */
+            payload_len = 4;
+        } else {
+            l2cap_release_packet_buffer();
+            return 0;
+        }
+    }
+
+    /* Check for MTU limits */
+    if (payload_len > channel->max_frame_size) {
+        log_error("bnep_send_prepared: Max frame size (%d) exceeded: %d", channel->max_frame_size, payload_len);
+        l2cap_release_packet_buffer();
+        return BNEP_DATA_LEN_EXCEEDS_MTU;
+    }
+
+    /* Destination, source and protocol type are already in place */
+    bnep_out_buffer[0] = BNEP_PKT_TYPE_GENERAL_ETHERNET;
+
+    err = l2cap_send_prepared(channel->l2cap_cid, 1 + pos + payload_len);
+    if (err) {
+        log_error("bnep_send_prepared: error %d", err);
+    }
+    return err;
+}
+
 /* Set BNEP network protocol type filter */
 int bnep_set_net_type_filter(uint16_t bnep_cid, bnep_net_filter_t *filter, uint16_t len)
 {
@@ -946,6 +1119,7 @@ static int bnep_handle_filter_net_type_set(bnep_channel_t *channel, uint8_t *pac
                 channel->net_filter_count ++;
             }
         }
+        bnep_compile_net_filter(channel);
     }
 
     /* Set flag to send out the set net filter response on next statemachine cycle */
@@ -1033,6 +1207,7 @@ static int bnep_handle_multi_addr_set(bnep_channel_t *channel, uint8_t *packet,
                 channel->multicast_filter_count ++;
             }
         }
+        bnep_compile_multicast_filter(channel);
     }
     /* Set flag to send out the set multi addr response on next statemachine cycle */
     bnep_channel_state_add(channel, BNEP_CHANNEL_STATE_VAR_SND_FILTER_MULTI_ADDR_RESPONSE);
@@ -54,8 +54,13 @@
 extern "C" {
 #endif
 
+// number of filter ranges accepted from remote, can be increased in btstack_config.h
+#ifndef MAX_BNEP_NETFILTER
 #define MAX_BNEP_NETFILTER                              8
+#endif
+#ifndef MAX_BNEP_MULTICAST_FILTER
 #define MAX_BNEP_MULTICAST_FILTER                       8
+#endif
 #define MAX_BNEP_NETFILTER_OUT                          421
 #define MAX_BNEP_MULTICAST_FILTER_OUT                   140
 
@@ -121,13 +126,13 @@ typedef struct {
     uint8_t            last_control_type; // type of last control package
     uint16_t           response_code;     // response code of last action (temp. storage for state machine)
 
-    bnep_net_filter_t  net_filter[MAX_BNEP_NETFILTER];              // network protocol filter, define fixed size for now
+    bnep_net_filter_t  net_filter[MAX_BNEP_NETFILTER];              // network protocol filter, sorted and merged, define fixed size for now
     uint16_t           net_filter_count;
 
     bnep_net_filter_t *net_filter_out;                              // outgoint network protocol filter, must be statically allocated in the application
     uint16_t           net_filter_out_count;
     
-    bnep_multi_filter_t  multicast_filter[MAX_BNEP_MULTICAST_FILTER]; // multicast address filter, define fixed size for now
+    bnep_multi_filter_t  multicast_filter[MAX_BNEP_MULTICAST_FILTER]; // multicast address filter, sorted and merged, define fixed size for now
     uint16_t             multicast_filter_count;
     
     bnep_multi_filter_t *multicast_filter_out;                        // outgoing multicast address filter, must be statically allocated in the application
@@ -182,6 +187,29 @@ void bnep_request_can_send_now_event(uint16_t bnep_cid);
  */
 int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len);
 
+/**
+ * @brief Reserve outgoing packet buffer to send an Ethernet frame without extra copy via bnep_send_prepared.
+ * @note Only one buffer can be reserved at a time, it's shared with L2CAP
+ * @return 0 if ok
+ */
+int bnep_reserve_packet_buffer(uint16_t bnep_cid);
+
+/**
+ * @brief Release outgoing packet buffer reserved with bnep_reserve_packet_buffer without sending.
+ */
+void bnep_release_packet_buffer(void);
+
+/**
+ * @brief Get location in reserved outgoing packet buffer where the Ethernet frame is stored.
+ */
+uint8_t * bnep_get_outgoing_ethernet_frame_buffer(void);
+
+/**
+ * @brief Send Ethernet frame stored in reserved outgoing packet buffer. Buffer is released if frame is filtered out.
+ * @param len of Ethernet frame
+ */
+int bnep_send_prepared(uint16_t bnep_cid, uint16_t len);
+
 /**
  * @brief Set the network protocol filter.
  */
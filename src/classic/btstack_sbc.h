@@ -50,6 +50,16 @@
 extern "C" {
 #endif
 
+// number of concurrent decoders, e.g. one per SCO connection
+#ifndef MAX_NR_BTSTACK_SBC_DECODERS
+#define MAX_NR_BTSTACK_SBC_DECODERS 1
+#endif
+
+// number of concurrent encoders, e.g. one per SCO connection
+#ifndef MAX_NR_BTSTACK_SBC_ENCODERS
+#define MAX_NR_BTSTACK_SBC_ENCODERS 1
+#endif
+
 typedef enum{
     SBC_MODE_STANDARD,
     SBC_MODE_mSBC
@@ -84,9 +94,10 @@ typedef struct {
  * @param mode
  * @param callback for decoded PCM data in host endianess
  * @param context provided in callback
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if all MAX_NR_BTSTACK_SBC_DECODERS are in use
  */
 
-void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context);
+uint8_t btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context);
 
 /**
  * @brief Process received SCO data
@@ -112,6 +123,12 @@ int btstack_sbc_decoder_num_channels(btstack_sbc_decoder_state_t * state);
  */
 int btstack_sbc_decoder_sample_rate(btstack_sbc_decoder_state_t * state);
 
+/**
+ * @brief Release decoder storage, see MAX_NR_BTSTACK_SBC_DECODERS
+ * @param state
+ */
+void btstack_sbc_decoder_deinit(btstack_sbc_decoder_state_t * state);
+
 
 /* BTstack SBC Encoder */
 /**
@@ -123,12 +140,38 @@ int btstack_sbc_decoder_sample_rate(btstack_sbc_decoder_state_t * state);
  * @param allocation_method
  * @param sample_rate
  * @param bitpool
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if all MAX_NR_BTSTACK_SBC_ENCODERS are in use
  */
-void btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
+uint8_t btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
                         int blocks, int subbands, int allocation_method, int sample_rate, int bitpool);
 
 /**
- * @brief Encode PCM data
+ * @brief Release encoder storage, see MAX_NR_BTSTACK_SBC_ENCODERS
+ * @param state
+ */
+void btstack_sbc_encoder_deinit(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Encode PCM data with given encoder
+ * @param state
+ * @param buffer with samples in host endianess
+ */
+void btstack_sbc_encoder_process_data_for_state(btstack_sbc_encoder_state_t * state, int16_t * input_buffer);
+
+/**
+ * @brief Return SBC frame of given encoder
+ * @param state
+ */
+uint8_t * btstack_sbc_encoder_sbc_buffer_for_state(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Return SBC frame length of given encoder
+ * @param state
+ */
+uint16_t  btstack_sbc_encoder_sbc_buffer_length_for_state(btstack_sbc_encoder_state_t * state);
+
+/**
+ * @brief Encode PCM data with last initialized encoder
  * @param buffer with samples in host endianess
  */
 void btstack_sbc_encoder_process_data(int16_t * input_buffer);
@@ -149,6 +192,12 @@ uint16_t  btstack_sbc_encoder_sbc_buffer_length(void);
  */
 int  btstack_sbc_encoder_num_audio_frames(void);
 
+/**
+ * @brief Change bitpool of SBC encoder, e.g. to adapt to available bandwidth
+ * @param bitpool
+ */
+void btstack_sbc_encoder_set_bitpool(int bitpool);
+
 /* API_END */
 
 // testing only
@@ -82,8 +82,8 @@ typedef struct {
     int first_good_frame_found; 
 } bludroid_decoder_state_t;
 
-static btstack_sbc_decoder_state_t * sbc_decoder_state_singleton = NULL;
-static bludroid_decoder_state_t bd_decoder_state;
+static btstack_sbc_decoder_state_t * bd_decoder_state_owner[MAX_NR_BTSTACK_SBC_DECODERS];
+static bludroid_decoder_state_t bd_decoder_state_storage[MAX_NR_BTSTACK_SBC_DECODERS];
 
 // Testing only - START
 static int plc_enabled = 1;
@@ -103,8 +103,10 @@ typedef struct {
     uint8_t sbc_packet[1000];
 } bludroid_encoder_state_t;
 
+// last initialized encoder, used by the API without encoder state
 static btstack_sbc_encoder_state_t * sbc_encoder_state_singleton = NULL;
-static bludroid_encoder_state_t bd_encoder_state;
+static btstack_sbc_encoder_state_t * bd_encoder_state_owner[MAX_NR_BTSTACK_SBC_ENCODERS];
+static bludroid_encoder_state_t bd_encoder_state_storage[MAX_NR_BTSTACK_SBC_ENCODERS];
 
 // SBC encoder start
 // *****************************************************************************
@@ -186,18 +188,38 @@ void OI_AssertFail(const char* file, int line, const char* reason){
 }
 #endif
 
-void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context){
-    if (sbc_decoder_state_singleton && sbc_decoder_state_singleton != state ){
-        log_error("SBC decoder: different sbc decoder state is allready registered");
-    } 
+static bludroid_decoder_state_t * btstack_sbc_decoder_storage_for_state(btstack_sbc_decoder_state_t * state){
+    int i;
+    int free_index = -1;
+    for (i=0;i<MAX_NR_BTSTACK_SBC_DECODERS;i++){
+        if (bd_decoder_state_owner[i] == state) return &bd_decoder_state_storage[i];
+        if (free_index < 0 && bd_decoder_state_owner[i] == NULL){
+            free_index = i;
+        }
+    }
+    if (free_index < 0){
+        log_error("SBC decoder: all %u decoders in use", MAX_NR_BTSTACK_SBC_DECODERS);
+        return NULL;
+    }
+    bd_decoder_state_owner[free_index] = state;
+    return &bd_decoder_state_storage[free_index];
+}
+
+uint8_t btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_mode_t mode, void (*callback)(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context), void * context){
+    bludroid_decoder_state_t * bd_decoder_state = btstack_sbc_decoder_storage_for_state(state);
+    if (!bd_decoder_state){
+        memset(state, 0, sizeof(btstack_sbc_decoder_state_t));
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
+    }
+
     OI_STATUS status = OI_STATUS_SUCCESS;
     switch (mode){
         case SBC_MODE_STANDARD:
             // note: we always request stereo output, even for mono input
-            status = OI_CODEC_SBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data), 2, 2, FALSE);
+            status = OI_CODEC_SBC_DecoderReset(&(bd_decoder_state->decoder_context), bd_decoder_state->decoder_data, sizeof(bd_decoder_state->decoder_data), 2, 2, FALSE);
             break;
         case SBC_MODE_mSBC:
-            status = OI_CODEC_mSBC_DecoderReset(&(bd_decoder_state.decoder_context), bd_decoder_state.decoder_data, sizeof(bd_decoder_state.decoder_data));
+            status = OI_CODEC_mSBC_DecoderReset(&(bd_decoder_state->decoder_context), bd_decoder_state->decoder_data, sizeof(bd_decoder_state->decoder_data));
             break;
         default:
             break;
@@ -207,24 +229,32 @@ void btstack_sbc_decoder_init(btstack_sbc_decoder_state_t * state, btstack_sbc_m
         log_error("SBC decoder: error during reset %d\n", status);
     }
     
-    sbc_decoder_state_singleton = state;
-    
-    bd_decoder_state.bytes_in_frame_buffer = 0;
-    bd_decoder_state.pcm_bytes = sizeof(bd_decoder_state.pcm_data);
-    bd_decoder_state.h2_sequence_nr = -1;
-    bd_decoder_state.sync_word_found = 0;
-    bd_decoder_state.search_new_sync_word = 0;
+    bd_decoder_state->bytes_in_frame_buffer = 0;
+    bd_decoder_state->pcm_bytes = sizeof(bd_decoder_state->pcm_data);
+    bd_decoder_state->h2_sequence_nr = -1;
+    bd_decoder_state->sync_word_found = 0;
+    bd_decoder_state->search_new_sync_word = 0;
     if (mode == SBC_MODE_mSBC){
-        bd_decoder_state.search_new_sync_word = 1;
+        bd_decoder_state->search_new_sync_word = 1;
     }
-    bd_decoder_state.first_good_frame_found = 0;
+    bd_decoder_state->first_good_frame_found = 0;
 
     memset(state, 0, sizeof(btstack_sbc_decoder_state_t));
     state->handle_pcm_data = callback;
     state->mode = mode;
     state->context = context;
-    state->decoder_state = &bd_decoder_state;
+    state->decoder_state = bd_decoder_state;
     btstack_sbc_plc_init(&state->plc_state);
+    return ERROR_CODE_SUCCESS;
+}
+
+void btstack_sbc_decoder_deinit(btstack_sbc_decoder_state_t * state){
+    int i;
+    for (i=0;i<MAX_NR_BTSTACK_SBC_DECODERS;i++){
+        if (bd_decoder_state_owner[i] != state) continue;
+        bd_decoder_state_owner[i] = NULL;
+    }
+    state->decoder_state = NULL;
 }
 
 static void append_received_sbc_data(bludroid_decoder_state_t * state, uint8_t * buffer, int size){
@@ -490,6 +520,7 @@ static void btstack_sbc_decoder_process_msbc_data(btstack_sbc_decoder_state_t *
 }
 
 void btstack_sbc_decoder_process_data(btstack_sbc_decoder_state_t * state, int packet_status_flag, uint8_t * buffer, int size){
+    if (!state->decoder_state) return;
     if (state->mode == SBC_MODE_mSBC){
         btstack_sbc_decoder_process_msbc_data(state, packet_status_flag, buffer, size);
     } else {
@@ -502,63 +533,92 @@ void btstack_sbc_decoder_process_data(btstack_sbc_decoder_state_t * state, int p
 //
 // *****************************************************************************
 
-void btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
-                        int blocks, int subbands, int allmethod, int sample_rate, int bitpool){
+static bludroid_encoder_state_t * btstack_sbc_encoder_storage_for_state(btstack_sbc_encoder_state_t * state){
+    int i;
+    int free_index = -1;
+    for (i=0;i<MAX_NR_BTSTACK_SBC_ENCODERS;i++){
+        if (bd_encoder_state_owner[i] == state) return &bd_encoder_state_storage[i];
+        if (free_index < 0 && bd_encoder_state_owner[i] == NULL){
+            free_index = i;
+        }
+    }
+    if (free_index < 0){
+        log_error("SBC encoder: all %u encoders in use", MAX_NR_BTSTACK_SBC_ENCODERS);
+        return NULL;
+    }
+    bd_encoder_state_owner[free_index] = state;
+    return &bd_encoder_state_storage[free_index];
+}
 
-    if (sbc_encoder_state_singleton && sbc_encoder_state_singleton != state ){
-        log_error("SBC encoder: different sbc decoder state is allready registered");
-    } 
-    
-    sbc_encoder_state_singleton = state;
+uint8_t btstack_sbc_encoder_init(btstack_sbc_encoder_state_t * state, btstack_sbc_mode_t mode, 
+                        int blocks, int subbands, int allmethod, int sample_rate, int bitpool){
 
-    if (!sbc_encoder_state_singleton){
+    if (!state){
         log_error("SBC encoder init: sbc state is NULL");
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+
+    bludroid_encoder_state_t * bd_encoder_state = btstack_sbc_encoder_storage_for_state(state);
+    if (!bd_encoder_state){
+        state->encoder_state = NULL;
+        return ERROR_CODE_MEMORY_CAPACITY_EXCEEDED;
     }
 
-    sbc_encoder_state_singleton->mode = mode;
+    sbc_encoder_state_singleton = state;
 
-    switch (sbc_encoder_state_singleton->mode){
+    state->mode = mode;
+
+    switch (state->mode){
         case SBC_MODE_STANDARD:
-            bd_encoder_state.context.s16NumOfBlocks = blocks;                          
-            bd_encoder_state.context.s16NumOfSubBands = subbands;                       
-            bd_encoder_state.context.s16AllocationMethod = allmethod;                     
-            bd_encoder_state.context.s16BitPool = bitpool;  
-            bd_encoder_state.context.mSBCEnabled = 0;
-            bd_encoder_state.context.s16ChannelMode = SBC_STEREO;
-            bd_encoder_state.context.s16NumOfChannels = 2;
+            bd_encoder_state->context.s16NumOfBlocks = blocks;                          
+            bd_encoder_state->context.s16NumOfSubBands = subbands;                       
+            bd_encoder_state->context.s16AllocationMethod = allmethod;                     
+            bd_encoder_state->context.s16BitPool = bitpool;  
+            bd_encoder_state->context.mSBCEnabled = 0;
+            bd_encoder_state->context.s16ChannelMode = SBC_STEREO;
+            bd_encoder_state->context.s16NumOfChannels = 2;
             
             switch(sample_rate){
-                case 16000: bd_encoder_state.context.s16SamplingFreq = SBC_sf16000; break;
-                case 32000: bd_encoder_state.context.s16SamplingFreq = SBC_sf32000; break;
-                case 44100: bd_encoder_state.context.s16SamplingFreq = SBC_sf44100; break;
-                case 48000: bd_encoder_state.context.s16SamplingFreq = SBC_sf48000; break;
-                default: bd_encoder_state.context.s16SamplingFreq = 0; break;
+                case 16000: bd_encoder_state->context.s16SamplingFreq = SBC_sf16000; break;
+                case 32000: bd_encoder_state->context.s16SamplingFreq = SBC_sf32000; break;
+                case 44100: bd_encoder_state->context.s16SamplingFreq = SBC_sf44100; break;
+                case 48000: bd_encoder_state->context.s16SamplingFreq = SBC_sf48000; break;
+                default: bd_encoder_state->context.s16SamplingFreq = 0; break;
             }
             break;
         case SBC_MODE_mSBC:
-            bd_encoder_state.context.s16NumOfBlocks    = 15;
-            bd_encoder_state.context.s16NumOfSubBands  = 8;
-            bd_encoder_state.context.s16AllocationMethod = SBC_LOUDNESS;
-            bd_encoder_state.context.s16BitPool   = 26;
-            bd_encoder_state.context.s16ChannelMode = SBC_MONO;
-            bd_encoder_state.context.s16NumOfChannels = 1;
-            bd_encoder_state.context.mSBCEnabled = 1;
-            bd_encoder_state.context.s16SamplingFreq = SBC_sf16000;
+            bd_encoder_state->context.s16NumOfBlocks    = 15;
+            bd_encoder_state->context.s16NumOfSubBands  = 8;
+            bd_encoder_state->context.s16AllocationMethod = SBC_LOUDNESS;
+            bd_encoder_state->context.s16BitPool   = 26;
+            bd_encoder_state->context.s16ChannelMode = SBC_MONO;
+            bd_encoder_state->context.s16NumOfChannels = 1;
+            bd_encoder_state->context.mSBCEnabled = 1;
+            bd_encoder_state->context.s16SamplingFreq = SBC_sf16000;
             break;
     }
-    bd_encoder_state.context.pu8Packet = bd_encoder_state.sbc_packet;
+    bd_encoder_state->context.pu8Packet = bd_encoder_state->sbc_packet;
     
-    sbc_encoder_state_singleton->encoder_state = &bd_encoder_state;
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
-    SBC_Encoder_Init(context);
+    state->encoder_state = bd_encoder_state;
+    SBC_Encoder_Init(&bd_encoder_state->context);
+    return ERROR_CODE_SUCCESS;
 }
 
-
-void btstack_sbc_encoder_process_data(int16_t * input_buffer){
-    if (!sbc_encoder_state_singleton){
-        log_error("SBC encoder: sbc state is NULL, call btstack_sbc_encoder_init to initialize it");
+void btstack_sbc_encoder_deinit(btstack_sbc_encoder_state_t * state){
+    int i;
+    for (i=0;i<MAX_NR_BTSTACK_SBC_ENCODERS;i++){
+        if (bd_encoder_state_owner[i] != state) continue;
+        bd_encoder_state_owner[i] = NULL;
     }
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
+    state->encoder_state = NULL;
+    if (sbc_encoder_state_singleton == state){
+        sbc_encoder_state_singleton = NULL;
+    }
+}
+
+void btstack_sbc_encoder_process_data_for_state(btstack_sbc_encoder_state_t * state, int16_t * input_buffer){
+    if (!state->encoder_state) return;
+    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)state->encoder_state)->context;
     context->ps16PcmBuffer = input_buffer;
     if (context->mSBCEnabled){
         context->pu8Packet[0] = 0xad;
@@ -566,17 +626,39 @@ void btstack_sbc_encoder_process_data(int16_t * input_buffer){
     SBC_Encoder(context);
 }
 
+uint8_t * btstack_sbc_encoder_sbc_buffer_for_state(btstack_sbc_encoder_state_t * state){
+    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)state->encoder_state)->context;
+    return context->pu8Packet;
+}
+
+uint16_t btstack_sbc_encoder_sbc_buffer_length_for_state(btstack_sbc_encoder_state_t * state){
+    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)state->encoder_state)->context;
+    return context->u16PacketLength;
+}
+
+void btstack_sbc_encoder_process_data(int16_t * input_buffer){
+    if (!sbc_encoder_state_singleton){
+        log_error("SBC encoder: sbc state is NULL, call btstack_sbc_encoder_init to initialize it");
+        return;
+    }
+    btstack_sbc_encoder_process_data_for_state(sbc_encoder_state_singleton, input_buffer);
+}
+
 int btstack_sbc_encoder_num_audio_frames(void){
     SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
     return context->s16NumOfSubBands * context->s16NumOfBlocks;
 }
 
-uint8_t * btstack_sbc_encoder_sbc_buffer(void){
+void btstack_sbc_encoder_set_bitpool(int bitpool){
+    // bitpool is used for bit allocation and packing of each frame, no re-init required
     SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
-    return context->pu8Packet;
+    context->s16BitPool = bitpool;
+}
+
+uint8_t * btstack_sbc_encoder_sbc_buffer(void){
+    return btstack_sbc_encoder_sbc_buffer_for_state(sbc_encoder_state_singleton);
 }
 
 uint16_t  btstack_sbc_encoder_sbc_buffer_length(void){
-    SBC_ENC_PARAMS * context = &((bludroid_encoder_state_t *)sbc_encoder_state_singleton->encoder_state)->context;
-    return context->u16PacketLength;
+    return btstack_sbc_encoder_sbc_buffer_length_for_state(sbc_encoder_state_singleton);
 }
@@ -0,0 +1,474 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+#define __BTSTACK_FILE__ "hfp_ag_media.c"
+
+/*
+ * hfp_ag_media.c
+ *
+ * Each link owns its codec contexts and an outgoing mix buffer at the sample rate of the link.
+ * Decoded audio of a link is added to the mix buffers of all other links in its mixer group.
+ * Every source, i.e. another link or the local audio, has its own write position in a mix
+ * buffer, so sources that deliver audio in different frame sizes are mixed sample-aligned.
+ * Samples are taken from the mix buffer when a packet is sent, which also advances all
+ * write positions.
+ */
+
+#include <string.h>
+
+#include "btstack_config.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "classic/btstack_cvsd_plc.h"
+#include "classic/btstack_sbc.h"
+#include "classic/hfp.h"
+#include "classic/hfp_ag_media.h"
+#include "classic/hfp_msbc.h"
+
+// each mSBC link owns an SBC encoder and decoder
+#if (MAX_NR_BTSTACK_SBC_ENCODERS < MAX_NR_HFP_AG_MEDIA_LINKS) || (MAX_NR_BTSTACK_SBC_DECODERS < MAX_NR_HFP_AG_MEDIA_LINKS)
+#error "MAX_NR_BTSTACK_SBC_ENCODERS and MAX_NR_BTSTACK_SBC_DECODERS must not be smaller than MAX_NR_HFP_AG_MEDIA_LINKS"
+#endif
+
+#define HFP_AG_MEDIA_CVSD_SAMPLE_RATE   8000
+#define HFP_AG_MEDIA_MSBC_SAMPLE_RATE  16000
+
+// 30 ms at 16 kHz
+#define HFP_AG_MEDIA_MIX_BUFFER_SAMPLES  480
+
+#define HFP_AG_MEDIA_MSBC_SAMPLES_PER_FRAME 120
+#define HFP_AG_MEDIA_MAX_CVSD_SAMPLES_PER_PACKET 128
+
+// source index for local audio
+#define HFP_AG_MEDIA_LOCAL_SOURCE MAX_NR_HFP_AG_MEDIA_LINKS
+
+// air mode in HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE
+#define HFP_AG_MEDIA_AIR_MODE_CVSD         0x02
+#define HFP_AG_MEDIA_AIR_MODE_TRANSPARENT  0x03
+
+typedef struct {
+    uint8_t  in_use;
+    hci_con_handle_t sco_handle;
+    uint8_t  codec;
+    uint8_t  mixer_group;
+    uint16_t sample_rate;
+
+    // packets are sent in response to received ones with the same size
+    uint16_t packets_to_send;
+    uint16_t payload_size;
+
+    // mSBC
+    hfp_msbc_encoder_t          msbc_encoder;
+    btstack_sbc_decoder_state_t msbc_decoder;
+
+    // CVSD, packet loss concealment works on frames of CVSD_FS samples
+    btstack_cvsd_plc_state_t cvsd_plc;
+    int16_t  cvsd_frame[CVSD_FS];
+    uint16_t cvsd_frame_samples;
+
+    // outgoing audio
+    int16_t  mix_buffer[HFP_AG_MEDIA_MIX_BUFFER_SAMPLES];
+    uint16_t mix_samples;
+    uint16_t mix_write_pos[MAX_NR_HFP_AG_MEDIA_LINKS + 1];
+
+    uint32_t packets_received;
+    uint32_t packets_sent;
+    uint32_t frames_encoded;
+    uint32_t mixer_underruns;
+    uint32_t mixer_overruns;
+} hfp_ag_media_link_t;
+
+static hfp_ag_media_link_t hfp_ag_media_links[MAX_NR_HFP_AG_MEDIA_LINKS];
+static int hfp_ag_media_next_link_to_send;
+static uint8_t hfp_ag_media_next_mixer_group;
+static void (*hfp_ag_media_pcm_handler)(hci_con_handle_t sco_handle, int16_t * samples, int num_samples, int sample_rate);
+static btstack_packet_callback_registration_t hfp_ag_media_hci_event_callback_registration;
+
+static hfp_ag_media_link_t * hfp_ag_media_link_for_sco_handle(hci_con_handle_t sco_handle){
+    int i;
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        hfp_ag_media_link_t * link = &hfp_ag_media_links[i];
+        if (link->in_use && link->sco_handle == sco_handle) return link;
+    }
+    return NULL;
+}
+
+static int16_t hfp_ag_media_saturate(int32_t sample){
+    if (sample >  32767) return  32767;
+    if (sample < -32768) return -32768;
+    return (int16_t) sample;
+}
+
+static int hfp_ag_media_mixer_add_sample(hfp_ag_media_link_t * link, int source, int16_t sample){
+    uint16_t pos = link->mix_write_pos[source];
+    if (pos >= HFP_AG_MEDIA_MIX_BUFFER_SAMPLES){
+        link->mixer_overruns++;
+        return 0;
+    }
+    link->mix_buffer[pos] = hfp_ag_media_saturate((int32_t) link->mix_buffer[pos] + sample);
+    pos++;
+    link->mix_write_pos[source] = pos;
+    if (pos > link->mix_samples){
+        link->mix_samples = pos;
+    }
+    return 1;
+}
+
+// add audio to outgoing audio of link, converts between 8 and 16 kHz, returns number of input samples added
+static int hfp_ag_media_mixer_add(hfp_ag_media_link_t * link, int source, const int16_t * samples, int num_samples, int sample_rate){
+    int samples_added = 0;
+    int i;
+    if (sample_rate == link->sample_rate){
+        for (i=0;i<num_samples;i++){
+            samples_added += hfp_ag_media_mixer_add_sample(link, source, samples[i]);
+        }
+        return samples_added;
+    }
+    if (sample_rate * 2 == link->sample_rate){
+        for (i=0;i<num_samples;i++){
+            samples_added += hfp_ag_media_mixer_add_sample(link, source, samples[i]);
+            hfp_ag_media_mixer_add_sample(link, source, samples[i]);
+        }
+        return samples_added;
+    }
+    if (sample_rate == link->sample_rate * 2){
+        for (i=0;i+1<num_samples;i+=2){
+            samples_added += 2 * hfp_ag_media_mixer_add_sample(link, source, (int16_t) (((int32_t) samples[i] + samples[i+1]) / 2));
+        }
+        return samples_added;
+    }
+    log_error("HFP AG Media: cannot mix audio with %u hz into link with %u hz", sample_rate, link->sample_rate);
+    return 0;
+}
+
+static void hfp_ag_media_mixer_read(hfp_ag_media_link_t * link, int16_t * samples, int num_samples){
+    int samples_available = btstack_min(num_samples, link->mix_samples);
+    memcpy(samples, link->mix_buffer, samples_available * sizeof(int16_t));
+    if (samples_available < num_samples){
+        memset(&samples[samples_available], 0, (num_samples - samples_available) * sizeof(int16_t));
+        link->mixer_underruns += num_samples - samples_available;
+    }
+    // drop samples and clear freed space for mixing
+    uint16_t samples_remaining = link->mix_samples - samples_available;
+    memmove(link->mix_buffer, &link->mix_buffer[samples_available], samples_remaining * sizeof(int16_t));
+    memset(&link->mix_buffer[samples_remaining], 0, samples_available * sizeof(int16_t));
+    link->mix_samples = samples_remaining;
+    int i;
+    for (i=0;i<=MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        if (link->mix_write_pos[i] > samples_available){
+            link->mix_write_pos[i] -= samples_available;
+        } else {
+            link->mix_write_pos[i] = 0;
+        }
+    }
+}
+
+// provide decoded audio of link to application and other links in its mixer group
+static void hfp_ag_media_deliver_audio(hfp_ag_media_link_t * link, int16_t * samples, int num_samples){
+    if (hfp_ag_media_pcm_handler){
+        (*hfp_ag_media_pcm_handler)(link->sco_handle, samples, num_samples, link->sample_rate);
+    }
+    if (link->mixer_group == 0) return;
+    int source = link - hfp_ag_media_links;
+    int i;
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        hfp_ag_media_link_t * other = &hfp_ag_media_links[i];
+        if (!other->in_use) continue;
+        if (other == link) continue;
+        if (other->mixer_group != link->mixer_group) continue;
+        hfp_ag_media_mixer_add(other, source, samples, num_samples, link->sample_rate);
+    }
+}
+
+static void hfp_ag_media_handle_msbc_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    UNUSED(num_channels);
+    UNUSED(sample_rate);
+    hfp_ag_media_deliver_audio((hfp_ag_media_link_t *) context, data, num_samples);
+}
+
+static void hfp_ag_media_link_open(hci_con_handle_t sco_handle, uint8_t codec){
+    hfp_ag_media_link_t * link = hfp_ag_media_link_for_sco_handle(sco_handle);
+    if (!link){
+        int i;
+        for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+            if (hfp_ag_media_links[i].in_use) continue;
+            link = &hfp_ag_media_links[i];
+            break;
+        }
+    }
+    if (!link){
+        log_error("HFP AG Media: no free link for SCO handle 0x%04x, MAX_NR_HFP_AG_MEDIA_LINKS %u", sco_handle, MAX_NR_HFP_AG_MEDIA_LINKS);
+        return;
+    }
+    memset(link, 0, sizeof(hfp_ag_media_link_t));
+    link->sco_handle = sco_handle;
+    link->codec = codec;
+    switch (codec){
+        case HFP_CODEC_MSBC:
+            link->sample_rate = HFP_AG_MEDIA_MSBC_SAMPLE_RATE;
+            if ((hfp_msbc_encoder_init(&link->msbc_encoder) != ERROR_CODE_SUCCESS)
+            ||  (btstack_sbc_decoder_init(&link->msbc_decoder, SBC_MODE_mSBC, &hfp_ag_media_handle_msbc_pcm_data, link) != ERROR_CODE_SUCCESS)){
+                hfp_msbc_encoder_deinit(&link->msbc_encoder);
+                btstack_sbc_decoder_deinit(&link->msbc_decoder);
+                log_error("HFP AG Media: no mSBC codec available for SCO handle 0x%04x", sco_handle);
+                return;
+            }
+            break;
+        default:
+            link->sample_rate = HFP_AG_MEDIA_CVSD_SAMPLE_RATE;
+            btstack_cvsd_plc_init(&link->cvsd_plc);
+            break;
+    }
+    link->in_use = 1;
+    log_info("HFP AG Media: link for SCO handle 0x%04x, codec %u", sco_handle, codec);
+}
+
+static void hfp_ag_media_link_close(hfp_ag_media_link_t * link){
+    if (link->codec == HFP_CODEC_MSBC){
+        hfp_msbc_encoder_deinit(&link->msbc_encoder);
+        btstack_sbc_decoder_deinit(&link->msbc_decoder);
+    }
+    link->in_use = 0;
+    // forget write position of link in other mix buffers
+    int source = link - hfp_ag_media_links;
+    int i;
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        hfp_ag_media_links[i].mix_write_pos[source] = 0;
+    }
+    log_info("HFP AG Media: link for SCO handle 0x%04x closed", link->sco_handle);
+}
+
+static void hfp_ag_media_receive_cvsd(hfp_ag_media_link_t * link, const uint8_t * payload, int size){
+    int num_samples = size / 2;
+    int i;
+    for (i=0;i<num_samples;i++){
+        link->cvsd_frame[link->cvsd_frame_samples++] = (int16_t) little_endian_read_16(payload, i * 2);
+        if (link->cvsd_frame_samples < CVSD_FS) continue;
+        int16_t audio_frame_out[CVSD_FS];
+        memset(audio_frame_out, 0, sizeof(audio_frame_out));
+        btstack_cvsd_plc_process_data(&link->cvsd_plc, link->cvsd_frame, CVSD_FS, audio_frame_out);
+        link->cvsd_frame_samples = 0;
+        hfp_ag_media_deliver_audio(link, audio_frame_out, CVSD_FS);
+    }
+}
+
+static void hfp_ag_media_send_packet(hfp_ag_media_link_t * link){
+    int payload_size = link->payload_size;
+    hci_reserve_packet_buffer();
+    uint8_t * sco_packet = hci_get_outgoing_packet_buffer();
+    int i;
+    switch (link->codec){
+        case HFP_CODEC_MSBC:
+            payload_size = btstack_min(payload_size, sizeof(link->msbc_encoder.buffer));
+            while (hfp_msbc_encoder_num_bytes_in_stream(&link->msbc_encoder) < payload_size 
+               &&  hfp_msbc_encoder_can_encode_audio_frame_now(&link->msbc_encoder)){
+                int16_t audio_frame[HFP_AG_MEDIA_MSBC_SAMPLES_PER_FRAME];
+                hfp_ag_media_mixer_read(link, audio_frame, HFP_AG_MEDIA_MSBC_SAMPLES_PER_FRAME);
+                hfp_msbc_encoder_encode_audio_frame(&link->msbc_encoder, audio_frame);
+                link->frames_encoded++;
+            }
+            hfp_msbc_encoder_read_from_stream(&link->msbc_encoder, &sco_packet[3], payload_size);
+            break;
+        default: {
+            int num_samples = btstack_min(payload_size / 2, HFP_AG_MEDIA_MAX_CVSD_SAMPLES_PER_PACKET);
+            int16_t audio_frame[HFP_AG_MEDIA_MAX_CVSD_SAMPLES_PER_PACKET];
+            hfp_ag_media_mixer_read(link, audio_frame, num_samples);
+            for (i=0;i<num_samples;i++){
+                little_endian_store_16(sco_packet, 3 + i * 2, (uint16_t) audio_frame[i]);
+            }
+            payload_size = num_samples * 2;
+            break;
+        }
+    }
+    little_endian_store_16(sco_packet, 0, link->sco_handle);
+    sco_packet[2] = payload_size;
+    hci_send_sco_packet_buffer(3 + payload_size);
+    link->packets_to_send--;
+    link->packets_sent++;
+}
+
+static void hfp_ag_media_handle_sco_can_send_now(void){
+    // round robin over links with pending packets
+    int i;
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        int index = (hfp_ag_media_next_link_to_send + i) % MAX_NR_HFP_AG_MEDIA_LINKS;
+        hfp_ag_media_link_t * link = &hfp_ag_media_links[index];
+        if (!link->in_use) continue;
+        if (link->packets_to_send == 0) continue;
+        hfp_ag_media_send_packet(link);
+        hfp_ag_media_next_link_to_send = (index + 1) % MAX_NR_HFP_AG_MEDIA_LINKS;
+        break;
+    }
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        hfp_ag_media_link_t * link = &hfp_ag_media_links[i];
+        if (!link->in_use) continue;
+        if (link->packets_to_send == 0) continue;
+        hci_request_sco_can_send_now_event();
+        break;
+    }
+}
+
+static void hfp_ag_media_hci_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    hfp_ag_media_link_t * link;
+    switch (hci_event_packet_get_type(packet)){
+        case HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE:
+            if (hci_event_synchronous_connection_complete_get_status(packet)) break;
+            switch (hci_event_synchronous_connection_complete_get_air_mode(packet)){
+                case HFP_AG_MEDIA_AIR_MODE_CVSD:
+                    hfp_ag_media_link_open(hci_event_synchronous_connection_complete_get_handle(packet), HFP_CODEC_CVSD);
+                    break;
+                case HFP_AG_MEDIA_AIR_MODE_TRANSPARENT:
+                    hfp_ag_media_link_open(hci_event_synchronous_connection_complete_get_handle(packet), HFP_CODEC_MSBC);
+                    break;
+                default:
+                    log_info("HFP AG Media: air mode %u not supported", hci_event_synchronous_connection_complete_get_air_mode(packet));
+                    break;
+            }
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            link = hfp_ag_media_link_for_sco_handle(hci_event_disconnection_complete_get_connection_handle(packet));
+            if (!link) break;
+            hfp_ag_media_link_close(link);
+            break;
+        case HCI_EVENT_SCO_CAN_SEND_NOW:
+            hfp_ag_media_handle_sco_can_send_now();
+            break;
+        default:
+            break;
+    }
+}
+
+void hfp_ag_media_sco_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    if (packet_type != HCI_SCO_DATA_PACKET) return;
+    if (size < 3) return;
+    hci_con_handle_t sco_handle = little_endian_read_16(packet, 0) & 0x0fff;
+    hfp_ag_media_link_t * link = hfp_ag_media_link_for_sco_handle(sco_handle);
+    if (!link) return;
+
+    int payload_size = btstack_min(packet[2], size - 3);
+    link->packets_received++;
+    switch (link->codec){
+        case HFP_CODEC_MSBC:
+            btstack_sbc_decoder_process_data(&link->msbc_decoder, (packet[1] >> 4) & 3, &packet[3], payload_size);
+            break;
+        default:
+            hfp_ag_media_receive_cvsd(link, &packet[3], payload_size);
+            break;
+    }
+
+    // send packet with same size
+    link->payload_size = payload_size;
+    link->packets_to_send++;
+    hci_request_sco_can_send_now_event();
+}
+
+void hfp_ag_media_init(void){
+    memset(hfp_ag_media_links, 0, sizeof(hfp_ag_media_links));
+    hfp_ag_media_next_link_to_send = 0;
+    hfp_ag_media_next_mixer_group = 1;
+    hfp_ag_media_pcm_handler = NULL;
+
+    hfp_ag_media_hci_event_callback_registration.callback = &hfp_ag_media_hci_event_handler;
+    hci_add_event_handler(&hfp_ag_media_hci_event_callback_registration);
+}
+
+void hfp_ag_media_register_pcm_handler(void (*callback)(hci_con_handle_t sco_handle, int16_t * samples, int num_samples, int sample_rate)){
+    hfp_ag_media_pcm_handler = callback;
+}
+
+uint8_t hfp_ag_media_set_mixer_group(hci_con_handle_t sco_handle, uint8_t mixer_group){
+    hfp_ag_media_link_t * link = hfp_ag_media_link_for_sco_handle(sco_handle);
+    if (!link) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    link->mixer_group = mixer_group;
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t hfp_ag_media_bridge(hci_con_handle_t sco_handle_a, hci_con_handle_t sco_handle_b){
+    hfp_ag_media_link_t * link_a = hfp_ag_media_link_for_sco_handle(sco_handle_a);
+    hfp_ag_media_link_t * link_b = hfp_ag_media_link_for_sco_handle(sco_handle_b);
+    if (!link_a || !link_b) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    uint8_t mixer_group = hfp_ag_media_next_mixer_group++;
+    if (hfp_ag_media_next_mixer_group == 0){
+        hfp_ag_media_next_mixer_group = 1;
+    }
+    link_a->mixer_group = mixer_group;
+    link_b->mixer_group = mixer_group;
+    return ERROR_CODE_SUCCESS;
+}
+
+int hfp_ag_media_mix_audio(hci_con_handle_t sco_handle, const int16_t * samples, int num_samples, int sample_rate){
+    hfp_ag_media_link_t * link = hfp_ag_media_link_for_sco_handle(sco_handle);
+    if (!link) return 0;
+    return hfp_ag_media_mixer_add(link, HFP_AG_MEDIA_LOCAL_SOURCE, samples, num_samples, sample_rate);
+}
+
+int hfp_ag_media_num_links(void){
+    int num_links = 0;
+    int i;
+    for (i=0;i<MAX_NR_HFP_AG_MEDIA_LINKS;i++){
+        if (hfp_ag_media_links[i].in_use) num_links++;
+    }
+    return num_links;
+}
+
+uint8_t hfp_ag_media_get_statistics(hci_con_handle_t sco_handle, hfp_ag_media_link_statistics_t * statistics){
+    hfp_ag_media_link_t * link = hfp_ag_media_link_for_sco_handle(sco_handle);
+    if (!link) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+    memset(statistics, 0, sizeof(hfp_ag_media_link_statistics_t));
+    statistics->sco_handle       = link->sco_handle;
+    statistics->codec            = link->codec;
+    statistics->mixer_group      = link->mixer_group;
+    statistics->packets_received = link->packets_received;
+    statistics->packets_sent     = link->packets_sent;
+    statistics->frames_encoded   = link->frames_encoded;
+    statistics->mixer_underruns  = link->mixer_underruns;
+    statistics->mixer_overruns   = link->mixer_overruns;
+    if (link->codec == HFP_CODEC_MSBC){
+        statistics->frames_decoded   = link->msbc_decoder.good_frames_nr + link->msbc_decoder.bad_frames_nr + link->msbc_decoder.zero_frames_nr;
+        statistics->frames_concealed = link->msbc_decoder.bad_frames_nr + link->msbc_decoder.zero_frames_nr;
+    } else {
+        statistics->frames_decoded   = link->cvsd_plc.good_frames_nr + link->cvsd_plc.bad_frames_nr;
+        statistics->frames_concealed = link->cvsd_plc.bad_frames_nr;
+    }
+    return ERROR_CODE_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ * hfp_ag_media.h
+ *
+ * Media engine for an HFP Audio Gateway with several concurrent SCO/eSCO connections
+ *
+ * Each SCO connection gets its own codec context: mSBC encoder/decoder with H2 framing or
+ * CVSD, each with its own packet loss concealment state. Received audio is decoded and mixed
+ * into the outgoing audio of all other connections in the same mixer group:
+ * - two connections in one group are bridged
+ * - more connections in one group form a conference, each one hears the sum of the others
+ * - audio of connections with different sample rates (CVSD 8 kHz, mSBC 16 kHz) is resampled
+ *
+ * Local audio, e.g. from the microphone of the gateway, can be mixed into each connection,
+ * decoded audio of each connection is provided to the application by callback.
+ *
+ * Connections are tracked via HCI events, the codec is selected by the air mode of the
+ * (e)SCO connection. Register hfp_ag_media_sco_packet_handler with hci_register_sco_packet_handler.
+ * For each received SCO packet, a packet with the same size is sent on that connection.
+ *
+ * Required: MAX_NR_BTSTACK_SBC_ENCODERS and MAX_NR_BTSTACK_SBC_DECODERS >= MAX_NR_HFP_AG_MEDIA_LINKS.
+ * An mSBC connection is not handled if no SBC encoder or decoder is available, e.g. as they are used elsewhere.
+ */
+
+#ifndef __HFP_AG_MEDIA_H
+#define __HFP_AG_MEDIA_H
+
+#include <stdint.h>
+
+#include "bluetooth.h"
+#include "btstack_defines.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+// number of concurrent SCO connections, increase together with MAX_NR_BTSTACK_SBC_ENCODERS/DECODERS
+#ifndef MAX_NR_HFP_AG_MEDIA_LINKS
+#define MAX_NR_HFP_AG_MEDIA_LINKS 1
+#endif
+
+typedef struct {
+    hci_con_handle_t sco_handle;
+    uint8_t  codec;                 // HFP_CODEC_CVSD or HFP_CODEC_MSBC
+    uint8_t  mixer_group;
+    uint32_t packets_received;
+    uint32_t packets_sent;
+    uint32_t frames_decoded;        // mSBC frames or CVSD frames of 24 samples
+    uint32_t frames_concealed;      // frames replaced by packet loss concealment
+    uint32_t frames_encoded;        // mSBC frames
+    uint32_t mixer_underruns;       // samples sent as silence
+    uint32_t mixer_overruns;        // samples dropped as outgoing audio was not sent in time
+} hfp_ag_media_link_statistics_t;
+
+/* API_START */
+
+/**
+ * @brief Init media engine, registers for HCI events
+ */
+void hfp_ag_media_init(void);
+
+/**
+ * @brief SCO packet handler, register with hci_register_sco_packet_handler
+ */
+void hfp_ag_media_sco_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
+
+/**
+ * @brief Register callback for decoded audio of each connection
+ * @param callback with PCM samples in host endianess
+ */
+void hfp_ag_media_register_pcm_handler(void (*callback)(hci_con_handle_t sco_handle, int16_t * samples, int num_samples, int sample_rate));
+
+/**
+ * @brief Set mixer group of connection. Connections in the same group hear each other, group 0 is not mixed.
+ * @param sco_handle
+ * @param mixer_group
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER
+ */
+uint8_t hfp_ag_media_set_mixer_group(hci_con_handle_t sco_handle, uint8_t mixer_group);
+
+/**
+ * @brief Bridge two connections, i.e. put both into a new mixer group
+ * @param sco_handle_a
+ * @param sco_handle_b
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER
+ */
+uint8_t hfp_ag_media_bridge(hci_con_handle_t sco_handle_a, hci_con_handle_t sco_handle_b);
+
+/**
+ * @brief Mix local audio into outgoing audio of connection
+ * @param sco_handle
+ * @param samples in host endianess
+ * @param num_samples
+ * @param sample_rate 8000 or 16000
+ * @return number of samples accepted, might be smaller if outgoing audio is not sent in time
+ */
+int hfp_ag_media_mix_audio(hci_con_handle_t sco_handle, const int16_t * samples, int num_samples, int sample_rate);
+
+/**
+ * @brief Get number of active connections
+ */
+int hfp_ag_media_num_links(void);
+
+/**
+ * @brief Get statistics for connection
+ * @param sco_handle
+ * @param statistics
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER
+ */
+uint8_t hfp_ag_media_get_statistics(hci_con_handle_t sco_handle, hfp_ag_media_link_statistics_t * statistics);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __HFP_AG_MEDIA_H
@@ -51,66 +51,85 @@
 #include "btstack_sbc.h"
 #include "hfp_msbc.h"
 
-#define MSBC_FRAME_SIZE 57
-#define MSBC_HEADER_H2_SIZE 2
-#define MSBC_PADDING_SIZE 1
-#define MSBC_EXTRA_SIZE (MSBC_HEADER_H2_SIZE + MSBC_PADDING_SIZE)
+// mSBC frames contain 15 blocks with 8 subbands each
+#define MSBC_NUM_AUDIO_SAMPLES_PER_FRAME 120
 
 static const uint8_t msbc_header_h2_byte_0         = 1;
 static const uint8_t msbc_header_h2_byte_1_table[] = { 0x08, 0x38, 0xc8, 0xf8 };
 
-static btstack_sbc_encoder_state_t state;
-static int msbc_sequence_number;
+// encoder used by the API without encoder context
+static hfp_msbc_encoder_t hfp_msbc_default_encoder;
 
-static uint8_t msbc_buffer[2*(MSBC_FRAME_SIZE + MSBC_EXTRA_SIZE)];
-static int msbc_buffer_offset = 0; 
+uint8_t hfp_msbc_encoder_init(hfp_msbc_encoder_t * encoder){
+    encoder->buffer_offset = 0;
+    encoder->sequence_number = 0;
+    return btstack_sbc_encoder_init(&encoder->sbc_encoder_state, SBC_MODE_mSBC, 16, 8, 0, 16000, 26);
+}
 
-void hfp_msbc_init(void){
-    btstack_sbc_encoder_init(&state, SBC_MODE_mSBC, 16, 8, 0, 16000, 26);
-    msbc_buffer_offset = 0;
-    msbc_sequence_number = 0;
+void hfp_msbc_encoder_deinit(hfp_msbc_encoder_t * encoder){
+    btstack_sbc_encoder_deinit(&encoder->sbc_encoder_state);
+    encoder->buffer_offset = 0;
 }
 
-int hfp_msbc_can_encode_audio_frame_now(void){
-    return sizeof(msbc_buffer) - msbc_buffer_offset >= MSBC_FRAME_SIZE + MSBC_EXTRA_SIZE; 
+int hfp_msbc_encoder_can_encode_audio_frame_now(hfp_msbc_encoder_t * encoder){
+    if (!encoder->sbc_encoder_state.encoder_state) return 0;
+    return sizeof(encoder->buffer) - encoder->buffer_offset >= HFP_MSBC_FRAME_SIZE + HFP_MSBC_EXTRA_SIZE; 
 }
 
-void hfp_msbc_encode_audio_frame(int16_t * pcm_samples){
-    if (!hfp_msbc_can_encode_audio_frame_now()) return;
+void hfp_msbc_encoder_encode_audio_frame(hfp_msbc_encoder_t * encoder, int16_t * pcm_samples){
+    if (!hfp_msbc_encoder_can_encode_audio_frame_now(encoder)) return;
 
     // Synchronization Header H2
-    msbc_buffer[msbc_buffer_offset++] = msbc_header_h2_byte_0;
-    msbc_buffer[msbc_buffer_offset++] = msbc_header_h2_byte_1_table[msbc_sequence_number];
-    msbc_sequence_number = (msbc_sequence_number + 1) & 3;
+    encoder->buffer[encoder->buffer_offset++] = msbc_header_h2_byte_0;
+    encoder->buffer[encoder->buffer_offset++] = msbc_header_h2_byte_1_table[encoder->sequence_number];
+    encoder->sequence_number = (encoder->sequence_number + 1) & 3;
 
     // SBC Frame
-    btstack_sbc_encoder_process_data(pcm_samples);
-    memcpy(msbc_buffer + msbc_buffer_offset, btstack_sbc_encoder_sbc_buffer(), MSBC_FRAME_SIZE);
-    msbc_buffer_offset += MSBC_FRAME_SIZE;
+    btstack_sbc_encoder_process_data_for_state(&encoder->sbc_encoder_state, pcm_samples);
+    memcpy(encoder->buffer + encoder->buffer_offset, btstack_sbc_encoder_sbc_buffer_for_state(&encoder->sbc_encoder_state), HFP_MSBC_FRAME_SIZE);
+    encoder->buffer_offset += HFP_MSBC_FRAME_SIZE;
 
     // Final padding to use 60 bytes for 120 audio samples
-    msbc_buffer[msbc_buffer_offset++] = 0;
+    encoder->buffer[encoder->buffer_offset++] = 0;
 }
 
-void hfp_msbc_read_from_stream(uint8_t * buf, int size){
+void hfp_msbc_encoder_read_from_stream(hfp_msbc_encoder_t * encoder, uint8_t * buf, int size){
     int bytes_to_copy = size;
-    if (size > msbc_buffer_offset){
-        bytes_to_copy = msbc_buffer_offset;
+    if (size > encoder->buffer_offset){
+        bytes_to_copy = encoder->buffer_offset;
         log_error("sbc frame storage is smaller then the output buffer");
         return;
     }
 
-    memcpy(buf, msbc_buffer, bytes_to_copy);
-    memmove(msbc_buffer, msbc_buffer + bytes_to_copy, sizeof(msbc_buffer) - bytes_to_copy);
-    msbc_buffer_offset -= bytes_to_copy;
+    memcpy(buf, encoder->buffer, bytes_to_copy);
+    memmove(encoder->buffer, encoder->buffer + bytes_to_copy, sizeof(encoder->buffer) - bytes_to_copy);
+    encoder->buffer_offset -= bytes_to_copy;
 }
 
-int hfp_msbc_num_bytes_in_stream(void){
-    return msbc_buffer_offset;
+int hfp_msbc_encoder_num_bytes_in_stream(hfp_msbc_encoder_t * encoder){
+    return encoder->buffer_offset;
 }
 
-int hfp_msbc_num_audio_samples_per_frame(void){
-    return btstack_sbc_encoder_num_audio_frames();
+void hfp_msbc_init(void){
+    hfp_msbc_encoder_init(&hfp_msbc_default_encoder);
 }
 
+int hfp_msbc_can_encode_audio_frame_now(void){
+    return hfp_msbc_encoder_can_encode_audio_frame_now(&hfp_msbc_default_encoder);
+}
 
+void hfp_msbc_encode_audio_frame(int16_t * pcm_samples){
+    hfp_msbc_encoder_encode_audio_frame(&hfp_msbc_default_encoder, pcm_samples);
+}
+
+void hfp_msbc_read_from_stream(uint8_t * buf, int size){
+    hfp_msbc_encoder_read_from_stream(&hfp_msbc_default_encoder, buf, size);
+}
+
+int hfp_msbc_num_bytes_in_stream(void){
+    return hfp_msbc_encoder_num_bytes_in_stream(&hfp_msbc_default_encoder);
+}
+
+int hfp_msbc_num_audio_samples_per_frame(void){
+    return MSBC_NUM_AUDIO_SAMPLES_PER_FRAME;
+}
@@ -48,14 +48,65 @@
 
 #include <stdint.h>
 
+#include "btstack_sbc.h"
+
 #if defined __cplusplus
 extern "C" {
 #endif
 
+#define HFP_MSBC_FRAME_SIZE 57
+#define HFP_MSBC_HEADER_H2_SIZE 2
+#define HFP_MSBC_PADDING_SIZE 1
+#define HFP_MSBC_EXTRA_SIZE (HFP_MSBC_HEADER_H2_SIZE + HFP_MSBC_PADDING_SIZE)
+
+typedef struct {
+    // private
+    btstack_sbc_encoder_state_t sbc_encoder_state;
+    int     sequence_number;
+    uint8_t buffer[2*(HFP_MSBC_FRAME_SIZE + HFP_MSBC_EXTRA_SIZE)];
+    int     buffer_offset;
+} hfp_msbc_encoder_t;
+
 /* API_START */
 
 /**
- *
+ * @brief Init mSBC encoder with H2 framing, e.g. one per SCO connection
+ * @param encoder
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_MEMORY_CAPACITY_EXCEEDED if no SBC encoder is available
+ */
+uint8_t hfp_msbc_encoder_init(hfp_msbc_encoder_t * encoder);
+
+/**
+ * @brief Release SBC encoder storage
+ * @param encoder
+ */
+void hfp_msbc_encoder_deinit(hfp_msbc_encoder_t * encoder);
+
+/**
+ * @param encoder
+ */
+int  hfp_msbc_encoder_can_encode_audio_frame_now(hfp_msbc_encoder_t * encoder);
+
+/**
+ * @param encoder
+ * @param pcm_samples - complete audio frame of hfp_msbc_num_audio_samples_per_frame int16 samples
+ */
+void hfp_msbc_encoder_encode_audio_frame(hfp_msbc_encoder_t * encoder, int16_t * pcm_samples);
+
+/**
+ * @param encoder
+ */
+int  hfp_msbc_encoder_num_bytes_in_stream(hfp_msbc_encoder_t * encoder);
+
+/**
+ * @param encoder
+ * @param buffer to store stream
+ * @param size num bytes to read from stream
+ */
+void hfp_msbc_encoder_read_from_stream(hfp_msbc_encoder_t * encoder, uint8_t * buffer, int size);
+
+/**
+ * @brief Init default mSBC encoder
  */
 void hfp_msbc_init(void);
 
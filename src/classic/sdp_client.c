@@ -41,10 +41,14 @@
  *  sdp_client.c
  */
 
+#include <string.h>
+
 #include "bluetooth_sdp.h"
 #include "btstack_config.h"
 #include "btstack_debug.h"
 #include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
 #include "classic/core.h"
 #include "classic/sdp_client.h"
 #include "classic/sdp_server.h"
@@ -64,7 +68,7 @@ typedef enum {
 
 // Types SDP Client 
 typedef enum {
-    INIT, W4_CONNECT, W2_SEND, W4_RESPONSE, QUERY_COMPLETE
+    INIT, W4_CONNECT, W2_SEND, W4_RESPONSE, W2_DELIVER_CACHED, IDLE, W4_DISCONNECT
 } sdp_client_state_t;
 
 
@@ -72,6 +76,7 @@ typedef enum {
 void sdp_parser_init(btstack_packet_handler_t callback);
 void sdp_parser_handle_chunk(uint8_t * data, uint16_t size);
 void sdp_parser_handle_done(uint8_t status);
+void sdp_parser_set_attribute_data_mode(int enabled);
 void sdp_parser_init_service_attribute_search(void);
 void sdp_parser_init_service_search(void);
 void sdp_parser_handle_service_search(uint8_t * data, uint16_t total_count, uint16_t record_handle_count);
@@ -79,47 +84,47 @@ void sdp_parser_handle_service_search(uint8_t * data, uint16_t total_count, uint
 // Prototypes SDP Client
 void sdp_client_reset(void);
 void sdp_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
-static uint16_t sdp_client_setup_service_search_attribute_request(uint8_t * data);
+static void sdp_client_complete_query(sdp_client_connection_t * connection, uint8_t status);
+static uint16_t sdp_client_setup_service_search_attribute_request(sdp_client_connection_t * connection, uint8_t * data);
 #ifdef ENABLE_SDP_EXTRA_QUERIES
-static uint16_t sdp_client_setup_service_search_request(uint8_t * data);
-static uint16_t sdp_client_setup_service_attribute_request(uint8_t * data);
-static void     sdp_client_parse_service_search_response(uint8_t* packet);
-static void     sdp_client_parse_service_attribute_response(uint8_t* packet);
+static uint16_t sdp_client_setup_service_search_request(sdp_client_connection_t * connection, uint8_t * data);
+static uint16_t sdp_client_setup_service_attribute_request(sdp_client_connection_t * connection, uint8_t * data);
+static void     sdp_client_parse_service_search_response(sdp_client_connection_t * connection, uint8_t* packet);
+static void     sdp_client_parse_service_attribute_response(sdp_client_connection_t * connection, uint8_t* packet);
 #endif
 
 static uint8_t des_attributeIDList[] = { 0x35, 0x05, 0x0A, 0x00, 0x01, 0xff, 0xff};  // Attribute: 0x0001 - 0x0100
 
-// State DES Parser
-static de_state_t de_header_state;
-
-// State SDP Parser
-static sdp_parser_state_t  state = GET_LIST_LENGTH;
-static uint16_t attribute_id = 0;
-static uint16_t attribute_bytes_received = 0;
-static uint16_t attribute_bytes_delivered = 0;
-static uint16_t list_offset = 0;
-static uint16_t list_size;
-static uint16_t record_offset = 0;
-static uint16_t record_size;
-static uint16_t attribute_value_size;
-static int record_counter = 0;
-static btstack_packet_handler_t sdp_parser_callback;
-
-// State SDP Client
-static uint16_t  mtu;
-static uint16_t  sdp_cid = 0x40;
-static const uint8_t * service_search_pattern;
-static const uint8_t * attribute_id_list;
-static uint16_t  transactionID = 0;
-static uint8_t   continuationState[16];
-static uint8_t   continuationStateLen;
-static sdp_client_state_t sdp_client_state = INIT;
-static SDP_PDU_ID_t PDU_ID = SDP_Invalid;
+// State SDP Parser, points to parser of connection that is processed
+static sdp_parser_t   sdp_parser_default;
+static sdp_parser_t * sdp_parser = &sdp_parser_default;
 #ifdef ENABLE_SDP_EXTRA_QUERIES
-static uint32_t serviceRecordHandle;
 static uint32_t record_handle;
 #endif
 
+// State SDP Client, one connection per remote device
+static btstack_linked_list_t   sdp_client_connections;
+// one connection is always available, additional ones are taken from btstack_memory
+static sdp_client_connection_t sdp_client_default_connection;
+static int sdp_client_default_connection_in_use;
+static sdp_client_connection_t * sdp_client_notifying_connection;
+static uint16_t sdp_client_query_id;
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+// attribute lists from ServiceSearchAttributeResponses indexed by remote and request
+typedef struct {
+    bd_addr_t address;
+    uint32_t  timestamp_ms;
+    uint16_t  request_size;     // 0 = unused
+    uint16_t  response_size;
+    uint8_t   filling;          // response of active query gets stored
+    uint8_t   request[SDP_CLIENT_CACHE_MAX_REQUEST_SIZE];
+    uint8_t   response[SDP_CLIENT_CACHE_MAX_RESPONSE_SIZE];
+} sdp_client_cache_entry_t;
+
+static sdp_client_cache_entry_t sdp_client_cache[MAX_NR_SDP_CLIENT_CACHE_ENTRIES];
+#endif
+
 // DES Parser
 void de_state_init(de_state_t * de_state){
     de_state->in_state_GET_DE_HEADER_LENGTH = 1;
@@ -161,147 +166,253 @@ static void sdp_parser_emit_value_byte(uint8_t event_byte){
     uint8_t event[11];
     event[0] = SDP_EVENT_QUERY_ATTRIBUTE_VALUE;
     event[1] = 9;
-    little_endian_store_16(event, 2, record_counter);
-    little_endian_store_16(event, 4, attribute_id);
-    little_endian_store_16(event, 6, attribute_value_size);
-    little_endian_store_16(event, 8, attribute_bytes_delivered);
+    little_endian_store_16(event, 2, sdp_parser->record_counter);
+    little_endian_store_16(event, 4, sdp_parser->attribute_id);
+    little_endian_store_16(event, 6, sdp_parser->attribute_value_size);
+    little_endian_store_16(event, 8, sdp_parser->attribute_bytes_delivered);
     event[10] = event_byte;
-    (*sdp_parser_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event)); 
+    (*sdp_parser->callback)(HCI_EVENT_PACKET, sdp_parser->query_id, event, sizeof(event)); 
+}
+
+// emit collected attribute data, event header is filled in front of the data
+static void sdp_parser_emit_attribute_data(void){
+    uint8_t * event = sdp_parser->attribute_data_event;
+    uint16_t  data_len = sdp_parser->attribute_data_len;
+    event[0] = SDP_EVENT_QUERY_ATTRIBUTE_DATA;
+    event[1] = 10 + data_len;
+    little_endian_store_16(event, 2, sdp_parser->record_counter);
+    little_endian_store_16(event, 4, sdp_parser->attribute_id);
+    little_endian_store_16(event, 6, sdp_parser->attribute_value_size);
+    little_endian_store_16(event, 8, sdp_parser->attribute_bytes_delivered);
+    little_endian_store_16(event, 10, data_len);
+    sdp_parser->attribute_bytes_delivered += data_len;
+    sdp_parser->attribute_data_len = 0;
+    (*sdp_parser->callback)(HCI_EVENT_PACKET, sdp_parser->query_id, event, 12 + data_len); 
+}
+
+// deliver attribute value bytes, either one by one or collected into SDP_EVENT_QUERY_ATTRIBUTE_DATA events
+static void sdp_parser_deliver_value(const uint8_t * data, uint16_t size){
+    if (!sdp_parser->attribute_data_mode){
+        int i;
+        for (i=0;i<size;i++){
+            sdp_parser_emit_value_byte(data[i]);
+            sdp_parser->attribute_bytes_delivered++;
+        }
+        return;
+    }
+    while (size){
+        uint16_t bytes_to_copy = btstack_min(size, SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE - sdp_parser->attribute_data_len);
+        memcpy(&sdp_parser->attribute_data_event[12 + sdp_parser->attribute_data_len], data, bytes_to_copy);
+        sdp_parser->attribute_data_len += bytes_to_copy;
+        data += bytes_to_copy;
+        size -= bytes_to_copy;
+        if (sdp_parser->attribute_data_len < SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE) break;
+        sdp_parser_emit_attribute_data();
+    }
+}
+
+static void sdp_parser_attribute_complete(void){
+    if (sdp_parser->attribute_data_len){
+        sdp_parser_emit_attribute_data();
+    }
+    // log_info("parser: Record offset %u, record size %u", record_offset, record_size);
+    if (sdp_parser->record_offset != sdp_parser->record_size){
+        sdp_parser->state = GET_ATTRIBUTE_ID_HEADER_LENGTH;
+        // log_info("Get next attribute");
+        return;
+    } 
+    sdp_parser->record_offset = 0;
+    // log_info("parser: List offset %u, list size %u", list_offset, list_size);
+    
+    if (sdp_parser->list_size > 0 && sdp_parser->list_offset != sdp_parser->list_size){
+        sdp_parser->record_counter++;
+        sdp_parser->state = GET_RECORD_LENGTH;
+        log_info("parser: END_OF_RECORD");
+        return;
+    }
+    sdp_parser->list_offset = 0;
+    de_state_init(&sdp_parser->de_header_state);
+    sdp_parser->state = GET_LIST_LENGTH;
+    sdp_parser->record_counter = 0;
+    log_info("parser: END_OF_RECORD & DONE");
 }
 
 static void sdp_parser_process_byte(uint8_t eventByte){
     // count all bytes
-    list_offset++;
-    record_offset++;
+    sdp_parser->list_offset++;
+    sdp_parser->record_offset++;
 
     // log_info(" parse BYTE_RECEIVED %02x", eventByte);
-    switch(state){
+    switch(sdp_parser->state){
         case GET_LIST_LENGTH:
-            if (!de_state_size(eventByte, &de_header_state)) break;
-            list_offset = de_header_state.de_offset;
-            list_size = de_header_state.de_size;
+            if (!de_state_size(eventByte, &sdp_parser->de_header_state)) break;
+            sdp_parser->list_offset = sdp_parser->de_header_state.de_offset;
+            sdp_parser->list_size = sdp_parser->de_header_state.de_size;
             // log_info("parser: List offset %u, list size %u", list_offset, list_size);
             
-            record_counter = 0;
-            state = GET_RECORD_LENGTH;
+            sdp_parser->record_counter = 0;
+            sdp_parser->state = GET_RECORD_LENGTH;
             break;
 
         case GET_RECORD_LENGTH:
             // check size
-            if (!de_state_size(eventByte, &de_header_state)) break;
+            if (!de_state_size(eventByte, &sdp_parser->de_header_state)) break;
             // log_info("parser: Record payload is %d bytes.", de_header_state.de_size);
-            record_offset = de_header_state.de_offset;
-            record_size = de_header_state.de_size;
-            state = GET_ATTRIBUTE_ID_HEADER_LENGTH;
+            sdp_parser->record_offset = sdp_parser->de_header_state.de_offset;
+            sdp_parser->record_size = sdp_parser->de_header_state.de_size;
+            sdp_parser->state = GET_ATTRIBUTE_ID_HEADER_LENGTH;
             break;
 
         case GET_ATTRIBUTE_ID_HEADER_LENGTH:
-            if (!de_state_size(eventByte, &de_header_state)) break;
-            attribute_id = 0;
-            log_info("ID data is stored in %d bytes.", (int) de_header_state.de_size);
-            state = GET_ATTRIBUTE_ID;
+            if (!de_state_size(eventByte, &sdp_parser->de_header_state)) break;
+            sdp_parser->attribute_id = 0;
+            log_info("ID data is stored in %d bytes.", (int) sdp_parser->de_header_state.de_size);
+            sdp_parser->state = GET_ATTRIBUTE_ID;
             break;
         
         case GET_ATTRIBUTE_ID:
-            attribute_id = (attribute_id << 8) | eventByte;
-            de_header_state.de_size--;
-            if (de_header_state.de_size > 0) break;
-            log_info("parser: Attribute ID: %04x.", attribute_id);
-
-            state = GET_ATTRIBUTE_VALUE_LENGTH;
-            attribute_bytes_received  = 0;
-            attribute_bytes_delivered = 0;
-            attribute_value_size      = 0;
-            de_state_init(&de_header_state);
+            sdp_parser->attribute_id = (sdp_parser->attribute_id << 8) | eventByte;
+            sdp_parser->de_header_state.de_size--;
+            if (sdp_parser->de_header_state.de_size > 0) break;
+            log_info("parser: Attribute ID: %04x.", sdp_parser->attribute_id);
+
+            sdp_parser->state = GET_ATTRIBUTE_VALUE_LENGTH;
+            sdp_parser->attribute_bytes_received  = 0;
+            sdp_parser->attribute_bytes_delivered = 0;
+            sdp_parser->attribute_value_size      = 0;
+            sdp_parser->attribute_data_len        = 0;
+            de_state_init(&sdp_parser->de_header_state);
             break;
         
         case GET_ATTRIBUTE_VALUE_LENGTH:
-            attribute_bytes_received++;
-            sdp_parser_emit_value_byte(eventByte);
-            attribute_bytes_delivered++;
-            if (!de_state_size(eventByte, &de_header_state)) break;
-
-            attribute_value_size = de_header_state.de_size + attribute_bytes_received;
-
-            state = GET_ATTRIBUTE_VALUE;
-            break;
-        
-        case GET_ATTRIBUTE_VALUE: 
-            attribute_bytes_received++;
-            sdp_parser_emit_value_byte(eventByte);
-            attribute_bytes_delivered++;
-            // log_info("paser: attribute_bytes_received %u, attribute_value_size %u", attribute_bytes_received, attribute_value_size);
-
-            if (attribute_bytes_received < attribute_value_size) break;
-            // log_info("parser: Record offset %u, record size %u", record_offset, record_size);
-            if (record_offset != record_size){
-                state = GET_ATTRIBUTE_ID_HEADER_LENGTH;
-                // log_info("Get next attribute");
-                break;
-            } 
-            record_offset = 0;
-            // log_info("parser: List offset %u, list size %u", list_offset, list_size);
-            
-            if (list_size > 0 && list_offset != list_size){
-                record_counter++;
-                state = GET_RECORD_LENGTH;
-                log_info("parser: END_OF_RECORD");
+            // collect header, deliver it when attribute value size is known
+            if (sdp_parser->attribute_bytes_received < sizeof(sdp_parser->attribute_header)){
+                sdp_parser->attribute_header[sdp_parser->attribute_bytes_received] = eventByte;
+            }
+            sdp_parser->attribute_bytes_received++;
+            if (!de_state_size(eventByte, &sdp_parser->de_header_state)) break;
+
+            sdp_parser->attribute_value_size = sdp_parser->de_header_state.de_size + sdp_parser->attribute_bytes_received;
+            sdp_parser_deliver_value(sdp_parser->attribute_header, sdp_parser->attribute_bytes_received);
+            if (sdp_parser->attribute_bytes_received >= sdp_parser->attribute_value_size){
+                // empty value
+                sdp_parser_attribute_complete();
                 break;
             }
-            list_offset = 0;
-            de_state_init(&de_header_state);
-            state = GET_LIST_LENGTH;
-            record_counter = 0;
-            log_info("parser: END_OF_RECORD & DONE");
+            sdp_parser->state = GET_ATTRIBUTE_VALUE;
             break;
+
         default:
+            // GET_ATTRIBUTE_VALUE handled by sdp_parser_process_value
             break;
     }
 }
 
+// consume attribute value bytes in one step, returns number of bytes consumed
+static uint16_t sdp_parser_process_value(const uint8_t * data, uint16_t size){
+    uint16_t bytes_to_read = btstack_min(size, sdp_parser->attribute_value_size - sdp_parser->attribute_bytes_received);
+    sdp_parser->list_offset   += bytes_to_read;
+    sdp_parser->record_offset += bytes_to_read;
+    sdp_parser->attribute_bytes_received += bytes_to_read;
+    // log_info("paser: attribute_bytes_received %u, attribute_value_size %u", attribute_bytes_received, attribute_value_size);
+    sdp_parser_deliver_value(data, bytes_to_read);
+    if (sdp_parser->attribute_bytes_received >= sdp_parser->attribute_value_size){
+        sdp_parser_attribute_complete();
+    }
+    return bytes_to_read;
+}
+
+// parse uint16 attribute ID and header of attribute value in one step if both are contained in data,
+// returns number of bytes consumed or 0
+static uint16_t sdp_parser_process_attribute_header(const uint8_t * data, uint16_t size){
+    if (size < 4) return 0;
+    if (data[0] != 0x09) return 0;  // DE_UINT, DE_SIZE_16
+    int header_size = de_get_header_size(&data[3]);
+    if (3 + header_size > size) return 0;
+
+    sdp_parser->attribute_id = big_endian_read_16(data, 1);
+    sdp_parser->attribute_bytes_received  = header_size;
+    sdp_parser->attribute_bytes_delivered = 0;
+    sdp_parser->attribute_value_size      = header_size + de_get_data_size(&data[3]);
+    sdp_parser->attribute_data_len        = 0;
+    sdp_parser->list_offset   += 3 + header_size;
+    sdp_parser->record_offset += 3 + header_size;
+
+    sdp_parser_deliver_value(&data[3], header_size);
+    if (sdp_parser->attribute_bytes_received >= sdp_parser->attribute_value_size){
+        sdp_parser_attribute_complete();
+    } else {
+        sdp_parser->state = GET_ATTRIBUTE_VALUE;
+    }
+    return 3 + header_size;
+}
+
 void sdp_parser_init(btstack_packet_handler_t callback){
     // init
-    sdp_parser_callback = callback;
-    de_state_init(&de_header_state);
-    state = GET_LIST_LENGTH;
-    list_offset = 0;
-    record_offset = 0;
-    record_counter = 0;
+    sdp_parser->callback = callback;
+    de_state_init(&sdp_parser->de_header_state);
+    sdp_parser->state = GET_LIST_LENGTH;
+    sdp_parser->list_offset = 0;
+    sdp_parser->record_offset = 0;
+    sdp_parser->record_counter = 0;
+    sdp_parser->attribute_data_mode = 0;
+    sdp_parser->attribute_data_len = 0;
 }
 
+void sdp_parser_set_attribute_data_mode(int enabled){
+    sdp_parser->attribute_data_mode = enabled;
+}
+
+// attribute values are consumed in runs, attribute headers in one step if complete, everything else byte by byte
 void sdp_parser_handle_chunk(uint8_t * data, uint16_t size){
-    int i;
-    for (i=0;i<size;i++){
-        sdp_parser_process_byte(data[i]);
+    uint16_t pos = 0;
+    while (pos < size){
+        uint16_t bytes_consumed = 0;
+        switch (sdp_parser->state){
+            case GET_ATTRIBUTE_VALUE:
+                bytes_consumed = sdp_parser_process_value(&data[pos], size - pos);
+                break;
+            case GET_ATTRIBUTE_ID_HEADER_LENGTH:
+                if (!sdp_parser->de_header_state.in_state_GET_DE_HEADER_LENGTH) break;
+                bytes_consumed = sdp_parser_process_attribute_header(&data[pos], size - pos);
+                break;
+            default:
+                break;
+        }
+        if (bytes_consumed == 0){
+            sdp_parser_process_byte(data[pos]);
+            bytes_consumed = 1;
+        }
+        pos += bytes_consumed;
     }
 }
 
 #ifdef ENABLE_SDP_EXTRA_QUERIES
 void sdp_parser_init_service_attribute_search(void){
     // init
-    de_state_init(&de_header_state);
-    state = GET_RECORD_LENGTH;
-    list_offset = 0;
-    record_offset = 0;
-    record_counter = 0;
+    de_state_init(&sdp_parser->de_header_state);
+    sdp_parser->state = GET_RECORD_LENGTH;
+    sdp_parser->list_offset = 0;
+    sdp_parser->record_offset = 0;
+    sdp_parser->record_counter = 0;
 }
 
 void sdp_parser_init_service_search(void){
-    record_offset = 0;
+    sdp_parser->record_offset = 0;
 }
 
 void sdp_parser_handle_service_search(uint8_t * data, uint16_t total_count, uint16_t record_handle_count){
     int i;
     for (i=0;i<record_handle_count;i++){
         record_handle = big_endian_read_32(data, i*4);
-        record_counter++;
+        sdp_parser->record_counter++;
         uint8_t event[10];
         event[0] = SDP_EVENT_QUERY_SERVICE_RECORD_HANDLE;
         event[1] = 8;
         little_endian_store_16(event, 2, total_count);
-        little_endian_store_16(event, 4, record_counter);
+        little_endian_store_16(event, 4, sdp_parser->record_counter);
         little_endian_store_32(event, 6, record_handle);
-        (*sdp_parser_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event)); 
+        (*sdp_parser->callback)(HCI_EVENT_PACKET, sdp_parser->query_id, event, sizeof(event)); 
     }        
 }
 #endif
@@ -311,51 +422,321 @@ void sdp_parser_handle_done(uint8_t status){
     event[0] = SDP_EVENT_QUERY_COMPLETE;
     event[1] = 1;
     event[2] = status;
-    (*sdp_parser_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event)); 
+    (*sdp_parser->callback)(HCI_EVENT_PACKET, sdp_parser->query_id, event, sizeof(event)); 
 }
 
 // SDP Client
 
-// TODO: inline if not needed (des(des))
+static sdp_client_connection_t * sdp_client_connection_for_address(bd_addr_t address){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &sdp_client_connections);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        sdp_client_connection_t * connection = (sdp_client_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (bd_addr_cmp(connection->address, address) == 0) return connection;
+    }
+    return NULL;
+}
 
-static void sdp_client_parse_attribute_lists(uint8_t* packet, uint16_t length){
+static sdp_client_connection_t * sdp_client_connection_for_l2cap_cid(uint16_t l2cap_cid){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &sdp_client_connections);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        sdp_client_connection_t * connection = (sdp_client_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (connection->state == INIT) continue;
+        if (connection->l2cap_cid == l2cap_cid) return connection;
+    }
+    return NULL;
+}
+
+static sdp_client_connection_t * sdp_client_connection_create(bd_addr_t address){
+    sdp_client_connection_t * connection;
+    if (!sdp_client_default_connection_in_use){
+        connection = &sdp_client_default_connection;
+        sdp_client_default_connection_in_use = 1;
+    } else {
+        connection = btstack_memory_sdp_client_connection_get();
+        if (!connection) return NULL;
+    }
+    memset(connection, 0, sizeof(sdp_client_connection_t));
+    bd_addr_copy(connection->address, address);
+    connection->state = INIT;
+    connection->cache_index = -1;
+    btstack_linked_list_add_tail(&sdp_client_connections, (btstack_linked_item_t *) connection);
+    return connection;
+}
+
+static void sdp_client_connection_finalize(sdp_client_connection_t * connection){
+    btstack_run_loop_remove_timer(&connection->cache_timer);
+    btstack_linked_list_remove(&sdp_client_connections, (btstack_linked_item_t *) connection);
+    if (connection == &sdp_client_default_connection){
+        sdp_client_default_connection_in_use = 0;
+        return;
+    }
+    btstack_memory_sdp_client_connection_free(connection);
+}
+
+static sdp_client_query_t * sdp_client_active_query(sdp_client_connection_t * connection){
+    return &connection->queries[connection->queries_head];
+}
+
+static void sdp_client_pop_query(sdp_client_connection_t * connection){
+    connection->queries_head++;
+    if (connection->queries_head == SDP_CLIENT_QUERY_QUEUE_SIZE){
+        connection->queries_head = 0;
+    }
+    connection->num_queries--;
+}
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+
+static int sdp_client_cache_build_request(sdp_client_query_t * query, uint8_t * request){
+    uint16_t pattern_len = de_get_len(query->service_search_pattern);
+    uint16_t attribute_id_list_len = de_get_len(query->attribute_id_list);
+    if (pattern_len + attribute_id_list_len > SDP_CLIENT_CACHE_MAX_REQUEST_SIZE) return 0;
+    memcpy(request, query->service_search_pattern, pattern_len);
+    memcpy(&request[pattern_len], query->attribute_id_list, attribute_id_list_len);
+    return pattern_len + attribute_id_list_len;
+}
+
+static sdp_client_cache_entry_t * sdp_client_cache_lookup(bd_addr_t address, sdp_client_query_t * query){
+    uint8_t request[SDP_CLIENT_CACHE_MAX_REQUEST_SIZE];
+    int request_size = sdp_client_cache_build_request(query, request);
+    if (!request_size) return NULL;
+    uint32_t now = btstack_run_loop_get_time_ms();
+    int i;
+    for (i=0;i<MAX_NR_SDP_CLIENT_CACHE_ENTRIES;i++){
+        sdp_client_cache_entry_t * entry = &sdp_client_cache[i];
+        if (entry->request_size != request_size) continue;
+        if (bd_addr_cmp(entry->address, address) != 0) continue;
+        if (memcmp(entry->request, request, request_size) != 0) continue;
+        if ((uint32_t)(now - entry->timestamp_ms) >= SDP_CLIENT_CACHE_TTL_MS){
+            entry->request_size = 0;
+            return NULL;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+// pick unused or oldest entry to store response of active query
+static void sdp_client_cache_start(sdp_client_connection_t * connection){
+    int victim = -1;
+    int i;
+    for (i=0;i<MAX_NR_SDP_CLIENT_CACHE_ENTRIES;i++){
+        sdp_client_cache_entry_t * entry = &sdp_client_cache[i];
+        if (entry->filling) continue;
+        if (entry->request_size == 0){
+            victim = i;
+            break;
+        }
+        if (victim < 0 || (int32_t)(entry->timestamp_ms - sdp_client_cache[victim].timestamp_ms) < 0){
+            victim = i;
+        }
+    }
+    connection->cache_index = victim;
+    if (victim < 0) return;
+    sdp_client_cache_entry_t * entry = &sdp_client_cache[victim];
+    entry->request_size = 0;
+    entry->response_size = 0;
+    entry->filling = 1;
+}
+
+static void sdp_client_cache_store(sdp_client_connection_t * connection, const uint8_t * data, uint16_t size){
+    if (connection->cache_index < 0) return;
+    sdp_client_cache_entry_t * entry = &sdp_client_cache[connection->cache_index];
+    if (entry->response_size + size > SDP_CLIENT_CACHE_MAX_RESPONSE_SIZE){
+        // too large, give up
+        entry->filling = 0;
+        connection->cache_index = -1;
+        return;
+    }
+    memcpy(&entry->response[entry->response_size], data, size);
+    entry->response_size += size;
+}
+
+static void sdp_client_cache_finalize(sdp_client_connection_t * connection, int complete){
+    if (connection->cache_index < 0) return;
+    sdp_client_cache_entry_t * entry = &sdp_client_cache[connection->cache_index];
+    connection->cache_index = -1;
+    entry->filling = 0;
+    if (!complete) return;
+    entry->request_size = sdp_client_cache_build_request(sdp_client_active_query(connection), entry->request);
+    bd_addr_copy(entry->address, connection->address);
+    entry->timestamp_ms = btstack_run_loop_get_time_ms();
+}
+
+static void sdp_client_cache_timeout_handler(btstack_timer_source_t * ts){
+    sdp_client_connection_t * connection = (sdp_client_connection_t *) btstack_run_loop_get_timer_context(ts);
+    if (connection->state != W2_DELIVER_CACHED) return;
+    sdp_client_query_t * query = sdp_client_active_query(connection);
+    sdp_client_cache_entry_t * entry = sdp_client_cache_lookup(connection->address, query);
+    sdp_parser = &connection->parser;
+    if (entry){
+        log_info("SDP Client deliver cached response for query %u", query->query_id);
+        sdp_parser_handle_chunk(entry->response, entry->response_size);
+    }
+    sdp_client_complete_query(connection, entry ? 0 : SDP_QUERY_INCOMPLETE);
+}
+
+void sdp_client_cache_remove(bd_addr_t remote){
+    int i;
+    for (i=0;i<MAX_NR_SDP_CLIENT_CACHE_ENTRIES;i++){
+        if (bd_addr_cmp(sdp_client_cache[i].address, remote) != 0) continue;
+        sdp_client_cache[i].request_size = 0;
+    }
+}
+
+void sdp_client_cache_flush(void){
+    int i;
+    for (i=0;i<MAX_NR_SDP_CLIENT_CACHE_ENTRIES;i++){
+        sdp_client_cache[i].request_size = 0;
+    }
+}
+#endif
+
+static void sdp_client_parse_attribute_lists(sdp_client_connection_t * connection, uint8_t* packet, uint16_t length){
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_store(connection, packet, length);
+#else
+    UNUSED(connection);
+#endif
     sdp_parser_handle_chunk(packet, length);
 }
 
+// emit query complete to all queued queries
+static void sdp_client_abort_queries(sdp_client_connection_t * connection, uint8_t status){
+    sdp_parser = &connection->parser;
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_finalize(connection, 0);
+#endif
+    while (connection->num_queries){
+        sdp_client_query_t * query = sdp_client_active_query(connection);
+        sdp_parser->callback = query->callback;
+        sdp_parser->query_id = query->query_id;
+        sdp_client_pop_query(connection);
+        sdp_parser_handle_done(status);
+    }
+}
+
+// start active query or disconnect if none queued, returns status of l2cap_create_channel
+static uint8_t sdp_client_start_next_query(sdp_client_connection_t * connection){
+
+    if (connection->num_queries == 0){
+        if (connection->l2cap_cid){
+            connection->state = W4_DISCONNECT;
+            l2cap_disconnect(connection->l2cap_cid, 0);
+        } else {
+            sdp_client_connection_finalize(connection);
+        }
+        return 0;
+    }
+
+    sdp_client_query_t * query = sdp_client_active_query(connection);
+    sdp_parser = &connection->parser;
+    sdp_parser_init(query->callback);
+    sdp_parser->query_id = query->query_id;
+    sdp_parser->attribute_data_mode = query->attribute_data_mode;
+#ifdef ENABLE_SDP_EXTRA_QUERIES
+    if (query->pdu_id == SDP_ServiceAttributeResponse){
+        sdp_parser_init_service_attribute_search();
+    }
+    if (query->pdu_id == SDP_ServiceSearchResponse){
+        sdp_parser_init_service_search();
+    }
+#endif
+    connection->continuation_state_len = 0;
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    if (query->pdu_id == SDP_ServiceSearchAttributeResponse){
+        if (sdp_client_cache_lookup(connection->address, query)){
+            // deliver from run loop to avoid re-entrance from sdp_client_query
+            connection->state = W2_DELIVER_CACHED;
+            btstack_run_loop_set_timer_handler(&connection->cache_timer, &sdp_client_cache_timeout_handler);
+            btstack_run_loop_set_timer_context(&connection->cache_timer, connection);
+            btstack_run_loop_set_timer(&connection->cache_timer, 0);
+            btstack_run_loop_add_timer(&connection->cache_timer);
+            return 0;
+        }
+        sdp_client_cache_start(connection);
+    }
+#endif
+
+    if (connection->l2cap_cid){
+        // reuse open channel
+        connection->state = W2_SEND;
+        l2cap_request_can_send_now_event(connection->l2cap_cid);
+        return 0;
+    }
+
+    connection->state = W4_CONNECT;
+    uint8_t status = l2cap_create_channel(sdp_client_packet_handler, connection->address, BLUETOOTH_PROTOCOL_SDP, l2cap_max_mtu(), &connection->l2cap_cid);
+    if (status){
+        connection->l2cap_cid = 0;
+    }
+    return status;
+}
+
+// start next query after the active one completed
+static void sdp_client_continue(sdp_client_connection_t * connection){
+    uint8_t status = sdp_client_start_next_query(connection);
+    if (!status) return;
+    sdp_client_abort_queries(connection, status);
+    sdp_client_connection_finalize(connection);
+}
 
-static void sdp_client_send_request(uint16_t channel){
+// report active query as done and continue with next one
+static void sdp_client_complete_query(sdp_client_connection_t * connection, uint8_t status){
+    sdp_client_pop_query(connection);
+    // l2cap_cid is only set while channel is open
+    connection->state = connection->l2cap_cid ? IDLE : INIT;
+    // queries for this remote added by callback are started afterwards
+    sdp_client_notifying_connection = connection;
+    sdp_parser_handle_done(status);
+    sdp_client_notifying_connection = NULL;
+    sdp_client_continue(connection);
+}
 
-    if (sdp_client_state != W2_SEND) return;
+static void sdp_client_query_complete(sdp_client_connection_t * connection){
+    log_info("SDP Client Query DONE! ");
+#ifdef ENABLE_SDP_CLIENT_CACHE
+    sdp_client_cache_finalize(connection, 1);
+#endif
+    sdp_client_complete_query(connection, 0);
+}
+
+static void sdp_client_send_request(sdp_client_connection_t * connection){
+
+    if (connection->state != W2_SEND) return;
 
     l2cap_reserve_packet_buffer();
     uint8_t * data = l2cap_get_outgoing_buffer();
     uint16_t request_len = 0;
 
-    switch (PDU_ID){
+    switch (sdp_client_active_query(connection)->pdu_id){
 #ifdef ENABLE_SDP_EXTRA_QUERIES
         case SDP_ServiceSearchResponse:
-            request_len = sdp_client_setup_service_search_request(data);
+            request_len = sdp_client_setup_service_search_request(connection, data);
             break;
         case SDP_ServiceAttributeResponse:
-            request_len = sdp_client_setup_service_attribute_request(data);
+            request_len = sdp_client_setup_service_attribute_request(connection, data);
             break;
 #endif
         case SDP_ServiceSearchAttributeResponse:
-            request_len = sdp_client_setup_service_search_attribute_request(data);
+            request_len = sdp_client_setup_service_search_attribute_request(connection, data);
             break;
         default:
-            log_error("SDP Client sdp_client_send_request :: PDU ID invalid. %u", PDU_ID);
+            log_error("SDP Client sdp_client_send_request :: PDU ID invalid. %u", sdp_client_active_query(connection)->pdu_id);
+            l2cap_release_packet_buffer();
             return;
     }
 
     // prevent re-entrance
-    sdp_client_state = W4_RESPONSE;
-    PDU_ID = SDP_Invalid;
-    l2cap_send_prepared(channel, request_len);
+    connection->state = W4_RESPONSE;
+    l2cap_send_prepared(connection->l2cap_cid, request_len);
 }
 
 
-static void sdp_client_parse_service_search_attribute_response(uint8_t* packet){
+static int sdp_client_parse_service_search_attribute_response(sdp_client_connection_t * connection, uint8_t* packet){
     uint16_t offset = 3;
     uint16_t parameterLength = big_endian_read_16(packet,offset);
     offset+=2;
@@ -363,85 +744,104 @@ static void sdp_client_parse_service_search_attribute_response(uint8_t* packet){
     uint16_t attributeListByteCount = big_endian_read_16(packet,offset);
     offset+=2;
 
-    if (attributeListByteCount > mtu){
+    if (attributeListByteCount > connection->mtu){
         log_error("Error parsing ServiceSearchAttributeResponse: Number of bytes in found attribute list is larger then the MaximumAttributeByteCount.");
-        return;
+        return 0;
     }
 
     // AttributeLists
-    sdp_client_parse_attribute_lists(packet+offset, attributeListByteCount);
+    sdp_client_parse_attribute_lists(connection, packet+offset, attributeListByteCount);
     offset+=attributeListByteCount;
 
-    continuationStateLen = packet[offset];
+    connection->continuation_state_len = packet[offset];
     offset++;
 
-    if (continuationStateLen > 16){
+    if (connection->continuation_state_len > 16){
         log_error("Error parsing ServiceSearchAttributeResponse: Number of bytes in continuation state exceedes 16.");
-        return;
+        return 0;
     }
-    memcpy(continuationState, packet+offset, continuationStateLen);
-    offset+=continuationStateLen;
+    memcpy(connection->continuation_state, packet+offset, connection->continuation_state_len);
+    offset+=connection->continuation_state_len;
 
     if (parameterLength != offset - 5){
         log_error("Error parsing ServiceSearchAttributeResponse: wrong size of parameters, number of expected bytes%u, actual number %u.", parameterLength, offset);
     }
+    return 1;
 }
 
-void sdp_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
-    UNUSED(size);
+static void sdp_client_handle_response(sdp_client_connection_t * connection, uint8_t *packet){
+    if (connection->state != W4_RESPONSE) return;
+
+    sdp_client_query_t * query = sdp_client_active_query(connection);
+    sdp_parser = &connection->parser;
+
+    uint16_t responseTransactionID = big_endian_read_16(packet,1);
+    if (responseTransactionID != connection->transaction_id){
+        log_error("Mismatching transaction ID, expected %u, found %u.", connection->transaction_id, responseTransactionID);
+        return;
+    } 
     
-    // uint16_t handle;
-    if (packet_type == L2CAP_DATA_PACKET){
-        uint16_t responseTransactionID = big_endian_read_16(packet,1);
-        if (responseTransactionID != transactionID){
-            log_error("Mismatching transaction ID, expected %u, found %u.", transactionID, responseTransactionID);
-            return;
-        } 
-        
-        if (packet[0] == SDP_ErrorResponse){
-            log_error("Received error response with code %u, disconnecting", packet[2]);
-            l2cap_disconnect(sdp_cid, 0);
-            return;
-        }
+    if (packet[0] == SDP_ErrorResponse){
+        log_error("Received error response with code %u, query %u", packet[2], query->query_id);
+#ifdef ENABLE_SDP_CLIENT_CACHE
+        sdp_client_cache_finalize(connection, 0);
+#endif
+        sdp_client_complete_query(connection, SDP_QUERY_INCOMPLETE);
+        return;
+    }
 
-        if (packet[0] != SDP_ServiceSearchAttributeResponse 
-         && packet[0] != SDP_ServiceSearchResponse
-         && packet[0] != SDP_ServiceAttributeResponse){
-            log_error("Not a valid PDU ID, expected %u, %u or %u, found %u.", SDP_ServiceSearchResponse, 
-                                    SDP_ServiceAttributeResponse, SDP_ServiceSearchAttributeResponse, packet[0]);
-            return;
-        }
+    if (packet[0] != query->pdu_id){
+        log_error("Not a valid PDU ID, expected %u, found %u.", query->pdu_id, packet[0]);
+        return;
+    }
 
-        PDU_ID = (SDP_PDU_ID_t)packet[0];
-        log_info("SDP Client :: PDU ID. %u ,%u", PDU_ID, packet[0]);
-        switch (PDU_ID){
+    log_info("SDP Client :: PDU ID. %u", packet[0]);
+    int ok = 0;
+    switch (packet[0]){
 #ifdef ENABLE_SDP_EXTRA_QUERIES
-            case SDP_ServiceSearchResponse:
-                sdp_client_parse_service_search_response(packet);
-                break;
-            case SDP_ServiceAttributeResponse:
-                sdp_client_parse_service_attribute_response(packet);
-                break;
+        case SDP_ServiceSearchResponse:
+            sdp_client_parse_service_search_response(connection, packet);
+            ok = 1;
+            break;
+        case SDP_ServiceAttributeResponse:
+            sdp_client_parse_service_attribute_response(connection, packet);
+            ok = 1;
+            break;
 #endif
-            case SDP_ServiceSearchAttributeResponse:
-                sdp_client_parse_service_search_attribute_response(packet);
-                break;
-            default:
-                log_error("SDP Client :: PDU ID invalid. %u ,%u", PDU_ID, packet[0]);
-                return;
-        }
+        case SDP_ServiceSearchAttributeResponse:
+            ok = sdp_client_parse_service_search_attribute_response(connection, packet);
+            break;
+        default:
+            log_error("SDP Client :: PDU ID invalid. %u", packet[0]);
+            break;
+    }
+    if (!ok){
+        // invalid response, drop channel
+        sdp_client_abort_queries(connection, SDP_QUERY_INCOMPLETE);
+        connection->state = W4_DISCONNECT;
+        l2cap_disconnect(connection->l2cap_cid, 0);
+        return;
+    }
 
-        // continuation set or DONE?
-        if (continuationStateLen == 0){
-            log_info("SDP Client Query DONE! ");
-            sdp_client_state = QUERY_COMPLETE;
-            l2cap_disconnect(sdp_cid, 0);
-            // sdp_parser_handle_done(0);
-            return;
-        }
-        // prepare next request and send
-        sdp_client_state = W2_SEND;
-        l2cap_request_can_send_now_event(sdp_cid);
+    // continuation set or DONE?
+    if (connection->continuation_state_len == 0){
+        sdp_client_query_complete(connection);
+        return;
+    }
+    // prepare next request and send
+    connection->state = W2_SEND;
+    l2cap_request_can_send_now_event(connection->l2cap_cid);
+}
+
+void sdp_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(size);
+
+    sdp_client_connection_t * connection;
+    
+    if (packet_type == L2CAP_DATA_PACKET){
+        connection = sdp_client_connection_for_l2cap_cid(channel);
+        if (!connection) return;
+        sdp_client_handle_response(connection, packet);
         return;
     }
     
@@ -449,52 +849,59 @@ void sdp_client_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *p
     
     switch(hci_event_packet_get_type(packet)){
         case L2CAP_EVENT_CHANNEL_OPENED:
-            if (sdp_client_state != W4_CONNECT) break;
+            connection = sdp_client_connection_for_l2cap_cid(l2cap_event_channel_opened_get_local_cid(packet));
+            if (!connection || connection->state != W4_CONNECT) break;
             // data: event (8), len(8), status (8), address(48), handle (16), psm (16), local_cid(16), remote_cid (16), local_mtu(16), remote_mtu(16) 
             if (packet[2]) {
                 log_error("SDP Client Connection failed.");
-                sdp_parser_handle_done(packet[2]);
+                connection->l2cap_cid = 0;
+                sdp_client_abort_queries(connection, packet[2]);
+                sdp_client_connection_finalize(connection);
                 break;
             }
-            sdp_cid = channel;
-            mtu = little_endian_read_16(packet, 17);
-            // handle = little_endian_read_16(packet, 9);
-            log_info("SDP Client Connected, cid %x, mtu %u.", sdp_cid, mtu);
+            connection->mtu = little_endian_read_16(packet, 17);
+            log_info("SDP Client Connected, cid %x, mtu %u.", connection->l2cap_cid, connection->mtu);
 
-            sdp_client_state = W2_SEND;
-            l2cap_request_can_send_now_event(sdp_cid);
+            connection->state = W2_SEND;
+            l2cap_request_can_send_now_event(connection->l2cap_cid);
             break;
 
         case L2CAP_EVENT_CAN_SEND_NOW:
-            if(l2cap_event_can_send_now_get_local_cid(packet) == sdp_cid){
-                sdp_client_send_request(sdp_cid);
-            }
+            connection = sdp_client_connection_for_l2cap_cid(l2cap_event_can_send_now_get_local_cid(packet));
+            if (!connection) break;
+            sdp_client_send_request(connection);
             break;
-        case L2CAP_EVENT_CHANNEL_CLOSED: {
-            if (sdp_cid != little_endian_read_16(packet, 2)) {
-                // log_info("Received L2CAP_EVENT_CHANNEL_CLOSED for cid %x, current cid %x\n",  little_endian_read_16(packet, 2),sdp_cid);
+
+        case L2CAP_EVENT_CHANNEL_CLOSED:
+            connection = sdp_client_connection_for_l2cap_cid(l2cap_event_channel_closed_get_local_cid(packet));
+            if (!connection) break;
+            log_info("SDP Client disconnected.");
+            connection->l2cap_cid = 0;
+            if (connection->state == W4_DISCONNECT && connection->num_queries){
+                // queries added while disconnecting, connect again
+                connection->state = INIT;
+                sdp_client_continue(connection);
                 break;
             }
-            log_info("SDP Client disconnected.");
-            uint8_t status = sdp_client_state == QUERY_COMPLETE ? 0 : SDP_QUERY_INCOMPLETE;
-            sdp_client_state = INIT;
-            sdp_parser_handle_done(status);
+            sdp_client_abort_queries(connection, SDP_QUERY_INCOMPLETE);
+            sdp_client_connection_finalize(connection);
             break;
-        }
+
         default:
             break;
     }
 }
 
 
-static uint16_t sdp_client_setup_service_search_attribute_request(uint8_t * data){
+static uint16_t sdp_client_setup_service_search_attribute_request(sdp_client_connection_t * connection, uint8_t * data){
 
+    sdp_client_query_t * query = sdp_client_active_query(connection);
     uint16_t offset = 0;
-    transactionID++;
+    connection->transaction_id++;
     // uint8_t SDP_PDU_ID_t.SDP_ServiceSearchRequest;
     data[offset++] = SDP_ServiceSearchAttributeRequest;
     // uint16_t transactionID
-    big_endian_store_16(data, offset, transactionID);
+    big_endian_store_16(data, offset, connection->transaction_id);
     offset += 2;
 
     // param legnth
@@ -502,24 +909,24 @@ static uint16_t sdp_client_setup_service_search_attribute_request(uint8_t * data
 
     // parameters: 
     //     Service_search_pattern - DES (min 1 UUID, max 12)
-    uint16_t service_search_pattern_len = de_get_len(service_search_pattern);
-    memcpy(data + offset, service_search_pattern, service_search_pattern_len);
+    uint16_t service_search_pattern_len = de_get_len(query->service_search_pattern);
+    memcpy(data + offset, query->service_search_pattern, service_search_pattern_len);
     offset += service_search_pattern_len;
 
     //     MaximumAttributeByteCount - uint16_t  0x0007 - 0xffff -> mtu
-    big_endian_store_16(data, offset, mtu);
+    big_endian_store_16(data, offset, connection->mtu);
     offset += 2;
 
     //     AttibuteIDList  
-    uint16_t attribute_id_list_len = de_get_len(attribute_id_list);
-    memcpy(data + offset, attribute_id_list, attribute_id_list_len);
+    uint16_t attribute_id_list_len = de_get_len(query->attribute_id_list);
+    memcpy(data + offset, query->attribute_id_list, attribute_id_list_len);
     offset += attribute_id_list_len;
 
     //     ContinuationState - uint8_t number of cont. bytes N<=16 
-    data[offset++] = continuationStateLen;
+    data[offset++] = connection->continuation_state_len;
     //                       - N-bytes previous response from server
-    memcpy(data + offset, continuationState, continuationStateLen);
-    offset += continuationStateLen;
+    memcpy(data + offset, connection->continuation_state, connection->continuation_state_len);
+    offset += connection->continuation_state_len;
 
     // uint16_t paramLength 
     big_endian_store_16(data, 3, offset - 5);
@@ -532,13 +939,14 @@ void sdp_client_parse_service_record_handle_list(uint8_t* packet, uint16_t total
     sdp_parser_handle_service_search(packet, total_count, current_count);
 }
 
-static uint16_t sdp_client_setup_service_search_request(uint8_t * data){
+static uint16_t sdp_client_setup_service_search_request(sdp_client_connection_t * connection, uint8_t * data){
+    sdp_client_query_t * query = sdp_client_active_query(connection);
     uint16_t offset = 0;
-    transactionID++;
+    connection->transaction_id++;
     // uint8_t SDP_PDU_ID_t.SDP_ServiceSearchRequest;
     data[offset++] = SDP_ServiceSearchRequest;
     // uint16_t transactionID
-    big_endian_store_16(data, offset, transactionID);
+    big_endian_store_16(data, offset, connection->transaction_id);
     offset += 2;
 
     // param legnth
@@ -546,19 +954,19 @@ static uint16_t sdp_client_setup_service_search_request(uint8_t * data){
 
     // parameters: 
     //     Service_search_pattern - DES (min 1 UUID, max 12)
-    uint16_t service_search_pattern_len = de_get_len(service_search_pattern);
-    memcpy(data + offset, service_search_pattern, service_search_pattern_len);
+    uint16_t service_search_pattern_len = de_get_len(query->service_search_pattern);
+    memcpy(data + offset, query->service_search_pattern, service_search_pattern_len);
     offset += service_search_pattern_len;
 
     //     MaximumAttributeByteCount - uint16_t  0x0007 - 0xffff -> mtu
-    big_endian_store_16(data, offset, mtu);
+    big_endian_store_16(data, offset, connection->mtu);
     offset += 2;
 
     //     ContinuationState - uint8_t number of cont. bytes N<=16 
-    data[offset++] = continuationStateLen;
+    data[offset++] = connection->continuation_state_len;
     //                       - N-bytes previous response from server
-    memcpy(data + offset, continuationState, continuationStateLen);
-    offset += continuationStateLen;
+    memcpy(data + offset, connection->continuation_state, connection->continuation_state_len);
+    offset += connection->continuation_state_len;
 
     // uint16_t paramLength 
     big_endian_store_16(data, 3, offset - 5);
@@ -567,14 +975,15 @@ static uint16_t sdp_client_setup_service_search_request(uint8_t * data){
 }
 
 
-static uint16_t sdp_client_setup_service_attribute_request(uint8_t * data){
+static uint16_t sdp_client_setup_service_attribute_request(sdp_client_connection_t * connection, uint8_t * data){
 
+    sdp_client_query_t * query = sdp_client_active_query(connection);
     uint16_t offset = 0;
-    transactionID++;
+    connection->transaction_id++;
     // uint8_t SDP_PDU_ID_t.SDP_ServiceSearchRequest;
     data[offset++] = SDP_ServiceAttributeRequest;
     // uint16_t transactionID
-    big_endian_store_16(data, offset, transactionID);
+    big_endian_store_16(data, offset, connection->transaction_id);
     offset += 2;
 
     // param legnth
@@ -582,23 +991,23 @@ static uint16_t sdp_client_setup_service_attribute_request(uint8_t * data){
 
     // parameters: 
     //     ServiceRecordHandle
-    big_endian_store_32(data, offset, serviceRecordHandle);
+    big_endian_store_32(data, offset, query->service_record_handle);
     offset += 4;
 
     //     MaximumAttributeByteCount - uint16_t  0x0007 - 0xffff -> mtu
-    big_endian_store_16(data, offset, mtu);
+    big_endian_store_16(data, offset, connection->mtu);
     offset += 2;
 
     //     AttibuteIDList  
-    uint16_t attribute_id_list_len = de_get_len(attribute_id_list);
-    memcpy(data + offset, attribute_id_list, attribute_id_list_len);
+    uint16_t attribute_id_list_len = de_get_len(query->attribute_id_list);
+    memcpy(data + offset, query->attribute_id_list, attribute_id_list_len);
     offset += attribute_id_list_len;
 
     //     ContinuationState - uint8_t number of cont. bytes N<=16 
-    data[offset++] = continuationStateLen;
+    data[offset++] = connection->continuation_state_len;
     //                       - N-bytes previous response from server
-    memcpy(data + offset, continuationState, continuationStateLen);
-    offset += continuationStateLen;
+    memcpy(data + offset, connection->continuation_state, connection->continuation_state_len);
+    offset += connection->continuation_state_len;
 
     // uint16_t paramLength 
     big_endian_store_16(data, 3, offset - 5);
@@ -606,7 +1015,7 @@ static uint16_t sdp_client_setup_service_attribute_request(uint8_t * data){
     return offset;
 }
 
-static void sdp_client_parse_service_search_response(uint8_t* packet){
+static void sdp_client_parse_service_search_response(sdp_client_connection_t * connection, uint8_t* packet){
     uint16_t offset = 3;
     uint16_t parameterLength = big_endian_read_16(packet,offset);
     offset+=2;
@@ -624,21 +1033,21 @@ static void sdp_client_parse_service_search_response(uint8_t* packet){
     sdp_client_parse_service_record_handle_list(packet+offset, totalServiceRecordCount, currentServiceRecordCount);
     offset+=(currentServiceRecordCount * 4);
 
-    continuationStateLen = packet[offset];
+    connection->continuation_state_len = packet[offset];
     offset++;
-    if (continuationStateLen > 16){
+    if (connection->continuation_state_len > 16){
         log_error("Error parsing ServiceSearchResponse: Number of bytes in continuation state exceedes 16.");
         return;
     }
-    memcpy(continuationState, packet+offset, continuationStateLen);
-    offset+=continuationStateLen;
+    memcpy(connection->continuation_state, packet+offset, connection->continuation_state_len);
+    offset+=connection->continuation_state_len;
 
     if (parameterLength != offset - 5){
         log_error("Error parsing ServiceSearchResponse: wrong size of parameters, number of expected bytes%u, actual number %u.", parameterLength, offset);
     }
 }
 
-static void sdp_client_parse_service_attribute_response(uint8_t* packet){
+static void sdp_client_parse_service_attribute_response(sdp_client_connection_t * connection, uint8_t* packet){
     uint16_t offset = 3;
     uint16_t parameterLength = big_endian_read_16(packet,offset);
     offset+=2;
@@ -647,24 +1056,24 @@ static void sdp_client_parse_service_attribute_response(uint8_t* packet){
     uint16_t attributeListByteCount = big_endian_read_16(packet,offset);
     offset+=2;
 
-    if (attributeListByteCount > mtu){
+    if (attributeListByteCount > connection->mtu){
         log_error("Error parsing ServiceSearchAttributeResponse: Number of bytes in found attribute list is larger then the MaximumAttributeByteCount.");
         return;
     }
 
     // AttributeLists
-    sdp_client_parse_attribute_lists(packet+offset, attributeListByteCount);
+    sdp_client_parse_attribute_lists(connection, packet+offset, attributeListByteCount);
     offset+=attributeListByteCount;
 
-    continuationStateLen = packet[offset];
+    connection->continuation_state_len = packet[offset];
     offset++;
 
-    if (continuationStateLen > 16){
+    if (connection->continuation_state_len > 16){
         log_error("Error parsing ServiceAttributeResponse: Number of bytes in continuation state exceedes 16.");
         return;
     }
-    memcpy(continuationState, packet+offset, continuationStateLen);
-    offset+=continuationStateLen;
+    memcpy(connection->continuation_state, packet+offset, connection->continuation_state_len);
+    offset+=connection->continuation_state_len;
 
     if (parameterLength != offset - 5){
         log_error("Error parsing ServiceAttributeResponse: wrong size of parameters, number of expected bytes%u, actual number %u.", parameterLength, offset);
@@ -674,74 +1083,113 @@ static void sdp_client_parse_service_attribute_response(uint8_t* packet){
 
 // for testing only
 void sdp_client_reset(void){
-    sdp_client_state = INIT;
+    while (sdp_client_connections){
+        sdp_client_connection_finalize((sdp_client_connection_t *) sdp_client_connections);
+    }
+    sdp_parser = &sdp_parser_default;
+}
+
+// queue query for remote, connect if needed
+static sdp_client_query_t * sdp_client_add_query(btstack_packet_handler_t callback, bd_addr_t remote, uint8_t pdu_id){
+    sdp_client_connection_t * connection = sdp_client_connection_for_address(remote);
+    if (!connection){
+        connection = sdp_client_connection_create(remote);
+        if (!connection) return NULL;
+    }
+    if (connection->num_queries == SDP_CLIENT_QUERY_QUEUE_SIZE) return NULL;
+    int index = (connection->queries_head + connection->num_queries) % SDP_CLIENT_QUERY_QUEUE_SIZE;
+    sdp_client_query_t * query = &connection->queries[index];
+    memset(query, 0, sizeof(sdp_client_query_t));
+    connection->num_queries++;
+    sdp_client_query_id++;
+    if (sdp_client_query_id == 0){
+        sdp_client_query_id = 1;
+    }
+    query->query_id = sdp_client_query_id;
+    query->callback = callback;
+    query->pdu_id = pdu_id;
+    return query;
+}
+
+// start query if connection is not busy
+static uint8_t sdp_client_run_query(bd_addr_t remote){
+    sdp_client_connection_t * connection = sdp_client_connection_for_address(remote);
+    if (connection == sdp_client_notifying_connection) return 0;
+    switch (connection->state){
+        case INIT:
+        case IDLE:
+            break;
+        default:
+            return 0;
+    }
+    uint8_t status = sdp_client_start_next_query(connection);
+    if (!status) return 0;
+    // drop new query without event, report status to caller instead
+    connection->num_queries--;
+    sdp_client_abort_queries(connection, status);
+    sdp_client_connection_finalize(connection);
+    return status;
 }
 
 // Public API
 
 int sdp_client_ready(void){
-    return sdp_client_state == INIT;
+    return btstack_linked_list_empty(&sdp_client_connections);
 }
 
-uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list){
+uint16_t sdp_client_get_last_query_id(void){
+    return sdp_client_query_id;
+}
 
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
+// copy service search pattern if possible, sdp_service_search_pattern_for_uuid* use a shared buffer
+static void sdp_client_query_set_service_search_pattern(sdp_client_query_t * query, const uint8_t * service_search_pattern){
+    uint16_t service_search_pattern_len = de_get_len(service_search_pattern);
+    if (service_search_pattern_len > SDP_CLIENT_UUID_SERVICE_SEARCH_PATTERN_SIZE){
+        query->service_search_pattern = service_search_pattern;
+        return;
+    }
+    memcpy(query->service_search_pattern_storage, service_search_pattern, service_search_pattern_len);
+    query->service_search_pattern = query->service_search_pattern_storage;
+}
 
-    sdp_parser_init(callback);
-    service_search_pattern = des_service_search_pattern;
-    attribute_id_list = des_attribute_id_list;
-    continuationStateLen = 0;
-    PDU_ID = SDP_ServiceSearchAttributeResponse;
+uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list){
+    sdp_client_query_t * query = sdp_client_add_query(callback, remote, SDP_ServiceSearchAttributeResponse);
+    if (!query) return SDP_QUERY_BUSY;
+    sdp_client_query_set_service_search_pattern(query, des_service_search_pattern);
+    query->attribute_id_list = des_attribute_id_list;
+    return sdp_client_run_query(remote);
+}
 
-    sdp_client_state = W4_CONNECT;
-    l2cap_create_channel(sdp_client_packet_handler, remote, BLUETOOTH_PROTOCOL_SDP, l2cap_max_mtu(), NULL);
-    return 0;
+uint8_t sdp_client_query_attribute_data(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list){
+    sdp_client_query_t * query = sdp_client_add_query(callback, remote, SDP_ServiceSearchAttributeResponse);
+    if (!query) return SDP_QUERY_BUSY;
+    sdp_client_query_set_service_search_pattern(query, des_service_search_pattern);
+    query->attribute_id_list = des_attribute_id_list;
+    query->attribute_data_mode = 1;
+    return sdp_client_run_query(remote);
 }
 
 uint8_t sdp_client_query_uuid16(btstack_packet_handler_t callback, bd_addr_t remote, uint16_t uuid){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
-    uint8_t * service_service_search_pattern = sdp_service_search_pattern_for_uuid16(uuid);
-    return sdp_client_query(callback, remote, service_service_search_pattern, des_attributeIDList);
+    return sdp_client_query(callback, remote, sdp_service_search_pattern_for_uuid16(uuid), des_attributeIDList);
 }
 
 uint8_t sdp_client_query_uuid128(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t* uuid){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
-    uint8_t * service_service_search_pattern = sdp_service_search_pattern_for_uuid128(uuid);
-    return sdp_client_query(callback, remote, service_service_search_pattern, des_attributeIDList);
+    return sdp_client_query(callback, remote, sdp_service_search_pattern_for_uuid128(uuid), des_attributeIDList);
 }
 
 #ifdef ENABLE_SDP_EXTRA_QUERIES
-uint8_t sdp_client_service_attribute_search(btstack_packet_handler_t callback, bd_addr_t remote, uint32_t search_service_record_handle, uint8_t * des_attribute_id_list){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
-    sdp_parser_init(callback);
-    serviceRecordHandle = search_service_record_handle;
-    attribute_id_list = des_attribute_id_list;
-    continuationStateLen = 0;
-    PDU_ID = SDP_ServiceAttributeResponse;
-
-    sdp_client_state = W4_CONNECT;
-    l2cap_create_channel(sdp_client_packet_handler, remote, BLUETOOTH_PROTOCOL_SDP, l2cap_max_mtu(), NULL);
-    return 0;
+uint8_t sdp_client_service_attribute_search(btstack_packet_handler_t callback, bd_addr_t remote, uint32_t search_service_record_handle, const uint8_t * des_attribute_id_list){
+    sdp_client_query_t * query = sdp_client_add_query(callback, remote, SDP_ServiceAttributeResponse);
+    if (!query) return SDP_QUERY_BUSY;
+    query->service_record_handle = search_service_record_handle;
+    query->attribute_id_list = des_attribute_id_list;
+    return sdp_client_run_query(remote);
 }
 
-uint8_t sdp_client_service_search(btstack_packet_handler_t callback, bd_addr_t remote, uint8_t * des_service_search_pattern){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
-    sdp_parser_init(callback);
-    service_search_pattern = des_service_search_pattern;
-    continuationStateLen = 0;
-    PDU_ID = SDP_ServiceSearchResponse;
-
-    sdp_client_state = W4_CONNECT;
-    l2cap_create_channel(sdp_client_packet_handler, remote, BLUETOOTH_PROTOCOL_SDP, l2cap_max_mtu(), NULL);
-    return 0;
+uint8_t sdp_client_service_search(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern){
+    sdp_client_query_t * query = sdp_client_add_query(callback, remote, SDP_ServiceSearchResponse);
+    if (!query) return SDP_QUERY_BUSY;
+    sdp_client_query_set_service_search_pattern(query, des_service_search_pattern);
+    return sdp_client_run_query(remote);
 }
 #endif
-
@@ -44,13 +44,47 @@
 
 #include "btstack_config.h"
 
+#include "btstack_linked_list.h"
+#include "btstack_run_loop.h"
 #include "btstack_util.h"
 
 #if defined __cplusplus
 extern "C" {
 #endif
 
-/* API_START */
+// max number of queries queued per remote device
+#ifndef SDP_CLIENT_QUERY_QUEUE_SIZE
+#define SDP_CLIENT_QUERY_QUEUE_SIZE 4
+#endif
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+// number of cached ServiceSearchAttribute responses
+#ifndef MAX_NR_SDP_CLIENT_CACHE_ENTRIES
+#define MAX_NR_SDP_CLIENT_CACHE_ENTRIES 4
+#endif
+// max size of service search pattern + attribute id list
+#ifndef SDP_CLIENT_CACHE_MAX_REQUEST_SIZE
+#define SDP_CLIENT_CACHE_MAX_REQUEST_SIZE 48
+#endif
+// max size of cached attribute lists, larger responses are not cached
+#ifndef SDP_CLIENT_CACHE_MAX_RESPONSE_SIZE
+#define SDP_CLIENT_CACHE_MAX_RESPONSE_SIZE 512
+#endif
+#ifndef SDP_CLIENT_CACHE_TTL_MS
+#define SDP_CLIENT_CACHE_TTL_MS 60000
+#endif
+#endif
+
+// max attribute data per SDP_EVENT_QUERY_ATTRIBUTE_DATA event, larger values are delivered in segments
+#ifndef SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE
+#define SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE 245
+#endif
+#if SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE > 245
+#error "SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE must not exceed 245 bytes to fit into an HCI event"
+#endif
+
+// space for service search pattern with single UUID128
+#define SDP_CLIENT_UUID_SERVICE_SEARCH_PATTERN_SIZE 19
 
 typedef struct de_state {
     uint8_t  in_state_GET_DE_HEADER_LENGTH ;
@@ -59,15 +93,78 @@ typedef struct de_state {
     uint32_t de_offset;
 } de_state_t; 
 
+// SDP Parser state, one per remote device
+typedef struct {
+    btstack_packet_handler_t callback;
+    uint16_t   query_id;
+    de_state_t de_header_state;
+    uint8_t    state;
+    uint16_t   attribute_id;
+    uint16_t   attribute_bytes_received;
+    uint16_t   attribute_bytes_delivered;
+    uint16_t   list_offset;
+    uint16_t   list_size;
+    uint16_t   record_offset;
+    uint16_t   record_size;
+    uint16_t   attribute_value_size;
+    int        record_counter;
+    uint8_t    attribute_header[5];     // DE header of attribute value, delivered when complete
+    // SDP_EVENT_QUERY_ATTRIBUTE_DATA mode
+    uint8_t    attribute_data_mode;
+    uint16_t   attribute_data_len;
+    uint8_t    attribute_data_event[12 + SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE];
+} sdp_parser_t;
+
+typedef struct {
+    btstack_packet_handler_t callback;
+    const uint8_t * service_search_pattern;
+    const uint8_t * attribute_id_list;
+    uint32_t        service_record_handle;
+    uint16_t        query_id;
+    uint8_t         pdu_id;     // expected response
+    uint8_t         attribute_data_mode;
+    uint8_t         service_search_pattern_storage[SDP_CLIENT_UUID_SERVICE_SEARCH_PATTERN_SIZE];
+} sdp_client_query_t;
+
+typedef struct {
+    btstack_linked_item_t item;
+    bd_addr_t   address;
+    uint16_t    l2cap_cid;
+    uint16_t    mtu;
+    uint16_t    transaction_id;
+    uint8_t     state;
+    uint8_t     continuation_state_len;
+    uint8_t     continuation_state[16];
+    sdp_parser_t parser;
+
+    // queued queries, active query at queries_head
+    sdp_client_query_t queries[SDP_CLIENT_QUERY_QUEUE_SIZE];
+    uint8_t     queries_head;
+    uint8_t     num_queries;
+
+    // deliver cached result from run loop
+    btstack_timer_source_t cache_timer;
+    int         cache_index;    // entry filled by active query, -1 = none
+} sdp_client_connection_t;
+
+/* API_START */
+
 void de_state_init(de_state_t * state);
 int  de_state_size(uint8_t eventByte, de_state_t *de_state);
 
 /** 
  * @brief Checks if the SDP Client is ready
+ * @note queries to different remote devices run in parallel, queries to the same device are queued
  * @return 1 when no query is active
  */
 int sdp_client_ready(void);
 
+/**
+ * @brief Get ID of the query started last. All SDP events of a query are delivered with its ID as channel.
+ * @return query_id
+ */
+uint16_t sdp_client_get_last_query_id(void);
+
 /** 
  * @brief Queries the SDP service of the remote device given a service search pattern and a list of attribute IDs. 
  * The remote data is handled by the SDP parser. The SDP parser delivers attribute values and done event via the callback.
@@ -78,6 +175,17 @@ int sdp_client_ready(void);
  */
 uint8_t sdp_client_query(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list);
 
+/** 
+ * @brief Queries the SDP service of the remote device like sdp_client_query, but delivers attribute values
+ * as SDP_EVENT_QUERY_ATTRIBUTE_DATA events instead of single bytes. Values split across continuation responses 
+ * are reassembled, values larger than SDP_CLIENT_ATTRIBUTE_DATA_MAX_SIZE are delivered in several events.
+ * @param callback for attributes data and done event
+ * @param remote address
+ * @param des_service_search_pattern 
+ * @param des_attribute_id_list
+ */
+uint8_t sdp_client_query_attribute_data(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern, const uint8_t * des_attribute_id_list);
+
 /*
  * @brief Searches SDP records on a remote device for all services with a given UUID.
  * @note calls sdp_client_query with service search pattern based on uuid16
@@ -112,6 +220,19 @@ uint8_t sdp_client_service_attribute_search(btstack_packet_handler_t callback, b
  */
 uint8_t sdp_client_service_search(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * des_service_search_pattern);
 
+/**
+ * @brief Remove cached results for remote device, e.g. after its services changed
+ * @note only provided if ENABLE_SDP_CLIENT_CACHE is defined
+ * @param remote address
+ */
+void sdp_client_cache_remove(bd_addr_t remote);
+
+/**
+ * @brief Remove all cached results
+ * @note only provided if ENABLE_SDP_CLIENT_CACHE is defined
+ */
+void sdp_client_cache_flush(void);
+
 
 /* API_END */
 
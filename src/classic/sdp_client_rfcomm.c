@@ -67,38 +67,50 @@ typedef enum {
     GET_PROTOCOL_VALUE
 } pdl_state_t;
 
+#ifndef SDP_CLIENT_RFCOMM_MAX_QUERIES
+#define SDP_CLIENT_RFCOMM_MAX_QUERIES 4
+#endif
+
 
 // higher layer query - get rfcomm channel and name
 
 // All attributes: 0x0001 - 0x0100
 static const uint8_t des_attributeIDList[]    = { 0x35, 0x05, 0x0A, 0x00, 0x01, 0x01, 0x00};  
 
-static uint8_t sdp_service_name[SDP_SERVICE_NAME_LEN+1];
-static uint8_t sdp_service_name_len = 0;
-static uint8_t sdp_rfcomm_channel_nr = 0;
-static uint8_t sdp_service_name_header_size;
-
-static pdl_state_t pdl_state = GET_PROTOCOL_LIST_LENGTH;
-static int protocol_value_bytes_received = 0;
-static uint16_t protocol_id = 0;
-static int protocol_offset;
-static int protocol_size;
-static int protocol_id_bytes_to_read;
-static int protocol_value_size;
-static de_state_t de_header_state;
-static de_state_t sn_de_header_state;
-static btstack_packet_handler_t sdp_app_callback;
-//
+typedef struct {
+    uint16_t query_id;      // 0 = unused
+    btstack_packet_handler_t callback;
+    // service
+    uint8_t service_name[SDP_SERVICE_NAME_LEN+1];
+    uint8_t service_name_len;
+    uint8_t rfcomm_channel_nr;
+    uint8_t service_name_header_size;
+    // protocol descriptor list parser
+    pdl_state_t pdl_state;
+    int protocol_value_bytes_received;
+    uint16_t protocol_id;
+    int protocol_offset;
+    int protocol_size;
+    int protocol_id_bytes_to_read;
+    int protocol_value_size;
+    de_state_t de_header_state;
+    de_state_t sn_de_header_state;
+} sdp_client_rfcomm_query_t;
+
+// one context per active query, events are routed by query id
+static sdp_client_rfcomm_query_t sdp_client_rfcomm_queries[SDP_CLIENT_RFCOMM_MAX_QUERIES];
+static sdp_client_rfcomm_query_t * context;
+
 
 static void sdp_rfcomm_query_emit_service(void){
     uint8_t event[3+SDP_SERVICE_NAME_LEN+1];
     event[0] = SDP_EVENT_QUERY_RFCOMM_SERVICE;
-    event[1] = sdp_service_name_len + 1;
-    event[2] = sdp_rfcomm_channel_nr;
-    memcpy(&event[3], sdp_service_name, sdp_service_name_len);
-    event[3+sdp_service_name_len] = 0;
-    (*sdp_app_callback)(HCI_EVENT_PACKET, 0, event, sizeof(event)); 
-    sdp_rfcomm_channel_nr = 0;
+    event[1] = context->service_name_len + 1;
+    event[2] = context->rfcomm_channel_nr;
+    memcpy(&event[3], context->service_name, context->service_name_len);
+    event[3+context->service_name_len] = 0;
+    (*context->callback)(HCI_EVENT_PACKET, context->query_id, event, sizeof(event)); 
+    context->rfcomm_channel_nr = 0;
 }
 
 static void sdp_client_query_rfcomm_handle_protocol_descriptor_list_data(uint32_t attribute_value_length, uint32_t data_offset, uint8_t data){
@@ -106,95 +118,95 @@ static void sdp_client_query_rfcomm_handle_protocol_descriptor_list_data(uint32_
     
     // init state on first byte
     if (data_offset == 0){
-        pdl_state = GET_PROTOCOL_LIST_LENGTH;
+        context->pdl_state = GET_PROTOCOL_LIST_LENGTH;
     }
 
     // log_info("sdp_client_query_rfcomm_handle_protocol_descriptor_list_data (%u,%u) %02x", attribute_value_length, data_offset, data);
 
-    switch(pdl_state){
+    switch(context->pdl_state){
         
         case GET_PROTOCOL_LIST_LENGTH:
-            if (!de_state_size(data, &de_header_state)) break;
-            // log_info("   query: PD List payload is %d bytes.", de_header_state.de_size);
-            // log_info("   query: PD List offset %u, list size %u", de_header_state.de_offset, de_header_state.de_size);
+            if (!de_state_size(data, &context->de_header_state)) break;
+            // log_info("   query: PD List payload is %d bytes.", context->de_header_state.de_size);
+            // log_info("   query: PD List offset %u, list size %u", context->de_header_state.de_offset, context->de_header_state.de_size);
 
-            pdl_state = GET_PROTOCOL_LENGTH;
+            context->pdl_state = GET_PROTOCOL_LENGTH;
             break;
         
         case GET_PROTOCOL_LENGTH:
             // check size
-            if (!de_state_size(data, &de_header_state)) break;
-            // log_info("   query: PD Record payload is %d bytes.", de_header_state.de_size);
+            if (!de_state_size(data, &context->de_header_state)) break;
+            // log_info("   query: PD Record payload is %d bytes.", context->de_header_state.de_size);
             
             // cache protocol info
-            protocol_offset = de_header_state.de_offset;
-            protocol_size   = de_header_state.de_size;
+            context->protocol_offset = context->de_header_state.de_offset;
+            context->protocol_size   = context->de_header_state.de_size;
 
-            pdl_state = GET_PROTOCOL_ID_HEADER_LENGTH;
+            context->pdl_state = GET_PROTOCOL_ID_HEADER_LENGTH;
             break;
         
        case GET_PROTOCOL_ID_HEADER_LENGTH:
-            protocol_offset++;
-            if (!de_state_size(data, &de_header_state)) break;
+            context->protocol_offset++;
+            if (!de_state_size(data, &context->de_header_state)) break;
             
-            protocol_id = 0;
-            protocol_id_bytes_to_read = de_header_state.de_size;
-            // log_info("   query: ID data is stored in %d bytes.", protocol_id_bytes_to_read);
-            pdl_state = GET_PROTOCOL_ID;
+            context->protocol_id = 0;
+            context->protocol_id_bytes_to_read = context->de_header_state.de_size;
+            // log_info("   query: ID data is stored in %d bytes.", context->protocol_id_bytes_to_read);
+            context->pdl_state = GET_PROTOCOL_ID;
             
             break;
         
         case GET_PROTOCOL_ID:
-            protocol_offset++;
+            context->protocol_offset++;
 
-            protocol_id = (protocol_id << 8) | data;
-            protocol_id_bytes_to_read--;
-            if (protocol_id_bytes_to_read > 0) break;
+            context->protocol_id = (context->protocol_id << 8) | data;
+            context->protocol_id_bytes_to_read--;
+            if (context->protocol_id_bytes_to_read > 0) break;
 
-            // log_info("   query: Protocol ID: %04x.", protocol_id);
+            // log_info("   query: Protocol ID: %04x.", context->protocol_id);
 
-            if (protocol_offset >= protocol_size){
-                pdl_state = GET_PROTOCOL_LENGTH;
+            if (context->protocol_offset >= context->protocol_size){
+                context->pdl_state = GET_PROTOCOL_LENGTH;
                 // log_info("   query: Get next protocol");
                 break;
             } 
             
-            pdl_state = GET_PROTOCOL_VALUE_LENGTH;
-            protocol_value_bytes_received = 0;
+            context->pdl_state = GET_PROTOCOL_VALUE_LENGTH;
+            context->protocol_value_bytes_received = 0;
             break;
         
         case GET_PROTOCOL_VALUE_LENGTH:
-            protocol_offset++;
+            context->protocol_offset++;
 
-            if (!de_state_size(data, &de_header_state)) break;
+            if (!de_state_size(data, &context->de_header_state)) break;
 
-            protocol_value_size = de_header_state.de_size;
-            pdl_state = GET_PROTOCOL_VALUE;
-            sdp_rfcomm_channel_nr = 0;
+            context->protocol_value_size = context->de_header_state.de_size;
+            context->pdl_state = GET_PROTOCOL_VALUE;
+            context->rfcomm_channel_nr = 0;
             break;
         
         case GET_PROTOCOL_VALUE:
-            protocol_offset++;
-            protocol_value_bytes_received++;
+            context->protocol_offset++;
+            context->protocol_value_bytes_received++;
            
-            // log_info("   query: protocol_value_bytes_received %u, protocol_value_size %u", protocol_value_bytes_received, protocol_value_size);
+            // log_info("   query: context->protocol_value_bytes_received %u, context->protocol_value_size %u", context->protocol_value_bytes_received, context->protocol_value_size);
 
-            if (protocol_value_bytes_received < protocol_value_size) break;
+            if (context->protocol_value_bytes_received < context->protocol_value_size) break;
 
-            if (protocol_id == BLUETOOTH_PROTOCOL_RFCOMM){
+            if (context->protocol_id == BLUETOOTH_PROTOCOL_RFCOMM){
                 //  log_info("\n\n *******  Data ***** %02x\n\n", data);
-                sdp_rfcomm_channel_nr = data;
+                context->rfcomm_channel_nr = data;
             }
 
             // log_info("   query: protocol done");
-            // log_info("   query: Protocol offset %u, protocol size %u", protocol_offset, protocol_size);
+            // log_info("   query: Protocol offset %u, protocol size %u", context->protocol_offset, context->protocol_size);
 
-            if (protocol_offset >= protocol_size) {
-                pdl_state = GET_PROTOCOL_LENGTH;
+            if (context->protocol_offset >= context->protocol_size) {
+                context->pdl_state = GET_PROTOCOL_LENGTH;
                 break;
 
             }
-            pdl_state = GET_PROTOCOL_ID_HEADER_LENGTH;
+            context->pdl_state = GET_PROTOCOL_ID_HEADER_LENGTH;
             // log_info("   query: Get next protocol");
             break;
         default:
@@ -206,58 +218,69 @@ static void sdp_client_query_rfcomm_handle_service_name_data(uint32_t attribute_
 
     // Get Header Len
     if (data_offset == 0){
-        de_state_size(data, &sn_de_header_state);
-        sdp_service_name_header_size = sn_de_header_state.addon_header_bytes + 1;
+        de_state_size(data, &context->sn_de_header_state);
+        context->service_name_header_size = context->sn_de_header_state.addon_header_bytes + 1;
         return;
     }
 
     // Get Header
-    if (data_offset < sdp_service_name_header_size){
-        de_state_size(data, &sn_de_header_state);
+    if (data_offset < context->service_name_header_size){
+        de_state_size(data, &context->sn_de_header_state);
         return;
     }
 
     // Process payload
-    int name_len = attribute_value_length - sdp_service_name_header_size;
-    int name_pos = data_offset - sdp_service_name_header_size;
+    int name_len = attribute_value_length - context->service_name_header_size;
+    int name_pos = data_offset - context->service_name_header_size;
 
     if (name_pos < SDP_SERVICE_NAME_LEN){
-        sdp_service_name[name_pos] = data;
+        context->service_name[name_pos] = data;
         name_pos++;
 
         // terminate if name complete
         if (name_pos >= name_len){
-            sdp_service_name[name_pos] = 0;
-            sdp_service_name_len = name_pos;            
+            context->service_name[name_pos] = 0;
+            context->service_name_len = name_pos;            
         } 
 
         // terminate if buffer full
         if (name_pos == SDP_SERVICE_NAME_LEN){
-            sdp_service_name[name_pos] = 0;            
-            sdp_service_name_len = name_pos;            
+            context->service_name[name_pos] = 0;            
+            context->service_name_len = name_pos;            
         }
     }
 
     // notify on last char
-    if (data_offset == attribute_value_length - 1 && sdp_rfcomm_channel_nr!=0){
+    if (data_offset == attribute_value_length - 1 && context->rfcomm_channel_nr!=0){
         sdp_rfcomm_query_emit_service();
     }
 }
 
+static sdp_client_rfcomm_query_t * sdp_client_query_rfcomm_context_for_query_id(uint16_t query_id){
+    int i;
+    for (i=0;i<SDP_CLIENT_RFCOMM_MAX_QUERIES;i++){
+        if (sdp_client_rfcomm_queries[i].query_id == query_id) return &sdp_client_rfcomm_queries[i];
+    }
+    return NULL;
+}
+
 static void sdp_client_query_rfcomm_handle_sdp_parser_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
     UNUSED(packet_type);
-    UNUSED(channel);
+
+    // SDP Client reports query id as channel
+    context = sdp_client_query_rfcomm_context_for_query_id(channel);
+    if (!context) return;
 
     switch (hci_event_packet_get_type(packet)){
         case SDP_EVENT_QUERY_SERVICE_RECORD_HANDLE:
             // handle service without a name
-            if (sdp_rfcomm_channel_nr){
+            if (context->rfcomm_channel_nr){
                 sdp_rfcomm_query_emit_service();
             }
 
             // prepare for new record
-            sdp_rfcomm_channel_nr = 0;
-            sdp_service_name[0] = 0;
+            context->rfcomm_channel_nr = 0;
+            context->service_name[0] = 0;
             break;
         case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
             // log_info("sdp_client_query_rfcomm_handle_sdp_parser_event [ AID, ALen, DOff, Data] : [%x, %u, %u] BYTE %02x", 
@@ -283,51 +306,56 @@ static void sdp_client_query_rfcomm_handle_sdp_parser_event(uint8_t packet_type,
             break;
         case SDP_EVENT_QUERY_COMPLETE:
             // handle service without a name
-            if (sdp_rfcomm_channel_nr){
+            if (context->rfcomm_channel_nr){
                 sdp_rfcomm_query_emit_service();
             }
-            (*sdp_app_callback)(HCI_EVENT_PACKET, 0, packet, size); 
+            // free context before callback, so it can start a new query
+            context->query_id = 0;
+            (*context->callback)(HCI_EVENT_PACKET, channel, packet, size); 
             break;
     }
     // insert higher level code HERE
 }
 
+static void sdp_client_query_rfcomm_context_init(sdp_client_rfcomm_query_t * query_context){
+    de_state_init(&query_context->de_header_state);
+    de_state_init(&query_context->sn_de_header_state);
+    query_context->pdl_state = GET_PROTOCOL_LIST_LENGTH;
+    query_context->protocol_offset = 0;
+    query_context->rfcomm_channel_nr = 0;
+    query_context->service_name[0] = 0;
+}
+
 void sdp_client_query_rfcomm_init(void){
-    // init
-    de_state_init(&de_header_state);
-    de_state_init(&sn_de_header_state);
-    pdl_state = GET_PROTOCOL_LIST_LENGTH;
-    protocol_offset = 0;
-    sdp_rfcomm_channel_nr = 0;
-    sdp_service_name[0] = 0;
+    int i;
+    for (i=0;i<SDP_CLIENT_RFCOMM_MAX_QUERIES;i++){
+        sdp_client_rfcomm_queries[i].query_id = 0;
+        sdp_client_query_rfcomm_context_init(&sdp_client_rfcomm_queries[i]);
+    }
 }
 
 // Public API
 
 uint8_t sdp_client_query_rfcomm_channel_and_name_for_search_pattern(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * service_search_pattern){
 
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
+    sdp_client_rfcomm_query_t * query_context = sdp_client_query_rfcomm_context_for_query_id(0);
+    if (!query_context) return SDP_QUERY_BUSY;
+
+    uint8_t status = sdp_client_query(&sdp_client_query_rfcomm_handle_sdp_parser_event, remote, service_search_pattern, (uint8_t*)&des_attributeIDList[0]);
+    if (status) return status;
 
-    sdp_app_callback = callback;
-    sdp_client_query_rfcomm_init();
-    sdp_client_query(&sdp_client_query_rfcomm_handle_sdp_parser_event, remote, service_search_pattern, (uint8_t*)&des_attributeIDList[0]);
+    query_context->query_id = sdp_client_get_last_query_id();
+    query_context->callback = callback;
+    sdp_client_query_rfcomm_context_init(query_context);
     return 0;
 }
 
 uint8_t sdp_client_query_rfcomm_channel_and_name_for_uuid(btstack_packet_handler_t callback, bd_addr_t remote, uint16_t uuid16){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
     uint8_t * service_search_pattern = sdp_service_search_pattern_for_uuid16(uuid16);
-    sdp_client_query_rfcomm_channel_and_name_for_search_pattern(callback, remote, service_search_pattern);
-    return 0;
+    return sdp_client_query_rfcomm_channel_and_name_for_search_pattern(callback, remote, service_search_pattern);
 }
 
 uint8_t sdp_client_query_rfcomm_channel_and_name_for_uuid128(btstack_packet_handler_t callback, bd_addr_t remote, const uint8_t * uuid128){
-
-    if (!sdp_client_ready()) return SDP_QUERY_BUSY;
-
     uint8_t * service_search_pattern = sdp_service_search_pattern_for_uuid128(uuid128);
-    sdp_client_query_rfcomm_channel_and_name_for_search_pattern(callback, remote, service_search_pattern);
-    return 0;
+    return sdp_client_query_rfcomm_channel_and_name_for_search_pattern(callback, remote, service_search_pattern);
 }
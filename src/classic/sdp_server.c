@@ -57,9 +57,14 @@
 // max reserved ServiceRecordHandle
 #define maxReservedServiceRecordHandle 0xffff
 
-// max SDP response matches L2CAP PDU -- allow to use smaller buffer
-#ifndef SDP_RESPONSE_BUFFER_SIZE
-#define SDP_RESPONSE_BUFFER_SIZE (HCI_ACL_BUFFER_SIZE-HCI_ACL_HEADER_SIZE)
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+#ifndef MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES
+#define MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES 4
+#endif
+// requests with larger parameters (long UUID lists) are not cached
+#ifndef SDP_SERVER_RESPONSE_CACHE_MAX_REQUEST_SIZE
+#define SDP_SERVER_RESPONSE_CACHE_MAX_REQUEST_SIZE 32
+#endif
 #endif
 
 static void sdp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size);
@@ -70,16 +75,132 @@ static btstack_linked_list_t sdp_service_records = NULL;
 // our handles start after the reserved range
 static uint32_t sdp_next_service_record_handle = ((uint32_t) maxReservedServiceRecordHandle) + 2;
 
-static uint8_t sdp_response_buffer[SDP_RESPONSE_BUFFER_SIZE];
+// active connections, one per L2CAP channel
+static btstack_linked_list_t sdp_server_connections;
+
+// one connection is always available, additional ones are taken from btstack_memory
+static sdp_server_connection_t sdp_server_default_connection;
 
-static uint16_t l2cap_cid = 0;
-static uint16_t sdp_response_size = 0;
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+// serialized responses indexed by request (PDU ID + parameters) and effective MTU
+typedef struct {
+    uint16_t request_size;      // 0 = unused
+    uint16_t remote_mtu;
+    uint16_t response_size;
+    uint32_t last_used;
+    uint8_t  request[SDP_SERVER_RESPONSE_CACHE_MAX_REQUEST_SIZE];
+    uint8_t  response[SDP_RESPONSE_BUFFER_SIZE];
+} sdp_server_response_cache_entry_t;
+
+static sdp_server_response_cache_entry_t sdp_server_response_cache[MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES];
+static uint32_t sdp_server_response_cache_time;
+#endif
 
 void sdp_init(void){
     // register with l2cap psm sevices - max MTU
     l2cap_register_service(sdp_packet_handler, BLUETOOTH_PROTOCOL_SDP, 0xffff, LEVEL_0);
 }
 
+static sdp_server_connection_t * sdp_server_connection_for_l2cap_cid(uint16_t l2cap_cid){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &sdp_server_connections);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        sdp_server_connection_t * connection = (sdp_server_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (connection->l2cap_cid == l2cap_cid) return connection;
+    }
+    return NULL;
+}
+
+static sdp_server_connection_t * sdp_server_connection_create(uint16_t l2cap_cid){
+    sdp_server_connection_t * connection;
+    if (sdp_server_default_connection.l2cap_cid == 0){
+        connection = &sdp_server_default_connection;
+    } else {
+        connection = btstack_memory_sdp_server_connection_get();
+        if (!connection) return NULL;
+    }
+    connection->l2cap_cid = l2cap_cid;
+    connection->response_size = 0;
+    btstack_linked_list_add(&sdp_server_connections, (btstack_linked_item_t *) connection);
+    return connection;
+}
+
+static void sdp_server_connection_finalize(sdp_server_connection_t * connection){
+    btstack_linked_list_remove(&sdp_server_connections, (btstack_linked_item_t *) connection);
+    connection->l2cap_cid = 0;
+    connection->response_size = 0;
+    if (connection == &sdp_server_default_connection) return;
+    btstack_memory_sdp_server_connection_free(connection);
+}
+
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+
+static void sdp_server_response_cache_invalidate(void){
+    int i;
+    for (i=0;i<MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES;i++){
+        sdp_server_response_cache[i].request_size = 0;
+    }
+}
+
+// request is stored as PDU ID + parameters, transaction ID and parameter length are skipped
+static int sdp_server_response_cache_request_size(const uint8_t * packet, uint16_t size){
+    if (size < 5) return 0;
+    uint16_t param_len = big_endian_read_16(packet, 3);
+    if (5 + param_len > size) return 0;
+    if (1 + param_len > SDP_SERVER_RESPONSE_CACHE_MAX_REQUEST_SIZE) return 0;
+    return 1 + param_len;
+}
+
+static int sdp_server_response_cache_matches(const sdp_server_response_cache_entry_t * entry, const uint8_t * packet, uint16_t request_size, uint16_t remote_mtu){
+    if (entry->request_size != request_size) return 0;
+    if (entry->remote_mtu   != remote_mtu)   return 0;
+    if (entry->request[0]   != packet[0])    return 0;
+    return memcmp(&entry->request[1], &packet[5], request_size - 1) == 0;
+}
+
+// @returns response size or 0 if not cached
+static uint16_t sdp_server_response_cache_lookup(const uint8_t * packet, uint16_t size, uint16_t remote_mtu, uint8_t * response_buffer){
+    uint16_t request_size = sdp_server_response_cache_request_size(packet, size);
+    if (!request_size) return 0;
+    int i;
+    for (i=0;i<MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES;i++){
+        sdp_server_response_cache_entry_t * entry = &sdp_server_response_cache[i];
+        if (!sdp_server_response_cache_matches(entry, packet, request_size, remote_mtu)) continue;
+        entry->last_used = ++sdp_server_response_cache_time;
+        memcpy(response_buffer, entry->response, entry->response_size);
+        // patch transaction id
+        big_endian_store_16(response_buffer, 1, big_endian_read_16(packet, 1));
+        return entry->response_size;
+    }
+    return 0;
+}
+
+static void sdp_server_response_cache_store(const uint8_t * packet, uint16_t size, uint16_t remote_mtu, const uint8_t * response_buffer, uint16_t response_size){
+    uint16_t request_size = sdp_server_response_cache_request_size(packet, size);
+    if (!request_size) return;
+    // replace unused or least recently used entry
+    sdp_server_response_cache_entry_t * entry = &sdp_server_response_cache[0];
+    int i;
+    for (i=0;i<MAX_NR_SDP_SERVER_RESPONSE_CACHE_ENTRIES;i++){
+        sdp_server_response_cache_entry_t * candidate = &sdp_server_response_cache[i];
+        if (candidate->request_size == 0){
+            entry = candidate;
+            break;
+        }
+        if (candidate->last_used < entry->last_used){
+            entry = candidate;
+        }
+    }
+    entry->request_size  = request_size;
+    entry->remote_mtu    = remote_mtu;
+    entry->response_size = response_size;
+    entry->last_used     = ++sdp_server_response_cache_time;
+    entry->request[0]    = packet[0];
+    memcpy(&entry->request[1], &packet[5], request_size - 1);
+    memcpy(entry->response, response_buffer, response_size);
+}
+#endif
+
 uint32_t sdp_get_service_record_handle(const uint8_t * record){
     // TODO: make sdp_get_attribute_value_for_attribute_id accept const data to remove cast
     uint8_t * serviceRecordHandleAttribute = sdp_get_attribute_value_for_attribute_id((uint8_t *)record, BLUETOOTH_ATTRIBUTE_SERVICE_RECORD_HANDLE);
@@ -141,7 +262,11 @@ uint8_t sdp_register_service(const uint8_t * record){
     
     // add to linked list
     btstack_linked_list_add(&sdp_service_records, (btstack_linked_item_t *) newRecordItem);
-    
+
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+    sdp_server_response_cache_invalidate();
+#endif
+
     return 0;
 }
 
@@ -152,12 +277,15 @@ void sdp_unregister_service(uint32_t service_record_handle){
     service_record_item_t * record_item = sdp_get_record_item_for_handle(service_record_handle);
     if (!record_item) return;
     btstack_linked_list_remove(&sdp_service_records, (btstack_linked_item_t *) record_item);
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+    sdp_server_response_cache_invalidate();
+#endif
 }
 
 // PDU
 // PDU ID (1), Transaction ID (2), Param Length (2), Param 1, Param 2, ..
 
-static int sdp_create_error_response(uint16_t transaction_id, uint16_t error_code){
+static int sdp_create_error_response(uint16_t transaction_id, uint16_t error_code, uint8_t * sdp_response_buffer){
     sdp_response_buffer[0] = SDP_ErrorResponse;
     big_endian_store_16(sdp_response_buffer, 1, transaction_id);
     big_endian_store_16(sdp_response_buffer, 3, 2);
@@ -165,7 +293,7 @@ static int sdp_create_error_response(uint16_t transaction_id, uint16_t error_cod
     return 7;
 }
 
-int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu){
+int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer){
     
     // get request details
     uint16_t  transaction_id = big_endian_read_16(packet, 1);
@@ -242,7 +370,7 @@ int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu){
     return pos;
 }
 
-int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu){
+int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer){
     
     // get request details
     uint16_t  transaction_id = big_endian_read_16(packet, 1);
@@ -269,7 +397,7 @@ int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu){
     service_record_item_t * item = sdp_get_record_item_for_handle(serviceRecordHandle);
     if (!item){
         // service record handle doesn't exist
-        return sdp_create_error_response(transaction_id, 0x0002); /// invalid Service Record Handle
+        return sdp_create_error_response(transaction_id, 0x0002, sdp_response_buffer); /// invalid Service Record Handle
     }
     
     
@@ -326,7 +454,7 @@ static uint16_t sdp_get_size_for_service_search_attribute_response(uint8_t * ser
     return total_response_size;
 }
 
-int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remote_mtu){
+int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer){
     
     // SDP header before attribute sevice list: 7
     // Continuation, worst case: 5
@@ -439,58 +567,72 @@ int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remot
     return pos;
 }
 
-static void sdp_respond(void){
-    if (!sdp_response_size ) return;
-    if (!l2cap_cid) return;
+static void sdp_respond(sdp_server_connection_t * connection){
+    if (!connection->response_size ) return;
     
     // update state before sending packet (avoid getting called when new l2cap credit gets emitted)
-    uint16_t size = sdp_response_size;
-    sdp_response_size = 0;
-    l2cap_send(l2cap_cid, sdp_response_buffer, size);
+    uint16_t size = connection->response_size;
+    connection->response_size = 0;
+    l2cap_send(connection->l2cap_cid, connection->response_buffer, size);
 }
 
-// we assume that we don't get two requests in a row
-static void sdp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+static uint16_t sdp_create_response(uint8_t * packet, uint16_t size, uint16_t remote_mtu, uint8_t * response_buffer){
+    SDP_PDU_ID_t pdu_id = (SDP_PDU_ID_t) packet[0];
+    uint16_t transaction_id = big_endian_read_16(packet, 1);
+    uint16_t response_size;
+
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+    response_size = sdp_server_response_cache_lookup(packet, size, remote_mtu, response_buffer);
+    if (response_size) return response_size;
+#else
     UNUSED(size);
-    
-	uint16_t transaction_id;
-    SDP_PDU_ID_t pdu_id;
+#endif
+
+    // log_info("SDP Request: type %u, transaction id %u, mtu %u", pdu_id, transaction_id, remote_mtu);
+    switch (pdu_id){
+
+        case SDP_ServiceSearchRequest:
+            response_size = sdp_handle_service_search_request(packet, remote_mtu, response_buffer);
+            break;
+
+        case SDP_ServiceAttributeRequest:
+            response_size = sdp_handle_service_attribute_request(packet, remote_mtu, response_buffer);
+            break;
+
+        case SDP_ServiceSearchAttributeRequest:
+            response_size = sdp_handle_service_search_attribute_request(packet, remote_mtu, response_buffer);
+            break;
+
+        default:
+            // invalid syntax, not cached
+            return sdp_create_error_response(transaction_id, 0x0003, response_buffer);
+    }
+
+#ifdef ENABLE_SDP_SERVER_RESPONSE_CACHE
+    sdp_server_response_cache_store(packet, size, remote_mtu, response_buffer, response_size);
+#endif
+    return response_size;
+}
+
+// each connection handles one request at a time
+static void sdp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    sdp_server_connection_t * connection;
     uint16_t remote_mtu;
-    // uint16_t param_len;
+    uint16_t l2cap_cid;
     
 	switch (packet_type) {
 			
 		case L2CAP_DATA_PACKET:
-            pdu_id = (SDP_PDU_ID_t) packet[0];
-            transaction_id = big_endian_read_16(packet, 1);
-            // param_len = big_endian_read_16(packet, 3);
+            connection = sdp_server_connection_for_l2cap_cid(channel);
+            if (!connection) break;
             remote_mtu = l2cap_get_remote_mtu_for_local_cid(channel);
             // account for our buffer
             if (remote_mtu > SDP_RESPONSE_BUFFER_SIZE){
                 remote_mtu = SDP_RESPONSE_BUFFER_SIZE;
             }
-            
-            // log_info("SDP Request: type %u, transaction id %u, len %u, mtu %u", pdu_id, transaction_id, param_len, remote_mtu);
-            switch (pdu_id){
-                    
-                case SDP_ServiceSearchRequest:
-                    sdp_response_size = sdp_handle_service_search_request(packet, remote_mtu);
-                    break;
-                                        
-                case SDP_ServiceAttributeRequest:
-                    sdp_response_size = sdp_handle_service_attribute_request(packet, remote_mtu);
-                    break;
-                    
-                case SDP_ServiceSearchAttributeRequest:
-                    sdp_response_size = sdp_handle_service_search_attribute_request(packet, remote_mtu);
-                    break;
-                    
-                default:
-                    sdp_response_size = sdp_create_error_response(transaction_id, 0x0003); // invalid syntax
-                    break;
-            }
-            if (!sdp_response_size) break;
-            l2cap_request_can_send_now_event(l2cap_cid);
+            connection->response_size = sdp_create_response(packet, size, remote_mtu, connection->response_buffer);
+            if (!connection->response_size) break;
+            l2cap_request_can_send_now_event(channel);
 			break;
 			
 		case HCI_EVENT_PACKET:
@@ -498,33 +640,35 @@ static void sdp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *p
 			switch (hci_event_packet_get_type(packet)) {
 
 				case L2CAP_EVENT_INCOMING_CONNECTION:
-                    if (l2cap_cid) {
+                    l2cap_cid = l2cap_event_incoming_connection_get_local_cid(packet);
+                    connection = sdp_server_connection_create(l2cap_cid);
+                    if (!connection) {
                         // CONNECTION REJECTED DUE TO LIMITED RESOURCES 
-                        l2cap_decline_connection(channel);
+                        l2cap_decline_connection(l2cap_cid);
                         break;
                     }
                     // accept
-                    l2cap_cid = channel;
-                    sdp_response_size = 0;
-                    l2cap_accept_connection(channel);
+                    l2cap_accept_connection(l2cap_cid);
 					break;
                     
                 case L2CAP_EVENT_CHANNEL_OPENED:
-                    if (packet[2]) {
-                        // open failed -> reset
-                        l2cap_cid = 0;
-                    }
+                    if (l2cap_event_channel_opened_get_status(packet) == 0) break;
+                    // open failed -> reset
+                    connection = sdp_server_connection_for_l2cap_cid(l2cap_event_channel_opened_get_local_cid(packet));
+                    if (!connection) break;
+                    sdp_server_connection_finalize(connection);
                     break;
 
                 case L2CAP_EVENT_CAN_SEND_NOW:
-                    sdp_respond();
+                    connection = sdp_server_connection_for_l2cap_cid(l2cap_event_can_send_now_get_local_cid(packet));
+                    if (!connection) break;
+                    sdp_respond(connection);
                     break;
                 
                 case L2CAP_EVENT_CHANNEL_CLOSED:
-                    if (channel == l2cap_cid){
-                        // reset
-                        l2cap_cid = 0;
-                    }
+                    connection = sdp_server_connection_for_l2cap_cid(l2cap_event_channel_closed_get_local_cid(packet));
+                    if (!connection) break;
+                    sdp_server_connection_finalize(connection);
                     break;
 					                    
 				default:
@@ -538,4 +682,3 @@ static void sdp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *p
 			break;
 	}
 }
-
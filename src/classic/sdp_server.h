@@ -39,6 +39,7 @@
 
 #include <stdint.h>
 #include "btstack_linked_list.h"
+#include "hci.h"
 
 #include "btstack_config.h"
 
@@ -54,9 +55,24 @@ typedef struct {
     uint8_t *       service_record;
 } service_record_item_t;
 
-int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu);
-int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu);
-int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remote_mtu);
+// max SDP response matches L2CAP PDU -- allow to use smaller buffer
+#ifndef SDP_RESPONSE_BUFFER_SIZE
+#define SDP_RESPONSE_BUFFER_SIZE (HCI_ACL_BUFFER_SIZE-HCI_ACL_HEADER_SIZE)
+#endif
+
+// per L2CAP channel state, allows to serve several SDP clients in parallel
+typedef struct {
+    // linked list - assert: first field
+    btstack_linked_item_t   item;
+
+    uint16_t        l2cap_cid;
+    uint16_t        response_size;
+    uint8_t         response_buffer[SDP_RESPONSE_BUFFER_SIZE];
+} sdp_server_connection_t;
+
+int sdp_handle_service_search_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer);
+int sdp_handle_service_attribute_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer);
+int sdp_handle_service_search_attribute_request(uint8_t * packet, uint16_t remote_mtu, uint8_t * sdp_response_buffer);
 
 /* API_START */
 
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "vcard_parser.c"
+ 
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bluetooth.h"
+#include "btstack_debug.h"
+#include "classic/vcard_parser.h"
+
+//------------------------------------------------------------------------------------------------------------
+// vcard_parser.c
+//
+// Lines are collected in the line buffer until the first character of the next line shows that the
+// line isn't folded (RFC 2425 5.8.1). Soft line breaks of QUOTED-PRINTABLE values (vCard 2.1) are
+// removed as well.
+//
+
+typedef enum {
+    VCARD_PARSER_STATE_W4_END_OF_LINE = 0,
+    VCARD_PARSER_STATE_W4_CONTINUATION,
+} vcard_parser_state_t;
+
+static int vcard_parser_equals_ignore_case(const char * a, const char * b){
+    while (*a && *b){
+        char ca = *a++;
+        char cb = *b++;
+        if (ca >= 'a' && ca <= 'z') ca -= 'a' - 'A';
+        if (cb >= 'a' && cb <= 'z') cb -= 'a' - 'A';
+        if (ca != cb) return 0;
+    }
+    return *a == *b;
+}
+
+static int vcard_parser_contains_ignore_case(const char * data, uint16_t len, const char * pattern){
+    uint16_t pattern_len = strlen(pattern);
+    uint16_t i;
+    if (len < pattern_len) return 0;
+    for (i = 0; i <= len - pattern_len; i++){
+        uint16_t j;
+        for (j = 0; j < pattern_len; j++){
+            char c = data[i+j];
+            if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+            if (c != pattern[j]) break;
+        }
+        if (j == pattern_len) return 1;
+    }
+    return 0;
+}
+
+static void vcard_parser_reset_line(vcard_parser_t * parser){
+    parser->line_len = 0;
+    parser->line_truncated = 0;
+}
+
+static void vcard_parser_append(vcard_parser_t * parser, const uint8_t * data, uint16_t len){
+    // keep one byte for '\0'
+    uint16_t bytes_free = parser->line_buffer_size - 1 - parser->line_len;
+    if (len > bytes_free){
+        len = bytes_free;
+        parser->line_truncated = 1;
+    }
+    memcpy(&parser->line_buffer[parser->line_len], data, len);
+    parser->line_len += len;
+}
+
+static void vcard_parser_emit(vcard_parser_t * parser, vcard_parser_event_t event, const vcard_parser_property_t * property){
+    (*parser->callback)(parser->context, event, property);
+}
+
+static void vcard_parser_handle_line(vcard_parser_t * parser){
+    char * line = parser->line_buffer;
+    line[parser->line_len] = 0;
+    char * colon = (char *) memchr(line, ':', parser->line_len);
+    if (!colon) {
+        log_info("vcard_parser: skip line without value");
+        vcard_parser_reset_line(parser);
+        return;
+    }
+    *colon = 0;
+    vcard_parser_property_t property;
+    property.name = line;
+    property.params = "";
+    property.value = colon + 1;
+    property.value_len = parser->line_len - (colon + 1 - line);
+    property.truncated = parser->line_truncated;
+    char * semicolon = (char *) memchr(line, ';', colon - line);
+    if (semicolon){
+        *semicolon = 0;
+        property.params = semicolon + 1;
+    }
+    vcard_parser_reset_line(parser);
+
+    if (vcard_parser_equals_ignore_case(property.name, "BEGIN") && vcard_parser_equals_ignore_case(property.value, "VCARD")){
+        parser->in_contact = 1;
+        vcard_parser_emit(parser, VCARD_PARSER_EVENT_CONTACT_START, NULL);
+        return;
+    }
+    if (!parser->in_contact) return;
+    if (vcard_parser_equals_ignore_case(property.name, "END") && vcard_parser_equals_ignore_case(property.value, "VCARD")){
+        parser->in_contact = 0;
+        parser->num_contacts++;
+        vcard_parser_emit(parser, VCARD_PARSER_EVENT_CONTACT_END, NULL);
+        return;
+    }
+    vcard_parser_emit(parser, VCARD_PARSER_EVENT_PROPERTY, &property);
+}
+
+static void vcard_parser_handle_end_of_line(vcard_parser_t * parser){
+    // strip CR of CRLF
+    if (parser->line_len && parser->line_buffer[parser->line_len-1] == '\r'){
+        parser->line_len--;
+    }
+    if (parser->line_len == 0) return;
+
+    // QUOTED-PRINTABLE soft line break: drop '=' and continue with next line
+    if (parser->line_buffer[parser->line_len-1] == '='){
+        char * colon = (char *) memchr(parser->line_buffer, ':', parser->line_len);
+        if (colon && vcard_parser_contains_ignore_case(parser->line_buffer, colon - parser->line_buffer, "QUOTED-PRINTABLE")){
+            parser->line_len--;
+            return;
+        }
+    }
+    parser->state = VCARD_PARSER_STATE_W4_CONTINUATION;
+}
+
+uint8_t vcard_parser_init(vcard_parser_t * parser, char * line_buffer, uint16_t line_buffer_size, vcard_parser_callback_t callback, void * context){
+    memset(parser, 0, sizeof(vcard_parser_t));
+    // line buffer needs space for '\0', data is ignored if init failed
+    if (line_buffer == NULL || line_buffer_size == 0){
+        log_error("vcard_parser_init: line buffer missing");
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    parser->line_buffer = line_buffer;
+    parser->line_buffer_size = line_buffer_size;
+    parser->callback = callback;
+    parser->context = context;
+    parser->state = VCARD_PARSER_STATE_W4_END_OF_LINE;
+    return ERROR_CODE_SUCCESS;
+}
+
+void vcard_parser_process_data(vcard_parser_t * parser, const uint8_t * data, uint16_t size){
+    if (parser->line_buffer_size == 0) return;
+    while (size){
+        if (parser->state == VCARD_PARSER_STATE_W4_CONTINUATION){
+            parser->state = VCARD_PARSER_STATE_W4_END_OF_LINE;
+            if (*data == ' ' || *data == '\t'){
+                // folded line, drop single whitespace
+                data++;
+                size--;
+                continue;
+            }
+            vcard_parser_handle_line(parser);
+        }
+        // copy everything up to end of line at once
+        const uint8_t * end_of_line = (const uint8_t *) memchr(data, '\n', size);
+        uint16_t len = end_of_line ? end_of_line - data : size;
+        vcard_parser_append(parser, data, len);
+        if (!end_of_line) return;
+        data += len + 1;
+        size -= len + 1;
+        vcard_parser_handle_end_of_line(parser);
+    }
+}
+
+void vcard_parser_finalize(vcard_parser_t * parser){
+    if (parser->line_buffer_size == 0) return;
+    // last line might not be terminated by line break
+    if (parser->line_len && parser->line_buffer[parser->line_len-1] == '\r'){
+        parser->line_len--;
+    }
+    if (parser->line_len){
+        vcard_parser_handle_line(parser);
+    }
+    parser->state = VCARD_PARSER_STATE_W4_END_OF_LINE;
+    vcard_parser_reset_line(parser);
+}
+
+uint32_t vcard_parser_get_num_contacts(vcard_parser_t * parser){
+    return parser->num_contacts;
+}
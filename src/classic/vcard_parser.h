@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#ifndef __VCARD_PARSER_H
+#define __VCARD_PARSER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------------------------------------------
+// vcard_parser.h
+//
+// Incremental vCard tokenizer for PBAP phonebook objects
+//
+// Body data can be passed in arbitrary chunks. Lines are unfolded in the provided line buffer and
+// reported as properties, so memory usage is bounded by the line buffer size and independent of
+// the number of contacts.
+//
+
+typedef enum {
+    VCARD_PARSER_EVENT_CONTACT_START = 0,
+    VCARD_PARSER_EVENT_PROPERTY,
+    VCARD_PARSER_EVENT_CONTACT_END,
+} vcard_parser_event_t;
+
+typedef struct {
+    const char * name;          // property name incl. optional group, e.g. "TEL"
+    const char * params;        // parameters without leading ';', "" if none
+    const char * value;         // raw value, QUOTED-PRINTABLE soft line breaks removed
+    uint16_t     value_len;
+    uint8_t      truncated;     // line did not fit into line buffer
+} vcard_parser_property_t;
+
+/**
+ * @brief Callback for parser events
+ * @param context provided in vcard_parser_init
+ * @param event
+ * @param property for VCARD_PARSER_EVENT_PROPERTY, NULL otherwise
+ */
+typedef void (*vcard_parser_callback_t)(void * context, vcard_parser_event_t event, const vcard_parser_property_t * property);
+
+typedef struct {
+    vcard_parser_callback_t callback;
+    void *    context;
+    char *    line_buffer;
+    uint16_t  line_buffer_size;
+    uint16_t  line_len;
+    uint8_t   state;
+    uint8_t   line_truncated;
+    uint8_t   in_contact;
+    uint32_t  num_contacts;
+} vcard_parser_t;
+
+/* API_START */
+
+/**
+ * @brief Init vCard parser
+ * @param parser
+ * @param line_buffer used to store a single unfolded line
+ * @param line_buffer_size, longer lines are truncated
+ * @param callback
+ * @param context passed to callback
+ * @return status ERROR_CODE_SUCCESS or ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS if line buffer is missing
+ */
+uint8_t vcard_parser_init(vcard_parser_t * parser, char * line_buffer, uint16_t line_buffer_size, vcard_parser_callback_t callback, void * context);
+
+/**
+ * @brief Process next chunk of vCard data, e.g. PBAP_DATA_PACKET
+ * @param parser
+ * @param data
+ * @param size
+ */
+void vcard_parser_process_data(vcard_parser_t * parser, const uint8_t * data, uint16_t size);
+
+/**
+ * @brief Process pending line at end of phonebook object
+ * @param parser
+ */
+void vcard_parser_finalize(vcard_parser_t * parser);
+
+/**
+ * @brief Get number of completed contacts
+ * @param parser
+ * @return number of contacts
+ */
+uint32_t vcard_parser_get_num_contacts(vcard_parser_t * parser);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+#endif // __VCARD_PARSER_H
@@ -302,6 +302,14 @@ int gap_update_connection_parameters(hci_con_handle_t con_handle, uint16_t conn_
  */
 void gap_get_connection_parameter_range(le_connection_parameter_range_t * range);
 
+/**
+ * @brief Get accepted connection parameter range of the controller of the given connection
+ * @note same as gap_get_connection_parameter_range without ENABLE_HCI_MULTIPLE_CONTROLLERS
+ * @param con_handle
+ * @param range
+ */
+void gap_get_connection_parameter_range_for_con_handle(hci_con_handle_t con_handle, le_connection_parameter_range_t * range);
+
 /**
  * @brief Get accepted connection parameter range
  * @param range
@@ -455,6 +463,15 @@ int gap_ssp_confirmation_negative(bd_addr_t addr);
  */
 void gap_le_get_own_address(uint8_t * addr_type, bd_addr_t addr);
 
+/**
+ * @brief Get own addr type and address used for LE by the controller of the given connection
+ * @note same as gap_le_get_own_address without ENABLE_HCI_MULTIPLE_CONTROLLERS
+ * @param con_handle
+ * @param addr_type
+ * @param addr
+ */
+void gap_le_get_own_address_for_con_handle(hci_con_handle_t con_handle, uint8_t * addr_type, bd_addr_t addr);
+
 
 /* API_END*/
 
@@ -75,9 +75,14 @@
 #include "gap.h"
 #include "hci.h"
 #include "hci_cmd.h"
+#include "hci_cmd_builder.h"
 #include "hci_dump.h"
 #include "ad_parser.h"
 
+#ifdef ENABLE_LE_SCAN_ENGINE
+#include "ble/le_scan_engine.h"
+#endif
+
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
 #ifndef HCI_HOST_ACL_PACKET_NUM
 #error "ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL requires to define HCI_HOST_ACL_PACKET_NUM"
@@ -128,7 +133,7 @@
 #ifdef ENABLE_CLASSIC
 static void hci_update_scan_enable(void);
 static void hci_emit_discoverable_enabled(uint8_t enabled);
-static int  hci_local_ssp_activated(void);
+static int  hci_local_ssp_activated(hci_stack_t * stack);
 static int  hci_remote_ssp_supported(hci_con_handle_t con_handle);
 static void hci_notify_if_sco_can_send_now(void);
 static void hci_emit_connection_complete(bd_addr_t address, hci_con_handle_t con_handle, uint8_t status);
@@ -151,7 +156,8 @@ static void hci_emit_event(uint8_t * event, uint16_t size, int dump);
 static void hci_emit_acl_packet(uint8_t * packet, uint16_t size);
 static void hci_run(void);
 static int  hci_is_le_connection(hci_connection_t * connection);
-static int  hci_number_free_acl_slots_for_connection_type( bd_addr_type_t address_type);
+static int  hci_number_free_acl_slots_for_connection_type(hci_stack_t * stack, bd_addr_type_t address_type);
+static hci_stack_t * hci_stack_for_con_handle(hci_con_handle_t con_handle);
 
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
@@ -165,8 +171,62 @@ static void hci_remove_from_whitelist(bd_addr_type_t address_type, bd_addr_t add
 #ifndef HAVE_MALLOC
 static hci_stack_t   hci_stack_static;
 #endif
+// selected controller
 static hci_stack_t * hci_stack = NULL;
 
+// connections, event handlers and outgoing packet buffer are stored in the stack of the first controller
+static hci_stack_t * hci_host = NULL;
+
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+
+// connection handles of a controller are mapped to connection handles that are unique in the host stack
+typedef struct {
+    hci_con_handle_t controller_con_handle;
+    hci_con_handle_t con_handle;    // HCI_CON_HANDLE_INVALID for free entry
+} hci_con_handle_mapping_t;
+
+typedef struct {
+    hci_stack_t * stack;
+    hci_con_handle_mapping_t con_handles[MAX_NR_HCI_CONTROLLER_CONNECTIONS];
+    // connection handle of last HCI Command with connection handle, returned in its Command Complete
+    hci_con_handle_t command_con_handle;
+} hci_controller_t;
+
+#ifndef HAVE_MALLOC
+static hci_stack_t      hci_controller_stacks_static[MAX_NR_HCI_CONTROLLERS - 1];
+#endif
+static hci_controller_t hci_controllers[MAX_NR_HCI_CONTROLLERS];
+static int              hci_num_controllers;
+static int              hci_controller_index;
+
+// controller to select after HCI Command reserved for a connection handle has been sent, -1 if none
+static int              hci_command_previous_controller = -1;
+
+static void hci_controller_select_index(int controller);
+static int  hci_controller_enter_for_con_handle(hci_con_handle_t con_handle);
+static void hci_controller_leave(int previous_controller);
+static void hci_controller_store_controller_con_handle(uint8_t * packet, int pos);
+static void hci_controller_init_con_handles(void);
+static int  hci_connection_on_selected_controller(hci_connection_t * connection);
+static hci_stack_t * hci_stack_for_connection(hci_connection_t * connection);
+#else
+static inline int hci_controller_enter_for_con_handle(hci_con_handle_t con_handle){
+    UNUSED(con_handle);
+    return 0;
+}
+static inline void hci_controller_leave(int previous_controller){
+    UNUSED(previous_controller);
+}
+static inline int hci_connection_on_selected_controller(hci_connection_t * connection){
+    UNUSED(connection);
+    return 1;
+}
+static inline hci_stack_t * hci_stack_for_connection(hci_connection_t * connection){
+    UNUSED(connection);
+    return hci_stack;
+}
+#endif
+
 #ifdef ENABLE_CLASSIC
 // test helper
 static uint8_t disable_l2cap_timeouts = 0;
@@ -198,7 +258,10 @@ static hci_connection_t * create_connection_for_bd_addr_and_type(bd_addr_t addr,
     conn->num_acl_packets_sent = 0;
     conn->num_sco_packets_sent = 0;
     conn->le_con_parameter_update_state = CON_PARAMETER_UPDATE_NONE;
-    btstack_linked_list_add(&hci_stack->connections, (btstack_linked_item_t *) conn);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    conn->controller = hci_controller_index;
+#endif
+    btstack_linked_list_add(&hci_host->connections, (btstack_linked_item_t *) conn);
     return conn;
 }
 
@@ -212,6 +275,10 @@ void gap_get_connection_parameter_range(le_connection_parameter_range_t * range)
     *range = hci_stack->le_connection_parameter_range;
 }
 
+void gap_get_connection_parameter_range_for_con_handle(hci_con_handle_t con_handle, le_connection_parameter_range_t * range){
+    *range = hci_stack_for_con_handle(con_handle)->le_connection_parameter_range;
+}
+
 /**
  * set le connection parameter range
  *
@@ -228,7 +295,7 @@ void gap_set_connection_parameter_range(le_connection_parameter_range_t *range){
  */
 
 void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
-    btstack_linked_list_iterator_init(it, &hci_stack->connections);
+    btstack_linked_list_iterator_init(it, &hci_host->connections);
 }
 
 /**
@@ -238,7 +305,7 @@ void hci_connections_get_iterator(btstack_linked_list_iterator_t *it){
  */
 hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
     btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->connections);
+    btstack_linked_list_iterator_init(&it, &hci_host->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * item = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
         if ( item->con_handle == con_handle ) {
@@ -248,21 +315,46 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle){
     return NULL;
 }
 
+// get connection for given address on selected controller, used for events and commands of selected controller
+static hci_connection_t * hci_connection_on_selected_controller_for_bd_addr_and_type(bd_addr_t addr, bd_addr_type_t addr_type){
+    btstack_linked_list_iterator_t it;
+    btstack_linked_list_iterator_init(&it, &hci_host->connections);
+    while (btstack_linked_list_iterator_has_next(&it)){
+        hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (!hci_connection_on_selected_controller(connection)) continue;
+        if (connection->address_type != addr_type)  continue;
+        if (memcmp(addr, connection->address, 6) != 0) continue;
+        return connection;   
+    } 
+    return NULL;
+}
+
 /**
- * get connection for given address
+ * get connection for given address, connection on selected controller is preferred
  *
  * @return connection OR NULL, if not found
  */
 hci_connection_t * hci_connection_for_bd_addr_and_type(bd_addr_t  addr, bd_addr_type_t addr_type){
+    hci_connection_t * connection = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, addr_type);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    if (connection) return connection;
     btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->connections);
+    btstack_linked_list_iterator_init(&it, &hci_host->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
-        hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
         if (connection->address_type != addr_type)  continue;
         if (memcmp(addr, connection->address, 6) != 0) continue;
-        return connection;   
-    } 
-    return NULL;
+        return connection;
+    }
+#endif
+    return connection;
+}
+
+// stack of the controller of the connection, selected controller if not found
+static hci_stack_t * hci_stack_for_con_handle(hci_con_handle_t con_handle){
+    hci_connection_t * connection = hci_connection_for_handle(con_handle);
+    if (!connection) return hci_stack;
+    return hci_stack_for_connection(connection);
 }
 
 
@@ -272,9 +364,10 @@ hci_connection_t * hci_connection_for_bd_addr_and_type(bd_addr_t  addr, bd_addr_
 static int hci_number_sco_connections(void){
     int connections = 0;
     btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->connections);
+    btstack_linked_list_iterator_init(&it, &hci_host->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * connection = (hci_connection_t *) btstack_linked_list_iterator_next(&it);
+        if (!hci_connection_on_selected_controller(connection)) continue;
         if (connection->address_type != BD_ADDR_TYPE_SCO) continue;
         connections++;
     } 
@@ -322,7 +415,7 @@ inline static void connectionClearAuthenticationFlags(hci_connection_t * conn, h
 static void hci_add_connection_flags_for_flipped_bd_addr(uint8_t *bd_addr, hci_authentication_flags_t flags){
     bd_addr_t addr;
     reverse_bd_addr(bd_addr, addr);
-    hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+    hci_connection_t * conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
     if (conn) {
         connectionSetAuthenticationFlags(conn, flags);
         hci_connection_timestamp(conn);
@@ -338,15 +431,15 @@ int  hci_authentication_active_for_handle(hci_con_handle_t handle){
 }
 
 void gap_drop_link_key_for_bd_addr(bd_addr_t addr){
-    if (!hci_stack->link_key_db) return;
+    if (!hci_host->link_key_db) return;
     log_info("gap_drop_link_key_for_bd_addr: %s", bd_addr_to_str(addr));
-    hci_stack->link_key_db->delete_link_key(addr);
+    hci_host->link_key_db->delete_link_key(addr);
 }
 
 void gap_store_link_key_for_bd_addr(bd_addr_t addr, link_key_t link_key, link_key_type_t type){
-    if (!hci_stack->link_key_db) return;
+    if (!hci_host->link_key_db) return;
     log_info("gap_store_link_key_for_bd_addr: %s, type %u", bd_addr_to_str(addr), type);
-    hci_stack->link_key_db->put_link_key(addr, link_key, type);
+    hci_host->link_key_db->put_link_key(addr, link_key, type);
 }
 #endif
 
@@ -361,45 +454,46 @@ static int hci_is_le_connection(hci_connection_t * connection){
 static int nr_hci_connections(void){
     int count = 0;
     btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next, count++);
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next, count++);
     return count;
 }
 
-static int hci_number_free_acl_slots_for_connection_type(bd_addr_type_t address_type){
+static int hci_number_free_acl_slots_for_connection_type(hci_stack_t * stack, bd_addr_type_t address_type){
     
     unsigned int num_packets_sent_classic = 0;
     unsigned int num_packets_sent_le = 0;
 
     btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
+        if (hci_stack_for_connection(connection) != stack) continue;
         if (connection->address_type == BD_ADDR_TYPE_CLASSIC){
             num_packets_sent_classic += connection->num_acl_packets_sent;
         } else {
             num_packets_sent_le += connection->num_acl_packets_sent;
         }
     }
-    log_debug("ACL classic buffers: %u used of %u", num_packets_sent_classic, hci_stack->acl_packets_total_num);
-    int free_slots_classic = hci_stack->acl_packets_total_num - num_packets_sent_classic;
+    log_debug("ACL classic buffers: %u used of %u", num_packets_sent_classic, stack->acl_packets_total_num);
+    int free_slots_classic = stack->acl_packets_total_num - num_packets_sent_classic;
     int free_slots_le = 0;
 
     if (free_slots_classic < 0){
-        log_error("hci_number_free_acl_slots: outgoing classic packets (%u) > total classic packets (%u)", num_packets_sent_classic, hci_stack->acl_packets_total_num);
+        log_error("hci_number_free_acl_slots: outgoing classic packets (%u) > total classic packets (%u)", num_packets_sent_classic, stack->acl_packets_total_num);
         return 0;
     }
 
-    if (hci_stack->le_acl_packets_total_num){
+    if (stack->le_acl_packets_total_num){
         // if we have LE slots, they are used
-        free_slots_le = hci_stack->le_acl_packets_total_num - num_packets_sent_le;
+        free_slots_le = stack->le_acl_packets_total_num - num_packets_sent_le;
         if (free_slots_le < 0){
-            log_error("hci_number_free_acl_slots: outgoing le packets (%u) > total le packets (%u)", num_packets_sent_le, hci_stack->le_acl_packets_total_num);
+            log_error("hci_number_free_acl_slots: outgoing le packets (%u) > total le packets (%u)", num_packets_sent_le, stack->le_acl_packets_total_num);
             return 0;
         }
     } else {
         // otherwise, classic slots are used for LE, too
         free_slots_classic -= num_packets_sent_le;
         if (free_slots_classic < 0){
-            log_error("hci_number_free_acl_slots: outgoing classic + le packets (%u + %u) > total packets (%u)", num_packets_sent_classic, num_packets_sent_le, hci_stack->acl_packets_total_num);
+            log_error("hci_number_free_acl_slots: outgoing classic + le packets (%u + %u) > total packets (%u)", num_packets_sent_classic, num_packets_sent_le, stack->acl_packets_total_num);
             return 0;
         }
     }
@@ -413,7 +507,7 @@ static int hci_number_free_acl_slots_for_connection_type(bd_addr_type_t address_
             return free_slots_classic;
 
         default:
-           if (hci_stack->le_acl_packets_total_num){
+           if (stack->le_acl_packets_total_num){
                return free_slots_le;
            }
            return free_slots_classic; 
@@ -427,15 +521,16 @@ int hci_number_free_acl_slots_for_handle(hci_con_handle_t con_handle){
         log_error("hci_number_free_acl_slots: handle 0x%04x not in connection list", con_handle);
         return 0;
     }
-    return hci_number_free_acl_slots_for_connection_type(connection->address_type);
+    return hci_number_free_acl_slots_for_connection_type(hci_stack_for_connection(connection), connection->address_type);
 }
 
 #ifdef ENABLE_CLASSIC
 static int hci_number_free_sco_slots(void){
     unsigned int num_sco_packets_sent  = 0;
     btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
+        if (!hci_connection_on_selected_controller(connection)) continue;
         num_sco_packets_sent += connection->num_sco_packets_sent;
     }
     if (num_sco_packets_sent > hci_stack->sco_packets_total_num){
@@ -449,7 +544,7 @@ static int hci_number_free_sco_slots(void){
 
 // only used to send HCI Host Number Completed Packets
 static int hci_can_send_comand_packet_transport(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_host->hci_packet_buffer_reserved) return 0;
 
     // check for async hci transport implementations
     if (hci_stack->hci_transport->can_send_packet_now){
@@ -466,46 +561,46 @@ int hci_can_send_command_packet_now(void){
     return hci_stack->num_cmd_packets > 0;
 }
 
-static int hci_transport_can_send_prepared_packet_now(uint8_t packet_type){
+static int hci_transport_can_send_prepared_packet_now(hci_stack_t * stack, uint8_t packet_type){
     // check for async hci transport implementations
-    if (!hci_stack->hci_transport->can_send_packet_now) return 1;
-    return hci_stack->hci_transport->can_send_packet_now(packet_type);
+    if (!stack->hci_transport->can_send_packet_now) return 1;
+    return stack->hci_transport->can_send_packet_now(packet_type);
 }
 
 static int hci_can_send_prepared_acl_packet_for_address_type(bd_addr_type_t address_type){
-    if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
-    return hci_number_free_acl_slots_for_connection_type(address_type) > 0;
+    if (!hci_transport_can_send_prepared_packet_now(hci_stack, HCI_ACL_DATA_PACKET)) return 0;
+    return hci_number_free_acl_slots_for_connection_type(hci_stack, address_type) > 0;
 }
 
 int hci_can_send_acl_le_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_host->hci_packet_buffer_reserved) return 0;
     return hci_can_send_prepared_acl_packet_for_address_type(BD_ADDR_TYPE_LE_PUBLIC);
 }
 
 int hci_can_send_prepared_acl_packet_now(hci_con_handle_t con_handle) {
-    if (!hci_transport_can_send_prepared_packet_now(HCI_ACL_DATA_PACKET)) return 0;
+    if (!hci_transport_can_send_prepared_packet_now(hci_stack_for_con_handle(con_handle), HCI_ACL_DATA_PACKET)) return 0;
     return hci_number_free_acl_slots_for_handle(con_handle) > 0;
 }
 
 int hci_can_send_acl_packet_now(hci_con_handle_t con_handle){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_host->hci_packet_buffer_reserved) return 0;
     return hci_can_send_prepared_acl_packet_now(con_handle);
 }
 
 #ifdef ENABLE_CLASSIC
 int hci_can_send_acl_classic_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_host->hci_packet_buffer_reserved) return 0;
     return hci_can_send_prepared_acl_packet_for_address_type(BD_ADDR_TYPE_CLASSIC);
 }
 
 int hci_can_send_prepared_sco_packet_now(void){
-    if (!hci_transport_can_send_prepared_packet_now(HCI_SCO_DATA_PACKET)) return 0;
+    if (!hci_transport_can_send_prepared_packet_now(hci_stack, HCI_SCO_DATA_PACKET)) return 0;
     if (!hci_stack->synchronous_flow_control_enabled) return 1;
     return hci_number_free_sco_slots() > 0;    
 }
 
 int hci_can_send_sco_packet_now(void){
-    if (hci_stack->hci_packet_buffer_reserved) return 0;
+    if (hci_host->hci_packet_buffer_reserved) return 0;
     return hci_can_send_prepared_sco_packet_now();
 }
 
@@ -517,21 +612,21 @@ void hci_request_sco_can_send_now_event(void){
 
 // used for internal checks in l2cap.c
 int hci_is_packet_buffer_reserved(void){
-    return hci_stack->hci_packet_buffer_reserved;
+    return hci_host->hci_packet_buffer_reserved;
 }
 
 // reserves outgoing packet buffer. @returns 1 if successful
 int hci_reserve_packet_buffer(void){
-    if (hci_stack->hci_packet_buffer_reserved) {
+    if (hci_host->hci_packet_buffer_reserved) {
         log_error("hci_reserve_packet_buffer called but buffer already reserved");
         return 0;
     }
-    hci_stack->hci_packet_buffer_reserved = 1;
+    hci_host->hci_packet_buffer_reserved = 1;
     return 1;    
 }
 
 void hci_release_packet_buffer(void){
-    hci_stack->hci_packet_buffer_reserved = 0;
+    hci_host->hci_packet_buffer_reserved = 0;
 }
 
 // assumption: synchronous implementations don't provide can_send_packet_now as they don't keep the buffer after the call
@@ -541,7 +636,7 @@ static int hci_transport_synchronous(void){
 
 static int hci_send_acl_packet_fragments(hci_connection_t *connection){
 
-    // log_info("hci_send_acl_packet_fragments  %u/%u (con 0x%04x)", hci_stack->acl_fragmentation_pos, hci_stack->acl_fragmentation_total_size, connection->con_handle);
+    // log_info("hci_send_acl_packet_fragments  %u/%u (con 0x%04x)", hci_host->acl_fragmentation_pos, hci_host->acl_fragmentation_total_size, connection->con_handle);
 
     // max ACL data packet length depends on connection type (LE vs. Classic) and available buffers
     uint16_t max_acl_data_packet_length = hci_stack->acl_data_packet_length;
@@ -561,8 +656,8 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         log_debug("hci_send_acl_packet_fragments loop entered");
 
         // get current data
-        const uint16_t acl_header_pos = hci_stack->acl_fragmentation_pos - 4;
-        int current_acl_data_packet_length = hci_stack->acl_fragmentation_total_size - hci_stack->acl_fragmentation_pos;
+        const uint16_t acl_header_pos = hci_host->acl_fragmentation_pos - 4;
+        int current_acl_data_packet_length = hci_host->acl_fragmentation_total_size - hci_host->acl_fragmentation_pos;
         int more_fragments = 0;
 
         // if ACL packet is larger than Bluetooth packet buffer, only send max_acl_data_packet_length
@@ -571,15 +666,15 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
             current_acl_data_packet_length = max_acl_data_packet_length;
         }
 
-        // copy handle_and_flags if not first fragment and update packet boundary flags to be 01 (continuing fragmnent)
+        // copy flags if not first fragment and update packet boundary flags to be 01 (continuing fragmnent)
         if (acl_header_pos > 0){
-            uint16_t handle_and_flags = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
-            handle_and_flags = (handle_and_flags & 0xcfff) | (1 << 12);
-            little_endian_store_16(hci_stack->hci_packet_buffer, acl_header_pos, handle_and_flags);
+            uint16_t handle_and_flags = little_endian_read_16(hci_host->hci_packet_buffer, 0);
+            handle_and_flags = (handle_and_flags & 0xc000) | (1 << 12) | hci_host->acl_fragmentation_con_handle;
+            little_endian_store_16(hci_host->hci_packet_buffer, acl_header_pos, handle_and_flags);
         }
 
         // update header len
-        little_endian_store_16(hci_stack->hci_packet_buffer, acl_header_pos + 2, current_acl_data_packet_length);
+        little_endian_store_16(hci_host->hci_packet_buffer, acl_header_pos + 2, current_acl_data_packet_length);
 
         // count packet
         connection->num_acl_packets_sent++;
@@ -588,17 +683,20 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
         // update state for next fragment (if any) as "transport done" might be sent during send_packet already
         if (more_fragments){
             // update start of next fragment to send
-            hci_stack->acl_fragmentation_pos += current_acl_data_packet_length;
+            hci_host->acl_fragmentation_pos += current_acl_data_packet_length;
         } else {
             // done
-            hci_stack->acl_fragmentation_pos = 0;
-            hci_stack->acl_fragmentation_total_size = 0;
+            hci_host->acl_fragmentation_pos = 0;
+            hci_host->acl_fragmentation_total_size = 0;
         }
 
         // send packet
-        uint8_t * packet = &hci_stack->hci_packet_buffer[acl_header_pos];
+        uint8_t * packet = &hci_host->hci_packet_buffer[acl_header_pos];
         const int size = current_acl_data_packet_length + 4;
         hci_dump_packet(HCI_ACL_DATA_PACKET, 0, packet, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+        hci_controller_store_controller_con_handle(packet, 0);
+#endif
         err = hci_stack->hci_transport->send_packet(HCI_ACL_DATA_PACKET, packet, size);
 
         log_debug("hci_send_acl_packet_fragments loop after send (more fragments %d)", more_fragments);
@@ -623,18 +721,7 @@ static int hci_send_acl_packet_fragments(hci_connection_t *connection){
     return err;
 }
 
-// pre: caller has reserved the packet buffer
-int hci_send_acl_packet_buffer(int size){
-
-    // log_info("hci_send_acl_packet_buffer size %u", size);
-
-    if (!hci_stack->hci_packet_buffer_reserved) {
-        log_error("hci_send_acl_packet_buffer called without reserving packet buffer");
-        return 0;
-    }
-
-    uint8_t * packet = hci_stack->hci_packet_buffer;
-    hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(packet);
+static int hci_send_acl_packet_buffer_for_con_handle(hci_con_handle_t con_handle, int size){
 
     // check for free places on Bluetooth module
     if (!hci_can_send_prepared_acl_packet_now(con_handle)) {
@@ -657,24 +744,35 @@ int hci_send_acl_packet_buffer(int size){
     // hci_dump_packet( HCI_ACL_DATA_PACKET, 0, packet, size);
 
     // setup data
-    hci_stack->acl_fragmentation_total_size = size;
-    hci_stack->acl_fragmentation_pos = 4;   // start of L2CAP packet
+    hci_host->acl_fragmentation_total_size = size;
+    hci_host->acl_fragmentation_pos = 4;   // start of L2CAP packet
+    hci_host->acl_fragmentation_con_handle = con_handle;
 
     return hci_send_acl_packet_fragments(connection);
 }
 
-#ifdef ENABLE_CLASSIC
 // pre: caller has reserved the packet buffer
-int hci_send_sco_packet_buffer(int size){
+int hci_send_acl_packet_buffer(int size){
 
     // log_info("hci_send_acl_packet_buffer size %u", size);
 
-    if (!hci_stack->hci_packet_buffer_reserved) {
+    if (!hci_host->hci_packet_buffer_reserved) {
         log_error("hci_send_acl_packet_buffer called without reserving packet buffer");
         return 0;
     }
 
-    uint8_t * packet = hci_stack->hci_packet_buffer;
+    hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(hci_host->hci_packet_buffer);
+
+    int previous_controller = hci_controller_enter_for_con_handle(con_handle);
+    int err = hci_send_acl_packet_buffer_for_con_handle(con_handle, size);
+    hci_controller_leave(previous_controller);
+    return err;
+}
+
+#ifdef ENABLE_CLASSIC
+static int hci_send_sco_packet_buffer_on_controller(int size){
+
+    uint8_t * packet = hci_host->hci_packet_buffer;
 
     // skip checks in loopback mode
     if (!hci_stack->loopback_mode){
@@ -698,6 +796,11 @@ int hci_send_sco_packet_buffer(int size){
     }
 
     hci_dump_packet( HCI_SCO_DATA_PACKET, 0, packet, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    if (!hci_stack->loopback_mode){
+        hci_controller_store_controller_con_handle(packet, 0);
+    }
+#endif
     int err = hci_stack->hci_transport->send_packet(HCI_SCO_DATA_PACKET, packet, size);
 
     if (hci_transport_synchronous()){
@@ -709,6 +812,24 @@ int hci_send_sco_packet_buffer(int size){
 
     return err;
 }
+
+// pre: caller has reserved the packet buffer
+int hci_send_sco_packet_buffer(int size){
+
+    // log_info("hci_send_acl_packet_buffer size %u", size);
+
+    if (!hci_host->hci_packet_buffer_reserved) {
+        log_error("hci_send_acl_packet_buffer called without reserving packet buffer");
+        return 0;
+    }
+
+    hci_con_handle_t con_handle = READ_SCO_CONNECTION_HANDLE(hci_host->hci_packet_buffer);
+
+    int previous_controller = hci_controller_enter_for_con_handle(con_handle);
+    int err = hci_send_sco_packet_buffer_on_controller(size);
+    hci_controller_leave(previous_controller);
+    return err;
+}
 #endif
 
 static void acl_handler(uint8_t *packet, int size){
@@ -830,7 +951,7 @@ static void hci_shutdown_connection(hci_connection_t *conn){
 
     btstack_run_loop_remove_timer(&conn->timeout);
     
-    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+    btstack_linked_list_remove(&hci_host->connections, (btstack_linked_item_t *) conn);
     btstack_memory_hci_connection_free( conn );
     
     // now it's gone
@@ -901,13 +1022,17 @@ uint16_t hci_usable_acl_packet_types(void){
 
 uint8_t* hci_get_outgoing_packet_buffer(void){
     // hci packet buffer is >= acl data packet length
-    return hci_stack->hci_packet_buffer;
+    return hci_host->hci_packet_buffer;
 }
 
 uint16_t hci_max_acl_data_packet_length(void){
     return hci_stack->acl_data_packet_length;
 }
 
+uint16_t hci_max_acl_data_packet_length_for_con_handle(hci_con_handle_t con_handle){
+    return hci_stack_for_con_handle(con_handle)->acl_data_packet_length;
+}
+
 #ifdef ENABLE_CLASSIC
 int hci_extended_sco_link_supported(void){
     // No. 31, byte 3, bit 7
@@ -915,14 +1040,22 @@ int hci_extended_sco_link_supported(void){
 }
 #endif
 
-int hci_non_flushable_packet_boundary_flag_supported(void){
+static int hci_non_flushable_packet_boundary_flag_supported_for_stack(hci_stack_t * stack){
     // No. 54, byte 6, bit 6
-    return (hci_stack->local_supported_features[6] & (1 << 6)) != 0;
+    return (stack->local_supported_features[6] & (1 << 6)) != 0;
+}
+
+int hci_non_flushable_packet_boundary_flag_supported(void){
+    return hci_non_flushable_packet_boundary_flag_supported_for_stack(hci_stack);
 }
 
-static int gap_ssp_supported(void){
+int hci_non_flushable_packet_boundary_flag_supported_for_con_handle(hci_con_handle_t con_handle){
+    return hci_non_flushable_packet_boundary_flag_supported_for_stack(hci_stack_for_con_handle(con_handle));
+}
+
+static int gap_ssp_supported(hci_stack_t * stack){
     // No. 51, byte 6, bit 3
-    return (hci_stack->local_supported_features[6] & (1 << 3)) != 0;
+    return (stack->local_supported_features[6] & (1 << 3)) != 0;
 }
 
 static int hci_classic_supported(void){
@@ -948,15 +1081,23 @@ static int hci_le_supported(void){
 /**
  * @brief Get addr type and address used for LE in Advertisements, Scan Responses, 
  */
-void gap_le_get_own_address(uint8_t * addr_type, bd_addr_t addr){
-    *addr_type = hci_stack->le_own_addr_type;
-    if (hci_stack->le_own_addr_type){
-        memcpy(addr, hci_stack->le_random_address, 6);
+static void gap_le_get_own_address_for_stack(hci_stack_t * stack, uint8_t * addr_type, bd_addr_t addr){
+    *addr_type = stack->le_own_addr_type;
+    if (stack->le_own_addr_type){
+        memcpy(addr, stack->le_random_address, 6);
     } else {
-        memcpy(addr, hci_stack->local_bd_addr, 6);
+        memcpy(addr, stack->local_bd_addr, 6);
     }
 }
 
+void gap_le_get_own_address(uint8_t * addr_type, bd_addr_t addr){
+    gap_le_get_own_address_for_stack(hci_stack, addr_type, addr);
+}
+
+void gap_le_get_own_address_for_con_handle(hci_con_handle_t con_handle, uint8_t * addr_type, bd_addr_t addr){
+    gap_le_get_own_address_for_stack(hci_stack_for_con_handle(con_handle), addr_type, addr);
+}
+
 #ifdef ENABLE_LE_CENTRAL
 void le_handle_advertisement_report(uint8_t *packet, int size){
 
@@ -971,6 +1112,15 @@ void le_handle_advertisement_report(uint8_t *packet, int size){
     uint8_t event[12 + LE_ADVERTISING_DATA_SIZE]; // use upper bound to avoid var size automatic var
     for (i=0; i<num_reports;i++){
         uint8_t data_length = packet[offset + 8];
+#ifdef ENABLE_LE_SCAN_ENGINE
+        if (le_scan_engine_enabled()){
+            // event type, address type, address, data length, data, rssi
+            le_scan_engine_handle_advertising_report(packet[offset], packet[offset+1], &packet[offset+2],
+                (int8_t) packet[offset + 9 + data_length], data_length, &packet[offset + 9]);
+            offset += 10 + data_length;
+            continue;
+        }
+#endif
         uint8_t event_size = 10 + data_length;
         int pos = 0;
         event[pos++] = GAP_EVENT_ADVERTISING_REPORT;
@@ -1001,9 +1151,7 @@ static uint32_t hci_transport_uart_get_main_baud_rate(void){
     return baud_rate;
 }
 
-static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
-    UNUSED(ds);
-
+static void hci_initialization_timeout(void){
     switch (hci_stack->substate){
         case HCI_INIT_W4_SEND_RESET:
             log_info("Resend HCI Reset");
@@ -1042,12 +1190,30 @@ static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
         case HCI_INIT_W4_CUSTOM_INIT_BCM_DELAY:
             // otherwise continue
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_COMMANDS;
-            hci_send_cmd(&hci_read_local_supported_commands);
+            hci_send_read_local_supported_commands();
             break;
         default:
             break;
     }
 }
+
+static void hci_initialization_timeout_handler(btstack_timer_source_t * ds){
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // run on controller that started the timer
+    int selected_controller = hci_controller_index;
+    int controller;
+    for (controller = 0; controller < hci_num_controllers; controller++){
+        if (ds != &hci_controllers[controller].stack->timeout) continue;
+        hci_controller_select_index(controller);
+        hci_initialization_timeout();
+        break;
+    }
+    hci_controller_select_index(selected_controller);
+#else
+    UNUSED(ds);
+    hci_initialization_timeout();
+#endif
+}
 #endif
 
 static void hci_initializing_next_state(void){
@@ -1069,14 +1235,14 @@ static void hci_initializing_run(void){
 #endif
             // send command
             hci_stack->substate = HCI_INIT_W4_SEND_RESET;
-            hci_send_cmd(&hci_reset);
+            hci_send_reset();
             break;
         case HCI_INIT_SEND_READ_LOCAL_VERSION_INFORMATION:
-            hci_send_cmd(&hci_read_local_version_information);
+            hci_send_read_local_version_information();
             hci_stack->substate = HCI_INIT_W4_SEND_READ_LOCAL_VERSION_INFORMATION;
             break;
         case HCI_INIT_SEND_READ_LOCAL_NAME:
-            hci_send_cmd(&hci_read_local_name);
+            hci_send_read_local_name();
             hci_stack->substate = HCI_INIT_W4_SEND_READ_LOCAL_NAME;
             break;
 
@@ -1089,19 +1255,19 @@ static void hci_initializing_run(void){
             btstack_run_loop_add_timer(&hci_stack->timeout);
             // send command
             hci_stack->substate = HCI_INIT_W4_CUSTOM_INIT_CSR_WARM_BOOT;
-            hci_send_cmd(&hci_reset);
+            hci_send_reset();
             break;
         case HCI_INIT_SEND_RESET_ST_WARM_BOOT:
             hci_state_reset();
             hci_stack->substate = HCI_INIT_W4_SEND_RESET_ST_WARM_BOOT;
-            hci_send_cmd(&hci_reset);
+            hci_send_reset();
             break;
         case HCI_INIT_SEND_BAUD_CHANGE: {
             uint32_t baud_rate = hci_transport_uart_get_main_baud_rate();
-            hci_stack->chipset->set_baudrate_command(baud_rate, hci_stack->hci_packet_buffer);
-            hci_stack->last_cmd_opcode = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
+            hci_stack->chipset->set_baudrate_command(baud_rate, hci_host->hci_packet_buffer);
+            hci_stack->last_cmd_opcode = little_endian_read_16(hci_host->hci_packet_buffer, 0);
             hci_stack->substate = HCI_INIT_W4_SEND_BAUD_CHANGE;
-            hci_send_cmd_packet(hci_stack->hci_packet_buffer, 3 + hci_stack->hci_packet_buffer[2]);
+            hci_send_cmd_packet(hci_host->hci_packet_buffer, 3 + hci_host->hci_packet_buffer[2]);
             // STLC25000D: baudrate change happens within 0.5 s after command was send,
             // use timer to update baud rate after 100 ms (knowing exactly, when command was sent is non-trivial)
             if (hci_stack->manufacturer == BLUETOOTH_COMPANY_ID_ST_MICROELECTRONICS){
@@ -1112,20 +1278,20 @@ static void hci_initializing_run(void){
         }
         case HCI_INIT_SEND_BAUD_CHANGE_BCM: {
             uint32_t baud_rate = hci_transport_uart_get_main_baud_rate();
-            hci_stack->chipset->set_baudrate_command(baud_rate, hci_stack->hci_packet_buffer);
-            hci_stack->last_cmd_opcode = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
+            hci_stack->chipset->set_baudrate_command(baud_rate, hci_host->hci_packet_buffer);
+            hci_stack->last_cmd_opcode = little_endian_read_16(hci_host->hci_packet_buffer, 0);
             hci_stack->substate = HCI_INIT_W4_SEND_BAUD_CHANGE_BCM;
-            hci_send_cmd_packet(hci_stack->hci_packet_buffer, 3 + hci_stack->hci_packet_buffer[2]);
+            hci_send_cmd_packet(hci_host->hci_packet_buffer, 3 + hci_host->hci_packet_buffer[2]);
             break;
         }
         case HCI_INIT_CUSTOM_INIT:
             // Custom initialization
             if (hci_stack->chipset && hci_stack->chipset->next_command){
-                int valid_cmd = (*hci_stack->chipset->next_command)(hci_stack->hci_packet_buffer);
+                int valid_cmd = (*hci_stack->chipset->next_command)(hci_host->hci_packet_buffer);
                 if (valid_cmd){
-                    int size = 3 + hci_stack->hci_packet_buffer[2];
-                    hci_stack->last_cmd_opcode = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
-                    hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, hci_stack->hci_packet_buffer, size);
+                    int size = 3 + hci_host->hci_packet_buffer[2];
+                    hci_stack->last_cmd_opcode = little_endian_read_16(hci_host->hci_packet_buffer, 0);
+                    hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, hci_host->hci_packet_buffer, size);
                     switch (valid_cmd) {
                         case 1:
                         default:
@@ -1148,7 +1314,7 @@ static void hci_initializing_run(void){
                             }
                             break;
                     }
-                    hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, hci_stack->hci_packet_buffer, size);
+                    hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, hci_host->hci_packet_buffer, size);
                     break;
                 }
                 log_info("Init script done");
@@ -1179,43 +1345,43 @@ static void hci_initializing_run(void){
                         }
             // otherwise continue
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_COMMANDS;
-            hci_send_cmd(&hci_read_local_supported_commands);
+            hci_send_read_local_supported_commands();
             break;            
         case HCI_INIT_SET_BD_ADDR:
             log_info("Set Public BD ADDR to %s", bd_addr_to_str(hci_stack->custom_bd_addr));
-            hci_stack->chipset->set_bd_addr_command(hci_stack->custom_bd_addr, hci_stack->hci_packet_buffer);
-            hci_stack->last_cmd_opcode = little_endian_read_16(hci_stack->hci_packet_buffer, 0);
+            hci_stack->chipset->set_bd_addr_command(hci_stack->custom_bd_addr, hci_host->hci_packet_buffer);
+            hci_stack->last_cmd_opcode = little_endian_read_16(hci_host->hci_packet_buffer, 0);
             hci_stack->substate = HCI_INIT_W4_SET_BD_ADDR;
-            hci_send_cmd_packet(hci_stack->hci_packet_buffer, 3 + hci_stack->hci_packet_buffer[2]);
+            hci_send_cmd_packet(hci_host->hci_packet_buffer, 3 + hci_host->hci_packet_buffer[2]);
             break;
 #endif
 
         case HCI_INIT_READ_LOCAL_SUPPORTED_COMMANDS:
             log_info("Resend hci_read_local_supported_commands after CSR Warm Boot double reset");
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_COMMANDS;
-            hci_send_cmd(&hci_read_local_supported_commands);
+            hci_send_read_local_supported_commands();
             break;       
         case HCI_INIT_READ_BD_ADDR:
             hci_stack->substate = HCI_INIT_W4_READ_BD_ADDR;
-            hci_send_cmd(&hci_read_bd_addr);
+            hci_send_read_bd_addr();
             break;
         case HCI_INIT_READ_BUFFER_SIZE:
             hci_stack->substate = HCI_INIT_W4_READ_BUFFER_SIZE;
-            hci_send_cmd(&hci_read_buffer_size);
+            hci_send_read_buffer_size();
             break;
         case HCI_INIT_READ_LOCAL_SUPPORTED_FEATURES:
             hci_stack->substate = HCI_INIT_W4_READ_LOCAL_SUPPORTED_FEATURES;
-            hci_send_cmd(&hci_read_local_supported_features);
+            hci_send_read_local_supported_features();
             break;                
 
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
         case HCI_INIT_SET_CONTROLLER_TO_HOST_FLOW_CONTROL:
             hci_stack->substate = HCI_INIT_W4_SET_CONTROLLER_TO_HOST_FLOW_CONTROL;
-            hci_send_cmd(&hci_set_controller_to_host_flow_control, 3);  // ACL + SCO Flow Control
+            hci_send_set_controller_to_host_flow_control(3);  // ACL + SCO Flow Control
             break;
         case HCI_INIT_HOST_BUFFER_SIZE:
             hci_stack->substate = HCI_INIT_W4_HOST_BUFFER_SIZE;
-            hci_send_cmd(&hci_host_buffer_size, HCI_HOST_ACL_PACKET_LEN, HCI_HOST_SCO_PACKET_LEN, 
+            hci_send_host_buffer_size(HCI_HOST_ACL_PACKET_LEN, HCI_HOST_SCO_PACKET_LEN, 
                                                 HCI_HOST_ACL_PACKET_NUM, HCI_HOST_SCO_PACKET_NUM);
             break;            
 #endif
@@ -1223,30 +1389,30 @@ static void hci_initializing_run(void){
         case HCI_INIT_SET_EVENT_MASK:
             hci_stack->substate = HCI_INIT_W4_SET_EVENT_MASK;
             if (hci_le_supported()){
-                hci_send_cmd(&hci_set_event_mask,0xffffffff, 0x3FFFFFFF);
+                hci_send_set_event_mask(0xffffffff, 0x3FFFFFFF);
             } else {
                 // Kensington Bluetooth 2.1 USB Dongle (CSR Chipset) returns an error for 0xffff... 
-                hci_send_cmd(&hci_set_event_mask,0xffffffff, 0x1FFFFFFF);
+                hci_send_set_event_mask(0xffffffff, 0x1FFFFFFF);
             }
             break;
 
 #ifdef ENABLE_CLASSIC
         case HCI_INIT_WRITE_SIMPLE_PAIRING_MODE:
             hci_stack->substate = HCI_INIT_W4_WRITE_SIMPLE_PAIRING_MODE;
-            hci_send_cmd(&hci_write_simple_pairing_mode, hci_stack->ssp_enable);
+            hci_send_write_simple_pairing_mode(hci_stack->ssp_enable);
             break;
         case HCI_INIT_WRITE_PAGE_TIMEOUT:
             hci_stack->substate = HCI_INIT_W4_WRITE_PAGE_TIMEOUT;
-            hci_send_cmd(&hci_write_page_timeout, 0x6000);  // ca. 15 sec
+            hci_send_write_page_timeout(0x6000);  // ca. 15 sec
             break;
         case HCI_INIT_WRITE_CLASS_OF_DEVICE:
             hci_stack->substate = HCI_INIT_W4_WRITE_CLASS_OF_DEVICE;
-            hci_send_cmd(&hci_write_class_of_device, hci_stack->class_of_device);
+            hci_send_write_class_of_device(hci_stack->class_of_device);
             break;
         case HCI_INIT_WRITE_LOCAL_NAME:
             hci_stack->substate = HCI_INIT_W4_WRITE_LOCAL_NAME;
             if (hci_stack->local_name){
-                hci_send_cmd(&hci_write_local_name, hci_stack->local_name);
+                hci_send_write_local_name(hci_stack->local_name);
             } else {
                 char local_name[8+17+1];
                 // BTstack 11:22:33:44:55:66
@@ -1254,35 +1420,35 @@ static void hci_initializing_run(void){
                 memcpy(&local_name[8], bd_addr_to_str(hci_stack->local_bd_addr), 17);   // strlen(bd_addr_to_str(...)) = 17
                 local_name[8+17] = '\0';
                 log_info("---> Name %s", local_name);
-                hci_send_cmd(&hci_write_local_name, local_name);
+                hci_send_write_local_name(local_name);
             }
             break;
         case HCI_INIT_WRITE_EIR_DATA:
             hci_stack->substate = HCI_INIT_W4_WRITE_EIR_DATA;
-            hci_send_cmd(&hci_write_extended_inquiry_response, 0, hci_stack->eir_data);                        
+            hci_send_write_extended_inquiry_response(0, hci_stack->eir_data);                        
             break;
         case HCI_INIT_WRITE_INQUIRY_MODE:
             hci_stack->substate = HCI_INIT_W4_WRITE_INQUIRY_MODE;
-            hci_send_cmd(&hci_write_inquiry_mode, (int) hci_stack->inquiry_mode);
+            hci_send_write_inquiry_mode((int) hci_stack->inquiry_mode);
             break;
         case HCI_INIT_WRITE_SCAN_ENABLE:
-            hci_send_cmd(&hci_write_scan_enable, (hci_stack->connectable << 1) | hci_stack->discoverable); // page scan
+            hci_send_write_scan_enable((hci_stack->connectable << 1) | hci_stack->discoverable); // page scan
             hci_stack->substate = HCI_INIT_W4_WRITE_SCAN_ENABLE;
             break;
         // only sent if ENABLE_SCO_OVER_HCI is defined
         case HCI_INIT_WRITE_SYNCHRONOUS_FLOW_CONTROL_ENABLE:
             hci_stack->substate = HCI_INIT_W4_WRITE_SYNCHRONOUS_FLOW_CONTROL_ENABLE;
-            hci_send_cmd(&hci_write_synchronous_flow_control_enable, 1); // SCO tracking enabled
+            hci_send_write_synchronous_flow_control_enable(1); // SCO tracking enabled
             break;
         case HCI_INIT_WRITE_DEFAULT_ERRONEOUS_DATA_REPORTING:
             hci_stack->substate = HCI_INIT_W4_WRITE_DEFAULT_ERRONEOUS_DATA_REPORTING;
-            hci_send_cmd(&hci_write_default_erroneous_data_reporting, 1);
+            hci_send_write_default_erroneous_data_reporting(1);
             break;
         // only sent if ENABLE_SCO_OVER_HCI and manufacturer is Broadcom
         case HCI_INIT_BCM_WRITE_SCO_PCM_INT:
             hci_stack->substate = HCI_INIT_W4_BCM_WRITE_SCO_PCM_INT;
             log_info("BCM: Route SCO data via HCI transport");
-            hci_send_cmd(&hci_bcm_write_sco_pcm_int, 1, 0, 0, 0, 0);
+            hci_send_bcm_write_sco_pcm_int(1, 0, 0, 0, 0);
             break;
 
 #endif
@@ -1290,22 +1456,22 @@ static void hci_initializing_run(void){
         // LE INIT
         case HCI_INIT_LE_READ_BUFFER_SIZE:
             hci_stack->substate = HCI_INIT_W4_LE_READ_BUFFER_SIZE;
-            hci_send_cmd(&hci_le_read_buffer_size);
+            hci_send_le_read_buffer_size();
             break;
         case HCI_INIT_WRITE_LE_HOST_SUPPORTED:
             // LE Supported Host = 1, Simultaneous Host = 0
             hci_stack->substate = HCI_INIT_W4_WRITE_LE_HOST_SUPPORTED;
-            hci_send_cmd(&hci_write_le_host_supported, 1, 0);
+            hci_send_write_le_host_supported(1, 0);
             break;
 #ifdef ENABLE_LE_CENTRAL
         case HCI_INIT_READ_WHITE_LIST_SIZE:
             hci_stack->substate = HCI_INIT_W4_READ_WHITE_LIST_SIZE;
-            hci_send_cmd(&hci_le_read_white_list_size);
+            hci_send_le_read_white_list_size();
             break;
         case HCI_INIT_LE_SET_SCAN_PARAMETERS:
             // LE Scan Parameters: active scanning, 300 ms interval, 30 ms window, own address type, accept all advs
             hci_stack->substate = HCI_INIT_W4_LE_SET_SCAN_PARAMETERS;
-            hci_send_cmd(&hci_le_set_scan_parameters, 1, 0x1e0, 0x30, hci_stack->le_own_addr_type, 0);
+            hci_send_le_set_scan_parameters(1, 0x1e0, 0x30, hci_stack->le_own_addr_type, 0);
             break;
 #endif
 #endif
@@ -1540,7 +1706,7 @@ static void hci_initializing_event_handler(uint8_t * packet, uint16_t size){
                 hci_init_done();
                 return;
             }
-            if (!gap_ssp_supported()){
+            if (!gap_ssp_supported(hci_stack)){
                 hci_stack->substate = HCI_INIT_WRITE_PAGE_TIMEOUT;
                 return;
             }
@@ -1688,8 +1854,8 @@ static void event_handler(uint8_t *packet, int size){
                 log_info("Local Address, Status: 0x%02x: Addr: %s",
                     packet[OFFSET_OF_DATA_IN_COMMAND_COMPLETE], bd_addr_to_str(hci_stack->local_bd_addr));
 #ifdef ENABLE_CLASSIC
-                if (hci_stack->link_key_db){
-                    hci_stack->link_key_db->set_local_bd_addr(hci_stack->local_bd_addr);
+                if (hci_host->link_key_db){
+                    hci_host->link_key_db->set_local_bd_addr(hci_stack->local_bd_addr);
                 }
 #endif
             }
@@ -1804,7 +1970,7 @@ static void event_handler(uint8_t *packet, int size){
             link_type = packet[11];
             log_info("Connection_incoming: %s, type %u", bd_addr_to_str(addr), link_type);
             addr_type = link_type == 1 ? BD_ADDR_TYPE_CLASSIC : BD_ADDR_TYPE_SCO;
-            conn = hci_connection_for_bd_addr_and_type(addr, addr_type);
+            conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, addr_type);
             if (!conn) {
                 conn = create_connection_for_bd_addr_and_type(addr, addr_type);
             }
@@ -1828,7 +1994,7 @@ static void event_handler(uint8_t *packet, int size){
             reverse_bd_addr(&packet[5], addr);
             log_info("Connection_complete (status=%u) %s", packet[2], bd_addr_to_str(addr));
             addr_type = BD_ADDR_TYPE_CLASSIC;
-            conn = hci_connection_for_bd_addr_and_type(addr, addr_type);
+            conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, addr_type);
             if (conn) {
                 if (!packet[2]){
                     conn->state = OPEN;
@@ -1849,7 +2015,7 @@ static void event_handler(uint8_t *packet, int size){
                     memcpy(&bd_address, conn->address, 6);
 
                     // connection failed, remove entry
-                    btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+                    btstack_linked_list_remove(&hci_host->connections, (btstack_linked_item_t *) conn);
                     btstack_memory_hci_connection_free( conn );
                     
                     // notify client if dedicated bonding
@@ -1873,7 +2039,7 @@ static void event_handler(uint8_t *packet, int size){
                 // connection failed
                 break;
             }
-            conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_SCO);
+            conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_SCO);
             if (!conn) {
                 conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_SCO);
             }
@@ -1915,7 +2081,7 @@ static void event_handler(uint8_t *packet, int size){
             log_info("HCI_EVENT_LINK_KEY_REQUEST");
             hci_add_connection_flags_for_flipped_bd_addr(&packet[2], RECV_LINK_KEY_REQUEST);
             // non-bondable mode: link key negative reply will be sent by HANDLE_LINK_KEY_REQUEST
-            if (hci_stack->bondable && !hci_stack->link_key_db) break;
+            if (hci_stack->bondable && !hci_host->link_key_db) break;
             hci_add_connection_flags_for_flipped_bd_addr(&packet[2], HANDLE_LINK_KEY_REQUEST);
             hci_run();
             // request handled by hci_run() as HANDLE_LINK_KEY_REQUEST gets set
@@ -1923,7 +2089,7 @@ static void event_handler(uint8_t *packet, int size){
             
         case HCI_EVENT_LINK_KEY_NOTIFICATION: {
             reverse_bd_addr(&packet[2], addr);
-            conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+            conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
             if (!conn) break;
             conn->authentication_flags |= RECV_LINK_KEY_NOTIFICATION;
             link_key_type_t link_key_type = (link_key_type_t)packet[24];
@@ -1945,9 +2111,9 @@ static void event_handler(uint8_t *packet, int size){
                 return;
             }
             // PIN CODE REQUEST means the link key request didn't succee -> delete stored link key
-            if (!hci_stack->link_key_db) break;
+            if (!hci_host->link_key_db) break;
             hci_event_pin_code_request_get_bd_addr(packet, addr);
-            hci_stack->link_key_db->delete_link_key(addr);
+            hci_host->link_key_db->delete_link_key(addr);
             break;
             
         case HCI_EVENT_IO_CAPABILITY_REQUEST:
@@ -2015,11 +2181,11 @@ static void event_handler(uint8_t *packet, int size){
             if (packet[2]) break;   // status != 0
             handle = little_endian_read_16(packet, 3);
             // drop outgoing ACL fragments if it is for closed connection
-            if (hci_stack->acl_fragmentation_total_size > 0) {
-                if (handle == READ_ACL_CONNECTION_HANDLE(hci_stack->hci_packet_buffer)){
+            if (hci_host->acl_fragmentation_total_size > 0) {
+                if (handle == hci_host->acl_fragmentation_con_handle){
                     log_info("hci: drop fragmented ACL data for closed connection");
-                     hci_stack->acl_fragmentation_total_size = 0;
-                     hci_stack->acl_fragmentation_pos = 0;
+                     hci_host->acl_fragmentation_total_size = 0;
+                     hci_host->acl_fragmentation_pos = 0;
                 }
             }
 
@@ -2038,8 +2204,8 @@ static void event_handler(uint8_t *packet, int size){
 
         case HCI_EVENT_HARDWARE_ERROR:
             log_error("Hardware Error: 0x%02x", packet[2]);
-            if (hci_stack->hardware_error_callback){
-                (*hci_stack->hardware_error_callback)(packet[2]);
+            if (hci_host->hardware_error_callback){
+                (*hci_host->hardware_error_callback)(packet[2]);
             } else {
                 // if no special requests, just reboot stack
                 hci_power_control_off();
@@ -2063,7 +2229,7 @@ static void event_handler(uint8_t *packet, int size){
                 log_error("Synchronous HCI Transport shouldn't send HCI_EVENT_TRANSPORT_PACKET_SENT");
                 return; // instead of break: to avoid re-entering hci_run()
             }
-            if (hci_stack->acl_fragmentation_total_size) break;
+            if (hci_host->acl_fragmentation_total_size) break;
             hci_release_packet_buffer();
             
             // L2CAP receives this event via the hci_emit_event below
@@ -2103,7 +2269,7 @@ static void event_handler(uint8_t *packet, int size){
                     reverse_bd_addr(&packet[8], addr);
                     addr_type = (bd_addr_type_t)packet[7];
                     log_info("LE Connection_complete (status=%u) type %u, %s", packet[3], addr_type, bd_addr_to_str(addr));
-                    conn = hci_connection_for_bd_addr_and_type(addr, addr_type);
+                    conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, addr_type);
 #ifdef ENABLE_LE_CENTRAL
                     // if auto-connect, remove from whitelist in both roles
                     if (hci_stack->le_connecting_state == LE_CONNECTING_WHITELIST){
@@ -2115,7 +2281,7 @@ static void event_handler(uint8_t *packet, int size){
                         hci_stack->le_connecting_state = LE_CONNECTING_IDLE;
                         // remove entry
                         if (conn){
-                            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+                            btstack_linked_list_remove(&hci_host->connections, (btstack_linked_item_t *) conn);
                             btstack_memory_hci_connection_free( conn );
                         }
                         break;
@@ -2210,8 +2376,8 @@ static void event_handler(uint8_t *packet, int size){
 
 #ifdef ENABLE_CLASSIC
 static void sco_handler(uint8_t * packet, uint16_t size){
-    if (!hci_stack->sco_packet_handler) return;
-    hci_stack->sco_packet_handler(HCI_SCO_DATA_PACKET, 0, packet, size);
+    if (!hci_host->sco_packet_handler) return;
+    hci_host->sco_packet_handler(HCI_SCO_DATA_PACKET, 0, packet, size);
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
     hci_con_handle_t con_handle = READ_SCO_CONNECTION_HANDLE(packet);
     hci_connection_t *conn      = hci_connection_for_handle(con_handle);
@@ -2243,17 +2409,326 @@ static void packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
     }
 }
 
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+
+// Multiple Controllers
+//
+// Each controller has its own hci_stack_t, hci_stack points to the selected one. Connections, event handlers,
+// link key db and the outgoing packet buffer are shared and stored in the stack of the first controller (hci_host).
+// Connection handles reported by a controller are mapped to handles that are unique in the host stack for all
+// incoming packets, and mapped back for all outgoing packets after they have been logged by hci_dump.
+
+static void hci_controller_select_index(int controller){
+    hci_controller_index = controller;
+    hci_stack = hci_controllers[controller].stack;
+}
+
+static void hci_controller_init_con_handles(void){
+    hci_controller_t * controller = &hci_controllers[hci_controller_index];
+    int i;
+    for (i = 0; i < MAX_NR_HCI_CONTROLLER_CONNECTIONS; i++){
+        controller->con_handles[i].con_handle = HCI_CON_HANDLE_INVALID;
+    }
+    controller->command_con_handle = HCI_CON_HANDLE_INVALID;
+}
+
+static hci_con_handle_mapping_t * hci_controller_mapping_for_con_handle(int controller, hci_con_handle_t con_handle){
+    int i;
+    for (i = 0; i < MAX_NR_HCI_CONTROLLER_CONNECTIONS; i++){
+        hci_con_handle_mapping_t * mapping = &hci_controllers[controller].con_handles[i];
+        if (mapping->con_handle == con_handle) return mapping;
+    }
+    return NULL;
+}
+
+static hci_con_handle_mapping_t * hci_controller_mapping_for_controller_con_handle(hci_con_handle_t controller_con_handle){
+    int i;
+    for (i = 0; i < MAX_NR_HCI_CONTROLLER_CONNECTIONS; i++){
+        hci_con_handle_mapping_t * mapping = &hci_controllers[hci_controller_index].con_handles[i];
+        if (mapping->con_handle == HCI_CON_HANDLE_INVALID) continue;
+        if (mapping->controller_con_handle == controller_con_handle) return mapping;
+    }
+    return NULL;
+}
+
+static int hci_controller_con_handle_in_use(hci_con_handle_t con_handle){
+    return hci_get_controller_for_con_handle(con_handle) >= 0;
+}
+
+// map new connection handle of selected controller, keep controller's handle if possible
+static void hci_controller_add_con_handle(hci_con_handle_t controller_con_handle){
+    if (hci_controller_mapping_for_controller_con_handle(controller_con_handle)) return;
+    hci_con_handle_mapping_t * mapping = hci_controller_mapping_for_con_handle(hci_controller_index, HCI_CON_HANDLE_INVALID);
+    if (!mapping){
+        log_error("hci_controller_add_con_handle: MAX_NR_HCI_CONTROLLER_CONNECTIONS reached");
+        return;
+    }
+    hci_con_handle_t con_handle = controller_con_handle;
+    if (hci_controller_con_handle_in_use(con_handle)){
+        for (con_handle = 0x0001; con_handle < 0x0eff; con_handle++){
+            if (!hci_controller_con_handle_in_use(con_handle)) break;
+        }
+    }
+    mapping->controller_con_handle = controller_con_handle;
+    mapping->con_handle = con_handle;
+    log_info("hci_controller_add_con_handle: controller %u, handle 0x%04x -> 0x%04x", hci_controller_index, controller_con_handle, con_handle);
+}
+
+static void hci_controller_remove_con_handle(hci_con_handle_t con_handle){
+    hci_con_handle_mapping_t * mapping = hci_controller_mapping_for_con_handle(hci_controller_index, con_handle);
+    if (!mapping) return;
+    mapping->con_handle = HCI_CON_HANDLE_INVALID;
+}
+
+// replace controller handle at pos by host handle, keep flags in upper 4 bits
+static int hci_controller_read_con_handle(uint8_t * packet, int pos){
+    uint16_t value = little_endian_read_16(packet, pos);
+    hci_con_handle_mapping_t * mapping = hci_controller_mapping_for_controller_con_handle(value & 0x0fff);
+    hci_con_handle_t con_handle = mapping ? mapping->con_handle : HCI_CON_HANDLE_INVALID;
+    little_endian_store_16(packet, pos, (value & 0xf000) | (con_handle & 0x0fff));
+    return mapping != NULL;
+}
+
+// replace host handle at pos by controller handle, keep flags in upper 4 bits
+static void hci_controller_store_controller_con_handle(uint8_t * packet, int pos){
+    uint16_t value = little_endian_read_16(packet, pos);
+    hci_con_handle_mapping_t * mapping = hci_controller_mapping_for_con_handle(hci_controller_index, value & 0x0fff);
+    if (!mapping) return;
+    little_endian_store_16(packet, pos, (value & 0xf000) | mapping->controller_con_handle);
+}
+
+// events with connection handle after status
+static const uint8_t hci_controller_events_with_status_and_con_handle[] = {
+    HCI_EVENT_CONNECTION_COMPLETE,
+    HCI_EVENT_DISCONNECTION_COMPLETE,
+    HCI_EVENT_AUTHENTICATION_COMPLETE_EVENT,
+    HCI_EVENT_ENCRYPTION_CHANGE,
+    HCI_EVENT_CHANGE_CONNECTION_LINK_KEY_COMPLETE,
+    HCI_EVENT_MASTER_LINK_KEY_COMPLETE,
+    HCI_EVENT_READ_REMOTE_SUPPORTED_FEATURES_COMPLETE,
+    HCI_EVENT_READ_REMOTE_VERSION_INFORMATION_COMPLETE,
+    HCI_EVENT_QOS_SETUP_COMPLETE,
+    HCI_EVENT_MODE_CHANGE_EVENT,
+    HCI_EVENT_READ_CLOCK_OFFSET_COMPLETE,
+    HCI_EVENT_CONNECTION_PACKET_TYPE_CHANGED,
+    0x21,   // Flow Specification Complete
+    0x23,   // Read Remote Extended Features Complete
+    HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE,
+    0x2D,   // Synchronous Connection Changed
+    0x2E,   // Sniff Subrating
+    HCI_EVENT_ENCRYPTION_KEY_REFRESH_COMPLETE,
+};
+
+// events that start with connection handle
+static const uint8_t hci_controller_events_with_con_handle[] = {
+    HCI_EVENT_FLUSH_OCCURRED,
+    HCI_EVENT_MAX_SLOTS_CHANGED,
+    0x1E,   // QoS Violation
+    0x38,   // Link Supervision Timeout Changed
+    0x39,   // Enhanced Flush Complete
+    0x57,   // Authenticated Payload Timeout Expired
+};
+
+static int hci_controller_event_in_list(uint8_t event_code, const uint8_t * list, int list_len){
+    int i;
+    for (i = 0; i < list_len; i++){
+        if (list[i] == event_code) return 1;
+    }
+    return 0;
+}
+
+static void hci_controller_handle_incoming_le_event(uint8_t * packet, uint16_t size){
+    if (size < 5) return;
+    switch (packet[2]){
+        case HCI_SUBEVENT_LE_CONNECTION_COMPLETE:
+        case HCI_SUBEVENT_LE_ENHANCED_CONNECTION_COMPLETE:
+            if (packet[3] == 0){
+                hci_controller_add_con_handle(little_endian_read_16(packet, 4) & 0x0fff);
+            }
+            // fall through
+        case HCI_SUBEVENT_LE_CONNECTION_UPDATE_COMPLETE:
+        case HCI_SUBEVENT_LE_READ_REMOTE_USED_FEATURES_COMPLETE:
+        case 0x0C:  // PHY Update Complete
+            if (size < 6) return;
+            hci_controller_read_con_handle(packet, 4);
+            break;
+        case HCI_SUBEVENT_LE_LONG_TERM_KEY_REQUEST:
+        case HCI_SUBEVENT_LE_REMOTE_CONNECTION_PARAMETER_REQUEST:
+        case HCI_SUBEVENT_LE_DATA_LENGTH_CHANGE:
+            hci_controller_read_con_handle(packet, 3);
+            break;
+        default:
+            break;
+    }
+}
+
+static void hci_controller_handle_incoming_event(uint8_t * packet, uint16_t size){
+    uint8_t event_code = packet[0];
+    int i;
+    switch (event_code){
+        case HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS:
+            for (i = 0; i < packet[2] && (3 + i * 4 + 2) <= size; i++){
+                hci_controller_read_con_handle(packet, 3 + i * 4);
+            }
+            return;
+        case HCI_EVENT_COMMAND_COMPLETE:{
+            // return parameters of commands with connection handle start with status and connection handle
+            hci_con_handle_t command_con_handle = hci_controllers[hci_controller_index].command_con_handle;
+            if (command_con_handle == HCI_CON_HANDLE_INVALID) return;
+            if (size < 8) return;
+            if (little_endian_read_16(packet, 3) != hci_stack->last_cmd_opcode) return;
+            hci_con_handle_mapping_t * mapping = hci_controller_mapping_for_con_handle(hci_controller_index, command_con_handle);
+            if (!mapping) return;
+            if (little_endian_read_16(packet, 6) != mapping->controller_con_handle) return;
+            little_endian_store_16(packet, 6, command_con_handle);
+            return;
+        }
+        case HCI_EVENT_LE_META:
+            hci_controller_handle_incoming_le_event(packet, size);
+            return;
+        case HCI_EVENT_CONNECTION_COMPLETE:
+        case HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE:
+            if (size < 5) return;
+            if (packet[2] == 0){
+                hci_controller_add_con_handle(little_endian_read_16(packet, 3) & 0x0fff);
+            }
+            break;
+        default:
+            break;
+    }
+    if (hci_controller_event_in_list(event_code, hci_controller_events_with_status_and_con_handle, sizeof(hci_controller_events_with_status_and_con_handle))){
+        if (size < 5) return;
+        hci_controller_read_con_handle(packet, 3);
+        return;
+    }
+    if (hci_controller_event_in_list(event_code, hci_controller_events_with_con_handle, sizeof(hci_controller_events_with_con_handle))){
+        if (size < 4) return;
+        hci_controller_read_con_handle(packet, 2);
+        return;
+    }
+}
+
+// translate connection handles of incoming packet, returns 0 if packet should be dropped
+static int hci_controller_handle_incoming(uint8_t packet_type, uint8_t * packet, uint16_t size){
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (size < 2) return 1;
+            hci_controller_handle_incoming_event(packet, size);
+            return 1;
+        case HCI_ACL_DATA_PACKET:
+        case HCI_SCO_DATA_PACKET:
+            if (size < 2) return 0;
+            if (hci_stack->loopback_mode) return 1;
+            if (hci_controller_read_con_handle(packet, 0)) return 1;
+            log_error("hci_controller_handle_incoming: drop packet type %u for unknown handle on controller %u", packet_type, hci_controller_index);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static void hci_controller_packet_handler(int controller, uint8_t packet_type, uint8_t *packet, uint16_t size){
+    int selected_controller = hci_controller_index;
+    hci_controller_select_index(controller);
+    if (hci_controller_handle_incoming(packet_type, packet, size)){
+        packet_handler(packet_type, packet, size);
+        // forget connection handle after stack has processed the disconnect
+        if (packet_type == HCI_EVENT_PACKET && packet[0] == HCI_EVENT_DISCONNECTION_COMPLETE && packet[2] == 0){
+            hci_controller_remove_con_handle(little_endian_read_16(packet, 3));
+        }
+    }
+    // stack might have been closed
+    if (hci_num_controllers == 0) return;
+    hci_controller_select_index(selected_controller);
+}
+
+static void hci_controller_0_packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    hci_controller_packet_handler(0, packet_type, packet, size);
+}
+static void hci_controller_1_packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    hci_controller_packet_handler(1, packet_type, packet, size);
+}
+#if MAX_NR_HCI_CONTROLLERS > 2
+static void hci_controller_2_packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    hci_controller_packet_handler(2, packet_type, packet, size);
+}
+#endif
+#if MAX_NR_HCI_CONTROLLERS > 3
+static void hci_controller_3_packet_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    hci_controller_packet_handler(3, packet_type, packet, size);
+}
+#endif
+
+typedef void (*hci_controller_packet_handler_t)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+static const hci_controller_packet_handler_t hci_controller_packet_handlers[MAX_NR_HCI_CONTROLLERS] = {
+    &hci_controller_0_packet_handler,
+    &hci_controller_1_packet_handler,
+#if MAX_NR_HCI_CONTROLLERS > 2
+    &hci_controller_2_packet_handler,
+#endif
+#if MAX_NR_HCI_CONTROLLERS > 3
+    &hci_controller_3_packet_handler,
+#endif
+};
+
+static int hci_controller_enter_for_con_handle(hci_con_handle_t con_handle){
+    int previous_controller = hci_controller_index;
+    int controller = hci_get_controller_for_con_handle(con_handle);
+    if (controller >= 0){
+        hci_controller_select_index(controller);
+    }
+    return previous_controller;
+}
+
+static void hci_controller_leave(int previous_controller){
+    hci_controller_select_index(previous_controller);
+}
+
+static int hci_connection_on_selected_controller(hci_connection_t * connection){
+    return connection->controller == hci_controller_index;
+}
+
+static hci_stack_t * hci_stack_for_connection(hci_connection_t * connection){
+    return hci_controllers[connection->controller].stack;
+}
+
+void hci_select_controller(int controller){
+    if (controller < 0 || controller >= hci_num_controllers){
+        log_error("hci_select_controller: invalid controller %d", controller);
+        return;
+    }
+    hci_controller_select_index(controller);
+}
+
+int hci_get_controller(void){
+    return hci_controller_index;
+}
+
+int hci_get_num_controllers(void){
+    return hci_num_controllers;
+}
+
+int hci_get_controller_for_con_handle(hci_con_handle_t con_handle){
+    if (con_handle == HCI_CON_HANDLE_INVALID) return -1;
+    int controller;
+    for (controller = 0; controller < hci_num_controllers; controller++){
+        if (hci_controller_mapping_for_con_handle(controller, con_handle)) return controller;
+    }
+    return -1;
+}
+#endif
+
 /**
  * @brief Add event packet handler. 
  */
 void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
-    btstack_linked_list_add_tail(&hci_stack->event_handlers, (btstack_linked_item_t*) callback_handler);
+    btstack_linked_list_add_tail(&hci_host->event_handlers, (btstack_linked_item_t*) callback_handler);
 }
 
 
 /** Register HCI packet handlers */
 void hci_register_acl_packet_handler(btstack_packet_handler_t handler){
-    hci_stack->acl_packet_handler = handler;
+    hci_host->acl_packet_handler = handler;
 }
 
 #ifdef ENABLE_CLASSIC
@@ -2261,13 +2736,18 @@ void hci_register_acl_packet_handler(btstack_packet_handler_t handler){
  * @brief Registers a packet handler for SCO data. Used for HSP and HFP profiles.
  */
 void hci_register_sco_packet_handler(btstack_packet_handler_t handler){
-    hci_stack->sco_packet_handler = handler;    
+    hci_host->sco_packet_handler = handler;    
 }
 #endif
 
 static void hci_state_reset(void){
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // connections and outgoing buffer are shared with the other controllers, just forget the connection handles
+    hci_controller_init_con_handles();
+#else
     // no connections yet
-    hci_stack->connections = NULL;
+    hci_host->connections = NULL;
+#endif
 
     // keep discoverable/connectable as this has been requested by the client(s)
     // hci_stack->discoverable = 0;
@@ -2275,8 +2755,10 @@ static void hci_state_reset(void){
     // hci_stack->bondable = 1;
     // hci_stack->own_addr_type = 0;
 
+#ifndef ENABLE_HCI_MULTIPLE_CONTROLLERS
     // buffer is free
-    hci_stack->hci_packet_buffer_reserved = 0;
+    hci_host->hci_packet_buffer_reserved = 0;
+#endif
 
     // no pending cmds
     hci_stack->decline_reason = 0;
@@ -2309,23 +2791,15 @@ static void hci_state_reset(void){
  */
 void hci_set_link_key_db(btstack_link_key_db_t const * link_key_db){
     // store and open remote device db
-    hci_stack->link_key_db = link_key_db;
-    if (hci_stack->link_key_db) {
-        hci_stack->link_key_db->open();
+    hci_host->link_key_db = link_key_db;
+    if (hci_host->link_key_db) {
+        hci_host->link_key_db->open();
     }
 }
 #endif
 
-void hci_init(const hci_transport_t *transport, const void *config){
-    
-#ifdef HAVE_MALLOC
-    if (!hci_stack) {
-        hci_stack = (hci_stack_t*) malloc(sizeof(hci_stack_t));
-    }
-#else
-    hci_stack = &hci_stack_static;
-#endif
-    memset(hci_stack, 0, sizeof(hci_stack_t));
+// set up selected stack for given transport
+static void hci_init_stack(const hci_transport_t *transport, const void *config, void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
 
     // reference to use transport layer implementation
     hci_stack->hci_transport = transport;
@@ -2334,13 +2808,13 @@ void hci_init(const hci_transport_t *transport, const void *config){
     hci_stack->config = config;
     
     // setup pointer for outgoing packet buffer
-    hci_stack->hci_packet_buffer = &hci_stack->hci_packet_buffer_data[HCI_OUTGOING_PRE_BUFFER_SIZE];
+    hci_stack->hci_packet_buffer = &hci_host->hci_packet_buffer_data[HCI_OUTGOING_PRE_BUFFER_SIZE];
 
     // max acl payload size defined in config.h
     hci_stack->acl_data_packet_length = HCI_ACL_PAYLOAD_SIZE;
     
     // register packet handlers with transport
-    transport->register_packet_handler(&packet_handler);
+    transport->register_packet_handler(handler);
 
     hci_stack->state = HCI_STATE_OFF;
 
@@ -2362,6 +2836,55 @@ void hci_init(const hci_transport_t *transport, const void *config){
     hci_state_reset();
 }
 
+void hci_init(const hci_transport_t *transport, const void *config){
+    
+#ifdef HAVE_MALLOC
+    if (!hci_stack) {
+        hci_stack = (hci_stack_t*) malloc(sizeof(hci_stack_t));
+    }
+#else
+    hci_stack = &hci_stack_static;
+#endif
+    memset(hci_stack, 0, sizeof(hci_stack_t));
+    hci_host = hci_stack;
+
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    hci_controllers[0].stack = hci_stack;
+    hci_num_controllers = 1;
+    hci_controller_index = 0;
+    hci_command_previous_controller = -1;
+    hci_init_stack(transport, config, hci_controller_packet_handlers[0]);
+#else
+    hci_init_stack(transport, config, &packet_handler);
+#endif
+}
+
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+int hci_add_controller(const hci_transport_t *transport, const void *config){
+    if (hci_num_controllers >= MAX_NR_HCI_CONTROLLERS){
+        log_error("hci_add_controller: MAX_NR_HCI_CONTROLLERS %u reached", MAX_NR_HCI_CONTROLLERS);
+        return -1;
+    }
+    int controller = hci_num_controllers;
+    hci_stack_t * stack;
+#ifdef HAVE_MALLOC
+    stack = (hci_stack_t*) malloc(sizeof(hci_stack_t));
+    if (!stack) return -1;
+#else
+    stack = &hci_controller_stacks_static[controller - 1];
+#endif
+    memset(stack, 0, sizeof(hci_stack_t));
+    hci_controllers[controller].stack = stack;
+    hci_num_controllers++;
+
+    int selected_controller = hci_controller_index;
+    hci_controller_select_index(controller);
+    hci_init_stack(transport, config, hci_controller_packet_handlers[controller]);
+    hci_controller_select_index(selected_controller);
+    return controller;
+}
+#endif
+
 /**
  * @brief Configure Bluetooth chipset driver. Has to be called before power on, or right after receiving the local version information
  */
@@ -2386,12 +2909,12 @@ void hci_set_control(const btstack_control_t *hardware_control){
 
 void hci_close(void){
     // close remote device db
-    if (hci_stack->link_key_db) {
-        hci_stack->link_key_db->close();
+    if (hci_host->link_key_db) {
+        hci_host->link_key_db->close();
     }
 
     btstack_linked_list_iterator_t lit;
-    btstack_linked_list_iterator_init(&lit, &hci_stack->connections);
+    btstack_linked_list_iterator_init(&lit, &hci_host->connections);
     while (btstack_linked_list_iterator_has_next(&lit)){
         // cancel all l2cap connections by emitting dicsconnection complete before shutdown (free) connection
         hci_connection_t * connection = (hci_connection_t*) btstack_linked_list_iterator_next(&lit);
@@ -2399,12 +2922,31 @@ void hci_close(void){
         hci_shutdown_connection(connection);
     }
 
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    int controller;
+    for (controller = hci_num_controllers - 1; controller >= 0; controller--){
+        hci_controller_select_index(controller);
+        hci_power_control(HCI_POWER_OFF);
+        if (controller == 0) break;
+#ifdef HAVE_MALLOC
+        free(hci_stack);
+#endif
+        hci_controllers[controller].stack = NULL;
+        hci_num_controllers--;
+    }
+    hci_controllers[0].stack = NULL;
+    hci_num_controllers = 0;
+    hci_controller_index = 0;
+    hci_stack = hci_host;
+#else
     hci_power_control(HCI_POWER_OFF);
+#endif
     
 #ifdef HAVE_MALLOC
     free(hci_stack);
 #endif
     hci_stack = NULL;
+    hci_host = NULL;
 }
 
 #ifdef ENABLE_CLASSIC
@@ -2536,7 +3078,10 @@ static int hci_power_control_wake(void){
 static void hci_power_transition_to_initializing(void){
     // set up state machine
     hci_stack->num_cmd_packets = 1; // assume that one cmd can be sent
-    hci_stack->hci_packet_buffer_reserved = 0;
+#ifndef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // with multiple controllers, the shared buffer might be in use by another controller
+    hci_host->hci_packet_buffer_reserved = 0;
+#endif
     hci_stack->state = HCI_STATE_INITIALIZING;
     hci_stack->substate = HCI_INIT_SEND_RESET;
 }
@@ -2728,8 +3273,9 @@ static void hci_host_num_completed_packets(void){
 
     // add { handle, packets } entries
     btstack_linked_item_t * it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
+        if (!hci_connection_on_selected_controller(connection)) continue;
         if (connection->num_packets_completed){
             little_endian_store_16(packet, size, connection->con_handle);
             size += 2;
@@ -2747,36 +3293,58 @@ static void hci_host_num_completed_packets(void){
     hci_stack->host_completed_packets = 0;
 
     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    int i;
+    for (i = 0; i < num_handles; i++){
+        hci_controller_store_controller_con_handle(packet, 4 + i * 4);
+    }
+#endif
     hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, packet, size);
 
     // release packet buffer for synchronous transport implementations    
     if (hci_transport_synchronous()){
-        hci_stack->hci_packet_buffer_reserved = 0;
+        hci_host->hci_packet_buffer_reserved = 0;
     }
 }
 #endif
 
-static void hci_run(void){
-    
-    // log_info("hci_run: entered");
-    btstack_linked_item_t * it;
+// returns 1 if a continuation fragment was sent
+static int hci_run_acl_fragments(void){
+    if (hci_host->acl_fragmentation_total_size == 0) return 0;
+    hci_con_handle_t con_handle = hci_host->acl_fragmentation_con_handle;
+    hci_connection_t *connection = hci_connection_for_handle(con_handle);
+    if (!connection) {
+        // connection gone -> discard further fragments
+        log_info("hci_run: fragmented ACL packet no connection -> discard fragment");
+        hci_host->acl_fragmentation_total_size = 0;
+        hci_host->acl_fragmentation_pos = 0;
+        return 0;
+    }
+    if (!hci_can_send_prepared_acl_packet_now(con_handle)) return 0;
+    int previous_controller = hci_controller_enter_for_con_handle(con_handle);
+    hci_send_acl_packet_fragments(connection);
+    hci_controller_leave(previous_controller);
+    return 1;
+}
 
-    // send continuation fragments first, as they block the prepared packet buffer
-    if (hci_stack->acl_fragmentation_total_size > 0) {
-        hci_con_handle_t con_handle = READ_ACL_CONNECTION_HANDLE(hci_stack->hci_packet_buffer);
-        hci_connection_t *connection = hci_connection_for_handle(con_handle);
-        if (connection) {
-            if (hci_can_send_prepared_acl_packet_now(con_handle)){
-                hci_send_acl_packet_fragments(connection);
-                return;
-            }
-        } else {
-            // connection gone -> discard further fragments
-            log_info("hci_run: fragmented ACL packet no connection -> discard fragment");
-            hci_stack->acl_fragmentation_total_size = 0;
-            hci_stack->acl_fragmentation_pos = 0;
-        }
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+static hci_connection_t * hci_first_connection_on_selected_controller(void){
+    btstack_linked_item_t * it;
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
+        hci_connection_t * connection = (hci_connection_t *) it;
+        if (hci_connection_on_selected_controller(connection)) return connection;
     }
+    return NULL;
+}
+#else
+static inline hci_connection_t * hci_first_connection_on_selected_controller(void){
+    return (hci_connection_t *) hci_host->connections;
+}
+#endif
+
+static void hci_run_controller(void){
+    
+    btstack_linked_item_t * it;
 
 #ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
     // send host num completed packets next as they don't require num_cmd_packets > 0
@@ -2796,12 +3364,12 @@ static void hci_run(void){
     if (hci_stack->decline_reason){
         uint8_t reason = hci_stack->decline_reason;
         hci_stack->decline_reason = 0;
-        hci_send_cmd(&hci_reject_connection_request, hci_stack->decline_addr, reason);
+        hci_send_reject_connection_request(hci_stack->decline_addr, reason);
         return;
     }
     // send scan enable
     if (hci_stack->state == HCI_STATE_WORKING && hci_stack->new_scan_enable_value != 0xff && hci_classic_supported()){
-        hci_send_cmd(&hci_write_scan_enable, hci_stack->new_scan_enable_value);
+        hci_send_write_scan_enable(hci_stack->new_scan_enable_value);
         hci_stack->new_scan_enable_value = 0xff;
         return;
     }
@@ -2809,19 +3377,19 @@ static void hci_run(void){
     if (hci_stack->inquiry_state >= GAP_INQUIRY_DURATION_MIN && hci_stack->inquiry_state <= GAP_INQUIRY_DURATION_MAX){
         uint8_t duration = hci_stack->inquiry_state;
         hci_stack->inquiry_state = GAP_INQUIRY_STATE_ACTIVE;
-        hci_send_cmd(&hci_inquiry, HCI_INQUIRY_LAP, duration, 0);
+        hci_send_inquiry(HCI_INQUIRY_LAP, duration, 0);
         return;
     }
     if (hci_stack->inquiry_state == GAP_INQUIRY_STATE_W2_CANCEL){
         hci_stack->inquiry_state = GAP_INQUIRY_STATE_W4_CANCELLED;
-        hci_send_cmd(&hci_inquiry_cancel);
+        hci_send_inquiry_cancel();
         return;
     }
     // remote name request
     if (hci_stack->remote_name_state == GAP_REMOTE_NAME_STATE_W2_SEND){
         hci_stack->remote_name_state = GAP_REMOTE_NAME_STATE_W4_COMPLETE;
-        hci_send_cmd(&hci_remote_name_request, hci_stack->remote_name_addr, 
-            hci_stack->remote_name_page_scan_repetition_mode, hci_stack->remote_name_clock_offset);
+        hci_send_remote_name_request(hci_stack->remote_name_addr, 
+            hci_stack->remote_name_page_scan_repetition_mode, 0, hci_stack->remote_name_clock_offset);
         return;
     }
     // pairing
@@ -2830,22 +3398,22 @@ static void hci_run(void){
         hci_stack->gap_pairing_state = GAP_PAIRING_STATE_IDLE;
         switch (state){
             case GAP_PAIRING_STATE_SEND_PIN:
-                hci_send_cmd(&hci_pin_code_request_reply, hci_stack->gap_pairing_addr, strlen(hci_stack->gap_pairing_pin), hci_stack->gap_pairing_pin);
+                hci_send_pin_code_request_reply(hci_stack->gap_pairing_addr, strlen(hci_stack->gap_pairing_pin), (const uint8_t *) hci_stack->gap_pairing_pin);
                 break;
             case GAP_PAIRING_STATE_SEND_PIN_NEGATIVE:
-                hci_send_cmd(&hci_pin_code_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_pin_code_request_negative_reply(hci_stack->gap_pairing_addr);
                 break;
             case GAP_PAIRING_STATE_SEND_PASSKEY:
-                hci_send_cmd(&hci_user_passkey_request_reply, hci_stack->gap_pairing_addr, hci_stack->gap_pairing_passkey);
+                hci_send_user_passkey_request_reply(hci_stack->gap_pairing_addr, hci_stack->gap_pairing_passkey);
                 break;
             case GAP_PAIRING_STATE_SEND_PASSKEY_NEGATIVE:
-                hci_send_cmd(&hci_user_passkey_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_user_passkey_request_negative_reply(hci_stack->gap_pairing_addr);
                 break;
             case GAP_PAIRING_STATE_SEND_CONFIRMATION:
-                hci_send_cmd(&hci_user_confirmation_request_reply, hci_stack->gap_pairing_addr);
+                hci_send_user_confirmation_request_reply(hci_stack->gap_pairing_addr);
                 break;
             case GAP_PAIRING_STATE_SEND_CONFIRMATION_NEGATIVE:
-                hci_send_cmd(&hci_user_confirmation_request_negative_reply, hci_stack->gap_pairing_addr);
+                hci_send_user_confirmation_request_negative_reply(hci_stack->gap_pairing_addr);
                 break;
             default:
                 break;
@@ -2864,12 +3432,12 @@ static void hci_run(void){
         switch(hci_stack->le_scanning_state){
             case LE_START_SCAN:
                 hci_stack->le_scanning_state = LE_SCANNING;
-                hci_send_cmd(&hci_le_set_scan_enable, 1, 0);
+                hci_send_le_set_scan_enable(1, 0);
                 return;
                 
             case LE_STOP_SCAN:
                 hci_stack->le_scanning_state = LE_SCAN_IDLE;
-                hci_send_cmd(&hci_le_set_scan_enable, 0, 0);
+                hci_send_le_set_scan_enable(0, 0);
                 return;
             default:
                 break;
@@ -2878,7 +3446,7 @@ static void hci_run(void){
             // defaults: active scanning, accept all advertisement packets
             int scan_type = hci_stack->le_scan_type;
             hci_stack->le_scan_type = 0xff;
-            hci_send_cmd(&hci_le_set_scan_parameters, scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window, hci_stack->le_own_addr_type, 0);
+            hci_send_le_set_scan_parameters(scan_type, hci_stack->le_scan_interval, hci_stack->le_scan_window, hci_stack->le_own_addr_type, 0);
             return;
         }
 #endif
@@ -2889,13 +3457,12 @@ static void hci_run(void){
         }
         if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_DISABLE){
             hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_DISABLE;
-            hci_send_cmd(&hci_le_set_advertise_enable, 0);
+            hci_send_le_set_advertise_enable(0);
             return;
         }
         if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_PARAMS){
             hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_PARAMS;
-            hci_send_cmd(&hci_le_set_advertising_parameters,
-                 hci_stack->le_advertisements_interval_min,
+            hci_send_le_set_advertising_parameters(hci_stack->le_advertisements_interval_min,
                  hci_stack->le_advertisements_interval_max,
                  hci_stack->le_advertisements_type,
                  hci_stack->le_own_addr_type,
@@ -2907,18 +3474,18 @@ static void hci_run(void){
         }
         if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_ADV_DATA){
             hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_ADV_DATA;
-            hci_send_cmd(&hci_le_set_advertising_data, hci_stack->le_advertisements_data_len, hci_stack->le_advertisements_data);
+            hci_send_le_set_advertising_data(hci_stack->le_advertisements_data_len, hci_stack->le_advertisements_data);
             return;
         }
         if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA){
             hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_SET_SCAN_DATA;
-            hci_send_cmd(&hci_le_set_scan_response_data, hci_stack->le_scan_response_data_len,
+            hci_send_le_set_scan_response_data(hci_stack->le_scan_response_data_len,
                 hci_stack->le_scan_response_data);
             return;
         }
         if (hci_stack->le_advertisements_todo & LE_ADVERTISEMENT_TASKS_ENABLE){
             hci_stack->le_advertisements_todo &= ~LE_ADVERTISEMENT_TASKS_ENABLE;
-            hci_send_cmd(&hci_le_set_advertise_enable, 1);
+            hci_send_le_set_advertise_enable(1);
             return;
         }
 #endif
@@ -2943,7 +3510,7 @@ static void hci_run(void){
         if (modification_pending){
             // stop connnecting if modification pending
             if (hci_stack->le_connecting_state != LE_CONNECTING_IDLE){
-                hci_send_cmd(&hci_le_create_connection_cancel);
+                hci_send_le_create_connection_cancel();
                 return;
             }
 
@@ -2953,7 +3520,7 @@ static void hci_run(void){
                 whitelist_entry_t * entry = (whitelist_entry_t*) btstack_linked_list_iterator_next(&lit);
                 if (entry->state & LE_WHITELIST_ADD_TO_CONTROLLER){
                     entry->state = LE_WHITELIST_ON_CONTROLLER;
-                    hci_send_cmd(&hci_le_add_device_to_white_list, entry->address_type, entry->address);
+                    hci_send_le_add_device_to_white_list(entry->address_type, entry->address);
                     return;
 
                 }
@@ -2963,7 +3530,7 @@ static void hci_run(void){
                     memcpy(address, entry->address, 6);
                     btstack_linked_list_remove(&hci_stack->le_whitelist, (btstack_linked_item_t *) entry);
                     btstack_memory_whitelist_entry_free(entry);
-                    hci_send_cmd(&hci_le_remove_device_from_white_list, address_type, address);
+                    hci_send_le_remove_device_from_white_list(address_type, address);
                     return;
                 }
             }
@@ -2974,8 +3541,7 @@ static void hci_run(void){
             !btstack_linked_list_empty(&hci_stack->le_whitelist)){
             bd_addr_t null_addr;
             memset(null_addr, 0, 6);
-            hci_send_cmd(&hci_le_create_connection,
-                 0x0060,    // scan interval: 60 ms
+            hci_send_le_create_connection(0x0060,    // scan interval: 60 ms
                  0x0030,    // scan interval: 30 ms
                  1,         // use whitelist
                  0,         // peer address type
@@ -2995,8 +3561,9 @@ static void hci_run(void){
 #endif
     
     // send pending HCI commands
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
         hci_connection_t * connection = (hci_connection_t *) it;
+        if (!hci_connection_on_selected_controller(connection)) continue;
         
         switch(connection->state){
             case SEND_CREATE_CONNECTION:
@@ -3004,15 +3571,14 @@ static void hci_run(void){
 #ifdef ENABLE_CLASSIC
                     case BD_ADDR_TYPE_CLASSIC:
                         log_info("sending hci_create_connection");
-                        hci_send_cmd(&hci_create_connection, connection->address, hci_usable_acl_packet_types(), 0, 0, 0, 1);
+                        hci_send_create_connection(connection->address, hci_usable_acl_packet_types(), 0, 0, 0, 1);
                         break;
 #endif
                     default:
 #ifdef ENABLE_BLE
 #ifdef ENABLE_LE_CENTRAL
                         log_info("sending hci_le_create_connection");
-                        hci_send_cmd(&hci_le_create_connection,
-                                     0x0060,    // scan interval: 60 ms
+                        hci_send_le_create_connection(0x0060,    // scan interval: 60 ms
                                      0x0030,    // scan interval: 30 ms
                                      0,         // don't use whitelist
                                      connection->address_type, // peer address type
@@ -3039,7 +3605,7 @@ static void hci_run(void){
                 connection->state = ACCEPTED_CONNECTION_REQUEST;
                 connection->role  = HCI_ROLE_SLAVE;
                 if (connection->address_type == BD_ADDR_TYPE_CLASSIC){
-                    hci_send_cmd(&hci_accept_connection_request, connection->address, 1);
+                    hci_send_accept_connection_request(connection->address, 1);
                 } 
                 return;
 #endif
@@ -3048,13 +3614,13 @@ static void hci_run(void){
 #ifdef ENABLE_LE_CENTRAL
             case SEND_CANCEL_CONNECTION:
                 connection->state = SENT_CANCEL_CONNECTION;
-                hci_send_cmd(&hci_le_create_connection_cancel);
+                hci_send_le_create_connection_cancel();
                 return;
 #endif
 #endif                
             case SEND_DISCONNECT:
                 connection->state = SENT_DISCONNECT;
-                hci_send_cmd(&hci_disconnect, connection->con_handle, 0x13); // remote closed connection
+                hci_send_disconnect(connection->con_handle, 0x13); // remote closed connection
                 return;
                 
             default:
@@ -3067,13 +3633,13 @@ static void hci_run(void){
             connectionClearAuthenticationFlags(connection, HANDLE_LINK_KEY_REQUEST);
             link_key_t link_key;
             link_key_type_t link_key_type;
-            if ( hci_stack->link_key_db
-              && hci_stack->link_key_db->get_link_key(connection->address, link_key, &link_key_type)
+            if ( hci_host->link_key_db
+              && hci_host->link_key_db->get_link_key(connection->address, link_key, &link_key_type)
               && gap_security_level_for_link_key_type(link_key_type) >= connection->requested_security_level){
                connection->link_key_type = link_key_type;
-               hci_send_cmd(&hci_link_key_request_reply, connection->address, &link_key);
+               hci_send_link_key_request_reply(connection->address, link_key);
             } else {
-               hci_send_cmd(&hci_link_key_request_negative_reply, connection->address);
+               hci_send_link_key_request_negative_reply(connection->address);
             }
             return;
         }
@@ -3081,7 +3647,7 @@ static void hci_run(void){
         if (connection->authentication_flags & DENY_PIN_CODE_REQUEST){
             log_info("denying to pin request");
             connectionClearAuthenticationFlags(connection, DENY_PIN_CODE_REQUEST);
-            hci_send_cmd(&hci_pin_code_request_negative_reply, connection->address);
+            hci_send_pin_code_request_negative_reply(connection->address);
             return;
         }
 
@@ -3097,54 +3663,54 @@ static void hci_run(void){
                 if (gap_mitm_protection_required_for_security_level(connection->requested_security_level)){
                     authreq |= 1;
                 } 
-                hci_send_cmd(&hci_io_capability_request_reply, &connection->address, hci_stack->ssp_io_capability, NULL, authreq);
+                hci_send_io_capability_request_reply(connection->address, hci_stack->ssp_io_capability, 0, authreq);
             } else {
-                hci_send_cmd(&hci_io_capability_request_negative_reply, &connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED);
+                hci_send_io_capability_request_negative_reply(connection->address, ERROR_CODE_PAIRING_NOT_ALLOWED);
             }
             return;
         }
         
         if (connection->authentication_flags & SEND_USER_CONFIRM_REPLY){
             connectionClearAuthenticationFlags(connection, SEND_USER_CONFIRM_REPLY);
-            hci_send_cmd(&hci_user_confirmation_request_reply, &connection->address);
+            hci_send_user_confirmation_request_reply(connection->address);
             return;
         }
 
         if (connection->authentication_flags & SEND_USER_PASSKEY_REPLY){
             connectionClearAuthenticationFlags(connection, SEND_USER_PASSKEY_REPLY);
-            hci_send_cmd(&hci_user_passkey_request_reply, &connection->address, 000000);
+            hci_send_user_passkey_request_reply(connection->address, 000000);
             return;
         }
 
         if (connection->bonding_flags & BONDING_REQUEST_REMOTE_FEATURES){
             connection->bonding_flags &= ~BONDING_REQUEST_REMOTE_FEATURES;
-            hci_send_cmd(&hci_read_remote_supported_features_command, connection->con_handle);
+            hci_send_read_remote_supported_features_command(connection->con_handle);
             return;
         }
 
         if (connection->bonding_flags & BONDING_DISCONNECT_DEDICATED_DONE){
             connection->bonding_flags &= ~BONDING_DISCONNECT_DEDICATED_DONE;
             connection->bonding_flags |= BONDING_EMIT_COMPLETE_ON_DISCONNECT;
-            hci_send_cmd(&hci_disconnect, connection->con_handle, 0x13);  // authentication done
+            hci_send_disconnect(connection->con_handle, 0x13);  // authentication done
             return;
         }
 
         if (connection->bonding_flags & BONDING_SEND_AUTHENTICATE_REQUEST){
             connection->bonding_flags &= ~BONDING_SEND_AUTHENTICATE_REQUEST;
-            hci_send_cmd(&hci_authentication_requested, connection->con_handle);
+            hci_send_authentication_requested(connection->con_handle);
             return;
         }
 
         if (connection->bonding_flags & BONDING_SEND_ENCRYPTION_REQUEST){
             connection->bonding_flags &= ~BONDING_SEND_ENCRYPTION_REQUEST;
-            hci_send_cmd(&hci_set_connection_encryption, connection->con_handle, 1);
+            hci_send_set_connection_encryption(connection->con_handle, 1);
             return;
         }
 #endif
 
         if (connection->bonding_flags & BONDING_DISCONNECT_SECURITY_BLOCK){
             connection->bonding_flags &= ~BONDING_DISCONNECT_SECURITY_BLOCK;
-            hci_send_cmd(&hci_disconnect, connection->con_handle, 0x0005);  // authentication failure
+            hci_send_disconnect(connection->con_handle, 0x0005);  // authentication failure
             return;
         }
 
@@ -3154,7 +3720,7 @@ static void hci_run(void){
             
             uint16_t connection_interval_min = connection->le_conn_interval_min;
             connection->le_conn_interval_min = 0;
-            hci_send_cmd(&hci_le_connection_update, connection->con_handle, connection_interval_min,
+            hci_send_le_connection_update(connection->con_handle, connection_interval_min,
                 connection->le_conn_interval_max, connection->le_conn_latency, connection->le_supervision_timeout,
                 0x0000, 0xffff);
         }
@@ -3186,7 +3752,7 @@ static void hci_run(void){
 #endif
 #endif
             // close all open connections
-            connection =  (hci_connection_t *) hci_stack->connections;
+            connection = hci_first_connection_on_selected_controller();
             if (connection){
                 hci_con_handle_t con_handle = (uint16_t) connection->con_handle;
                 if (!hci_can_send_command_packet_now()) return;
@@ -3200,7 +3766,7 @@ static void hci_run(void){
                 hci_shutdown_connection(connection);
 
                 // finally, send the disconnect command
-                hci_send_cmd(&hci_disconnect, con_handle, 0x13);  // remote closed connection
+                hci_send_disconnect(con_handle, 0x13);  // remote closed connection
                 return;
             }
             log_info("HCI_STATE_HALTING, calling off");
@@ -3218,7 +3784,7 @@ static void hci_run(void){
                 case HCI_FALLING_ASLEEP_DISCONNECT:
                     log_info("HCI_STATE_FALLING_ASLEEP");
                     // close all open connections
-                    connection =  (hci_connection_t *) hci_stack->connections;
+                    connection = hci_first_connection_on_selected_controller();
 
 #ifdef HAVE_PLATFORM_IPHONE_OS
                     // don't close connections, if H4 supports power management
@@ -3232,7 +3798,7 @@ static void hci_run(void){
                         if (!hci_can_send_command_packet_now()) return;
 
                         log_info("HCI_STATE_FALLING_ASLEEP, connection %p, handle %u", connection, (uint16_t)connection->con_handle);
-                        hci_send_cmd(&hci_disconnect, connection->con_handle, 0x13);  // remote closed connection
+                        hci_send_disconnect(connection->con_handle, 0x13);  // remote closed connection
                         
                         // send disconnected event right away - causes higher layer connections to get closed, too.
                         hci_shutdown_connection(connection);
@@ -3244,7 +3810,7 @@ static void hci_run(void){
                         if (!hci_can_send_command_packet_now()) return;
                         
                         log_info("HCI_STATE_HALTING, disabling inq scans");
-                        hci_send_cmd(&hci_write_scan_enable, hci_stack->connectable << 1); // drop inquiry scan but keep page scan
+                        hci_send_write_scan_enable(hci_stack->connectable << 1); // drop inquiry scan but keep page scan
                         
                         // continue in next sub state
                         hci_stack->substate = HCI_FALLING_ASLEEP_W4_WRITE_SCAN_ENABLE;
@@ -3278,7 +3844,27 @@ static void hci_run(void){
     }
 }
 
-int hci_send_cmd_packet(uint8_t *packet, int size){
+static void hci_run(void){
+
+    // log_info("hci_run: entered");
+
+    // send continuation fragments first, as they block the prepared packet buffer
+    if (hci_run_acl_fragments()) return;
+
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    int selected_controller = hci_controller_index;
+    int i;
+    for (i = 0; i < hci_num_controllers; i++){
+        hci_controller_select_index(i);
+        hci_run_controller();
+    }
+    hci_controller_select_index(selected_controller);
+#else
+    hci_run_controller();
+#endif
+}
+
+static int hci_send_cmd_packet_on_controller(uint8_t *packet, int size){
     // house-keeping
     
     if (IS_COMMAND(packet, hci_write_loopback_mode)){
@@ -3294,7 +3880,7 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
         reverse_bd_addr(&packet[3], addr);
         log_info("Create_connection to %s", bd_addr_to_str(addr));
 
-        conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+        conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
         if (!conn){
             conn = create_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
             if (!conn){
@@ -3329,16 +3915,16 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
     }
     
     if (IS_COMMAND(packet, hci_delete_stored_link_key)){
-        if (hci_stack->link_key_db){
+        if (hci_host->link_key_db){
             reverse_bd_addr(&packet[3], addr);
-            hci_stack->link_key_db->delete_link_key(addr);
+            hci_host->link_key_db->delete_link_key(addr);
         }
     }
 
     if (IS_COMMAND(packet, hci_pin_code_request_negative_reply)
     ||  IS_COMMAND(packet, hci_pin_code_request_reply)){
         reverse_bd_addr(&packet[3], addr);
-        conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+        conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
         if (conn){
             connectionClearAuthenticationFlags(conn, LEGACY_PAIRING_ACTIVE);
         }
@@ -3349,7 +3935,7 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
     ||  IS_COMMAND(packet, hci_user_passkey_request_negative_reply)
     ||  IS_COMMAND(packet, hci_user_passkey_request_reply)) {
         reverse_bd_addr(&packet[3], addr);
-        conn = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+        conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
         if (conn){
             connectionClearAuthenticationFlags(conn, SSP_PAIRING_ACTIVE);
         }
@@ -3405,16 +3991,34 @@ int hci_send_cmd_packet(uint8_t *packet, int size){
     hci_stack->num_cmd_packets--;
 
     hci_dump_packet(HCI_COMMAND_DATA_PACKET, 0, packet, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // command reserved for connection: con handle follows opcode and length
+    if (hci_command_previous_controller >= 0 && packet == hci_host->hci_packet_buffer){
+        hci_controller_store_controller_con_handle(packet, 3);
+    }
+#endif
     int err = hci_stack->hci_transport->send_packet(HCI_COMMAND_DATA_PACKET, packet, size);
 
     // release packet buffer for synchronous transport implementations    
-    if (hci_transport_synchronous() && (packet == hci_stack->hci_packet_buffer)){
-        hci_stack->hci_packet_buffer_reserved = 0;
+    if (hci_transport_synchronous() && (packet == hci_host->hci_packet_buffer)){
+        hci_host->hci_packet_buffer_reserved = 0;
     }
 
     return err;
 }
 
+int hci_send_cmd_packet(uint8_t *packet, int size){
+    int err = hci_send_cmd_packet_on_controller(packet, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // return to controller selected before hci_reserve_command_packet_buffer_for_con_handle
+    if (hci_command_previous_controller >= 0){
+        hci_controller_select_index(hci_command_previous_controller);
+        hci_command_previous_controller = -1;
+    }
+#endif
+    return err;
+}
+
 // disconnect because of security block
 void hci_disconnect_security_block(hci_con_handle_t con_handle){
     hci_connection_t * connection = hci_connection_for_handle(con_handle);
@@ -3432,8 +4036,8 @@ void gap_ssp_set_enable(int enable){
     hci_stack->ssp_enable = enable;
 }
 
-static int hci_local_ssp_activated(void){
-    return gap_ssp_supported() && hci_stack->ssp_enable;
+static int hci_local_ssp_activated(hci_stack_t * stack){
+    return gap_ssp_supported(stack) && stack->ssp_enable;
 }
 
 // if set, BTstack will respond to io capability request using authentication requirement
@@ -3450,19 +4054,65 @@ void gap_ssp_set_auto_accept(int auto_accept){
 }
 #endif
 
-// va_list part of hci_send_cmd
-int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argptr){
+// reserve outgoing packet buffer for command with given opcode, used by hci_send_cmd and hci_cmd_builder.h
+uint8_t * hci_reserve_command_packet_buffer(uint16_t opcode){
     if (!hci_can_send_command_packet_now()){ 
         log_error("hci_send_cmd called but cannot send packet now");
-        return 0;
+        return NULL;
     }
 
     // for HCI INITIALIZATION
-    // log_info("hci_send_cmd: opcode %04x", cmd->opcode);
-    hci_stack->last_cmd_opcode = cmd->opcode;
+    // log_info("hci_send_cmd: opcode %04x", opcode);
+    hci_stack->last_cmd_opcode = opcode;
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    hci_controllers[hci_controller_index].command_con_handle = HCI_CON_HANDLE_INVALID;
+#endif
 
     hci_reserve_packet_buffer();
-    uint8_t * packet = hci_stack->hci_packet_buffer;
+    return hci_host->hci_packet_buffer;
+}
+
+// reserve outgoing packet buffer for command that starts with a connection handle
+// with multiple controllers, the controller of the connection is selected until the command was sent
+uint8_t * hci_reserve_command_packet_buffer_for_con_handle(uint16_t opcode, hci_con_handle_t con_handle){
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    int previous_controller = hci_controller_index;
+    int controller = hci_get_controller_for_con_handle(con_handle);
+    if (controller >= 0){
+        hci_controller_select_index(controller);
+    }
+    uint8_t * packet = hci_reserve_command_packet_buffer(opcode);
+    if (!packet){
+        hci_controller_select_index(previous_controller);
+        return NULL;
+    }
+    hci_controllers[hci_controller_index].command_con_handle = con_handle;
+    hci_command_previous_controller = previous_controller;
+    return packet;
+#else
+    UNUSED(con_handle);
+    return hci_reserve_command_packet_buffer(opcode);
+#endif
+}
+
+// va_list part of hci_send_cmd
+int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argptr){
+    uint8_t * packet;
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    if (cmd->format[0] == 'H'){
+        // peek at con handle to find controller
+        va_list argptr_con_handle;
+        va_copy(argptr_con_handle, argptr);
+        hci_con_handle_t con_handle = va_arg(argptr_con_handle, int);
+        va_end(argptr_con_handle);
+        packet = hci_reserve_command_packet_buffer_for_con_handle(cmd->opcode, con_handle);
+    } else {
+        packet = hci_reserve_command_packet_buffer(cmd->opcode);
+    }
+#else
+    packet = hci_reserve_command_packet_buffer(cmd->opcode);
+#endif
+    if (!packet) return 0;
     uint16_t size = hci_cmd_create_from_template(packet, cmd, argptr);
     return hci_send_cmd_packet(packet, size);
 }
@@ -3487,18 +4137,34 @@ static void hci_emit_event(uint8_t * event, uint16_t size, int dump){
         hci_dump_packet( HCI_EVENT_PACKET, 0, event, size);
     } 
 
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // handlers might select another controller
+    int controller = hci_controller_index;
+#endif
+
     // dispatch to all event handlers
     btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->event_handlers);
+    btstack_linked_list_iterator_init(&it, &hci_host->event_handlers);
     while (btstack_linked_list_iterator_has_next(&it)){
         btstack_packet_callback_registration_t * entry = (btstack_packet_callback_registration_t*) btstack_linked_list_iterator_next(&it);
+        // skip handlers not interested in this event
+        if (entry->event_mask && !btstack_event_mask_matches(entry->event_mask, event)) continue;
         entry->callback(HCI_EVENT_PACKET, 0, event, size);
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+        hci_controller_select_index(controller);
+#endif
     }
 }
 
 static void hci_emit_acl_packet(uint8_t * packet, uint16_t size){
-    if (!hci_stack->acl_packet_handler) return;
-    hci_stack->acl_packet_handler(HCI_ACL_DATA_PACKET, 0, packet, size);
+    if (!hci_host->acl_packet_handler) return;
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    int controller = hci_controller_index;
+    hci_host->acl_packet_handler(HCI_ACL_DATA_PACKET, 0, packet, size);
+    hci_controller_select_index(controller);
+#else
+    hci_host->acl_packet_handler(HCI_ACL_DATA_PACKET, 0, packet, size);
+#endif
 }
 
 #ifdef ENABLE_CLASSIC
@@ -3509,7 +4175,7 @@ static void hci_notify_if_sco_can_send_now(void){
         hci_stack->sco_waiting_for_can_send_now = 0;
         uint8_t event[2] = { HCI_EVENT_SCO_CAN_SEND_NOW, 0 };
         hci_dump_packet(HCI_EVENT_PACKET, 1, event, sizeof(event));
-        hci_stack->sco_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+        hci_host->sco_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
     }
 }
 
@@ -3724,7 +4390,7 @@ int hci_remote_ssp_supported(hci_con_handle_t con_handle){
 }
 
 int gap_ssp_supported_on_both_sides(hci_con_handle_t handle){
-    return hci_local_ssp_activated() && hci_remote_ssp_supported(handle);
+    return hci_local_ssp_activated(hci_stack_for_con_handle(handle)) && hci_remote_ssp_supported(handle);
 }
 #endif
 
@@ -3797,10 +4463,10 @@ void gap_request_security_level(hci_con_handle_t con_handle, gap_security_level_
     // TODO: figure out how to use it properly
 
     // would enabling ecnryption suffice (>= LEVEL_2)?
-    if (hci_stack->link_key_db){
+    if (hci_host->link_key_db){
         link_key_type_t link_key_type;
         link_key_t      link_key;
-        if (hci_stack->link_key_db->get_link_key( &connection->address, &link_key, &link_key_type)){
+        if (hci_host->link_key_db->get_link_key( &connection->address, &link_key, &link_key_type)){
             if (gap_security_level_for_link_key_type(link_key_type) >= requested_level){
                 connection->bonding_flags |= BONDING_SEND_ENCRYPTION_REQUEST;
                 return;
@@ -3878,7 +4544,7 @@ void gap_set_scan_parameters(uint8_t scan_type, uint16_t scan_interval, uint16_t
 }
 
 uint8_t gap_connect(bd_addr_t addr, bd_addr_type_t addr_type){
-    hci_connection_t * conn = hci_connection_for_bd_addr_and_type(addr, addr_type);
+    hci_connection_t * conn = hci_connection_on_selected_controller_for_bd_addr_and_type(addr, addr_type);
     if (!conn){
         log_info("gap_connect: no connection exists yet, creating context");
         conn = create_connection_for_bd_addr_and_type(addr, addr_type);
@@ -3911,9 +4577,10 @@ uint8_t gap_connect(bd_addr_t addr, bd_addr_type_t addr_type){
 // @assumption: only a single outgoing LE Connection exists
 static hci_connection_t * gap_get_outgoing_connection(void){
     btstack_linked_item_t *it;
-    for (it = (btstack_linked_item_t *) hci_stack->connections; it ; it = it->next){
+    for (it = (btstack_linked_item_t *) hci_host->connections; it ; it = it->next){
         hci_connection_t * conn = (hci_connection_t *) it;
         if (!hci_is_le_connection(conn)) continue;
+        if (!hci_connection_on_selected_controller(conn)) continue;
         switch (conn->state){
             case SEND_CREATE_CONNECTION:
             case SENT_CREATE_CONNECTION:
@@ -3932,7 +4599,7 @@ uint8_t gap_connect_cancel(void){
         case SEND_CREATE_CONNECTION:
             // skip sending create connection and emit event instead
             hci_emit_le_connection_complete(conn->address_type, conn->address, 0, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
-            btstack_linked_list_remove(&hci_stack->connections, (btstack_linked_item_t *) conn);
+            btstack_linked_list_remove(&hci_host->connections, (btstack_linked_item_t *) conn);
             btstack_memory_hci_connection_free( conn );
             break;            
         case SENT_CREATE_CONNECTION:
@@ -4258,9 +4925,17 @@ int gap_remote_name_request(bd_addr_t addr, uint8_t page_scan_repetition_mode, u
     return 0;
 }
 
-static int gap_pairing_set_state_and_run(bd_addr_t addr, uint8_t state){
-    hci_stack->gap_pairing_state = state;
-    memcpy(hci_stack->gap_pairing_addr, addr, 6);
+// stack of the controller connected to addr, selected controller if not connected
+static hci_stack_t * hci_stack_for_bd_addr(bd_addr_t addr){
+    hci_connection_t * connection = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_CLASSIC);
+    if (!connection) return hci_stack;
+    return hci_stack_for_connection(connection);
+}
+
+static int gap_pairing_set_state_and_run(hci_stack_t * stack, bd_addr_t addr, uint8_t state){
+    if (stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
+    stack->gap_pairing_state = state;
+    memcpy(stack->gap_pairing_addr, addr, 6);
     hci_run();
     return 0;
 }
@@ -4272,9 +4947,10 @@ static int gap_pairing_set_state_and_run(bd_addr_t addr, uint8_t state){
  * @return 0 if ok
  */
 int gap_pin_code_response(bd_addr_t addr, const char * pin){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    hci_stack->gap_pairing_pin = pin;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_PIN);
+    hci_stack_t * stack = hci_stack_for_bd_addr(addr);
+    if (stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
+    stack->gap_pairing_pin = pin;
+    return gap_pairing_set_state_and_run(stack, addr, GAP_PAIRING_STATE_SEND_PIN);
 }
 
 /**
@@ -4284,8 +4960,7 @@ int gap_pin_code_response(bd_addr_t addr, const char * pin){
  * @return 0 if ok
  */
 int gap_pin_code_negative(bd_addr_t addr){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_PIN_NEGATIVE);
+    return gap_pairing_set_state_and_run(hci_stack_for_bd_addr(addr), addr, GAP_PAIRING_STATE_SEND_PIN_NEGATIVE);
 }
 
 /**
@@ -4295,9 +4970,10 @@ int gap_pin_code_negative(bd_addr_t addr){
  * @return 0 if ok
  */
 int gap_ssp_passkey_response(bd_addr_t addr, uint32_t passkey){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    hci_stack->gap_pairing_passkey = passkey;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_PASSKEY);
+    hci_stack_t * stack = hci_stack_for_bd_addr(addr);
+    if (stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
+    stack->gap_pairing_passkey = passkey;
+    return gap_pairing_set_state_and_run(stack, addr, GAP_PAIRING_STATE_SEND_PASSKEY);
 }
 
 /**
@@ -4307,8 +4983,7 @@ int gap_ssp_passkey_response(bd_addr_t addr, uint32_t passkey){
  * @return 0 if ok
  */
 int gap_ssp_passkey_negative(bd_addr_t addr){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_PASSKEY_NEGATIVE);
+    return gap_pairing_set_state_and_run(hci_stack_for_bd_addr(addr), addr, GAP_PAIRING_STATE_SEND_PASSKEY_NEGATIVE);
 }
 
 /**
@@ -4318,8 +4993,7 @@ int gap_ssp_passkey_negative(bd_addr_t addr){
  * @return 0 if ok
  */
 int gap_ssp_confirmation_response(bd_addr_t addr){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_CONFIRMATION);
+    return gap_pairing_set_state_and_run(hci_stack_for_bd_addr(addr), addr, GAP_PAIRING_STATE_SEND_CONFIRMATION);
 }
 
 /**
@@ -4329,8 +5003,7 @@ int gap_ssp_confirmation_response(bd_addr_t addr){
  * @return 0 if ok
  */
 int gap_ssp_confirmation_negative(bd_addr_t addr){
-    if (hci_stack->gap_pairing_state != GAP_INQUIRY_STATE_IDLE) return ERROR_CODE_COMMAND_DISALLOWED;
-    return gap_pairing_set_state_and_run(addr, GAP_PAIRING_STATE_SEND_CONFIRMATION_NEGATIVE);
+    return gap_pairing_set_state_and_run(hci_stack_for_bd_addr(addr), addr, GAP_PAIRING_STATE_SEND_CONFIRMATION_NEGATIVE);
 }
 
 /**
@@ -4371,12 +5044,12 @@ int hci_get_sco_packet_length(void){
  * @brief Set callback for Bluetooth Hardware Error
  */
 void hci_set_hardware_error_callback(void (*fn)(uint8_t error)){
-    hci_stack->hardware_error_callback = fn;
+    hci_host->hardware_error_callback = fn;
 }
 
 void hci_disconnect_all(void){
     btstack_linked_list_iterator_t it;
-    btstack_linked_list_iterator_init(&it, &hci_stack->connections);
+    btstack_linked_list_iterator_init(&it, &hci_host->connections);
     while (btstack_linked_list_iterator_has_next(&it)){
         hci_connection_t * con = (hci_connection_t*) btstack_linked_list_iterator_next(&it);
         if (con->state == SENT_DISCONNECT) continue;
@@ -124,6 +124,20 @@ extern "C" {
 #endif
 #endif
 
+// Multiple Bluetooth Controllers sharing L2CAP and higher layers
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+#ifndef MAX_NR_HCI_CONTROLLERS
+#define MAX_NR_HCI_CONTROLLERS 2
+#endif
+#if MAX_NR_HCI_CONTROLLERS > 4
+#error "MAX_NR_HCI_CONTROLLERS > 4 not supported"
+#endif
+// connections per controller, incl. SCO connections
+#ifndef MAX_NR_HCI_CONTROLLER_CONNECTIONS
+#define MAX_NR_HCI_CONTROLLER_CONNECTIONS 16
+#endif
+#endif
+
 // 
 #define IS_COMMAND(packet, command) (little_endian_read_16(packet,0) == command.opcode)
 
@@ -351,6 +365,7 @@ typedef enum {
     SM_SC_W4_PAIRING_RANDOM,
     SM_SC_W2_CALCULATE_G2,
     SM_SC_W4_CALCULATE_G2,
+    SM_SC_W4_CALCULATE_DHKEY,
     SM_SC_W2_CALCULATE_F5_SALT,
     SM_SC_W4_CALCULATE_F5_SALT,
     SM_SC_W2_CALCULATE_F5_MACKEY,
@@ -465,6 +480,11 @@ typedef struct {
 
     // connection state
     CONNECTION_STATE state;
+
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+    // index of controller that handles this connection
+    uint8_t controller;
+#endif
     
     // bonding
     uint16_t bonding_flags;
@@ -688,6 +708,7 @@ typedef struct {
     uint8_t   hci_packet_buffer_reserved;
     uint16_t  acl_fragmentation_pos;
     uint16_t  acl_fragmentation_total_size;
+    hci_con_handle_t acl_fragmentation_con_handle;
      
     /* host to controller flow control */
     uint8_t  num_cmd_packets;
@@ -876,12 +897,52 @@ int  hci_power_control(HCI_POWER_MODE mode);
  */
 void hci_close(void);
 
+#ifdef ENABLE_HCI_MULTIPLE_CONTROLLERS
+
+/**
+ * @brief Add Bluetooth Controller that shares L2CAP and higher layers with the controller passed to hci_init
+ * @note Connection handles reported to higher layers are unique across all controllers
+ * @param transport
+ * @param config
+ * @return controller index or -1 if MAX_NR_HCI_CONTROLLERS reached
+ */
+int hci_add_controller(const hci_transport_t *transport, const void *config);
+
+/**
+ * @brief Select controller for HCI and GAP functions without connection handle, e.g. hci_power_control or gap_advertisements_enable
+ * @note While an event is delivered, the controller that caused it is selected
+ * @param controller index, 0 = controller passed to hci_init
+ */
+void hci_select_controller(int controller);
+
+/**
+ * @brief Get selected controller
+ * @return controller index
+ */
+int hci_get_controller(void);
+
+/**
+ * @brief Get controller for connection
+ * @param con_handle
+ * @return controller index or -1 if connection unknown
+ */
+int hci_get_controller_for_con_handle(hci_con_handle_t con_handle);
+
+/**
+ * @brief Get number of controllers
+ * @return number of controllers
+ */
+int hci_get_num_controllers(void);
+
+#endif
+
 
 // Callback registration
 
 
 /**
  * @brief Add event packet handler. 
+ * @note If callback_handler->event_mask is set, only events contained in the mask are delivered
  */
 void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler);
 
@@ -969,6 +1030,18 @@ void hci_release_packet_buffer(void);
  */
 int hci_send_cmd_va_arg(const hci_cmd_t *cmd, va_list argtr);
 
+/**
+ * Reserve outgoing packet buffer for HCI Command with given opcode. Used by hci_cmd_builder.h
+ * @return packet buffer or NULL if command cannot be sent now
+ */
+uint8_t * hci_reserve_command_packet_buffer(uint16_t opcode);
+
+/**
+ * Reserve outgoing packet buffer for HCI Command with connection handle as first parameter. Used by hci_cmd_builder.h
+ * @return packet buffer or NULL if command cannot be sent now
+ */
+uint8_t * hci_reserve_command_packet_buffer_for_con_handle(uint16_t opcode, hci_con_handle_t con_handle);
+
 /**
  * Get connection iterator. Only used by l2cap.c and sm.c
  */
@@ -981,6 +1054,7 @@ hci_connection_t * hci_connection_for_handle(hci_con_handle_t con_handle);
 
 /**
  * Get internal hci_connection_t for given Bluetooth addres. Called by L2CAP
+ * @note with ENABLE_HCI_MULTIPLE_CONTROLLERS, a connection on the selected controller is preferred
  */
 hci_connection_t * hci_connection_for_bd_addr_and_type(bd_addr_t addr, bd_addr_type_t addr_type);
 
@@ -1025,6 +1099,11 @@ int hci_authentication_active_for_handle(hci_con_handle_t handle);
  */
 uint16_t hci_max_acl_data_packet_length(void);
 
+/**
+ * Get maximal ACL Classic data packet length of the controller of the given connection. Called by L2CAP
+ */
+uint16_t hci_max_acl_data_packet_length_for_con_handle(hci_con_handle_t con_handle);
+
 /**
  * Get supported packet types. Called by L2CAP
  */
@@ -1035,6 +1114,11 @@ uint16_t hci_usable_acl_packet_types(void);
  */
 int hci_non_flushable_packet_boundary_flag_supported(void);
 
+/**
+ * Check if ACL packets marked as non flushable can be sent on the given connection. Called by L2CAP
+ */
+int hci_non_flushable_packet_boundary_flag_supported_for_con_handle(hci_con_handle_t con_handle);
+
 /**
  * Check if extended SCO Link is supported
  */
@@ -206,6 +206,8 @@ extern const hci_cmd_t hci_bcm_write_sco_pcm_int;
  *   P: 16 byte Pairing code
  *   A: 31 bytes advertising data
  *   S: Service Record (Data Element Sequence)
+ *
+ * @note hci_cmd_builder.h provides typed builders generated from the templates in hci_cmd.c
  */
  uint16_t hci_cmd_create_from_template(uint8_t *hci_cmd_buffer, const hci_cmd_t *cmd, va_list argptr);
 
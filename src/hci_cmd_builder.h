@@ -0,0 +1,3041 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  hci_cmd_builder.h
+ *
+ *  @brief Typed HCI Command builders
+ *  @note  Don't edit - generated by tool/btstack_hci_cmd_generator.py
+ *
+ *  For each HCI Command in hci_cmd.c, hci_<command>_create() stores the command
+ *  into a buffer without interpreting the format string of the hci_cmd_t template,
+ *  and hci_send_<command>() builds it directly in the outgoing HCI packet buffer.
+ *  The result is identical to hci_send_cmd(&hci_<command>, ...).
+ */
+
+#ifndef __HCI_CMD_BUILDER_H
+#define __HCI_CMD_BUILDER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include "btstack_util.h"
+#include "hci.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* API_START */
+
+/**
+ * @brief Create hci_inquiry
+ * @param hci_cmd_buffer
+ * @param lap
+ * @param inquiry_length
+ * @param num_responses
+ * @return size of HCI Command
+ * @note: btstack_type 311
+ */
+static inline uint16_t hci_inquiry_create(uint8_t * hci_cmd_buffer, uint32_t lap, uint8_t inquiry_length, uint8_t num_responses){
+    hci_cmd_buffer[0] = 0x01;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 5;
+    hci_cmd_buffer[3] = lap;
+    little_endian_store_16(hci_cmd_buffer, 4, lap >> 8);
+    hci_cmd_buffer[6] = inquiry_length;
+    hci_cmd_buffer[7] = num_responses;
+    return 8;
+}
+
+/**
+ * @brief Send hci_inquiry
+ * @return status
+ */
+static inline int hci_send_inquiry(uint32_t lap, uint8_t inquiry_length, uint8_t num_responses){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0401);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_inquiry_create(hci_cmd_buffer, lap, inquiry_length, num_responses);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_inquiry_cancel
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_inquiry_cancel_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x02;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_inquiry_cancel
+ * @return status
+ */
+static inline int hci_send_inquiry_cancel(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0402);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_inquiry_cancel_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_create_connection
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param packet_type
+ * @param page_scan_repetition_mode
+ * @param reserved
+ * @param clock_offset
+ * @param allow_role_switch
+ * @return size of HCI Command
+ * @note: btstack_type B21121
+ */
+static inline uint16_t hci_create_connection_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint16_t packet_type, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset, uint8_t allow_role_switch){
+    hci_cmd_buffer[0] = 0x05;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 13;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_16(hci_cmd_buffer, 9, packet_type);
+    hci_cmd_buffer[11] = page_scan_repetition_mode;
+    hci_cmd_buffer[12] = reserved;
+    little_endian_store_16(hci_cmd_buffer, 13, clock_offset);
+    hci_cmd_buffer[15] = allow_role_switch;
+    return 16;
+}
+
+/**
+ * @brief Send hci_create_connection
+ * @return status
+ */
+static inline int hci_send_create_connection(const bd_addr_t bd_addr, uint16_t packet_type, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset, uint8_t allow_role_switch){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0405);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_create_connection_create(hci_cmd_buffer, bd_addr, packet_type, page_scan_repetition_mode, reserved, clock_offset, allow_role_switch);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_disconnect
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_disconnect_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t reason){
+    hci_cmd_buffer[0] = 0x06;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = reason;
+    return 6;
+}
+
+/**
+ * @brief Send hci_disconnect
+ * @return status
+ */
+static inline int hci_send_disconnect(hci_con_handle_t handle, uint8_t reason){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0406, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_disconnect_create(hci_cmd_buffer, handle, reason);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_create_connection_cancel
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_create_connection_cancel_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x08;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_create_connection_cancel
+ * @return status
+ */
+static inline int hci_send_create_connection_cancel(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0408);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_create_connection_cancel_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_accept_connection_request
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param role
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_accept_connection_request_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t role){
+    hci_cmd_buffer[0] = 0x09;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = role;
+    return 10;
+}
+
+/**
+ * @brief Send hci_accept_connection_request
+ * @return status
+ */
+static inline int hci_send_accept_connection_request(const bd_addr_t bd_addr, uint8_t role){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0409);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_accept_connection_request_create(hci_cmd_buffer, bd_addr, role);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_reject_connection_request
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_reject_connection_request_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t reason){
+    hci_cmd_buffer[0] = 0x0a;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = reason;
+    return 10;
+}
+
+/**
+ * @brief Send hci_reject_connection_request
+ * @return status
+ */
+static inline int hci_send_reject_connection_request(const bd_addr_t bd_addr, uint8_t reason){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x040a);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_reject_connection_request_create(hci_cmd_buffer, bd_addr, reason);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_link_key_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param link_key
+ * @return size of HCI Command
+ * @note: btstack_type BP
+ */
+static inline uint16_t hci_link_key_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, const uint8_t * link_key){
+    hci_cmd_buffer[0] = 0x0b;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 22;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    memcpy(&hci_cmd_buffer[9], link_key, 16);
+    return 25;
+}
+
+/**
+ * @brief Send hci_link_key_request_reply
+ * @return status
+ */
+static inline int hci_send_link_key_request_reply(const bd_addr_t bd_addr, const uint8_t * link_key){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x040b);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_link_key_request_reply_create(hci_cmd_buffer, bd_addr, link_key);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_link_key_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_link_key_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x0c;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_link_key_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_link_key_request_negative_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x040c);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_link_key_request_negative_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_pin_code_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param pin_length
+ * @param pin
+ * @return size of HCI Command
+ * @note: btstack_type B1P
+ */
+static inline uint16_t hci_pin_code_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t pin_length, const uint8_t * pin){
+    hci_cmd_buffer[0] = 0x0d;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 23;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = pin_length;
+    memcpy(&hci_cmd_buffer[10], pin, 16);
+    return 26;
+}
+
+/**
+ * @brief Send hci_pin_code_request_reply
+ * @return status
+ */
+static inline int hci_send_pin_code_request_reply(const bd_addr_t bd_addr, uint8_t pin_length, const uint8_t * pin){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x040d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_pin_code_request_reply_create(hci_cmd_buffer, bd_addr, pin_length, pin);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_pin_code_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_pin_code_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x0e;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_pin_code_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_pin_code_request_negative_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x040e);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_pin_code_request_negative_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_change_connection_packet_type
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_change_connection_packet_type_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t packet_type){
+    hci_cmd_buffer[0] = 0x0f;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, packet_type);
+    return 7;
+}
+
+/**
+ * @brief Send hci_change_connection_packet_type
+ * @return status
+ */
+static inline int hci_send_change_connection_packet_type(hci_con_handle_t handle, uint16_t packet_type){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x040f, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_change_connection_packet_type_create(hci_cmd_buffer, handle, packet_type);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_authentication_requested
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_authentication_requested_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x11;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_authentication_requested
+ * @return status
+ */
+static inline int hci_send_authentication_requested(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0411, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_authentication_requested_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_set_connection_encryption
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param encryption_enable
+ * @return size of HCI Command
+ * @note: btstack_type H1
+ */
+static inline uint16_t hci_set_connection_encryption_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t encryption_enable){
+    hci_cmd_buffer[0] = 0x13;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 3;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = encryption_enable;
+    return 6;
+}
+
+/**
+ * @brief Send hci_set_connection_encryption
+ * @return status
+ */
+static inline int hci_send_set_connection_encryption(hci_con_handle_t handle, uint8_t encryption_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0413, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_set_connection_encryption_create(hci_cmd_buffer, handle, encryption_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_change_connection_link_key
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_change_connection_link_key_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x15;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_change_connection_link_key
+ * @return status
+ */
+static inline int hci_send_change_connection_link_key(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0415, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_change_connection_link_key_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_remote_name_request
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param page_scan_repetition_mode
+ * @param reserved
+ * @param clock_offset
+ * @return size of HCI Command
+ * @note: btstack_type B112
+ */
+static inline uint16_t hci_remote_name_request_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset){
+    hci_cmd_buffer[0] = 0x19;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 10;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = page_scan_repetition_mode;
+    hci_cmd_buffer[10] = reserved;
+    little_endian_store_16(hci_cmd_buffer, 11, clock_offset);
+    return 13;
+}
+
+/**
+ * @brief Send hci_remote_name_request
+ * @return status
+ */
+static inline int hci_send_remote_name_request(const bd_addr_t bd_addr, uint8_t page_scan_repetition_mode, uint8_t reserved, uint16_t clock_offset){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0419);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_remote_name_request_create(hci_cmd_buffer, bd_addr, page_scan_repetition_mode, reserved, clock_offset);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_remote_name_request_cancel
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_remote_name_request_cancel_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x1a;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_remote_name_request_cancel
+ * @return status
+ */
+static inline int hci_send_remote_name_request_cancel(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x041a);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_remote_name_request_cancel_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_remote_supported_features_command
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_read_remote_supported_features_command_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x1b;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_read_remote_supported_features_command
+ * @return status
+ */
+static inline int hci_send_read_remote_supported_features_command(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x041b, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_remote_supported_features_command_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_setup_synchronous_connection
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param max_latency
+ * @param voice_settings
+ * @param retransmission_effort
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type H442212
+ */
+static inline uint16_t hci_setup_synchronous_connection_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    hci_cmd_buffer[0] = 0x28;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 17;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_32(hci_cmd_buffer, 5, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 9, receive_bandwidth);
+    little_endian_store_16(hci_cmd_buffer, 13, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 15, voice_settings);
+    hci_cmd_buffer[17] = retransmission_effort;
+    little_endian_store_16(hci_cmd_buffer, 18, packet_type);
+    return 20;
+}
+
+/**
+ * @brief Send hci_setup_synchronous_connection
+ * @return status
+ */
+static inline int hci_send_setup_synchronous_connection(hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0428, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_setup_synchronous_connection_create(hci_cmd_buffer, handle, transmit_bandwidth, receive_bandwidth, max_latency, voice_settings, retransmission_effort, packet_type);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_accept_synchronous_connection
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param max_latency
+ * @param voice_settings
+ * @param retransmission_effort
+ * @param packet_type
+ * @return size of HCI Command
+ * @note: btstack_type B442212
+ */
+static inline uint16_t hci_accept_synchronous_connection_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    hci_cmd_buffer[0] = 0x29;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 21;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 13, receive_bandwidth);
+    little_endian_store_16(hci_cmd_buffer, 17, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 19, voice_settings);
+    hci_cmd_buffer[21] = retransmission_effort;
+    little_endian_store_16(hci_cmd_buffer, 22, packet_type);
+    return 24;
+}
+
+/**
+ * @brief Send hci_accept_synchronous_connection
+ * @return status
+ */
+static inline int hci_send_accept_synchronous_connection(const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint16_t max_latency, uint16_t voice_settings, uint8_t retransmission_effort, uint16_t packet_type){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0429);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_accept_synchronous_connection_create(hci_cmd_buffer, bd_addr, transmit_bandwidth, receive_bandwidth, max_latency, voice_settings, retransmission_effort, packet_type);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_io_capability_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param IO_capability
+ * @param OOB_data_present
+ * @param authentication_requirements
+ * @return size of HCI Command
+ * @note: btstack_type B111
+ */
+static inline uint16_t hci_io_capability_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t IO_capability, uint8_t OOB_data_present, uint8_t authentication_requirements){
+    hci_cmd_buffer[0] = 0x2b;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 9;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = IO_capability;
+    hci_cmd_buffer[10] = OOB_data_present;
+    hci_cmd_buffer[11] = authentication_requirements;
+    return 12;
+}
+
+/**
+ * @brief Send hci_io_capability_request_reply
+ * @return status
+ */
+static inline int hci_send_io_capability_request_reply(const bd_addr_t bd_addr, uint8_t IO_capability, uint8_t OOB_data_present, uint8_t authentication_requirements){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x042b);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_io_capability_request_reply_create(hci_cmd_buffer, bd_addr, IO_capability, OOB_data_present, authentication_requirements);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_user_confirmation_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_user_confirmation_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x2c;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_user_confirmation_request_reply
+ * @return status
+ */
+static inline int hci_send_user_confirmation_request_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x042c);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_user_confirmation_request_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_user_confirmation_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_user_confirmation_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x2d;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_user_confirmation_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_user_confirmation_request_negative_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x042d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_user_confirmation_request_negative_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_user_passkey_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param numeric_value
+ * @return size of HCI Command
+ * @note: btstack_type B4
+ */
+static inline uint16_t hci_user_passkey_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t numeric_value){
+    hci_cmd_buffer[0] = 0x2e;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 10;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, numeric_value);
+    return 13;
+}
+
+/**
+ * @brief Send hci_user_passkey_request_reply
+ * @return status
+ */
+static inline int hci_send_user_passkey_request_reply(const bd_addr_t bd_addr, uint32_t numeric_value){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x042e);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_user_passkey_request_reply_create(hci_cmd_buffer, bd_addr, numeric_value);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_user_passkey_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_user_passkey_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x2f;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_user_passkey_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_user_passkey_request_negative_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x042f);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_user_passkey_request_negative_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_remote_oob_data_request_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param c
+ * @param r
+ * @return size of HCI Command
+ * @note: btstack_type BPP
+ */
+static inline uint16_t hci_remote_oob_data_request_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, const uint8_t * c, const uint8_t * r){
+    hci_cmd_buffer[0] = 0x30;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 38;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    memcpy(&hci_cmd_buffer[9], c, 16);
+    memcpy(&hci_cmd_buffer[25], r, 16);
+    return 41;
+}
+
+/**
+ * @brief Send hci_remote_oob_data_request_reply
+ * @return status
+ */
+static inline int hci_send_remote_oob_data_request_reply(const bd_addr_t bd_addr, const uint8_t * c, const uint8_t * r){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0430);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_remote_oob_data_request_reply_create(hci_cmd_buffer, bd_addr, c, r);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_remote_oob_data_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_remote_oob_data_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x33;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_remote_oob_data_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_remote_oob_data_request_negative_reply(const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0433);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_remote_oob_data_request_negative_reply_create(hci_cmd_buffer, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_io_capability_request_negative_reply
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param reason
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_io_capability_request_negative_reply_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t reason){
+    hci_cmd_buffer[0] = 0x34;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = reason;
+    return 10;
+}
+
+/**
+ * @brief Send hci_io_capability_request_negative_reply
+ * @return status
+ */
+static inline int hci_send_io_capability_request_negative_reply(const bd_addr_t bd_addr, uint8_t reason){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0434);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_io_capability_request_negative_reply_create(hci_cmd_buffer, bd_addr, reason);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_enhanced_setup_synchronous_connection
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param transmit_coding_format_type
+ * @param transmit_coding_format_company
+ * @param transmit_coding_format_codec
+ * @param receive_coding_format_type
+ * @param receive_coding_format_company
+ * @param receive_coding_format_codec
+ * @param transmit_coding_frame_size
+ * @param receive_coding_frame_size
+ * @param input_bandwidth
+ * @param output_bandwidth
+ * @param input_coding_format_type
+ * @param input_coding_format_company
+ * @param input_coding_format_codec
+ * @param output_coding_format_type
+ * @param output_coding_format_company
+ * @param output_coding_format_codec
+ * @param input_coded_data_size
+ * @param outupt_coded_data_size
+ * @param input_pcm_data_format
+ * @param output_pcm_data_format
+ * @param input_pcm_sample_payload_msb_position
+ * @param output_pcm_sample_payload_msb_position
+ * @param input_data_path
+ * @param output_data_path
+ * @param input_transport_unit_size
+ * @param output_transport_unit_size
+ * @param max_latency
+ * @param packet_type
+ * @param retransmission_effort
+ * @return size of HCI Command
+ * @note: btstack_type H4412212222441221222211111111221
+ */
+static inline uint16_t hci_enhanced_setup_synchronous_connection_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    hci_cmd_buffer[0] = 0x3d;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 59;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_32(hci_cmd_buffer, 5, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 9, receive_bandwidth);
+    hci_cmd_buffer[13] = transmit_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 14, transmit_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 16, transmit_coding_format_codec);
+    hci_cmd_buffer[18] = receive_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 19, receive_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 21, receive_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 23, transmit_coding_frame_size);
+    little_endian_store_16(hci_cmd_buffer, 25, receive_coding_frame_size);
+    little_endian_store_32(hci_cmd_buffer, 27, input_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 31, output_bandwidth);
+    hci_cmd_buffer[35] = input_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 36, input_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 38, input_coding_format_codec);
+    hci_cmd_buffer[40] = output_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 41, output_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 43, output_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 45, input_coded_data_size);
+    little_endian_store_16(hci_cmd_buffer, 47, outupt_coded_data_size);
+    hci_cmd_buffer[49] = input_pcm_data_format;
+    hci_cmd_buffer[50] = output_pcm_data_format;
+    hci_cmd_buffer[51] = input_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[52] = output_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[53] = input_data_path;
+    hci_cmd_buffer[54] = output_data_path;
+    hci_cmd_buffer[55] = input_transport_unit_size;
+    hci_cmd_buffer[56] = output_transport_unit_size;
+    little_endian_store_16(hci_cmd_buffer, 57, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 59, packet_type);
+    hci_cmd_buffer[61] = retransmission_effort;
+    return 62;
+}
+
+/**
+ * @brief Send hci_enhanced_setup_synchronous_connection
+ * @return status
+ */
+static inline int hci_send_enhanced_setup_synchronous_connection(hci_con_handle_t handle, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x043d, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_enhanced_setup_synchronous_connection_create(hci_cmd_buffer, handle, transmit_bandwidth, receive_bandwidth, transmit_coding_format_type, transmit_coding_format_company, transmit_coding_format_codec, receive_coding_format_type, receive_coding_format_company, receive_coding_format_codec, transmit_coding_frame_size, receive_coding_frame_size, input_bandwidth, output_bandwidth, input_coding_format_type, input_coding_format_company, input_coding_format_codec, output_coding_format_type, output_coding_format_company, output_coding_format_codec, input_coded_data_size, outupt_coded_data_size, input_pcm_data_format, output_pcm_data_format, input_pcm_sample_payload_msb_position, output_pcm_sample_payload_msb_position, input_data_path, output_data_path, input_transport_unit_size, output_transport_unit_size, max_latency, packet_type, retransmission_effort);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_enhanced_accept_synchronous_connection
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param transmit_bandwidth
+ * @param receive_bandwidth
+ * @param transmit_coding_format_type
+ * @param transmit_coding_format_company
+ * @param transmit_coding_format_codec
+ * @param receive_coding_format_type
+ * @param receive_coding_format_company
+ * @param receive_coding_format_codec
+ * @param transmit_coding_frame_size
+ * @param receive_coding_frame_size
+ * @param input_bandwidth
+ * @param output_bandwidth
+ * @param input_coding_format_type
+ * @param input_coding_format_company
+ * @param input_coding_format_codec
+ * @param output_coding_format_type
+ * @param output_coding_format_company
+ * @param output_coding_format_codec
+ * @param input_coded_data_size
+ * @param outupt_coded_data_size
+ * @param input_pcm_data_format
+ * @param output_pcm_data_format
+ * @param input_pcm_sample_payload_msb_position
+ * @param output_pcm_sample_payload_msb_position
+ * @param input_data_path
+ * @param output_data_path
+ * @param input_transport_unit_size
+ * @param output_transport_unit_size
+ * @param max_latency
+ * @param packet_type
+ * @param retransmission_effort
+ * @return size of HCI Command
+ * @note: btstack_type B4412212222441221222211111111221
+ */
+static inline uint16_t hci_enhanced_accept_synchronous_connection_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    hci_cmd_buffer[0] = 0x3e;
+    hci_cmd_buffer[1] = 0x04;
+    hci_cmd_buffer[2] = 63;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    little_endian_store_32(hci_cmd_buffer, 9, transmit_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 13, receive_bandwidth);
+    hci_cmd_buffer[17] = transmit_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 18, transmit_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 20, transmit_coding_format_codec);
+    hci_cmd_buffer[22] = receive_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 23, receive_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 25, receive_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 27, transmit_coding_frame_size);
+    little_endian_store_16(hci_cmd_buffer, 29, receive_coding_frame_size);
+    little_endian_store_32(hci_cmd_buffer, 31, input_bandwidth);
+    little_endian_store_32(hci_cmd_buffer, 35, output_bandwidth);
+    hci_cmd_buffer[39] = input_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 40, input_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 42, input_coding_format_codec);
+    hci_cmd_buffer[44] = output_coding_format_type;
+    little_endian_store_16(hci_cmd_buffer, 45, output_coding_format_company);
+    little_endian_store_16(hci_cmd_buffer, 47, output_coding_format_codec);
+    little_endian_store_16(hci_cmd_buffer, 49, input_coded_data_size);
+    little_endian_store_16(hci_cmd_buffer, 51, outupt_coded_data_size);
+    hci_cmd_buffer[53] = input_pcm_data_format;
+    hci_cmd_buffer[54] = output_pcm_data_format;
+    hci_cmd_buffer[55] = input_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[56] = output_pcm_sample_payload_msb_position;
+    hci_cmd_buffer[57] = input_data_path;
+    hci_cmd_buffer[58] = output_data_path;
+    hci_cmd_buffer[59] = input_transport_unit_size;
+    hci_cmd_buffer[60] = output_transport_unit_size;
+    little_endian_store_16(hci_cmd_buffer, 61, max_latency);
+    little_endian_store_16(hci_cmd_buffer, 63, packet_type);
+    hci_cmd_buffer[65] = retransmission_effort;
+    return 66;
+}
+
+/**
+ * @brief Send hci_enhanced_accept_synchronous_connection
+ * @return status
+ */
+static inline int hci_send_enhanced_accept_synchronous_connection(const bd_addr_t bd_addr, uint32_t transmit_bandwidth, uint32_t receive_bandwidth, uint8_t transmit_coding_format_type, uint16_t transmit_coding_format_company, uint16_t transmit_coding_format_codec, uint8_t receive_coding_format_type, uint16_t receive_coding_format_company, uint16_t receive_coding_format_codec, uint16_t transmit_coding_frame_size, uint16_t receive_coding_frame_size, uint32_t input_bandwidth, uint32_t output_bandwidth, uint8_t input_coding_format_type, uint16_t input_coding_format_company, uint16_t input_coding_format_codec, uint8_t output_coding_format_type, uint16_t output_coding_format_company, uint16_t output_coding_format_codec, uint16_t input_coded_data_size, uint16_t outupt_coded_data_size, uint8_t input_pcm_data_format, uint8_t output_pcm_data_format, uint8_t input_pcm_sample_payload_msb_position, uint8_t output_pcm_sample_payload_msb_position, uint8_t input_data_path, uint8_t output_data_path, uint8_t input_transport_unit_size, uint8_t output_transport_unit_size, uint16_t max_latency, uint16_t packet_type, uint8_t retransmission_effort){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x043e);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_enhanced_accept_synchronous_connection_create(hci_cmd_buffer, bd_addr, transmit_bandwidth, receive_bandwidth, transmit_coding_format_type, transmit_coding_format_company, transmit_coding_format_codec, receive_coding_format_type, receive_coding_format_company, receive_coding_format_codec, transmit_coding_frame_size, receive_coding_frame_size, input_bandwidth, output_bandwidth, input_coding_format_type, input_coding_format_company, input_coding_format_codec, output_coding_format_type, output_coding_format_company, output_coding_format_codec, input_coded_data_size, outupt_coded_data_size, input_pcm_data_format, output_pcm_data_format, input_pcm_sample_payload_msb_position, output_pcm_sample_payload_msb_position, input_data_path, output_data_path, input_transport_unit_size, output_transport_unit_size, max_latency, packet_type, retransmission_effort);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_sniff_mode
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param sniff_max_interval
+ * @param sniff_min_interval
+ * @param sniff_attempt
+ * @param sniff_timeout
+ * @return size of HCI Command
+ * @note: btstack_type H2222
+ */
+static inline uint16_t hci_sniff_mode_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t sniff_max_interval, uint16_t sniff_min_interval, uint16_t sniff_attempt, uint16_t sniff_timeout){
+    hci_cmd_buffer[0] = 0x03;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 10;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, sniff_max_interval);
+    little_endian_store_16(hci_cmd_buffer, 7, sniff_min_interval);
+    little_endian_store_16(hci_cmd_buffer, 9, sniff_attempt);
+    little_endian_store_16(hci_cmd_buffer, 11, sniff_timeout);
+    return 13;
+}
+
+/**
+ * @brief Send hci_sniff_mode
+ * @return status
+ */
+static inline int hci_send_sniff_mode(hci_con_handle_t handle, uint16_t sniff_max_interval, uint16_t sniff_min_interval, uint16_t sniff_attempt, uint16_t sniff_timeout){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0803, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_sniff_mode_create(hci_cmd_buffer, handle, sniff_max_interval, sniff_min_interval, sniff_attempt, sniff_timeout);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_qos_setup
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param flags
+ * @param service_type
+ * @param token_rate
+ * @param peak_bandwith
+ * @param latency
+ * @param delay_variation
+ * @return size of HCI Command
+ * @note: btstack_type H114444
+ */
+static inline uint16_t hci_qos_setup_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint8_t flags, uint8_t service_type, uint32_t token_rate, uint32_t peak_bandwith, uint32_t latency, uint32_t delay_variation){
+    hci_cmd_buffer[0] = 0x07;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 20;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    hci_cmd_buffer[5] = flags;
+    hci_cmd_buffer[6] = service_type;
+    little_endian_store_32(hci_cmd_buffer, 7, token_rate);
+    little_endian_store_32(hci_cmd_buffer, 11, peak_bandwith);
+    little_endian_store_32(hci_cmd_buffer, 15, latency);
+    little_endian_store_32(hci_cmd_buffer, 19, delay_variation);
+    return 23;
+}
+
+/**
+ * @brief Send hci_qos_setup
+ * @return status
+ */
+static inline int hci_send_qos_setup(hci_con_handle_t handle, uint8_t flags, uint8_t service_type, uint32_t token_rate, uint32_t peak_bandwith, uint32_t latency, uint32_t delay_variation){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0807, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_qos_setup_create(hci_cmd_buffer, handle, flags, service_type, token_rate, peak_bandwith, latency, delay_variation);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_role_discovery
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_role_discovery_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x09;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_role_discovery
+ * @return status
+ */
+static inline int hci_send_role_discovery(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0809, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_role_discovery_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_switch_role_command
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param role
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_switch_role_command_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t role){
+    hci_cmd_buffer[0] = 0x0b;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = role;
+    return 10;
+}
+
+/**
+ * @brief Send hci_switch_role_command
+ * @return status
+ */
+static inline int hci_send_switch_role_command(const bd_addr_t bd_addr, uint8_t role){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x080b);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_switch_role_command_create(hci_cmd_buffer, bd_addr, role);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_link_policy_settings
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_read_link_policy_settings_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x0c;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_read_link_policy_settings
+ * @return status
+ */
+static inline int hci_send_read_link_policy_settings(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x080c, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_link_policy_settings_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_link_policy_settings
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param settings
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_write_link_policy_settings_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t settings){
+    hci_cmd_buffer[0] = 0x0d;
+    hci_cmd_buffer[1] = 0x08;
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, settings);
+    return 7;
+}
+
+/**
+ * @brief Send hci_write_link_policy_settings
+ * @return status
+ */
+static inline int hci_send_write_link_policy_settings(hci_con_handle_t handle, uint16_t settings){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x080d, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_link_policy_settings_create(hci_cmd_buffer, handle, settings);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_set_event_mask
+ * @param hci_cmd_buffer
+ * @param event_mask_lover_octets
+ * @param event_mask_higher_octets
+ * @return size of HCI Command
+ * @note: btstack_type 44
+ */
+static inline uint16_t hci_set_event_mask_create(uint8_t * hci_cmd_buffer, uint32_t event_mask_lover_octets, uint32_t event_mask_higher_octets){
+    hci_cmd_buffer[0] = 0x01;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 8;
+    little_endian_store_32(hci_cmd_buffer, 3, event_mask_lover_octets);
+    little_endian_store_32(hci_cmd_buffer, 7, event_mask_higher_octets);
+    return 11;
+}
+
+/**
+ * @brief Send hci_set_event_mask
+ * @return status
+ */
+static inline int hci_send_set_event_mask(uint32_t event_mask_lover_octets, uint32_t event_mask_higher_octets){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c01);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_set_event_mask_create(hci_cmd_buffer, event_mask_lover_octets, event_mask_higher_octets);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_reset
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_reset_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x03;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_reset
+ * @return status
+ */
+static inline int hci_send_reset(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c03);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_reset_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_flush
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_flush_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x09;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_flush
+ * @return status
+ */
+static inline int hci_send_flush(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0c09, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_flush_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_delete_stored_link_key
+ * @param hci_cmd_buffer
+ * @param bd_addr
+ * @param delete_all_flags
+ * @return size of HCI Command
+ * @note: btstack_type B1
+ */
+static inline uint16_t hci_delete_stored_link_key_create(uint8_t * hci_cmd_buffer, const bd_addr_t bd_addr, uint8_t delete_all_flags){
+    hci_cmd_buffer[0] = 0x12;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 7;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[3]);
+    hci_cmd_buffer[9] = delete_all_flags;
+    return 10;
+}
+
+/**
+ * @brief Send hci_delete_stored_link_key
+ * @return status
+ */
+static inline int hci_send_delete_stored_link_key(const bd_addr_t bd_addr, uint8_t delete_all_flags){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c12);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_delete_stored_link_key_create(hci_cmd_buffer, bd_addr, delete_all_flags);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#ifdef ENABLE_CLASSIC
+
+/**
+ * @brief Create hci_write_local_name
+ * @param hci_cmd_buffer
+ * @param local_name
+ * @return size of HCI Command
+ * @note: btstack_type N
+ */
+static inline uint16_t hci_write_local_name_create(uint8_t * hci_cmd_buffer, const char * local_name){
+    hci_cmd_buffer[0] = 0x13;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 248;
+    uint16_t local_name_len = strlen(local_name);
+    if (local_name_len > 248) {
+        local_name_len = 248;
+    }
+    memcpy(&hci_cmd_buffer[3], local_name, local_name_len);
+    memset(&hci_cmd_buffer[3 + local_name_len], 0, 248 - local_name_len);
+    return 251;
+}
+
+/**
+ * @brief Send hci_write_local_name
+ * @return status
+ */
+static inline int hci_send_write_local_name(const char * local_name){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c13);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_local_name_create(hci_cmd_buffer, local_name);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#endif
+
+/**
+ * @brief Create hci_read_local_name
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_name_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x14;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_name
+ * @return status
+ */
+static inline int hci_send_read_local_name(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c14);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_name_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_page_timeout
+ * @param hci_cmd_buffer
+ * @param page_timeout
+ * @return size of HCI Command
+ * @note: btstack_type 2
+ */
+static inline uint16_t hci_write_page_timeout_create(uint8_t * hci_cmd_buffer, uint16_t page_timeout){
+    hci_cmd_buffer[0] = 0x18;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, page_timeout);
+    return 5;
+}
+
+/**
+ * @brief Send hci_write_page_timeout
+ * @return status
+ */
+static inline int hci_send_write_page_timeout(uint16_t page_timeout){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c18);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_page_timeout_create(hci_cmd_buffer, page_timeout);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_scan_enable
+ * @param hci_cmd_buffer
+ * @param scan_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_scan_enable_create(uint8_t * hci_cmd_buffer, uint8_t scan_enable){
+    hci_cmd_buffer[0] = 0x1a;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = scan_enable;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_scan_enable
+ * @return status
+ */
+static inline int hci_send_write_scan_enable(uint8_t scan_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c1a);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_scan_enable_create(hci_cmd_buffer, scan_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_authentication_enable
+ * @param hci_cmd_buffer
+ * @param authentication_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_authentication_enable_create(uint8_t * hci_cmd_buffer, uint8_t authentication_enable){
+    hci_cmd_buffer[0] = 0x20;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = authentication_enable;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_authentication_enable
+ * @return status
+ */
+static inline int hci_send_write_authentication_enable(uint8_t authentication_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c20);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_authentication_enable_create(hci_cmd_buffer, authentication_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_class_of_device
+ * @param hci_cmd_buffer
+ * @param class_of_device
+ * @return size of HCI Command
+ * @note: btstack_type 3
+ */
+static inline uint16_t hci_write_class_of_device_create(uint8_t * hci_cmd_buffer, uint32_t class_of_device){
+    hci_cmd_buffer[0] = 0x24;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 3;
+    hci_cmd_buffer[3] = class_of_device;
+    little_endian_store_16(hci_cmd_buffer, 4, class_of_device >> 8);
+    return 6;
+}
+
+/**
+ * @brief Send hci_write_class_of_device
+ * @return status
+ */
+static inline int hci_send_write_class_of_device(uint32_t class_of_device){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c24);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_class_of_device_create(hci_cmd_buffer, class_of_device);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_num_broadcast_retransmissions
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_num_broadcast_retransmissions_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x29;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_num_broadcast_retransmissions
+ * @return status
+ */
+static inline int hci_send_read_num_broadcast_retransmissions(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c29);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_num_broadcast_retransmissions_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_num_broadcast_retransmissions
+ * @param hci_cmd_buffer
+ * @param num_broadcast_retransmissions
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_num_broadcast_retransmissions_create(uint8_t * hci_cmd_buffer, uint8_t num_broadcast_retransmissions){
+    hci_cmd_buffer[0] = 0x2a;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = num_broadcast_retransmissions;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_num_broadcast_retransmissions
+ * @return status
+ */
+static inline int hci_send_write_num_broadcast_retransmissions(uint8_t num_broadcast_retransmissions){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c2a);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_num_broadcast_retransmissions_create(hci_cmd_buffer, num_broadcast_retransmissions);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_synchronous_flow_control_enable
+ * @param hci_cmd_buffer
+ * @param synchronous_flow_control_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_synchronous_flow_control_enable_create(uint8_t * hci_cmd_buffer, uint8_t synchronous_flow_control_enable){
+    hci_cmd_buffer[0] = 0x2f;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = synchronous_flow_control_enable;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_synchronous_flow_control_enable
+ * @return status
+ */
+static inline int hci_send_write_synchronous_flow_control_enable(uint8_t synchronous_flow_control_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c2f);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_synchronous_flow_control_enable_create(hci_cmd_buffer, synchronous_flow_control_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#ifdef ENABLE_HCI_CONTROLLER_TO_HOST_FLOW_CONTROL
+
+/**
+ * @brief Create hci_set_controller_to_host_flow_control
+ * @param hci_cmd_buffer
+ * @param flow_control_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_set_controller_to_host_flow_control_create(uint8_t * hci_cmd_buffer, uint8_t flow_control_enable){
+    hci_cmd_buffer[0] = 0x31;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = flow_control_enable;
+    return 4;
+}
+
+/**
+ * @brief Send hci_set_controller_to_host_flow_control
+ * @return status
+ */
+static inline int hci_send_set_controller_to_host_flow_control(uint8_t flow_control_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c31);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_set_controller_to_host_flow_control_create(hci_cmd_buffer, flow_control_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_host_buffer_size
+ * @param hci_cmd_buffer
+ * @param host_acl_data_packet_length
+ * @param host_synchronous_data_packet_length
+ * @param host_total_num_acl_data_packets
+ * @param host_total_num_synchronous_data_packets
+ * @return size of HCI Command
+ * @note: btstack_type 2122
+ */
+static inline uint16_t hci_host_buffer_size_create(uint8_t * hci_cmd_buffer, uint16_t host_acl_data_packet_length, uint8_t host_synchronous_data_packet_length, uint16_t host_total_num_acl_data_packets, uint16_t host_total_num_synchronous_data_packets){
+    hci_cmd_buffer[0] = 0x33;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 7;
+    little_endian_store_16(hci_cmd_buffer, 3, host_acl_data_packet_length);
+    hci_cmd_buffer[5] = host_synchronous_data_packet_length;
+    little_endian_store_16(hci_cmd_buffer, 6, host_total_num_acl_data_packets);
+    little_endian_store_16(hci_cmd_buffer, 8, host_total_num_synchronous_data_packets);
+    return 10;
+}
+
+/**
+ * @brief Send hci_host_buffer_size
+ * @return status
+ */
+static inline int hci_send_host_buffer_size(uint16_t host_acl_data_packet_length, uint8_t host_synchronous_data_packet_length, uint16_t host_total_num_acl_data_packets, uint16_t host_total_num_synchronous_data_packets){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c33);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_host_buffer_size_create(hci_cmd_buffer, host_acl_data_packet_length, host_synchronous_data_packet_length, host_total_num_acl_data_packets, host_total_num_synchronous_data_packets);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#endif
+
+/**
+ * @brief Create hci_read_link_supervision_timeout
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_read_link_supervision_timeout_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x36;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_read_link_supervision_timeout
+ * @return status
+ */
+static inline int hci_send_read_link_supervision_timeout(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0c36, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_link_supervision_timeout_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_link_supervision_timeout
+ * @param hci_cmd_buffer
+ * @param handle
+ * @param timeout
+ * @return size of HCI Command
+ * @note: btstack_type H2
+ */
+static inline uint16_t hci_write_link_supervision_timeout_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle, uint16_t timeout){
+    hci_cmd_buffer[0] = 0x37;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 4;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    little_endian_store_16(hci_cmd_buffer, 5, timeout);
+    return 7;
+}
+
+/**
+ * @brief Send hci_write_link_supervision_timeout
+ * @return status
+ */
+static inline int hci_send_write_link_supervision_timeout(hci_con_handle_t handle, uint16_t timeout){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x0c37, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_link_supervision_timeout_create(hci_cmd_buffer, handle, timeout);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_inquiry_mode
+ * @param hci_cmd_buffer
+ * @param inquiry_mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_inquiry_mode_create(uint8_t * hci_cmd_buffer, uint8_t inquiry_mode){
+    hci_cmd_buffer[0] = 0x45;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = inquiry_mode;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_inquiry_mode
+ * @return status
+ */
+static inline int hci_send_write_inquiry_mode(uint8_t inquiry_mode){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c45);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_inquiry_mode_create(hci_cmd_buffer, inquiry_mode);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_extended_inquiry_response
+ * @param hci_cmd_buffer
+ * @param fec_required
+ * @param exstended_inquiry_response
+ * @return size of HCI Command
+ * @note: btstack_type 1E
+ */
+static inline uint16_t hci_write_extended_inquiry_response_create(uint8_t * hci_cmd_buffer, uint8_t fec_required, const uint8_t * exstended_inquiry_response){
+    hci_cmd_buffer[0] = 0x52;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 241;
+    hci_cmd_buffer[3] = fec_required;
+    memcpy(&hci_cmd_buffer[4], exstended_inquiry_response, 240);
+    return 244;
+}
+
+/**
+ * @brief Send hci_write_extended_inquiry_response
+ * @return status
+ */
+static inline int hci_send_write_extended_inquiry_response(uint8_t fec_required, const uint8_t * exstended_inquiry_response){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c52);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_extended_inquiry_response_create(hci_cmd_buffer, fec_required, exstended_inquiry_response);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_simple_pairing_mode
+ * @param hci_cmd_buffer
+ * @param mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_simple_pairing_mode_create(uint8_t * hci_cmd_buffer, uint8_t mode){
+    hci_cmd_buffer[0] = 0x56;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = mode;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_simple_pairing_mode
+ * @return status
+ */
+static inline int hci_send_write_simple_pairing_mode(uint8_t mode){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c56);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_simple_pairing_mode_create(hci_cmd_buffer, mode);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_local_oob_data
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_oob_data_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x57;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_oob_data
+ * @return status
+ */
+static inline int hci_send_read_local_oob_data(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c57);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_oob_data_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_default_erroneous_data_reporting
+ * @param hci_cmd_buffer
+ * @param mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_default_erroneous_data_reporting_create(uint8_t * hci_cmd_buffer, uint8_t mode){
+    hci_cmd_buffer[0] = 0x5b;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = mode;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_default_erroneous_data_reporting
+ * @return status
+ */
+static inline int hci_send_write_default_erroneous_data_reporting(uint8_t mode){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c5b);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_default_erroneous_data_reporting_create(hci_cmd_buffer, mode);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_le_host_supported
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_le_host_supported_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x6c;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_le_host_supported
+ * @return status
+ */
+static inline int hci_send_read_le_host_supported(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c6c);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_le_host_supported_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_le_host_supported
+ * @param hci_cmd_buffer
+ * @param le_supported_host
+ * @param simultaneous_le_host
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_write_le_host_supported_create(uint8_t * hci_cmd_buffer, uint8_t le_supported_host, uint8_t simultaneous_le_host){
+    hci_cmd_buffer[0] = 0x6d;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = le_supported_host;
+    hci_cmd_buffer[4] = simultaneous_le_host;
+    return 5;
+}
+
+/**
+ * @brief Send hci_write_le_host_supported
+ * @return status
+ */
+static inline int hci_send_write_le_host_supported(uint8_t le_supported_host, uint8_t simultaneous_le_host){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c6d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_le_host_supported_create(hci_cmd_buffer, le_supported_host, simultaneous_le_host);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_local_extended_ob_data
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_extended_ob_data_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x7d;
+    hci_cmd_buffer[1] = 0x0c;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_extended_ob_data
+ * @return status
+ */
+static inline int hci_send_read_local_extended_ob_data(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x0c7d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_extended_ob_data_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_loopback_mode
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_loopback_mode_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x01;
+    hci_cmd_buffer[1] = 0x18;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_loopback_mode
+ * @return status
+ */
+static inline int hci_send_read_loopback_mode(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1801);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_loopback_mode_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_write_loopback_mode
+ * @param hci_cmd_buffer
+ * @param loopback_mode
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_write_loopback_mode_create(uint8_t * hci_cmd_buffer, uint8_t loopback_mode){
+    hci_cmd_buffer[0] = 0x02;
+    hci_cmd_buffer[1] = 0x18;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = loopback_mode;
+    return 4;
+}
+
+/**
+ * @brief Send hci_write_loopback_mode
+ * @return status
+ */
+static inline int hci_send_write_loopback_mode(uint8_t loopback_mode){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1802);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_write_loopback_mode_create(hci_cmd_buffer, loopback_mode);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_local_version_information
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_version_information_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x01;
+    hci_cmd_buffer[1] = 0x10;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_version_information
+ * @return status
+ */
+static inline int hci_send_read_local_version_information(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1001);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_version_information_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_local_supported_commands
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_supported_commands_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x02;
+    hci_cmd_buffer[1] = 0x10;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_supported_commands
+ * @return status
+ */
+static inline int hci_send_read_local_supported_commands(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1002);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_supported_commands_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_local_supported_features
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_local_supported_features_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x03;
+    hci_cmd_buffer[1] = 0x10;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_local_supported_features
+ * @return status
+ */
+static inline int hci_send_read_local_supported_features(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1003);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_local_supported_features_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_buffer_size
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_buffer_size_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x05;
+    hci_cmd_buffer[1] = 0x10;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_buffer_size
+ * @return status
+ */
+static inline int hci_send_read_buffer_size(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1005);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_buffer_size_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_bd_addr
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_read_bd_addr_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x09;
+    hci_cmd_buffer[1] = 0x10;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_read_bd_addr
+ * @return status
+ */
+static inline int hci_send_read_bd_addr(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x1009);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_bd_addr_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_read_rssi
+ * @param hci_cmd_buffer
+ * @param handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_read_rssi_create(uint8_t * hci_cmd_buffer, hci_con_handle_t handle){
+    hci_cmd_buffer[0] = 0x05;
+    hci_cmd_buffer[1] = 0x14;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_read_rssi
+ * @return status
+ */
+static inline int hci_send_read_rssi(hci_con_handle_t handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x1405, handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_read_rssi_create(hci_cmd_buffer, handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#ifdef ENABLE_BLE
+
+/**
+ * @brief Create hci_le_set_event_mask
+ * @param hci_cmd_buffer
+ * @param event_mask_lower_octets
+ * @param event_mask_higher_octets
+ * @return size of HCI Command
+ * @note: btstack_type 44
+ */
+static inline uint16_t hci_le_set_event_mask_create(uint8_t * hci_cmd_buffer, uint32_t event_mask_lower_octets, uint32_t event_mask_higher_octets){
+    hci_cmd_buffer[0] = 0x01;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 8;
+    little_endian_store_32(hci_cmd_buffer, 3, event_mask_lower_octets);
+    little_endian_store_32(hci_cmd_buffer, 7, event_mask_higher_octets);
+    return 11;
+}
+
+/**
+ * @brief Send hci_le_set_event_mask
+ * @return status
+ */
+static inline int hci_send_le_set_event_mask(uint32_t event_mask_lower_octets, uint32_t event_mask_higher_octets){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2001);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_event_mask_create(hci_cmd_buffer, event_mask_lower_octets, event_mask_higher_octets);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_buffer_size
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_read_buffer_size_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x02;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_read_buffer_size
+ * @return status
+ */
+static inline int hci_send_le_read_buffer_size(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2002);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_buffer_size_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_supported_features
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_read_supported_features_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x03;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_read_supported_features
+ * @return status
+ */
+static inline int hci_send_le_read_supported_features(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2003);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_supported_features_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_random_address
+ * @param hci_cmd_buffer
+ * @param random_bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type B
+ */
+static inline uint16_t hci_le_set_random_address_create(uint8_t * hci_cmd_buffer, const bd_addr_t random_bd_addr){
+    hci_cmd_buffer[0] = 0x05;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 6;
+    reverse_bd_addr(random_bd_addr, &hci_cmd_buffer[3]);
+    return 9;
+}
+
+/**
+ * @brief Send hci_le_set_random_address
+ * @return status
+ */
+static inline int hci_send_le_set_random_address(const bd_addr_t random_bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2005);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_random_address_create(hci_cmd_buffer, random_bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_advertising_parameters
+ * @param hci_cmd_buffer
+ * @param advertising_interval_min
+ * @param advertising_interval_max
+ * @param advertising_type
+ * @param own_address_type
+ * @param direct_address_type
+ * @param direct_address
+ * @param advertising_channel_map
+ * @param advertising_filter_policy
+ * @return size of HCI Command
+ * @note: btstack_type 22111B11
+ */
+static inline uint16_t hci_le_set_advertising_parameters_create(uint8_t * hci_cmd_buffer, uint16_t advertising_interval_min, uint16_t advertising_interval_max, uint8_t advertising_type, uint8_t own_address_type, uint8_t direct_address_type, const bd_addr_t direct_address, uint8_t advertising_channel_map, uint8_t advertising_filter_policy){
+    hci_cmd_buffer[0] = 0x06;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 15;
+    little_endian_store_16(hci_cmd_buffer, 3, advertising_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 5, advertising_interval_max);
+    hci_cmd_buffer[7] = advertising_type;
+    hci_cmd_buffer[8] = own_address_type;
+    hci_cmd_buffer[9] = direct_address_type;
+    reverse_bd_addr(direct_address, &hci_cmd_buffer[10]);
+    hci_cmd_buffer[16] = advertising_channel_map;
+    hci_cmd_buffer[17] = advertising_filter_policy;
+    return 18;
+}
+
+/**
+ * @brief Send hci_le_set_advertising_parameters
+ * @return status
+ */
+static inline int hci_send_le_set_advertising_parameters(uint16_t advertising_interval_min, uint16_t advertising_interval_max, uint8_t advertising_type, uint8_t own_address_type, uint8_t direct_address_type, const bd_addr_t direct_address, uint8_t advertising_channel_map, uint8_t advertising_filter_policy){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2006);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_advertising_parameters_create(hci_cmd_buffer, advertising_interval_min, advertising_interval_max, advertising_type, own_address_type, direct_address_type, direct_address, advertising_channel_map, advertising_filter_policy);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_advertising_channel_tx_power
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_read_advertising_channel_tx_power_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x07;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_read_advertising_channel_tx_power
+ * @return status
+ */
+static inline int hci_send_le_read_advertising_channel_tx_power(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2007);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_advertising_channel_tx_power_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_advertising_data
+ * @param hci_cmd_buffer
+ * @param advertising_data_length
+ * @param advertising_data
+ * @return size of HCI Command
+ * @note: btstack_type 1A
+ */
+static inline uint16_t hci_le_set_advertising_data_create(uint8_t * hci_cmd_buffer, uint8_t advertising_data_length, const uint8_t * advertising_data){
+    hci_cmd_buffer[0] = 0x08;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 32;
+    hci_cmd_buffer[3] = advertising_data_length;
+    memcpy(&hci_cmd_buffer[4], advertising_data, 31);
+    return 35;
+}
+
+/**
+ * @brief Send hci_le_set_advertising_data
+ * @return status
+ */
+static inline int hci_send_le_set_advertising_data(uint8_t advertising_data_length, const uint8_t * advertising_data){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2008);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_advertising_data_create(hci_cmd_buffer, advertising_data_length, advertising_data);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_scan_response_data
+ * @param hci_cmd_buffer
+ * @param scan_response_data_length
+ * @param scan_response_data
+ * @return size of HCI Command
+ * @note: btstack_type 1A
+ */
+static inline uint16_t hci_le_set_scan_response_data_create(uint8_t * hci_cmd_buffer, uint8_t scan_response_data_length, const uint8_t * scan_response_data){
+    hci_cmd_buffer[0] = 0x09;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 32;
+    hci_cmd_buffer[3] = scan_response_data_length;
+    memcpy(&hci_cmd_buffer[4], scan_response_data, 31);
+    return 35;
+}
+
+/**
+ * @brief Send hci_le_set_scan_response_data
+ * @return status
+ */
+static inline int hci_send_le_set_scan_response_data(uint8_t scan_response_data_length, const uint8_t * scan_response_data){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2009);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_scan_response_data_create(hci_cmd_buffer, scan_response_data_length, scan_response_data);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_advertise_enable
+ * @param hci_cmd_buffer
+ * @param advertise_enable
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_le_set_advertise_enable_create(uint8_t * hci_cmd_buffer, uint8_t advertise_enable){
+    hci_cmd_buffer[0] = 0x0a;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = advertise_enable;
+    return 4;
+}
+
+/**
+ * @brief Send hci_le_set_advertise_enable
+ * @return status
+ */
+static inline int hci_send_le_set_advertise_enable(uint8_t advertise_enable){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200a);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_advertise_enable_create(hci_cmd_buffer, advertise_enable);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_scan_parameters
+ * @param hci_cmd_buffer
+ * @param le_scan_type
+ * @param le_scan_interval
+ * @param le_scan_window
+ * @param own_address_type
+ * @param scanning_filter_policy
+ * @return size of HCI Command
+ * @note: btstack_type 12211
+ */
+static inline uint16_t hci_le_set_scan_parameters_create(uint8_t * hci_cmd_buffer, uint8_t le_scan_type, uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t own_address_type, uint8_t scanning_filter_policy){
+    hci_cmd_buffer[0] = 0x0b;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = le_scan_type;
+    little_endian_store_16(hci_cmd_buffer, 4, le_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 6, le_scan_window);
+    hci_cmd_buffer[8] = own_address_type;
+    hci_cmd_buffer[9] = scanning_filter_policy;
+    return 10;
+}
+
+/**
+ * @brief Send hci_le_set_scan_parameters
+ * @return status
+ */
+static inline int hci_send_le_set_scan_parameters(uint8_t le_scan_type, uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t own_address_type, uint8_t scanning_filter_policy){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200b);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_scan_parameters_create(hci_cmd_buffer, le_scan_type, le_scan_interval, le_scan_window, own_address_type, scanning_filter_policy);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_scan_enable
+ * @param hci_cmd_buffer
+ * @param le_scan_enable
+ * @param filter_duplices
+ * @return size of HCI Command
+ * @note: btstack_type 11
+ */
+static inline uint16_t hci_le_set_scan_enable_create(uint8_t * hci_cmd_buffer, uint8_t le_scan_enable, uint8_t filter_duplices){
+    hci_cmd_buffer[0] = 0x0c;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 2;
+    hci_cmd_buffer[3] = le_scan_enable;
+    hci_cmd_buffer[4] = filter_duplices;
+    return 5;
+}
+
+/**
+ * @brief Send hci_le_set_scan_enable
+ * @return status
+ */
+static inline int hci_send_le_set_scan_enable(uint8_t le_scan_enable, uint8_t filter_duplices){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200c);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_scan_enable_create(hci_cmd_buffer, le_scan_enable, filter_duplices);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_create_connection
+ * @param hci_cmd_buffer
+ * @param le_scan_interval
+ * @param le_scan_window
+ * @param initiator_filter_policy
+ * @param peer_address_type
+ * @param peer_address
+ * @param own_address_type
+ * @param conn_interval_min
+ * @param conn_interval_max
+ * @param conn_latency
+ * @param supervision_timeout
+ * @param minimum_CE_length
+ * @param maximum_CE_length
+ * @return size of HCI Command
+ * @note: btstack_type 2211B1222222
+ */
+static inline uint16_t hci_le_create_connection_create(uint8_t * hci_cmd_buffer, uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t initiator_filter_policy, uint8_t peer_address_type, const bd_addr_t peer_address, uint8_t own_address_type, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_CE_length, uint16_t maximum_CE_length){
+    hci_cmd_buffer[0] = 0x0d;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 25;
+    little_endian_store_16(hci_cmd_buffer, 3, le_scan_interval);
+    little_endian_store_16(hci_cmd_buffer, 5, le_scan_window);
+    hci_cmd_buffer[7] = initiator_filter_policy;
+    hci_cmd_buffer[8] = peer_address_type;
+    reverse_bd_addr(peer_address, &hci_cmd_buffer[9]);
+    hci_cmd_buffer[15] = own_address_type;
+    little_endian_store_16(hci_cmd_buffer, 16, conn_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 18, conn_interval_max);
+    little_endian_store_16(hci_cmd_buffer, 20, conn_latency);
+    little_endian_store_16(hci_cmd_buffer, 22, supervision_timeout);
+    little_endian_store_16(hci_cmd_buffer, 24, minimum_CE_length);
+    little_endian_store_16(hci_cmd_buffer, 26, maximum_CE_length);
+    return 28;
+}
+
+/**
+ * @brief Send hci_le_create_connection
+ * @return status
+ */
+static inline int hci_send_le_create_connection(uint16_t le_scan_interval, uint16_t le_scan_window, uint8_t initiator_filter_policy, uint8_t peer_address_type, const bd_addr_t peer_address, uint8_t own_address_type, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_CE_length, uint16_t maximum_CE_length){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_create_connection_create(hci_cmd_buffer, le_scan_interval, le_scan_window, initiator_filter_policy, peer_address_type, peer_address, own_address_type, conn_interval_min, conn_interval_max, conn_latency, supervision_timeout, minimum_CE_length, maximum_CE_length);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_create_connection_cancel
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_create_connection_cancel_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x0e;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_create_connection_cancel
+ * @return status
+ */
+static inline int hci_send_le_create_connection_cancel(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200e);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_create_connection_cancel_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_white_list_size
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_read_white_list_size_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x0f;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_read_white_list_size
+ * @return status
+ */
+static inline int hci_send_le_read_white_list_size(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x200f);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_white_list_size_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_clear_white_list
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_clear_white_list_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x10;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_clear_white_list
+ * @return status
+ */
+static inline int hci_send_le_clear_white_list(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2010);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_clear_white_list_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_add_device_to_white_list
+ * @param hci_cmd_buffer
+ * @param address_type
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type 1B
+ */
+static inline uint16_t hci_le_add_device_to_white_list_create(uint8_t * hci_cmd_buffer, uint8_t address_type, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x11;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = address_type;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[4]);
+    return 10;
+}
+
+/**
+ * @brief Send hci_le_add_device_to_white_list
+ * @return status
+ */
+static inline int hci_send_le_add_device_to_white_list(uint8_t address_type, const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2011);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_add_device_to_white_list_create(hci_cmd_buffer, address_type, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_remove_device_from_white_list
+ * @param hci_cmd_buffer
+ * @param address_type
+ * @param bd_addr
+ * @return size of HCI Command
+ * @note: btstack_type 1B
+ */
+static inline uint16_t hci_le_remove_device_from_white_list_create(uint8_t * hci_cmd_buffer, uint8_t address_type, const bd_addr_t bd_addr){
+    hci_cmd_buffer[0] = 0x12;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 7;
+    hci_cmd_buffer[3] = address_type;
+    reverse_bd_addr(bd_addr, &hci_cmd_buffer[4]);
+    return 10;
+}
+
+/**
+ * @brief Send hci_le_remove_device_from_white_list
+ * @return status
+ */
+static inline int hci_send_le_remove_device_from_white_list(uint8_t address_type, const bd_addr_t bd_addr){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2012);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_remove_device_from_white_list_create(hci_cmd_buffer, address_type, bd_addr);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_connection_update
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @param conn_interval_min
+ * @param conn_interval_max
+ * @param conn_latency
+ * @param supervision_timeout
+ * @param minimum_CE_length
+ * @param maximum_CE_length
+ * @return size of HCI Command
+ * @note: btstack_type H222222
+ */
+static inline uint16_t hci_le_connection_update_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_CE_length, uint16_t maximum_CE_length){
+    hci_cmd_buffer[0] = 0x13;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 14;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    little_endian_store_16(hci_cmd_buffer, 5, conn_interval_min);
+    little_endian_store_16(hci_cmd_buffer, 7, conn_interval_max);
+    little_endian_store_16(hci_cmd_buffer, 9, conn_latency);
+    little_endian_store_16(hci_cmd_buffer, 11, supervision_timeout);
+    little_endian_store_16(hci_cmd_buffer, 13, minimum_CE_length);
+    little_endian_store_16(hci_cmd_buffer, 15, maximum_CE_length);
+    return 17;
+}
+
+/**
+ * @brief Send hci_le_connection_update
+ * @return status
+ */
+static inline int hci_send_le_connection_update(hci_con_handle_t conn_handle, uint16_t conn_interval_min, uint16_t conn_interval_max, uint16_t conn_latency, uint16_t supervision_timeout, uint16_t minimum_CE_length, uint16_t maximum_CE_length){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x2013, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_connection_update_create(hci_cmd_buffer, conn_handle, conn_interval_min, conn_interval_max, conn_latency, supervision_timeout, minimum_CE_length, maximum_CE_length);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_set_host_channel_classification
+ * @param hci_cmd_buffer
+ * @param channel_map_lower_32bits
+ * @param channel_map_higher_5bits
+ * @return size of HCI Command
+ * @note: btstack_type 41
+ */
+static inline uint16_t hci_le_set_host_channel_classification_create(uint8_t * hci_cmd_buffer, uint32_t channel_map_lower_32bits, uint8_t channel_map_higher_5bits){
+    hci_cmd_buffer[0] = 0x14;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 5;
+    little_endian_store_32(hci_cmd_buffer, 3, channel_map_lower_32bits);
+    hci_cmd_buffer[7] = channel_map_higher_5bits;
+    return 8;
+}
+
+/**
+ * @brief Send hci_le_set_host_channel_classification
+ * @return status
+ */
+static inline int hci_send_le_set_host_channel_classification(uint32_t channel_map_lower_32bits, uint8_t channel_map_higher_5bits){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2014);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_set_host_channel_classification_create(hci_cmd_buffer, channel_map_lower_32bits, channel_map_higher_5bits);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_channel_map
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_le_read_channel_map_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    hci_cmd_buffer[0] = 0x15;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_le_read_channel_map
+ * @return status
+ */
+static inline int hci_send_le_read_channel_map(hci_con_handle_t conn_handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x2015, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_channel_map_create(hci_cmd_buffer, conn_handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_remote_used_features
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_le_read_remote_used_features_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    hci_cmd_buffer[0] = 0x16;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_le_read_remote_used_features
+ * @return status
+ */
+static inline int hci_send_le_read_remote_used_features(hci_con_handle_t conn_handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x2016, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_remote_used_features_create(hci_cmd_buffer, conn_handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_encrypt
+ * @param hci_cmd_buffer
+ * @param key
+ * @param plain_text
+ * @return size of HCI Command
+ * @note: btstack_type PP
+ */
+static inline uint16_t hci_le_encrypt_create(uint8_t * hci_cmd_buffer, const uint8_t * key, const uint8_t * plain_text){
+    hci_cmd_buffer[0] = 0x17;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 32;
+    memcpy(&hci_cmd_buffer[3], key, 16);
+    memcpy(&hci_cmd_buffer[19], plain_text, 16);
+    return 35;
+}
+
+/**
+ * @brief Send hci_le_encrypt
+ * @return status
+ */
+static inline int hci_send_le_encrypt(const uint8_t * key, const uint8_t * plain_text){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2017);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_encrypt_create(hci_cmd_buffer, key, plain_text);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_rand
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_rand_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x18;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_rand
+ * @return status
+ */
+static inline int hci_send_le_rand(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2018);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_rand_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_start_encryption
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @param random_number_lower_32bits
+ * @param random_number_higher_32bits
+ * @param encryption_diversifier
+ * @param long_term_key
+ * @return size of HCI Command
+ * @note: btstack_type H442P
+ */
+static inline uint16_t hci_le_start_encryption_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle, uint32_t random_number_lower_32bits, uint32_t random_number_higher_32bits, uint16_t encryption_diversifier, const uint8_t * long_term_key){
+    hci_cmd_buffer[0] = 0x19;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 28;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    little_endian_store_32(hci_cmd_buffer, 5, random_number_lower_32bits);
+    little_endian_store_32(hci_cmd_buffer, 9, random_number_higher_32bits);
+    little_endian_store_16(hci_cmd_buffer, 13, encryption_diversifier);
+    memcpy(&hci_cmd_buffer[15], long_term_key, 16);
+    return 31;
+}
+
+/**
+ * @brief Send hci_le_start_encryption
+ * @return status
+ */
+static inline int hci_send_le_start_encryption(hci_con_handle_t conn_handle, uint32_t random_number_lower_32bits, uint32_t random_number_higher_32bits, uint16_t encryption_diversifier, const uint8_t * long_term_key){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x2019, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_start_encryption_create(hci_cmd_buffer, conn_handle, random_number_lower_32bits, random_number_higher_32bits, encryption_diversifier, long_term_key);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_long_term_key_request_reply
+ * @param hci_cmd_buffer
+ * @param connection_handle
+ * @param long_term_key
+ * @return size of HCI Command
+ * @note: btstack_type HP
+ */
+static inline uint16_t hci_le_long_term_key_request_reply_create(uint8_t * hci_cmd_buffer, hci_con_handle_t connection_handle, const uint8_t * long_term_key){
+    hci_cmd_buffer[0] = 0x1a;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 18;
+    little_endian_store_16(hci_cmd_buffer, 3, connection_handle);
+    memcpy(&hci_cmd_buffer[5], long_term_key, 16);
+    return 21;
+}
+
+/**
+ * @brief Send hci_le_long_term_key_request_reply
+ * @return status
+ */
+static inline int hci_send_le_long_term_key_request_reply(hci_con_handle_t connection_handle, const uint8_t * long_term_key){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x201a, connection_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_long_term_key_request_reply_create(hci_cmd_buffer, connection_handle, long_term_key);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_long_term_key_negative_reply
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_le_long_term_key_negative_reply_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    hci_cmd_buffer[0] = 0x1b;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_le_long_term_key_negative_reply
+ * @return status
+ */
+static inline int hci_send_le_long_term_key_negative_reply(hci_con_handle_t conn_handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x201b, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_long_term_key_negative_reply_create(hci_cmd_buffer, conn_handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_supported_states
+ * @param hci_cmd_buffer
+ * @param conn_handle
+ * @return size of HCI Command
+ * @note: btstack_type H
+ */
+static inline uint16_t hci_le_read_supported_states_create(uint8_t * hci_cmd_buffer, hci_con_handle_t conn_handle){
+    hci_cmd_buffer[0] = 0x1c;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 2;
+    little_endian_store_16(hci_cmd_buffer, 3, conn_handle);
+    return 5;
+}
+
+/**
+ * @brief Send hci_le_read_supported_states
+ * @return status
+ */
+static inline int hci_send_le_read_supported_states(hci_con_handle_t conn_handle){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer_for_con_handle(0x201c, conn_handle);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_supported_states_create(hci_cmd_buffer, conn_handle);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_receiver_test
+ * @param hci_cmd_buffer
+ * @param rx_frequency
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_le_receiver_test_create(uint8_t * hci_cmd_buffer, uint8_t rx_frequency){
+    hci_cmd_buffer[0] = 0x1d;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = rx_frequency;
+    return 4;
+}
+
+/**
+ * @brief Send hci_le_receiver_test
+ * @return status
+ */
+static inline int hci_send_le_receiver_test(uint8_t rx_frequency){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x201d);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_receiver_test_create(hci_cmd_buffer, rx_frequency);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_transmitter_test
+ * @param hci_cmd_buffer
+ * @param tx_frequency
+ * @param test_payload_lengh
+ * @param packet_payload
+ * @return size of HCI Command
+ * @note: btstack_type 111
+ */
+static inline uint16_t hci_le_transmitter_test_create(uint8_t * hci_cmd_buffer, uint8_t tx_frequency, uint8_t test_payload_lengh, uint8_t packet_payload){
+    hci_cmd_buffer[0] = 0x1e;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 3;
+    hci_cmd_buffer[3] = tx_frequency;
+    hci_cmd_buffer[4] = test_payload_lengh;
+    hci_cmd_buffer[5] = packet_payload;
+    return 6;
+}
+
+/**
+ * @brief Send hci_le_transmitter_test
+ * @return status
+ */
+static inline int hci_send_le_transmitter_test(uint8_t tx_frequency, uint8_t test_payload_lengh, uint8_t packet_payload){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x201e);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_transmitter_test_create(hci_cmd_buffer, tx_frequency, test_payload_lengh, packet_payload);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_test_end
+ * @param hci_cmd_buffer
+ * @param end_test_cmd
+ * @return size of HCI Command
+ * @note: btstack_type 1
+ */
+static inline uint16_t hci_le_test_end_create(uint8_t * hci_cmd_buffer, uint8_t end_test_cmd){
+    hci_cmd_buffer[0] = 0x1f;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 1;
+    hci_cmd_buffer[3] = end_test_cmd;
+    return 4;
+}
+
+/**
+ * @brief Send hci_le_test_end
+ * @return status
+ */
+static inline int hci_send_le_test_end(uint8_t end_test_cmd){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x201f);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_test_end_create(hci_cmd_buffer, end_test_cmd);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+/**
+ * @brief Create hci_le_read_local_p256_public_key
+ * @param hci_cmd_buffer
+ * @return size of HCI Command
+ * @note: btstack_type 
+ */
+static inline uint16_t hci_le_read_local_p256_public_key_create(uint8_t * hci_cmd_buffer){
+    hci_cmd_buffer[0] = 0x25;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 0;
+    return 3;
+}
+
+/**
+ * @brief Send hci_le_read_local_p256_public_key
+ * @return status
+ */
+static inline int hci_send_le_read_local_p256_public_key(void){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2025);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_read_local_p256_public_key_create(hci_cmd_buffer);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#ifdef HAVE_HCI_CONTROLLER_DHKEY_SUPPORT
+
+/**
+ * @brief Create hci_le_generate_dhkey
+ * @param hci_cmd_buffer
+ * @param arg1
+ * @param arg2
+ * @return size of HCI Command
+ * @note: btstack_type QQ
+ */
+static inline uint16_t hci_le_generate_dhkey_create(uint8_t * hci_cmd_buffer, const uint8_t * arg1, const uint8_t * arg2){
+    hci_cmd_buffer[0] = 0x26;
+    hci_cmd_buffer[1] = 0x20;
+    hci_cmd_buffer[2] = 64;
+    reverse_bytes(arg1, &hci_cmd_buffer[3], 32);
+    reverse_bytes(arg2, &hci_cmd_buffer[35], 32);
+    return 67;
+}
+
+/**
+ * @brief Send hci_le_generate_dhkey
+ * @return status
+ */
+static inline int hci_send_le_generate_dhkey(const uint8_t * arg1, const uint8_t * arg2){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0x2026);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_le_generate_dhkey_create(hci_cmd_buffer, arg1, arg2);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+#endif
+
+#endif
+
+/**
+ * @brief Configure SCO Routing (BCM)
+ * @param hci_cmd_buffer
+ * @param sco_routing
+ * @param pcm_interface_rate
+ * @param frame_type
+ * @param sync_mode
+ * @param clock_mode
+ * @return size of HCI Command
+ * @note: btstack_type 11111
+ */
+static inline uint16_t hci_bcm_write_sco_pcm_int_create(uint8_t * hci_cmd_buffer, uint8_t sco_routing, uint8_t pcm_interface_rate, uint8_t frame_type, uint8_t sync_mode, uint8_t clock_mode){
+    hci_cmd_buffer[0] = 0x1c;
+    hci_cmd_buffer[1] = 0xfc;
+    hci_cmd_buffer[2] = 5;
+    hci_cmd_buffer[3] = sco_routing;
+    hci_cmd_buffer[4] = pcm_interface_rate;
+    hci_cmd_buffer[5] = frame_type;
+    hci_cmd_buffer[6] = sync_mode;
+    hci_cmd_buffer[7] = clock_mode;
+    return 8;
+}
+
+/**
+ * @brief Send hci_bcm_write_sco_pcm_int
+ * @return status
+ */
+static inline int hci_send_bcm_write_sco_pcm_int(uint8_t sco_routing, uint8_t pcm_interface_rate, uint8_t frame_type, uint8_t sync_mode, uint8_t clock_mode){
+    uint8_t * hci_cmd_buffer = hci_reserve_command_packet_buffer(0xfc1c);
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = hci_bcm_write_sco_pcm_int_create(hci_cmd_buffer, sco_routing, pcm_interface_rate, frame_type, sync_mode, clock_mode);
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}
+
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __HCI_CMD_BUILDER_H
@@ -164,6 +164,18 @@ const hci_transport_t * hci_transport_usb_instance(void);
  */
 void hci_transport_usb_set_path(int len, uint8_t * port_numbers);
 
+/*
+ * @brief Get USB transport for additional Bluetooth device, e.g. for use with hci_add_controller
+ * @param device_index 0 .. HCI_TRANSPORT_USB_MAX_DEVICES-1, device 0 is returned by hci_transport_usb_instance
+ * @return transport or NULL if device_index invalid
+ */
+const hci_transport_t * hci_transport_usb_instance_for_device(int device_index);
+
+/**
+ * @brief Specify USB Bluetooth device for given device index via port numbers from root to device
+ */
+void hci_transport_usb_set_path_for_device(int device_index, int len, uint8_t * port_numbers);
+
 /* API_END */
     
 #if defined __cplusplus
@@ -68,10 +68,44 @@
 // used to cache l2cap rejects, echo, and informational requests
 #define NR_PENDING_SIGNALING_RESPONSES 3
 
-// nr of credits provided to remote if credits fall below watermark
-#define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK 5
+// min nr of credits provided to remote if outstanding credits fall below current increment
 #define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT 5
 
+// max nr of credits provided to remote at once with automatic credits
+#ifndef L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_MAX
+#define L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_MAX 64
+#endif
+
+// minimal MPS for LE Data Channels
+#define L2CAP_LE_DATA_CHANNELS_MIN_MPS 23
+
+// Enhanced Retransmission and Streaming Mode: control field, SDU length in start segment, FCS
+#define L2CAP_ERTM_CONTROL_FIELD_SIZE 2
+#define L2CAP_ERTM_SDU_LENGTH_SIZE    2
+#define L2CAP_ERTM_FCS_SIZE           2
+
+// max nr of unacknowledged I-frames accepted from remote, announced as TxWindow
+// incoming I-frames are not buffered, so it's only used to tell duplicates from missing frames
+#ifndef L2CAP_ERTM_RX_WINDOW_SIZE
+#define L2CAP_ERTM_RX_WINDOW_SIZE 32
+#endif
+
+// sequence numbers are modulo 64, so at most 63 I-frames can be unacknowledged
+#define L2CAP_ERTM_MAX_TX_WINDOW 63
+#if L2CAP_ERTM_RX_WINDOW_SIZE > L2CAP_ERTM_MAX_TX_WINDOW
+#error "L2CAP_ERTM_RX_WINDOW_SIZE must not be larger than 63"
+#endif
+
+// state of retransmission / monitor timer
+#define L2CAP_ERTM_TIMER_NONE           0
+#define L2CAP_ERTM_TIMER_RETRANSMISSION 1
+#define L2CAP_ERTM_TIMER_MONITOR        2
+
+// Retransmission and Flow Control option { type(8): 4, len(8): 9, mode(8), tx window(8), max transmit(8), 
+//   retransmission timeout(16), monitor timeout(16), mps(16) }
+#define L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL     4
+#define L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN 9
+
 // offsets for L2CAP SIGNALING COMMANDS
 #define L2CAP_SIGNALING_COMMAND_CODE_OFFSET   0
 #define L2CAP_SIGNALING_COMMAND_SIGID_OFFSET  1
@@ -101,6 +135,9 @@ static void l2cap_emit_channel_closed(l2cap_channel_t *channel);
 static void l2cap_emit_incoming_connection(l2cap_channel_t *channel);
 static int  l2cap_channel_ready_for_open(l2cap_channel_t *channel);
 #endif
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+static void l2cap_run(void);
+#endif
 #ifdef ENABLE_LE_DATA_CHANNELS
 static void l2cap_emit_le_channel_opened(l2cap_channel_t *channel, uint8_t status);
 static void l2cap_emit_le_incoming_connection(l2cap_channel_t *channel);
@@ -113,6 +150,7 @@ static inline l2cap_service_t * l2cap_le_get_service(uint16_t psm);
 typedef struct l2cap_fixed_channel {
     btstack_packet_handler_t callback;
     uint8_t waiting_for_can_send_now;
+    hci_con_handle_t con_handle;    // of last can send now request
 } l2cap_fixed_channel_t;
 
 #ifdef ENABLE_CLASSIC
@@ -131,6 +169,7 @@ static l2cap_signaling_response_t signaling_responses[NR_PENDING_SIGNALING_RESPO
 static int signaling_responses_pending;
 
 static btstack_packet_callback_registration_t hci_event_callback_registration;
+static btstack_event_mask_t hci_event_mask;
 static l2cap_fixed_channel_t fixed_channels[L2CAP_FIXED_CHANNEL_TABLE_SIZE];
 
 #ifdef ENABLE_BLE
@@ -191,6 +230,8 @@ void l2cap_init(void){
     // register callback with HCI
     //
     hci_event_callback_registration.callback = &l2cap_hci_event_handler;
+    btstack_event_mask_set_all_except_reports(&hci_event_mask);
+    hci_event_callback_registration.event_mask = &hci_event_mask;
     hci_add_event_handler(&hci_event_callback_registration);
 
     hci_register_acl_packet_handler(&l2cap_acl_handler);
@@ -209,12 +250,14 @@ void l2cap_register_packet_handler(void (*handler)(uint8_t packet_type, uint16_t
 }
 
 void l2cap_request_can_send_fix_channel_now_event(hci_con_handle_t con_handle, uint16_t channel_id){
-    UNUSED(con_handle);
-
     int index = l2cap_fixed_channel_table_index_for_channel_id(channel_id);
     if (index < 0) return;
     fixed_channels[index].waiting_for_can_send_now = 1;
-    l2cap_notify_channel_can_send();
+    fixed_channels[index].con_handle = con_handle;
+    // check connection instead of selected controller, event gets emitted on number of completed packets otherwise
+    if (!hci_can_send_acl_packet_now(con_handle)) return;
+    fixed_channels[index].waiting_for_can_send_now = 0;
+    l2cap_emit_can_send_now(fixed_channels[index].callback, channel_id);
 }
 
 int  l2cap_can_send_fixed_channel_packet_now(hci_con_handle_t con_handle, uint16_t channel_id){
@@ -308,6 +351,552 @@ static void l2cap_emit_simple_event_with_cid(l2cap_channel_t * channel, uint8_t
 }
 #endif
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+
+typedef enum {
+    L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU = 0,
+    L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU,
+    L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU,
+    L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU
+} l2cap_segmentation_and_reassembly_t;
+
+typedef enum {
+    L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY = 0,
+    L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT,
+    L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY,
+    L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT
+} l2cap_supervisory_function_t;
+
+// FCS: CRC-16 with polynomial x^16 + x^15 + x^2 + 1, LSB first, initial value 0 - nibble-wise table
+static const uint16_t l2cap_ertm_crc16_table[16] = {
+    0x0000, 0xcc01, 0xd801, 0x1400, 0xf001, 0x3c00, 0x2800, 0xe401,
+    0xa001, 0x6c00, 0x7800, 0xb401, 0x5000, 0x9c01, 0x8801, 0x4400,
+};
+
+static uint16_t l2cap_ertm_crc16(const uint8_t * data, uint16_t len){
+    uint16_t crc = 0;
+    uint16_t i;
+    for (i = 0; i < len; i++){
+        crc = (crc >> 4) ^ l2cap_ertm_crc16_table[(crc ^ data[i]) & 0x0f];
+        crc = (crc >> 4) ^ l2cap_ertm_crc16_table[(crc ^ (data[i] >> 4)) & 0x0f];
+    }
+    return crc;
+}
+
+static inline uint8_t l2cap_ertm_next_seq(uint8_t seq){
+    return (seq + 1) & 0x3f;
+}
+
+// nr of sequence numbers from 'from' up to 'to', modulo 64
+static inline uint8_t l2cap_ertm_seq_distance(uint8_t from, uint8_t to){
+    return (to - from) & 0x3f;
+}
+
+// outgoing I-frames are stored in order of tx_seq, starting at tx_read_index for expected_ack_seq
+static inline uint8_t l2cap_ertm_tx_slot(l2cap_channel_t * channel, uint8_t tx_seq){
+    return (channel->tx_read_index + l2cap_ertm_seq_distance(channel->expected_ack_seq, tx_seq)) % channel->num_tx_buffers;
+}
+
+static inline uint8_t l2cap_ertm_num_stored_packets(l2cap_channel_t * channel){
+    return l2cap_ertm_seq_distance(channel->expected_ack_seq, channel->next_tx_seq);
+}
+
+static uint16_t l2cap_ertm_max_tx_payload_size(l2cap_channel_t * channel){
+    uint16_t max_payload = btstack_min(channel->tx_packet_size, channel->remote_mps);
+    // the start segment has to carry at least one byte besides the SDU length
+    return btstack_max(max_payload, L2CAP_ERTM_SDU_LENGTH_SIZE + 1);
+}
+
+static uint16_t l2cap_ertm_num_packets_for_sdu(l2cap_channel_t * channel, uint16_t len){
+    uint16_t max_payload = l2cap_ertm_max_tx_payload_size(channel);
+    if (len <= max_payload) return 1;
+    // start segment carries SDU length
+    len -= max_payload - L2CAP_ERTM_SDU_LENGTH_SIZE;
+    return 1 + (len + max_payload - 1) / max_payload;
+}
+
+static int l2cap_ertm_can_store_packet_now(l2cap_channel_t * channel){
+    if (channel->state != L2CAP_STATE_OPEN) return 0;
+    uint8_t num_stored_packets = l2cap_ertm_num_stored_packets(channel);
+    if (num_stored_packets > channel->num_tx_buffers) return 0;
+    uint32_t num_free_packets = channel->num_tx_buffers - num_stored_packets;
+    uint32_t num_packets_for_max_sdu = l2cap_ertm_num_packets_for_sdu(channel, channel->remote_mtu);
+    return num_free_packets >= btstack_min(num_packets_for_max_sdu, channel->num_tx_buffers);
+}
+
+static uint8_t l2cap_ertm_setup_channel(l2cap_channel_t * channel, l2cap_ertm_config_t * config, uint8_t * buffer, uint32_t size){
+
+    if (config->mode != L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION && config->mode != L2CAP_CHANNEL_MODE_STREAMING_MODE){
+        log_error("l2cap_ertm_setup_channel: unsupported mode %u", config->mode);
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+    if (config->num_tx_buffers == 0 || config->num_tx_buffers > L2CAP_ERTM_MAX_TX_WINDOW){
+        log_error("l2cap_ertm_setup_channel: num_tx_buffers %u not in 1..%u", config->num_tx_buffers, L2CAP_ERTM_MAX_TX_WINDOW);
+        return ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS;
+    }
+
+    // align tx packet state array
+    uint32_t bytes_till_alignment = (sizeof(void *) - (((uintptr_t) buffer) & (sizeof(void *) - 1))) & (sizeof(void *) - 1);
+    uint32_t tx_state_size = config->num_tx_buffers * sizeof(l2cap_ertm_tx_packet_state_t);
+    uint32_t used = bytes_till_alignment + tx_state_size + config->local_mtu;
+    if (size <= used){
+        log_error("l2cap_ertm_setup_channel: buffer of %u bytes too small", (int) size);
+        return BTSTACK_MEMORY_ALLOC_FAILED;
+    }
+
+    // tx packet size: payload of a single I-frame incl. SDU length, limited by HCI ACL buffer
+    uint32_t tx_packet_size = (size - used) / config->num_tx_buffers;
+    tx_packet_size = btstack_min(tx_packet_size, l2cap_max_mtu() - L2CAP_ERTM_CONTROL_FIELD_SIZE - L2CAP_ERTM_FCS_SIZE);
+    if (tx_packet_size <= L2CAP_ERTM_SDU_LENGTH_SIZE){
+        log_error("l2cap_ertm_setup_channel: buffer of %u bytes too small for %u tx packets", (int) size, config->num_tx_buffers);
+        return BTSTACK_MEMORY_ALLOC_FAILED;
+    }
+
+    channel->tx_packets_state  = (l2cap_ertm_tx_packet_state_t *) &buffer[bytes_till_alignment];
+    channel->reassembly_buffer = &buffer[bytes_till_alignment + tx_state_size];
+    channel->tx_packets_data   = &channel->reassembly_buffer[config->local_mtu];
+    channel->tx_packet_size    = tx_packet_size;
+    channel->num_tx_buffers    = config->num_tx_buffers;
+    memset(channel->tx_packets_state, 0, tx_state_size);
+
+    channel->mode           = config->mode;
+    channel->mode_mandatory = config->mode_mandatory;
+    channel->local_mtu      = config->local_mtu;
+    channel->local_max_transmit              = config->max_transmit;
+    channel->local_retransmission_timeout_ms = config->retransmission_timeout_ms;
+    channel->local_monitor_timeout_ms        = config->monitor_timeout_ms;
+
+    // complete I-frame has to fit into HCI ACL buffer used for recombination of incoming packets
+    channel->local_mps = l2cap_max_mtu() - L2CAP_ERTM_CONTROL_FIELD_SIZE - L2CAP_ERTM_FCS_SIZE;
+
+    log_info("l2cap_ertm_setup_channel: mode %u, %u tx packets with %u bytes, reassembly %u bytes",
+        channel->mode, channel->num_tx_buffers, channel->tx_packet_size, channel->local_mtu);
+    return 0;
+}
+
+static void l2cap_ertm_fall_back_to_basic_mode(l2cap_channel_t * channel){
+    log_info("l2cap_ertm: remote does not support mode %u, use Basic mode", channel->mode);
+    channel->mode = L2CAP_CHANNEL_MODE_BASIC;
+    channel->local_mtu = btstack_min(channel->local_mtu, l2cap_max_mtu());
+}
+
+static void l2cap_ertm_stop_timer(l2cap_channel_t * channel){
+    if (channel->ertm_timer_state == L2CAP_ERTM_TIMER_NONE) return;
+    btstack_run_loop_remove_timer(&channel->ertm_timer);
+    channel->ertm_timer_state = L2CAP_ERTM_TIMER_NONE;
+}
+
+static void l2cap_ertm_timeout_handler(btstack_timer_source_t * ts){
+    l2cap_channel_t * channel = (l2cap_channel_t *) btstack_run_loop_get_timer_context(ts);
+    uint8_t timer_state = channel->ertm_timer_state;
+    channel->ertm_timer_state = L2CAP_ERTM_TIMER_NONE;
+    if (channel->state != L2CAP_STATE_OPEN) return;
+
+    switch (timer_state){
+        case L2CAP_ERTM_TIMER_RETRANSMISSION:
+            log_info("l2cap_ertm: retransmission timeout for local cid 0x%02x, poll remote", channel->local_cid);
+            channel->monitor_retry_count = 1;
+            break;
+        case L2CAP_ERTM_TIMER_MONITOR:
+            if (channel->remote_max_transmit && channel->monitor_retry_count >= channel->remote_max_transmit){
+                log_info("l2cap_ertm: no response to poll for local cid 0x%02x, disconnect", channel->local_cid);
+                channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                l2cap_run();
+                return;
+            }
+            channel->monitor_retry_count++;
+            break;
+        default:
+            return;
+    }
+    // monitor timer is started when poll is sent
+    channel->send_supervisor_frame_poll = 1;
+    l2cap_run();
+}
+
+static void l2cap_ertm_start_timer(l2cap_channel_t * channel, uint8_t timer_state){
+    l2cap_ertm_stop_timer(channel);
+    uint16_t timeout_ms = (timer_state == L2CAP_ERTM_TIMER_RETRANSMISSION) ? channel->local_retransmission_timeout_ms : channel->local_monitor_timeout_ms;
+    btstack_run_loop_set_timer_handler(&channel->ertm_timer, l2cap_ertm_timeout_handler);
+    btstack_run_loop_set_timer_context(&channel->ertm_timer, channel);
+    btstack_run_loop_set_timer(&channel->ertm_timer, timeout_ms);
+    btstack_run_loop_add_timer(&channel->ertm_timer);
+    channel->ertm_timer_state = timer_state;
+}
+
+// store SDU as one or more I-frames, they are sent by l2cap_run
+static int l2cap_ertm_store_sdu(l2cap_channel_t * channel, const uint8_t * data, uint16_t len){
+    if (channel->state != L2CAP_STATE_OPEN){
+        log_info("l2cap_ertm_store_sdu cid 0x%02x, channel not open", channel->local_cid);
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+    if (len > channel->remote_mtu){
+        log_error("l2cap_ertm_store_sdu cid 0x%02x, data length exceeds remote MTU.", channel->local_cid);
+        return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
+    }
+    int num_packets = l2cap_ertm_num_packets_for_sdu(channel, len);
+    if (num_packets > channel->num_tx_buffers - l2cap_ertm_num_stored_packets(channel)){
+        log_info("l2cap_ertm_store_sdu cid 0x%02x, SDU of %u bytes needs %u tx packets", channel->local_cid, len, num_packets);
+        return BTSTACK_ACL_BUFFERS_FULL;
+    }
+    uint16_t max_payload = l2cap_ertm_max_tx_payload_size(channel);
+    uint16_t pos = 0;
+    int i;
+    for (i = 0; i < num_packets; i++){
+        uint8_t slot = l2cap_ertm_tx_slot(channel, channel->next_tx_seq);
+        l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[slot];
+        uint8_t * payload = &channel->tx_packets_data[slot * channel->tx_packet_size];
+        uint16_t payload_pos = 0;
+        if (num_packets == 1){
+            tx_state->sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU;
+        } else if (i == 0){
+            tx_state->sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU;
+            little_endian_store_16(payload, 0, len);
+            payload_pos = L2CAP_ERTM_SDU_LENGTH_SIZE;
+        } else if (i == num_packets - 1){
+            tx_state->sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU;
+        } else {
+            tx_state->sar = L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU;
+        }
+        uint16_t segment_len = btstack_min(len - pos, max_payload - payload_pos);
+        memcpy(&payload[payload_pos], &data[pos], segment_len);
+        pos += segment_len;
+        tx_state->len = payload_pos + segment_len;
+        tx_state->transmissions = 0;
+        tx_state->retransmission_requested = 0;
+        channel->next_tx_seq = l2cap_ertm_next_seq(channel->next_tx_seq);
+    }
+    return 0;
+}
+
+static void l2cap_ertm_send_frame(l2cap_channel_t * channel, uint16_t control, const uint8_t * payload, uint16_t len){
+    hci_reserve_packet_buffer();
+    uint8_t * acl_buffer = hci_get_outgoing_packet_buffer();
+    uint16_t pos = COMPLETE_L2CAP_HEADER;
+    little_endian_store_16(acl_buffer, pos, control);
+    pos += L2CAP_ERTM_CONTROL_FIELD_SIZE;
+    if (len){
+        memcpy(&acl_buffer[pos], payload, len);
+        pos += len;
+    }
+    // set non-flushable packet boundary flag if supported on Controller
+    uint8_t packet_boundary_flag = hci_non_flushable_packet_boundary_flag_supported_for_con_handle(channel->con_handle) ? 0x00 : 0x02;
+    l2cap_setup_header(acl_buffer, channel->con_handle, packet_boundary_flag, channel->remote_cid, pos - COMPLETE_L2CAP_HEADER + L2CAP_ERTM_FCS_SIZE);
+    // FCS covers basic L2CAP header, control field and payload
+    uint16_t fcs = l2cap_ertm_crc16(&acl_buffer[HCI_ACL_HEADER_SIZE], pos - HCI_ACL_HEADER_SIZE);
+    little_endian_store_16(acl_buffer, pos, fcs);
+    pos += L2CAP_ERTM_FCS_SIZE;
+    hci_send_acl_packet_buffer(pos);
+}
+
+static void l2cap_ertm_send_supervisor_frame(l2cap_channel_t * channel, l2cap_supervisory_function_t supervisory_function, int poll){
+    uint16_t control = (channel->expected_tx_seq << 8) | (channel->send_final_bit << 7) | (poll << 4) | (supervisory_function << 2) | 1;
+    channel->send_final_bit = 0;
+    channel->acked_tx_seq   = channel->expected_tx_seq;
+    l2cap_ertm_send_frame(channel, control, NULL, 0);
+}
+
+static void l2cap_ertm_send_information_frame(l2cap_channel_t * channel, uint8_t tx_seq){
+    uint8_t slot = l2cap_ertm_tx_slot(channel, tx_seq);
+    l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[slot];
+    tx_state->transmissions++;
+    tx_state->retransmission_requested = 0;
+    uint16_t control = (tx_state->sar << 14) | (tx_seq << 1);
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        // piggyback acknowledgement
+        control |= (channel->expected_tx_seq << 8) | (channel->send_final_bit << 7);
+        channel->send_final_bit = 0;
+        channel->acked_tx_seq   = channel->expected_tx_seq;
+    }
+    l2cap_ertm_send_frame(channel, control, &channel->tx_packets_data[slot * channel->tx_packet_size], tx_state->len);
+}
+
+// @returns tx_seq of next I-frame to send or -1
+static int l2cap_ertm_next_information_frame(l2cap_channel_t * channel){
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        if (channel->remote_busy) return -1;
+        // wait for response to poll
+        if (channel->send_supervisor_frame_poll || channel->ertm_timer_state == L2CAP_ERTM_TIMER_MONITOR) return -1;
+        // retransmission requested by SREJ
+        uint8_t tx_seq;
+        for (tx_seq = channel->expected_ack_seq; tx_seq != channel->tx_send_seq; tx_seq = l2cap_ertm_next_seq(tx_seq)){
+            if (channel->tx_packets_state[l2cap_ertm_tx_slot(channel, tx_seq)].retransmission_requested) return tx_seq;
+        }
+        // remote tx window
+        if (l2cap_ertm_seq_distance(channel->expected_ack_seq, channel->tx_send_seq) >= channel->remote_tx_window) return -1;
+    }
+    if (channel->tx_send_seq == channel->next_tx_seq) return -1;
+    return channel->tx_send_seq;
+}
+
+// acknowledge outgoing I-frames up to, but not including req_seq
+static void l2cap_ertm_process_req_seq(l2cap_channel_t * channel, uint8_t req_seq){
+    uint8_t num_acked = l2cap_ertm_seq_distance(channel->expected_ack_seq, req_seq);
+    if (num_acked == 0) return;
+    if (num_acked > l2cap_ertm_num_stored_packets(channel)){
+        log_error("l2cap_ertm: invalid req_seq %u, expected ack seq %u, next tx seq %u", req_seq, channel->expected_ack_seq, channel->next_tx_seq);
+        return;
+    }
+    // acknowledged I-frames don't need to be sent again
+    if (l2cap_ertm_seq_distance(channel->expected_ack_seq, channel->tx_send_seq) < num_acked){
+        channel->tx_send_seq = req_seq;
+    }
+    channel->expected_ack_seq = req_seq;
+    channel->tx_read_index = (channel->tx_read_index + num_acked) % channel->num_tx_buffers;
+
+    if (channel->ertm_timer_state == L2CAP_ERTM_TIMER_RETRANSMISSION){
+        if (channel->expected_ack_seq == channel->tx_send_seq){
+            l2cap_ertm_stop_timer(channel);
+        } else {
+            l2cap_ertm_start_timer(channel, L2CAP_ERTM_TIMER_RETRANSMISSION);
+        }
+    }
+
+    if (channel->waiting_for_can_send_now && l2cap_ertm_can_store_packet_now(channel)){
+        channel->waiting_for_can_send_now = 0;
+        l2cap_emit_can_send_now(channel->packet_handler, channel->local_cid);
+    }
+}
+
+// go back to oldest unacknowledged I-frame, disconnect if it has been sent max transmit times
+static void l2cap_ertm_retransmit_unacknowledged_frames(l2cap_channel_t * channel){
+    if (channel->expected_ack_seq == channel->next_tx_seq) return;
+    l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[channel->tx_read_index];
+    if (channel->remote_max_transmit && tx_state->transmissions >= channel->remote_max_transmit){
+        log_info("l2cap_ertm: max transmit reached for local cid 0x%02x, disconnect", channel->local_cid);
+        l2cap_ertm_stop_timer(channel);
+        channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+        return;
+    }
+    channel->tx_send_seq = channel->expected_ack_seq;
+}
+
+static void l2cap_ertm_handle_final_bit(l2cap_channel_t * channel){
+    // only relevant while waiting for response to poll
+    if (channel->ertm_timer_state != L2CAP_ERTM_TIMER_MONITOR) return;
+    l2cap_ertm_stop_timer(channel);
+    l2cap_ertm_retransmit_unacknowledged_frames(channel);
+}
+
+// @returns 0 if SDU overrun
+static int l2cap_ertm_append_segment(l2cap_channel_t * channel, const uint8_t * data, uint16_t len){
+    if (channel->reassembly_pos + len > channel->reassembly_sdu_length){
+        log_error("l2cap_ertm: SDU overrun, len %u", channel->reassembly_sdu_length);
+        channel->reassembly_active = 0;
+        return 0;
+    }
+    memcpy(&channel->reassembly_buffer[channel->reassembly_pos], data, len);
+    channel->reassembly_pos += len;
+    return 1;
+}
+
+static void l2cap_ertm_handle_in_sequence_segment(l2cap_channel_t * channel, uint8_t sar, uint8_t * payload, uint16_t len){
+    switch (sar){
+        case L2CAP_SEGMENTATION_AND_REASSEMBLY_UNSEGMENTED_L2CAP_SDU:
+            if (channel->reassembly_active){
+                log_error("l2cap_ertm: unsegmented SDU during reassembly, drop partial SDU");
+                channel->reassembly_active = 0;
+            }
+            if (len > channel->local_mtu){
+                log_error("l2cap_ertm: SDU of size %u larger than MTU %u", len, channel->local_mtu);
+                break;
+            }
+            // deliver directly from HCI buffer
+            l2cap_dispatch_to_channel(channel, L2CAP_DATA_PACKET, payload, len);
+            break;
+        case L2CAP_SEGMENTATION_AND_REASSEMBLY_START_OF_L2CAP_SDU: {
+            if (len < L2CAP_ERTM_SDU_LENGTH_SIZE) break;
+            uint16_t sdu_length = little_endian_read_16(payload, 0);
+            if (sdu_length > channel->local_mtu){
+                log_error("l2cap_ertm: SDU of size %u larger than MTU %u", sdu_length, channel->local_mtu);
+                channel->reassembly_active = 0;
+                break;
+            }
+            channel->reassembly_sdu_length = sdu_length;
+            channel->reassembly_pos = 0;
+            channel->reassembly_active = 1;
+            l2cap_ertm_append_segment(channel, &payload[L2CAP_ERTM_SDU_LENGTH_SIZE], len - L2CAP_ERTM_SDU_LENGTH_SIZE);
+            break;
+        }
+        case L2CAP_SEGMENTATION_AND_REASSEMBLY_CONTINUATION_OF_L2CAP_SDU:
+            if (!channel->reassembly_active) break;
+            l2cap_ertm_append_segment(channel, payload, len);
+            break;
+        case L2CAP_SEGMENTATION_AND_REASSEMBLY_END_OF_L2CAP_SDU:
+            if (!channel->reassembly_active) break;
+            if (!l2cap_ertm_append_segment(channel, payload, len)) break;
+            channel->reassembly_active = 0;
+            if (channel->reassembly_pos != channel->reassembly_sdu_length){
+                log_error("l2cap_ertm: SDU incomplete, %u of %u bytes", channel->reassembly_pos, channel->reassembly_sdu_length);
+                break;
+            }
+            l2cap_dispatch_to_channel(channel, L2CAP_DATA_PACKET, channel->reassembly_buffer, channel->reassembly_sdu_length);
+            break;
+        default:
+            break;
+    }
+}
+
+static void l2cap_ertm_handle_supervisor_frame(l2cap_channel_t * channel, uint16_t control){
+    uint8_t req_seq = (control >> 8) & 0x3f;
+    int     final   = (control >> 7) & 0x01;
+    int     poll    = (control >> 4) & 0x01;
+    l2cap_supervisory_function_t supervisory_function = (l2cap_supervisory_function_t) ((control >> 2) & 0x03);
+
+    if (poll){
+        // respond with F-bit set, either in I-frame or RR
+        channel->send_final_bit = 1;
+    }
+
+    switch (supervisory_function){
+        case L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY:
+            channel->remote_busy = 0;
+            l2cap_ertm_process_req_seq(channel, req_seq);
+            if (final) {
+                l2cap_ertm_handle_final_bit(channel);
+            }
+            break;
+        case L2CAP_SUPERVISORY_FUNCTION_RNR_RECEIVER_NOT_READY:
+            channel->remote_busy = 1;
+            l2cap_ertm_process_req_seq(channel, req_seq);
+            if (final) {
+                l2cap_ertm_handle_final_bit(channel);
+            }
+            break;
+        case L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT:
+            channel->remote_busy = 0;
+            l2cap_ertm_process_req_seq(channel, req_seq);
+            if (final && channel->ertm_timer_state == L2CAP_ERTM_TIMER_MONITOR){
+                l2cap_ertm_stop_timer(channel);
+            }
+            l2cap_ertm_retransmit_unacknowledged_frames(channel);
+            break;
+        case L2CAP_SUPERVISORY_FUNCTION_SREJ_SELECTIVE_REJECT:
+            if (poll){
+                l2cap_ertm_process_req_seq(channel, req_seq);
+            }
+            if (final && channel->ertm_timer_state == L2CAP_ERTM_TIMER_MONITOR){
+                l2cap_ertm_stop_timer(channel);
+            }
+            if (l2cap_ertm_seq_distance(channel->expected_ack_seq, req_seq) < l2cap_ertm_seq_distance(channel->expected_ack_seq, channel->tx_send_seq)){
+                l2cap_ertm_tx_packet_state_t * tx_state = &channel->tx_packets_state[l2cap_ertm_tx_slot(channel, req_seq)];
+                if (channel->remote_max_transmit && tx_state->transmissions >= channel->remote_max_transmit){
+                    log_info("l2cap_ertm: max transmit reached for local cid 0x%02x, disconnect", channel->local_cid);
+                    l2cap_ertm_stop_timer(channel);
+                    channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                    break;
+                }
+                tx_state->retransmission_requested = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// handle I-frame or S-frame, packet starts with basic L2CAP header
+static void l2cap_ertm_handle_packet(l2cap_channel_t * channel, uint8_t * packet, uint16_t size){
+
+    if (channel->state != L2CAP_STATE_OPEN) return;
+
+    if (size < L2CAP_HEADER_SIZE + L2CAP_ERTM_CONTROL_FIELD_SIZE + L2CAP_ERTM_FCS_SIZE) return;
+
+    // drop frames with invalid FCS, missing I-frames are detected by next valid one
+    uint16_t fcs = little_endian_read_16(packet, size - L2CAP_ERTM_FCS_SIZE);
+    if (l2cap_ertm_crc16(packet, size - L2CAP_ERTM_FCS_SIZE) != fcs){
+        log_info("l2cap_ertm: invalid FCS, drop frame");
+        return;
+    }
+
+    uint16_t control = little_endian_read_16(packet, L2CAP_HEADER_SIZE);
+    uint8_t * payload = &packet[L2CAP_HEADER_SIZE + L2CAP_ERTM_CONTROL_FIELD_SIZE];
+    uint16_t  payload_len = size - L2CAP_HEADER_SIZE - L2CAP_ERTM_CONTROL_FIELD_SIZE - L2CAP_ERTM_FCS_SIZE;
+
+    // S-frame
+    if (control & 1){
+        if (channel->mode != L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION) return;
+        l2cap_ertm_handle_supervisor_frame(channel, control);
+        return;
+    }
+
+    // I-frame
+    if (payload_len > channel->local_mps){
+        log_error("l2cap_ertm: I-frame payload of size %u larger than MPS %u", payload_len, channel->local_mps);
+        return;
+    }
+    uint8_t tx_seq = (control >> 1) & 0x3f;
+    uint8_t sar    = control >> 14;
+
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        l2cap_ertm_process_req_seq(channel, (control >> 8) & 0x3f);
+        if (control & 0x80){
+            l2cap_ertm_handle_final_bit(channel);
+        }
+        if (tx_seq != channel->expected_tx_seq){
+            if (l2cap_ertm_seq_distance(tx_seq, channel->expected_tx_seq) <= L2CAP_ERTM_RX_WINDOW_SIZE){
+                // duplicate, acknowledge again
+                log_info("l2cap_ertm: duplicate I-frame %u, expected %u", tx_seq, channel->expected_tx_seq);
+                channel->acked_tx_seq = (channel->expected_tx_seq - 1) & 0x3f;
+            } else if (!channel->rej_actioned){
+                // missing I-frame: request retransmission of all I-frames starting with expected tx seq
+                log_info("l2cap_ertm: I-frame %u missing, received %u", channel->expected_tx_seq, tx_seq);
+                channel->send_supervisor_frame_reject = 1;
+                channel->rej_actioned = 1;
+            }
+            return;
+        }
+        channel->rej_actioned = 0;
+    } else {
+        // Streaming Mode: missing I-frames are lost, drop partial SDU
+        if (tx_seq != channel->expected_tx_seq){
+            log_info("l2cap_ertm: I-frame %u lost, received %u", channel->expected_tx_seq, tx_seq);
+            channel->reassembly_active = 0;
+        }
+    }
+
+    channel->expected_tx_seq = l2cap_ertm_next_seq(tx_seq);
+    l2cap_ertm_handle_in_sequence_segment(channel, sar, payload, payload_len);
+}
+
+// send at most one frame, called by l2cap_run if HCI can send ACL packet
+static void l2cap_ertm_run(l2cap_channel_t * channel){
+    if (channel->send_supervisor_frame_reject){
+        channel->send_supervisor_frame_reject = 0;
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_REJ_REJECT, 0);
+        return;
+    }
+
+    // F-bit and P-bit cannot be set in same S-frame, send F-bit first
+    if (channel->send_supervisor_frame_poll && !channel->send_final_bit){
+        channel->send_supervisor_frame_poll = 0;
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 1);
+        l2cap_ertm_start_timer(channel, L2CAP_ERTM_TIMER_MONITOR);
+        return;
+    }
+
+    int tx_seq = l2cap_ertm_next_information_frame(channel);
+    if (tx_seq >= 0){
+        if (tx_seq == channel->tx_send_seq){
+            channel->tx_send_seq = l2cap_ertm_next_seq(tx_seq);
+        }
+        l2cap_ertm_send_information_frame(channel, tx_seq);
+        if (channel->mode == L2CAP_CHANNEL_MODE_STREAMING_MODE){
+            // no acknowledgements in Streaming Mode, release I-frame right away
+            l2cap_ertm_process_req_seq(channel, channel->tx_send_seq);
+        } else if (channel->ertm_timer_state == L2CAP_ERTM_TIMER_NONE){
+            l2cap_ertm_start_timer(channel, L2CAP_ERTM_TIMER_RETRANSMISSION);
+        }
+        return;
+    }
+
+    // acknowledge received I-frames or respond to poll
+    if (channel->mode != L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION) return;
+    if (channel->send_final_bit || channel->acked_tx_seq != channel->expected_tx_seq){
+        l2cap_ertm_send_supervisor_frame(channel, L2CAP_SUPERVISORY_FUNCTION_RR_RECEIVER_READY, 0);
+    }
+}
+#endif
+
 #ifdef ENABLE_CLASSIC
 void l2cap_emit_channel_opened(l2cap_channel_t *channel, uint8_t status) {
     log_info("L2CAP_EVENT_CHANNEL_OPENED status 0x%x addr %s handle 0x%x psm 0x%x local_cid 0x%x remote_cid 0x%x local_mtu %u, remote_mtu %u, flush_timeout %u",
@@ -374,12 +963,22 @@ void l2cap_request_can_send_now_event(uint16_t local_cid){
 int  l2cap_can_send_packet_now(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return 0;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        return l2cap_ertm_can_store_packet_now(channel);
+    }
+#endif
     return hci_can_send_acl_packet_now(channel->con_handle);
 }
 
 int  l2cap_can_send_prepared_packet_now(uint16_t local_cid){
     l2cap_channel_t *channel = l2cap_get_channel_for_local_cid(local_cid);
     if (!channel) return 0;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        return l2cap_ertm_can_store_packet_now(channel);
+    }
+#endif
     return hci_can_send_prepared_acl_packet_now(channel->con_handle);
 }
 uint16_t l2cap_get_remote_mtu_for_local_cid(uint16_t local_cid){
@@ -479,6 +1078,16 @@ int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
         return -1;   // TODO: define error
     }
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        int status = l2cap_ertm_store_sdu(channel, &hci_get_outgoing_packet_buffer()[COMPLETE_L2CAP_HEADER], len);
+        if (status) return status;
+        hci_release_packet_buffer();
+        l2cap_run();
+        return 0;
+    }
+#endif
+
     if (!hci_can_send_prepared_acl_packet_now(channel->con_handle)){
         log_info("l2cap_send_prepared cid 0x%02x, cannot send", local_cid);
         return BTSTACK_ACL_BUFFERS_FULL;
@@ -488,7 +1097,7 @@ int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
     
     // set non-flushable packet boundary flag if supported on Controller
     uint8_t *acl_buffer = hci_get_outgoing_packet_buffer();
-    uint8_t packet_boundary_flag = hci_non_flushable_packet_boundary_flag_supported() ? 0x00 : 0x02;
+    uint8_t packet_boundary_flag = hci_non_flushable_packet_boundary_flag_supported_for_con_handle(channel->con_handle) ? 0x00 : 0x02;
     l2cap_setup_header(acl_buffer, channel->con_handle, packet_boundary_flag, channel->remote_cid, len);
     // send
     return hci_send_acl_packet_buffer(len+8);
@@ -508,6 +1117,15 @@ int l2cap_send(uint16_t local_cid, uint8_t *data, uint16_t len){
         return L2CAP_DATA_LEN_EXCEEDS_REMOTE_MTU;
     }
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        int status = l2cap_ertm_store_sdu(channel, data, len);
+        if (status) return status;
+        l2cap_run();
+        return 0;
+    }
+#endif
+
     if (!hci_can_send_acl_packet_now(channel->con_handle)){
         log_info("l2cap_send cid 0x%02x, cannot send", local_cid);
         return BTSTACK_ACL_BUFFERS_FULL;
@@ -563,6 +1181,73 @@ uint16_t l2cap_max_le_mtu(void){
     return l2cap_max_mtu();
 }
 
+#ifdef ENABLE_LE_DATA_CHANNELS
+// MPS: complete PDU has to fit into HCI ACL buffer used for recombination of incoming LE data packets,
+// a larger MPS than needed for a single SDU does not reduce the number of PDUs
+static uint16_t l2cap_le_max_mps(uint16_t mtu){
+    uint16_t mps = btstack_min(mtu + 2, HCI_ACL_PAYLOAD_SIZE - L2CAP_HEADER_SIZE);
+    return btstack_max(mps, L2CAP_LE_DATA_CHANNELS_MIN_MPS);
+}
+
+static uint16_t l2cap_le_max_outgoing_pdu_size(l2cap_channel_t * channel){
+    return btstack_min(channel->remote_mps, HCI_ACL_PAYLOAD_SIZE - L2CAP_HEADER_SIZE);
+}
+
+// called before sending connection request/response, when local MTU is known
+static void l2cap_le_setup_channel(l2cap_channel_t * channel){
+    channel->local_mps = l2cap_le_max_mps(channel->local_mtu);
+    if (!channel->automatic_credits) return;
+    // start with credits for two complete SDUs
+    uint16_t credits_per_sdu = (channel->local_mtu + 2 + channel->local_mps - 1) / channel->local_mps;
+    channel->automatic_credits_increment = btstack_max(L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT, credits_per_sdu);
+    channel->automatic_credits_increment = btstack_min(channel->automatic_credits_increment, L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_MAX);
+    channel->new_credits_incoming = 2 * channel->automatic_credits_increment;
+}
+
+// called for each received PDU. SDUs are delivered from the receive buffer synchronously, so the buffer
+// drains as fast as the remote can send. If the remote used up all credits before new ones arrived,
+// the increment is doubled to cover the round trip time of the credit packet.
+static void l2cap_le_update_automatic_credits(l2cap_channel_t * channel){
+    if (channel->credits_incoming == 0){
+        channel->automatic_credits_increment = btstack_min(2 * channel->automatic_credits_increment, L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_MAX);
+    }
+    if (channel->credits_incoming + channel->new_credits_incoming >= channel->automatic_credits_increment) return;
+    channel->new_credits_incoming += channel->automatic_credits_increment;
+}
+#endif
+
+#ifdef ENABLE_CLASSIC
+// Retransmission and Flow Control option for Configure Request or Configure Response, Basic mode if ERTM is not enabled
+static uint16_t l2cap_setup_options_mode(l2cap_channel_t * channel, uint8_t * config_options, int is_response){
+    config_options[0] = L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL;
+    config_options[1] = L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN;
+    memset(&config_options[2], 0, L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN);
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    config_options[2] = channel->mode;
+    if (channel->mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+        if (is_response){
+            // confirm remote tx window and max transmit, provide timeouts to be used by remote
+            config_options[3] = channel->remote_tx_window;
+            config_options[4] = channel->remote_max_transmit;
+            little_endian_store_16(config_options, 5, channel->local_retransmission_timeout_ms);
+            little_endian_store_16(config_options, 7, channel->local_monitor_timeout_ms);
+        } else {
+            // timeouts are provided by remote in its Configure Response
+            config_options[3] = L2CAP_ERTM_RX_WINDOW_SIZE;
+            config_options[4] = channel->local_max_transmit;
+        }
+    }
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        little_endian_store_16(config_options, 9, is_response ? channel->remote_mps : channel->local_mps);
+    }
+#else
+    UNUSED(channel);
+    UNUSED(is_response);
+#endif
+    return 2 + L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN;
+}
+#endif
+
 // MARK: L2CAP_RUN
 // process outstanding signaling tasks
 static void l2cap_run(void){
@@ -607,13 +1292,17 @@ static void l2cap_run(void){
             case INFORMATION_REQUEST:
                 switch (infoType){
                     case 1: { // Connectionless MTU
-                            uint16_t connectionless_mtu = hci_max_acl_data_packet_length();
+                            uint16_t connectionless_mtu = hci_max_acl_data_packet_length_for_con_handle(handle);
                             l2cap_send_signaling_packet(handle, INFORMATION_RESPONSE, sig_id, infoType, 0, sizeof(connectionless_mtu), &connectionless_mtu);
                         }
                         break;
                     case 2: { // Extended Features Supported
                             // extended features request supported, features: fixed channels, unicast connectionless data reception
                             uint32_t features = 0x280;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                            // Enhanced Retransmission Mode, Streaming Mode
+                            features |= 0x18;
+#endif
                             l2cap_send_signaling_packet(handle, INFORMATION_RESPONSE, sig_id, infoType, 0, sizeof(features), &features);
                         }
                         break;
@@ -652,7 +1341,8 @@ static void l2cap_run(void){
     UNUSED(it);
 
 #ifdef ENABLE_CLASSIC
-    uint8_t  config_options[4];
+    uint8_t  config_options[16];
+    uint16_t config_options_len;
     btstack_linked_list_iterator_init(&it, &l2cap_channels);
     while (btstack_linked_list_iterator_has_next(&it)){
 
@@ -710,20 +1400,33 @@ static void l2cap_run(void){
                     channelStateVarClearFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP);
                     if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_CONT) {
                         flags = 1;
-                    } else {
+                    } else if ((channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT) == 0){
                         channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SENT_CONF_RSP);
                     }
                     if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_INVALID){
                         l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_RESPONSE, channel->remote_sig_id, channel->remote_cid, flags, L2CAP_CONF_RESULT_UNKNOWN_OPTIONS, 0, NULL);
-                    } else if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_MTU){
-                        config_options[0] = 1; // MTU
-                        config_options[1] = 2; // len param
-                        little_endian_store_16( (uint8_t*)&config_options, 2, channel->remote_mtu);
-                        l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_RESPONSE, channel->remote_sig_id, channel->remote_cid, flags, 0, 4, &config_options);
-                        channelStateVarClearFlag(channel,L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_MTU);
+                    } else if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT){
+                        // requested mode not acceptable, propose own mode
+                        config_options_len = l2cap_setup_options_mode(channel, config_options, 1);
+                        l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_RESPONSE, channel->remote_sig_id, channel->remote_cid, flags, L2CAP_CONF_RESULT_UNACCEPTABLE_PARAMETERS, config_options_len, &config_options);
                     } else {
-                        l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_RESPONSE, channel->remote_sig_id, channel->remote_cid, flags, 0, 0, NULL);
+                        config_options_len = 0;
+                        if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_MTU){
+                            config_options[0] = 1; // MTU
+                            config_options[1] = 2; // len param
+                            little_endian_store_16( (uint8_t*)&config_options, 2, channel->remote_mtu);
+                            config_options_len = 4;
+                        }
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                        if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_ERTM){
+                            config_options_len += l2cap_setup_options_mode(channel, &config_options[config_options_len], 1);
+                        }
+#endif
+                        l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_RESPONSE, channel->remote_sig_id, channel->remote_cid, flags, 0, config_options_len, &config_options);
                     }
+                    channelStateVarClearFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_MTU);
+                    channelStateVarClearFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_ERTM);
+                    channelStateVarClearFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT);
                     channelStateVarClearFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_CONT);
                 }
                 else if (channel->state_var & L2CAP_CHANNEL_STATE_VAR_SEND_CONF_REQ){
@@ -733,7 +1436,13 @@ static void l2cap_run(void){
                     config_options[0] = 1; // MTU
                     config_options[1] = 2; // len param
                     little_endian_store_16( (uint8_t*)&config_options, 2, channel->local_mtu);
-                    l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_REQUEST, channel->local_sig_id, channel->remote_cid, 0, 4, &config_options);
+                    config_options_len = 4;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+                        config_options_len += l2cap_setup_options_mode(channel, &config_options[config_options_len], 0);
+                    }
+#endif
+                    l2cap_send_signaling_packet(channel->con_handle, CONFIGURE_REQUEST, channel->local_sig_id, channel->remote_cid, 0, config_options_len, &config_options);
                     l2cap_start_rtx(channel);
                 }
                 if (l2cap_channel_ready_for_open(channel)){
@@ -742,6 +1451,14 @@ static void l2cap_run(void){
                 }
                 break;
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+            case L2CAP_STATE_OPEN:
+                if (channel->mode == L2CAP_CHANNEL_MODE_BASIC) break;
+                if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
+                l2cap_ertm_run(channel);
+                break;
+#endif
+
             case L2CAP_STATE_WILL_SEND_DISCONNECT_RESPONSE:
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
                 channel->state = L2CAP_STATE_INVALID;
@@ -777,17 +1494,18 @@ static void l2cap_run(void){
                 channel->state = L2CAP_STATE_WAIT_LE_CONNECTION_RESPONSE;
                 // le psm, source cid, mtu, mps, initial credits
                 channel->local_sig_id = l2cap_next_sig_id();
+                l2cap_le_setup_channel(channel);
                 channel->credits_incoming =  channel->new_credits_incoming;
                 channel->new_credits_incoming = 0;
-                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, 23, channel->credits_incoming);
+                l2cap_send_le_signaling_packet( channel->con_handle, LE_CREDIT_BASED_CONNECTION_REQUEST, channel->local_sig_id, channel->psm, channel->local_cid, channel->local_mtu, channel->local_mps, channel->credits_incoming);
                 break;
             case L2CAP_STATE_WILL_SEND_LE_CONNECTION_RESPONSE_ACCEPT:
                 if (!hci_can_send_acl_packet_now(channel->con_handle)) break;
-                // TODO: support larger MPS
                 channel->state = L2CAP_STATE_OPEN;
+                l2cap_le_setup_channel(channel);
                 channel->credits_incoming =  channel->new_credits_incoming;
                 channel->new_credits_incoming = 0;
-                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, 23, channel->credits_incoming, 0);
+                l2cap_send_le_signaling_packet(channel->con_handle, LE_CREDIT_BASED_CONNECTION_RESPONSE, channel->remote_sig_id, channel->local_cid, channel->local_mtu, channel->local_mps, channel->credits_incoming, 0);
                 // notify client
                 l2cap_emit_le_channel_opened(channel, 0);
                 break;                       
@@ -829,7 +1547,8 @@ static void l2cap_run(void){
                     little_endian_store_16(l2cap_payload, pos, channel->send_sdu_len);
                     pos += 2;
                 }
-                payload_size = btstack_min(channel->send_sdu_len + 2 - channel->send_sdu_pos, channel->remote_mps - pos);
+                // PDU has to fit into outgoing ACL buffer, HCI fragments it into LE data packets
+                payload_size = btstack_min(channel->send_sdu_len + 2 - channel->send_sdu_pos, l2cap_le_max_outgoing_pdu_size(channel) - pos);
                 log_info("len %u, pos %u => payload %u, credits %u", channel->send_sdu_len, channel->send_sdu_pos, payload_size, channel->credits_outgoing);
                 memcpy(&l2cap_payload[pos], &channel->send_sdu_buffer[channel->send_sdu_pos-2], payload_size); // -2 for virtual SDU len
                 pos += payload_size;
@@ -959,6 +1678,30 @@ static l2cap_channel_t * l2cap_create_channel_entry(btstack_packet_handler_t pac
 
 #ifdef ENABLE_CLASSIC
 
+static void l2cap_start_outgoing_channel(l2cap_channel_t * channel, uint16_t * out_local_cid){
+
+    // add to connections list
+    btstack_linked_list_add(&l2cap_channels, (btstack_linked_item_t *) channel);
+
+    // store local_cid
+    if (out_local_cid){
+       *out_local_cid = channel->local_cid;
+    }
+
+    // check if hci connection is already usable
+    hci_connection_t * conn = hci_connection_for_bd_addr_and_type(channel->address, BD_ADDR_TYPE_CLASSIC);
+    if (conn){
+        log_info("l2cap_create_channel, hci connection already exists");
+        l2cap_handle_connection_complete(conn->con_handle, channel);
+        // check if remote supported fearures are already received
+        if (conn->bonding_flags & BONDING_RECEIVED_REMOTE_FEATURES) {
+            l2cap_handle_remote_supported_features_received(channel);
+        }
+    }
+
+    l2cap_run();
+}
+
 /** 
  * @brief Creates L2CAP channel to the PSM of a remote device with baseband address. A new baseband connection will be initiated if necessary.
  * @param packet_handler
@@ -980,29 +1723,31 @@ uint8_t l2cap_create_channel(btstack_packet_handler_t channel_packet_handler, bd
         return BTSTACK_MEMORY_ALLOC_FAILED;
     }
 
-    // add to connections list
-    btstack_linked_list_add(&l2cap_channels, (btstack_linked_item_t *) channel);
+    l2cap_start_outgoing_channel(channel, out_local_cid);
+    return 0;
+}
 
-    // store local_cid
-    if (out_local_cid){
-       *out_local_cid = channel->local_cid;
-    }
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_addr_t address, uint16_t psm, 
+    l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size, uint16_t * out_local_cid){
 
-    // check if hci connection is already usable
-    hci_connection_t * conn = hci_connection_for_bd_addr_and_type(address, BD_ADDR_TYPE_CLASSIC);
-    if (conn){
-        log_info("l2cap_create_channel, hci connection already exists");
-        l2cap_handle_connection_complete(conn->con_handle, channel);
-        // check if remote supported fearures are already received
-        if (conn->bonding_flags & BONDING_RECEIVED_REMOTE_FEATURES) {
-            l2cap_handle_remote_supported_features_received(channel);
-        }
+    log_info("L2CAP_CREATE_ERTM_CHANNEL addr %s psm 0x%x mode %u", bd_addr_to_str(address), psm, ertm_config->mode);
+
+    l2cap_channel_t * channel = l2cap_create_channel_entry(packet_handler, address, BD_ADDR_TYPE_CLASSIC, psm, ertm_config->local_mtu, LEVEL_0);
+    if (!channel) {
+        return BTSTACK_MEMORY_ALLOC_FAILED;
     }
 
-    l2cap_run();
+    uint8_t status = l2cap_ertm_setup_channel(channel, ertm_config, buffer, size);
+    if (status) {
+        btstack_memory_l2cap_channel_free(channel);
+        return status;
+    }
 
+    l2cap_start_outgoing_channel(channel, out_local_cid);
     return 0;
 }
+#endif
 
 void 
 l2cap_disconnect(uint16_t local_cid, uint8_t reason){
@@ -1061,6 +1806,11 @@ static void l2cap_notify_channel_can_send(void){
     while (btstack_linked_list_iterator_has_next(&it)){
         l2cap_channel_t * channel = (l2cap_channel_t *) btstack_linked_list_iterator_next(&it);
         if (!channel->waiting_for_can_send_now) continue;
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+        if (channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+            if (!l2cap_ertm_can_store_packet_now(channel)) continue;
+        } else
+#endif
         if (!hci_can_send_acl_packet_now(channel->con_handle)) continue;
         channel->waiting_for_can_send_now = 0;
         l2cap_emit_can_send_now(channel->packet_handler, channel->local_cid);
@@ -1072,7 +1822,10 @@ static void l2cap_notify_channel_can_send(void){
         if (!fixed_channels[i].callback) continue;
         if (!fixed_channels[i].waiting_for_can_send_now) continue;
         int can_send = 0;
-        if (l2cap_fixed_channel_table_index_is_le(i)){
+        if (hci_connection_for_handle(fixed_channels[i].con_handle)){
+            // check controller of requesting connection
+            can_send = hci_can_send_acl_packet_now(fixed_channels[i].con_handle);
+        } else if (l2cap_fixed_channel_table_index_is_le(i)){
 #ifdef ENABLE_BLE
             can_send = hci_can_send_acl_le_packet_now();
 #endif
@@ -1153,6 +1906,9 @@ static void l2cap_hci_event_handler(uint8_t packet_type, uint16_t cid, uint8_t *
                 if (channel->con_handle != handle) continue;
                 l2cap_emit_channel_closed(channel);
                 l2cap_stop_rtx(channel);
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                l2cap_ertm_stop_timer(channel);
+#endif
                 btstack_linked_list_iterator_remove(&it);
                 btstack_memory_l2cap_channel_free(channel);
             }
@@ -1328,6 +2084,26 @@ void l2cap_accept_connection(uint16_t local_cid){
     l2cap_run();
 }
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+uint8_t l2cap_accept_ertm_connection(uint16_t local_cid, l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size){
+    log_info("L2CAP_ACCEPT_ERTM_CONNECTION local_cid 0x%x", local_cid);
+    l2cap_channel_t * channel = l2cap_get_channel_for_local_cid(local_cid);
+    if (!channel) {
+        log_error("l2cap_accept_ertm_connection called but local_cid 0x%x not found", local_cid);
+        return L2CAP_LOCAL_CID_DOES_NOT_EXIST;
+    }
+
+    uint8_t status = l2cap_ertm_setup_channel(channel, ertm_config, buffer, size);
+    if (status) return status;
+
+    channel->state = L2CAP_STATE_WILL_SEND_CONNECTION_RESPONSE_ACCEPT;
+
+    // process
+    l2cap_run();
+    return 0;
+}
+#endif
+
 void l2cap_decline_connection(uint16_t local_cid){
     log_info("L2CAP_DECLINE_CONNECTION local_cid 0x%x", local_cid);
     l2cap_channel_t * channel = l2cap_get_channel_for_local_cid( local_cid);
@@ -1340,6 +2116,31 @@ void l2cap_decline_connection(uint16_t local_cid){
     l2cap_run();
 }
 
+static void l2cap_signaling_handle_configure_request_mode(l2cap_channel_t *channel, uint8_t * option){
+    // mode(8), tx window(8), max transmit(8), retransmission timeout(16), monitor timeout(16), mps(16)
+    l2cap_channel_mode_t mode = (l2cap_channel_mode_t) option[0];
+    log_info("l2cap cid 0x%02x, remote requests mode %u", channel->local_cid, mode);
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC && mode == channel->mode){
+        channel->remote_tx_window    = btstack_min(btstack_max(option[1], 1), L2CAP_ERTM_MAX_TX_WINDOW);
+        channel->remote_max_transmit = option[2];
+        channel->remote_mps          = little_endian_read_16(option, 7);
+        channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_ERTM);
+        return;
+    }
+    if (channel->mode != L2CAP_CHANNEL_MODE_BASIC && mode == L2CAP_CHANNEL_MODE_BASIC && !channel->mode_mandatory){
+        l2cap_ertm_fall_back_to_basic_mode(channel);
+        return;
+    }
+    l2cap_channel_mode_t own_mode = channel->mode;
+#else
+    l2cap_channel_mode_t own_mode = L2CAP_CHANNEL_MODE_BASIC;
+#endif
+    if (mode != own_mode){
+        channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT);
+    }
+}
+
 static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, uint8_t *command){
 
     channel->remote_sig_id = command[L2CAP_SIGNALING_COMMAND_SIGID_OFFSET];
@@ -1352,6 +2153,7 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
     // accept the other's configuration options
     uint16_t end_pos = 4 + little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_LENGTH_OFFSET);
     uint16_t pos     = 8;
+    int      mode_option_found = 0;
     while (pos < end_pos){
         uint8_t option_hint = command[pos] >> 7;
         uint8_t option_type = command[pos] & 0x7f;
@@ -1368,6 +2170,11 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
         if (option_type == 2 && length == 2){
             channel->flush_timeout = little_endian_read_16(command, pos);
         }
+        // Retransmission and Flow Control
+        if (option_type == L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL && length == L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN){
+            mode_option_found = 1;
+            l2cap_signaling_handle_configure_request_mode(channel, &command[pos]);
+        }
         // check for unknown options
         if (option_hint == 0 && (option_type == 0 || option_type >= 0x07)){
             log_info("l2cap cid %u, unknown options", channel->local_cid);
@@ -1375,6 +2182,19 @@ static void l2cap_signaling_handle_configure_request(l2cap_channel_t *channel, u
         }
         pos += length;
     }
+
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    // no Retransmission and Flow Control option: remote requests Basic mode
+    if (!mode_option_found && channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+        if (channel->mode_mandatory){
+            channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT);
+        } else {
+            l2cap_ertm_fall_back_to_basic_mode(channel);
+        }
+    }
+#else
+    UNUSED(mode_option_found);
+#endif
 }
 
 static int l2cap_channel_ready_for_open(l2cap_channel_t *channel){
@@ -1387,6 +2207,42 @@ static int l2cap_channel_ready_for_open(l2cap_channel_t *channel){
 }
 
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+static void l2cap_signaling_handle_configure_response(l2cap_channel_t *channel, uint16_t result, uint8_t *command){
+
+    if (channel->mode == L2CAP_CHANNEL_MODE_BASIC) return;
+
+    uint16_t end_pos = 4 + little_endian_read_16(command, L2CAP_SIGNALING_COMMAND_LENGTH_OFFSET);
+    uint16_t pos     = 10;
+    while (pos < end_pos){
+        uint8_t option_type = command[pos] & 0x7f;
+        uint8_t length      = command[pos+1];
+        pos += 2;
+        if (option_type == L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL && length == L2CAP_CONFIG_OPTION_RETRANSMISSION_AND_FLOW_CONTROL_LEN){
+            l2cap_channel_mode_t mode = (l2cap_channel_mode_t) command[pos];
+            if (result == 0){
+                // use timeouts provided by remote
+                if (mode == L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION){
+                    uint16_t retransmission_timeout_ms = little_endian_read_16(command, pos + 3);
+                    uint16_t monitor_timeout_ms        = little_endian_read_16(command, pos + 5);
+                    if (retransmission_timeout_ms) channel->local_retransmission_timeout_ms = retransmission_timeout_ms;
+                    if (monitor_timeout_ms)        channel->local_monitor_timeout_ms        = monitor_timeout_ms;
+                }
+            } else if (result == L2CAP_CONF_RESULT_UNACCEPTABLE_PARAMETERS && mode != channel->mode){
+                if (mode == L2CAP_CHANNEL_MODE_BASIC && !channel->mode_mandatory){
+                    // new Configure Request without Retransmission and Flow Control option is sent
+                    l2cap_ertm_fall_back_to_basic_mode(channel);
+                } else {
+                    log_info("l2cap cid 0x%02x, remote rejected mode %u, proposes %u", channel->local_cid, channel->mode, mode);
+                    channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                }
+            }
+        }
+        pos += length;
+    }
+}
+#endif
+
 static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *command){
 
     uint8_t  code       = command[L2CAP_SIGNALING_COMMAND_CODE_OFFSET];
@@ -1468,6 +2324,10 @@ static void l2cap_signaling_handler_channel(l2cap_channel_t *channel, uint8_t *c
                     break;
                 case CONFIGURE_RESPONSE:
                     l2cap_stop_rtx(channel);
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                    l2cap_signaling_handle_configure_response(channel, result, command);
+                    if (channel->state != L2CAP_STATE_CONFIG) break;
+#endif
                     switch (result){
                         case 0: // success
                             channelStateVarSetFlag(channel, L2CAP_CHANNEL_STATE_VAR_RCVD_CONF_RSP);
@@ -1628,7 +2488,7 @@ static int l2cap_le_signaling_handler_dispatch(hci_con_handle_t handle, uint8_t
                 }
                 int update_parameter = 1;
                 le_connection_parameter_range_t existing_range;
-                gap_get_connection_parameter_range(&existing_range);
+                gap_get_connection_parameter_range_for_con_handle(handle, &existing_range);
                 uint16_t le_conn_interval_min = little_endian_read_16(command,4);
                 uint16_t le_conn_interval_max = little_endian_read_16(command,6);
                 uint16_t le_conn_latency = little_endian_read_16(command,8);
@@ -1927,7 +2787,14 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
             // Find channel for this channel_id and connection handle
             l2cap_channel = l2cap_get_channel_for_local_cid(channel_id);
             if (l2cap_channel) {
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+                if (l2cap_channel->mode != L2CAP_CHANNEL_MODE_BASIC){
+                    l2cap_ertm_handle_packet(l2cap_channel, &packet[HCI_ACL_HEADER_SIZE], size - HCI_ACL_HEADER_SIZE);
+                    break;
+                }
+#endif
                 l2cap_dispatch_to_channel(l2cap_channel, L2CAP_DATA_PACKET, &packet[COMPLETE_L2CAP_HEADER], size-COMPLETE_L2CAP_HEADER);
+                break;
             }
 #endif
 #ifdef ENABLE_LE_DATA_CHANNELS
@@ -1942,18 +2809,37 @@ static void l2cap_acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *pa
                 l2cap_channel->credits_incoming--;
 
                 // automatic credits
-                if (l2cap_channel->credits_incoming < L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_WATERMARK && l2cap_channel->automatic_credits){
-                    l2cap_channel->new_credits_incoming = L2CAP_LE_DATA_CHANNELS_AUTOMATIC_CREDITS_INCREMENT;
+                if (l2cap_channel->automatic_credits){
+                    l2cap_le_update_automatic_credits(l2cap_channel);
+                }
+
+                // PDU larger than MPS
+                if (size - COMPLETE_L2CAP_HEADER > l2cap_channel->local_mps){
+                    log_error("LE Data Channel PDU of size %u larger than MPS %u", size - COMPLETE_L2CAP_HEADER, l2cap_channel->local_mps);
+                    l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                    break;
                 }
 
                 // first fragment
                 uint16_t pos = 0;
                 if (!l2cap_channel->receive_sdu_len){
-                    l2cap_channel->receive_sdu_len = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
+                    if (size < COMPLETE_L2CAP_HEADER + 2) break;
+                    uint16_t sdu_len = little_endian_read_16(packet, COMPLETE_L2CAP_HEADER);
+                    if (sdu_len > l2cap_channel->local_mtu){
+                        log_error("LE Data Channel SDU of size %u larger than MTU %u", sdu_len, l2cap_channel->local_mtu);
+                        l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                        break;
+                    }
+                    l2cap_channel->receive_sdu_len = sdu_len;
                     l2cap_channel->receive_sdu_pos = 0;                   
                     pos  += 2;
                     size -= 2;
                 }
+                if (l2cap_channel->receive_sdu_pos + size - COMPLETE_L2CAP_HEADER > l2cap_channel->receive_sdu_len){
+                    log_error("LE Data Channel SDU overrun");
+                    l2cap_channel->state = L2CAP_STATE_WILL_SEND_DISCONNECT_REQUEST;
+                    break;
+                }
                 memcpy(&l2cap_channel->receive_sdu_buffer[l2cap_channel->receive_sdu_pos], &packet[COMPLETE_L2CAP_HEADER+pos], size-COMPLETE_L2CAP_HEADER);
                 l2cap_channel->receive_sdu_pos += size - COMPLETE_L2CAP_HEADER;
                 // done?
@@ -1986,6 +2872,9 @@ void l2cap_finialize_channel_close(l2cap_channel_t * channel){
     l2cap_emit_channel_closed(channel);
     // discard channel
     l2cap_stop_rtx(channel);
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    l2cap_ertm_stop_timer(channel);
+#endif
     btstack_linked_list_remove(&l2cap_channels, (btstack_linked_item_t *) channel);
     btstack_memory_l2cap_channel_free(channel);
 }
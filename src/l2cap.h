@@ -108,9 +108,42 @@ typedef enum {
     L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_INVALID = 1 << 8,   // in CONF RSP, send UNKNOWN OPTIONS
     L2CAP_CHANNEL_STATE_VAR_SEND_CMD_REJ_UNKNOWN  = 1 << 9,   // send CMD_REJ with reason unknown
     L2CAP_CHANNEL_STATE_VAR_SEND_CONN_RESP_PEND   = 1 << 10,  // send Connection Respond with pending
+    L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_ERTM    = 1 << 11,  // in CONF RSP, add Retransmission and Flow Control option
+    L2CAP_CHANNEL_STATE_VAR_SEND_CONF_RSP_REJECT  = 1 << 12,  // in CONF RSP, send UNACCEPTABLE PARAMETERS with own mode
     L2CAP_CHANNEL_STATE_VAR_INCOMING              = 1 << 15,  // channel is incoming
 } L2CAP_CHANNEL_STATE_VAR;
 
+// channel modes from Retransmission and Flow Control option
+typedef enum {
+    L2CAP_CHANNEL_MODE_BASIC                   = 0,
+    L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION = 3,
+    L2CAP_CHANNEL_MODE_STREAMING_MODE          = 4,
+} l2cap_channel_mode_t;
+
+// configuration for Enhanced Retransmission and Streaming Mode channels
+typedef struct {
+    // L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION or L2CAP_CHANNEL_MODE_STREAMING_MODE
+    l2cap_channel_mode_t mode;
+    // if set, the channel is closed if the remote does not support the mode, otherwise Basic mode is used
+    uint8_t  mode_mandatory;
+    // number of transmissions of a single I-frame before the channel is closed, 0 = infinite
+    uint8_t  max_transmit;
+    uint16_t retransmission_timeout_ms;
+    uint16_t monitor_timeout_ms;
+    // max incoming SDU size, used for reassembly
+    uint16_t local_mtu;
+    // number of outgoing I-frames that can be stored for retransmission, 1..63
+    uint8_t  num_tx_buffers;
+} l2cap_ertm_config_t;
+
+// state of an outgoing I-frame stored for retransmission
+typedef struct {
+    uint16_t len;
+    uint8_t  sar;
+    uint8_t  retransmission_requested;
+    uint8_t  transmissions;
+} l2cap_ertm_tx_packet_state_t;
+
 // info regarding an actual connection
 typedef struct {
     // linked list - assert: first field
@@ -162,6 +195,7 @@ typedef struct {
     uint16_t   send_sdu_pos;
 
     // max PDU size
+    uint16_t  local_mps;
     uint16_t  remote_mps;
 
     // credits for outgoing traffic
@@ -176,6 +210,58 @@ typedef struct {
     // automatic credits incoming
     uint16_t automatic_credits;
 
+    // nr of credits granted per round trip, doubled whenever remote ran out of credits
+    uint16_t automatic_credits_increment;
+
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+    // Enhanced Retransmission and Streaming Mode
+
+    l2cap_channel_mode_t mode;
+    uint8_t   mode_mandatory;
+
+    // retransmission or monitor timer
+    btstack_timer_source_t ertm_timer;
+    uint8_t   ertm_timer_state;
+    uint8_t   monitor_retry_count;
+
+    // own configuration
+    uint8_t   local_max_transmit;
+    uint16_t  local_retransmission_timeout_ms;
+    uint16_t  local_monitor_timeout_ms;
+
+    // from remote Configure Request
+    uint8_t   remote_tx_window;
+    uint8_t   remote_max_transmit;
+
+    // outgoing I-frames: next to store, next to send, oldest unacknowledged
+    uint8_t   next_tx_seq;
+    uint8_t   tx_send_seq;
+    uint8_t   expected_ack_seq;
+
+    // incoming I-frames: next expected, last acknowledged
+    uint8_t   expected_tx_seq;
+    uint8_t   acked_tx_seq;
+
+    uint8_t   remote_busy;
+    uint8_t   rej_actioned;
+    uint8_t   send_supervisor_frame_reject;
+    uint8_t   send_supervisor_frame_poll;
+    uint8_t   send_final_bit;
+
+    // storage for outgoing I-frames, indexed by tx_seq % num_tx_buffers
+    uint8_t   num_tx_buffers;
+    uint16_t  tx_packet_size;
+    uint8_t   tx_read_index;    // slot of expected_ack_seq
+    l2cap_ertm_tx_packet_state_t * tx_packets_state;
+    uint8_t * tx_packets_data;
+
+    // reassembly of segmented incoming SDUs
+    uint8_t * reassembly_buffer;
+    uint16_t  reassembly_sdu_length;
+    uint16_t  reassembly_pos;
+    uint8_t   reassembly_active;
+#endif
+
 } l2cap_channel_t;
 
 // info regarding potential connections
@@ -321,6 +407,34 @@ int l2cap_send_prepared(uint16_t local_cid, uint16_t len);
  */
 void l2cap_release_packet_buffer(void);
 
+#ifdef ENABLE_L2CAP_ENHANCED_RETRANSMISSION_MODE
+/** 
+ * @brief Creates L2CAP channel in Enhanced Retransmission or Streaming Mode to the PSM of a remote device.
+ * @note The buffer stores outgoing I-frames until they are acknowledged and incoming SDUs during reassembly.
+ *       It has to stay valid until L2CAP_EVENT_CHANNEL_CLOSED or a failed L2CAP_EVENT_CHANNEL_OPENED is received.
+ * @param packet_handler
+ * @param address
+ * @param psm
+ * @param ertm_config
+ * @param buffer for outgoing I-frames and reassembly
+ * @param size of buffer
+ * @param local_cid
+ * @return status
+ */
+uint8_t l2cap_create_ertm_channel(btstack_packet_handler_t packet_handler, bd_addr_t address, uint16_t psm, 
+    l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size, uint16_t * out_local_cid);
+
+/** 
+ * @brief Accepts incoming L2CAP connection in Enhanced Retransmission or Streaming Mode.
+ * @param local_cid
+ * @param ertm_config
+ * @param buffer for outgoing I-frames and reassembly, see l2cap_create_ertm_channel
+ * @param size of buffer
+ * @return status
+ */
+uint8_t l2cap_accept_ertm_connection(uint16_t local_cid, l2cap_ertm_config_t * ertm_config, uint8_t * buffer, uint32_t size);
+#endif
+
 
 //
 // LE Connection Oriented Channels feature with the LE Credit Based Flow Control Mode == LE Data Channel
@@ -106,7 +106,7 @@ static uint16_t l2cap_create_signaling_internal(uint8_t * acl_buffer, hci_con_ha
         return 0;
     }
 
-    int pb = hci_non_flushable_packet_boundary_flag_supported() ? 0x00 : 0x02;
+    int pb = hci_non_flushable_packet_boundary_flag_supported_for_con_handle(handle) ? 0x00 : 0x02;
 
     // 0 - Connection handle : PB=pb : BC=00 
     little_endian_store_16(acl_buffer, 0, handle | (pb << 12) | (0 << 14));
@@ -0,0 +1,284 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_util.h"
+#include "classic/a2dp_sink_jitter_buffer.h"
+#include "classic/btstack_sbc.h"
+
+// offline simulation: SBC stream is encoded on the fly, sent with source clock, delivered in order
+// with jitter and loss like L2CAP, and played back with sink clock in DMA sized chunks
+
+#define SAMPLE_RATE         44100
+#define SBC_FRAMES_PER_PKT  5
+#define AUDIO_FRAMES_PER_SBC_FRAME 128
+#define FRAMES_PER_PACKET   (SBC_FRAMES_PER_PKT * AUDIO_FRAMES_PER_SBC_FRAME)
+#define DMA_FRAMES          128
+#define MAX_PACKET_SIZE     700
+#define MAX_PENDING         256
+
+typedef struct {
+    int32_t  drift_ppm;            // source clock relative to sink clock
+    uint32_t jitter_ms;            // uniform random transmission delay, packets stay in order
+    uint32_t loss_period;          // drop every n-th packet, 0 = none
+    uint32_t late_sequence;        // packet delivered after its successor, 0 = none
+    uint32_t outage_start_ms;      // no packets delivered in this interval
+    uint32_t outage_duration_ms;
+    int      timestamp_in_ms;      // RTP timestamps like a2dp_source.c
+    uint32_t warmup_ms;            // statistics are reset after warmup
+} trace_t;
+
+typedef struct {
+    double   arrival;              // sink frames
+    uint16_t len;
+    uint8_t  data[MAX_PACKET_SIZE];
+} packet_t;
+
+// FIFO, arrival is monotonic
+static packet_t pending[MAX_PENDING + 1];
+static int      num_pending;
+static double   last_arrival;
+static uint32_t packets_dropped;
+static int      max_sample_step;   // largest difference between consecutive output samples during playback
+
+static uint32_t lcg_state;
+static uint32_t lcg_next(void){
+    lcg_state = lcg_state * 1664525 + 1013904223;
+    return lcg_state >> 8;
+}
+
+static btstack_sbc_encoder_state_t encoder_state;
+static uint32_t sine_phase;
+
+static uint16_t encode_packet(uint8_t * packet, uint16_t sequence_number, uint32_t timestamp){
+    packet[0] = 0x80;
+    packet[1] = 0x60;
+    big_endian_store_16(packet, 2, sequence_number);
+    big_endian_store_32(packet, 4, timestamp);
+    big_endian_store_32(packet, 8, 0x1234);
+    packet[12] = SBC_FRAMES_PER_PKT;
+    uint16_t pos = 13;
+    int i, j;
+    for (i = 0; i < SBC_FRAMES_PER_PKT; i++){
+        int16_t pcm[AUDIO_FRAMES_PER_SBC_FRAME * 2];
+        for (j = 0; j < AUDIO_FRAMES_PER_SBC_FRAME; j++){
+            int16_t sample = (int16_t) (8000 * sin(2 * M_PI * 1000 * sine_phase++ / SAMPLE_RATE));
+            pcm[j * 2]     = sample;
+            pcm[j * 2 + 1] = sample;
+        }
+        btstack_sbc_encoder_process_data(pcm);
+        uint16_t len = btstack_sbc_encoder_sbc_buffer_length();
+        memcpy(&packet[pos], btstack_sbc_encoder_sbc_buffer(), len);
+        pos += len;
+    }
+    return pos;
+}
+
+static void simulate(a2dp_sink_jitter_buffer_t * jitter_buffer, const trace_t * trace, uint32_t duration_ms, uint32_t seed){
+    lcg_state = seed;
+    num_pending = 0;
+    last_arrival = 0;
+    packets_dropped = 0;
+    max_sample_step = 0;
+    sine_phase = 0;
+    btstack_sbc_encoder_init(&encoder_state, SBC_MODE_STANDARD, 16, 8, 0, SAMPLE_RATE, 35);
+
+    double   packet_interval = FRAMES_PER_PACKET / (1.0 + trace->drift_ppm / 1000000.0);
+    double   outage_start = trace->outage_start_ms * (SAMPLE_RATE / 1000.0);
+    double   outage_end   = outage_start + trace->outage_duration_ms * (SAMPLE_RATE / 1000.0);
+    uint32_t sequence_number = 1;
+    uint32_t warmup_end = trace->warmup_ms * SAMPLE_RATE / 1000;
+    uint32_t clock;
+    int16_t  pcm[DMA_FRAMES * 2];
+    int16_t  last_sample = 0;
+    int      i;
+
+    uint32_t end = (uint32_t) ((uint64_t) duration_ms * SAMPLE_RATE / 1000);
+    for (clock = 0; clock < end; clock += DMA_FRAMES){
+        // send all packets that are due
+        while ((sequence_number - 1) * packet_interval <= clock){
+            double   arrival   = (sequence_number - 1) * packet_interval;
+            uint32_t timestamp = trace->timestamp_in_ms ? (sequence_number - 1) * FRAMES_PER_PACKET * 1000 / SAMPLE_RATE : (sequence_number - 1) * FRAMES_PER_PACKET;
+            packet_t * packet = &pending[num_pending];
+            packet->len = encode_packet(packet->data, (uint16_t) sequence_number, timestamp);
+            if (trace->jitter_ms){
+                arrival += (lcg_next() % (trace->jitter_ms * SAMPLE_RATE / 1000));
+            }
+            if (arrival >= outage_start && arrival < outage_end){
+                arrival = outage_end;
+            }
+            if (arrival < last_arrival){
+                arrival = last_arrival;
+            }
+            last_arrival = arrival;
+            packet->arrival = arrival;
+            if (trace->loss_period && (sequence_number % trace->loss_period) == 0){
+                packets_dropped++;
+            } else {
+                num_pending++;
+            }
+            // hold back late packet until its successor has been sent
+            if (trace->late_sequence && sequence_number == trace->late_sequence){
+                pending[MAX_PENDING] = pending[--num_pending];
+            }
+            if (trace->late_sequence && sequence_number == trace->late_sequence + 1){
+                pending[num_pending] = pending[MAX_PENDING];
+                pending[num_pending++].arrival = arrival;
+            }
+            sequence_number++;
+        }
+        // deliver
+        while (num_pending && pending[0].arrival <= clock){
+            a2dp_sink_jitter_buffer_put_media_packet(jitter_buffer, pending[0].data, pending[0].len);
+            num_pending--;
+            memmove(&pending[0], &pending[1], num_pending * sizeof(packet_t));
+        }
+        int was_playing = a2dp_sink_jitter_buffer_is_playing(jitter_buffer);
+        a2dp_sink_jitter_buffer_read(jitter_buffer, pcm, DMA_FRAMES);
+        if (was_playing && a2dp_sink_jitter_buffer_is_playing(jitter_buffer)){
+            for (i = 0; i < DMA_FRAMES; i++){
+                max_sample_step = btstack_max(max_sample_step, abs(pcm[i * 2] - last_sample));
+                last_sample = pcm[i * 2];
+            }
+        }
+        last_sample = pcm[(DMA_FRAMES - 1) * 2];
+        if (warmup_end >= clock && warmup_end < clock + DMA_FRAMES){
+            a2dp_sink_jitter_buffer_reset_statistics(jitter_buffer);
+        }
+    }
+}
+
+// 1 kHz sine with amplitude 8000 changes by up to 1140 per sample
+#define MAX_SINE_STEP 1200
+
+static uint8_t storage[SAMPLE_RATE / 4 * A2DP_SINK_JITTER_BUFFER_NUM_CHANNELS * 2];
+
+TEST_GROUP(JitterBuffer){
+    a2dp_sink_jitter_buffer_t jitter_buffer;
+    a2dp_sink_jitter_buffer_statistics_t stats;
+    trace_t trace;
+
+    void setup(void){
+        memset(&trace, 0, sizeof(trace));
+        a2dp_sink_jitter_buffer_init(&jitter_buffer, SAMPLE_RATE, storage, sizeof(storage));
+    }
+    void run_trace(uint32_t duration_ms){
+        simulate(&jitter_buffer, &trace, duration_ms, 0x1234);
+        a2dp_sink_jitter_buffer_get_statistics(&jitter_buffer, &stats);
+    }
+};
+
+TEST(JitterBuffer, Prebuffering){
+    int16_t pcm[DMA_FRAMES * 2];
+    a2dp_sink_jitter_buffer_read(&jitter_buffer, pcm, DMA_FRAMES);
+    CHECK_EQUAL(0, a2dp_sink_jitter_buffer_is_playing(&jitter_buffer));
+    CHECK_EQUAL(0, pcm[0]);
+    run_trace(1000);
+    CHECK_EQUAL(1, a2dp_sink_jitter_buffer_is_playing(&jitter_buffer));
+    CHECK_EQUAL(0, stats.underruns);
+}
+
+TEST(JitterBuffer, Steady){
+    run_trace(10000);
+    CHECK(max_sample_step < MAX_SINE_STEP);
+    CHECK_EQUAL(0, stats.packets_lost);
+    CHECK_EQUAL(0, stats.packets_late);
+    CHECK_EQUAL(0, stats.frames_concealed);
+    CHECK_EQUAL(0, stats.frames_dropped);
+    CHECK_EQUAL(0, stats.underruns);
+    CHECK(stats.packets_received > 10000 * SAMPLE_RATE / 1000 / FRAMES_PER_PACKET - 2);
+}
+
+TEST(JitterBuffer, Jitter){
+    trace.jitter_ms = 60;
+    trace.warmup_ms = 5000;
+    run_trace(20000);
+    CHECK_EQUAL(0, stats.underruns);
+    CHECK_EQUAL(0, stats.frames_concealed);
+    CHECK(stats.jitter > 0);
+    CHECK(stats.target_depth > SAMPLE_RATE * 60 / 1000);
+}
+
+TEST(JitterBuffer, DriftFast){
+    trace.drift_ppm = 200;
+    trace.jitter_ms = 20;
+    run_trace(120000);
+    CHECK_EQUAL(0, stats.underruns);
+    CHECK_EQUAL(0, stats.frames_dropped);
+    CHECK(abs(stats.drift_ppm - 200) < 30);
+    CHECK(max_sample_step < MAX_SINE_STEP);
+    CHECK(abs((int) stats.buffer_depth - (int) stats.target_depth) < FRAMES_PER_PACKET + DMA_FRAMES);
+}
+
+TEST(JitterBuffer, DriftSlow){
+    trace.drift_ppm = -300;
+    run_trace(120000);
+    CHECK_EQUAL(0, stats.underruns);
+    CHECK_EQUAL(0, stats.frames_concealed);
+    CHECK(abs(stats.drift_ppm + 300) < 30);
+    CHECK(abs((int) stats.buffer_depth - (int) stats.target_depth) < FRAMES_PER_PACKET + DMA_FRAMES);
+}
+
+TEST(JitterBuffer, Loss){
+    trace.loss_period = 50;
+    run_trace(10000);
+    CHECK_EQUAL(packets_dropped, stats.packets_lost);
+    CHECK_EQUAL(packets_dropped * FRAMES_PER_PACKET, stats.frames_concealed);
+    CHECK_EQUAL(0, stats.underruns);
+    // concealment without clicks
+    CHECK(max_sample_step < 2 * MAX_SINE_STEP);
+}
+
+TEST(JitterBuffer, LossTimestampInMs){
+    trace.loss_period = 50;
+    trace.timestamp_in_ms = 1;
+    run_trace(10000);
+    CHECK_EQUAL(packets_dropped, stats.packets_lost);
+    CHECK_EQUAL(packets_dropped * FRAMES_PER_PACKET, stats.frames_concealed);
+    CHECK_EQUAL(0, stats.underruns);
+}
+
+TEST(JitterBuffer, Late){
+    trace.late_sequence = 100;
+    run_trace(5000);
+    CHECK_EQUAL(1, stats.packets_lost);
+    CHECK_EQUAL(1, stats.packets_late);
+    CHECK_EQUAL(FRAMES_PER_PACKET, stats.frames_concealed);
+    CHECK_EQUAL(0, stats.underruns);
+}
+
+TEST(JitterBuffer, ShortOutage){
+    // shorter than buffer depth plus max concealment: concealed by reader, late audio is dropped
+    trace.outage_start_ms = 3000;
+    trace.outage_duration_ms = 100;
+    run_trace(6000);
+    CHECK_EQUAL(0, stats.underruns);
+    CHECK_EQUAL(0, stats.packets_lost);
+    CHECK_EQUAL(0, stats.frames_dropped);
+    CHECK(a2dp_sink_jitter_buffer_is_playing(&jitter_buffer));
+}
+
+TEST(JitterBuffer, LongOutage){
+    trace.outage_start_ms = 3000;
+    trace.outage_duration_ms = 1000;
+    run_trace(8000);
+    CHECK_EQUAL(1, stats.underruns);
+    CHECK(a2dp_sink_jitter_buffer_is_playing(&jitter_buffer));
+}
+
+TEST(JitterBuffer, ResetStatistics){
+    trace.loss_period = 10;
+    run_trace(2000);
+    CHECK(stats.packets_lost > 0);
+    a2dp_sink_jitter_buffer_reset_statistics(&jitter_buffer);
+    a2dp_sink_jitter_buffer_get_statistics(&jitter_buffer, &stats);
+    CHECK_EQUAL(0, stats.packets_lost);
+    CHECK_EQUAL(0, stats.packets_received);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,314 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack.h"
+#include "classic/a2dp_source.h"
+#include "classic/a2dp_source_scheduler.h"
+#include "classic/btstack_sbc.h"
+
+// offline simulation: a2dp_source and run loop are replaced by a link model that
+// delivers can send now events with limited throughput and optional stalls
+
+#define SAMPLE_RATE     44100
+#define MIN_BITPOOL     2
+#define MAX_BITPOOL     53
+#define LOCAL_SEID      1
+#define MAX_PACKETS     20000
+
+typedef struct {
+    uint32_t send_ms;
+    uint32_t timestamp;
+    uint16_t len;
+    uint8_t  num_frames;
+} sent_packet_t;
+
+static sent_packet_t sent_packets[MAX_PACKETS];
+static int           num_sent_packets;
+
+// link model
+static uint32_t link_kbps;          // 0 = unlimited
+static uint32_t link_stall_start_ms;
+static uint32_t link_stall_duration_ms;
+static uint32_t link_busy_until_ms;
+static uint32_t run_loop_block_start_ms;
+static uint32_t run_loop_block_duration_ms;
+static int      can_send_now_requested;
+static int      max_payload_size;
+
+static btstack_packet_handler_t media_packet_handler;
+
+// run loop
+static uint32_t now_ms;
+static btstack_timer_source_t * active_timer;
+
+extern "C" void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = now_ms + timeout_in_ms;
+}
+extern "C" void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *_ts)){
+    ts->process = process;
+}
+extern "C" void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
+    active_timer = ts;
+}
+extern "C" int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
+    if (active_timer != ts) return 0;
+    active_timer = NULL;
+    return 1;
+}
+extern "C" uint32_t btstack_run_loop_get_time_ms(void){
+    return now_ms;
+}
+
+// a2dp source
+extern "C" uint8_t a2dp_source_stream_sbc_configuration(uint8_t int_seid, uint32_t * sampling_frequency, uint8_t * min_bitpool_value, uint8_t * max_bitpool_value){
+    UNUSED(int_seid);
+    *sampling_frequency = SAMPLE_RATE;
+    *min_bitpool_value  = MIN_BITPOOL;
+    *max_bitpool_value  = MAX_BITPOOL;
+    return 1;
+}
+extern "C" int a2dp_max_media_payload_size(uint8_t int_seid){
+    UNUSED(int_seid);
+    return max_payload_size;
+}
+extern "C" void a2dp_source_register_media_packet_handler(btstack_packet_handler_t callback){
+    media_packet_handler = callback;
+}
+extern "C" void a2dp_source_stream_endpoint_request_can_send_now(uint8_t local_seid){
+    UNUSED(local_seid);
+    can_send_now_requested = 1;
+}
+extern "C" int a2dp_source_stream_send_media_payload_with_timestamp(uint8_t int_seid, uint8_t * storage, int num_bytes_to_copy, uint8_t num_frames, uint8_t marker, uint32_t timestamp){
+    UNUSED(int_seid);
+    UNUSED(storage);
+    UNUSED(marker);
+    CHECK(num_bytes_to_copy + 1 <= max_payload_size);
+    if (num_sent_packets < MAX_PACKETS){
+        sent_packet_t * packet = &sent_packets[num_sent_packets++];
+        packet->send_ms    = now_ms;
+        packet->timestamp  = timestamp;
+        packet->len        = num_bytes_to_copy;
+        packet->num_frames = num_frames;
+    }
+    // L2CAP + ACL overhead ignored
+    if (link_kbps){
+        link_busy_until_ms = now_ms + (num_bytes_to_copy + 13) * 8 / link_kbps;
+    }
+    return max_payload_size + 12;
+}
+
+static void simulate(uint32_t duration_ms){
+    uint32_t end_ms = now_ms + duration_ms;
+    for (; now_ms < end_ms; now_ms++){
+        if (active_timer && (int32_t)(now_ms - active_timer->timeout) >= 0 && !(now_ms >= run_loop_block_start_ms && now_ms < run_loop_block_start_ms + run_loop_block_duration_ms)){
+            btstack_timer_source_t * timer = active_timer;
+            active_timer = NULL;
+            (*timer->process)(timer);
+        }
+        if (now_ms >= link_stall_start_ms && now_ms < link_stall_start_ms + link_stall_duration_ms) continue;
+        if ((int32_t)(now_ms - link_busy_until_ms) < 0) continue;
+        if (!can_send_now_requested || !media_packet_handler) continue;
+        can_send_now_requested = 0;
+        uint8_t event[8] = { HCI_EVENT_A2DP_META, 6, A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW, 0, 0, LOCAL_SEID, 0, 0};
+        (*media_packet_handler)(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+}
+
+static void produce_silence(int16_t * pcm, int num_frames, void * context){
+    UNUSED(context);
+    memset(pcm, 0, num_frames * 4);
+}
+
+// checks RTP timestamps are contiguous, returns number of discontinuities
+static int count_timestamp_gaps(void){
+    int gaps = 0;
+    int i;
+    for (i = 1; i < num_sent_packets; i++){
+        if (sent_packets[i].timestamp != sent_packets[i-1].timestamp + sent_packets[i-1].num_frames * 128){
+            gaps++;
+        }
+    }
+    return gaps;
+}
+
+static btstack_sbc_encoder_state_t encoder_state;
+static uint8_t queue_storage[4 * (1021 + 8)];
+
+TEST_GROUP(A2DPSourceScheduler){
+    a2dp_source_scheduler_statistics_t stats;
+
+    void setup(void){
+        now_ms = 1000;
+        active_timer = NULL;
+        num_sent_packets = 0;
+        link_kbps = 0;
+        link_stall_start_ms = 0;
+        link_stall_duration_ms = 0;
+        link_busy_until_ms = 0;
+        run_loop_block_start_ms = 0;
+        run_loop_block_duration_ms = 0;
+        can_send_now_requested = 0;
+        media_packet_handler = NULL;
+        max_payload_size = 1021 - 12;
+        btstack_sbc_encoder_init(&encoder_state, SBC_MODE_STANDARD, 16, 8, 0, SAMPLE_RATE, MAX_BITPOOL);
+        a2dp_source_scheduler_init(queue_storage, sizeof(queue_storage));
+        a2dp_source_scheduler_set_pcm_callback(&produce_silence, NULL);
+    }
+    void teardown(void){
+        a2dp_source_scheduler_stop();
+    }
+};
+
+TEST(A2DPSourceScheduler, StartStop){
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, a2dp_source_scheduler_start(LOCAL_SEID));
+    CHECK(media_packet_handler != NULL);
+    CHECK(active_timer != NULL);
+    a2dp_source_scheduler_stop();
+    CHECK(media_packet_handler == NULL);
+    CHECK(active_timer == NULL);
+}
+
+TEST(A2DPSourceScheduler, StorageTooSmall){
+    a2dp_source_scheduler_init(queue_storage, 1021);
+    CHECK_EQUAL(ERROR_CODE_MEMORY_CAPACITY_EXCEEDED, a2dp_source_scheduler_start(LOCAL_SEID));
+}
+
+TEST(A2DPSourceScheduler, Pacing){
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(10000);
+    a2dp_source_scheduler_get_statistics(&stats);
+
+    CHECK(num_sent_packets > 0);
+    CHECK_EQUAL(0, count_timestamp_gaps());
+    CHECK_EQUAL(0, stats.catch_up_packets);
+    CHECK_EQUAL(0, stats.frames_skipped);
+    CHECK_EQUAL(MAX_BITPOOL, stats.bitpool);
+    CHECK(stats.max_queue_depth <= 1);
+
+    // all audio sent, but not before it was due
+    int i;
+    uint32_t frames_sent = 0;
+    for (i = 0; i < num_sent_packets; i++){
+        frames_sent += sent_packets[i].num_frames * 128;
+        uint32_t due_ms = 1000 + (uint32_t) ((uint64_t) frames_sent * 1000 / SAMPLE_RATE);
+        CHECK(sent_packets[i].send_ms >= due_ms);
+        CHECK(sent_packets[i].send_ms <= due_ms + 2);
+    }
+    CHECK(frames_sent <= 10 * SAMPLE_RATE);
+    CHECK(frames_sent + sent_packets[0].num_frames * 128 >= 10 * SAMPLE_RATE);
+}
+
+TEST(A2DPSourceScheduler, PacketsFillMTU){
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(1000);
+    int i;
+    for (i = 0; i < num_sent_packets; i++){
+        uint16_t frame_len = sent_packets[i].len / sent_packets[i].num_frames;
+        CHECK(sent_packets[i].len + frame_len + 1 > max_payload_size);
+    }
+}
+
+TEST(A2DPSourceScheduler, SmallMTU){
+    // one 118 byte SBC frame per packet
+    max_payload_size = 200;
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(1000);
+    CHECK(num_sent_packets > 0);
+    CHECK_EQUAL(1, sent_packets[0].num_frames);
+    CHECK_EQUAL(0, count_timestamp_gaps());
+}
+
+TEST(A2DPSourceScheduler, CatchUp){
+    // media clock timer delayed by other run loop activity
+    run_loop_block_start_ms = 3000;
+    run_loop_block_duration_ms = 60;
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(5000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK_EQUAL(0, count_timestamp_gaps());
+    CHECK_EQUAL(0, stats.frames_skipped);
+    CHECK(stats.catch_up_packets > 0);
+}
+
+TEST(A2DPSourceScheduler, LinkStall){
+    // shorter than max latency and send queue
+    link_stall_start_ms = 3000;
+    link_stall_duration_ms = 60;
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(5000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK_EQUAL(0, count_timestamp_gaps());
+    CHECK_EQUAL(0, stats.frames_skipped);
+    CHECK(stats.max_queue_depth >= 2);
+    CHECK_EQUAL(0, stats.queue_depth);
+}
+
+TEST(A2DPSourceScheduler, SkipAfterStall){
+    link_stall_start_ms = 3000;
+    link_stall_duration_ms = 500;
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(5000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK(stats.frames_skipped > 0);
+    CHECK_EQUAL(0, stats.frames_skipped % 128);
+    CHECK(count_timestamp_gaps() >= 1);
+    CHECK_EQUAL(0, stats.queue_depth);
+    // stream continues on time
+    CHECK(sent_packets[num_sent_packets-1].send_ms >= 5000 + 1000 - 30);
+}
+
+TEST(A2DPSourceScheduler, BitpoolAdaptation){
+    // bitpool 53 needs about 330 kbit/s
+    link_kbps = 250;
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    simulate(20000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK(stats.bitpool < 40);
+    CHECK(stats.bitpool_changes > 0);
+
+    // steady after adaptation
+    a2dp_source_scheduler_reset_statistics();
+    simulate(5000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK_EQUAL(0, stats.frames_skipped);
+
+    // link recovers
+    link_kbps = 0;
+    simulate(60000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK_EQUAL(MAX_BITPOOL, stats.bitpool);
+}
+
+TEST(A2DPSourceScheduler, RingBuffer){
+    static uint8_t ring_buffer_storage[SAMPLE_RATE * 4];
+    static int16_t pcm[1000 * 2];
+    btstack_ring_buffer_t ring_buffer;
+    btstack_ring_buffer_init(&ring_buffer, ring_buffer_storage, sizeof(ring_buffer_storage));
+    a2dp_source_scheduler_set_pcm_callback(NULL, NULL);
+    a2dp_source_scheduler_set_pcm_ring_buffer(&ring_buffer);
+    memset(pcm, 0, sizeof(pcm));
+
+    // capture 1000 frames ahead, then in real time
+    btstack_ring_buffer_write(&ring_buffer, (uint8_t *) pcm, sizeof(pcm));
+    a2dp_source_scheduler_start(LOCAL_SEID);
+    int i;
+    for (i = 0; i < 1000; i++){
+        btstack_ring_buffer_write(&ring_buffer, (uint8_t *) pcm, 441 * 4);
+        simulate(10);
+    }
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK_EQUAL(0, stats.pcm_underruns);
+
+    // capture stops
+    simulate(1000);
+    a2dp_source_scheduler_get_statistics(&stats);
+    CHECK(stats.pcm_underruns > 0);
+    CHECK_EQUAL(0, count_timestamp_gaps());
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
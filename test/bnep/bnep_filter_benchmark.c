@@ -0,0 +1,109 @@
+// Benchmark for BNEP network protocol and multicast filters
+//
+// Measures bnep_send() per frame without filters and with full filter tables of
+// MAX_BNEP_NETFILTER / MAX_BNEP_MULTICAST_FILTER ranges, set in btstack_config.h.
+// Frames alternate between the start value of a range and a value outside of all ranges.
+//
+// Usage: bnep_filter_benchmark [iterations]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "btstack_config.h"
+#include "bluetooth.h"
+#include "btstack_util.h"
+#include "classic/bnep.h"
+#include "mock.h"
+
+static const bd_addr_t local_addr  = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01 };
+static const bd_addr_t remote_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x02 };
+
+static uint16_t bnep_cid;
+
+static uint32_t time_us(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t) (tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
+static void multicast_addr(uint32_t index, bd_addr_t addr){
+    addr[0] = 0x01;
+    addr[1] = 0x00;
+    addr[2] = 0x5e;
+    addr[3] = (index >> 16) & 0xff;
+    addr[4] = (index >>  8) & 0xff;
+    addr[5] =  index        & 0xff;
+}
+
+// send frames to all num_ranges ranges, odd values are filtered if filters are set
+static uint32_t benchmark_send(int iterations, int num_ranges, int multicast, const char * name){
+    uint8_t frame[60];
+    memset(frame, 0x55, sizeof(frame));
+    memcpy(&frame[0], remote_addr, sizeof(bd_addr_t));
+    memcpy(&frame[6], local_addr, sizeof(bd_addr_t));
+    big_endian_store_16(frame, 12, 0x0800);
+
+    int num_sent = mock_l2cap_num_packets_sent();
+    uint32_t start = time_us();
+    int i;
+    for (i = 0; i < iterations; i++){
+        uint32_t value = 0x100 * ((i >> 1) % num_ranges) + (i & 1);
+        if (multicast){
+            multicast_addr(value, frame);
+        } else {
+            big_endian_store_16(frame, 12, value);
+        }
+        bnep_send(bnep_cid, frame, sizeof(frame));
+    }
+    uint32_t duration_us = time_us() - start;
+    num_sent = mock_l2cap_num_packets_sent() - num_sent;
+    printf("%-32s %6u ns/frame, %u of %u frames sent\n", name,
+        (unsigned) (duration_us * 1000ULL / iterations), (unsigned) num_sent, (unsigned) iterations);
+    return duration_us;
+}
+
+int main(int argc, const char * argv[]){
+    int iterations = 1000000;
+    if (argc > 1){
+        iterations = atoi(argv[1]);
+    }
+    if (iterations <= 0) return 1;
+
+    mock_bnep_init();
+    bnep_cid = mock_bnep_connect();
+    if (!bnep_cid){
+        printf("BNEP connection failed\n");
+        return 1;
+    }
+
+    benchmark_send(iterations, MAX_BNEP_NETFILTER, 0, "no filter");
+
+    // ranges cover even values 0x0000, 0x0100, ...
+    uint16_t net_ranges[MAX_BNEP_NETFILTER * 2];
+    int i;
+    for (i = 0; i < MAX_BNEP_NETFILTER; i++){
+        net_ranges[i * 2]     = 0x100 * i;
+        net_ranges[i * 2 + 1] = 0x100 * i;
+    }
+    mock_bnep_set_net_filter(bnep_cid, net_ranges, MAX_BNEP_NETFILTER);
+    char name[40];
+    snprintf(name, sizeof(name), "net filter, %u ranges", MAX_BNEP_NETFILTER);
+    benchmark_send(iterations, MAX_BNEP_NETFILTER, 0, name);
+    mock_bnep_set_net_filter(bnep_cid, NULL, 0);
+
+    uint8_t multicast_ranges[MAX_BNEP_MULTICAST_FILTER * 12];
+    for (i = 0; i < MAX_BNEP_MULTICAST_FILTER; i++){
+        multicast_addr(0x100 * i, &multicast_ranges[i * 12]);
+        multicast_addr(0x100 * i, &multicast_ranges[i * 12 + 6]);
+    }
+    mock_bnep_set_multicast_filter(bnep_cid, multicast_ranges, MAX_BNEP_MULTICAST_FILTER);
+    snprintf(name, sizeof(name), "multicast filter, %u ranges", MAX_BNEP_MULTICAST_FILTER);
+    benchmark_send(iterations, MAX_BNEP_MULTICAST_FILTER, 1, name);
+
+    mock_bnep_disconnect(bnep_cid);
+    mock_bnep_deinit();
+    return 0;
+}
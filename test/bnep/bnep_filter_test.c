@@ -0,0 +1,292 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "bluetooth.h"
+#include "btstack_util.h"
+#include "classic/bnep.h"
+#include "mock.h"
+
+static const bd_addr_t local_addr  = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01 };
+static const bd_addr_t remote_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x02 };
+
+static uint16_t bnep_cid;
+
+// @returns 1 if frame with given destination and network protocol type passes the filters
+static int frame_sent(const bd_addr_t dest, uint16_t network_protocol_type){
+    uint8_t frame[18];
+    memcpy(&frame[0], dest, sizeof(bd_addr_t));
+    memcpy(&frame[6], local_addr, sizeof(bd_addr_t));
+    big_endian_store_16(frame, 12, network_protocol_type);
+    memset(&frame[14], 0x55, 4);
+    int num_packets_sent = mock_l2cap_num_packets_sent();
+    CHECK_EQUAL(0, bnep_send(bnep_cid, frame, sizeof(frame)));
+    return mock_l2cap_num_packets_sent() - num_packets_sent;
+}
+
+static int protocol_sent(uint16_t network_protocol_type){
+    return frame_sent(remote_addr, network_protocol_type);
+}
+
+static int multicast_sent(const bd_addr_t dest){
+    return frame_sent(dest, 0x0800);
+}
+
+// multicast address with 24 bit index in lower half
+static void multicast_addr(uint32_t index, bd_addr_t addr){
+    addr[0] = 0x01;
+    addr[1] = 0x00;
+    addr[2] = 0x5e;
+    addr[3] = (index >> 16) & 0xff;
+    addr[4] = (index >>  8) & 0xff;
+    addr[5] =  index        & 0xff;
+}
+
+static void multicast_range(uint8_t * range, uint32_t start, uint32_t end){
+    multicast_addr(start, &range[0]);
+    multicast_addr(end,   &range[6]);
+}
+
+TEST_GROUP(BnepNetFilter){
+    void setup(void){
+        mock_bnep_init();
+        bnep_cid = mock_bnep_connect();
+        CHECK(bnep_cid != 0);
+    }
+    void teardown(void){
+        mock_bnep_disconnect(bnep_cid);
+        mock_bnep_deinit();
+    }
+};
+
+TEST(BnepNetFilter, NoFilterPassesAll){
+    CHECK_EQUAL(1, protocol_sent(0x0000));
+    CHECK_EQUAL(1, protocol_sent(0x0800));
+    CHECK_EQUAL(1, protocol_sent(0xffff));
+}
+
+TEST(BnepNetFilter, EmptyListRemovesFilter){
+    const uint16_t ranges[] = { 0x0800, 0x0800 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, 1));
+    CHECK_EQUAL(0, protocol_sent(0x86dd));
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, NULL, 0));
+    CHECK_EQUAL(1, protocol_sent(0x86dd));
+    CHECK_EQUAL(1, protocol_sent(0x0800));
+}
+
+TEST(BnepNetFilter, RangeBoundaries){
+    const uint16_t ranges[] = { 0x0800, 0x0806 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, 1));
+    CHECK_EQUAL(0, protocol_sent(0x07ff));
+    CHECK_EQUAL(1, protocol_sent(0x0800));
+    CHECK_EQUAL(1, protocol_sent(0x0803));
+    CHECK_EQUAL(1, protocol_sent(0x0806));
+    CHECK_EQUAL(0, protocol_sent(0x0807));
+}
+
+TEST(BnepNetFilter, ValueRangeBoundaries){
+    const uint16_t ranges[] = { 0xffff, 0xffff, 0x0000, 0x0000 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, 2));
+    CHECK_EQUAL(1, protocol_sent(0x0000));
+    CHECK_EQUAL(0, protocol_sent(0x0001));
+    CHECK_EQUAL(0, protocol_sent(0x0800));
+    CHECK_EQUAL(0, protocol_sent(0xfffe));
+    CHECK_EQUAL(1, protocol_sent(0xffff));
+}
+
+TEST(BnepNetFilter, OverlappingAndAdjacentRanges){
+    // unsorted, 0x0850-0x0860 contained in merged range, 0x0901 adjacent
+    const uint16_t ranges[] = { 0x86dd, 0x86dd, 0x0805, 0x0900, 0x0850, 0x0860, 0x0800, 0x0810, 0x0901, 0x0910 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, 5));
+    CHECK_EQUAL(0, protocol_sent(0x07ff));
+    CHECK_EQUAL(1, protocol_sent(0x0800));
+    CHECK_EQUAL(1, protocol_sent(0x0811));
+    CHECK_EQUAL(1, protocol_sent(0x0900));
+    CHECK_EQUAL(1, protocol_sent(0x0901));
+    CHECK_EQUAL(1, protocol_sent(0x0910));
+    CHECK_EQUAL(0, protocol_sent(0x0911));
+    CHECK_EQUAL(0, protocol_sent(0x86dc));
+    CHECK_EQUAL(1, protocol_sent(0x86dd));
+    CHECK_EQUAL(0, protocol_sent(0x86de));
+}
+
+TEST(BnepNetFilter, IdenticalRanges){
+    const uint16_t ranges[] = { 0x0800, 0x0800, 0x0800, 0x0800 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, 2));
+    CHECK_EQUAL(0, protocol_sent(0x07ff));
+    CHECK_EQUAL(1, protocol_sent(0x0800));
+    CHECK_EQUAL(0, protocol_sent(0x0801));
+}
+
+TEST(BnepNetFilter, InvalidRangeIgnored){
+    const uint16_t ranges[] = { 0x0900, 0x0800, 0x0806, 0x0806 };
+    CHECK_EQUAL(BNEP_RESP_FILTER_ERR_INVALID_RANGE, mock_bnep_set_net_filter(bnep_cid, ranges, 2));
+    CHECK_EQUAL(0, protocol_sent(0x0800));
+    CHECK_EQUAL(0, protocol_sent(0x0850));
+    CHECK_EQUAL(1, protocol_sent(0x0806));
+}
+
+TEST(BnepNetFilter, TooManyRanges){
+    uint16_t ranges[(MAX_BNEP_NETFILTER + 1) * 2];
+    int i;
+    for (i = 0; i < MAX_BNEP_NETFILTER + 1; i++){
+        ranges[i * 2]     = i * 0x10;
+        ranges[i * 2 + 1] = i * 0x10;
+    }
+    CHECK_EQUAL(BNEP_RESP_FILTER_ERR_TOO_MANY_FILTERS, mock_bnep_set_net_filter(bnep_cid, ranges, MAX_BNEP_NETFILTER + 1));
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, MAX_BNEP_NETFILTER));
+    CHECK_EQUAL(1, protocol_sent((MAX_BNEP_NETFILTER - 1) * 0x10));
+    CHECK_EQUAL(0, protocol_sent(MAX_BNEP_NETFILTER * 0x10));
+}
+
+// binary search has to find every range for all table sizes
+TEST(BnepNetFilter, AllTableSizes){
+    uint16_t ranges[MAX_BNEP_NETFILTER * 2];
+    int num_ranges;
+    for (num_ranges = 1; num_ranges <= MAX_BNEP_NETFILTER; num_ranges++){
+        int i;
+        // descending order
+        for (i = 0; i < num_ranges; i++){
+            ranges[i * 2]     = 0x100 * (num_ranges - i);
+            ranges[i * 2 + 1] = 0x100 * (num_ranges - i) + 0x10;
+        }
+        CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_net_filter(bnep_cid, ranges, num_ranges));
+        CHECK_EQUAL(0, protocol_sent(0x0000));
+        for (i = 1; i <= num_ranges; i++){
+            CHECK_EQUAL(0, protocol_sent(0x100 * i - 1));
+            CHECK_EQUAL(1, protocol_sent(0x100 * i));
+            CHECK_EQUAL(1, protocol_sent(0x100 * i + 0x10));
+            CHECK_EQUAL(0, protocol_sent(0x100 * i + 0x11));
+        }
+    }
+}
+
+TEST_GROUP(BnepMulticastFilter){
+    void setup(void){
+        mock_bnep_init();
+        bnep_cid = mock_bnep_connect();
+        CHECK(bnep_cid != 0);
+    }
+    void teardown(void){
+        mock_bnep_disconnect(bnep_cid);
+        mock_bnep_deinit();
+    }
+};
+
+TEST(BnepMulticastFilter, NoFilterPassesAll){
+    bd_addr_t addr;
+    multicast_addr(0, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0xffffff, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+}
+
+TEST(BnepMulticastFilter, UnicastNotFiltered){
+    uint8_t range[12];
+    multicast_range(range, 0x10, 0x20);
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, range, 1));
+    CHECK_EQUAL(1, multicast_sent(remote_addr));
+}
+
+TEST(BnepMulticastFilter, EmptyListRemovesFilter){
+    uint8_t range[12];
+    bd_addr_t addr;
+    multicast_range(range, 0x10, 0x20);
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, range, 1));
+    multicast_addr(0x30, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, NULL, 0));
+    CHECK_EQUAL(1, multicast_sent(addr));
+}
+
+TEST(BnepMulticastFilter, RangeBoundaries){
+    // end crosses byte boundary
+    uint8_t range[12];
+    bd_addr_t addr;
+    multicast_range(range, 0x0100, 0x02ff);
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, range, 1));
+    multicast_addr(0x00ff, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    multicast_addr(0x0100, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x0200, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x02ff, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x0300, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+}
+
+TEST(BnepMulticastFilter, OverlappingRanges){
+    // unsorted, contained and overlapping
+    uint8_t ranges[4 * 12];
+    bd_addr_t addr;
+    multicast_range(&ranges[0],  0x500, 0x500);
+    multicast_range(&ranges[12], 0x150, 0x200);
+    multicast_range(&ranges[24], 0x100, 0x180);
+    multicast_range(&ranges[36], 0x120, 0x130);
+    CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, ranges, 4));
+    multicast_addr(0x0ff, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    multicast_addr(0x100, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x181, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x200, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x201, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    multicast_addr(0x4ff, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    multicast_addr(0x500, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+    multicast_addr(0x501, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+}
+
+TEST(BnepMulticastFilter, InvalidRangeIgnored){
+    uint8_t ranges[2 * 12];
+    bd_addr_t addr;
+    multicast_range(&ranges[0],  0x200, 0x100);
+    multicast_range(&ranges[12], 0x300, 0x300);
+    CHECK_EQUAL(BNEP_RESP_FILTER_ERR_INVALID_RANGE, mock_bnep_set_multicast_filter(bnep_cid, ranges, 2));
+    multicast_addr(0x180, addr);
+    CHECK_EQUAL(0, multicast_sent(addr));
+    multicast_addr(0x300, addr);
+    CHECK_EQUAL(1, multicast_sent(addr));
+}
+
+// binary search has to find every range for all table sizes
+TEST(BnepMulticastFilter, AllTableSizes){
+    uint8_t ranges[MAX_BNEP_MULTICAST_FILTER * 12];
+    bd_addr_t addr;
+    int num_ranges;
+    for (num_ranges = 1; num_ranges <= MAX_BNEP_MULTICAST_FILTER; num_ranges++){
+        int i;
+        // descending order
+        for (i = 0; i < num_ranges; i++){
+            uint32_t start = 0x1000 * (num_ranges - i);
+            multicast_range(&ranges[i * 12], start, start + 0x10);
+        }
+        CHECK_EQUAL(BNEP_RESP_FILTER_SUCCESS, mock_bnep_set_multicast_filter(bnep_cid, ranges, num_ranges));
+        multicast_addr(0, addr);
+        CHECK_EQUAL(0, multicast_sent(addr));
+        for (i = 1; i <= num_ranges; i++){
+            multicast_addr(0x1000 * i - 1, addr);
+            CHECK_EQUAL(0, multicast_sent(addr));
+            multicast_addr(0x1000 * i, addr);
+            CHECK_EQUAL(1, multicast_sent(addr));
+            multicast_addr(0x1000 * i + 0x10, addr);
+            CHECK_EQUAL(1, multicast_sent(addr));
+            multicast_addr(0x1000 * i + 0x11, addr);
+            CHECK_EQUAL(0, multicast_sent(addr));
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
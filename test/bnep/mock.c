@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// BNEP test mocks: L2CAP layer and channel setup
+//
+// *****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "bluetooth.h"
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "classic/bnep.h"
+#include "gap.h"
+#include "l2cap.h"
+#include "mock.h"
+
+#define MOCK_L2CAP_CID   0x0041
+#define MOCK_L2CAP_MTU   1691
+#define MOCK_CON_HANDLE  0x0040
+
+static const bd_addr_t local_addr  = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01 };
+static const bd_addr_t remote_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x02 };
+
+static uint8_t  outgoing_buffer[MOCK_L2CAP_MTU];
+static uint8_t  last_packet[MOCK_L2CAP_MTU];
+static uint16_t last_packet_len;
+static int      num_packets_sent;
+static int      can_send_now_requested;
+static uint16_t bnep_cid;
+static int      run_loop_initialized;
+
+// run loop without time, BNEP only uses it for setup timeout
+
+static void mock_run_loop_init(void){
+}
+static void mock_run_loop_add_data_source(btstack_data_source_t * ds){
+    UNUSED(ds);
+}
+static int mock_run_loop_remove_data_source(btstack_data_source_t * ds){
+    UNUSED(ds);
+    return 0;
+}
+static void mock_run_loop_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    UNUSED(ds);
+    UNUSED(callbacks);
+}
+static void mock_run_loop_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    UNUSED(ds);
+    UNUSED(callbacks);
+}
+static void mock_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    UNUSED(ts);
+    UNUSED(timeout_in_ms);
+}
+static void mock_run_loop_add_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+}
+static int mock_run_loop_remove_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    return 0;
+}
+static void mock_run_loop_execute(void){
+}
+static void mock_run_loop_dump_timer(void){
+}
+static uint32_t mock_run_loop_get_time_ms(void){
+    return 0;
+}
+
+static const btstack_run_loop_t mock_run_loop = {
+    &mock_run_loop_init,
+    &mock_run_loop_add_data_source,
+    &mock_run_loop_remove_data_source,
+    &mock_run_loop_enable_data_source_callbacks,
+    &mock_run_loop_disable_data_source_callbacks,
+    &mock_run_loop_set_timer,
+    &mock_run_loop_add_timer,
+    &mock_run_loop_remove_timer,
+    &mock_run_loop_execute,
+    &mock_run_loop_dump_timer,
+    &mock_run_loop_get_time_ms,
+};
+
+// L2CAP
+
+uint16_t l2cap_max_mtu(void){
+    return MOCK_L2CAP_MTU;
+}
+
+uint8_t l2cap_create_channel(btstack_packet_handler_t packet_handler, bd_addr_t address, uint16_t psm, uint16_t mtu, uint16_t * out_local_cid){
+    (void) address;
+    UNUSED(packet_handler);
+    UNUSED(psm);
+    UNUSED(mtu);
+    UNUSED(out_local_cid);
+    return ERROR_CODE_COMMAND_DISALLOWED;
+}
+
+void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
+    UNUSED(local_cid);
+    UNUSED(reason);
+}
+
+uint8_t l2cap_register_service(btstack_packet_handler_t packet_handler, uint16_t psm, uint16_t mtu, gap_security_level_t security_level){
+    UNUSED(packet_handler);
+    UNUSED(psm);
+    UNUSED(mtu);
+    UNUSED(security_level);
+    return ERROR_CODE_SUCCESS;
+}
+
+uint8_t l2cap_unregister_service(uint16_t psm){
+    UNUSED(psm);
+    return ERROR_CODE_SUCCESS;
+}
+
+void l2cap_accept_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+
+void l2cap_decline_connection(uint16_t local_cid){
+    UNUSED(local_cid);
+}
+
+int l2cap_can_send_packet_now(uint16_t local_cid){
+    UNUSED(local_cid);
+    return 1;
+}
+
+void l2cap_request_can_send_now_event(uint16_t local_cid){
+    UNUSED(local_cid);
+    can_send_now_requested = 1;
+}
+
+int l2cap_reserve_packet_buffer(void){
+    return 0;
+}
+
+uint8_t *l2cap_get_outgoing_buffer(void){
+    return outgoing_buffer;
+}
+
+int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
+    UNUSED(local_cid);
+    memcpy(last_packet, outgoing_buffer, len);
+    last_packet_len = len;
+    num_packets_sent++;
+    return 0;
+}
+
+void l2cap_release_packet_buffer(void){
+}
+
+void gap_local_bd_addr(bd_addr_t address_buffer){
+    memcpy(address_buffer, local_addr, sizeof(bd_addr_t));
+}
+
+static void mock_bnep_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != BNEP_EVENT_CHANNEL_OPENED) return;
+    if (bnep_event_channel_opened_get_status(packet)) return;
+    bnep_cid = bnep_event_channel_opened_get_bnep_cid(packet);
+}
+
+// deliver pending L2CAP_EVENT_CAN_SEND_NOW events
+static void mock_l2cap_process(void){
+    while (can_send_now_requested){
+        can_send_now_requested = 0;
+        uint8_t event[4] = { L2CAP_EVENT_CAN_SEND_NOW, 2 };
+        little_endian_store_16(event, 2, MOCK_L2CAP_CID);
+        bnep_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    }
+}
+
+static void mock_l2cap_receive(uint8_t * packet, uint16_t len){
+    bnep_packet_handler(L2CAP_DATA_PACKET, MOCK_L2CAP_CID, packet, len);
+    mock_l2cap_process();
+}
+
+// @returns response code of last sent control packet
+static uint16_t mock_last_response_code(uint8_t control_type){
+    if (last_packet_len < 4) return 0xffff;
+    if (last_packet[0] != BNEP_PKT_TYPE_CONTROL) return 0xffff;
+    if (last_packet[1] != control_type) return 0xffff;
+    return big_endian_read_16(last_packet, 2);
+}
+
+void mock_bnep_init(void){
+    btstack_memory_init();
+    // run loop can only be initialized once
+    if (!run_loop_initialized){
+        run_loop_initialized = 1;
+        btstack_run_loop_init(&mock_run_loop);
+    }
+    bnep_init();
+    bnep_register_service(&mock_bnep_handler, BLUETOOTH_SERVICE_CLASS_NAP, MOCK_L2CAP_MTU - 15);
+    num_packets_sent = 0;
+    can_send_now_requested = 0;
+    bnep_cid = 0;
+}
+
+void mock_bnep_deinit(void){
+    bnep_unregister_service(BLUETOOTH_SERVICE_CLASS_NAP);
+}
+
+uint16_t mock_bnep_connect(void){
+    uint8_t event[19];
+
+    // incoming L2CAP connection
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_INCOMING_CONNECTION;
+    event[1] = 12;
+    reverse_bd_addr(remote_addr, &event[2]);
+    little_endian_store_16(event,  8, MOCK_CON_HANDLE);
+    little_endian_store_16(event, 10, BLUETOOTH_PROTOCOL_BNEP);
+    little_endian_store_16(event, 12, MOCK_L2CAP_CID);
+    bnep_packet_handler(HCI_EVENT_PACKET, 0, event, 14);
+
+    // L2CAP channel opened
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    reverse_bd_addr(remote_addr, &event[3]);
+    little_endian_store_16(event,  9, MOCK_CON_HANDLE);
+    little_endian_store_16(event, 11, BLUETOOTH_PROTOCOL_BNEP);
+    little_endian_store_16(event, 13, MOCK_L2CAP_CID);
+    little_endian_store_16(event, 15, MOCK_L2CAP_CID);
+    little_endian_store_16(event, 17, MOCK_L2CAP_MTU);
+    bnep_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+
+    // BNEP setup connection request PANU -> NAP
+    uint8_t setup_request[] = { BNEP_PKT_TYPE_CONTROL, BNEP_CONTROL_TYPE_SETUP_CONNECTION_REQUEST, 2, 0, 0, 0, 0 };
+    big_endian_store_16(setup_request, 3, BLUETOOTH_SERVICE_CLASS_NAP);
+    big_endian_store_16(setup_request, 5, BLUETOOTH_SERVICE_CLASS_PANU);
+    mock_l2cap_receive(setup_request, sizeof(setup_request));
+    return bnep_cid;
+}
+
+void mock_bnep_disconnect(uint16_t cid){
+    uint8_t event[4] = { L2CAP_EVENT_CHANNEL_CLOSED, 2 };
+    little_endian_store_16(event, 2, cid);
+    bnep_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+uint16_t mock_bnep_set_net_filter(uint16_t cid, const uint16_t * ranges, int num_ranges){
+    UNUSED(cid);
+    uint16_t len = 4 + num_ranges * 4;
+    uint8_t * packet = (uint8_t *) malloc(len);
+    packet[0] = BNEP_PKT_TYPE_CONTROL;
+    packet[1] = BNEP_CONTROL_TYPE_FILTER_NET_TYPE_SET;
+    big_endian_store_16(packet, 2, num_ranges * 4);
+    int i;
+    for (i = 0; i < num_ranges * 2; i++){
+        big_endian_store_16(packet, 4 + i * 2, ranges[i]);
+    }
+    mock_l2cap_receive(packet, len);
+    free(packet);
+    return mock_last_response_code(BNEP_CONTROL_TYPE_FILTER_NET_TYPE_RESPONSE);
+}
+
+uint16_t mock_bnep_set_multicast_filter(uint16_t cid, const uint8_t * ranges, int num_ranges){
+    UNUSED(cid);
+    uint16_t len = 4 + num_ranges * 12;
+    uint8_t * packet = (uint8_t *) malloc(len);
+    packet[0] = BNEP_PKT_TYPE_CONTROL;
+    packet[1] = BNEP_CONTROL_TYPE_FILTER_MULTI_ADDR_SET;
+    big_endian_store_16(packet, 2, num_ranges * 12);
+    memcpy(&packet[4], ranges, num_ranges * 12);
+    mock_l2cap_receive(packet, len);
+    free(packet);
+    return mock_last_response_code(BNEP_CONTROL_TYPE_FILTER_MULTI_ADDR_RESPONSE);
+}
+
+int mock_l2cap_num_packets_sent(void){
+    return num_packets_sent;
+}
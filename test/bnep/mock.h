@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+ 
+// *****************************************************************************
+//
+// BNEP test mocks: L2CAP layer and channel setup
+//
+// *****************************************************************************
+
+#ifndef __BNEP_TEST_MOCK_H
+#define __BNEP_TEST_MOCK_H
+
+#include <stdint.h>
+
+// init memory, run loop and BNEP with NAP service
+void mock_bnep_init(void);
+
+// remove service and free all memory
+void mock_bnep_deinit(void);
+
+// accept incoming BNEP connection from PANU, @returns bnep_cid
+uint16_t mock_bnep_connect(void);
+
+// close L2CAP channel
+void mock_bnep_disconnect(uint16_t bnep_cid);
+
+// receive Filter Net Type Set with num_ranges pairs of start, end, @returns response code
+uint16_t mock_bnep_set_net_filter(uint16_t bnep_cid, const uint16_t * ranges, int num_ranges);
+
+// receive Filter Multicast Address Set with num_ranges pairs of start, end address, @returns response code
+uint16_t mock_bnep_set_multicast_filter(uint16_t bnep_cid, const uint8_t * ranges, int num_ranges);
+
+// number of packets sent via l2cap_send_prepared
+int mock_l2cap_num_packets_sent(void);
+
+#endif
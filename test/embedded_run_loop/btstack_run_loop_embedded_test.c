@@ -0,0 +1,231 @@
+// Tickless mode of btstack_run_loop_embedded with simulated HAL
+
+#include <stdint.h>
+#include <string.h>
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_embedded.h"
+#include "hal_cpu.h"
+#include "hal_time_ms.h"
+#include "hci_dump.h"
+
+#define MAX_FIRED 10
+
+// simulated HAL
+static uint32_t sim_time_ms;
+static void (*sim_alarm_handler)(void);
+static int      sim_alarm_active;
+static uint32_t sim_alarm_time_ms;
+static int      sim_external_irq_pending;
+static uint32_t sim_external_irq_time_ms;
+static int      sim_sleep_forever;
+
+static uint32_t fired_times[MAX_FIRED];
+static int      num_fired;
+
+extern "C" void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+uint32_t hal_time_ms(void){
+    return sim_time_ms;
+}
+
+static void sim_fire_alarm(void){
+    sim_alarm_active = 0;
+    (*sim_alarm_handler)();
+}
+
+void hal_time_ms_set_alarm_handler(void (*alarm_handler)(void)){
+    sim_alarm_handler = alarm_handler;
+}
+
+void hal_time_ms_set_alarm(uint32_t alarm_time_ms){
+    sim_alarm_active = 1;
+    sim_alarm_time_ms = alarm_time_ms;
+    if ((int32_t)(alarm_time_ms - sim_time_ms) <= 0){
+        sim_fire_alarm();
+    }
+}
+
+void hal_time_ms_clear_alarm(void){
+    sim_alarm_active = 0;
+}
+
+void hal_cpu_disable_irqs(void){
+}
+
+void hal_cpu_enable_irqs(void){
+}
+
+// advance time to next IRQ
+void hal_cpu_enable_irqs_and_sleep(void){
+    if (sim_external_irq_pending && (!sim_alarm_active || (int32_t)(sim_external_irq_time_ms - sim_alarm_time_ms) < 0)){
+        sim_time_ms = sim_external_irq_time_ms;
+        sim_external_irq_pending = 0;
+        btstack_run_loop_embedded_trigger();
+        return;
+    }
+    if (sim_alarm_active){
+        sim_time_ms = sim_alarm_time_ms;
+        sim_fire_alarm();
+        return;
+    }
+    sim_sleep_forever = 1;
+}
+
+static void run_until(uint32_t time_ms){
+    while (!sim_sleep_forever && (int32_t)(sim_time_ms - time_ms) < 0){
+        btstack_run_loop_embedded_execute_once();
+    }
+}
+
+static void timer_handler(btstack_timer_source_t * ts){
+    (void) ts;
+    if (num_fired < MAX_FIRED){
+        fired_times[num_fired] = sim_time_ms;
+    }
+    num_fired++;
+}
+
+TEST_GROUP(RunLoopEmbeddedTickless){
+    btstack_timer_source_t timers[3];
+    btstack_run_loop_embedded_statistics_t statistics;
+
+    void setup(void){
+        sim_time_ms = 0;
+        sim_alarm_active = 0;
+        sim_external_irq_pending = 0;
+        sim_sleep_forever = 0;
+        num_fired = 0;
+        memset(fired_times, 0, sizeof(fired_times));
+        memset(timers, 0, sizeof(timers));
+        // btstack_run_loop_init can only be called once, re-init run loop directly
+        btstack_run_loop_embedded_get_instance()->init();
+    }
+
+    void add_timer(int index, uint32_t timeout_ms){
+        btstack_run_loop_set_timer_handler(&timers[index], &timer_handler);
+        btstack_run_loop_set_timer(&timers[index], timeout_ms);
+        btstack_run_loop_add_timer(&timers[index]);
+    }
+};
+
+TEST(RunLoopEmbeddedTickless, NoTimersNoAlarm){
+    btstack_run_loop_embedded_execute_once();
+    CHECK_EQUAL(1, sim_sleep_forever);
+    CHECK_EQUAL(0, sim_alarm_active);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.sleeps);
+    CHECK_EQUAL(0, statistics.alarms_programmed);
+}
+
+TEST(RunLoopEmbeddedTickless, SingleTimerSingleWakeup){
+    add_timer(0, 1000);
+    run_until(2000);
+    CHECK_EQUAL(1, num_fired);
+    CHECK_EQUAL(1001, fired_times[0]);
+    CHECK_EQUAL(1, sim_sleep_forever);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.sleeps);
+    CHECK_EQUAL(1, statistics.wakeups_by_timer);
+    // final sleep without alarm returns in simulation
+    CHECK_EQUAL(1, statistics.wakeups_by_other);
+    CHECK_EQUAL(1, statistics.alarms_programmed);
+    CHECK_EQUAL(1001, statistics.time_asleep_ms);
+    CHECK_EQUAL(1, statistics.timers_processed);
+}
+
+TEST(RunLoopEmbeddedTickless, NoCoalescingWithoutSlack){
+    btstack_run_loop_embedded_set_timer_slack(0);
+    add_timer(0, 100);
+    add_timer(1, 120);
+    add_timer(2, 200);
+    run_until(1000);
+    CHECK_EQUAL(3, num_fired);
+    CHECK_EQUAL(101, fired_times[0]);
+    CHECK_EQUAL(121, fired_times[1]);
+    CHECK_EQUAL(201, fired_times[2]);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(3, statistics.wakeups_by_timer);
+    CHECK_EQUAL(0, statistics.timers_coalesced);
+}
+
+TEST(RunLoopEmbeddedTickless, CoalescingWithinSlack){
+    btstack_run_loop_embedded_set_timer_slack(50);
+    add_timer(0, 100);
+    add_timer(1, 120);
+    add_timer(2, 200);
+    run_until(1000);
+    CHECK_EQUAL(3, num_fired);
+    // first timer delayed to second one, third one outside of slack window
+    CHECK_EQUAL(121, fired_times[0]);
+    CHECK_EQUAL(121, fired_times[1]);
+    CHECK_EQUAL(201, fired_times[2]);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.wakeups_by_timer);
+    CHECK_EQUAL(1, statistics.timers_coalesced);
+    CHECK_EQUAL(3, statistics.timers_processed);
+}
+
+TEST(RunLoopEmbeddedTickless, RemoveTimerReprogramsAlarm){
+    add_timer(0, 100);
+    // don't sleep
+    btstack_run_loop_embedded_trigger();
+    btstack_run_loop_embedded_execute_once();
+    CHECK_EQUAL(1, sim_alarm_active);
+    CHECK_EQUAL(101, sim_alarm_time_ms);
+
+    btstack_run_loop_remove_timer(&timers[0]);
+    add_timer(1, 500);
+    run_until(1000);
+    CHECK_EQUAL(1, num_fired);
+    CHECK_EQUAL(501, fired_times[0]);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.alarms_programmed);
+}
+
+TEST(RunLoopEmbeddedTickless, RemoveLastTimerClearsAlarm){
+    add_timer(0, 100);
+    btstack_run_loop_embedded_trigger();
+    btstack_run_loop_embedded_execute_once();
+    CHECK_EQUAL(1, sim_alarm_active);
+    btstack_run_loop_remove_timer(&timers[0]);
+    btstack_run_loop_embedded_execute_once();
+    CHECK_EQUAL(1, sim_sleep_forever);
+    CHECK_EQUAL(0, sim_alarm_active);
+    CHECK_EQUAL(0, num_fired);
+}
+
+TEST(RunLoopEmbeddedTickless, ExternalWakeup){
+    add_timer(0, 100);
+    sim_external_irq_pending = 1;
+    sim_external_irq_time_ms = 40;
+    run_until(1000);
+    CHECK_EQUAL(1, num_fired);
+    CHECK_EQUAL(101, fired_times[0]);
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(2, statistics.wakeups_by_other);
+    CHECK_EQUAL(1, statistics.wakeups_by_timer);
+    CHECK_EQUAL(1, statistics.alarms_programmed);
+    CHECK_EQUAL(101, statistics.time_asleep_ms);
+}
+
+TEST(RunLoopEmbeddedTickless, ResetStatistics){
+    add_timer(0, 10);
+    run_until(100);
+    btstack_run_loop_embedded_reset_statistics();
+    btstack_run_loop_embedded_get_statistics(&statistics);
+    CHECK_EQUAL(0, statistics.iterations);
+    CHECK_EQUAL(0, statistics.sleeps);
+    CHECK_EQUAL(0, statistics.timers_processed);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_embedded_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,218 @@
+// Per-event dispatch benchmark for HCI event handler masks
+//
+// Injects HCI events into hci.c through a stub transport with L2CAP, SM, ATT Server
+// and GATT Client registered for HCI events, plus one application handler without mask.
+// Each event type is dispatched once with the event masks installed by the layers
+// and once with all masks removed, i.e. broadcast to every handler.
+//
+// Usage: event_dispatch_benchmark [iterations]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_config.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "l2cap.h"
+#include "ble/att_server.h"
+#include "ble/gatt_client.h"
+#include "ble/le_device_db.h"
+#include "ble/sm.h"
+
+#define MAX_REGISTRATIONS 10
+
+typedef struct {
+    const char * name;
+    uint8_t      packet[50];
+    uint16_t     size;
+} benchmark_event_t;
+
+static void (*transport_packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static btstack_packet_callback_registration_t probe_registration;
+static btstack_packet_callback_registration_t app_registration;
+
+static btstack_packet_callback_registration_t * registrations[MAX_REGISTRATIONS];
+static const btstack_event_mask_t * registration_masks[MAX_REGISTRATIONS];
+static int num_registrations;
+
+static uint32_t app_events;
+
+// stub transport
+
+static void transport_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    transport_packet_handler = handler;
+}
+static int transport_can_send_packet_now(uint8_t packet_type){
+    UNUSED(packet_type);
+    return 1;
+}
+static int transport_send_packet(uint8_t packet_type, uint8_t *packet, int size){
+    UNUSED(packet_type);
+    UNUSED(packet);
+    UNUSED(size);
+    return 0;
+}
+
+static const hci_transport_t transport = {
+    "stub", NULL, NULL, NULL, &transport_register_packet_handler, &transport_can_send_packet_now, &transport_send_packet, NULL, NULL, NULL
+};
+
+static void probe_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(channel);
+    UNUSED(packet);
+    UNUSED(size);
+}
+
+static void app_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case BTSTACK_EVENT_STATE:
+            break;
+        default:
+            app_events++;
+            break;
+    }
+}
+
+// probe registration is added first, all later registrations follow it in the list
+static void collect_registrations(void){
+    btstack_linked_item_t * item;
+    for (item = probe_registration.item.next; item && num_registrations < MAX_REGISTRATIONS; item = item->next){
+        btstack_packet_callback_registration_t * registration = (btstack_packet_callback_registration_t *) item;
+        registrations[num_registrations] = registration;
+        registration_masks[num_registrations] = registration->event_mask;
+        num_registrations++;
+    }
+}
+
+static void set_masks_enabled(int enabled){
+    int i;
+    for (i = 0; i < num_registrations; i++){
+        registrations[i]->event_mask = enabled ? registration_masks[i] : NULL;
+    }
+}
+
+static int count_receivers(const uint8_t * packet){
+    int receivers = 0;
+    int i;
+    for (i = 0; i < num_registrations; i++){
+        if (registrations[i]->event_mask && !btstack_event_mask_matches(registrations[i]->event_mask, packet)) continue;
+        receivers++;
+    }
+    return receivers;
+}
+
+static double dispatch(benchmark_event_t * event, int iterations){
+    uint8_t packet[sizeof(event->packet)];
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int i;
+    for (i = 0; i < iterations; i++){
+        // handlers may modify event in place
+        memcpy(packet, event->packet, event->size);
+        (*transport_packet_handler)(HCI_EVENT_PACKET, packet, event->size);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) * 1e9 / iterations;
+}
+
+static void setup_events(benchmark_event_t * events){
+    // LE Advertising Report with 31 bytes data
+    benchmark_event_t * event = &events[0];
+    event->name = "LE Advertising Report";
+    event->size = 3 + 1 + 1 + 1 + 6 + 1 + 31 + 1;
+    event->packet[0] = HCI_EVENT_LE_META;
+    event->packet[1] = event->size - 2;
+    event->packet[2] = HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+    event->packet[3] = 1;
+    event->packet[12] = 31;
+
+    // Number Of Completed Packets for connection 0x0040
+    event = &events[1];
+    event->name = "Number Of Completed Packets";
+    event->size = 7;
+    event->packet[0] = HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS;
+    event->packet[1] = 5;
+    event->packet[2] = 1;
+    little_endian_store_16(event->packet, 3, 0x0040);
+    little_endian_store_16(event->packet, 5, 0);
+
+    // Encryption Change for connection 0x0040, delivered to all layers
+    event = &events[2];
+    event->name = "Encryption Change";
+    event->size = 6;
+    event->packet[0] = HCI_EVENT_ENCRYPTION_CHANGE;
+    event->packet[1] = 4;
+    event->packet[2] = 0;
+    little_endian_store_16(event->packet, 3, 0x0040);
+    event->packet[5] = 0;
+}
+
+static void connect_le(void){
+    uint8_t event[21];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    event[3] = 0;
+    little_endian_store_16(event, 4, 0x0040);
+    event[6] = 1;   // slave
+    (*transport_packet_handler)(HCI_EVENT_PACKET, event, sizeof(event));
+}
+
+int main(int argc, const char * argv[]){
+    int iterations = 1000000;
+    if (argc > 1){
+        iterations = atoi(argv[1]);
+    }
+
+    btstack_memory_init();
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    hci_init(&transport, NULL);
+
+    probe_registration.callback = &probe_handler;
+    hci_add_event_handler(&probe_registration);
+
+    l2cap_init();
+    le_device_db_init();
+    sm_init();
+    att_server_init(NULL, NULL, NULL);
+    gatt_client_init();
+
+    app_registration.callback = &app_packet_handler;
+    hci_add_event_handler(&app_registration);
+
+    collect_registrations();
+    connect_le();
+
+    benchmark_event_t events[3];
+    memset(events, 0, sizeof(events));
+    setup_events(events);
+
+    printf("%u event handlers registered\n", num_registrations);
+    int i;
+    for (i = 0; i < 3; i++){
+        benchmark_event_t * event = &events[i];
+        set_masks_enabled(0);
+        int broadcast_receivers = count_receivers(event->packet);
+        double broadcast_ns = dispatch(event, iterations);
+        set_masks_enabled(1);
+        int masked_receivers = count_receivers(event->packet);
+        double masked_ns = dispatch(event, iterations);
+        printf("%-28s broadcast: %u handlers, %6.1f ns - masks: %u handlers, %6.1f ns\n",
+            event->name, broadcast_receivers, broadcast_ns, masked_receivers, masked_ns);
+    }
+    return 0;
+}
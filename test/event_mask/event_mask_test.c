@@ -0,0 +1,72 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include "btstack_defines.h"
+#include "btstack_util.h"
+#include "bluetooth.h"
+
+static uint8_t event[] = { HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, 0x40, 0x00, 0x13 };
+static uint8_t le_connection_complete[] = { HCI_EVENT_LE_META, 19, HCI_SUBEVENT_LE_CONNECTION_COMPLETE };
+static uint8_t le_advertising_report[]  = { HCI_EVENT_LE_META, 12, HCI_SUBEVENT_LE_ADVERTISING_REPORT };
+
+TEST_GROUP(EventMask){
+    btstack_event_mask_t mask;
+    void setup(void){
+        btstack_event_mask_clear(&mask);
+    }
+};
+
+TEST(EventMask, Clear){
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, event));
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, le_connection_complete));
+}
+
+TEST(EventMask, SetAll){
+    btstack_event_mask_set_all(&mask);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, event));
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_connection_complete));
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_advertising_report));
+}
+
+TEST(EventMask, AddRemoveEvent){
+    btstack_event_mask_add_event(&mask, HCI_EVENT_DISCONNECTION_COMPLETE);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, event));
+    event[0] = HCI_EVENT_CONNECTION_COMPLETE;
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, event));
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    btstack_event_mask_remove_event(&mask, HCI_EVENT_DISCONNECTION_COMPLETE);
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, event));
+}
+
+TEST(EventMask, EventCodeBoundaries){
+    uint8_t first[] = { 0x00, 0 };
+    uint8_t last[]  = { 0xff, 0 };
+    btstack_event_mask_add_event(&mask, 0xff);
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, first));
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, last));
+    btstack_event_mask_add_event(&mask, 0x00);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, first));
+}
+
+TEST(EventMask, LESubevents){
+    btstack_event_mask_add_le_subevent(&mask, HCI_SUBEVENT_LE_CONNECTION_COMPLETE);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_connection_complete));
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, le_advertising_report));
+    btstack_event_mask_remove_le_subevent(&mask, HCI_SUBEVENT_LE_CONNECTION_COMPLETE);
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, le_connection_complete));
+}
+
+TEST(EventMask, LEMetaEvent){
+    btstack_event_mask_add_event(&mask, HCI_EVENT_LE_META);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_connection_complete));
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_advertising_report));
+    btstack_event_mask_remove_le_subevent(&mask, HCI_SUBEVENT_LE_ADVERTISING_REPORT);
+    CHECK_EQUAL(1, btstack_event_mask_matches(&mask, le_connection_complete));
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, le_advertising_report));
+    btstack_event_mask_remove_event(&mask, HCI_EVENT_LE_META);
+    CHECK_EQUAL(0, btstack_event_mask_matches(&mask, le_connection_complete));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
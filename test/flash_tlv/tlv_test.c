@@ -13,9 +13,34 @@
 #include "btstack_config.h"
 #include "btstack_debug.h"
 
-#define HAL_FLASH_SECTOR_MEMORY_STORAGE_SIZE 256
+// each bank holds the directory overflow test (MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS + 2 tags, 9 bytes each) plus headroom
+#define HAL_FLASH_SECTOR_MEMORY_STORAGE_SIZE (2 * (128 + (MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS + 2) * 9))
 static uint8_t hal_flash_sector_memory_storage[HAL_FLASH_SECTOR_MEMORY_STORAGE_SIZE];
 
+// counts reads to verify that lookups don't scan the flash bank
+static const hal_flash_sector_t * counting_hal_flash_sector_impl;
+static int counting_hal_flash_sector_reads;
+
+static uint32_t counting_hal_flash_sector_get_size(void * context){
+	return counting_hal_flash_sector_impl->get_size(context);
+}
+static void counting_hal_flash_sector_erase(void * context, int bank){
+	counting_hal_flash_sector_impl->erase(context, bank);
+}
+static void counting_hal_flash_sector_read(void * context, int bank, uint32_t offset, uint8_t * buffer, uint32_t size){
+	counting_hal_flash_sector_reads++;
+	counting_hal_flash_sector_impl->read(context, bank, offset, buffer, size);
+}
+static void counting_hal_flash_sector_write(void * context, int bank, uint32_t offset, const uint8_t * data, uint32_t size){
+	counting_hal_flash_sector_impl->write(context, bank, offset, data, size);
+}
+static const hal_flash_sector_t counting_hal_flash_sector = {
+	&counting_hal_flash_sector_get_size,
+	&counting_hal_flash_sector_erase,
+	&counting_hal_flash_sector_read,
+	&counting_hal_flash_sector_write,
+};
+
 static void CHECK_EQUAL_ARRAY(uint8_t * expected, uint8_t * actual, int size){
 	int i;
 	for (i=0; i<size; i++){
@@ -227,6 +252,116 @@ TEST(BSTACK_TLV, TestMigrate2){
 	CHECK_EQUAL(buffer[0], data2[0]);
 }
 
+TEST(BSTACK_TLV, TestLookupWithoutScan){
+	counting_hal_flash_sector_impl = hal_flash_sector_impl;
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, &counting_hal_flash_sector, &hal_flash_sector_context);
+	uint32_t tag;
+	uint8_t  buffer;
+	for (tag=1;tag<=MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS;tag++){
+		buffer = tag;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &buffer, 1);
+	}
+
+	// directory is built at init
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, &counting_hal_flash_sector, &hal_flash_sector_context);
+	counting_hal_flash_sector_reads = 0;
+	for (tag=1;tag<=MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS;tag++){
+		CHECK_EQUAL(1, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, NULL, 0));
+		CHECK_EQUAL(1, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, &buffer, 1));
+		CHECK_EQUAL(tag, buffer);
+	}
+	// one read for each value
+	CHECK_EQUAL(MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS, counting_hal_flash_sector_reads);
+	CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, 'miss', &buffer, 1));
+	CHECK_EQUAL(MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS, counting_hal_flash_sector_reads);
+}
+
+TEST(BSTACK_TLV, TestMigrateDropsDeleted){
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, hal_flash_sector_impl, &hal_flash_sector_context);
+	uint32_t tag_a = 'aaaa';
+	uint32_t tag_b = 'bbbb';
+	uint8_t  data[8];
+	memcpy(data, "01234567", 8);
+	btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_b, data, 8);
+	btstack_tlv_impl->delete_tag(&btstack_tlv_context, tag_b);
+
+	btstack_tlv_flash_sector_statistics_t statistics;
+	int i = 0;
+	do {
+		data[0] = '0' + i++;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag_a, data, 8);
+		btstack_tlv_flash_sector_get_statistics(&btstack_tlv_context, &statistics);
+	} while (statistics.migrations == 0);
+
+	// only latest value of tag a left
+	CHECK_EQUAL(16, statistics.bytes_live);
+	CHECK_EQUAL(16, statistics.bytes_stale);
+	CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_b, NULL, 0));
+
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, hal_flash_sector_impl, &hal_flash_sector_context);
+	uint8_t buffer[8];
+	CHECK_EQUAL(8, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_a, buffer, 8));
+	CHECK_EQUAL(data[0], buffer[0]);
+	CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag_b, NULL, 0));
+}
+
+TEST(BSTACK_TLV, TestDirectoryOverflow){
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, hal_flash_sector_impl, &hal_flash_sector_context);
+	const uint32_t num_tags = MAX_NR_BTSTACK_TLV_FLASH_SECTOR_TAGS + 2;
+	uint32_t tag;
+	uint8_t  buffer;
+	for (tag=1;tag<=num_tags;tag++){
+		buffer = tag;
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, &buffer, 1);
+	}
+	btstack_tlv_impl->delete_tag(&btstack_tlv_context, num_tags);
+
+	btstack_tlv_flash_sector_statistics_t statistics;
+	int round;
+	for (round=0;round<3;round++){
+		for (tag=1;tag<num_tags;tag++){
+			CHECK_EQUAL(1, btstack_tlv_impl->get_tag(&btstack_tlv_context, tag, &buffer, 1));
+			CHECK_EQUAL(tag, buffer);
+		}
+		CHECK_EQUAL(0, btstack_tlv_impl->get_tag(&btstack_tlv_context, num_tags, NULL, 0));
+		btstack_tlv_flash_sector_get_statistics(&btstack_tlv_context, &statistics);
+		CHECK(statistics.directory_misses > 0);
+		CHECK_EQUAL((num_tags - 1) * 9, statistics.bytes_live);
+
+		// force migration by updating first tag
+		uint32_t migrations = statistics.migrations;
+		while (statistics.migrations == migrations){
+			buffer = 1;
+			btstack_tlv_impl->store_tag(&btstack_tlv_context, 1, &buffer, 1);
+			btstack_tlv_flash_sector_get_statistics(&btstack_tlv_context, &statistics);
+		}
+		btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, hal_flash_sector_impl, &hal_flash_sector_context);
+	}
+}
+
+TEST(BSTACK_TLV, TestWearStatistics){
+	btstack_tlv_impl = btstack_tlv_flash_sector_init_instance(&btstack_tlv_context, hal_flash_sector_impl, &hal_flash_sector_context);
+	btstack_tlv_flash_sector_statistics_t statistics;
+	btstack_tlv_flash_sector_get_statistics(&btstack_tlv_context, &statistics);
+	// no valid bank found, both erased
+	CHECK_EQUAL(1, statistics.erase_count[0]);
+	CHECK_EQUAL(1, statistics.erase_count[1]);
+	CHECK_EQUAL(HAL_FLASH_SECTOR_MEMORY_STORAGE_SIZE / 2 - 8, statistics.bytes_free);
+
+	uint32_t tag = 'abcd';
+	uint8_t  data[8];
+	memcpy(data, "01234567", 8);
+	while (statistics.migrations < 2){
+		btstack_tlv_impl->store_tag(&btstack_tlv_context, tag, data, 8);
+		btstack_tlv_flash_sector_get_statistics(&btstack_tlv_context, &statistics);
+	}
+	CHECK_EQUAL(2, statistics.erase_count[0]);
+	CHECK_EQUAL(2, statistics.erase_count[1]);
+	// entries plus one migrated entry per migration
+	CHECK_EQUAL(statistics.entries_written * 16 + 2 * 16, statistics.bytes_written);
+	CHECK_EQUAL(HAL_FLASH_SECTOR_MEMORY_STORAGE_SIZE / 2 - 8, statistics.bytes_live + statistics.bytes_stale + statistics.bytes_free);
+}
+
 //
 
 TEST_GROUP(LINK_KEY_DB){
@@ -0,0 +1,963 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "hci_benchmark.c"
+
+/*
+ *  hci_benchmark.c
+ *
+ *  Full-stack throughput and latency benchmark against the virtual controller
+ *
+ *  BTstack keeps its state in singletons, so a single instance runs against a scripted peer
+ *  that lives inside the virtual controller. For each scenario, the peer connects and sets up
+ *  the data channel, then the application sends as fast as the flow control allows until the
+ *  configured number of payload bytes has arrived at the peer.
+ *
+ *  Scenarios:
+ *  - gatt:  GATT Notifications, LE
+ *  - le:    LE Data Channel (credit based flow control)
+ *  - spp:   RFCOMM / SPP, BR/EDR
+ *  - a2dp:  A2DP Source media packets, BR/EDR
+ *
+ *  CPU time is split into BTstack, virtual controller, scripted peer and application.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btstack_config.h"
+#include "bluetooth_sdp.h"
+#include "btstack_debug.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_embedded.h"
+#include "btstack_util.h"
+#include "hal_cpu.h"
+#include "hal_time_ms.h"
+#include "hci.h"
+#include "hci_dump.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+#include "ble/att_db_util.h"
+#include "ble/att_server.h"
+#include "ble/le_device_db.h"
+#include "ble/sm.h"
+#include "classic/a2dp_source.h"
+#include "classic/rfcomm.h"
+
+#include "hci_transport_virtual.h"
+
+#define BENCHMARK_DEFAULT_BYTES     (4 * 1024 * 1024)
+#define BENCHMARK_TIMEOUT_MS        60000
+#define LATENCY_SLOTS               1024
+
+#define LE_DATA_CHANNEL_PSM         0x0081
+#define RFCOMM_SERVER_CHANNEL       1
+#define PEER_ATT_MTU                247
+#define PEER_LE_CREDITS             10
+#define PEER_RFCOMM_CREDITS         10
+#define PEER_RFCOMM_FRAME_SIZE      1000
+#define PEER_L2CAP_MTU              1691
+#define SBC_FRAME_SIZE              119
+#define SBC_FRAMES_PER_PACKET       5
+#define RTP_HEADER_SIZE             12
+
+#define PEER_CID_SIGNALING          0x0041
+#define PEER_CID_MEDIA              0x0042
+#define PEER_CID_LE_DATA_CHANNEL    0x0043
+
+// HAL for embedded run loop
+
+uint32_t hal_time_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void hal_cpu_disable_irqs(void){
+}
+
+void hal_cpu_enable_irqs(void){
+}
+
+void hal_cpu_enable_irqs_and_sleep(void){
+    // wait for next connection event
+    if (hci_transport_virtual_has_pending_work()) return;
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_IDLE);
+    struct timespec ts = { 0, 500000 };
+    nanosleep(&ts, NULL);
+    hci_transport_virtual_enter_layer(layer);
+}
+
+static uint64_t now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Benchmark state
+
+typedef struct {
+    const char * name;
+    uint16_t     psm;   // BR/EDR only
+    void (*peer_connect)(void);
+    void (*app_start)(void);
+} benchmark_scenario_t;
+
+static const benchmark_scenario_t * scenario;
+
+static uint32_t bytes_target = BENCHMARK_DEFAULT_BYTES;
+static int      app_ready;      // data channel established
+static int      app_sending;    // measurement running
+static uint32_t app_bytes_sent;
+static int      connected;
+static int      hci_working;
+
+static uint32_t peer_packets_received;
+static uint32_t peer_bytes_received;
+static uint64_t latency_sum_ns;
+static uint64_t latency_max_ns;
+
+static uint32_t next_sequence_number;
+static uint64_t send_time_ns[LATENCY_SLOTS];
+
+static uint8_t app_buffer[HCI_ACL_PAYLOAD_SIZE];
+
+static btstack_packet_callback_registration_t hci_event_callback_registration;
+
+// stamp sequence number into first four bytes of payload
+static void app_prepare_payload(uint8_t * payload, uint16_t len){
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_APP);
+    little_endian_store_32(payload, 0, next_sequence_number);
+    send_time_ns[next_sequence_number % LATENCY_SLOTS] = now_ns();
+    next_sequence_number++;
+    app_bytes_sent += len;
+    hci_transport_virtual_enter_layer(layer);
+}
+
+static int app_can_send_more(void){
+    return app_sending && app_bytes_sent < bytes_target;
+}
+
+static void peer_payload_received(const uint8_t * payload, uint16_t len){
+    if (!app_sending || len < 4) return;
+    uint32_t sequence_number = little_endian_read_32(payload, 0);
+    uint64_t latency_ns = now_ns() - send_time_ns[sequence_number % LATENCY_SLOTS];
+    latency_sum_ns += latency_ns;
+    if (latency_ns > latency_max_ns){
+        latency_max_ns = latency_ns;
+    }
+    peer_packets_received++;
+    peer_bytes_received += len;
+}
+
+// Scripted peer: L2CAP
+
+typedef struct {
+    uint16_t local_cid;
+    uint16_t remote_cid;
+    uint16_t psm;
+    uint8_t  config_request_received;
+    uint8_t  config_response_received;
+    uint8_t  open;
+} peer_l2cap_channel_t;
+
+static hci_con_handle_t peer_con_handle;
+static uint8_t peer_sig_id = 1;
+static bd_addr_t peer_addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+static peer_l2cap_channel_t peer_channels[2];
+
+static void peer_channel_opened(peer_l2cap_channel_t * channel);
+
+static void peer_send_signaling(uint16_t cid, uint8_t code, uint8_t identifier, const uint8_t * data, uint16_t len){
+    uint8_t pdu[32];
+    pdu[0] = code;
+    pdu[1] = identifier;
+    little_endian_store_16(pdu, 2, len);
+    memcpy(&pdu[4], data, len);
+    hci_transport_virtual_peer_send_l2cap(peer_con_handle, cid, pdu, 4 + len);
+}
+
+static peer_l2cap_channel_t * peer_channel_for_local_cid(uint16_t local_cid){
+    unsigned int i;
+    for (i = 0; i < sizeof(peer_channels) / sizeof(peer_l2cap_channel_t); i++){
+        if (peer_channels[i].local_cid == local_cid) return &peer_channels[i];
+    }
+    return NULL;
+}
+
+static void peer_l2cap_create_channel(peer_l2cap_channel_t * channel, uint16_t psm, uint16_t local_cid){
+    memset(channel, 0, sizeof(peer_l2cap_channel_t));
+    channel->psm = psm;
+    channel->local_cid = local_cid;
+    uint8_t data[4];
+    little_endian_store_16(data, 0, psm);
+    little_endian_store_16(data, 2, local_cid);
+    peer_send_signaling(L2CAP_CID_SIGNALING, CONNECTION_REQUEST, peer_sig_id++, data, sizeof(data));
+}
+
+static void peer_l2cap_check_open(peer_l2cap_channel_t * channel){
+    if (channel->open) return;
+    if (!channel->config_request_received || !channel->config_response_received) return;
+    channel->open = 1;
+    peer_channel_opened(channel);
+}
+
+static void peer_handle_signaling(const uint8_t * command){
+    uint8_t  code       = command[0];
+    uint8_t  identifier = command[1];
+    uint8_t  data[8];
+    peer_l2cap_channel_t * channel;
+
+    switch (code){
+        case CONNECTION_RESPONSE:
+            channel = peer_channel_for_local_cid(little_endian_read_16(command, 6));
+            if (!channel) break;
+            if (little_endian_read_16(command, 8) != 0) break;  // pending
+            channel->remote_cid = little_endian_read_16(command, 4);
+            // config request with MTU option
+            little_endian_store_16(data, 0, channel->remote_cid);
+            little_endian_store_16(data, 2, 0);
+            data[4] = 1;
+            data[5] = 2;
+            little_endian_store_16(data, 6, PEER_L2CAP_MTU);
+            peer_send_signaling(L2CAP_CID_SIGNALING, CONFIGURE_REQUEST, peer_sig_id++, data, 8);
+            break;
+        case CONFIGURE_REQUEST:
+            channel = peer_channel_for_local_cid(little_endian_read_16(command, 4));
+            if (!channel) break;
+            little_endian_store_16(data, 0, channel->remote_cid);
+            little_endian_store_16(data, 2, 0);
+            little_endian_store_16(data, 4, 0);
+            peer_send_signaling(L2CAP_CID_SIGNALING, CONFIGURE_RESPONSE, identifier, data, 6);
+            channel->config_request_received = 1;
+            peer_l2cap_check_open(channel);
+            break;
+        case CONFIGURE_RESPONSE:
+            channel = peer_channel_for_local_cid(little_endian_read_16(command, 4));
+            if (!channel) break;
+            channel->config_response_received = 1;
+            peer_l2cap_check_open(channel);
+            break;
+        case DISCONNECTION_REQUEST:
+            peer_send_signaling(L2CAP_CID_SIGNALING, DISCONNECTION_RESPONSE, identifier, &command[4], 4);
+            break;
+        case INFORMATION_REQUEST:
+            // not supported
+            little_endian_store_16(data, 0, little_endian_read_16(command, 4));
+            little_endian_store_16(data, 2, 1);
+            peer_send_signaling(L2CAP_CID_SIGNALING, INFORMATION_RESPONSE, identifier, data, 4);
+            break;
+        default:
+            break;
+    }
+}
+
+// Scripted peer: GATT Client
+
+static uint16_t gatt_value_handle;
+static uint16_t gatt_mtu;
+static hci_con_handle_t gatt_con_handle;
+
+static void peer_gatt_connect(void){
+    peer_con_handle = hci_transport_virtual_peer_le_connect(peer_addr);
+    uint8_t request[3];
+    request[0] = ATT_EXCHANGE_MTU_REQUEST;
+    little_endian_store_16(request, 1, PEER_ATT_MTU);
+    hci_transport_virtual_peer_send_l2cap(peer_con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, request, sizeof(request));
+}
+
+static void peer_gatt_handle_pdu(const uint8_t * pdu, uint16_t len){
+    uint8_t request[5];
+    switch (pdu[0]){
+        case ATT_EXCHANGE_MTU_RESPONSE:
+            // enable notifications
+            request[0] = ATT_WRITE_REQUEST;
+            little_endian_store_16(request, 1, gatt_value_handle + 1);
+            little_endian_store_16(request, 3, GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION);
+            hci_transport_virtual_peer_send_l2cap(peer_con_handle, L2CAP_CID_ATTRIBUTE_PROTOCOL, request, sizeof(request));
+            break;
+        case ATT_HANDLE_VALUE_NOTIFICATION:
+            peer_payload_received(&pdu[3], len - 3);
+            break;
+        default:
+            break;
+    }
+}
+
+// Application: GATT Server
+
+static uint16_t app_gatt_payload_size(void){
+    return gatt_mtu - 3;
+}
+
+static void app_gatt_start(void){
+    att_server_request_can_send_now_event(gatt_con_handle);
+}
+
+static int app_att_write_callback(hci_con_handle_t con_handle, uint16_t attribute_handle, uint16_t transaction_mode, uint16_t offset, uint8_t *buffer, uint16_t buffer_size){
+    UNUSED(transaction_mode);
+    UNUSED(offset);
+    if (attribute_handle != gatt_value_handle + 1 || buffer_size < 2) return 0;
+    if (little_endian_read_16(buffer, 0) != GATT_CLIENT_CHARACTERISTICS_CONFIGURATION_NOTIFICATION) return 0;
+    gatt_con_handle = con_handle;
+    app_ready = 1;
+    return 0;
+}
+
+static void app_att_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case ATT_EVENT_MTU_EXCHANGE_COMPLETE:
+            gatt_mtu = att_event_mtu_exchange_complete_get_MTU(packet);
+            break;
+        case ATT_EVENT_CAN_SEND_NOW:
+            if (!app_can_send_more()) break;
+            app_prepare_payload(app_buffer, app_gatt_payload_size());
+            att_server_notify(gatt_con_handle, gatt_value_handle, app_buffer, app_gatt_payload_size());
+            att_server_request_can_send_now_event(gatt_con_handle);
+            break;
+        default:
+            break;
+    }
+}
+
+// Scripted peer: LE Data Channel
+
+static uint16_t le_remote_cid;
+static uint16_t le_sdu_len;
+static uint16_t le_sdu_pos;
+static uint16_t le_credits_consumed;
+static uint8_t  le_sdu_buffer[HCI_ACL_PAYLOAD_SIZE];
+
+static void peer_le_connect(void){
+    peer_con_handle = hci_transport_virtual_peer_le_connect(peer_addr);
+    uint8_t data[10];
+    little_endian_store_16(data, 0, LE_DATA_CHANNEL_PSM);
+    little_endian_store_16(data, 2, PEER_CID_LE_DATA_CHANNEL);
+    little_endian_store_16(data, 4, sizeof(le_sdu_buffer));
+    little_endian_store_16(data, 6, 251 - 4);   // MPS, one K-frame per LE Data PDU
+    little_endian_store_16(data, 8, PEER_LE_CREDITS);
+    le_sdu_len = 0;
+    le_credits_consumed = 0;
+    peer_send_signaling(L2CAP_CID_SIGNALING_LE, LE_CREDIT_BASED_CONNECTION_REQUEST, peer_sig_id++, data, sizeof(data));
+}
+
+static void peer_le_handle_signaling(const uint8_t * command){
+    uint8_t data[4];
+    switch (command[0]){
+        case LE_CREDIT_BASED_CONNECTION_RESPONSE:
+            le_remote_cid = little_endian_read_16(command, 4);
+            break;
+        case CONNECTION_PARAMETER_UPDATE_REQUEST:
+            little_endian_store_16(data, 0, 0);
+            peer_send_signaling(L2CAP_CID_SIGNALING_LE, CONNECTION_PARAMETER_UPDATE_RESPONSE, command[1], data, 2);
+            break;
+        default:
+            break;
+    }
+}
+
+static void peer_le_handle_k_frame(const uint8_t * pdu, uint16_t len){
+    if (le_sdu_len == 0){
+        // first K-frame contains SDU length
+        if (len < 2) return;
+        le_sdu_len = little_endian_read_16(pdu, 0);
+        le_sdu_pos = 0;
+        pdu += 2;
+        len -= 2;
+    }
+    if (le_sdu_pos + len > sizeof(le_sdu_buffer)) {
+        le_sdu_len = 0;
+        return;
+    }
+    memcpy(&le_sdu_buffer[le_sdu_pos], pdu, len);
+    le_sdu_pos += len;
+    if (le_sdu_pos >= le_sdu_len){
+        peer_payload_received(le_sdu_buffer, le_sdu_len);
+        le_sdu_len = 0;
+    }
+
+    // return credits in batches
+    le_credits_consumed++;
+    if (le_credits_consumed < PEER_LE_CREDITS / 2) return;
+    uint8_t data[4];
+    little_endian_store_16(data, 0, le_remote_cid);
+    little_endian_store_16(data, 2, le_credits_consumed);
+    le_credits_consumed = 0;
+    peer_send_signaling(L2CAP_CID_SIGNALING_LE, LE_FLOW_CONTROL_CREDIT, peer_sig_id++, data, sizeof(data));
+}
+
+// Application: LE Data Channel
+
+static uint16_t le_local_cid;
+static uint16_t le_sdu_size;
+static uint8_t  le_receive_buffer[100];
+
+static void app_le_start(void){
+    l2cap_le_request_can_send_now_event(le_local_cid);
+}
+
+static void app_le_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case L2CAP_EVENT_LE_INCOMING_CONNECTION:
+            l2cap_le_accept_connection(l2cap_event_le_incoming_connection_get_local_cid(packet), le_receive_buffer, sizeof(le_receive_buffer), 1);
+            break;
+        case L2CAP_EVENT_LE_CHANNEL_OPENED:
+            if (l2cap_event_le_channel_opened_get_status(packet)) break;
+            le_local_cid = l2cap_event_le_channel_opened_get_local_cid(packet);
+            le_sdu_size  = btstack_min(l2cap_event_le_channel_opened_get_remote_mtu(packet), 1000);
+            app_ready = 1;
+            break;
+        case L2CAP_EVENT_LE_CAN_SEND_NOW:
+            if (!app_can_send_more()) break;
+            // buffer is owned by L2CAP until L2CAP_EVENT_LE_PACKET_SENT
+            app_prepare_payload(app_buffer, le_sdu_size);
+            l2cap_le_send_data(le_local_cid, app_buffer, le_sdu_size);
+            break;
+        case L2CAP_EVENT_LE_PACKET_SENT:
+            if (!app_can_send_more()) break;
+            l2cap_le_request_can_send_now_event(le_local_cid);
+            break;
+        default:
+            break;
+    }
+}
+
+// Scripted peer: RFCOMM client
+
+#define PEER_RFCOMM_DLCI (RFCOMM_SERVER_CHANNEL << 1)
+
+static uint16_t rfcomm_credits_consumed;
+
+static void peer_rfcomm_send(uint8_t dlci, uint8_t control, uint8_t credits, const uint8_t * data, uint8_t len){
+    uint8_t frame[16];
+    int pos = 0;
+    frame[pos++] = (dlci << 2) | (1 << 1) | 1;  // initiator, C/R = 1
+    frame[pos++] = control;
+    frame[pos++] = (len << 1) | 1;
+    if (control == BT_RFCOMM_UIH_PF){
+        frame[pos++] = credits;
+    }
+    memcpy(&frame[pos], data, len);
+    pos += len;
+    // UIH frames only calc FCS over address + control
+    frame[pos] = crc8_calc(frame, ((control & 0xef) == BT_RFCOMM_UIH) ? 2 : 3);
+    pos++;
+    hci_transport_virtual_peer_send_l2cap(peer_con_handle, peer_channels[0].remote_cid, frame, pos);
+}
+
+static void peer_spp_connect(void){
+    rfcomm_credits_consumed = 0;
+    hci_transport_virtual_peer_classic_connect(peer_addr);
+}
+
+static void peer_spp_handle_frame(const uint8_t * frame, uint16_t len){
+    uint8_t  dlci    = frame[0] >> 2;
+    uint8_t  control = frame[1];
+    uint16_t payload_offset = 3;
+    uint16_t payload_len = frame[2] >> 1;
+    uint8_t  data[10];
+    if ((frame[2] & 1) == 0){
+        payload_len |= frame[3] << 7;
+        payload_offset++;
+    }
+    if (control == BT_RFCOMM_UIH_PF){
+        payload_offset++;
+    }
+    if (payload_offset + payload_len + 1 > len) return;
+    const uint8_t * payload = &frame[payload_offset];
+
+    switch (control){
+        case BT_RFCOMM_UA:
+            if (dlci == 0){
+                // multiplexer open, negotiate parameters with credit based flow control
+                data[0] = BT_RFCOMM_PN_CMD;
+                data[1] = (8 << 1) | 1;
+                data[2] = PEER_RFCOMM_DLCI;
+                data[3] = 0xf0;
+                data[4] = 0;
+                data[5] = 0;
+                little_endian_store_16(data, 6, PEER_RFCOMM_FRAME_SIZE);
+                data[8] = 0;
+                data[9] = PEER_RFCOMM_CREDITS;
+                peer_rfcomm_send(0, BT_RFCOMM_UIH, 0, data, 10);
+            }
+            break;
+        case BT_RFCOMM_UIH:
+        case BT_RFCOMM_UIH_PF:
+            if (dlci == PEER_RFCOMM_DLCI){
+                if (payload_len == 0) break;
+                peer_payload_received(payload, payload_len);
+                rfcomm_credits_consumed++;
+                if (rfcomm_credits_consumed < PEER_RFCOMM_CREDITS / 2) break;
+                peer_rfcomm_send(PEER_RFCOMM_DLCI, BT_RFCOMM_UIH_PF, rfcomm_credits_consumed, NULL, 0);
+                rfcomm_credits_consumed = 0;
+                break;
+            }
+            if (dlci != 0 || payload_len == 0) break;
+            switch (payload[0]){
+                case BT_RFCOMM_PN_RSP:
+                    peer_rfcomm_send(PEER_RFCOMM_DLCI, BT_RFCOMM_SABM, 0, NULL, 0);
+                    break;
+                case BT_RFCOMM_MSC_CMD:
+                    // confirm and send own modem status
+                    memcpy(data, payload, 4);
+                    data[0] = BT_RFCOMM_MSC_RSP;
+                    peer_rfcomm_send(0, BT_RFCOMM_UIH, 0, data, 4);
+                    data[0] = BT_RFCOMM_MSC_CMD;
+                    data[2] = (PEER_RFCOMM_DLCI << 2) | (1 << 1) | 1;
+                    data[3] = 0x8d;
+                    peer_rfcomm_send(0, BT_RFCOMM_UIH, 0, data, 4);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Application: SPP Server
+
+static uint16_t spp_rfcomm_cid;
+static uint16_t spp_frame_size;
+
+static void app_spp_start(void){
+    rfcomm_request_can_send_now_event(spp_rfcomm_cid);
+}
+
+static void app_spp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case RFCOMM_EVENT_INCOMING_CONNECTION:
+            rfcomm_accept_connection(rfcomm_event_incoming_connection_get_rfcomm_cid(packet));
+            break;
+        case RFCOMM_EVENT_CHANNEL_OPENED:
+            if (rfcomm_event_channel_opened_get_status(packet)) break;
+            spp_rfcomm_cid = rfcomm_event_channel_opened_get_rfcomm_cid(packet);
+            spp_frame_size = rfcomm_event_channel_opened_get_max_frame_size(packet);
+            app_ready = 1;
+            break;
+        case RFCOMM_EVENT_CAN_SEND_NOW:
+            if (!app_can_send_more()) break;
+            app_prepare_payload(app_buffer, spp_frame_size);
+            rfcomm_send(spp_rfcomm_cid, app_buffer, spp_frame_size);
+            rfcomm_request_can_send_now_event(spp_rfcomm_cid);
+            break;
+        default:
+            break;
+    }
+}
+
+// Scripted peer: A2DP Sink
+
+static uint8_t a2dp_local_seid;
+static uint8_t avdtp_transaction_label;
+
+static void peer_avdtp_send_command(uint8_t signal_identifier, const uint8_t * data, uint16_t len){
+    uint8_t pdu[32];
+    pdu[0] = (avdtp_transaction_label++ << 4) | (AVDTP_SINGLE_PACKET << 2) | AVDTP_CMD_MSG;
+    pdu[1] = signal_identifier;
+    memcpy(&pdu[2], data, len);
+    avdtp_transaction_label &= 0x0f;
+    hci_transport_virtual_peer_send_l2cap(peer_con_handle, peer_channels[0].remote_cid, pdu, 2 + len);
+}
+
+static void peer_a2dp_connect(void){
+    hci_transport_virtual_peer_classic_connect(peer_addr);
+}
+
+static void peer_a2dp_handle_signaling(const uint8_t * pdu, uint16_t len){
+    if (len < 2) return;
+    uint8_t message_type      = pdu[0] & 0x03;
+    uint8_t signal_identifier = pdu[1] & 0x3f;
+    uint8_t data[2];
+
+    if (message_type == AVDTP_CMD_MSG){
+        // accept all commands, e.g. Start
+        data[0] = (pdu[0] & 0xf0) | (AVDTP_SINGLE_PACKET << 2) | AVDTP_RESPONSE_ACCEPT_MSG;
+        data[1] = signal_identifier;
+        hci_transport_virtual_peer_send_l2cap(peer_con_handle, peer_channels[0].remote_cid, data, 2);
+        return;
+    }
+    if (message_type != AVDTP_RESPONSE_ACCEPT_MSG) {
+        log_error("peer: AVDTP signal %u rejected", signal_identifier);
+        return;
+    }
+    switch (signal_identifier){
+        case AVDTP_SI_SET_CONFIGURATION:
+            data[0] = a2dp_local_seid << 2;
+            peer_avdtp_send_command(AVDTP_SI_OPEN, data, 1);
+            break;
+        case AVDTP_SI_OPEN:
+            peer_l2cap_create_channel(&peer_channels[1], BLUETOOTH_PROTOCOL_AVDTP, PEER_CID_MEDIA);
+            break;
+        default:
+            break;
+    }
+}
+
+static void peer_a2dp_signaling_opened(void){
+    // SBC, 44.1 kHz, joint stereo, 16 blocks, 8 subbands, loudness, bitpool 2..53
+    const uint8_t configuration[] = {
+        0, 1 << 2,
+        AVDTP_MEDIA_TRANSPORT, 0,
+        AVDTP_MEDIA_CODEC, 6, AVDTP_AUDIO << 4, AVDTP_CODEC_SBC, 0x21, 0x15, 2, 53,
+    };
+    uint8_t data[sizeof(configuration)];
+    memcpy(data, configuration, sizeof(configuration));
+    data[0] = a2dp_local_seid << 2;
+    peer_avdtp_send_command(AVDTP_SI_SET_CONFIGURATION, data, sizeof(data));
+}
+
+// Application: A2DP Source
+
+static uint8_t sbc_codec_capabilities[] = {
+    0xff, 0xff, 2, 53
+};
+static uint8_t sbc_codec_configuration[4];
+
+static void app_a2dp_start(void){
+    a2dp_source_stream_endpoint_request_can_send_now(a2dp_local_seid);
+}
+
+static void app_a2dp_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != HCI_EVENT_A2DP_META) return;
+    uint16_t media_payload_size = SBC_FRAME_SIZE * SBC_FRAMES_PER_PACKET;
+    switch (packet[2]){
+        case A2DP_SUBEVENT_STREAM_ESTABLISHED:
+            a2dp_source_start_stream(a2dp_local_seid);
+            break;
+        case A2DP_SUBEVENT_STREAM_START_ACCEPTED:
+            app_ready = 1;
+            break;
+        case A2DP_SUBEVENT_STREAMING_CAN_SEND_MEDIA_PACKET_NOW:
+            if (!app_can_send_more()) break;
+            app_prepare_payload(app_buffer, media_payload_size);
+            a2dp_source_stream_send_media_payload(a2dp_local_seid, app_buffer, media_payload_size, SBC_FRAMES_PER_PACKET, 0);
+            a2dp_source_stream_endpoint_request_can_send_now(a2dp_local_seid);
+            break;
+        default:
+            break;
+    }
+}
+
+// Scripted peer: dispatch
+
+static void peer_channel_opened(peer_l2cap_channel_t * channel){
+    switch (channel->local_cid){
+        case PEER_CID_SIGNALING:
+            if (channel->psm == BLUETOOTH_PROTOCOL_RFCOMM){
+                peer_rfcomm_send(0, BT_RFCOMM_SABM, 0, NULL, 0);
+            } else {
+                peer_a2dp_signaling_opened();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void peer_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    hci_con_handle_t con_handle = channel;
+    switch (packet_type){
+        case HCI_EVENT_PACKET:
+            if (hci_event_packet_get_type(packet) != HCI_EVENT_CONNECTION_COMPLETE) break;
+            if (packet[2]) break;
+            // BR/EDR connection accepted by host, connect to profile
+            peer_con_handle = con_handle;
+            peer_l2cap_create_channel(&peer_channels[0], scenario->psm, PEER_CID_SIGNALING);
+            break;
+        case HCI_ACL_DATA_PACKET: {
+            uint16_t cid = little_endian_read_16(packet, 2);
+            uint8_t * pdu = &packet[4];
+            uint16_t len = size - 4;
+            switch (cid){
+                case L2CAP_CID_SIGNALING:
+                    peer_handle_signaling(pdu);
+                    break;
+                case L2CAP_CID_SIGNALING_LE:
+                    peer_le_handle_signaling(pdu);
+                    break;
+                case L2CAP_CID_ATTRIBUTE_PROTOCOL:
+                    peer_gatt_handle_pdu(pdu, len);
+                    break;
+                case PEER_CID_LE_DATA_CHANNEL:
+                    peer_le_handle_k_frame(pdu, len);
+                    break;
+                case PEER_CID_SIGNALING:
+                    if (peer_channels[0].psm == BLUETOOTH_PROTOCOL_RFCOMM){
+                        peer_spp_handle_frame(pdu, len);
+                    } else {
+                        peer_a2dp_handle_signaling(pdu, len);
+                    }
+                    break;
+                case PEER_CID_MEDIA:
+                    // skip RTP header and SBC media payload header
+                    if (len <= RTP_HEADER_SIZE + 1) break;
+                    peer_payload_received(&pdu[RTP_HEADER_SIZE + 1], len - RTP_HEADER_SIZE - 1);
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Benchmark driver
+
+static const benchmark_scenario_t scenarios[] = {
+    { "gatt", 0,                         &peer_gatt_connect, &app_gatt_start },
+    { "le",   0,                         &peer_le_connect,   &app_le_start   },
+    { "spp",  BLUETOOTH_PROTOCOL_RFCOMM, &peer_spp_connect,  &app_spp_start  },
+    { "a2dp", BLUETOOTH_PROTOCOL_AVDTP,  &peer_a2dp_connect, &app_a2dp_start },
+};
+
+static void hci_packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case BTSTACK_EVENT_STATE:
+            hci_working = btstack_event_state_get_state(packet) == HCI_STATE_WORKING;
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            connected = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+static int run_until(int * condition, int value){
+    uint32_t start_ms = hal_time_ms();
+    while (*condition != value){
+        btstack_run_loop_embedded_execute_once();
+        if (hal_time_ms() - start_ms > BENCHMARK_TIMEOUT_MS) return 0;
+    }
+    return 1;
+}
+
+static int run_measurement(void){
+    uint32_t start_ms = hal_time_ms();
+    while (peer_bytes_received < bytes_target){
+        btstack_run_loop_embedded_execute_once();
+        if (hal_time_ms() - start_ms > BENCHMARK_TIMEOUT_MS) return 0;
+    }
+    return 1;
+}
+
+static const char * layer_names[] = { "btstack", "controller", "peer", "app", "idle" };
+
+static int run_scenario(const benchmark_scenario_t * the_scenario){
+    scenario = the_scenario;
+    app_ready = 0;
+    app_sending = 0;
+    app_bytes_sent = 0;
+    peer_packets_received = 0;
+    peer_bytes_received = 0;
+    latency_sum_ns = 0;
+    latency_max_ns = 0;
+    memset(peer_channels, 0, sizeof(peer_channels));
+
+    // connect and set up data channel
+    connected = 1;
+    (*scenario->peer_connect)();
+    if (!run_until(&app_ready, 1)){
+        printf("%-5s: setup failed\n", scenario->name);
+        return 0;
+    }
+
+    // measure
+    hci_transport_virtual_reset_statistics();
+    hci_transport_virtual_set_cpu_accounting(1);
+    app_sending = 1;
+    uint64_t start_ns = now_ns();
+    (*scenario->app_start)();
+    int ok = run_measurement();
+    uint64_t elapsed_ns = now_ns() - start_ns;
+    app_sending = 0;
+
+    uint64_t cpu_time_ns[HCI_TRANSPORT_VIRTUAL_LAYER_COUNT];
+    hci_transport_virtual_get_cpu_time_ns(cpu_time_ns);
+    hci_transport_virtual_set_cpu_accounting(0);
+    hci_transport_virtual_statistics_t statistics;
+    hci_transport_virtual_get_statistics(&statistics);
+
+    double seconds = elapsed_ns / 1e9;
+    printf("%-5s: %s%8u packets, %9u bytes, %9.0f packets/s, %7.2f MB/s, latency avg %6.1f us, max %7.1f us\n",
+        scenario->name, ok ? "" : "TIMEOUT ",
+        peer_packets_received, peer_bytes_received,
+        peer_packets_received / seconds, peer_bytes_received / seconds / 1e6,
+        peer_packets_received ? latency_sum_ns / 1e3 / peer_packets_received : 0.0, latency_max_ns / 1e3);
+    uint64_t cpu_total_ns = 0;
+    int i;
+    for (i = 0; i < HCI_TRANSPORT_VIRTUAL_LAYER_COUNT; i++){
+        cpu_total_ns += cpu_time_ns[i];
+    }
+    printf("       cpu:");
+    for (i = 0; i < HCI_TRANSPORT_VIRTUAL_LAYER_COUNT; i++){
+        printf(" %s %.1f ms (%.0f%%)%s", layer_names[i], cpu_time_ns[i] / 1e6,
+            cpu_total_ns ? 100.0 * cpu_time_ns[i] / cpu_total_ns : 0.0,
+            i + 1 < HCI_TRANSPORT_VIRTUAL_LAYER_COUNT ? "," : "\n");
+    }
+    printf("       btstack cpu per packet %.2f us, hci: %u acl packets, %u completed packets events, max %u packets in controller, %u credit violations\n",
+        peer_packets_received ? cpu_time_ns[HCI_TRANSPORT_VIRTUAL_LAYER_HOST] / 1e3 / peer_packets_received : 0.0,
+        statistics.acl_packets_to_controller, statistics.completed_packets_events,
+        statistics.max_packets_in_controller, statistics.credit_violations);
+
+    // disconnect
+    hci_transport_virtual_peer_disconnect(peer_con_handle);
+    run_until(&connected, 0);
+    return ok && statistics.credit_violations == 0;
+}
+
+static void usage(const char * name){
+    printf("Usage: %s [-n bytes] [-i connection interval ms] [-p packets per connection event] [-d dump.pklg] [scenario...]\n", name);
+    printf("Scenarios: gatt le spp a2dp (default: all)\n");
+}
+
+int main(int argc, char * argv[]){
+    hci_transport_virtual_config_t config;
+    memset(&config, 0, sizeof(config));
+    bd_addr_t controller_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01 };
+    bd_addr_copy(config.bd_addr, controller_addr);
+    config.acl_packet_len  = 1021;  // 3-DH5
+    config.acl_packets_num = 8;
+    config.le_packet_len   = 251;   // LE Data Length Extension
+    config.le_packets_num  = 8;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:i:p:d:h")) != -1){
+        switch (opt){
+            case 'n':
+                bytes_target = atoi(optarg);
+                break;
+            case 'i':
+                config.connection_interval_ms = atoi(optarg);
+                break;
+            case 'p':
+                config.packets_per_event = atoi(optarg);
+                break;
+            case 'd':
+                hci_dump_open(optarg, HCI_DUMP_PACKETLOGGER);
+                break;
+            default:
+                usage(argv[0]);
+                return 0;
+        }
+    }
+
+    btstack_memory_init();
+    btstack_run_loop_init(btstack_run_loop_embedded_get_instance());
+
+    hci_init(hci_transport_virtual_instance(), &config);
+    hci_transport_virtual_register_peer_packet_handler(&peer_packet_handler);
+    hci_event_callback_registration.callback = &hci_packet_handler;
+    hci_add_event_handler(&hci_event_callback_registration);
+
+    l2cap_init();
+
+    // GATT Server
+    le_device_db_init();
+    sm_init();
+    att_db_util_init();
+    att_db_util_add_service_uuid16(0xfff0);
+    gatt_value_handle = att_db_util_add_characteristic_uuid16(0xfff1, ATT_PROPERTY_NOTIFY, app_buffer, 1);
+    att_server_init(att_db_util_get_address(), NULL, &app_att_write_callback);
+    att_server_register_packet_handler(&app_att_packet_handler);
+
+    // LE Data Channel
+    l2cap_le_register_service(&app_le_packet_handler, LE_DATA_CHANNEL_PSM, LEVEL_0);
+
+    // SPP
+    rfcomm_init();
+    rfcomm_set_required_security_level(LEVEL_0);
+    rfcomm_register_service(&app_spp_packet_handler, RFCOMM_SERVER_CHANNEL, 0xffff);
+
+    // A2DP Source
+    a2dp_source_init();
+    a2dp_source_register_packet_handler(&app_a2dp_packet_handler);
+    a2dp_local_seid = a2dp_source_create_stream_endpoint(AVDTP_AUDIO, AVDTP_CODEC_SBC, sbc_codec_capabilities, sizeof(sbc_codec_capabilities),
+        sbc_codec_configuration, sizeof(sbc_codec_configuration));
+
+    hci_power_control(HCI_POWER_ON);
+    if (!run_until(&hci_working, 1)){
+        printf("HCI init failed\n");
+        return 1;
+    }
+
+    printf("Virtual controller: ACL %u x %u bytes, LE %u x %u bytes, connection interval %u ms, %u packets per event, %u bytes per scenario\n",
+        config.acl_packets_num, config.acl_packet_len, config.le_packets_num, config.le_packet_len,
+        config.connection_interval_ms, config.packets_per_event, bytes_target);
+
+    int failed = 0;
+    unsigned int i;
+    for (i = 0; i < sizeof(scenarios) / sizeof(benchmark_scenario_t); i++){
+        if (optind < argc){
+            int selected = 0;
+            int j;
+            for (j = optind; j < argc; j++){
+                if (strcmp(argv[j], scenarios[i].name) == 0) selected = 1;
+            }
+            if (!selected) continue;
+        }
+        if (!run_scenario(&scenarios[i])) failed = 1;
+    }
+    return failed;
+}
@@ -0,0 +1,732 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+#define __BTSTACK_FILE__ "hci_transport_virtual.c"
+
+/*
+ *  hci_transport_virtual.c
+ *
+ *  In-process virtual Bluetooth controller
+ *
+ *  - HCI Commands are answered with Command Complete or Command Status plus the follow-up event
+ *  - ACL packets from the host occupy a controller buffer until they are transmitted in the next
+ *    connection event, which reports them with a single Number Of Completed Packets event
+ *  - transmitted ACL packets are reassembled into L2CAP PDUs and passed to the scripted peer
+ *  - packets for the host are queued and delivered from a polled run loop data source
+ */
+
+#include "hci_transport_virtual.h"
+
+#include <string.h>
+#include <time.h>
+
+#include "btstack_config.h"
+#include "btstack_debug.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_cmd.h"
+
+#define VIRTUAL_MAX_CONNECTIONS         4
+#define VIRTUAL_MAX_CONTROLLER_BUFFERS  32
+#define VIRTUAL_HOST_QUEUE_SIZE         32
+#define VIRTUAL_SLOT_SIZE               (HCI_INCOMING_PRE_BUFFER_SIZE + HCI_PACKET_BUFFER_SIZE)
+
+#define VIRTUAL_HANDLE_BASE             0x0040
+
+typedef struct {
+    hci_con_handle_t con_handle;    // HCI_CON_HANDLE_INVALID if unused
+    bd_addr_t        address;
+    uint8_t          le;
+    uint8_t          pending;       // waiting for host to accept the connection
+    uint16_t         completed_packets;
+    uint16_t         reassembly_pos;
+    uint16_t         reassembly_len;
+    uint8_t          reassembly_buffer[HCI_ACL_BUFFER_SIZE];
+} virtual_connection_t;
+
+typedef struct {
+    hci_con_handle_t con_handle;
+    uint8_t          le_buffer;
+    uint16_t         len;
+    uint8_t          data[HCI_ACL_BUFFER_SIZE];
+} virtual_controller_buffer_t;
+
+typedef struct {
+    uint8_t  packet_type;
+    uint16_t len;
+    uint8_t  data[VIRTUAL_SLOT_SIZE];
+} virtual_host_slot_t;
+
+static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static void (*host_packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size) = dummy_handler;
+static btstack_packet_handler_t peer_packet_handler;
+
+static hci_transport_virtual_config_t config;
+static hci_transport_virtual_statistics_t statistics;
+static btstack_data_source_t virtual_data_source;
+
+static virtual_connection_t connections[VIRTUAL_MAX_CONNECTIONS];
+static uint16_t next_con_handle;
+
+// controller buffers, FIFO in order of arrival
+static virtual_controller_buffer_t controller_buffers[VIRTUAL_MAX_CONTROLLER_BUFFERS];
+static uint16_t controller_buffers_head;
+static uint16_t controller_buffers_count;
+static uint16_t acl_buffers_used;
+static uint16_t le_buffers_used;
+static uint32_t last_connection_event_ms;
+
+// controller -> host queue
+static virtual_host_slot_t host_queue[VIRTUAL_HOST_QUEUE_SIZE];
+static uint16_t host_queue_head;
+static uint16_t host_queue_count;
+
+// cpu accounting
+static int cpu_accounting_enabled;
+static hci_transport_virtual_layer_t cpu_layer;
+static uint64_t cpu_layer_start_ns;
+static uint64_t cpu_time_ns[HCI_TRANSPORT_VIRTUAL_LAYER_COUNT];
+
+static void dummy_handler(uint8_t packet_type, uint8_t *packet, uint16_t size){
+    UNUSED(packet_type);
+    UNUSED(packet);
+    UNUSED(size);
+}
+
+// CPU accounting
+
+static uint64_t virtual_cpu_time_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void virtual_cpu_account(void){
+    if (!cpu_accounting_enabled) return;
+    uint64_t now = virtual_cpu_time_ns();
+    cpu_time_ns[cpu_layer] += now - cpu_layer_start_ns;
+    cpu_layer_start_ns = now;
+}
+
+hci_transport_virtual_layer_t hci_transport_virtual_enter_layer(hci_transport_virtual_layer_t layer){
+    hci_transport_virtual_layer_t previous_layer = cpu_layer;
+    if (layer == previous_layer) return previous_layer;
+    virtual_cpu_account();
+    cpu_layer = layer;
+    return previous_layer;
+}
+
+void hci_transport_virtual_set_cpu_accounting(int enabled){
+    cpu_accounting_enabled = enabled;
+    memset(cpu_time_ns, 0, sizeof(cpu_time_ns));
+    cpu_layer_start_ns = virtual_cpu_time_ns();
+}
+
+void hci_transport_virtual_get_cpu_time_ns(uint64_t * time_ns){
+    // include time spent in current layer so far
+    virtual_cpu_account();
+    memcpy(time_ns, cpu_time_ns, sizeof(cpu_time_ns));
+}
+
+// connections
+
+static virtual_connection_t * virtual_connection_for_handle(hci_con_handle_t con_handle){
+    int i;
+    for (i = 0; i < VIRTUAL_MAX_CONNECTIONS; i++){
+        if (connections[i].con_handle == con_handle) return &connections[i];
+    }
+    return NULL;
+}
+
+static virtual_connection_t * virtual_connection_for_address(bd_addr_t address){
+    int i;
+    for (i = 0; i < VIRTUAL_MAX_CONNECTIONS; i++){
+        if (connections[i].con_handle == HCI_CON_HANDLE_INVALID) continue;
+        if (bd_addr_cmp(connections[i].address, address) == 0) return &connections[i];
+    }
+    return NULL;
+}
+
+static virtual_connection_t * virtual_connection_create(bd_addr_t address, int le){
+    virtual_connection_t * connection = virtual_connection_for_handle(HCI_CON_HANDLE_INVALID);
+    if (!connection) return NULL;
+    memset(connection, 0, sizeof(virtual_connection_t));
+    connection->con_handle = next_con_handle++;
+    bd_addr_copy(connection->address, address);
+    connection->le = le;
+    return connection;
+}
+
+// controller -> host
+
+static uint8_t * virtual_host_queue_reserve(uint8_t packet_type, uint16_t len){
+    if (host_queue_count == VIRTUAL_HOST_QUEUE_SIZE || len > HCI_PACKET_BUFFER_SIZE){
+        log_error("virtual controller: host queue full, dropping packet type %u", packet_type);
+        statistics.dropped_packets++;
+        return NULL;
+    }
+    virtual_host_slot_t * slot = &host_queue[(host_queue_head + host_queue_count) % VIRTUAL_HOST_QUEUE_SIZE];
+    host_queue_count++;
+    slot->packet_type = packet_type;
+    slot->len = len;
+    return &slot->data[HCI_INCOMING_PRE_BUFFER_SIZE];
+}
+
+static void virtual_emit_event(const uint8_t * event, uint16_t len){
+    uint8_t * buffer = virtual_host_queue_reserve(HCI_EVENT_PACKET, len);
+    if (!buffer) return;
+    memcpy(buffer, event, len);
+    statistics.events++;
+}
+
+static void virtual_emit_peer_event(hci_con_handle_t con_handle, uint8_t * event, uint16_t len){
+    if (!peer_packet_handler) return;
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_PEER);
+    (*peer_packet_handler)(HCI_EVENT_PACKET, con_handle, event, len);
+    hci_transport_virtual_enter_layer(layer);
+}
+
+static void virtual_emit_command_complete(uint16_t opcode, const uint8_t * return_parameters, uint16_t return_parameters_len){
+    uint8_t event[2 + 255];
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 4 + return_parameters_len;
+    event[2] = 1;   // num hci command packets
+    little_endian_store_16(event, 3, opcode);
+    event[5] = ERROR_CODE_SUCCESS;
+    memcpy(&event[6], return_parameters, return_parameters_len);
+    virtual_emit_event(event, 6 + return_parameters_len);
+}
+
+static void virtual_emit_command_status(uint16_t opcode, uint8_t status){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_COMMAND_STATUS;
+    event[1] = 4;
+    event[2] = status;
+    event[3] = 1;   // num hci command packets
+    little_endian_store_16(event, 4, opcode);
+    virtual_emit_event(event, sizeof(event));
+}
+
+static void virtual_emit_connection_complete(virtual_connection_t * connection, uint8_t status){
+    uint8_t event[13];
+    event[0] = HCI_EVENT_CONNECTION_COMPLETE;
+    event[1] = sizeof(event) - 2;
+    event[2] = status;
+    little_endian_store_16(event, 3, connection->con_handle);
+    reverse_bd_addr(connection->address, &event[5]);
+    event[11] = 1;  // ACL
+    event[12] = 0;  // encryption disabled
+    virtual_emit_event(event, sizeof(event));
+    virtual_emit_peer_event(connection->con_handle, event, sizeof(event));
+}
+
+static void virtual_emit_le_connection_complete(virtual_connection_t * connection, uint8_t role){
+    uint8_t event[21];
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    event[3] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 4, connection->con_handle);
+    event[6] = role;
+    event[7] = BD_ADDR_TYPE_LE_PUBLIC;
+    reverse_bd_addr(connection->address, &event[8]);
+    little_endian_store_16(event, 14, 6);   // interval 7.5 ms
+    little_endian_store_16(event, 16, 0);   // latency
+    little_endian_store_16(event, 18, 200); // supervision timeout 2 s
+    event[20] = 0;                          // master clock accuracy
+    virtual_emit_event(event, sizeof(event));
+    virtual_emit_peer_event(connection->con_handle, event, sizeof(event));
+}
+
+static void virtual_emit_disconnection_complete(virtual_connection_t * connection, uint8_t reason){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    event[1] = sizeof(event) - 2;
+    event[2] = ERROR_CODE_SUCCESS;
+    little_endian_store_16(event, 3, connection->con_handle);
+    event[5] = reason;
+    virtual_emit_event(event, sizeof(event));
+    virtual_emit_peer_event(connection->con_handle, event, sizeof(event));
+}
+
+static void virtual_connection_finalize(virtual_connection_t * connection){
+    // drop pending packets, the host frees its buffers on disconnect
+    uint16_t i;
+    for (i = 0; i < controller_buffers_count; i++){
+        virtual_controller_buffer_t * buffer = &controller_buffers[(controller_buffers_head + i) % VIRTUAL_MAX_CONTROLLER_BUFFERS];
+        if (buffer->con_handle != connection->con_handle) continue;
+        buffer->con_handle = HCI_CON_HANDLE_INVALID;
+    }
+    connection->con_handle = HCI_CON_HANDLE_INVALID;
+}
+
+// HCI Commands
+
+static void virtual_handle_command(uint8_t * packet, uint16_t size){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    uint8_t  return_parameters[248];
+    uint8_t  features[] = { 0xff, 0xff, 0x8f, 0xfe, 0xdb, 0xff, 0x5b, 0x87 };  // BR/EDR + LE, SSP
+    virtual_connection_t * connection;
+    bd_addr_t address;
+
+    UNUSED(size);
+    statistics.commands++;
+    memset(return_parameters, 0, sizeof(return_parameters));
+
+    if (opcode == hci_read_bd_addr.opcode){
+        reverse_bd_addr(config.bd_addr, return_parameters);
+        virtual_emit_command_complete(opcode, return_parameters, 6);
+    } else if (opcode == hci_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, config.acl_packet_len);
+        return_parameters[2] = 0;   // no SCO
+        little_endian_store_16(return_parameters, 3, config.acl_packets_num);
+        little_endian_store_16(return_parameters, 5, 0);
+        virtual_emit_command_complete(opcode, return_parameters, 7);
+    } else if (opcode == hci_le_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, config.le_packet_len);
+        return_parameters[2] = config.le_packets_num;
+        virtual_emit_command_complete(opcode, return_parameters, 3);
+    } else if (opcode == hci_read_local_supported_features.opcode){
+        memcpy(return_parameters, features, sizeof(features));
+        virtual_emit_command_complete(opcode, return_parameters, sizeof(features));
+    } else if (opcode == hci_read_local_version_information.opcode){
+        return_parameters[0] = 0x08;                       // HCI 4.2
+        return_parameters[3] = 0x08;                       // LMP 4.2
+        little_endian_store_16(return_parameters, 4, 0xffff);  // no manufacturer specific init
+        virtual_emit_command_complete(opcode, return_parameters, 8);
+    } else if (opcode == hci_read_local_supported_commands.opcode){
+        return_parameters[14] = 0x80;   // Read Buffer Size
+        virtual_emit_command_complete(opcode, return_parameters, 64);
+    } else if (opcode == hci_read_local_name.opcode){
+        strcpy((char *) return_parameters, "BTstack Virtual Controller");
+        virtual_emit_command_complete(opcode, return_parameters, 248);
+    } else if (opcode == hci_le_read_white_list_size.opcode){
+        return_parameters[0] = 8;
+        virtual_emit_command_complete(opcode, return_parameters, 1);
+    } else if (opcode == hci_le_rand.opcode){
+        virtual_emit_command_complete(opcode, return_parameters, 8);
+    } else if (opcode == hci_le_encrypt.opcode){
+        virtual_emit_command_complete(opcode, return_parameters, 16);
+    } else if (opcode == hci_accept_connection_request.opcode){
+        reverse_bd_addr(&packet[3], address);
+        connection = virtual_connection_for_address(address);
+        if (!connection || !connection->pending){
+            virtual_emit_command_status(opcode, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+            return;
+        }
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        connection->pending = 0;
+        virtual_emit_connection_complete(connection, ERROR_CODE_SUCCESS);
+    } else if (opcode == hci_reject_connection_request.opcode){
+        reverse_bd_addr(&packet[3], address);
+        connection = virtual_connection_for_address(address);
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        if (!connection) return;
+        virtual_emit_connection_complete(connection, packet[9]);
+        virtual_connection_finalize(connection);
+    } else if (opcode == hci_create_connection.opcode){
+        reverse_bd_addr(&packet[3], address);
+        connection = virtual_connection_create(address, 0);
+        if (!connection){
+            virtual_emit_command_status(opcode, ERROR_CODE_CONNECTION_LIMIT_EXCEEDED);
+            return;
+        }
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        virtual_emit_connection_complete(connection, ERROR_CODE_SUCCESS);
+    } else if (opcode == hci_le_create_connection.opcode){
+        reverse_bd_addr(&packet[9], address);
+        connection = virtual_connection_create(address, 1);
+        if (!connection){
+            virtual_emit_command_status(opcode, ERROR_CODE_CONNECTION_LIMIT_EXCEEDED);
+            return;
+        }
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        virtual_emit_le_connection_complete(connection, HCI_ROLE_MASTER);
+    } else if (opcode == hci_disconnect.opcode){
+        connection = virtual_connection_for_handle(little_endian_read_16(packet, 3));
+        if (!connection){
+            virtual_emit_command_status(opcode, ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER);
+            return;
+        }
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        virtual_emit_disconnection_complete(connection, ERROR_CODE_CONNECTION_TERMINATED_BY_LOCAL_HOST);
+        virtual_connection_finalize(connection);
+    } else if (opcode == hci_read_remote_supported_features_command.opcode){
+        hci_con_handle_t con_handle = little_endian_read_16(packet, 3);
+        uint8_t event[13];
+        virtual_emit_command_status(opcode, ERROR_CODE_SUCCESS);
+        // peer does not support SSP, no authentication required for security level 0 services
+        event[0] = HCI_EVENT_READ_REMOTE_SUPPORTED_FEATURES_COMPLETE;
+        event[1] = sizeof(event) - 2;
+        event[2] = ERROR_CODE_SUCCESS;
+        little_endian_store_16(event, 3, con_handle);
+        memset(&event[5], 0, 8);
+        virtual_emit_event(event, sizeof(event));
+    } else if (opcode == hci_authentication_requested.opcode
+            || opcode == hci_set_connection_encryption.opcode
+            || opcode == hci_le_start_encryption.opcode
+            || opcode == hci_le_connection_update.opcode
+            || opcode == hci_inquiry.opcode
+            || opcode == hci_remote_name_request.opcode){
+        // not modelled
+        virtual_emit_command_status(opcode, ERROR_CODE_UNSUPPORTED_FEATURE_OR_PARAMETER_VALUE);
+    } else {
+        // all other commands succeed without return parameters
+        virtual_emit_command_complete(opcode, return_parameters, 0);
+    }
+}
+
+// host -> controller
+
+static void virtual_handle_acl_packet(uint8_t * packet, uint16_t size){
+    hci_con_handle_t con_handle = little_endian_read_16(packet, 0) & 0x0fff;
+    virtual_connection_t * connection = virtual_connection_for_handle(con_handle);
+
+    statistics.acl_packets_to_controller++;
+    statistics.acl_bytes_to_controller += size - 4;
+
+    if (!connection){
+        log_error("virtual controller: ACL for unknown handle 0x%04x", con_handle);
+        statistics.dropped_packets++;
+        return;
+    }
+
+    // check credits
+    int le_buffer = connection->le && config.le_packets_num;
+    if (le_buffer){
+        if (le_buffers_used >= config.le_packets_num) statistics.credit_violations++;
+    } else {
+        if (acl_buffers_used >= config.acl_packets_num) statistics.credit_violations++;
+    }
+
+    if (controller_buffers_count == VIRTUAL_MAX_CONTROLLER_BUFFERS || size > HCI_ACL_BUFFER_SIZE){
+        statistics.dropped_packets++;
+        return;
+    }
+
+    virtual_controller_buffer_t * buffer = &controller_buffers[(controller_buffers_head + controller_buffers_count) % VIRTUAL_MAX_CONTROLLER_BUFFERS];
+    controller_buffers_count++;
+    buffer->con_handle = con_handle;
+    buffer->le_buffer  = le_buffer;
+    buffer->len = size;
+    memcpy(buffer->data, packet, size);
+    if (le_buffer){
+        le_buffers_used++;
+    } else {
+        acl_buffers_used++;
+    }
+    if (controller_buffers_count > statistics.max_packets_in_controller){
+        statistics.max_packets_in_controller = controller_buffers_count;
+    }
+}
+
+// deliver transmitted ACL packet to peer
+static void virtual_transmit(virtual_connection_t * connection, uint8_t * packet, uint16_t size){
+    uint8_t  packet_boundary_flag = (little_endian_read_16(packet, 0) >> 12) & 0x03;
+    uint16_t acl_len = little_endian_read_16(packet, 2);
+    if (acl_len + 4 > size) return;
+
+    if (packet_boundary_flag != 0x01){
+        // first fragment
+        connection->reassembly_pos = 0;
+        connection->reassembly_len = 0;
+        if (acl_len < 4) return;
+        connection->reassembly_len = little_endian_read_16(packet, 4) + 4;
+    }
+    if (connection->reassembly_len == 0) return;
+    if (connection->reassembly_pos + acl_len > connection->reassembly_len){
+        log_error("virtual controller: L2CAP PDU larger than announced");
+        connection->reassembly_len = 0;
+        return;
+    }
+    memcpy(&connection->reassembly_buffer[connection->reassembly_pos], &packet[4], acl_len);
+    connection->reassembly_pos += acl_len;
+    if (connection->reassembly_pos < connection->reassembly_len) return;
+
+    // complete PDU
+    uint16_t pdu_len = connection->reassembly_len;
+    connection->reassembly_len = 0;
+    statistics.l2cap_pdus_to_peer++;
+    if (!peer_packet_handler) return;
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_PEER);
+    (*peer_packet_handler)(HCI_ACL_DATA_PACKET, connection->con_handle, connection->reassembly_buffer, pdu_len);
+    hci_transport_virtual_enter_layer(layer);
+}
+
+static void virtual_connection_event(void){
+    uint16_t num_packets = controller_buffers_count;
+    if (config.packets_per_event && num_packets > config.packets_per_event){
+        num_packets = config.packets_per_event;
+    }
+    if (num_packets == 0) return;
+
+    statistics.connection_events++;
+
+    // transmit
+    uint16_t i;
+    for (i = 0; i < num_packets; i++){
+        virtual_controller_buffer_t * buffer = &controller_buffers[controller_buffers_head];
+        controller_buffers_head = (controller_buffers_head + 1) % VIRTUAL_MAX_CONTROLLER_BUFFERS;
+        controller_buffers_count--;
+        if (buffer->le_buffer){
+            le_buffers_used--;
+        } else {
+            acl_buffers_used--;
+        }
+        virtual_connection_t * connection = virtual_connection_for_handle(buffer->con_handle);
+        if (!connection) continue;
+        connection->completed_packets++;
+        virtual_transmit(connection, buffer->data, buffer->len);
+    }
+
+    // report completed packets for all connections in a single event
+    uint8_t event[3 + VIRTUAL_MAX_CONNECTIONS * 4];
+    uint8_t num_handles = 0;
+    int pos = 3;
+    for (i = 0; i < VIRTUAL_MAX_CONNECTIONS; i++){
+        virtual_connection_t * connection = &connections[i];
+        if (connection->con_handle == HCI_CON_HANDLE_INVALID) continue;
+        if (connection->completed_packets == 0) continue;
+        little_endian_store_16(event, pos, connection->con_handle);
+        little_endian_store_16(event, pos + 2, connection->completed_packets);
+        pos += 4;
+        num_handles++;
+        connection->completed_packets = 0;
+    }
+    if (num_handles == 0) return;
+    event[0] = HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS;
+    event[1] = pos - 2;
+    event[2] = num_handles;
+    virtual_emit_event(event, pos);
+    statistics.completed_packets_events++;
+}
+
+static void virtual_process(btstack_data_source_t *ds, btstack_data_source_callback_type_t callback_type){
+    UNUSED(ds);
+    UNUSED(callback_type);
+
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_CONTROLLER);
+
+    // connection event
+    uint32_t now = btstack_run_loop_get_time_ms();
+    if (config.connection_interval_ms == 0 || (int32_t)(now - last_connection_event_ms) >= config.connection_interval_ms){
+        last_connection_event_ms = now;
+        virtual_connection_event();
+    }
+
+    // deliver packets queued before this iteration, packets queued by the host in response are delivered next time
+    uint16_t num_packets = host_queue_count;
+    while (num_packets--){
+        virtual_host_slot_t * slot = &host_queue[host_queue_head];
+        host_queue_head = (host_queue_head + 1) % VIRTUAL_HOST_QUEUE_SIZE;
+        host_queue_count--;
+        hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_HOST);
+        (*host_packet_handler)(slot->packet_type, &slot->data[HCI_INCOMING_PRE_BUFFER_SIZE], slot->len);
+        hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_CONTROLLER);
+    }
+
+    hci_transport_virtual_enter_layer(layer);
+}
+
+int hci_transport_virtual_has_pending_work(void){
+    if (host_queue_count) return 1;
+    if (controller_buffers_count == 0) return 0;
+    uint32_t now = btstack_run_loop_get_time_ms();
+    return (int32_t)(now - last_connection_event_ms) >= config.connection_interval_ms;
+}
+
+// peer API
+
+void hci_transport_virtual_register_peer_packet_handler(btstack_packet_handler_t handler){
+    peer_packet_handler = handler;
+}
+
+hci_con_handle_t hci_transport_virtual_peer_le_connect(bd_addr_t address){
+    virtual_connection_t * connection = virtual_connection_create(address, 1);
+    if (!connection) return HCI_CON_HANDLE_INVALID;
+    virtual_emit_le_connection_complete(connection, HCI_ROLE_SLAVE);
+    return connection->con_handle;
+}
+
+void hci_transport_virtual_peer_classic_connect(bd_addr_t address){
+    virtual_connection_t * connection = virtual_connection_create(address, 0);
+    if (!connection) return;
+    connection->pending = 1;
+    uint8_t event[12];
+    event[0] = HCI_EVENT_CONNECTION_REQUEST;
+    event[1] = sizeof(event) - 2;
+    reverse_bd_addr(address, &event[2]);
+    event[8]  = 0x04;   // class of device: audio, headset
+    event[9]  = 0x04;
+    event[10] = 0x20;
+    event[11] = 1;  // ACL
+    virtual_emit_event(event, sizeof(event));
+}
+
+void hci_transport_virtual_peer_disconnect(hci_con_handle_t con_handle){
+    virtual_connection_t * connection = virtual_connection_for_handle(con_handle);
+    if (!connection) return;
+    virtual_emit_disconnection_complete(connection, ERROR_CODE_REMOTE_USER_TERMINATED_CONNECTION);
+    virtual_connection_finalize(connection);
+}
+
+int hci_transport_virtual_peer_send_l2cap(hci_con_handle_t con_handle, uint16_t cid, const uint8_t * payload, uint16_t len){
+    virtual_connection_t * connection = virtual_connection_for_handle(con_handle);
+    if (!connection) return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+
+    uint16_t fragment_size = config.acl_packet_len;
+    if (connection->le && config.le_packet_len){
+        fragment_size = config.le_packet_len;
+    }
+    if (fragment_size > HCI_ACL_PAYLOAD_SIZE){
+        fragment_size = HCI_ACL_PAYLOAD_SIZE;
+    }
+    uint16_t num_fragments = (len + 4 + fragment_size - 1) / fragment_size;
+    if (host_queue_count + num_fragments > VIRTUAL_HOST_QUEUE_SIZE) return BTSTACK_ACL_BUFFERS_FULL;
+
+    uint8_t header[4];
+    little_endian_store_16(header, 0, len);
+    little_endian_store_16(header, 2, cid);
+
+    // pos counts bytes of basic L2CAP header + payload
+    uint16_t total = len + 4;
+    uint16_t pos = 0;
+    while (pos < total){
+        uint16_t fragment_len = btstack_min(fragment_size, total - pos);
+        uint8_t * packet = virtual_host_queue_reserve(HCI_ACL_DATA_PACKET, 4 + fragment_len);
+        uint8_t flags = pos ? 0x01 : 0x02;
+        little_endian_store_16(packet, 0, con_handle | (flags << 12));
+        little_endian_store_16(packet, 2, fragment_len);
+        uint16_t header_len = 0;
+        if (pos < 4){
+            header_len = btstack_min(4 - pos, fragment_len);
+            memcpy(&packet[4], &header[pos], header_len);
+        }
+        memcpy(&packet[4 + header_len], &payload[pos + header_len - 4], fragment_len - header_len);
+        pos += fragment_len;
+        statistics.acl_packets_to_host++;
+        statistics.acl_bytes_to_host += fragment_len;
+    }
+    return 0;
+}
+
+// statistics
+
+void hci_transport_virtual_get_statistics(hci_transport_virtual_statistics_t * out_statistics){
+    *out_statistics = statistics;
+}
+
+void hci_transport_virtual_reset_statistics(void){
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+// hci_transport_t implementation
+
+static void hci_transport_virtual_init(const void * transport_config){
+    if (transport_config){
+        config = *(const hci_transport_virtual_config_t *) transport_config;
+    }
+    if (config.acl_packets_num + config.le_packets_num > VIRTUAL_MAX_CONTROLLER_BUFFERS){
+        log_error("virtual controller: more than %u buffers configured", VIRTUAL_MAX_CONTROLLER_BUFFERS);
+    }
+    hci_transport_virtual_reset_statistics();
+}
+
+static int hci_transport_virtual_open(void){
+    int i;
+    for (i = 0; i < VIRTUAL_MAX_CONNECTIONS; i++){
+        connections[i].con_handle = HCI_CON_HANDLE_INVALID;
+    }
+    next_con_handle = VIRTUAL_HANDLE_BASE;
+    controller_buffers_head  = 0;
+    controller_buffers_count = 0;
+    acl_buffers_used = 0;
+    le_buffers_used  = 0;
+    host_queue_head  = 0;
+    host_queue_count = 0;
+    last_connection_event_ms = btstack_run_loop_get_time_ms();
+
+    btstack_run_loop_set_data_source_handler(&virtual_data_source, &virtual_process);
+    btstack_run_loop_enable_data_source_callbacks(&virtual_data_source, DATA_SOURCE_CALLBACK_POLL);
+    btstack_run_loop_add_data_source(&virtual_data_source);
+    return 0;
+}
+
+static int hci_transport_virtual_close(void){
+    btstack_run_loop_remove_data_source(&virtual_data_source);
+    return 0;
+}
+
+static void hci_transport_virtual_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    host_packet_handler = handler;
+}
+
+static int hci_transport_virtual_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    hci_transport_virtual_layer_t layer = hci_transport_virtual_enter_layer(HCI_TRANSPORT_VIRTUAL_LAYER_CONTROLLER);
+    switch (packet_type){
+        case HCI_COMMAND_DATA_PACKET:
+            virtual_handle_command(packet, size);
+            break;
+        case HCI_ACL_DATA_PACKET:
+            virtual_handle_acl_packet(packet, size);
+            break;
+        default:
+            break;
+    }
+    hci_transport_virtual_enter_layer(layer);
+    return 0;
+}
+
+static const hci_transport_t hci_transport_virtual = {
+    /* const char * name; */                                        "virtual",
+    /* void   (*init) (const void *transport_config); */            &hci_transport_virtual_init,
+    /* int    (*open)(void); */                                     &hci_transport_virtual_open,
+    /* int    (*close)(void); */                                    &hci_transport_virtual_close,
+    /* void   (*register_packet_handler)(void (*handler)(...); */   &hci_transport_virtual_register_packet_handler,
+    /* int    (*can_send_packet_now)(uint8_t packet_type); */       NULL,
+    /* int    (*send_packet)(...); */                               &hci_transport_virtual_send_packet,
+    /* int    (*set_baudrate)(uint32_t baudrate); */                NULL,
+    /* void   (*reset_link)(void); */                               NULL,
+    /* void   (*set_sco_config)(uint16_t voice_setting, int num_connections); */ NULL,
+};
+
+const hci_transport_t * hci_transport_virtual_instance(void){
+    return &hci_transport_virtual;
+}
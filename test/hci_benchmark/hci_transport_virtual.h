@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at 
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+
+
+/*
+ *  hci_transport_virtual.h
+ *
+ *  In-process virtual Bluetooth controller for benchmarks and tests
+ *
+ *  The virtual controller answers HCI commands, models ACL buffer credits
+ *  and connection events, and connects the host stack to a scripted peer
+ *  that exchanges complete L2CAP PDUs with it.
+ */
+
+#ifndef __HCI_TRANSPORT_VIRTUAL_H
+#define __HCI_TRANSPORT_VIRTUAL_H
+
+#include <stdint.h>
+
+#include "btstack_defines.h"
+#include "bluetooth.h"
+#include "hci_transport.h"
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bd_addr_t bd_addr;              // public address of the controller
+    uint16_t  acl_packet_len;       // reported by HCI Read Buffer Size
+    uint16_t  acl_packets_num;
+    uint16_t  le_packet_len;        // reported by HCI LE Read Buffer Size, 0 = shared with BR/EDR buffers
+    uint8_t   le_packets_num;
+    uint16_t  packets_per_event;    // ACL packets transmitted per connection event, 0 = all
+    uint16_t  connection_interval_ms;  // time between connection events, 0 = every run loop iteration
+} hci_transport_virtual_config_t;
+
+typedef struct {
+    uint32_t commands;
+    uint32_t events;
+    uint32_t connection_events;
+    uint32_t completed_packets_events;
+    uint32_t acl_packets_to_controller;
+    uint32_t acl_bytes_to_controller;
+    uint32_t acl_packets_to_host;
+    uint32_t acl_bytes_to_host;
+    uint32_t l2cap_pdus_to_peer;
+    uint32_t max_packets_in_controller;
+    uint32_t credit_violations;     // ACL packets sent by host without free controller buffer
+    uint32_t dropped_packets;       // packets that did not fit into the host or controller queues
+} hci_transport_virtual_statistics_t;
+
+typedef enum {
+    HCI_TRANSPORT_VIRTUAL_LAYER_HOST = 0,
+    HCI_TRANSPORT_VIRTUAL_LAYER_CONTROLLER,
+    HCI_TRANSPORT_VIRTUAL_LAYER_PEER,
+    HCI_TRANSPORT_VIRTUAL_LAYER_APP,
+    HCI_TRANSPORT_VIRTUAL_LAYER_IDLE,       // run loop waiting for next connection event
+    HCI_TRANSPORT_VIRTUAL_LAYER_COUNT
+} hci_transport_virtual_layer_t;
+
+/* API_START */
+
+/**
+ * @brief Get virtual controller instance, pass hci_transport_virtual_config_t to hci_init
+ */
+const hci_transport_t * hci_transport_virtual_instance(void);
+
+/**
+ * @brief Register handler for the scripted peer
+ * @note HCI_EVENT_PACKET: Connection Complete, LE Connection Complete, and Disconnection Complete, channel = con handle
+ * @note HCI_ACL_DATA_PACKET: reassembled L2CAP PDU incl. basic L2CAP header, channel = con handle
+ */
+void hci_transport_virtual_register_peer_packet_handler(btstack_packet_handler_t handler);
+
+/**
+ * @brief Peer connects to the LE Peripheral, host receives LE Connection Complete as slave
+ * @param address of peer
+ * @return con_handle or HCI_CON_HANDLE_INVALID if no connection available
+ */
+hci_con_handle_t hci_transport_virtual_peer_le_connect(bd_addr_t address);
+
+/**
+ * @brief Peer pages host, host receives Connection Request and is expected to accept it
+ * @param address of peer
+ */
+void hci_transport_virtual_peer_classic_connect(bd_addr_t address);
+
+/**
+ * @brief Peer terminates connection
+ * @param con_handle
+ */
+void hci_transport_virtual_peer_disconnect(hci_con_handle_t con_handle);
+
+/**
+ * @brief Peer sends L2CAP PDU, it is fragmented into ACL packets of the size reported to the host
+ * @param con_handle
+ * @param cid
+ * @param payload
+ * @param len
+ * @return 0 if ok, BTSTACK_ACL_BUFFERS_FULL if host queue is full
+ */
+int hci_transport_virtual_peer_send_l2cap(hci_con_handle_t con_handle, uint16_t cid, const uint8_t * payload, uint16_t len);
+
+/**
+ * @brief Get controller statistics
+ * @param statistics
+ */
+void hci_transport_virtual_get_statistics(hci_transport_virtual_statistics_t * statistics);
+
+/**
+ * @brief Reset controller statistics
+ */
+void hci_transport_virtual_reset_statistics(void);
+
+/**
+ * @brief Check if controller has work to do before the next connection event, e.g. to decide if the run loop may sleep
+ * @return 1 if packets are pending
+ */
+int hci_transport_virtual_has_pending_work(void);
+
+/**
+ * @brief Enable per-layer CPU time accounting based on thread CPU time
+ * @param enabled
+ */
+void hci_transport_virtual_set_cpu_accounting(int enabled);
+
+/**
+ * @brief Switch layer that subsequent CPU time is accounted to, used to wrap application callbacks
+ * @param layer
+ * @return previous layer to be restored
+ */
+hci_transport_virtual_layer_t hci_transport_virtual_enter_layer(hci_transport_virtual_layer_t layer);
+
+/**
+ * @brief Get CPU time per layer
+ * @param time_ns array of HCI_TRANSPORT_VIRTUAL_LAYER_COUNT entries
+ */
+void hci_transport_virtual_get_cpu_time_ns(uint64_t * time_ns);
+
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __HCI_TRANSPORT_VIRTUAL_H
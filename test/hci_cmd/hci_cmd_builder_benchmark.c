@@ -0,0 +1,104 @@
+// Micro-benchmark for HCI Command creation
+//
+// Creates a mix of HCI Commands as sent during HCI init, LE scan/advertising
+// reconfiguration and connection parameter updates, once with the hci_cmd_t
+// templates and once with the typed builders from hci_cmd_builder.h.
+//
+// Usage: hci_cmd_builder_benchmark [iterations]
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hci_cmd.h"
+#include "hci_cmd_builder.h"
+
+#define COMMANDS_PER_ITERATION 12
+
+static uint8_t  buffer[300];
+static uint32_t checksum;
+
+static const bd_addr_t address = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static uint8_t advertising_data[31];
+static uint8_t link_key[16];
+
+static void send_from_template(const hci_cmd_t * cmd, ...){
+    va_list argptr;
+    va_start(argptr, cmd);
+    uint16_t size = hci_cmd_create_from_template(buffer, cmd, argptr);
+    va_end(argptr);
+    checksum += buffer[size - 1] + size;
+}
+
+static void send_from_builder(uint16_t size){
+    checksum += buffer[size - 1] + size;
+}
+
+static void create_with_templates(int i){
+    send_from_template(&hci_set_event_mask, 0xffffffff, 0x1FFFFFFF);
+    send_from_template(&hci_write_page_timeout, 0x6000);
+    send_from_template(&hci_write_class_of_device, 0x2540);
+    send_from_template(&hci_write_local_name, "BTstack 11:22:33:44:55:66");
+    send_from_template(&hci_write_scan_enable, 3);
+    send_from_template(&hci_le_set_scan_parameters, 1, 0x1e0, 0x30, 0, 0);
+    send_from_template(&hci_le_set_scan_enable, i & 1, 0);
+    send_from_template(&hci_le_set_advertising_parameters, 0x30, 0x30, 0, 0, 0, address, 0x07, 0);
+    send_from_template(&hci_le_set_advertising_data, 31, advertising_data);
+    send_from_template(&hci_le_connection_update, i & 0x0eff, 6, 12, 4, 400, 2, 4);
+    send_from_template(&hci_link_key_request_reply, address, link_key);
+    send_from_template(&hci_disconnect, i & 0x0eff, 0x13);
+}
+
+static void create_with_builders(int i){
+    send_from_builder(hci_set_event_mask_create(buffer, 0xffffffff, 0x1FFFFFFF));
+    send_from_builder(hci_write_page_timeout_create(buffer, 0x6000));
+    send_from_builder(hci_write_class_of_device_create(buffer, 0x2540));
+    send_from_builder(hci_write_local_name_create(buffer, "BTstack 11:22:33:44:55:66"));
+    send_from_builder(hci_write_scan_enable_create(buffer, 3));
+    send_from_builder(hci_le_set_scan_parameters_create(buffer, 1, 0x1e0, 0x30, 0, 0));
+    send_from_builder(hci_le_set_scan_enable_create(buffer, i & 1, 0));
+    send_from_builder(hci_le_set_advertising_parameters_create(buffer, 0x30, 0x30, 0, 0, 0, address, 0x07, 0));
+    send_from_builder(hci_le_set_advertising_data_create(buffer, 31, advertising_data));
+    send_from_builder(hci_le_connection_update_create(buffer, i & 0x0eff, 6, 12, 4, 400, 2, 4));
+    send_from_builder(hci_link_key_request_reply_create(buffer, address, link_key));
+    send_from_builder(hci_disconnect_create(buffer, i & 0x0eff, 0x13));
+}
+
+static double run(void (*create)(int), int iterations){
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int i;
+    for (i = 0; i < iterations; i++){
+        (*create)(i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+int main(int argc, const char * argv[]){
+    int iterations = 1000000;
+    if (argc > 1){
+        iterations = atoi(argv[1]);
+    }
+    int num_commands = iterations * COMMANDS_PER_ITERATION;
+
+    checksum = 0;
+    double template_time = run(&create_with_templates, iterations);
+    uint32_t template_checksum = checksum;
+    printf("Templates: %8u commands, %6.1f ns per command\n", num_commands, template_time * 1e9 / num_commands);
+
+    checksum = 0;
+    double builder_time = run(&create_with_builders, iterations);
+    printf("Builders:  %8u commands, %6.1f ns per command\n", num_commands, builder_time * 1e9 / num_commands);
+
+    if (checksum != template_checksum){
+        printf("Checksum mismatch: %08x vs. %08x\n", checksum, template_checksum);
+        return 1;
+    }
+    printf("Speedup:   %.1fx\n", template_time / builder_time);
+    return 0;
+}
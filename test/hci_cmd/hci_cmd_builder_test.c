@@ -0,0 +1,112 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "hci_cmd.h"
+#include "hci_cmd_builder.h"
+
+// builders must create the same packet as hci_cmd_create_from_template
+
+static uint8_t template_buffer[300];
+static uint8_t builder_buffer[300];
+static uint16_t template_size;
+
+static void create_from_template(const hci_cmd_t * cmd, ...){
+    va_list argptr;
+    va_start(argptr, cmd);
+    memset(template_buffer, 0x55, sizeof(template_buffer));
+    template_size = hci_cmd_create_from_template(template_buffer, cmd, argptr);
+    va_end(argptr);
+}
+
+static void check_builder(uint16_t builder_size){
+    CHECK_EQUAL(template_size, builder_size);
+    MEMCMP_EQUAL(template_buffer, builder_buffer, template_size);
+}
+
+static bd_addr_t address = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static uint8_t data[240];
+
+TEST_GROUP(HCICmdBuilder){
+    void setup(void){
+        int i;
+        for (i = 0; i < (int) sizeof(data); i++){
+            data[i] = i;
+        }
+        memset(builder_buffer, 0x55, sizeof(builder_buffer));
+    }
+};
+
+TEST(HCICmdBuilder, NoParams){
+    create_from_template(&hci_reset);
+    check_builder(hci_reset_create(builder_buffer));
+}
+
+TEST(HCICmdBuilder, Integers){
+    // 3 byte LAP, 1 byte values
+    create_from_template(&hci_inquiry, 0x9e8b33, 10, 0);
+    check_builder(hci_inquiry_create(builder_buffer, 0x9e8b33, 10, 0));
+    // 4 byte values
+    create_from_template(&hci_set_event_mask, 0xffffffff, 0x1FFFFFFF);
+    check_builder(hci_set_event_mask_create(builder_buffer, 0xffffffff, 0x1FFFFFFF));
+    // 3 byte class of device
+    create_from_template(&hci_write_class_of_device, 0x2540);
+    check_builder(hci_write_class_of_device_create(builder_buffer, 0x2540));
+}
+
+TEST(HCICmdBuilder, Handle){
+    create_from_template(&hci_disconnect, 0x0e01, 0x13);
+    check_builder(hci_disconnect_create(builder_buffer, 0x0e01, 0x13));
+    create_from_template(&hci_le_connection_update, 0x0040, 6, 12, 4, 400, 2, 4);
+    check_builder(hci_le_connection_update_create(builder_buffer, 0x0040, 6, 12, 4, 400, 2, 4));
+}
+
+TEST(HCICmdBuilder, Address){
+    create_from_template(&hci_create_connection, address, 0xcc18, 0, 0, 0, 1);
+    check_builder(hci_create_connection_create(builder_buffer, address, 0xcc18, 0, 0, 0, 1));
+    create_from_template(&hci_remote_name_request, address, 1, 0, 0x1234);
+    check_builder(hci_remote_name_request_create(builder_buffer, address, 1, 0, 0x1234));
+}
+
+TEST(HCICmdBuilder, DataBlocks){
+    // P: link key
+    create_from_template(&hci_link_key_request_reply, address, data);
+    check_builder(hci_link_key_request_reply_create(builder_buffer, address, data));
+    // E: extended inquiry response
+    create_from_template(&hci_write_extended_inquiry_response, 0, data);
+    check_builder(hci_write_extended_inquiry_response_create(builder_buffer, 0, data));
+    // P: long term key
+    create_from_template(&hci_le_start_encryption, 0x0040, 0x01020304, 0x05060708, 0x1234, data);
+    check_builder(hci_le_start_encryption_create(builder_buffer, 0x0040, 0x01020304, 0x05060708, 0x1234, data));
+    // A: advertising data
+    create_from_template(&hci_le_set_advertising_data, 31, data);
+    check_builder(hci_le_set_advertising_data_create(builder_buffer, 31, data));
+}
+
+TEST(HCICmdBuilder, Name){
+    create_from_template(&hci_write_local_name, "BTstack 00:00:00:00:00:00");
+    check_builder(hci_write_local_name_create(builder_buffer, "BTstack 00:00:00:00:00:00"));
+    // names are truncated to 248 bytes
+    char long_name[300];
+    memset(long_name, 'a', sizeof(long_name));
+    long_name[299] = 0;
+    create_from_template(&hci_write_local_name, long_name);
+    check_builder(hci_write_local_name_create(builder_buffer, long_name));
+}
+
+TEST(HCICmdBuilder, LEScanAndAdvertising){
+    create_from_template(&hci_le_set_scan_parameters, 1, 0x1e0, 0x30, 0, 0);
+    check_builder(hci_le_set_scan_parameters_create(builder_buffer, 1, 0x1e0, 0x30, 0, 0));
+    create_from_template(&hci_le_set_scan_enable, 1, 0);
+    check_builder(hci_le_set_scan_enable_create(builder_buffer, 1, 0));
+    create_from_template(&hci_le_set_advertising_parameters, 0x30, 0x30, 0, 0, 0, address, 0x07, 0);
+    check_builder(hci_le_set_advertising_parameters_create(builder_buffer, 0x30, 0x30, 0, 0, 0, address, 0x07, 0));
+    create_from_template(&hci_le_create_connection, 0x60, 0x30, 0, 1, address, 0, 8, 24, 0, 72, 2, 0x30);
+    check_builder(hci_le_create_connection_create(builder_buffer, 0x60, 0x30, 0, 1, address, 0, 8, 24, 0, 72, 2, 0x30));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
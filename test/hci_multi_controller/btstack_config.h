@@ -0,0 +1,25 @@
+//
+// btstack_config.h for multiple controller test
+//
+
+#ifndef __BTSTACK_CONFIG
+#define __BTSTACK_CONFIG
+
+// Port related features
+#define HAVE_MALLOC
+#define HAVE_POSIX_TIME
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_CLASSIC
+#define ENABLE_LE_PERIPHERAL
+#define ENABLE_LE_CENTRAL
+#define ENABLE_LOG_ERROR
+#define ENABLE_HCI_MULTIPLE_CONTROLLERS
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 52
+#define MAX_NR_HCI_CONTROLLERS 2
+#define MAX_NR_LE_DEVICE_DB_ENTRIES 4
+
+#endif
@@ -0,0 +1,688 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+#include "rijndael.h"
+#include "ble/le_device_db.h"
+#include "ble/sm.h"
+
+#define MOCK_QUEUE_SIZE   8
+#define MOCK_MAX_SM_PDUS  8
+#define MOCK_PACKET_SIZE  (HCI_INCOMING_PRE_BUFFER_SIZE + 260)
+
+// controllers use the same connection handle
+#define CONTROLLER_CON_HANDLE 0x0040
+
+typedef struct {
+    void (*packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+    // controller -> host
+    uint8_t  queue_types[MOCK_QUEUE_SIZE];
+    uint16_t queue_lens[MOCK_QUEUE_SIZE];
+    uint8_t  queue_data[MOCK_QUEUE_SIZE][MOCK_PACKET_SIZE];
+    int      queue_count;
+    // host -> controller
+    uint8_t  sent_type;
+    uint8_t  sent_data[HCI_PACKET_BUFFER_SIZE];
+    int      sent_len;
+    int      sent_acl_packets;
+    bd_addr_t bd_addr;
+    // report ACL packets as completed right away
+    int      auto_complete_acl;
+    // controller properties, defaults if zero
+    uint16_t acl_data_packet_length;
+    int      no_non_flushable_packet_boundary_flag;
+    // SM PDUs sent on this controller
+    uint8_t  sm_pdus[MOCK_MAX_SM_PDUS][24];
+    int      sm_pdu_count;
+} mock_controller_t;
+
+static mock_controller_t mock_controllers[2];
+
+static uint8_t  received_acl_packet[HCI_ACL_BUFFER_SIZE];
+static int      received_acl_len;
+static uint8_t  controller_states[2];
+static hci_con_handle_t le_connection_handles[2];
+static int      le_connections;
+static int      disconnections;
+
+static void mock_enqueue(mock_controller_t * mock, uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    if (mock->queue_count >= MOCK_QUEUE_SIZE) return;
+    int pos = mock->queue_count++;
+    mock->queue_types[pos] = packet_type;
+    mock->queue_lens[pos]  = size;
+    memcpy(&mock->queue_data[pos][HCI_INCOMING_PRE_BUFFER_SIZE], packet, size);
+}
+
+static void mock_command_complete(mock_controller_t * mock, uint16_t opcode, const uint8_t * return_parameters, int len){
+    uint8_t event[6 + 64];
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 4 + len;
+    event[2] = 1;
+    little_endian_store_16(event, 3, opcode);
+    event[5] = 0;
+    memcpy(&event[6], return_parameters, len);
+    mock_enqueue(mock, HCI_EVENT_PACKET, event, 6 + len);
+}
+
+static void mock_handle_command(mock_controller_t * mock, uint8_t * packet){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    uint8_t  return_parameters[64];
+    uint8_t  features[] = { 0xff, 0xff, 0x8f, 0xfe, 0xdb, 0xff, 0x5b, 0x87 };
+    memset(return_parameters, 0, sizeof(return_parameters));
+    if (opcode == hci_read_bd_addr.opcode){
+        reverse_bd_addr(mock->bd_addr, return_parameters);
+        mock_command_complete(mock, opcode, return_parameters, 6);
+    } else if (opcode == hci_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, mock->acl_data_packet_length ? mock->acl_data_packet_length : 27);
+        little_endian_store_16(return_parameters, 3, 1);    // single ACL buffer
+        mock_command_complete(mock, opcode, return_parameters, 7);
+    } else if (opcode == hci_le_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, 27);
+        return_parameters[2] = 1;   // single LE buffer
+        mock_command_complete(mock, opcode, return_parameters, 3);
+    } else if (opcode == hci_read_local_supported_features.opcode){
+        if (mock->no_non_flushable_packet_boundary_flag){
+            features[6] &= ~(1 << 6);
+        }
+        memcpy(return_parameters, features, sizeof(features));
+        mock_command_complete(mock, opcode, return_parameters, sizeof(features));
+    } else if (opcode == hci_read_local_version_information.opcode){
+        little_endian_store_16(return_parameters, 4, 0xffff);
+        mock_command_complete(mock, opcode, return_parameters, 8);
+    } else if (opcode == hci_read_local_supported_commands.opcode){
+        return_parameters[14] = 0x80;   // Read Buffer Size
+        mock_command_complete(mock, opcode, return_parameters, 64);
+    } else if (opcode == hci_le_read_white_list_size.opcode){
+        return_parameters[0] = 8;
+        mock_command_complete(mock, opcode, return_parameters, 1);
+    } else if (opcode == hci_le_rand.opcode){
+        memset(return_parameters, 0x55, 8);
+        mock_command_complete(mock, opcode, return_parameters, 8);
+    } else if (opcode == hci_le_encrypt.opcode){
+        // key and plaintext in little endian
+        uint8_t key[16];
+        uint8_t plaintext[16];
+        uint8_t ciphertext[16];
+        reverse_128(&packet[3], key);
+        reverse_128(&packet[19], plaintext);
+        uint32_t rk[RKLENGTH(KEYBITS)];
+        int nrounds = rijndaelSetupEncrypt(rk, key, KEYBITS);
+        rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+        reverse_128(ciphertext, return_parameters);
+        mock_command_complete(mock, opcode, return_parameters, 16);
+    } else if (opcode == hci_disconnect.opcode){
+        uint8_t event[] = { HCI_EVENT_COMMAND_STATUS, 4, 0, 1, 0, 0};
+        little_endian_store_16(event, 4, opcode);
+        mock_enqueue(mock, HCI_EVENT_PACKET, event, sizeof(event));
+    } else {
+        mock_command_complete(mock, opcode, return_parameters, 1);
+    }
+}
+
+static int mock_send_packet(mock_controller_t * mock, uint8_t packet_type, uint8_t * packet, int size){
+    mock->sent_type = packet_type;
+    mock->sent_len  = size;
+    memcpy(mock->sent_data, packet, size);
+    switch (packet_type){
+        case HCI_COMMAND_DATA_PACKET:
+            mock_handle_command(mock, packet);
+            break;
+        case HCI_ACL_DATA_PACKET:
+            mock->sent_acl_packets++;
+            if (little_endian_read_16(packet, 6) == L2CAP_CID_SECURITY_MANAGER_PROTOCOL && mock->sm_pdu_count < MOCK_MAX_SM_PDUS){
+                memcpy(mock->sm_pdus[mock->sm_pdu_count++], &packet[8], btstack_min(size - 8, 24));
+            }
+            if (mock->auto_complete_acl){
+                uint8_t event[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0, 0, 1, 0};
+                little_endian_store_16(event, 3, little_endian_read_16(packet, 0) & 0x0fff);
+                mock_enqueue(mock, HCI_EVENT_PACKET, event, sizeof(event));
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void mock_0_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    mock_controllers[0].packet_handler = handler;
+}
+static int mock_0_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    return mock_send_packet(&mock_controllers[0], packet_type, packet, size);
+}
+static void mock_1_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    mock_controllers[1].packet_handler = handler;
+}
+static int mock_1_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    return mock_send_packet(&mock_controllers[1], packet_type, packet, size);
+}
+static int mock_open(void){
+    return 0;
+}
+static int mock_close(void){
+    return 0;
+}
+
+static const hci_transport_t mock_transports[2] = {
+    { "mock-0", NULL, &mock_open, &mock_close, &mock_0_register_packet_handler, NULL, &mock_0_send_packet, NULL, NULL, NULL },
+    { "mock-1", NULL, &mock_open, &mock_close, &mock_1_register_packet_handler, NULL, &mock_1_send_packet, NULL, NULL, NULL },
+};
+
+// deliver queued packets from both controllers until all are idle
+static void mock_process(void){
+    int delivered = 1;
+    while (delivered){
+        delivered = 0;
+        int i;
+        for (i = 0; i < 2; i++){
+            mock_controller_t * mock = &mock_controllers[i];
+            if (mock->queue_count == 0) continue;
+            uint8_t  packet_type = mock->queue_types[0];
+            uint16_t size = mock->queue_lens[0];
+            uint8_t  packet[MOCK_PACKET_SIZE];
+            memcpy(packet, mock->queue_data[0], sizeof(packet));
+            mock->queue_count--;
+            memmove(&mock->queue_types[0], &mock->queue_types[1], mock->queue_count);
+            memmove(&mock->queue_lens[0],  &mock->queue_lens[1],  mock->queue_count * sizeof(uint16_t));
+            memmove(&mock->queue_data[0],  &mock->queue_data[1],  mock->queue_count * MOCK_PACKET_SIZE);
+            mock->packet_handler(packet_type, &packet[HCI_INCOMING_PRE_BUFFER_SIZE], size);
+            delivered = 1;
+        }
+    }
+}
+
+static void mock_le_connection_complete(int controller, uint8_t addr_last_byte){
+    uint8_t event[21];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    little_endian_store_16(event, 4, CONTROLLER_CON_HANDLE);
+    event[6] = HCI_ROLE_SLAVE;
+    event[8] = addr_last_byte;
+    little_endian_store_16(event, 14, 6);
+    little_endian_store_16(event, 18, 200);
+    mock_enqueue(&mock_controllers[controller], HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static void mock_acl_packet(int controller, hci_con_handle_t con_handle){
+    uint8_t packet[] = { 0, 0, 4, 0, 0, 0, 0x05, 0x00 };
+    little_endian_store_16(packet, 0, con_handle | 0x2000);
+    mock_enqueue(&mock_controllers[controller], HCI_ACL_DATA_PACKET, packet, sizeof(packet));
+    mock_process();
+}
+
+static void mock_number_of_completed_packets(int controller, hci_con_handle_t con_handle){
+    uint8_t event[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0, 0, 1, 0};
+    little_endian_store_16(event, 3, con_handle);
+    mock_enqueue(&mock_controllers[controller], HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static void mock_disconnection_complete(int controller, hci_con_handle_t con_handle){
+    uint8_t event[] = { HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, 0, 0, 0x13};
+    little_endian_store_16(event, 3, con_handle);
+    mock_enqueue(&mock_controllers[controller], HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static void mock_sm_pdu(int controller, const uint8_t * pdu, uint16_t len){
+    uint8_t packet[8 + 17];
+    little_endian_store_16(packet, 0, CONTROLLER_CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + len);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, L2CAP_CID_SECURITY_MANAGER_PROTOCOL);
+    memcpy(&packet[8], pdu, len);
+    mock_enqueue(&mock_controllers[controller], HCI_ACL_DATA_PACKET, packet, 8 + len);
+    mock_process();
+}
+
+static void mock_le_long_term_key_request(int controller){
+    uint8_t event[15];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = HCI_SUBEVENT_LE_LONG_TERM_KEY_REQUEST;
+    little_endian_store_16(event, 3, CONTROLLER_CON_HANDLE);
+    mock_enqueue(&mock_controllers[controller], HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static void mock_encryption_change(int controller){
+    uint8_t event[] = { HCI_EVENT_ENCRYPTION_CHANGE, 4, 0, 0, 0, 1};
+    little_endian_store_16(event, 3, CONTROLLER_CON_HANDLE);
+    mock_enqueue(&mock_controllers[controller], HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static const uint8_t * mock_sm_pdu_sent(int controller, uint8_t code){
+    mock_controller_t * mock = &mock_controllers[controller];
+    int i;
+    for (i = 0; i < mock->sm_pdu_count; i++){
+        if (mock->sm_pdus[i][0] == code) return mock->sm_pdus[i];
+    }
+    return NULL;
+}
+
+static void aes128(const uint8_t * key, const uint8_t * plaintext, uint8_t * ciphertext){
+    uint32_t rk[RKLENGTH(KEYBITS)];
+    int nrounds = rijndaelSetupEncrypt(rk, key, KEYBITS);
+    rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+}
+
+// LE Legacy Pairing confirm value with TK = 0, public addresses, all values in big endian
+static void c1(const uint8_t * r, const uint8_t * preq, const uint8_t * pres, const bd_addr_t ia, const bd_addr_t ra, uint8_t * confirm){
+    uint8_t tk[16];
+    uint8_t p1[16];
+    uint8_t p2[16];
+    uint8_t t[16];
+    memset(tk, 0, sizeof(tk));
+    reverse_56(pres, &p1[0]);
+    reverse_56(preq, &p1[7]);
+    p1[14] = 0;
+    p1[15] = 0;
+    memset(p2, 0, sizeof(p2));
+    memcpy(&p2[4],  ia, 6);
+    memcpy(&p2[10], ra, 6);
+    int i;
+    for (i = 0; i < 16; i++){
+        t[i] = r[i] ^ p1[i];
+    }
+    aes128(tk, t, t);
+    for (i = 0; i < 16; i++){
+        t[i] ^= p2[i];
+    }
+    aes128(tk, t, confirm);
+}
+
+static void event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) channel;
+    (void) size;
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (packet[0]){
+        case BTSTACK_EVENT_STATE:
+            controller_states[hci_get_controller()] = packet[2];
+            break;
+        case HCI_EVENT_LE_META:
+            if (packet[2] != HCI_SUBEVENT_LE_CONNECTION_COMPLETE) break;
+            le_connection_handles[hci_get_controller()] = little_endian_read_16(packet, 4);
+            le_connections++;
+            break;
+        case HCI_EVENT_DISCONNECTION_COMPLETE:
+            disconnections++;
+            break;
+        case SM_EVENT_JUST_WORKS_REQUEST:
+            sm_just_works_confirm(little_endian_read_16(packet, 2));
+            break;
+        default:
+            break;
+    }
+}
+
+static void acl_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) packet_type;
+    (void) channel;
+    memcpy(received_acl_packet, packet, size);
+    received_acl_len = size;
+}
+
+static int can_send_now_events;
+
+static void fixed_channel_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) channel;
+    (void) size;
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (packet[0] != L2CAP_EVENT_CAN_SEND_NOW) return;
+    can_send_now_events++;
+}
+
+static btstack_packet_callback_registration_t event_callback_registration;
+
+static int send_acl_packet(hci_con_handle_t con_handle){
+    hci_reserve_packet_buffer();
+    uint8_t * packet = hci_get_outgoing_packet_buffer();
+    little_endian_store_16(packet, 0, con_handle | 0x2000);
+    little_endian_store_16(packet, 2, 4);
+    little_endian_store_16(packet, 4, 0);
+    little_endian_store_16(packet, 6, 0x0005);
+    return hci_send_acl_packet_buffer(8);
+}
+
+TEST_GROUP(MultipleControllers){
+    void setup(void){
+        memset(mock_controllers, 0, sizeof(mock_controllers));
+        mock_controllers[0].bd_addr[5] = 0x01;
+        mock_controllers[1].bd_addr[5] = 0x02;
+        received_acl_len = 0;
+        memset(controller_states, 0, sizeof(controller_states));
+        le_connections = 0;
+        disconnections = 0;
+
+        btstack_memory_init();
+        hci_init(&mock_transports[0], NULL);
+        CHECK_EQUAL(1, hci_add_controller(&mock_transports[1], NULL));
+        event_callback_registration.callback = &event_handler;
+        hci_add_event_handler(&event_callback_registration);
+        hci_register_acl_packet_handler(&acl_handler);
+
+        hci_select_controller(0);
+        hci_power_control(HCI_POWER_ON);
+        hci_select_controller(1);
+        hci_power_control(HCI_POWER_ON);
+        hci_select_controller(0);
+        mock_process();
+    }
+    void teardown(void){
+        hci_close();
+    }
+};
+
+TEST(MultipleControllers, Init){
+    CHECK_EQUAL(2, hci_get_num_controllers());
+    bd_addr_t addr;
+    CHECK_EQUAL(HCI_STATE_WORKING, controller_states[0]);
+    CHECK_EQUAL(HCI_STATE_WORKING, controller_states[1]);
+    hci_select_controller(0);
+    gap_local_bd_addr(addr);
+    CHECK_EQUAL(0x01, addr[5]);
+    hci_select_controller(1);
+    gap_local_bd_addr(addr);
+    CHECK_EQUAL(0x02, addr[5]);
+}
+
+TEST(MultipleControllers, UniqueConnectionHandles){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+    CHECK_EQUAL(2, le_connections);
+    CHECK(le_connection_handles[0] != le_connection_handles[1]);
+    CHECK_EQUAL(CONTROLLER_CON_HANDLE, le_connection_handles[0]);
+    CHECK_EQUAL(0, hci_get_controller_for_con_handle(le_connection_handles[0]));
+    CHECK_EQUAL(1, hci_get_controller_for_con_handle(le_connection_handles[1]));
+    CHECK(hci_connection_for_handle(le_connection_handles[0]) != NULL);
+    CHECK(hci_connection_for_handle(le_connection_handles[1]) != NULL);
+    // selection not changed by events
+    CHECK_EQUAL(0, hci_get_controller());
+}
+
+TEST(MultipleControllers, AclRouting){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+
+    // outgoing ACL goes to controller of connection with controller's handle
+    send_acl_packet(le_connection_handles[1]);
+    CHECK_EQUAL(0, mock_controllers[0].sent_acl_packets);
+    CHECK_EQUAL(1, mock_controllers[1].sent_acl_packets);
+    CHECK_EQUAL(CONTROLLER_CON_HANDLE | 0x2000, little_endian_read_16(mock_controllers[1].sent_data, 0));
+
+    // incoming ACL is reported with host handle
+    mock_acl_packet(1, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(8, received_acl_len);
+    CHECK_EQUAL(le_connection_handles[1] | 0x2000, little_endian_read_16(received_acl_packet, 0));
+
+    // unknown handle is dropped
+    received_acl_len = 0;
+    mock_acl_packet(1, 0x0041);
+    CHECK_EQUAL(0, received_acl_len);
+}
+
+TEST(MultipleControllers, FlowControlPerController){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+
+    // single ACL buffer per controller
+    send_acl_packet(le_connection_handles[1]);
+    CHECK_EQUAL(0, hci_can_send_acl_packet_now(le_connection_handles[1]));
+    CHECK_EQUAL(1, hci_can_send_acl_packet_now(le_connection_handles[0]));
+
+    // completed packet on other controller doesn't free buffer
+    mock_number_of_completed_packets(0, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(0, hci_can_send_acl_packet_now(le_connection_handles[1]));
+
+    mock_number_of_completed_packets(1, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(1, hci_can_send_acl_packet_now(le_connection_handles[1]));
+}
+
+TEST(MultipleControllers, Disconnect){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+
+    // HCI Disconnect is sent to controller of connection with controller's handle
+    mock_controllers[0].sent_len = 0;
+    gap_disconnect(le_connection_handles[1]);
+    CHECK_EQUAL(0, mock_controllers[0].sent_len);
+    CHECK_EQUAL(hci_disconnect.opcode, little_endian_read_16(mock_controllers[1].sent_data, 0));
+    CHECK_EQUAL(CONTROLLER_CON_HANDLE, little_endian_read_16(mock_controllers[1].sent_data, 3));
+    CHECK_EQUAL(0, hci_get_controller());
+
+    mock_disconnection_complete(1, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(1, disconnections);
+    CHECK(hci_connection_for_handle(le_connection_handles[1]) == NULL);
+    CHECK_EQUAL(-1, hci_get_controller_for_con_handle(le_connection_handles[1]));
+    CHECK(hci_connection_for_handle(le_connection_handles[0]) != NULL);
+}
+
+TEST(MultipleControllers, ConnectionForAddressOnOtherController){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+    bd_addr_t addr = { 0, 0, 0, 0, 0, 0x20 };
+    hci_connection_t * connection = hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_LE_PUBLIC);
+    CHECK(connection != NULL);
+    CHECK_EQUAL(le_connection_handles[1], connection->con_handle);
+    CHECK_EQUAL(0, hci_get_controller());
+}
+
+TEST(MultipleControllers, ConnectionForAddressPrefersSelectedController){
+    mock_le_connection_complete(0, 0x20);
+    mock_le_connection_complete(1, 0x20);
+    bd_addr_t addr = { 0, 0, 0, 0, 0, 0x20 };
+    hci_select_controller(1);
+    CHECK_EQUAL(le_connection_handles[1], hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_LE_PUBLIC)->con_handle);
+    hci_select_controller(0);
+    CHECK_EQUAL(le_connection_handles[0], hci_connection_for_bd_addr_and_type(addr, BD_ADDR_TYPE_LE_PUBLIC)->con_handle);
+}
+
+TEST(MultipleControllers, OwnAddressOfConnectionController){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+    uint8_t addr_type;
+    bd_addr_t addr;
+    hci_select_controller(1);
+    gap_le_get_own_address_for_con_handle(le_connection_handles[0], &addr_type, addr);
+    CHECK_EQUAL(0, memcmp(mock_controllers[0].bd_addr, addr, 6));
+    hci_select_controller(0);
+    gap_le_get_own_address_for_con_handle(le_connection_handles[1], &addr_type, addr);
+    CHECK_EQUAL(0, memcmp(mock_controllers[1].bd_addr, addr, 6));
+}
+
+TEST(MultipleControllers, FlowControlWithOtherControllerSelected){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+    send_acl_packet(le_connection_handles[0]);
+    hci_select_controller(1);
+    CHECK_EQUAL(0, hci_can_send_acl_packet_now(le_connection_handles[0]));
+    CHECK_EQUAL(1, hci_can_send_acl_packet_now(le_connection_handles[1]));
+    CHECK_EQUAL(0, hci_number_free_acl_slots_for_handle(le_connection_handles[0]));
+    CHECK_EQUAL(1, hci_number_free_acl_slots_for_handle(le_connection_handles[1]));
+    CHECK_EQUAL(1, hci_get_controller());
+}
+
+TEST_GROUP(MultipleControllersProperties){
+    void setup(void){
+        memset(mock_controllers, 0, sizeof(mock_controllers));
+        mock_controllers[0].bd_addr[5] = 0x01;
+        mock_controllers[1].bd_addr[5] = 0x02;
+        mock_controllers[1].acl_data_packet_length = 40;
+        mock_controllers[1].no_non_flushable_packet_boundary_flag = 1;
+
+        btstack_memory_init();
+        hci_init(&mock_transports[0], NULL);
+        CHECK_EQUAL(1, hci_add_controller(&mock_transports[1], NULL));
+
+        hci_select_controller(0);
+        hci_power_control(HCI_POWER_ON);
+        hci_select_controller(1);
+        hci_power_control(HCI_POWER_ON);
+        le_connection_parameter_range_t range;
+        gap_get_connection_parameter_range(&range);
+        range.le_conn_interval_min = 100;
+        gap_set_connection_parameter_range(&range);
+        hci_select_controller(0);
+        mock_process();
+
+        event_callback_registration.callback = &event_handler;
+        hci_add_event_handler(&event_callback_registration);
+        mock_le_connection_complete(0, 0x10);
+        mock_le_connection_complete(1, 0x20);
+    }
+    void teardown(void){
+        hci_close();
+    }
+};
+
+TEST(MultipleControllersProperties, PacketBoundaryFlag){
+    int i;
+    for (i = 0; i < 2; i++){
+        hci_select_controller(i);
+        CHECK_EQUAL(1, hci_non_flushable_packet_boundary_flag_supported_for_con_handle(le_connection_handles[0]));
+        CHECK_EQUAL(0, hci_non_flushable_packet_boundary_flag_supported_for_con_handle(le_connection_handles[1]));
+    }
+}
+
+TEST(MultipleControllersProperties, MaxAclDataPacketLength){
+    int i;
+    for (i = 0; i < 2; i++){
+        hci_select_controller(i);
+        CHECK_EQUAL(27, hci_max_acl_data_packet_length_for_con_handle(le_connection_handles[0]));
+        CHECK_EQUAL(40, hci_max_acl_data_packet_length_for_con_handle(le_connection_handles[1]));
+    }
+}
+
+TEST(MultipleControllersProperties, ConnectionParameterRange){
+    le_connection_parameter_range_t range;
+    int i;
+    for (i = 0; i < 2; i++){
+        hci_select_controller(i);
+        gap_get_connection_parameter_range_for_con_handle(le_connection_handles[0], &range);
+        CHECK_EQUAL(6, range.le_conn_interval_min);
+        gap_get_connection_parameter_range_for_con_handle(le_connection_handles[1], &range);
+        CHECK_EQUAL(100, range.le_conn_interval_min);
+    }
+}
+
+// SM keeps registered handlers across tests
+static btstack_packet_callback_registration_t sm_event_callback_registration;
+
+TEST_GROUP(MultipleControllersSM){
+    void setup(void){
+        memset(mock_controllers, 0, sizeof(mock_controllers));
+        mock_controllers[0].bd_addr[5] = 0x01;
+        mock_controllers[1].bd_addr[5] = 0x02;
+        mock_controllers[0].auto_complete_acl = 1;
+        mock_controllers[1].auto_complete_acl = 1;
+        le_connections = 0;
+
+        btstack_memory_init();
+        hci_init(&mock_transports[0], NULL);
+        CHECK_EQUAL(1, hci_add_controller(&mock_transports[1], NULL));
+        event_callback_registration.callback = &event_handler;
+        hci_add_event_handler(&event_callback_registration);
+        l2cap_init();
+        le_device_db_init();
+        sm_init();
+        sm_set_io_capabilities(IO_CAPABILITY_NO_INPUT_NO_OUTPUT);
+        sm_event_callback_registration.callback = &event_handler;
+        sm_add_event_handler(&sm_event_callback_registration);
+
+        hci_select_controller(0);
+        hci_power_control(HCI_POWER_ON);
+        hci_select_controller(1);
+        hci_power_control(HCI_POWER_ON);
+        hci_select_controller(0);
+        mock_process();
+    }
+    void teardown(void){
+        hci_close();
+    }
+};
+
+TEST(MultipleControllersSM, PairingUsesAddressOfConnectionController){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+
+    // pairing on controller 0 holds setup context, pairing on controller 1 has to wait
+    uint8_t preq[] = { SM_CODE_PAIRING_REQUEST, IO_CAPABILITY_NO_INPUT_NO_OUTPUT, 0, 0, 16, 0, SM_KEYDIST_ID_KEY };
+    mock_sm_pdu(0, preq, sizeof(preq));
+    CHECK(mock_sm_pdu_sent(0, SM_CODE_PAIRING_RESPONSE) != NULL);
+    mock_sm_pdu(1, preq, sizeof(preq));
+    CHECK(mock_sm_pdu_sent(1, SM_CODE_PAIRING_RESPONSE) == NULL);
+
+    // setup for controller 1 is initialized while handling event of controller 0
+    mock_disconnection_complete(0, CONTROLLER_CON_HANDLE);
+    const uint8_t * pres = mock_sm_pdu_sent(1, SM_CODE_PAIRING_RESPONSE);
+    CHECK(pres != NULL);
+
+    // peer confirm for address of controller 1 is accepted
+    bd_addr_t peer_addr = { 0, 0, 0, 0, 0, 0x20 };
+    uint8_t mrand[16];
+    uint8_t mconfirm[16];
+    uint8_t pdu[17];
+    memset(mrand, 0x33, sizeof(mrand));
+    c1(mrand, preq, pres, peer_addr, mock_controllers[1].bd_addr, mconfirm);
+    pdu[0] = SM_CODE_PAIRING_CONFIRM;
+    reverse_128(mconfirm, &pdu[1]);
+    mock_sm_pdu(1, pdu, sizeof(pdu));
+    CHECK(mock_sm_pdu_sent(1, SM_CODE_PAIRING_CONFIRM) != NULL);
+    pdu[0] = SM_CODE_PAIRING_RANDOM;
+    reverse_128(mrand, &pdu[1]);
+    mock_sm_pdu(1, pdu, sizeof(pdu));
+    CHECK(mock_sm_pdu_sent(1, SM_CODE_PAIRING_FAILED) == NULL);
+    CHECK(mock_sm_pdu_sent(1, SM_CODE_PAIRING_RANDOM) != NULL);
+
+    // identity address of controller 1 is distributed
+    mock_le_long_term_key_request(1);
+    mock_encryption_change(1);
+    const uint8_t * identity_address = mock_sm_pdu_sent(1, SM_CODE_IDENTITY_ADDRESS_INFORMATION);
+    CHECK(identity_address != NULL);
+    CHECK_EQUAL(0, identity_address[1]);
+    bd_addr_t address;
+    reverse_bd_addr(&identity_address[2], address);
+    CHECK_EQUAL(0, memcmp(mock_controllers[1].bd_addr, address, 6));
+    CHECK(mock_sm_pdu_sent(0, SM_CODE_IDENTITY_ADDRESS_INFORMATION) == NULL);
+}
+
+TEST(MultipleControllersSM, FixedChannelCanSendNowForConnectionController){
+    mock_le_connection_complete(0, 0x10);
+    mock_le_connection_complete(1, 0x20);
+    can_send_now_events = 0;
+    l2cap_register_fixed_channel(&fixed_channel_handler, L2CAP_CID_ATTRIBUTE_PROTOCOL);
+
+    // fill single buffer of controller 1
+    mock_controllers[1].auto_complete_acl = 0;
+    send_acl_packet(le_connection_handles[1]);
+    l2cap_request_can_send_fix_channel_now_event(le_connection_handles[1], L2CAP_CID_ATTRIBUTE_PROTOCOL);
+    CHECK_EQUAL(0, can_send_now_events);
+
+    // free buffer on selected controller 0 doesn't trigger event
+    mock_number_of_completed_packets(0, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(0, can_send_now_events);
+
+    mock_number_of_completed_packets(1, CONTROLLER_CON_HANDLE);
+    CHECK_EQUAL(1, can_send_now_events);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -274,6 +274,15 @@ TEST(HFPParser, HFP_AG_CONFIRM_COMMON_CODEC){
     CHECK_EQUAL(context.codec_confirmed, codec);
 }
 
+TEST(HFPParser, HFP_AG_DIAL_STRING_TOO_LONG){
+    sprintf(packet, "\r\n%s12345678901234567890123456789012345678901234567890;\r\n", HFP_CALL_PHONE_NUMBER);
+    for (pos = 0; pos < strlen(packet); pos++){
+        hfp_parse(&context, packet[pos], 0);
+    }
+    CHECK_EQUAL(HFP_CMD_CALL_PHONE_NUMBER, context.command);
+    CHECK_EQUAL(sizeof(context.line_buffer) - 1 - strlen(HFP_CALL_PHONE_NUMBER), strlen((const char *) &context.line_buffer[3]));
+}
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
@@ -0,0 +1,136 @@
+// Benchmark for HFP AT command parser
+//
+// Parses a stream of typical HF commands on the AG side and AG responses on the HF side
+// with hfp_parse(), as done by the RFCOMM handlers of HFP AG and HF.
+// Reports the fastest of several rounds to reduce scheduling noise.
+//
+// Usage: hfp_parser_benchmark [iterations]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "hci_dump.h"
+#include "classic/hfp.h"
+
+#define ROUNDS 5
+
+static const char * hf_commands[] = {
+    "\r\nAT+BRSF=159\r\n",
+    "\r\nAT+BAC=1,2\r\n",
+    "\r\nAT+CIND=?\r\n",
+    "\r\nAT+CIND?\r\n",
+    "\r\nAT+CMER=3,0,0,1\r\n",
+    "\r\nAT+CHLD=?\r\n",
+    "\r\nAT+BIND=1,2\r\n",
+    "\r\nAT+BIA=0,0,0,1,1,1,0\r\n",
+    "\r\nAT+COPS=3,0\r\n",
+    "\r\nAT+CMEE=1\r\n",
+    "\r\nAT+BCS=2\r\n",
+    "\r\nAT+VGS=9\r\n",
+    "\r\nAT+CLIP=1\r\n",
+    "\r\nATD1234567;\r\n",
+    "\r\nATA\r\n",
+};
+
+static const char * ag_responses[] = {
+    "\r\n+BRSF:1007\r\n\r\nOK\r\n",
+    "\r\n+BCS:2\r\n",
+    "\r\n+CIEV:2,1\r\n",
+    "\r\n+CIEV:3,0\r\n",
+    "\r\n+VGS:9\r\n",
+    "\r\n+CME ERROR:30\r\n",
+    "\r\n+COPS:0,0,\"operator\"\r\n\r\nOK\r\n",
+    "\r\n+CLIP:\"1234567\",129\r\n",
+    "\r\nRING\r\n",
+    "\r\nOK\r\n",
+};
+
+static hfp_connection_t context;
+static hfp_ag_indicator_t ag_indicators[] = {
+    {1, "service",   0, 1, 1, 0, 0, 0},
+    {2, "call",      0, 1, 0, 1, 1, 0},
+    {3, "callsetup", 0, 3, 0, 1, 1, 0},
+};
+
+static uint32_t time_us(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t) (tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
+static void reset_context(void){
+    memset(&context, 0, sizeof(context));
+    context.parser_state = HFP_PARSER_CMD_HEADER;
+    context.ag_indicators_nr = sizeof(ag_indicators) / sizeof(hfp_ag_indicator_t);
+    memcpy(context.ag_indicators, ag_indicators, sizeof(ag_indicators));
+}
+
+// concatenate lines into a single stream
+static uint8_t * create_stream(const char ** lines, int num_lines, uint32_t * out_size){
+    uint32_t size = 0;
+    int i;
+    for (i = 0; i < num_lines; i++){
+        size += strlen(lines[i]);
+    }
+    uint8_t * stream = (uint8_t *) malloc(size);
+    uint32_t pos = 0;
+    for (i = 0; i < num_lines; i++){
+        memcpy(&stream[pos], lines[i], strlen(lines[i]));
+        pos += strlen(lines[i]);
+    }
+    *out_size = size;
+    return stream;
+}
+
+// @returns duration of fastest round in us
+static uint32_t benchmark_parser(const uint8_t * stream, uint32_t size, int iterations, int isHandsFree){
+    uint32_t min_us = 0xffffffff;
+    int round;
+    for (round = 0; round < ROUNDS; round++){
+        reset_context();
+        uint32_t start = time_us();
+        int i;
+        for (i = 0; i < iterations; i++){
+            uint32_t pos;
+            for (pos = 0; pos < size; pos++){
+                hfp_parse(&context, stream[pos], isHandsFree);
+            }
+        }
+        uint32_t duration_us = time_us() - start;
+        if (duration_us < min_us){
+            min_us = duration_us;
+        }
+    }
+    return min_us;
+}
+
+static void benchmark(const char * name, const char ** lines, int num_lines, int iterations, int isHandsFree){
+    uint32_t size;
+    uint8_t * stream = create_stream(lines, num_lines, &size);
+    uint32_t duration_us = benchmark_parser(stream, size, iterations, isHandsFree);
+    uint64_t total_lines = (uint64_t) num_lines * iterations;
+    uint64_t total_bytes = (uint64_t) size * iterations;
+    printf("%s: %5u ns/line, %3u ns/byte\n", name, (unsigned) (duration_us * 1000ULL / total_lines),
+        (unsigned) (duration_us * 1000ULL / total_bytes));
+    free(stream);
+}
+
+int main(int argc, const char * argv[]){
+    int iterations = 100000;
+    if (argc > 1){
+        iterations = atoi(argv[1]);
+    }
+    if (iterations <= 0) return 1;
+
+    // test config enables logging, don't measure printf
+    hci_dump_enable_log_level(LOG_LEVEL_DEBUG, 0);
+    hci_dump_enable_log_level(LOG_LEVEL_INFO, 0);
+    hci_dump_enable_log_level(LOG_LEVEL_ERROR, 0);
+
+    benchmark("AG", hf_commands,  sizeof(hf_commands)  / sizeof(const char *), iterations, 0);
+    benchmark("HF", ag_responses, sizeof(ag_responses) / sizeof(const char *), iterations, 1);
+    return 0;
+}
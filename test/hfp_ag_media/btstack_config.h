@@ -0,0 +1,25 @@
+//
+// btstack_config.h for hfp_ag_media test
+//
+
+#ifndef __BTSTACK_CONFIG
+#define __BTSTACK_CONFIG
+
+// Port related features
+#define HAVE_POSIX_TIME
+#define HAVE_POSIX_FILE_IO
+
+// BTstack features that can be enabled
+#define ENABLE_CLASSIC
+#define ENABLE_LOG_ERROR
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 52
+#define HCI_INCOMING_PRE_BUFFER_SIZE 4
+
+// media engine: 4 links, SBC codec for AG and simulated remote side
+#define MAX_NR_HFP_AG_MEDIA_LINKS 4
+#define MAX_NR_BTSTACK_SBC_ENCODERS 8
+#define MAX_NR_BTSTACK_SBC_DECODERS 8
+
+#endif
@@ -0,0 +1,551 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_util.h"
+#include "hci.h"
+#include "classic/btstack_sbc.h"
+#include "classic/hfp.h"
+#include "classic/hfp_ag_media.h"
+#include "classic/hfp_msbc.h"
+
+// SCO loopback: HCI is replaced by a model of the remote hands-free devices. Each remote sends
+// a tone with its own frequency every 7.5 ms and decodes the audio sent by the media engine.
+
+#define MAX_REMOTES             4
+#define TICK_US                 7500
+#define CVSD_PAYLOAD_SIZE       60      // 30 samples, two packets per tick
+#define MSBC_PAYLOAD_SIZE       60      // one mSBC frame per tick
+#define MAX_CAPTURE_SAMPLES     32000   // 2 s at 16 kHz
+#define ANALYSIS_MS             500
+
+typedef struct {
+    hci_con_handle_t sco_handle;
+    uint8_t  codec;
+    int      sample_rate;
+    int      tone_hz;
+    uint32_t phase;             // samples sent
+    int      corrupt_packets;   // send bad packets if set
+
+    hfp_msbc_encoder_t          msbc_encoder;
+    btstack_sbc_decoder_state_t msbc_decoder;
+
+    // audio received from media engine
+    int16_t  capture[MAX_CAPTURE_SAMPLES];
+    int      capture_samples;
+    uint32_t packets_received;
+} remote_t;
+
+static remote_t remotes[MAX_REMOTES];
+static int      num_remotes;
+
+// hci
+static btstack_packet_handler_t hci_event_handler;
+static uint8_t  outgoing_packet_buffer[300];
+static int      sco_can_send_now_requested;
+static int      packet_buffer_reserved;
+
+// pcm handler
+static int      pcm_samples_by_handle[MAX_REMOTES];
+static int      pcm_sample_rate_by_handle[MAX_REMOTES];
+
+// time spent in media engine
+static double   engine_seconds;
+
+static double time_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static remote_t * remote_for_handle(hci_con_handle_t handle){
+    int i;
+    for (i=0;i<num_remotes;i++){
+        if (remotes[i].sco_handle == handle) return &remotes[i];
+    }
+    return NULL;
+}
+
+static void remote_capture(remote_t * remote, int16_t * samples, int num_samples){
+    int i;
+    for (i=0;i<num_samples;i++){
+        if (remote->capture_samples >= MAX_CAPTURE_SAMPLES){
+            // keep most recent audio
+            memmove(remote->capture, &remote->capture[MAX_CAPTURE_SAMPLES/2], MAX_CAPTURE_SAMPLES/2 * sizeof(int16_t));
+            remote->capture_samples = MAX_CAPTURE_SAMPLES/2;
+        }
+        remote->capture[remote->capture_samples++] = samples[i];
+    }
+}
+
+static void remote_handle_msbc_pcm_data(int16_t * data, int num_samples, int num_channels, int sample_rate, void * context){
+    UNUSED(num_channels);
+    UNUSED(sample_rate);
+    remote_capture((remote_t *) context, data, num_samples);
+}
+
+// mocks
+
+extern "C" void hci_add_event_handler(btstack_packet_callback_registration_t * callback_handler){
+    hci_event_handler = callback_handler->callback;
+}
+
+extern "C" int hci_reserve_packet_buffer(void){
+    packet_buffer_reserved = 1;
+    return 1;
+}
+
+extern "C" uint8_t * hci_get_outgoing_packet_buffer(void){
+    return outgoing_packet_buffer;
+}
+
+extern "C" void hci_request_sco_can_send_now_event(void){
+    sco_can_send_now_requested = 1;
+}
+
+extern "C" int hci_send_sco_packet_buffer(int size){
+    packet_buffer_reserved = 0;
+    hci_con_handle_t handle = little_endian_read_16(outgoing_packet_buffer, 0) & 0x0fff;
+    remote_t * remote = remote_for_handle(handle);
+    CHECK(remote != NULL);
+    CHECK_EQUAL(size - 3, outgoing_packet_buffer[2]);
+    remote->packets_received++;
+    if (remote->codec == HFP_CODEC_MSBC){
+        btstack_sbc_decoder_process_data(&remote->msbc_decoder, 0, &outgoing_packet_buffer[3], size - 3);
+    } else {
+        int16_t samples[128];
+        int num_samples = (size - 3) / 2;
+        int i;
+        for (i=0;i<num_samples;i++){
+            samples[i] = (int16_t) little_endian_read_16(outgoing_packet_buffer, 3 + i * 2);
+        }
+        remote_capture(remote, samples, num_samples);
+    }
+    return 0;
+}
+
+// engine calls, timed
+
+static void engine_handle_hci_event(uint8_t * event, uint16_t size){
+    double start = time_seconds();
+    (*hci_event_handler)(HCI_EVENT_PACKET, 0, event, size);
+    engine_seconds += time_seconds() - start;
+}
+
+static void engine_handle_sco_packet(uint8_t * packet, uint16_t size){
+    double start = time_seconds();
+    hfp_ag_media_sco_packet_handler(HCI_SCO_DATA_PACKET, 0, packet, size);
+    engine_seconds += time_seconds() - start;
+}
+
+static void process_sco_can_send_now(void){
+    while (sco_can_send_now_requested){
+        sco_can_send_now_requested = 0;
+        uint8_t event[] = { HCI_EVENT_SCO_CAN_SEND_NOW, 0 };
+        engine_handle_hci_event(event, sizeof(event));
+    }
+}
+
+static hci_con_handle_t remote_connect(uint8_t codec, int tone_hz){
+    remote_t * remote = &remotes[num_remotes];
+    memset(remote, 0, sizeof(remote_t));
+    remote->sco_handle = 0x20 + num_remotes;
+    remote->codec = codec;
+    remote->tone_hz = tone_hz;
+    if (codec == HFP_CODEC_MSBC){
+        remote->sample_rate = 16000;
+        hfp_msbc_encoder_init(&remote->msbc_encoder);
+        btstack_sbc_decoder_init(&remote->msbc_decoder, SBC_MODE_mSBC, &remote_handle_msbc_pcm_data, remote);
+    } else {
+        remote->sample_rate = 8000;
+    }
+    num_remotes++;
+
+    uint8_t event[19];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_SYNCHRONOUS_CONNECTION_COMPLETE;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 3, remote->sco_handle);
+    event[11] = 0x02;   // eSCO
+    little_endian_store_16(event, 14, 60);
+    little_endian_store_16(event, 16, 60);
+    event[18] = (codec == HFP_CODEC_MSBC) ? 0x03 : 0x02;
+    engine_handle_hci_event(event, sizeof(event));
+    return remote->sco_handle;
+}
+
+static void remote_disconnect(hci_con_handle_t sco_handle){
+    uint8_t event[6];
+    event[0] = HCI_EVENT_DISCONNECTION_COMPLETE;
+    event[1] = sizeof(event) - 2;
+    event[2] = 0;
+    little_endian_store_16(event, 3, sco_handle);
+    event[5] = 0x13;
+    engine_handle_hci_event(event, sizeof(event));
+}
+
+static void remote_fill_tone(remote_t * remote, int16_t * samples, int num_samples){
+    int i;
+    for (i=0;i<num_samples;i++){
+        samples[i] = (int16_t) (8000 * sin(2 * M_PI * remote->tone_hz * remote->phase / remote->sample_rate));
+        remote->phase++;
+    }
+}
+
+static void remote_send_packet(remote_t * remote, uint8_t * payload, int payload_size){
+    uint8_t packet[3+MSBC_PAYLOAD_SIZE];
+    little_endian_store_16(packet, 0, remote->sco_handle);
+    if (remote->corrupt_packets){
+        // packet status flag: no data received
+        packet[1] |= 2 << 4;
+        memset(payload, 0, payload_size);
+    }
+    packet[2] = payload_size;
+    memcpy(&packet[3], payload, payload_size);
+    engine_handle_sco_packet(packet, 3 + payload_size);
+    process_sco_can_send_now();
+}
+
+static void remote_tick(remote_t * remote){
+    uint8_t payload[MSBC_PAYLOAD_SIZE];
+    if (remote->codec == HFP_CODEC_MSBC){
+        int16_t samples[120];
+        remote_fill_tone(remote, samples, 120);
+        hfp_msbc_encoder_encode_audio_frame(&remote->msbc_encoder, samples);
+        hfp_msbc_encoder_read_from_stream(&remote->msbc_encoder, payload, MSBC_PAYLOAD_SIZE);
+        remote_send_packet(remote, payload, MSBC_PAYLOAD_SIZE);
+        return;
+    }
+    int packet;
+    for (packet=0;packet<2;packet++){
+        int16_t samples[CVSD_PAYLOAD_SIZE/2];
+        remote_fill_tone(remote, samples, CVSD_PAYLOAD_SIZE/2);
+        int i;
+        for (i=0;i<CVSD_PAYLOAD_SIZE/2;i++){
+            little_endian_store_16(payload, i * 2, (uint16_t) samples[i]);
+        }
+        remote_send_packet(remote, payload, CVSD_PAYLOAD_SIZE);
+    }
+}
+
+static void run_ms(int duration_ms){
+    int ticks = duration_ms * 1000 / TICK_US;
+    int i;
+    for (i=0;i<ticks;i++){
+        int j;
+        for (j=0;j<num_remotes;j++){
+            remote_tick(&remotes[j]);
+        }
+    }
+}
+
+// power of tone in most recent captured audio, relative to total power
+static double tone_ratio(remote_t * remote, int tone_hz){
+    int num_samples = btstack_min(remote->capture_samples, remote->sample_rate * ANALYSIS_MS / 1000);
+    int16_t * samples = &remote->capture[remote->capture_samples - num_samples];
+    double coeff = 2 * cos(2 * M_PI * tone_hz / remote->sample_rate);
+    double s1 = 0, s2 = 0, total = 0;
+    int i;
+    for (i=0;i<num_samples;i++){
+        double s0 = samples[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+        total += (double) samples[i] * samples[i];
+    }
+    if (total == 0) return 0;
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    // a pure tone has power = total * num_samples / 2
+    return power / (total * num_samples / 2);
+}
+
+static double rms(remote_t * remote){
+    int num_samples = btstack_min(remote->capture_samples, remote->sample_rate * ANALYSIS_MS / 1000);
+    int16_t * samples = &remote->capture[remote->capture_samples - num_samples];
+    double total = 0;
+    int i;
+    for (i=0;i<num_samples;i++){
+        total += (double) samples[i] * samples[i];
+    }
+    return num_samples ? sqrt(total / num_samples) : 0;
+}
+
+static void pcm_handler(hci_con_handle_t sco_handle, int16_t * samples, int num_samples, int sample_rate){
+    UNUSED(samples);
+    int index = sco_handle - 0x20;
+    pcm_samples_by_handle[index] += num_samples;
+    pcm_sample_rate_by_handle[index] = sample_rate;
+}
+
+TEST_GROUP(HFPAGMedia){
+    void setup(void){
+        int i;
+        for (i=0;i<num_remotes;i++){
+            remote_disconnect(remotes[i].sco_handle);
+            if (remotes[i].codec == HFP_CODEC_MSBC){
+                hfp_msbc_encoder_deinit(&remotes[i].msbc_encoder);
+                btstack_sbc_decoder_deinit(&remotes[i].msbc_decoder);
+            }
+        }
+        num_remotes = 0;
+        sco_can_send_now_requested = 0;
+        packet_buffer_reserved = 0;
+        engine_seconds = 0;
+        memset(pcm_samples_by_handle, 0, sizeof(pcm_samples_by_handle));
+        memset(pcm_sample_rate_by_handle, 0, sizeof(pcm_sample_rate_by_handle));
+        hfp_ag_media_init();
+    }
+};
+
+TEST(HFPAGMedia, LinksFollowSCOConnections){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_CVSD, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1000);
+    CHECK_EQUAL(2, hfp_ag_media_num_links());
+
+    hfp_ag_media_link_statistics_t statistics;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_get_statistics(a, &statistics));
+    CHECK_EQUAL(HFP_CODEC_CVSD, statistics.codec);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_get_statistics(b, &statistics));
+    CHECK_EQUAL(HFP_CODEC_MSBC, statistics.codec);
+
+    remote_disconnect(a);
+    CHECK_EQUAL(1, hfp_ag_media_num_links());
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, hfp_ag_media_get_statistics(a, &statistics));
+    CHECK_EQUAL(ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER, hfp_ag_media_bridge(a, b));
+}
+
+TEST(HFPAGMedia, PacketSentForEachPacketReceived){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_CVSD, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1000);
+    run_ms(300);
+
+    hfp_ag_media_link_statistics_t statistics;
+    hfp_ag_media_get_statistics(a, &statistics);
+    CHECK_EQUAL(80, statistics.packets_received);
+    CHECK_EQUAL(80, statistics.packets_sent);
+    CHECK_EQUAL(80, remotes[0].packets_received);
+    CHECK_EQUAL(80, statistics.frames_decoded * 24 / 30);
+    hfp_ag_media_get_statistics(b, &statistics);
+    CHECK_EQUAL(40, statistics.packets_received);
+    CHECK_EQUAL(40, statistics.packets_sent);
+    CHECK_EQUAL(40, statistics.frames_decoded);
+    CHECK_EQUAL(40, statistics.frames_encoded);
+    CHECK_EQUAL(0, statistics.frames_concealed);
+    CHECK_EQUAL(40, remotes[1].packets_received);
+}
+
+TEST(HFPAGMedia, UnbridgedLinksDoNotHearEachOther){
+    remote_connect(HFP_CODEC_CVSD, 500);
+    remote_connect(HFP_CODEC_MSBC, 1000);
+    run_ms(300);
+    CHECK(rms(&remotes[0]) < 1);
+    // decoder conceals mSBC frames with digital silence, check for cross talk only
+    CHECK(tone_ratio(&remotes[1],  500) < 0.01);
+    CHECK(tone_ratio(&remotes[1], 1000) < 0.01);
+}
+
+TEST(HFPAGMedia, BridgeCVSD){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_CVSD, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_CVSD, 1500);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_bridge(a, b));
+    run_ms(1000);
+    CHECK(tone_ratio(&remotes[0], 1500) > 0.9);
+    CHECK(tone_ratio(&remotes[0],  500) < 0.01);
+    CHECK(tone_ratio(&remotes[1],  500) > 0.9);
+    CHECK(tone_ratio(&remotes[1], 1500) < 0.01);
+}
+
+TEST(HFPAGMedia, BridgeMSBC){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1500);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_bridge(a, b));
+    run_ms(1000);
+    CHECK(tone_ratio(&remotes[0], 1500) > 0.9);
+    CHECK(tone_ratio(&remotes[0],  500) < 0.01);
+    CHECK(tone_ratio(&remotes[1],  500) > 0.9);
+    CHECK(tone_ratio(&remotes[1], 1500) < 0.01);
+    hfp_ag_media_link_statistics_t statistics;
+    hfp_ag_media_get_statistics(a, &statistics);
+    CHECK_EQUAL(0, statistics.mixer_overruns);
+}
+
+TEST(HFPAGMedia, BridgeCVSDAndMSBC){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_CVSD, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1500);
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_bridge(a, b));
+    run_ms(1000);
+    CHECK(tone_ratio(&remotes[0], 1500) > 0.8);
+    CHECK(tone_ratio(&remotes[0],  500) < 0.01);
+    CHECK(tone_ratio(&remotes[1],  500) > 0.8);
+    CHECK(tone_ratio(&remotes[1], 1500) < 0.01);
+}
+
+TEST(HFPAGMedia, Conference){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC,  500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1000);
+    hci_con_handle_t c = remote_connect(HFP_CODEC_CVSD, 1500);
+    hfp_ag_media_set_mixer_group(a, 7);
+    hfp_ag_media_set_mixer_group(b, 7);
+    hfp_ag_media_set_mixer_group(c, 7);
+    run_ms(1000);
+    // each remote hears the other two
+    CHECK(tone_ratio(&remotes[0], 1000) > 0.3);
+    CHECK(tone_ratio(&remotes[0], 1500) > 0.3);
+    CHECK(tone_ratio(&remotes[0],  500) < 0.01);
+    CHECK(tone_ratio(&remotes[1],  500) > 0.3);
+    CHECK(tone_ratio(&remotes[1], 1500) > 0.3);
+    CHECK(tone_ratio(&remotes[1], 1000) < 0.01);
+    CHECK(tone_ratio(&remotes[2],  500) > 0.3);
+    CHECK(tone_ratio(&remotes[2], 1000) > 0.3);
+    CHECK(tone_ratio(&remotes[2], 1500) < 0.01);
+}
+
+TEST(HFPAGMedia, TwoBridges){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC,  500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1000);
+    hci_con_handle_t c = remote_connect(HFP_CODEC_MSBC, 1500);
+    hci_con_handle_t d = remote_connect(HFP_CODEC_MSBC, 2000);
+    hfp_ag_media_bridge(a, b);
+    hfp_ag_media_bridge(c, d);
+    run_ms(1000);
+    CHECK(tone_ratio(&remotes[0], 1000) > 0.9);
+    CHECK(tone_ratio(&remotes[1],  500) > 0.9);
+    CHECK(tone_ratio(&remotes[2], 2000) > 0.9);
+    CHECK(tone_ratio(&remotes[3], 1500) > 0.9);
+}
+
+TEST(HFPAGMedia, LocalAudio){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC, 500);
+    hfp_ag_media_register_pcm_handler(&pcm_handler);
+    int tick;
+    for (tick=0;tick<133;tick++){
+        // 7.5 ms of 1 kHz at 8 kHz, upsampled by media engine
+        int16_t samples[60];
+        int i;
+        for (i=0;i<60;i++){
+            samples[i] = (int16_t) (8000 * sin(2 * M_PI * 1000 * (tick * 60 + i) / 8000));
+        }
+        CHECK_EQUAL(60, hfp_ag_media_mix_audio(a, samples, 60, 8000));
+        remote_tick(&remotes[0]);
+    }
+    CHECK(tone_ratio(&remotes[0], 1000) > 0.9);
+    CHECK_EQUAL(133 * 120, pcm_samples_by_handle[0]);
+    CHECK_EQUAL(16000, pcm_sample_rate_by_handle[0]);
+}
+
+TEST(HFPAGMedia, LocalAudioOverrun){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_CVSD, 500);
+    int16_t samples[600];
+    memset(samples, 0, sizeof(samples));
+    // mix buffer holds 480 samples, i.e. 60 ms at 8 kHz
+    CHECK_EQUAL(480, hfp_ag_media_mix_audio(a, samples, 600, 8000));
+    hfp_ag_media_link_statistics_t statistics;
+    hfp_ag_media_get_statistics(a, &statistics);
+    CHECK_EQUAL(120, statistics.mixer_overruns);
+    CHECK_EQUAL(0, hfp_ag_media_mix_audio(a, samples, 1, 8000));
+    CHECK_EQUAL(0, hfp_ag_media_mix_audio(a, samples, 1, 44100));
+}
+
+TEST(HFPAGMedia, PacketLossConcealmentPerLink){
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC, 500);
+    hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1500);
+    hfp_ag_media_bridge(a, b);
+    run_ms(300);
+    remotes[0].corrupt_packets = 1;
+    run_ms(60);
+    remotes[0].corrupt_packets = 0;
+    run_ms(300);
+
+    hfp_ag_media_link_statistics_t statistics;
+    hfp_ag_media_get_statistics(a, &statistics);
+    CHECK(statistics.frames_concealed > 0);
+    hfp_ag_media_get_statistics(b, &statistics);
+    CHECK_EQUAL(0, statistics.frames_concealed);
+    // audio continues after loss
+    CHECK(tone_ratio(&remotes[1], 500) > 0.9);
+}
+
+TEST(HFPAGMedia, ReuseLinks){
+    int round;
+    for (round=0;round<10;round++){
+        hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC, 500);
+        hci_con_handle_t b = remote_connect(HFP_CODEC_MSBC, 1500);
+        hfp_ag_media_bridge(a, b);
+        run_ms(100);
+        CHECK_EQUAL(2, hfp_ag_media_num_links());
+        remote_disconnect(a);
+        remote_disconnect(b);
+        hfp_msbc_encoder_deinit(&remotes[0].msbc_encoder);
+        btstack_sbc_decoder_deinit(&remotes[0].msbc_decoder);
+        hfp_msbc_encoder_deinit(&remotes[1].msbc_encoder);
+        btstack_sbc_decoder_deinit(&remotes[1].msbc_decoder);
+        num_remotes = 0;
+        CHECK_EQUAL(0, hfp_ag_media_num_links());
+    }
+}
+
+TEST(HFPAGMedia, MSBCLinkRejectedWithoutCodec){
+    // use up all SBC encoders
+    btstack_sbc_encoder_state_t encoders[MAX_NR_BTSTACK_SBC_ENCODERS + 1];
+    int num_encoders = 0;
+    while (btstack_sbc_encoder_init(&encoders[num_encoders], SBC_MODE_mSBC, 15, 8, 0, 16000, 26) == ERROR_CODE_SUCCESS){
+        num_encoders++;
+    }
+    CHECK_EQUAL(MAX_NR_BTSTACK_SBC_ENCODERS, num_encoders);
+
+    // leave one for the remote
+    num_encoders--;
+    btstack_sbc_encoder_deinit(&encoders[num_encoders]);
+
+    remote_connect(HFP_CODEC_MSBC, 500);
+    CHECK_EQUAL(0, hfp_ag_media_num_links());
+
+    // CVSD does not need codec storage
+    remote_connect(HFP_CODEC_CVSD, 1000);
+    CHECK_EQUAL(1, hfp_ag_media_num_links());
+
+    int i;
+    for (i=0;i<num_encoders;i++){
+        btstack_sbc_encoder_deinit(&encoders[i]);
+    }
+
+    // decoder of rejected link was released
+    hci_con_handle_t a = remote_connect(HFP_CODEC_MSBC, 1500);
+    CHECK_EQUAL(2, hfp_ag_media_num_links());
+    hfp_ag_media_link_statistics_t statistics;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, hfp_ag_media_get_statistics(a, &statistics));
+    CHECK_EQUAL(HFP_CODEC_MSBC, statistics.codec);
+}
+
+TEST(HFPAGMedia, BenchmarkCPUPerCall){
+    // bridged pairs, 5 s of audio
+    const int duration_ms = 5000;
+    uint8_t codecs[] = { HFP_CODEC_CVSD, HFP_CODEC_MSBC };
+    int c;
+    for (c=0;c<2;c++){
+        int num_links;
+        for (num_links=2;num_links<=MAX_REMOTES;num_links+=2){
+            setup();
+            int i;
+            for (i=0;i<num_links;i++){
+                remote_connect(codecs[c], 500 + 250 * i);
+            }
+            for (i=0;i<num_links;i+=2){
+                hfp_ag_media_bridge(remotes[i].sco_handle, remotes[i+1].sco_handle);
+            }
+            run_ms(duration_ms);
+            double cpu_percent_per_link = 100.0 * engine_seconds / num_links / (duration_ms / 1000.0);
+            printf("HFP AG Media: %s, %u links: %.3f %% CPU per link\n", codecs[c] == HFP_CODEC_MSBC ? "mSBC" : "CVSD",
+                num_links, cpu_percent_per_link);
+            // real-time with plenty of headroom on a host
+            CHECK(cpu_percent_per_link < 25);
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
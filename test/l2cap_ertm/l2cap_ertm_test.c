@@ -0,0 +1,785 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "btstack_event.h"
+#include "btstack_linked_list.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+#include "l2cap_signaling.h"
+
+#define MOCK_QUEUE_SIZE   16
+#define MOCK_PACKET_SIZE  (HCI_INCOMING_PRE_BUFFER_SIZE + 260)
+#define MOCK_MAX_FRAMES   32
+
+#define CON_HANDLE   0x0040
+#define TEST_PSM     0x1001
+#define REMOTE_CID   0x0041
+
+#define RETRANSMISSION_TIMEOUT_MS 1000
+#define MONITOR_TIMEOUT_MS        2000
+
+// I-frame: tx seq(6) << 1, final << 7, req seq(6) << 8, sar(2) << 14
+// S-frame: 1, function(2) << 2, poll << 4, final << 7, req seq(6) << 8
+#define SAR_UNSEGMENTED  0
+#define SAR_START        1
+#define SAR_END          2
+#define SAR_CONTINUATION 3
+
+#define S_RR   0
+#define S_REJ  1
+#define S_RNR  2
+#define S_SREJ 3
+
+// test run loop with time controlled by the test
+
+static btstack_linked_list_t test_timers;
+static uint32_t              test_time_ms;
+
+static void test_run_loop_init(void){
+}
+static void test_run_loop_add_data_source(btstack_data_source_t * ds){
+    UNUSED(ds);
+}
+static int test_run_loop_remove_data_source(btstack_data_source_t * ds){
+    UNUSED(ds);
+    return 0;
+}
+static void test_run_loop_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    UNUSED(ds);
+    UNUSED(callbacks);
+}
+static void test_run_loop_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    UNUSED(ds);
+    UNUSED(callbacks);
+}
+static void test_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = test_time_ms + timeout_in_ms;
+}
+static void test_run_loop_add_timer(btstack_timer_source_t * ts){
+    btstack_linked_list_remove(&test_timers, (btstack_linked_item_t *) ts);
+    btstack_linked_list_add(&test_timers, (btstack_linked_item_t *) ts);
+}
+static int test_run_loop_remove_timer(btstack_timer_source_t * ts){
+    return btstack_linked_list_remove(&test_timers, (btstack_linked_item_t *) ts);
+}
+static void test_run_loop_execute(void){
+}
+static void test_run_loop_dump_timer(void){
+}
+static uint32_t test_run_loop_get_time_ms(void){
+    return test_time_ms;
+}
+
+static const btstack_run_loop_t test_run_loop = {
+    &test_run_loop_init,
+    &test_run_loop_add_data_source,
+    &test_run_loop_remove_data_source,
+    &test_run_loop_enable_data_source_callbacks,
+    &test_run_loop_disable_data_source_callbacks,
+    &test_run_loop_set_timer,
+    &test_run_loop_add_timer,
+    &test_run_loop_remove_timer,
+    &test_run_loop_execute,
+    &test_run_loop_dump_timer,
+    &test_run_loop_get_time_ms,
+};
+
+// advance time and process expired timers
+static void test_run_loop_advance(uint32_t ms){
+    test_time_ms += ms;
+    int fired = 1;
+    while (fired){
+        fired = 0;
+        btstack_linked_list_iterator_t it;
+        btstack_linked_list_iterator_init(&it, &test_timers);
+        while (btstack_linked_list_iterator_has_next(&it)){
+            btstack_timer_source_t * ts = (btstack_timer_source_t *) btstack_linked_list_iterator_next(&it);
+            if (ts->timeout > test_time_ms) continue;
+            btstack_linked_list_iterator_remove(&it);
+            ts->process(ts);
+            fired = 1;
+            break;
+        }
+    }
+}
+
+// mock controller
+
+static void (*mock_packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+
+static uint8_t  mock_queue_types[MOCK_QUEUE_SIZE];
+static uint16_t mock_queue_lens[MOCK_QUEUE_SIZE];
+static uint8_t  mock_queue_data[MOCK_QUEUE_SIZE][MOCK_PACKET_SIZE];
+static int      mock_queue_count;
+
+// L2CAP packets sent by host, starting with basic L2CAP header
+static uint8_t  sent_frames[MOCK_MAX_FRAMES][HCI_ACL_PAYLOAD_SIZE];
+static uint16_t sent_frame_lens[MOCK_MAX_FRAMES];
+static int      sent_frame_count;
+static uint8_t  sent_signaling[MOCK_MAX_FRAMES][HCI_ACL_PAYLOAD_SIZE];
+static int      sent_signaling_count;
+
+static uint8_t  remote_sig_id;
+
+static void mock_enqueue(uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    if (mock_queue_count >= MOCK_QUEUE_SIZE) return;
+    int pos = mock_queue_count++;
+    mock_queue_types[pos] = packet_type;
+    mock_queue_lens[pos]  = size;
+    memcpy(&mock_queue_data[pos][HCI_INCOMING_PRE_BUFFER_SIZE], packet, size);
+}
+
+static void mock_command_complete(uint16_t opcode, const uint8_t * return_parameters, int len){
+    uint8_t event[6 + 64];
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 4 + len;
+    event[2] = 1;
+    little_endian_store_16(event, 3, opcode);
+    event[5] = 0;
+    memcpy(&event[6], return_parameters, len);
+    mock_enqueue(HCI_EVENT_PACKET, event, 6 + len);
+}
+
+static void mock_handle_command(uint8_t * packet){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    uint8_t  return_parameters[64];
+    uint8_t  features[] = { 0xff, 0xff, 0x8f, 0xfe, 0xdb, 0xff, 0x5b, 0x87 };
+    memset(return_parameters, 0, sizeof(return_parameters));
+    if (opcode == hci_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, 1021);
+        little_endian_store_16(return_parameters, 3, 4);
+        mock_command_complete(opcode, return_parameters, 7);
+    } else if (opcode == hci_read_local_supported_features.opcode){
+        memcpy(return_parameters, features, sizeof(features));
+        mock_command_complete(opcode, return_parameters, sizeof(features));
+    } else if (opcode == hci_read_local_version_information.opcode){
+        little_endian_store_16(return_parameters, 4, 0xffff);
+        mock_command_complete(opcode, return_parameters, 8);
+    } else if (opcode == hci_read_local_supported_commands.opcode){
+        return_parameters[14] = 0x80;   // Read Buffer Size
+        mock_command_complete(opcode, return_parameters, 64);
+    } else {
+        mock_command_complete(opcode, return_parameters, 1);
+    }
+}
+
+static int mock_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    switch (packet_type){
+        case HCI_COMMAND_DATA_PACKET:
+            mock_handle_command(packet);
+            break;
+        case HCI_ACL_DATA_PACKET: {
+            uint16_t cid = little_endian_read_16(packet, 6);
+            if (cid == L2CAP_CID_SIGNALING && sent_signaling_count < MOCK_MAX_FRAMES){
+                memcpy(sent_signaling[sent_signaling_count++], &packet[8], size - 8);
+            }
+            if (cid == REMOTE_CID && sent_frame_count < MOCK_MAX_FRAMES){
+                memcpy(sent_frames[sent_frame_count], &packet[4], size - 4);
+                sent_frame_lens[sent_frame_count] = size - 4;
+                sent_frame_count++;
+            }
+            // report packet as completed right away
+            uint8_t event[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0, 0, 1, 0};
+            little_endian_store_16(event, 3, little_endian_read_16(packet, 0) & 0x0fff);
+            mock_enqueue(HCI_EVENT_PACKET, event, sizeof(event));
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+static void mock_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    mock_packet_handler = handler;
+}
+static int mock_open(void){
+    return 0;
+}
+static int mock_close(void){
+    return 0;
+}
+
+static const hci_transport_t mock_transport = {
+    "mock", NULL, &mock_open, &mock_close, &mock_register_packet_handler, NULL, &mock_send_packet, NULL, NULL, NULL
+};
+
+// deliver queued packets until controller is idle
+static void mock_process(void){
+    while (mock_queue_count){
+        uint8_t  packet_type = mock_queue_types[0];
+        uint16_t size = mock_queue_lens[0];
+        uint8_t  packet[MOCK_PACKET_SIZE];
+        memcpy(packet, mock_queue_data[0], sizeof(packet));
+        mock_queue_count--;
+        memmove(&mock_queue_types[0], &mock_queue_types[1], mock_queue_count);
+        memmove(&mock_queue_lens[0],  &mock_queue_lens[1],  mock_queue_count * sizeof(uint16_t));
+        memmove(&mock_queue_data[0],  &mock_queue_data[1],  mock_queue_count * MOCK_PACKET_SIZE);
+        mock_packet_handler(packet_type, &packet[HCI_INCOMING_PRE_BUFFER_SIZE], size);
+    }
+}
+
+static void mock_classic_connection(void){
+    uint8_t request[] = { HCI_EVENT_CONNECTION_REQUEST, 10, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0, 0, 0, 1};
+    mock_enqueue(HCI_EVENT_PACKET, request, sizeof(request));
+    mock_process();
+    uint8_t complete[] = { HCI_EVENT_CONNECTION_COMPLETE, 11, 0, 0, 0, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 1, 0};
+    little_endian_store_16(complete, 3, CON_HANDLE);
+    mock_enqueue(HCI_EVENT_PACKET, complete, sizeof(complete));
+    mock_process();
+}
+
+static void mock_l2cap_packet(uint16_t cid, const uint8_t * payload, uint16_t len){
+    uint8_t packet[HCI_ACL_HEADER_SIZE + HCI_ACL_PAYLOAD_SIZE];
+    little_endian_store_16(packet, 0, CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + len);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, cid);
+    memcpy(&packet[8], payload, len);
+    mock_enqueue(HCI_ACL_DATA_PACKET, packet, 8 + len);
+    mock_process();
+}
+
+// responses use identifier of request
+static void mock_signaling(uint8_t code, uint8_t sig_id, const uint8_t * data, uint16_t len){
+    uint8_t command[HCI_ACL_PAYLOAD_SIZE];
+    command[0] = code;
+    command[1] = sig_id;
+    little_endian_store_16(command, 2, len);
+    memcpy(&command[4], data, len);
+    mock_l2cap_packet(L2CAP_CID_SIGNALING, command, 4 + len);
+}
+
+// reference FCS: CRC-16 with polynomial x^16 + x^15 + x^2 + 1, bit by bit
+static uint16_t crc16(const uint8_t * data, uint16_t len){
+    uint16_t crc = 0;
+    int i;
+    for (i = 0; i < len; i++){
+        crc ^= data[i];
+        int bit;
+        for (bit = 0; bit < 8; bit++){
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+
+// channel under test
+
+static l2cap_ertm_config_t ertm_config;
+static uint8_t  ertm_buffer[2000];
+static uint16_t local_cid;
+static uint8_t  accept_status;
+static int      channel_opened;
+static uint8_t  channel_opened_status;
+static int      channel_closed;
+static int      can_send_now_events;
+static uint8_t  received_sdus[8][100];
+static uint16_t received_sdu_lens[8];
+static int      received_sdu_count;
+
+static void channel_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    if (packet_type == L2CAP_DATA_PACKET){
+        if (received_sdu_count >= 8) return;
+        memcpy(received_sdus[received_sdu_count], packet, btstack_min(size, 100));
+        received_sdu_lens[received_sdu_count] = size;
+        received_sdu_count++;
+        return;
+    }
+    if (packet_type != HCI_EVENT_PACKET) return;
+    switch (hci_event_packet_get_type(packet)){
+        case L2CAP_EVENT_INCOMING_CONNECTION:
+            local_cid = l2cap_event_incoming_connection_get_local_cid(packet);
+            accept_status = l2cap_accept_ertm_connection(local_cid, &ertm_config, ertm_buffer, sizeof(ertm_buffer));
+            break;
+        case L2CAP_EVENT_CHANNEL_OPENED:
+            channel_opened = 1;
+            channel_opened_status = l2cap_event_channel_opened_get_status(packet);
+            break;
+        case L2CAP_EVENT_CHANNEL_CLOSED:
+            channel_closed = 1;
+            break;
+        case L2CAP_EVENT_CAN_SEND_NOW:
+            can_send_now_events++;
+            break;
+        default:
+            break;
+    }
+}
+
+static void mock_frame(uint16_t control, const uint8_t * payload, uint16_t len, int corrupt_fcs){
+    uint8_t frame[HCI_ACL_PAYLOAD_SIZE];
+    little_endian_store_16(frame, 0, 2 + len + 2);
+    little_endian_store_16(frame, 2, local_cid);
+    little_endian_store_16(frame, 4, control);
+    memcpy(&frame[6], payload, len);
+    uint16_t fcs = crc16(frame, 6 + len);
+    if (corrupt_fcs){
+        fcs ^= 0x0001;
+    }
+    little_endian_store_16(frame, 6 + len, fcs);
+    mock_l2cap_packet(local_cid, &frame[4], 2 + len + 2);
+}
+
+static void mock_i_frame(uint8_t tx_seq, uint8_t req_seq, uint8_t sar, const uint8_t * payload, uint16_t len){
+    mock_frame((sar << 14) | (req_seq << 8) | (tx_seq << 1), payload, len, 0);
+}
+
+static void mock_s_frame(uint8_t function, uint8_t req_seq, int poll, int final){
+    mock_frame((req_seq << 8) | (final << 7) | (poll << 4) | (function << 2) | 1, NULL, 0, 0);
+}
+
+static uint16_t frame_control(int index){
+    return little_endian_read_16(sent_frames[index], 4);
+}
+static int frame_is_s_frame(int index, uint8_t function){
+    uint16_t control = frame_control(index);
+    return (control & 1) && ((control >> 2) & 3) == function;
+}
+static int frame_is_i_frame(int index){
+    return (frame_control(index) & 1) == 0;
+}
+static uint8_t frame_tx_seq(int index){
+    return (frame_control(index) >> 1) & 0x3f;
+}
+static uint8_t frame_req_seq(int index){
+    return (frame_control(index) >> 8) & 0x3f;
+}
+static uint8_t frame_sar(int index){
+    return frame_control(index) >> 14;
+}
+static int frame_poll(int index){
+    return (frame_control(index) >> 4) & 1;
+}
+static int frame_fcs_valid(int index){
+    uint16_t len = sent_frame_lens[index];
+    return crc16(sent_frames[index], len - 2) == little_endian_read_16(sent_frames[index], len - 2);
+}
+static const uint8_t * frame_payload(int index){
+    return &sent_frames[index][6];
+}
+static uint16_t frame_payload_len(int index){
+    return sent_frame_lens[index] - 8;
+}
+
+static const uint8_t * signaling_sent(uint8_t code){
+    int i;
+    for (i = sent_signaling_count - 1; i >= 0; i--){
+        if (sent_signaling[i][0] == code) return sent_signaling[i];
+    }
+    return NULL;
+}
+
+// find Retransmission and Flow Control option in Configure Request or Response
+static const uint8_t * config_option_mode(const uint8_t * command, int options_offset){
+    uint16_t end_pos = 4 + little_endian_read_16(command, 2);
+    uint16_t pos = options_offset;
+    while (pos < end_pos){
+        if ((command[pos] & 0x7f) == 4) return &command[pos + 2];
+        pos += 2 + command[pos + 1];
+    }
+    return NULL;
+}
+
+static void mock_connection_request(void){
+    mock_classic_connection();
+    uint8_t data[4];
+    little_endian_store_16(data, 0, TEST_PSM);
+    little_endian_store_16(data, 2, REMOTE_CID);
+    mock_signaling(CONNECTION_REQUEST, ++remote_sig_id, data, sizeof(data));
+}
+
+// answer Configure Request sent by host
+static void mock_configure_response(uint16_t result, uint8_t mode){
+    uint8_t data[6 + 11];
+    little_endian_store_16(data, 0, local_cid);
+    little_endian_store_16(data, 2, 0);
+    little_endian_store_16(data, 4, result);
+    memset(&data[6], 0, 11);
+    data[6] = 4;
+    data[7] = 9;
+    data[8] = mode;
+    little_endian_store_16(data, 11, RETRANSMISSION_TIMEOUT_MS);
+    little_endian_store_16(data, 13, MONITOR_TIMEOUT_MS);
+    little_endian_store_16(data, 15, 20);
+    const uint8_t * request = signaling_sent(CONFIGURE_REQUEST);
+    CHECK(request != NULL);
+    mock_signaling(CONFIGURE_RESPONSE, request[1], data, sizeof(data));
+}
+
+// remote Configure Request with MTU option, without Retransmission and Flow Control option if mode is Basic
+static void mock_configure_request(uint8_t mode, uint8_t tx_window, uint8_t max_transmit, uint16_t mps){
+    uint8_t data[4 + 4 + 11];
+    little_endian_store_16(data, 0, local_cid);
+    little_endian_store_16(data, 2, 0);
+    data[4] = 1;
+    data[5] = 2;
+    little_endian_store_16(data, 6, 100);
+    int len = 8;
+    if (mode != L2CAP_CHANNEL_MODE_BASIC){
+        memset(&data[8], 0, 11);
+        data[8]  = 4;
+        data[9]  = 9;
+        data[10] = mode;
+        data[11] = tx_window;
+        data[12] = max_transmit;
+        little_endian_store_16(data, 17, mps);
+        len += 11;
+    }
+    mock_signaling(CONFIGURE_REQUEST, ++remote_sig_id, data, len);
+}
+
+static void open_channel(uint8_t mode, uint8_t tx_window, uint8_t max_transmit, uint16_t mps){
+    mock_connection_request();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, accept_status);
+    mock_configure_response(0, mode);
+    mock_configure_request(mode, tx_window, max_transmit, mps);
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(0, channel_opened_status);
+    sent_frame_count = 0;
+}
+
+static void send_sdu(uint8_t value, uint16_t len){
+    uint8_t sdu[100];
+    memset(sdu, value, len);
+    CHECK_EQUAL(0, l2cap_send(local_cid, sdu, len));
+    mock_process();
+}
+
+TEST_GROUP(L2CAPEnhancedRetransmissionMode){
+    void setup(void){
+        test_timers = NULL;
+        test_time_ms = 0;
+        mock_queue_count = 0;
+        sent_frame_count = 0;
+        sent_signaling_count = 0;
+        remote_sig_id = 0;
+        local_cid = 0;
+        accept_status = 0xff;
+        channel_opened = 0;
+        channel_opened_status = 0xff;
+        channel_closed = 0;
+        can_send_now_events = 0;
+        received_sdu_count = 0;
+
+        memset(&ertm_config, 0, sizeof(ertm_config));
+        ertm_config.mode = L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION;
+        ertm_config.max_transmit = 3;
+        ertm_config.retransmission_timeout_ms = RETRANSMISSION_TIMEOUT_MS;
+        ertm_config.monitor_timeout_ms = MONITOR_TIMEOUT_MS;
+        ertm_config.local_mtu = 100;
+        ertm_config.num_tx_buffers = 4;
+
+        btstack_memory_init();
+        hci_init(&mock_transport, NULL);
+        l2cap_init();
+        l2cap_register_service(&channel_handler, TEST_PSM, 100, LEVEL_0);
+        hci_power_control(HCI_POWER_ON);
+        mock_process();
+    }
+    void teardown(void){
+        l2cap_unregister_service(TEST_PSM);
+        hci_close();
+    }
+};
+
+TEST(L2CAPEnhancedRetransmissionMode, ConfigurationOptions){
+    mock_connection_request();
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, accept_status);
+    const uint8_t * request = signaling_sent(CONFIGURE_REQUEST);
+    CHECK(request != NULL);
+    const uint8_t * option = config_option_mode(request, 8);
+    CHECK(option != NULL);
+    CHECK_EQUAL(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, option[0]);
+    CHECK_EQUAL(3, option[2]);
+
+    // remote tx window is limited to 63
+    mock_configure_response(0, L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION);
+    mock_configure_request(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 200, 3, 20);
+    const uint8_t * response = signaling_sent(CONFIGURE_RESPONSE);
+    CHECK(response != NULL);
+    CHECK_EQUAL(0, little_endian_read_16(response, 8));
+    option = config_option_mode(response, 10);
+    CHECK(option != NULL);
+    CHECK_EQUAL(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, option[0]);
+    CHECK_EQUAL(63, option[1]);
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(0, channel_opened_status);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, NumTxBuffersLimitedBySequenceNumbers){
+    ertm_config.num_tx_buffers = 64;
+    mock_connection_request();
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, accept_status);
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_accept_ertm_connection(local_cid, &ertm_config, ertm_buffer, sizeof(ertm_buffer)));
+    ertm_config.num_tx_buffers = 0;
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, l2cap_accept_ertm_connection(local_cid, &ertm_config, ertm_buffer, sizeof(ertm_buffer)));
+    ertm_config.num_tx_buffers = 63;
+    CHECK_EQUAL(ERROR_CODE_SUCCESS, l2cap_accept_ertm_connection(local_cid, &ertm_config, ertm_buffer, sizeof(ertm_buffer)));
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, SegmentationOfOutgoingSdu){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    uint8_t sdu[50];
+    int i;
+    for (i = 0; i < 50; i++){
+        sdu[i] = i;
+    }
+    CHECK_EQUAL(0, l2cap_send(local_cid, sdu, sizeof(sdu)));
+    mock_process();
+
+    // start segment with SDU length, payload limited by remote MPS
+    CHECK_EQUAL(3, sent_frame_count);
+    for (i = 0; i < 3; i++){
+        CHECK(frame_is_i_frame(i));
+        CHECK_EQUAL(i, frame_tx_seq(i));
+        CHECK(frame_fcs_valid(i));
+    }
+    CHECK_EQUAL(SAR_START, frame_sar(0));
+    CHECK_EQUAL(SAR_CONTINUATION, frame_sar(1));
+    CHECK_EQUAL(SAR_END, frame_sar(2));
+    CHECK_EQUAL(20, frame_payload_len(0));
+    CHECK_EQUAL(50, little_endian_read_16(frame_payload(0), 0));
+    CHECK_EQUAL(20, frame_payload_len(1));
+    CHECK_EQUAL(12, frame_payload_len(2));
+    uint8_t reassembled[50];
+    memcpy(&reassembled[0],  &frame_payload(0)[2], 18);
+    memcpy(&reassembled[18], frame_payload(1), 20);
+    memcpy(&reassembled[38], frame_payload(2), 12);
+    MEMCMP_EQUAL(sdu, reassembled, sizeof(sdu));
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, ReassemblyOfIncomingSdu){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    uint8_t sdu[30];
+    int i;
+    for (i = 0; i < 30; i++){
+        sdu[i] = 0x80 + i;
+    }
+    uint8_t start[12];
+    little_endian_store_16(start, 0, sizeof(sdu));
+    memcpy(&start[2], &sdu[0], 10);
+    mock_i_frame(0, 0, SAR_START, start, sizeof(start));
+    mock_i_frame(1, 0, SAR_CONTINUATION, &sdu[10], 10);
+    CHECK_EQUAL(0, received_sdu_count);
+    mock_i_frame(2, 0, SAR_END, &sdu[20], 10);
+    CHECK_EQUAL(1, received_sdu_count);
+    CHECK_EQUAL(sizeof(sdu), received_sdu_lens[0]);
+    MEMCMP_EQUAL(sdu, received_sdus[0], sizeof(sdu));
+
+    // received I-frames are acknowledged
+    CHECK(sent_frame_count > 0);
+    int last = sent_frame_count - 1;
+    CHECK(frame_is_s_frame(last, S_RR));
+    CHECK_EQUAL(3, frame_req_seq(last));
+    CHECK(frame_fcs_valid(last));
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, InvalidFcsDroppedAndRejected){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    uint8_t data[] = { 1, 2, 3 };
+    mock_frame(0 << 1, data, sizeof(data), 1);
+    CHECK_EQUAL(0, received_sdu_count);
+    CHECK_EQUAL(0, sent_frame_count);
+
+    // next I-frame reveals missing I-frame 0
+    mock_i_frame(1, 0, SAR_UNSEGMENTED, data, sizeof(data));
+    CHECK_EQUAL(0, received_sdu_count);
+    CHECK_EQUAL(1, sent_frame_count);
+    CHECK(frame_is_s_frame(0, S_REJ));
+    CHECK_EQUAL(0, frame_req_seq(0));
+
+    // go-back-n: both I-frames are received again
+    mock_i_frame(0, 0, SAR_UNSEGMENTED, data, sizeof(data));
+    mock_i_frame(1, 0, SAR_UNSEGMENTED, data, sizeof(data));
+    CHECK_EQUAL(2, received_sdu_count);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, RejectRetransmitsUnacknowledgedFrames){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    send_sdu(0, 10);
+    send_sdu(1, 10);
+    send_sdu(2, 10);
+    CHECK_EQUAL(3, sent_frame_count);
+
+    // I-frame 0 acknowledged, 1 and 2 are sent again
+    sent_frame_count = 0;
+    mock_s_frame(S_REJ, 1, 0, 0);
+    CHECK_EQUAL(2, sent_frame_count);
+    CHECK(frame_is_i_frame(0));
+    CHECK_EQUAL(1, frame_tx_seq(0));
+    CHECK_EQUAL(1, frame_payload(0)[0]);
+    CHECK(frame_is_i_frame(1));
+    CHECK_EQUAL(2, frame_tx_seq(1));
+    CHECK_EQUAL(2, frame_payload(1)[0]);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, SelectiveRejectRetransmitsSingleFrame){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    send_sdu(0, 10);
+    send_sdu(1, 10);
+    send_sdu(2, 10);
+    CHECK_EQUAL(3, sent_frame_count);
+
+    sent_frame_count = 0;
+    mock_s_frame(S_SREJ, 1, 0, 0);
+    CHECK_EQUAL(1, sent_frame_count);
+    CHECK(frame_is_i_frame(0));
+    CHECK_EQUAL(1, frame_tx_seq(0));
+    CHECK_EQUAL(1, frame_payload(0)[0]);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, RemoteTxWindow){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 2, 3, 20);
+    send_sdu(0, 10);
+    send_sdu(1, 10);
+    send_sdu(2, 10);
+    CHECK_EQUAL(2, sent_frame_count);
+
+    // acknowledgement opens window
+    mock_s_frame(S_RR, 1, 0, 0);
+    CHECK_EQUAL(3, sent_frame_count);
+    CHECK_EQUAL(2, frame_tx_seq(2));
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, RetransmissionTimerPollsRemote){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 3, 20);
+    send_sdu(0, 10);
+    CHECK_EQUAL(1, sent_frame_count);
+
+    test_run_loop_advance(RETRANSMISSION_TIMEOUT_MS - 1);
+    CHECK_EQUAL(1, sent_frame_count);
+    test_run_loop_advance(1);
+    mock_process();
+    CHECK_EQUAL(2, sent_frame_count);
+    CHECK(frame_is_s_frame(1, S_RR));
+    CHECK_EQUAL(1, frame_poll(1));
+
+    // response to poll without acknowledgement: I-frame is sent again
+    mock_s_frame(S_RR, 0, 0, 1);
+    CHECK_EQUAL(3, sent_frame_count);
+    CHECK(frame_is_i_frame(2));
+    CHECK_EQUAL(0, frame_tx_seq(2));
+
+    // acknowledged, no further retransmission
+    mock_s_frame(S_RR, 1, 0, 0);
+    test_run_loop_advance(MONITOR_TIMEOUT_MS * 4);
+    mock_process();
+    CHECK_EQUAL(3, sent_frame_count);
+    CHECK_EQUAL(0, channel_closed);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, MonitorTimerDisconnectsAfterMaxTransmit){
+    open_channel(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, 8, 2, 20);
+    send_sdu(0, 10);
+
+    // retransmission timeout: first poll
+    test_run_loop_advance(RETRANSMISSION_TIMEOUT_MS);
+    mock_process();
+    CHECK(frame_is_s_frame(sent_frame_count - 1, S_RR));
+    CHECK_EQUAL(1, frame_poll(sent_frame_count - 1));
+
+    // monitor timeout: poll again
+    test_run_loop_advance(MONITOR_TIMEOUT_MS);
+    mock_process();
+    CHECK_EQUAL(3, sent_frame_count);
+    CHECK_EQUAL(1, frame_poll(2));
+    CHECK(signaling_sent(DISCONNECTION_REQUEST) == NULL);
+
+    // no response to max transmit polls: disconnect
+    test_run_loop_advance(MONITOR_TIMEOUT_MS);
+    mock_process();
+    CHECK_EQUAL(3, sent_frame_count);
+    CHECK(signaling_sent(DISCONNECTION_REQUEST) != NULL);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, FallbackToBasicMode){
+    mock_connection_request();
+    mock_configure_response(0, L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION);
+    mock_configure_request(L2CAP_CHANNEL_MODE_BASIC, 0, 0, 0);
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(0, channel_opened_status);
+
+    // Basic mode frame: no control field, no FCS
+    sent_frame_count = 0;
+    send_sdu(0x55, 10);
+    CHECK_EQUAL(1, sent_frame_count);
+    CHECK_EQUAL(4 + 10, sent_frame_lens[0]);
+    CHECK_EQUAL(10, little_endian_read_16(sent_frames[0], 0));
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, FallbackRequestedInConfigureResponse){
+    mock_connection_request();
+    int num_signaling = sent_signaling_count;
+    mock_configure_response(L2CAP_CONF_RESULT_UNACCEPTABLE_PARAMETERS, L2CAP_CHANNEL_MODE_BASIC);
+
+    // new Configure Request without Retransmission and Flow Control option
+    CHECK(sent_signaling_count > num_signaling);
+    const uint8_t * request = signaling_sent(CONFIGURE_REQUEST);
+    CHECK(request != NULL);
+    CHECK(config_option_mode(request, 8) == NULL);
+    mock_configure_response(0, L2CAP_CHANNEL_MODE_BASIC);
+    mock_configure_request(L2CAP_CHANNEL_MODE_BASIC, 0, 0, 0);
+    CHECK_EQUAL(1, channel_opened);
+    CHECK_EQUAL(0, channel_opened_status);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, MandatoryModeNotFallingBack){
+    ertm_config.mode_mandatory = 1;
+    mock_connection_request();
+    mock_configure_response(0, L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION);
+    mock_configure_request(L2CAP_CHANNEL_MODE_BASIC, 0, 0, 0);
+    const uint8_t * response = signaling_sent(CONFIGURE_RESPONSE);
+    CHECK(response != NULL);
+    CHECK_EQUAL(L2CAP_CONF_RESULT_UNACCEPTABLE_PARAMETERS, little_endian_read_16(response, 8));
+    const uint8_t * option = config_option_mode(response, 10);
+    CHECK(option != NULL);
+    CHECK_EQUAL(L2CAP_CHANNEL_MODE_ENHANCED_RETRANSMISSION, option[0]);
+    CHECK_EQUAL(0, channel_opened);
+}
+
+TEST(L2CAPEnhancedRetransmissionMode, StreamingMode){
+    ertm_config.mode = L2CAP_CHANNEL_MODE_STREAMING_MODE;
+    open_channel(L2CAP_CHANNEL_MODE_STREAMING_MODE, 0, 0, 20);
+
+    // I-frames are released once sent, more SDUs than tx buffers can be sent
+    int i;
+    for (i = 0; i < 6; i++){
+        CHECK(l2cap_can_send_packet_now(local_cid));
+        send_sdu(i, 10);
+    }
+    CHECK_EQUAL(6, sent_frame_count);
+    CHECK_EQUAL(5, frame_tx_seq(5));
+    CHECK_EQUAL(0, frame_req_seq(5));
+    test_run_loop_advance(RETRANSMISSION_TIMEOUT_MS * 4);
+    mock_process();
+    CHECK_EQUAL(6, sent_frame_count);
+
+    // lost I-frame drops partial SDU
+    uint8_t start[12];
+    little_endian_store_16(start, 0, 20);
+    memset(&start[2], 1, 10);
+    uint8_t data[10];
+    memset(data, 2, sizeof(data));
+    mock_i_frame(0, 0, SAR_START, start, sizeof(start));
+    mock_i_frame(2, 0, SAR_END, data, sizeof(data));
+    CHECK_EQUAL(0, received_sdu_count);
+    mock_i_frame(3, 0, SAR_UNSEGMENTED, data, sizeof(data));
+    CHECK_EQUAL(1, received_sdu_count);
+    CHECK_EQUAL(sizeof(data), received_sdu_lens[0]);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(&test_run_loop);
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,286 @@
+// Replay benchmark for LE Scan Engine
+//
+// Replays LE Advertising Report events from a PacketLogger file (e.g. /tmp/hci_dump.pklg
+// recorded by the posix ports) or from a synthetic dense environment, once with
+// the regular per-report GAP_EVENT_ADVERTISING_REPORT delivery and once with the LE Scan Engine.
+//
+// Usage: le_scan_engine_benchmark [-w recording.pklg] [recording.pklg]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ad_parser.h"
+#include "ble/le_scan_engine.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "hci_dump.h"
+
+#define NUM_HANDLERS          3
+#define SYNTHETIC_ADVERTISERS 2000
+#define SYNTHETIC_DURATION_MS 10000
+#define ADVERTISING_INTERVAL_MS 100
+
+typedef struct {
+    uint32_t timestamp_ms;
+    uint8_t  size;
+    uint8_t  packet[3 + 12 + 31];
+} recorded_event_t;
+
+static recorded_event_t * events;
+static int num_events;
+static int max_events;
+
+static uint32_t time_ms;
+static btstack_timer_source_t * active_timer;
+
+static int num_dispatched;
+static int num_matches;
+
+// btstack_run_loop.h
+uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = time_ms + timeout_in_ms;
+}
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *)){
+    ts->process = process;
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
+    active_timer = ts;
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
+    if (active_timer != ts) return 0;
+    active_timer = NULL;
+    return 1;
+}
+// btstack_debug.h
+void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+static recorded_event_t * add_event(void){
+    if (num_events == max_events){
+        max_events = max_events ? max_events * 2 : 1024;
+        events = (recorded_event_t *) realloc(events, max_events * sizeof(recorded_event_t));
+    }
+    return &events[num_events++];
+}
+
+static uint32_t read_net_32(FILE * file){
+    uint8_t buffer[4];
+    if (fread(buffer, 1, 4, file) != 4) return 0;
+    return big_endian_read_32(buffer, 0);
+}
+
+static int load_pklg(const char * path){
+    FILE * file = fopen(path, "rb");
+    if (!file) return 0;
+    uint8_t packet[1024];
+    while (1){
+        uint32_t len     = read_net_32(file);
+        uint32_t ts_sec  = read_net_32(file);
+        uint32_t ts_usec = read_net_32(file);
+        int type = fgetc(file);
+        if (len < 9 || type < 0) break;
+        uint32_t packet_len = len - 9;
+        if (packet_len > sizeof(packet)) break;
+        if (fread(packet, 1, packet_len, file) != packet_len) break;
+        // single report LE Advertising Report events only
+        if (type != 0x01 || packet_len < 14 || packet[0] != HCI_EVENT_LE_META || packet[2] != HCI_SUBEVENT_LE_ADVERTISING_REPORT) continue;
+        if (packet[3] != 1 || packet_len > sizeof(events[0].packet)) continue;
+        recorded_event_t * event = add_event();
+        event->timestamp_ms = ts_sec * 1000 + ts_usec / 1000;
+        event->size = packet_len;
+        memcpy(event->packet, packet, packet_len);
+    }
+    fclose(file);
+    return num_events;
+}
+
+static void write_pklg(const char * path){
+    FILE * file = fopen(path, "wb");
+    if (!file) return;
+    int i;
+    for (i = 0; i < num_events; i++){
+        uint8_t header[13];
+        big_endian_store_32(header, 0, 9 + events[i].size);
+        big_endian_store_32(header, 4, events[i].timestamp_ms / 1000);
+        big_endian_store_32(header, 8, (events[i].timestamp_ms % 1000) * 1000);
+        header[12] = 0x01;
+        fwrite(header, 1, sizeof(header), file);
+        fwrite(events[i].packet, 1, events[i].size, file);
+    }
+    fclose(file);
+}
+
+// every 10th advertiser is a heart rate sensor, others are beacons with changing payload
+static void synthesize(void){
+    uint32_t t;
+    srand(1);
+    for (t = 0; t < SYNTHETIC_DURATION_MS; t++){
+        int advertiser;
+        for (advertiser = t % ADVERTISING_INTERVAL_MS; advertiser < SYNTHETIC_ADVERTISERS; advertiser += ADVERTISING_INTERVAL_MS){
+            recorded_event_t * event = add_event();
+            uint8_t * packet = event->packet;
+            int pos = 0;
+            event->timestamp_ms = t;
+            packet[pos++] = HCI_EVENT_LE_META;
+            pos++;
+            packet[pos++] = HCI_SUBEVENT_LE_ADVERTISING_REPORT;
+            packet[pos++] = 1;
+            packet[pos++] = 0;  // ADV_IND
+            packet[pos++] = 1;  // random address
+            little_endian_store_16(packet, pos, advertiser);
+            memset(&packet[pos+2], 0xc0, 4);
+            pos += 6;
+            if (advertiser % 10 == 0){
+                static const uint8_t adv_heart_rate[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0x0d, 0x18 };
+                packet[pos++] = sizeof(adv_heart_rate);
+                memcpy(&packet[pos], adv_heart_rate, sizeof(adv_heart_rate));
+                pos += sizeof(adv_heart_rate);
+            } else {
+                // iBeacon like, payload changes every second
+                static const uint8_t adv_beacon[] = { 0x02, 0x01, 0x06, 0x1a, 0xff, 0x4c, 0x00, 0x02, 0x15 };
+                packet[pos++] = 30;
+                memcpy(&packet[pos], adv_beacon, sizeof(adv_beacon));
+                memset(&packet[pos + sizeof(adv_beacon)], advertiser, 30 - sizeof(adv_beacon));
+                packet[pos + 29] = t / 1000;
+                pos += 30;
+            }
+            packet[pos++] = (uint8_t) (-40 - (rand() % 50));
+            packet[1] = pos - 2;
+            event->size = pos;
+        }
+    }
+}
+
+// typical application handler: check for service of interest
+static void app_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) packet_type;
+    (void) channel;
+    (void) size;
+    num_dispatched++;
+    if (packet[0] == GAP_EVENT_ADVERTISING_REPORT){
+        if (ad_data_contains_uuid16(packet[11], &packet[12], 0x180d)){
+            num_matches++;
+        }
+        return;
+    }
+    le_scan_report_iterator_t it;
+    for (le_scan_report_iterator_init(&it, packet); le_scan_report_iterator_has_more(&it); le_scan_report_iterator_next(&it)){
+        num_matches++;
+    }
+}
+
+// same as le_handle_advertisement_report in hci.c with hci_emit_event to NUM_HANDLERS
+static void baseline_handle_report(uint8_t * packet){
+    uint8_t event[12 + 31];
+    int offset = 4;
+    uint8_t data_length = packet[offset + 8];
+    int pos = 0;
+    event[pos++] = GAP_EVENT_ADVERTISING_REPORT;
+    event[pos++] = 10 + data_length;
+    memcpy(&event[pos], &packet[offset], 1+1+6);
+    offset += 8;
+    pos += 8;
+    event[pos++] = packet[offset + 1 + data_length];
+    event[pos++] = packet[offset++];
+    memcpy(&event[pos], &packet[offset], data_length);
+    pos += data_length;
+    int i;
+    for (i = 0; i < NUM_HANDLERS; i++){
+        app_handler(HCI_EVENT_PACKET, 0, event, pos);
+    }
+}
+
+static void engine_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    int i;
+    for (i = 0; i < NUM_HANDLERS; i++){
+        app_handler(packet_type, channel, packet, size);
+    }
+}
+
+static void engine_handle_report(uint8_t * packet){
+    int offset = 4;
+    uint8_t data_length = packet[offset + 8];
+    le_scan_engine_handle_advertising_report(packet[offset], packet[offset+1], &packet[offset+2],
+        (int8_t) packet[offset + 9 + data_length], data_length, &packet[offset + 9]);
+}
+
+static double now_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double replay(void (*handle_report)(uint8_t * packet)){
+    num_dispatched = 0;
+    num_matches = 0;
+    double start = now_seconds();
+    int i;
+    for (i = 0; i < num_events; i++){
+        time_ms = events[i].timestamp_ms;
+        if (active_timer && (int32_t)(time_ms - active_timer->timeout) >= 0){
+            btstack_timer_source_t * timer = active_timer;
+            active_timer = NULL;
+            timer->process(timer);
+        }
+        (*handle_report)(events[i].packet);
+    }
+    le_scan_engine_flush();
+    return now_seconds() - start;
+}
+
+int main(int argc, const char * argv[]){
+    const char * output = NULL;
+    const char * input  = NULL;
+    int i;
+    for (i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc){
+            output = argv[++i];
+        } else {
+            input = argv[i];
+        }
+    }
+
+    if (input){
+        if (!load_pklg(input)){
+            printf("No LE Advertising Reports in %s\n", input);
+            return 1;
+        }
+    } else {
+        synthesize();
+    }
+    if (output){
+        write_pklg(output);
+    }
+
+    printf("Replaying %u advertising reports\n", num_events);
+
+    double baseline_time = replay(&baseline_handle_report);
+    printf("Baseline:   %8u handler calls, %6u matches, %6.1f ns per report\n",
+        num_dispatched, num_matches, baseline_time * 1e9 / num_events);
+
+    static le_scan_filter_t filter;
+    le_scan_engine_init();
+    le_scan_engine_register_packet_handler(&engine_handler);
+    le_scan_engine_add_uuid16_filter(&filter, 0x180d);
+    le_scan_engine_set_duplicate_window(1000);
+    le_scan_engine_set_batch_parameters(8, 100);
+    le_scan_engine_enable(1);
+    double engine_time = replay(&engine_handle_report);
+    le_scan_engine_statistics_t statistics;
+    le_scan_engine_get_statistics(&statistics);
+    printf("Scan Engine: %7u handler calls, %6u matches, %6.1f ns per report\n",
+        num_dispatched, num_matches, engine_time * 1e9 / num_events);
+    printf("Scan Engine: %u received, %u filtered, %u suppressed, %u delivered in %u events\n",
+        statistics.num_reports_received, statistics.num_reports_filtered, statistics.num_reports_suppressed,
+        statistics.num_reports_delivered, statistics.num_events_emitted);
+    free(events);
+    return 0;
+}
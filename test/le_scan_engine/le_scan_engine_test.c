@@ -0,0 +1,249 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <string.h>
+
+#include "ble/le_scan_engine.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "bluetooth_data_types.h"
+
+static uint32_t time_ms;
+static btstack_timer_source_t * active_timer;
+
+// btstack_run_loop.h
+extern "C" uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+extern "C" void btstack_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    ts->timeout = time_ms + timeout_in_ms;
+}
+extern "C" void btstack_run_loop_set_timer_handler(btstack_timer_source_t * ts, void (*process)(btstack_timer_source_t *)){
+    ts->process = process;
+}
+extern "C" void btstack_run_loop_add_timer(btstack_timer_source_t * ts){
+    active_timer = ts;
+}
+extern "C" int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
+    if (active_timer != ts) return 0;
+    active_timer = NULL;
+    return 1;
+}
+// btstack_debug.h
+extern "C" void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+#define MAX_REPORTS 64
+
+typedef struct {
+    bd_addr_t address;
+    int8_t    rssi;
+    uint8_t   num_aggregated;
+    uint8_t   data_length;
+    uint8_t   data[31];
+} report_t;
+
+static int      num_events;
+static int      num_reports;
+static report_t reports[MAX_REPORTS];
+
+static void packet_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) channel;
+    CHECK_EQUAL(HCI_EVENT_PACKET, packet_type);
+    CHECK_EQUAL(GAP_EVENT_ADVERTISING_REPORT_BATCH, packet[0]);
+    CHECK_EQUAL(size - 2, packet[1]);
+    num_events++;
+    le_scan_report_iterator_t it;
+    for (le_scan_report_iterator_init(&it, packet); le_scan_report_iterator_has_more(&it); le_scan_report_iterator_next(&it)){
+        if (num_reports == MAX_REPORTS) continue;
+        report_t * report = &reports[num_reports++];
+        le_scan_report_iterator_get_address(&it, report->address);
+        report->rssi = le_scan_report_iterator_get_rssi(&it);
+        report->num_aggregated = le_scan_report_iterator_get_num_aggregated(&it);
+        report->data_length = le_scan_report_iterator_get_data_length(&it);
+        memcpy(report->data, le_scan_report_iterator_get_data(&it), report->data_length);
+    }
+}
+
+// address in HCI little endian order
+static const uint8_t address_a[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+static const uint8_t address_b[] = { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16 };
+
+// flags, 16-bit service uuid 0x180d
+static const uint8_t adv_heart_rate[] = { 0x02, 0x01, 0x06, 0x03, 0x03, 0x0d, 0x18 };
+// flags, manufacturer data for company 0x004c
+static const uint8_t adv_manufacturer[] = { 0x02, 0x01, 0x06, 0x05, 0xff, 0x4c, 0x00, 0x02, 0x15 };
+// length of second AD structure exceeds data
+static const uint8_t adv_malformed[] = { 0x02, 0x01, 0x06, 0x09, 0xff, 0x4c, 0x00 };
+
+static void report(const uint8_t * address, int8_t rssi, const uint8_t * data, uint8_t data_length){
+    le_scan_engine_handle_advertising_report(0, 0, address, rssi, data_length, data);
+}
+
+TEST_GROUP(LEScanEngine){
+    void setup(void){
+        time_ms = 1000;
+        active_timer = NULL;
+        num_events = 0;
+        num_reports = 0;
+        le_scan_engine_init();
+        le_scan_engine_register_packet_handler(&packet_handler);
+        le_scan_engine_enable(1);
+    }
+};
+
+TEST(LEScanEngine, Passthrough){
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_a, -42, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(2, num_events);
+    CHECK_EQUAL(2, num_reports);
+    bd_addr_t expected = { 0x06, 0x05, 0x04, 0x03, 0x02, 0x01 };
+    CHECK_EQUAL(0, bd_addr_cmp(expected, reports[0].address));
+    CHECK_EQUAL(-40, reports[0].rssi);
+    CHECK_EQUAL(1, reports[0].num_aggregated);
+    CHECK_EQUAL(sizeof(adv_heart_rate), reports[0].data_length);
+    MEMCMP_EQUAL(adv_heart_rate, reports[0].data, sizeof(adv_heart_rate));
+}
+
+TEST(LEScanEngine, DuplicatesAggregated){
+    le_scan_engine_set_duplicate_window(1000);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    time_ms += 100;
+    report(address_a, -50, adv_heart_rate, sizeof(adv_heart_rate));
+    time_ms += 100;
+    report(address_a, -60, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(1, num_reports);
+    time_ms += 1000;
+    report(address_a, -70, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(2, num_reports);
+    CHECK_EQUAL(3, reports[1].num_aggregated);
+    CHECK_EQUAL(-60, reports[1].rssi);
+    le_scan_engine_statistics_t statistics;
+    le_scan_engine_get_statistics(&statistics);
+    CHECK_EQUAL(4, statistics.num_reports_received);
+    CHECK_EQUAL(2, statistics.num_reports_suppressed);
+    CHECK_EQUAL(2, statistics.num_reports_delivered);
+}
+
+TEST(LEScanEngine, DuplicateKeyIncludesPayload){
+    le_scan_engine_set_duplicate_window(1000);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_a, -40, adv_manufacturer, sizeof(adv_manufacturer));
+    report(address_b, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(3, num_reports);
+}
+
+TEST(LEScanEngine, ManyAdvertisers){
+    le_scan_engine_set_duplicate_window(1000);
+    uint8_t address[6] = { 0 };
+    int i;
+    for (i = 0; i < 4 * LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE; i++){
+        little_endian_store_16(address, 0, i);
+        report(address, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    }
+    le_scan_engine_statistics_t statistics;
+    le_scan_engine_get_statistics(&statistics);
+    CHECK_EQUAL(4 * LE_SCAN_ENGINE_DUPLICATE_TABLE_SIZE, statistics.num_reports_delivered);
+    // most recent advertiser is still known
+    report(address, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    le_scan_engine_get_statistics(&statistics);
+    CHECK_EQUAL(1, statistics.num_reports_suppressed);
+}
+
+TEST(LEScanEngine, Uuid16Filter){
+    le_scan_filter_t filter;
+    le_scan_engine_add_uuid16_filter(&filter, 0x180d);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_a, -40, adv_manufacturer, sizeof(adv_manufacturer));
+    CHECK_EQUAL(1, num_reports);
+    MEMCMP_EQUAL(adv_heart_rate, reports[0].data, sizeof(adv_heart_rate));
+    le_scan_engine_remove_filter(&filter);
+    report(address_a, -40, adv_manufacturer, sizeof(adv_manufacturer));
+    CHECK_EQUAL(2, num_reports);
+}
+
+TEST(LEScanEngine, ManufacturerFilter){
+    le_scan_filter_t filter_a;
+    le_scan_filter_t filter_b;
+    le_scan_engine_add_manufacturer_filter(&filter_a, 0x0001);
+    le_scan_engine_add_manufacturer_filter(&filter_b, 0x004c);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_a, -40, adv_manufacturer, sizeof(adv_manufacturer));
+    report(address_a, -40, adv_malformed, sizeof(adv_malformed));
+    CHECK_EQUAL(1, num_reports);
+    MEMCMP_EQUAL(adv_manufacturer, reports[0].data, sizeof(adv_manufacturer));
+}
+
+TEST(LEScanEngine, AddressFilter){
+    le_scan_filter_t filter;
+    bd_addr_t address = { 0x16, 0x15, 0x14, 0x13, 0x12, 0x11 };
+    le_scan_engine_add_address_filter(&filter, address);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_b, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(1, num_reports);
+    CHECK_EQUAL(0, bd_addr_cmp(address, reports[0].address));
+}
+
+TEST(LEScanEngine, RssiThreshold){
+    le_scan_engine_set_rssi_threshold(-70);
+    report(address_a, -80, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_a, -60, adv_heart_rate, sizeof(adv_heart_rate));
+    // not available
+    report(address_a, 127, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(2, num_reports);
+}
+
+TEST(LEScanEngine, BatchByCount){
+    le_scan_engine_set_batch_parameters(3, 100);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    report(address_b, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(0, num_events);
+    CHECK(active_timer != NULL);
+    report(address_a, -40, adv_manufacturer, sizeof(adv_manufacturer));
+    CHECK_EQUAL(1, num_events);
+    CHECK_EQUAL(3, num_reports);
+    CHECK(active_timer == NULL);
+    MEMCMP_EQUAL(adv_manufacturer, reports[2].data, sizeof(adv_manufacturer));
+}
+
+TEST(LEScanEngine, BatchByTimeout){
+    le_scan_engine_set_batch_parameters(10, 100);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    CHECK_EQUAL(0, num_events);
+    CHECK(active_timer != NULL);
+    btstack_timer_source_t * timer = active_timer;
+    active_timer = NULL;
+    timer->process(timer);
+    CHECK_EQUAL(1, num_events);
+    CHECK_EQUAL(1, num_reports);
+}
+
+TEST(LEScanEngine, BatchBySize){
+    uint8_t data[31];
+    memset(data, 0, sizeof(data));
+    le_scan_engine_set_batch_parameters(20, 100);
+    int i;
+    // 42 bytes per report, 6 fit into one event
+    for (i = 0; i < 7; i++){
+        report(address_a, -40, data, sizeof(data));
+    }
+    CHECK_EQUAL(1, num_events);
+    CHECK_EQUAL(6, num_reports);
+    le_scan_engine_flush();
+    CHECK_EQUAL(2, num_events);
+    CHECK_EQUAL(7, num_reports);
+}
+
+TEST(LEScanEngine, DisableFlushes){
+    le_scan_engine_set_batch_parameters(10, 100);
+    report(address_a, -40, adv_heart_rate, sizeof(adv_heart_rate));
+    le_scan_engine_enable(0);
+    CHECK_EQUAL(1, num_events);
+    CHECK_EQUAL(0, le_scan_engine_enabled());
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
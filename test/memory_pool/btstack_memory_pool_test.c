@@ -0,0 +1,99 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_memory_pool.h"
+
+#include <stdarg.h>
+
+#define NUM_BLOCKS 10
+
+typedef struct {
+    void *  next;
+    uint8_t data[20];
+} test_block_t;
+
+static test_block_t storage[NUM_BLOCKS];
+static uint8_t used_blocks[(NUM_BLOCKS + 7) / 8];
+static int num_errors;
+
+// btstack_debug.h
+extern "C" void hci_dump_log(int log_level, const char * format, ...){
+    (void) format;
+    if (log_level == 2) num_errors++;
+}
+
+TEST_GROUP(MemoryPool){
+    btstack_memory_pool_t pool;
+
+    void setup(void){
+        num_errors = 0;
+        btstack_memory_pool_create(&pool, storage, NUM_BLOCKS, sizeof(test_block_t), used_blocks);
+    }
+};
+
+TEST(MemoryPool, GetAll){
+    int i;
+    for (i = 0; i < NUM_BLOCKS; i++){
+        void * block = btstack_memory_pool_get(&pool);
+        CHECK(block != NULL);
+        CHECK((uint8_t *) block >= (uint8_t *) storage);
+        CHECK((uint8_t *) block <  (uint8_t *) &storage[NUM_BLOCKS]);
+    }
+    POINTERS_EQUAL(NULL, btstack_memory_pool_get(&pool));
+}
+
+TEST(MemoryPool, FreeAndReuse){
+    void * block_a = btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, block_a);
+    void * block_b = btstack_memory_pool_get(&pool);
+    POINTERS_EQUAL(block_a, block_b);
+    CHECK_EQUAL(0, num_errors);
+}
+
+TEST(MemoryPool, DoubleFree){
+    void * block_a = btstack_memory_pool_get(&pool);
+    void * block_b = btstack_memory_pool_get(&pool);
+    btstack_memory_pool_free(&pool, block_a);
+    btstack_memory_pool_free(&pool, block_a);
+    CHECK_EQUAL(1, num_errors);
+    // block only returned once
+    void * block_c = btstack_memory_pool_get(&pool);
+    void * block_d = btstack_memory_pool_get(&pool);
+    POINTERS_EQUAL(block_a, block_c);
+    CHECK(block_d != block_a);
+    CHECK(block_d != block_b);
+}
+
+TEST(MemoryPool, FreeUnusedBlock){
+    btstack_memory_pool_free(&pool, &storage[3]);
+    CHECK_EQUAL(1, num_errors);
+}
+
+TEST(MemoryPool, FreeForeignBlock){
+    test_block_t foreign;
+    btstack_memory_pool_free(&pool, &foreign);
+    btstack_memory_pool_free(&pool, &storage[1].data[0]);
+    CHECK_EQUAL(2, num_errors);
+}
+
+TEST(MemoryPool, Stats){
+    void * blocks[NUM_BLOCKS];
+    int i;
+    for (i = 0; i < NUM_BLOCKS; i++){
+        blocks[i] = btstack_memory_pool_get(&pool);
+    }
+    btstack_memory_pool_get(&pool);
+    for (i = 0; i < 4; i++){
+        btstack_memory_pool_free(&pool, blocks[i]);
+    }
+    btstack_memory_pool_stats_t stats;
+    btstack_memory_pool_get_stats(&pool, "test", &stats);
+    STRCMP_EQUAL("test", stats.name);
+    CHECK_EQUAL(NUM_BLOCKS, stats.count);
+    CHECK_EQUAL(NUM_BLOCKS - 4, stats.num_used);
+    CHECK_EQUAL(NUM_BLOCKS, stats.max_num_used);
+    CHECK_EQUAL(1, stats.num_allocation_failures);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,17 @@
+//
+// btstack_config.h for PAN NAP bridge test
+//
+
+#ifndef __BTSTACK_CONFIG
+#define __BTSTACK_CONFIG
+
+// Port related features
+#define HAVE_MALLOC
+
+// BTstack features that can be enabled
+#define ENABLE_CLASSIC
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 1021
+
+#endif
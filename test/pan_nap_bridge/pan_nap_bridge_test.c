@@ -0,0 +1,301 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "classic/bnep.h"
+#include "gap.h"
+#include "pan_nap_bridge_posix.h"
+
+#define MOCK_MAX_CHANNELS 4
+#define MOCK_MAX_FRAMES   8
+#define FRAME_SIZE        60
+
+#define CID_A 0x0041
+#define CID_B 0x0042
+#define CID_C 0x0043
+
+static const bd_addr_t local_addr  = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x01 };
+static const bd_addr_t panu_a_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x0a };
+static const bd_addr_t panu_b_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x0b };
+static const bd_addr_t panu_c_addr = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x0c };
+static const bd_addr_t unknown_addr   = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0xff };
+static const bd_addr_t broadcast_addr = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+static const bd_addr_t multicast_addr = { 0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb };
+
+// mock BNEP
+
+typedef struct {
+    uint16_t bnep_cid;
+    int      can_send;
+    int      waiting_for_can_send_now;
+    int      num_frames;
+    uint8_t  frames[MOCK_MAX_FRAMES][FRAME_SIZE];
+} mock_channel_t;
+
+static mock_channel_t           mock_channels[MOCK_MAX_CHANNELS];
+static btstack_packet_handler_t bridge_packet_handler;
+
+static mock_channel_t * mock_channel(uint16_t bnep_cid){
+    int i;
+    for (i=0;i<MOCK_MAX_CHANNELS;i++){
+        if (mock_channels[i].bnep_cid == bnep_cid) return &mock_channels[i];
+    }
+    return NULL;
+}
+
+uint8_t bnep_register_service(btstack_packet_handler_t packet_handler, uint16_t service_uuid, uint16_t max_frame_size){
+    UNUSED(service_uuid);
+    UNUSED(max_frame_size);
+    bridge_packet_handler = packet_handler;
+    return ERROR_CODE_SUCCESS;
+}
+
+int bnep_can_send_packet_now(uint16_t bnep_cid){
+    return mock_channel(bnep_cid)->can_send;
+}
+
+void bnep_request_can_send_now_event(uint16_t bnep_cid){
+    mock_channel(bnep_cid)->waiting_for_can_send_now = 1;
+}
+
+int bnep_send(uint16_t bnep_cid, uint8_t *packet, uint16_t len){
+    mock_channel_t * channel = mock_channel(bnep_cid);
+    CHECK(channel->can_send);
+    CHECK(channel->num_frames < MOCK_MAX_FRAMES);
+    CHECK_EQUAL(FRAME_SIZE, len);
+    memcpy(channel->frames[channel->num_frames++], packet, len);
+    return 0;
+}
+
+// TAP reading is not triggered without TAP interface
+int bnep_reserve_packet_buffer(uint16_t bnep_cid){
+    UNUSED(bnep_cid);
+    return 1;
+}
+
+void bnep_release_packet_buffer(void){
+}
+
+uint8_t * bnep_get_outgoing_ethernet_frame_buffer(void){
+    return NULL;
+}
+
+int bnep_send_prepared(uint16_t bnep_cid, uint16_t len){
+    UNUSED(bnep_cid);
+    UNUSED(len);
+    return 1;
+}
+
+void gap_local_bd_addr(bd_addr_t address_buffer){
+    memcpy(address_buffer, local_addr, sizeof(bd_addr_t));
+}
+
+// no TAP interface in unit test, frames for the TAP interface are counted as dropped
+extern "C" int open(const char * path, int flags, ...){
+    UNUSED(path);
+    UNUSED(flags);
+    errno = ENOENT;
+    return -1;
+}
+
+static void mock_channel_opened(uint16_t bnep_cid){
+    mock_channel_t * channel = mock_channel(0);
+    channel->bnep_cid = bnep_cid;
+    channel->can_send = 1;
+    uint8_t event[19];
+    memset(event, 0, sizeof(event));
+    event[0] = BNEP_EVENT_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 3, bnep_cid);
+    bridge_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void mock_channel_closed(uint16_t bnep_cid){
+    uint8_t event[16];
+    memset(event, 0, sizeof(event));
+    event[0] = BNEP_EVENT_CHANNEL_CLOSED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, bnep_cid);
+    bridge_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+    memset(mock_channel(bnep_cid), 0, sizeof(mock_channel_t));
+}
+
+static void mock_can_send_now(uint16_t bnep_cid){
+    mock_channel_t * channel = mock_channel(bnep_cid);
+    channel->can_send = 1;
+    if (!channel->waiting_for_can_send_now) return;
+    channel->waiting_for_can_send_now = 0;
+    uint8_t event[16];
+    memset(event, 0, sizeof(event));
+    event[0] = BNEP_EVENT_CAN_SEND_NOW;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 2, bnep_cid);
+    bridge_packet_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void mock_receive_frame(uint16_t bnep_cid, const bd_addr_t dest, const bd_addr_t source){
+    uint8_t frame[FRAME_SIZE];
+    memset(frame, 0x55, sizeof(frame));
+    memcpy(&frame[0], dest, sizeof(bd_addr_t));
+    memcpy(&frame[6], source, sizeof(bd_addr_t));
+    big_endian_store_16(frame, 12, 0x0800);
+    bridge_packet_handler(BNEP_DATA_PACKET, bnep_cid, frame, sizeof(frame));
+}
+
+static int num_frames(uint16_t bnep_cid){
+    return mock_channel(bnep_cid)->num_frames;
+}
+
+static const uint8_t * last_frame(uint16_t bnep_cid){
+    mock_channel_t * channel = mock_channel(bnep_cid);
+    return channel->frames[channel->num_frames - 1];
+}
+
+static pan_nap_bridge_stats_t get_stats(void){
+    pan_nap_bridge_stats_t stats;
+    pan_nap_bridge_get_stats(&stats);
+    return stats;
+}
+
+TEST_GROUP(PanNapBridge){
+    void setup(void){
+        memset(mock_channels, 0, sizeof(mock_channels));
+        pan_nap_bridge_init("bnep%d", 1691);
+        mock_channel_opened(CID_A);
+        mock_channel_opened(CID_B);
+        mock_channel_opened(CID_C);
+        // learn PANU addresses
+        mock_receive_frame(CID_A, local_addr, panu_a_addr);
+        mock_receive_frame(CID_B, local_addr, panu_b_addr);
+        mock_receive_frame(CID_C, local_addr, panu_c_addr);
+        pan_nap_bridge_reset_stats();
+    }
+    void teardown(void){
+        mock_channel_closed(CID_A);
+        mock_channel_closed(CID_B);
+        mock_channel_closed(CID_C);
+    }
+};
+
+TEST(PanNapBridge, FrameForNapNotForwarded){
+    mock_receive_frame(CID_A, local_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+    CHECK_EQUAL(0, get_stats().frames_forwarded);
+    CHECK_EQUAL(1, get_stats().frames_dropped);
+}
+
+TEST(PanNapBridge, UnicastForwardedToLearnedChannel){
+    mock_receive_frame(CID_A, panu_b_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_A));
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+    MEMCMP_EQUAL(panu_b_addr, &last_frame(CID_B)[0], 6);
+    MEMCMP_EQUAL(panu_a_addr, &last_frame(CID_B)[6], 6);
+    CHECK_EQUAL(1, get_stats().frames_forwarded);
+    // not written to TAP
+    CHECK_EQUAL(0, get_stats().frames_dropped);
+}
+
+TEST(PanNapBridge, UnicastForSourceChannelDropped){
+    mock_receive_frame(CID_A, panu_a_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_A));
+    CHECK_EQUAL(0, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+    CHECK_EQUAL(1, get_stats().frames_dropped);
+}
+
+TEST(PanNapBridge, BroadcastForwardedToOtherChannels){
+    mock_receive_frame(CID_B, broadcast_addr, panu_b_addr);
+    CHECK_EQUAL(1, num_frames(CID_A));
+    CHECK_EQUAL(0, num_frames(CID_B));
+    CHECK_EQUAL(1, num_frames(CID_C));
+    MEMCMP_EQUAL(broadcast_addr, &last_frame(CID_A)[0], 6);
+    MEMCMP_EQUAL(broadcast_addr, &last_frame(CID_C)[0], 6);
+    CHECK_EQUAL(1, get_stats().frames_forwarded);
+    // TAP write attempted
+    CHECK_EQUAL(1, get_stats().frames_dropped);
+}
+
+TEST(PanNapBridge, MulticastForwardedToOtherChannels){
+    mock_receive_frame(CID_C, multicast_addr, panu_c_addr);
+    CHECK_EQUAL(1, num_frames(CID_A));
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+}
+
+TEST(PanNapBridge, UnknownUnicastForwardedToOtherChannels){
+    mock_receive_frame(CID_A, unknown_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_A));
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(1, num_frames(CID_C));
+}
+
+TEST(PanNapBridge, BlockedChannelReceivesFrameOnCanSendNow){
+    mock_channel(CID_C)->can_send = 0;
+    mock_receive_frame(CID_A, broadcast_addr, panu_a_addr);
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+    CHECK(mock_channel(CID_C)->waiting_for_can_send_now);
+
+    mock_can_send_now(CID_C);
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(1, num_frames(CID_C));
+    MEMCMP_EQUAL(panu_a_addr, &last_frame(CID_C)[6], 6);
+}
+
+TEST(PanNapBridge, BlockedUnicastReceivesFrameOnCanSendNow){
+    mock_channel(CID_B)->can_send = 0;
+    mock_receive_frame(CID_A, panu_b_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_B));
+    CHECK(mock_channel(CID_B)->waiting_for_can_send_now);
+
+    mock_can_send_now(CID_B);
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(0, num_frames(CID_C));
+}
+
+TEST(PanNapBridge, FrameDroppedWhileForwardPending){
+    mock_channel(CID_C)->can_send = 0;
+    mock_receive_frame(CID_A, broadcast_addr, panu_a_addr);
+    mock_receive_frame(CID_A, unknown_addr, panu_a_addr);
+    CHECK_EQUAL(1, num_frames(CID_B));
+    CHECK_EQUAL(1, get_stats().frames_forwarded);
+
+    // unicast to channel without pending frame is sent directly
+    mock_receive_frame(CID_A, panu_b_addr, panu_a_addr);
+    CHECK_EQUAL(2, num_frames(CID_B));
+
+    // unicast must not overtake pending frame
+    mock_receive_frame(CID_A, panu_c_addr, panu_a_addr);
+    mock_can_send_now(CID_C);
+    CHECK_EQUAL(1, num_frames(CID_C));
+    MEMCMP_EQUAL(broadcast_addr, &last_frame(CID_C)[0], 6);
+    CHECK_EQUAL(2, get_stats().frames_forwarded);
+}
+
+TEST(PanNapBridge, AddressesForgottenOnChannelClosed){
+    mock_channel_closed(CID_B);
+    mock_receive_frame(CID_A, panu_b_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_A));
+    CHECK_EQUAL(1, num_frames(CID_C));
+    // channel re-opened for teardown
+    mock_channel_opened(CID_B);
+}
+
+TEST(PanNapBridge, AddressMovesToNewChannel){
+    mock_receive_frame(CID_C, local_addr, panu_b_addr);
+    mock_receive_frame(CID_A, panu_b_addr, panu_a_addr);
+    CHECK_EQUAL(0, num_frames(CID_B));
+    CHECK_EQUAL(1, num_frames(CID_C));
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -97,6 +97,29 @@ static uint16_t cid_classic;
 
 uint8_t receive_buffer_X[100];
 
+// throughput test: stream SDUs of remote MTU size and report data rate every REPORT_INTERVAL_MS
+#define REPORT_INTERVAL_MS 3000
+static int      test_streaming;
+static uint16_t test_remote_mtu;
+static uint8_t  test_data[1000];
+static uint32_t test_data_transferred;
+static uint32_t test_data_start;
+
+static void test_reset(void){
+    test_data_start = btstack_run_loop_get_time_ms();
+    test_data_transferred = 0;
+}
+
+static void test_track_data(const char * direction, int bytes){
+    test_data_transferred += bytes;
+    uint32_t now = btstack_run_loop_get_time_ms();
+    uint32_t time_passed = now - test_data_start;
+    if (time_passed < REPORT_INTERVAL_MS) return;
+    int bytes_per_second = test_data_transferred * 1000 / time_passed;
+    printf("%u bytes %s -> %u.%03u kB/s\n", test_data_transferred, direction, bytes_per_second / 1000, bytes_per_second % 1000);
+    test_reset();
+}
+
 static void gap_run(void){
 }
 
@@ -109,6 +132,10 @@ static void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *
     switch (packet_type) {
         
         case L2CAP_DATA_PACKET:
+            if (test_streaming){
+                test_track_data("received", size);
+                break;
+            }
             printf("L2CAP data cid 0x%02x: ", channel);
             printf_hexdump(packet, size);
             break;
@@ -201,6 +228,7 @@ static void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *
                         switch (psm){
                             case TSPX_le_psm:
                                 cid_le = cid;
+                                test_remote_mtu = l2cap_event_le_channel_opened_get_remote_mtu(packet);
                                 break;
                             case TSPX_psm:
                                 cid_classic = cid;
@@ -214,6 +242,13 @@ static void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *
                     break;
 
                 case L2CAP_EVENT_LE_CAN_SEND_NOW:
+                    if (test_streaming){
+                        uint16_t test_data_len = btstack_min(test_remote_mtu, sizeof(test_data));
+                        l2cap_le_send_data(cid_le, test_data, test_data_len);
+                        test_track_data("sent", test_data_len);
+                        l2cap_le_request_can_send_now_event(cid_le);
+                        break;
+                    }
                     if (todo_send_short){
                         todo_send_short = 0;
                         l2cap_le_send_data(cid_le, (uint8_t *) data_short, strlen(data_short));
@@ -231,6 +266,7 @@ static void app_packet_handler (uint8_t packet_type, uint16_t channel, uint8_t *
                     break;
 
                case L2CAP_EVENT_LE_PACKET_SENT:
+                    if (test_streaming) break;
                     cid = l2cap_event_le_packet_sent_get_local_cid(packet);
                     printf("L2CAP: LE Data Channel Packet sent0x%02x\n", cid); 
                     break;
@@ -287,6 +323,7 @@ void show_usage(void){
     printf("S - send long data %s\n", data_long);
     printf("y - connect to address %s PSM 0x%02x (TSPX_psm - Classic)\n", bd_addr_to_str(pts_address), TSPX_psm);
     printf("z - send classic data Classic %s\n", data_classic);
+    printf("p - toggle throughput test (stream data / report received data)\n");
     printf("t - disconnect channel\n");
     printf("---\n");
     printf("Ctrl-c - exit\n");
@@ -359,6 +396,16 @@ static void stdin_process(char buffer){
             l2cap_send(cid_classic, (uint8_t *) data_classic, strlen(data_classic));
             break;
 
+        case 'p':
+            test_streaming = !test_streaming;
+            printf("Throughput test %s\n", test_streaming ? "started" : "stopped");
+            if (!test_streaming) break;
+            test_reset();
+            if (cid_le){
+                l2cap_le_request_can_send_now_event(cid_le);
+            }
+            break;
+
         case 't':
             printf("Disconnect channel 0x%02x\n", cid_le);
             l2cap_le_disconnect(cid_le);
@@ -0,0 +1,194 @@
+// Cross-thread throughput benchmark for ring buffers
+//
+// A producer thread generates PCM-like blocks, a consumer thread checksums them,
+// similar to an audio thread and the stack thread exchanging PCM or SBC data.
+// Compares btstack_ring_buffer protected by a mutex with btstack_spsc_ring_buffer
+// using the copy API and the in-place reserve/commit and peek/consume API.
+//
+// Usage: btstack_spsc_ring_buffer_benchmark [block size]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "btstack_ring_buffer.h"
+#include "btstack_spsc_ring_buffer.h"
+#include "btstack_util.h"
+
+#define STORAGE_SIZE     (16 * 1024)
+#define TOTAL_BYTES      (256 * 1024 * 1024)
+#define MAX_BLOCK_SIZE   4096
+
+typedef enum {
+    MODE_MUTEX_COPY = 0,
+    MODE_SPSC_COPY,
+    MODE_SPSC_IN_PLACE,
+} benchmark_mode_t;
+
+static const char * mode_names[] = {
+    "btstack_ring_buffer + mutex, copy",
+    "btstack_spsc_ring_buffer, copy",
+    "btstack_spsc_ring_buffer, in place",
+};
+
+static uint8_t storage[STORAGE_SIZE];
+static btstack_ring_buffer_t ring_buffer;
+static btstack_spsc_ring_buffer_t spsc_ring_buffer;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static benchmark_mode_t  mode;
+static uint32_t block_size = 512;
+static uint32_t producer_checksum;
+static uint32_t consumer_checksum;
+
+// provided by btstack_util.c in the library
+uint32_t btstack_min(uint32_t a, uint32_t b){
+    return a < b ? a : b;
+}
+
+static void generate(uint8_t * buffer, uint32_t len, uint32_t * counter){
+    uint32_t i;
+    for (i = 0; i < len; i++){
+        buffer[i] = (uint8_t) *counter;
+        producer_checksum += buffer[i];
+        (*counter)++;
+    }
+}
+
+static void process(const uint8_t * buffer, uint32_t len){
+    uint32_t i;
+    for (i = 0; i < len; i++){
+        consumer_checksum += buffer[i];
+    }
+}
+
+static void * producer(void * context){
+    (void) context;
+    uint8_t block[MAX_BLOCK_SIZE];
+    uint32_t counter = 0;
+    uint32_t bytes_written = 0;
+    while (bytes_written < TOTAL_BYTES){
+        uint32_t len = block_size;
+        uint8_t * data;
+        int ok = 0;
+        switch (mode){
+            case MODE_MUTEX_COPY:
+                generate(block, len, &counter);
+                while (!ok){
+                    pthread_mutex_lock(&mutex);
+                    ok = btstack_ring_buffer_write(&ring_buffer, block, len) == 0;
+                    pthread_mutex_unlock(&mutex);
+                    if (!ok) sched_yield();
+                }
+                break;
+            case MODE_SPSC_COPY:
+                generate(block, len, &counter);
+                while (btstack_spsc_ring_buffer_write(&spsc_ring_buffer, block, len)){
+                    sched_yield();
+                }
+                break;
+            case MODE_SPSC_IN_PLACE:
+                data = btstack_spsc_ring_buffer_reserve(&spsc_ring_buffer, &len);
+                if (!data){
+                    sched_yield();
+                    continue;
+                }
+                if (len > block_size){
+                    len = block_size;
+                }
+                generate(data, len, &counter);
+                btstack_spsc_ring_buffer_commit(&spsc_ring_buffer, len);
+                break;
+            default:
+                break;
+        }
+        bytes_written += len;
+    }
+    return NULL;
+}
+
+static void * consumer(void * context){
+    (void) context;
+    uint8_t block[MAX_BLOCK_SIZE];
+    uint32_t bytes_read = 0;
+    while (bytes_read < TOTAL_BYTES){
+        uint32_t len = 0;
+        const uint8_t * data;
+        switch (mode){
+            case MODE_MUTEX_COPY:
+                pthread_mutex_lock(&mutex);
+                btstack_ring_buffer_read(&ring_buffer, block, block_size, &len);
+                pthread_mutex_unlock(&mutex);
+                process(block, len);
+                break;
+            case MODE_SPSC_COPY:
+                len = btstack_spsc_ring_buffer_read(&spsc_ring_buffer, block, block_size);
+                process(block, len);
+                break;
+            case MODE_SPSC_IN_PLACE:
+                data = btstack_spsc_ring_buffer_peek(&spsc_ring_buffer, &len);
+                if (!data) break;
+                if (len > block_size){
+                    len = block_size;
+                }
+                process(data, len);
+                btstack_spsc_ring_buffer_consume(&spsc_ring_buffer, len);
+                break;
+            default:
+                break;
+        }
+        if (len == 0){
+            sched_yield();
+            continue;
+        }
+        bytes_read += len;
+    }
+    return NULL;
+}
+
+static double now_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, const char * argv[]){
+    if (argc > 1){
+        block_size = atoi(argv[1]);
+        if (block_size == 0 || block_size > MAX_BLOCK_SIZE){
+            printf("Block size must be 1..%u\n", MAX_BLOCK_SIZE);
+            return 1;
+        }
+    }
+    printf("Transferring %u MB in blocks of %u bytes through %u byte buffer\n", TOTAL_BYTES / (1024*1024), block_size, STORAGE_SIZE);
+
+    int result = 0;
+    int i;
+    for (i = MODE_MUTEX_COPY; i <= MODE_SPSC_IN_PLACE; i++){
+        mode = (benchmark_mode_t) i;
+        btstack_ring_buffer_init(&ring_buffer, storage, sizeof(storage));
+        btstack_spsc_ring_buffer_init(&spsc_ring_buffer, storage, sizeof(storage));
+        producer_checksum = 0;
+        consumer_checksum = 0;
+
+        pthread_t producer_thread;
+        pthread_t consumer_thread;
+        double start = now_seconds();
+        pthread_create(&consumer_thread, NULL, &consumer, NULL);
+        pthread_create(&producer_thread, NULL, &producer, NULL);
+        pthread_join(producer_thread, NULL);
+        pthread_join(consumer_thread, NULL);
+        double duration = now_seconds() - start;
+
+        printf("%-36s %8.1f MB/s\n", mode_names[i], TOTAL_BYTES / duration / (1024*1024));
+        if (producer_checksum != consumer_checksum){
+            printf("Error: checksum mismatch\n");
+            result = 1;
+        }
+    }
+    return result;
+}
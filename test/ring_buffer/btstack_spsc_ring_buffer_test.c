@@ -0,0 +1,118 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+#include "btstack_spsc_ring_buffer.h"
+
+static uint8_t storage[10];
+
+TEST_GROUP(SPSCRingBuffer){
+    btstack_spsc_ring_buffer_t ring_buffer;
+    uint32_t storage_size;
+
+    void setup(void){
+        storage_size = sizeof(storage);
+        memset(storage, 0, storage_size);
+        btstack_spsc_ring_buffer_init(&ring_buffer, storage, storage_size);
+    }
+};
+
+TEST(SPSCRingBuffer, EmptyBuffer){
+    uint32_t contiguous_len = 1;
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+    CHECK_EQUAL(storage_size, btstack_spsc_ring_buffer_bytes_free(&ring_buffer));
+    POINTERS_EQUAL(NULL, btstack_spsc_ring_buffer_peek(&ring_buffer, &contiguous_len));
+    CHECK_EQUAL(0, contiguous_len);
+}
+
+TEST(SPSCRingBuffer, ReserveCommitPeekConsume){
+    uint32_t contiguous_len;
+    uint8_t * write_ptr = btstack_spsc_ring_buffer_reserve(&ring_buffer, &contiguous_len);
+    POINTERS_EQUAL(storage, write_ptr);
+    CHECK_EQUAL(storage_size, contiguous_len);
+    write_ptr[0] = 1;
+    write_ptr[1] = 2;
+    write_ptr[2] = 3;
+    // not visible before commit
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+    btstack_spsc_ring_buffer_commit(&ring_buffer, 3);
+    CHECK_EQUAL(3, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+
+    const uint8_t * read_ptr = btstack_spsc_ring_buffer_peek(&ring_buffer, &contiguous_len);
+    POINTERS_EQUAL(storage, read_ptr);
+    CHECK_EQUAL(3, contiguous_len);
+    btstack_spsc_ring_buffer_consume(&ring_buffer, 2);
+    read_ptr = btstack_spsc_ring_buffer_peek(&ring_buffer, &contiguous_len);
+    CHECK_EQUAL(1, contiguous_len);
+    CHECK_EQUAL(3, read_ptr[0]);
+    btstack_spsc_ring_buffer_consume(&ring_buffer, 1);
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+}
+
+TEST(SPSCRingBuffer, WriteFullBuffer){
+    uint8_t test_write_data[] = {1,2,3,4,5,6,7,8,9,10};
+    uint8_t test_read_data[10];
+    uint32_t contiguous_len;
+
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_write(&ring_buffer, test_write_data, sizeof(test_write_data)));
+    CHECK_EQUAL(storage_size, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_bytes_free(&ring_buffer));
+    POINTERS_EQUAL(NULL, btstack_spsc_ring_buffer_reserve(&ring_buffer, &contiguous_len));
+    CHECK_EQUAL(0, contiguous_len);
+    CHECK_EQUAL(0x07, btstack_spsc_ring_buffer_write(&ring_buffer, test_write_data, 1));
+
+    CHECK_EQUAL(sizeof(test_read_data), btstack_spsc_ring_buffer_read(&ring_buffer, test_read_data, sizeof(test_read_data)));
+    CHECK_EQUAL(0, memcmp(test_write_data, test_read_data, sizeof(test_read_data)));
+}
+
+TEST(SPSCRingBuffer, WrapAround){
+    uint8_t test_write_data[] = {1,2,3,4,5,6,7};
+    uint8_t test_read_data[7];
+    uint32_t contiguous_len;
+
+    // move positions to index 7
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_write(&ring_buffer, test_write_data, 7));
+    CHECK_EQUAL(7, btstack_spsc_ring_buffer_read(&ring_buffer, test_read_data, 7));
+
+    // reserve only returns space till end of storage
+    uint8_t * write_ptr = btstack_spsc_ring_buffer_reserve(&ring_buffer, &contiguous_len);
+    POINTERS_EQUAL(&storage[7], write_ptr);
+    CHECK_EQUAL(3, contiguous_len);
+
+    // copy wraps around
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_write(&ring_buffer, test_write_data, 7));
+    CHECK_EQUAL(7, btstack_spsc_ring_buffer_bytes_available(&ring_buffer));
+    CHECK_EQUAL(1, storage[7]);
+    CHECK_EQUAL(4, storage[0]);
+
+    const uint8_t * read_ptr = btstack_spsc_ring_buffer_peek(&ring_buffer, &contiguous_len);
+    POINTERS_EQUAL(&storage[7], read_ptr);
+    CHECK_EQUAL(3, contiguous_len);
+
+    memset(test_read_data, 0, sizeof(test_read_data));
+    CHECK_EQUAL(7, btstack_spsc_ring_buffer_read(&ring_buffer, test_read_data, sizeof(test_read_data)));
+    CHECK_EQUAL(0, memcmp(test_write_data, test_read_data, sizeof(test_read_data)));
+    CHECK_EQUAL(0, btstack_spsc_ring_buffer_read(&ring_buffer, test_read_data, 1));
+}
+
+TEST(SPSCRingBuffer, PositionsWrapTwice){
+    uint8_t value = 0;
+    uint8_t expected = 0;
+    int i;
+    // odd chunk size walks positions over the 2 * size boundary several times
+    for (i=0;i<100;i++){
+        uint8_t chunk[3];
+        uint8_t result[3];
+        int j;
+        for (j=0;j<3;j++) chunk[j] = value++;
+        CHECK_EQUAL(0, btstack_spsc_ring_buffer_write(&ring_buffer, chunk, 3));
+        if (btstack_spsc_ring_buffer_bytes_free(&ring_buffer) < 3){
+            while (btstack_spsc_ring_buffer_bytes_available(&ring_buffer)){
+                CHECK_EQUAL(1, btstack_spsc_ring_buffer_read(&ring_buffer, result, 1));
+                CHECK_EQUAL(expected++, result[0]);
+            }
+        }
+    }
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
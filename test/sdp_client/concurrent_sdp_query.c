@@ -0,0 +1,303 @@
+// *****************************************************************************
+//
+// test concurrent sdp client queries
+//
+// *****************************************************************************
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "hci_dump.h"
+#include "l2cap.h"
+#include "classic/sdp_client.h"
+#include "classic/sdp_util.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+void sdp_client_reset(void);
+
+// DES { DES { 0x0001 : DES { UUID16 0x1101 } } }
+static uint8_t attribute_list[] = { 0x35, 0x0a, 0x35, 0x08, 0x09, 0x00, 0x01, 0x35, 0x03, 0x19, 0x11, 0x01 };
+
+static bd_addr_t remote_a = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x0a };
+static bd_addr_t remote_b = { 0x00, 0x1b, 0xdc, 0x00, 0x00, 0x0b };
+
+// L2CAP mock, one channel per create call
+static btstack_packet_handler_t l2cap_handler;
+static uint16_t l2cap_next_cid;
+static uint16_t l2cap_created_cids[8];
+static int      l2cap_num_created;
+static uint16_t l2cap_disconnected_cid;
+static uint8_t  l2cap_outgoing_buffer[200];
+static uint16_t l2cap_sent_cid;
+static uint16_t l2cap_sent_transaction_id;
+static int      l2cap_num_sent;
+
+extern "C" uint8_t l2cap_create_channel(btstack_packet_handler_t handler, bd_addr_t address, uint16_t psm, uint16_t mtu, uint16_t * out_local_cid){
+    l2cap_handler = handler;
+    *out_local_cid = l2cap_next_cid++;
+    l2cap_created_cids[l2cap_num_created++] = *out_local_cid;
+    return 0;
+}
+extern "C" void l2cap_request_can_send_now_event(uint16_t cid){
+    uint8_t event[] = { L2CAP_EVENT_CAN_SEND_NOW, 2, 0, 0};
+    little_endian_store_16(event, 2, cid);
+    l2cap_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+extern "C" void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
+    l2cap_disconnected_cid = local_cid;
+}
+extern "C" uint8_t *l2cap_get_outgoing_buffer(void){
+    return l2cap_outgoing_buffer;
+}
+extern "C" uint16_t l2cap_max_mtu(void){
+    return 100;
+}
+extern "C" int l2cap_reserve_packet_buffer(void){
+    return 1;
+}
+extern "C" void l2cap_release_packet_buffer(void){
+}
+extern "C" int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
+    l2cap_sent_cid = local_cid;
+    l2cap_sent_transaction_id = big_endian_read_16(l2cap_outgoing_buffer, 1);
+    l2cap_num_sent++;
+    return 0;
+}
+
+// memory mock
+extern "C" sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void){
+    return (sdp_client_connection_t *) calloc(1, sizeof(sdp_client_connection_t));
+}
+extern "C" void btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection){
+    free(sdp_client_connection);
+}
+
+// run loop mock, single pending timer
+static btstack_timer_source_t * pending_timer;
+static uint32_t time_ms;
+
+void btstack_run_loop_set_timer_handler(btstack_timer_source_t *ts, void (*process)(btstack_timer_source_t *_ts)){
+    ts->process = process;
+}
+void btstack_run_loop_set_timer_context(btstack_timer_source_t *ts, void * context){
+    ts->context = context;
+}
+void * btstack_run_loop_get_timer_context(btstack_timer_source_t *ts){
+    return ts->context;
+}
+void btstack_run_loop_set_timer(btstack_timer_source_t *ts, uint32_t timeout_in_ms){
+}
+void btstack_run_loop_add_timer(btstack_timer_source_t *ts){
+    pending_timer = ts;
+}
+int btstack_run_loop_remove_timer(btstack_timer_source_t *ts){
+    if (pending_timer == ts) pending_timer = NULL;
+    return 0;
+}
+uint32_t btstack_run_loop_get_time_ms(void){
+    return time_ms;
+}
+
+static void fire_timer(void){
+    btstack_timer_source_t * ts = pending_timer;
+    CHECK(ts != NULL);
+    pending_timer = NULL;
+    ts->process(ts);
+}
+
+static void channel_opened(uint16_t cid){
+    uint8_t event[27];
+    memset(event, 0, sizeof(event));
+    event[0] = L2CAP_EVENT_CHANNEL_OPENED;
+    event[1] = sizeof(event) - 2;
+    little_endian_store_16(event, 13, cid);
+    little_endian_store_16(event, 17, 100);
+    l2cap_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void channel_closed(uint16_t cid){
+    uint8_t event[4];
+    event[0] = L2CAP_EVENT_CHANNEL_CLOSED;
+    event[1] = 2;
+    little_endian_store_16(event, 2, cid);
+    l2cap_handler(HCI_EVENT_PACKET, 0, event, sizeof(event));
+}
+
+static void receive_response(uint16_t cid, uint16_t transaction_id){
+    uint8_t response[40];
+    int pos = 0;
+    response[pos++] = SDP_ServiceSearchAttributeResponse;
+    big_endian_store_16(response, pos, transaction_id);
+    pos += 2;
+    big_endian_store_16(response, pos, 2 + sizeof(attribute_list) + 1);
+    pos += 2;
+    big_endian_store_16(response, pos, sizeof(attribute_list));
+    pos += 2;
+    memcpy(&response[pos], attribute_list, sizeof(attribute_list));
+    pos += sizeof(attribute_list);
+    response[pos++] = 0;
+    l2cap_handler(L2CAP_DATA_PACKET, cid, response, pos);
+}
+
+// events per query id
+#define MAX_EVENTS 20
+static uint16_t event_query_ids[MAX_EVENTS];
+static uint8_t  event_types[MAX_EVENTS];
+static uint8_t  event_status[MAX_EVENTS];
+static int      num_events;
+
+static int num_events_for_query(uint16_t query_id, uint8_t type){
+    int i;
+    int count = 0;
+    for (i=0;i<num_events;i++){
+        if (event_query_ids[i] == query_id && event_types[i] == type) count++;
+    }
+    return count;
+}
+
+static uint8_t status_for_query(uint16_t query_id){
+    int i;
+    for (i=0;i<num_events;i++){
+        if (event_query_ids[i] == query_id && event_types[i] == SDP_EVENT_QUERY_COMPLETE) return event_status[i];
+    }
+    return 0xff;
+}
+
+static void handle_sdp_client_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    if (num_events == MAX_EVENTS) return;
+    event_query_ids[num_events] = channel;
+    event_types[num_events] = hci_event_packet_get_type(packet);
+    event_status[num_events] = event_types[num_events] == SDP_EVENT_QUERY_COMPLETE ? sdp_event_query_complete_get_status(packet) : 0;
+    num_events++;
+}
+
+TEST_GROUP(SDPClientConcurrent){
+    void setup(void){
+        sdp_client_reset();
+#ifdef ENABLE_SDP_CLIENT_CACHE
+        sdp_client_cache_flush();
+#endif
+        l2cap_next_cid = 0x41;
+        l2cap_num_created = 0;
+        l2cap_disconnected_cid = 0;
+        l2cap_num_sent = 0;
+        pending_timer = NULL;
+        num_events = 0;
+    }
+};
+
+TEST(SDPClientConcurrent, TwoRemotesInParallel){
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    uint16_t query_a = sdp_client_get_last_query_id();
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_b, 0x1101));
+    uint16_t query_b = sdp_client_get_last_query_id();
+    CHECK(query_a != query_b);
+    CHECK_EQUAL(2, l2cap_num_created);
+    CHECK_EQUAL(0, sdp_client_ready());
+
+    channel_opened(l2cap_created_cids[0]);
+    uint16_t transaction_a = l2cap_sent_transaction_id;
+    channel_opened(l2cap_created_cids[1]);
+    uint16_t transaction_b = l2cap_sent_transaction_id;
+    CHECK_EQUAL(2, l2cap_num_sent);
+
+    // answer out of order
+    receive_response(l2cap_created_cids[1], transaction_b);
+    CHECK_EQUAL(5, num_events_for_query(query_b, SDP_EVENT_QUERY_ATTRIBUTE_VALUE));
+    CHECK_EQUAL(0, status_for_query(query_b));
+    CHECK_EQUAL(0, num_events_for_query(query_a, SDP_EVENT_QUERY_COMPLETE));
+    CHECK_EQUAL(l2cap_created_cids[1], l2cap_disconnected_cid);
+
+    receive_response(l2cap_created_cids[0], transaction_a);
+    CHECK_EQUAL(5, num_events_for_query(query_a, SDP_EVENT_QUERY_ATTRIBUTE_VALUE));
+    CHECK_EQUAL(0, status_for_query(query_a));
+    CHECK_EQUAL(l2cap_created_cids[0], l2cap_disconnected_cid);
+
+    channel_closed(l2cap_created_cids[0]);
+    channel_closed(l2cap_created_cids[1]);
+    CHECK_EQUAL(1, sdp_client_ready());
+}
+
+TEST(SDPClientConcurrent, QueriesForSameRemoteShareChannel){
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    uint16_t query_1 = sdp_client_get_last_query_id();
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1102));
+    uint16_t query_2 = sdp_client_get_last_query_id();
+    CHECK_EQUAL(1, l2cap_num_created);
+
+    channel_opened(l2cap_created_cids[0]);
+    CHECK_EQUAL(1, l2cap_num_sent);
+    receive_response(l2cap_created_cids[0], l2cap_sent_transaction_id);
+    CHECK_EQUAL(0, status_for_query(query_1));
+
+    // second query sent on open channel
+    CHECK_EQUAL(2, l2cap_num_sent);
+    CHECK_EQUAL(0, l2cap_disconnected_cid);
+    receive_response(l2cap_created_cids[0], l2cap_sent_transaction_id);
+    CHECK_EQUAL(0, status_for_query(query_2));
+    CHECK_EQUAL(l2cap_created_cids[0], l2cap_disconnected_cid);
+    CHECK_EQUAL(1, l2cap_num_created);
+}
+
+TEST(SDPClientConcurrent, QueueFull){
+    int i;
+    for (i=0;i<SDP_CLIENT_QUERY_QUEUE_SIZE;i++){
+        CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    }
+    CHECK_EQUAL(SDP_QUERY_BUSY, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_b, 0x1101));
+}
+
+TEST(SDPClientConcurrent, ChannelClosedAbortsQueries){
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    uint16_t query_1 = sdp_client_get_last_query_id();
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1102));
+    uint16_t query_2 = sdp_client_get_last_query_id();
+    channel_opened(l2cap_created_cids[0]);
+    channel_closed(l2cap_created_cids[0]);
+    CHECK_EQUAL(SDP_QUERY_INCOMPLETE, status_for_query(query_1));
+    CHECK_EQUAL(SDP_QUERY_INCOMPLETE, status_for_query(query_2));
+    CHECK_EQUAL(1, sdp_client_ready());
+}
+
+#ifdef ENABLE_SDP_CLIENT_CACHE
+TEST(SDPClientConcurrent, RepeatedQueryServedFromCache){
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    channel_opened(l2cap_created_cids[0]);
+    receive_response(l2cap_created_cids[0], l2cap_sent_transaction_id);
+    channel_closed(l2cap_created_cids[0]);
+
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    uint16_t query_cached = sdp_client_get_last_query_id();
+    CHECK_EQUAL(1, l2cap_num_created);
+    fire_timer();
+    CHECK_EQUAL(5, num_events_for_query(query_cached, SDP_EVENT_QUERY_ATTRIBUTE_VALUE));
+    CHECK_EQUAL(0, status_for_query(query_cached));
+    CHECK_EQUAL(1, sdp_client_ready());
+
+    // different remote is not cached
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_b, 0x1101));
+    CHECK_EQUAL(2, l2cap_num_created);
+    channel_opened(l2cap_created_cids[1]);
+    channel_closed(l2cap_created_cids[1]);
+
+    // expired entry
+    time_ms += SDP_CLIENT_CACHE_TTL_MS;
+    CHECK_EQUAL(0, sdp_client_query_uuid16(&handle_sdp_client_event, remote_a, 0x1101));
+    CHECK_EQUAL(3, l2cap_num_created);
+}
+#endif
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
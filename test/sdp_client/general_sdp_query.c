@@ -192,6 +192,105 @@ TEST(SDPClient, QueryWithMacOSXData){
 }
 
 
+// flattened attribute values, one entry per value byte
+typedef struct {
+    uint16_t record_id;
+    uint16_t attribute_id;
+    uint16_t attribute_length;
+    uint16_t data_offset;
+    uint8_t  data;
+} value_byte_t;
+
+#define MAX_VALUE_BYTES 1000
+static value_byte_t value_bytes[2][MAX_VALUE_BYTES];
+static int          num_value_bytes[2];
+static int          num_value_events;
+static int          transcript;
+
+static void add_value_byte(uint16_t record, uint16_t attribute, uint16_t length, uint16_t offset, uint8_t data){
+    if (num_value_bytes[transcript] == MAX_VALUE_BYTES) return;
+    value_byte_t * value_byte = &value_bytes[transcript][num_value_bytes[transcript]++];
+    value_byte->record_id = record;
+    value_byte->attribute_id = attribute;
+    value_byte->attribute_length = length;
+    value_byte->data_offset = offset;
+    value_byte->data = data;
+}
+
+static void handle_sdp_parser_transcript_event(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    int i;
+    switch (packet[0]){
+        case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
+            num_value_events++;
+            add_value_byte(sdp_event_query_attribute_byte_get_record_id(packet), sdp_event_query_attribute_byte_get_attribute_id(packet),
+                sdp_event_query_attribute_byte_get_attribute_length(packet), sdp_event_query_attribute_byte_get_data_offset(packet),
+                sdp_event_query_attribute_byte_get_data(packet));
+            break;
+        case SDP_EVENT_QUERY_ATTRIBUTE_DATA:
+            num_value_events++;
+            CHECK_EQUAL(12 + sdp_event_query_attribute_data_get_data_len(packet), size);
+            CHECK_EQUAL(size - 2, packet[1]);
+            for (i=0;i<sdp_event_query_attribute_data_get_data_len(packet);i++){
+                add_value_byte(sdp_event_query_attribute_data_get_record_id(packet), sdp_event_query_attribute_data_get_attribute_id(packet),
+                    sdp_event_query_attribute_data_get_attribute_length(packet), sdp_event_query_attribute_data_get_data_offset(packet) + i,
+                    sdp_event_query_attribute_data_get_data(packet)[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void parse_record_list(int attribute_data_mode, int chunk_size){
+    uint16_t len = de_get_len(sdp_test_record_list);
+    uint16_t pos;
+    num_value_bytes[transcript] = 0;
+    num_value_events = 0;
+    sdp_parser_init(&handle_sdp_parser_transcript_event);
+    sdp_parser_set_attribute_data_mode(attribute_data_mode);
+    for (pos = 0; pos < len; pos += chunk_size){
+        sdp_parser_handle_chunk(&sdp_test_record_list[pos], btstack_min(chunk_size, len - pos));
+    }
+}
+
+static void check_transcripts_equal(void){
+    int i;
+    CHECK_EQUAL(num_value_bytes[0], num_value_bytes[1]);
+    for (i=0;i<num_value_bytes[0];i++){
+        CHECK_EQUAL(value_bytes[0][i].record_id,        value_bytes[1][i].record_id);
+        CHECK_EQUAL(value_bytes[0][i].attribute_id,     value_bytes[1][i].attribute_id);
+        CHECK_EQUAL(value_bytes[0][i].attribute_length, value_bytes[1][i].attribute_length);
+        CHECK_EQUAL(value_bytes[0][i].data_offset,      value_bytes[1][i].data_offset);
+        CHECK_EQUAL(value_bytes[0][i].data,             value_bytes[1][i].data);
+    }
+}
+
+TEST(SDPClient, AttributeDataMatchesAttributeBytes){
+    transcript = 0;
+    parse_record_list(0, 1);
+    CHECK(num_value_bytes[0] > 0);
+    CHECK_EQUAL(num_value_bytes[0], num_value_events);
+
+    transcript = 1;
+    parse_record_list(1, 0xffff);
+    check_transcripts_equal();
+    // one event per attribute value
+    CHECK(num_value_events < num_value_bytes[0] / 4);
+}
+
+TEST(SDPClient, ChunkBoundaries){
+    int chunk_size;
+    transcript = 0;
+    parse_record_list(0, 1);
+    for (chunk_size = 2; chunk_size < 48; chunk_size++){
+        transcript = 1;
+        parse_record_list(0, chunk_size);
+        check_transcripts_equal();
+        parse_record_list(1, chunk_size);
+        check_transcripts_equal();
+    }
+}
+
 int main (int argc, const char * argv[]){
     return CommandLineTestRunner::RunAllTests(argc, argv);
 }
@@ -5,6 +5,8 @@
 #include "btstack_debug.h"
 #include "btstack_util.h"
 #include "bluetooth.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
 
 static btstack_packet_handler_t packet_handler;
 
@@ -19,7 +21,8 @@ extern "C" void l2cap_request_can_send_now_event(uint16_t cid){
 
 extern "C" uint8_t l2cap_create_channel(btstack_packet_handler_t handler, bd_addr_t address, uint16_t psm, uint16_t mtu, uint16_t * out_local_cid){
 	packet_handler = handler;
-    return 0x41;
+    if (out_local_cid) *out_local_cid = 0x41;
+    return 0;
 }
 extern "C" void l2cap_disconnect(uint16_t local_cid, uint8_t reason){
 }
@@ -34,4 +37,16 @@ extern "C" int l2cap_reserve_packet_buffer(void){
 }
 extern "C" int l2cap_send_prepared(uint16_t local_cid, uint16_t len){
     return 0;
-}
\ No newline at end of file
+}
+extern "C" void l2cap_release_packet_buffer(void){
+}
+
+// only default SDP client connection available
+extern "C" sdp_client_connection_t * btstack_memory_sdp_client_connection_get(void){
+    return NULL;
+}
+extern "C" void btstack_memory_sdp_client_connection_free(sdp_client_connection_t *sdp_client_connection){
+}
+extern "C" int btstack_run_loop_remove_timer(btstack_timer_source_t * ts){
+    return 0;
+}
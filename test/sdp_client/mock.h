@@ -3,6 +3,7 @@
 
 void sdp_parser_init(btstack_packet_handler_t callback);
 void sdp_parser_handle_chunk(uint8_t * data, uint16_t size);
+void sdp_parser_set_attribute_data_mode(int enabled);
 void sdp_parser_init_service_attribute_search(void);
 void sdp_parser_init_service_search(void);
 void sdp_parser_handle_service_search(uint8_t * data, uint16_t total_count, uint16_t record_handle_count);
@@ -0,0 +1,239 @@
+// Benchmark for SDP Client parser
+//
+// Replays attribute lists of SDP Service Search Attribute Responses from a PacketLogger file
+// (e.g. /tmp/hci_dump.pklg recorded by the posix ports) or from synthetic PBAP/A2DP-like records
+// with large attribute values, once with SDP_EVENT_QUERY_ATTRIBUTE_VALUE events per byte and
+// once with SDP_EVENT_QUERY_ATTRIBUTE_DATA events per attribute value.
+//
+// Usage: sdp_parser_benchmark [recording.pklg]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bluetooth_sdp.h"
+#include "btstack_event.h"
+#include "btstack_util.h"
+#include "hci_dump.h"
+#include "classic/sdp_util.h"
+#include "mock.h"
+
+#define SYNTHETIC_RECORDS    30
+#define SYNTHETIC_CHUNK_SIZE 64
+#define MIN_REPLAY_BYTES     (16 * 1024 * 1024)
+
+// chunk of attribute list, first chunk of a query starts a new parser run
+typedef struct {
+    uint16_t  size;
+    uint8_t   first;
+    uint8_t * data;
+} chunk_t;
+
+static chunk_t * chunks;
+static int num_chunks;
+static int max_chunks;
+static uint32_t total_bytes;
+
+static int num_callbacks;
+static uint8_t  attribute_value[0x10000];
+static uint32_t checksum;
+
+// btstack_debug.h
+void hci_dump_log(int log_level, const char * format, ...){
+    (void) log_level;
+    (void) format;
+}
+
+static void add_chunk(const uint8_t * data, uint16_t size, int first){
+    if (num_chunks == max_chunks){
+        max_chunks = max_chunks ? max_chunks * 2 : 256;
+        chunks = (chunk_t *) realloc(chunks, max_chunks * sizeof(chunk_t));
+    }
+    chunk_t * chunk = &chunks[num_chunks++];
+    chunk->size  = size;
+    chunk->first = first;
+    chunk->data  = (uint8_t *) malloc(size);
+    memcpy(chunk->data, data, size);
+    total_bytes += size;
+}
+
+static uint32_t read_net_32(FILE * file){
+    uint8_t buffer[4];
+    if (fread(buffer, 1, 4, file) != 4) return 0;
+    return big_endian_read_32(buffer, 0);
+}
+
+// L2CAP payload looks like complete ServiceSearchAttributeResponse
+static void handle_l2cap_payload(const uint8_t * payload, uint16_t size){
+    static int expect_continuation;
+    if (size < 8 || payload[0] != SDP_ServiceSearchAttributeResponse) return;
+    uint16_t parameter_length = big_endian_read_16(payload, 3);
+    uint16_t attribute_list_byte_count = big_endian_read_16(payload, 5);
+    if (parameter_length + 5 != size) return;
+    if (7 + attribute_list_byte_count >= size) return;
+    uint8_t continuation_state_len = payload[7 + attribute_list_byte_count];
+    if (8 + attribute_list_byte_count + continuation_state_len != size) return;
+    add_chunk(&payload[7], attribute_list_byte_count, !expect_continuation);
+    expect_continuation = continuation_state_len > 0;
+}
+
+static int load_pklg(const char * path){
+    FILE * file = fopen(path, "rb");
+    if (!file) return 0;
+    uint8_t packet[1100];
+    static uint8_t l2cap_buffer[0x10000];
+    uint16_t l2cap_pos = 0;
+    uint16_t l2cap_len = 0;
+    while (1){
+        uint32_t len = read_net_32(file);
+        read_net_32(file);
+        read_net_32(file);
+        int type = fgetc(file);
+        if (len < 9 || type < 0) break;
+        uint32_t packet_len = len - 9;
+        if (packet_len > sizeof(packet)) break;
+        if (fread(packet, 1, packet_len, file) != packet_len) break;
+        // received ACL packets only, single connection
+        if (type != 0x03 || packet_len < 4) continue;
+        uint16_t acl_len = little_endian_read_16(packet, 2);
+        if ((uint32_t) acl_len + 4 != packet_len) continue;
+        int packet_boundary = (packet[1] >> 4) & 0x03;
+        if (packet_boundary == 0x01){
+            // continuation fragment
+            if (l2cap_pos == 0 || l2cap_pos + acl_len > sizeof(l2cap_buffer)) continue;
+            memcpy(&l2cap_buffer[l2cap_pos], &packet[4], acl_len);
+            l2cap_pos += acl_len;
+        } else {
+            if (acl_len < 4) continue;
+            memcpy(l2cap_buffer, &packet[4], acl_len);
+            l2cap_pos = acl_len;
+            l2cap_len = little_endian_read_16(l2cap_buffer, 0) + 4;
+        }
+        if (l2cap_pos < l2cap_len) continue;
+        if (l2cap_pos == l2cap_len){
+            handle_l2cap_payload(&l2cap_buffer[4], l2cap_len - 4);
+        }
+        l2cap_pos = 0;
+    }
+    fclose(file);
+    return num_chunks;
+}
+
+// records with long service names and vendor specific attributes, split into MTU sized responses
+static void synthesize(void){
+    static uint8_t attribute_list[0x8000];
+    uint8_t blob[400];
+    char name[64];
+    int i;
+    for (i = 0; i < (int) sizeof(blob); i++){
+        blob[i] = (uint8_t) i;
+    }
+    de_create_sequence(attribute_list);
+    for (i = 0; i < SYNTHETIC_RECORDS; i++){
+        uint8_t * record = de_push_sequence(attribute_list);
+        de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_SERVICE_CLASS_ID_LIST);
+        uint8_t * service_classes = de_push_sequence(record);
+        de_add_number(service_classes, DE_UUID, DE_SIZE_16, i & 1 ? BLUETOOTH_SERVICE_CLASS_AUDIO_SOURCE : BLUETOOTH_SERVICE_CLASS_PHONEBOOK_ACCESS_PSE);
+        de_pop_sequence(record, service_classes);
+        de_add_number(record, DE_UINT, DE_SIZE_16, BLUETOOTH_ATTRIBUTE_PROTOCOL_DESCRIPTOR_LIST);
+        uint8_t * protocols = de_push_sequence(record);
+        uint8_t * l2cap = de_push_sequence(protocols);
+        de_add_number(l2cap, DE_UUID, DE_SIZE_16, BLUETOOTH_PROTOCOL_L2CAP);
+        de_add_number(l2cap, DE_UINT, DE_SIZE_16, BLUETOOTH_PROTOCOL_AVDTP);
+        de_pop_sequence(protocols, l2cap);
+        de_pop_sequence(record, protocols);
+        de_add_number(record, DE_UINT, DE_SIZE_16, 0x0100);
+        snprintf(name, sizeof(name), "Synthetic service record number %u with a long name", i);
+        de_add_data(record, DE_STRING, strlen(name), (uint8_t *) name);
+        de_add_number(record, DE_UINT, DE_SIZE_16, 0x0200 + i);
+        de_add_data(record, DE_STRING, sizeof(blob), blob);
+        de_pop_sequence(attribute_list, record);
+    }
+    uint32_t len = de_get_len(attribute_list);
+    uint32_t pos;
+    for (pos = 0; pos < len; pos += SYNTHETIC_CHUNK_SIZE){
+        add_chunk(&attribute_list[pos], btstack_min(SYNTHETIC_CHUNK_SIZE, len - pos), pos == 0);
+    }
+}
+
+// typical application handler: reassemble attribute values
+static void app_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    (void) packet_type;
+    (void) channel;
+    (void) size;
+    num_callbacks++;
+    switch (hci_event_packet_get_type(packet)){
+        case SDP_EVENT_QUERY_ATTRIBUTE_VALUE:
+            attribute_value[sdp_event_query_attribute_byte_get_data_offset(packet)] = sdp_event_query_attribute_byte_get_data(packet);
+            if (sdp_event_query_attribute_byte_get_data_offset(packet) + 1 == sdp_event_query_attribute_byte_get_attribute_length(packet)){
+                checksum += attribute_value[0] + sdp_event_query_attribute_byte_get_attribute_length(packet);
+            }
+            break;
+        case SDP_EVENT_QUERY_ATTRIBUTE_DATA:
+            memcpy(&attribute_value[sdp_event_query_attribute_data_get_data_offset(packet)], sdp_event_query_attribute_data_get_data(packet),
+                sdp_event_query_attribute_data_get_data_len(packet));
+            if (sdp_event_query_attribute_data_get_data_offset(packet) + sdp_event_query_attribute_data_get_data_len(packet) == sdp_event_query_attribute_data_get_attribute_length(packet)){
+                checksum += attribute_value[0] + sdp_event_query_attribute_data_get_attribute_length(packet);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static double now_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double replay(int attribute_data_mode, int iterations){
+    num_callbacks = 0;
+    checksum = 0;
+    double start = now_seconds();
+    int i, j;
+    for (i = 0; i < iterations; i++){
+        for (j = 0; j < num_chunks; j++){
+            if (chunks[j].first){
+                sdp_parser_init(&app_handler);
+                sdp_parser_set_attribute_data_mode(attribute_data_mode);
+            }
+            sdp_parser_handle_chunk(chunks[j].data, chunks[j].size);
+        }
+    }
+    return now_seconds() - start;
+}
+
+int main(int argc, const char * argv[]){
+    if (argc > 1){
+        if (!load_pklg(argv[1])){
+            printf("No SDP Service Search Attribute Responses in %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        synthesize();
+    }
+
+    int iterations = MIN_REPLAY_BYTES / total_bytes + 1;
+    printf("Replaying %u responses with %u bytes of attribute lists, %u times\n", num_chunks, total_bytes, iterations);
+
+    double byte_time = replay(0, iterations);
+    uint32_t byte_checksum = checksum;
+    printf("Attribute bytes: %9u callbacks, %6.2f ns per byte\n", num_callbacks, byte_time * 1e9 / ((double) total_bytes * iterations));
+
+    double data_time = replay(1, iterations);
+    printf("Attribute data:  %9u callbacks, %6.2f ns per byte\n", num_callbacks, data_time * 1e9 / ((double) total_bytes * iterations));
+
+    if (byte_checksum != checksum){
+        printf("Error: attribute values differ\n");
+        return 1;
+    }
+    int i;
+    for (i = 0; i < num_chunks; i++){
+        free(chunks[i].data);
+    }
+    free(chunks);
+    return 0;
+}
@@ -148,6 +148,11 @@ void gap_le_get_own_address(uint8_t * addr_type, bd_addr_t addr){
     memcpy(addr, dummy, 6);
 }
 
+void gap_le_get_own_address_for_con_handle(hci_con_handle_t con_handle, uint8_t * addr_type, bd_addr_t addr){
+    UNUSED(con_handle);
+    gap_le_get_own_address(addr_type, addr);
+}
+
 void hci_le_advertisements_set_params(uint16_t adv_int_min, uint16_t adv_int_max, uint8_t adv_type,
     uint8_t direct_address_typ, bd_addr_t direct_address, uint8_t channel_map, uint8_t filter_policy) {
  }
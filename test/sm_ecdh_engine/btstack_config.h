@@ -0,0 +1,24 @@
+//
+// btstack_config.h for ECDH engine test
+//
+
+#ifndef __BTSTACK_CONFIG
+#define __BTSTACK_CONFIG
+
+// Port related features
+#define HAVE_MALLOC
+#define HAVE_POSIX_TIME
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_LE_PERIPHERAL
+#define ENABLE_LE_CENTRAL
+#define ENABLE_LE_SECURE_CONNECTIONS
+#define ENABLE_LOG_ERROR
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 69
+#define MAX_NR_LE_DEVICE_DB_ENTRIES 4
+#define SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE 2
+
+#endif
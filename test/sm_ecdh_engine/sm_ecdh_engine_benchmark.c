@@ -0,0 +1,151 @@
+// DHKey benchmark for the posix ECDH engine
+//
+// Compares synchronous DHKey calculation on the run loop thread with the ECDH engine,
+// which only blocks the run loop to copy the request and to deliver the result.
+//
+// Usage: sm_ecdh_engine_benchmark [iterations]
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "btstack_config.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/sm.h"
+#include "sm_ecdh_engine_posix.h"
+
+// minimal run loop that lets the benchmark dispatch the engine's data source
+static btstack_data_source_t * benchmark_data_source;
+
+static void benchmark_run_loop_init(void){
+}
+static void benchmark_run_loop_add_data_source(btstack_data_source_t * ds){
+    benchmark_data_source = ds;
+}
+static int benchmark_run_loop_remove_data_source(btstack_data_source_t * ds){
+    if (benchmark_data_source != ds) return 0;
+    benchmark_data_source = NULL;
+    return 1;
+}
+static void benchmark_run_loop_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    ds->flags |= callbacks;
+}
+static void benchmark_run_loop_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    ds->flags &= ~callbacks;
+}
+static void benchmark_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    UNUSED(ts);
+    UNUSED(timeout_in_ms);
+}
+static void benchmark_run_loop_add_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+}
+static int benchmark_run_loop_remove_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    return 0;
+}
+static void benchmark_run_loop_execute(void){
+}
+static void benchmark_run_loop_dump_timer(void){
+}
+static uint32_t benchmark_run_loop_get_time_ms(void){
+    return 0;
+}
+
+static const btstack_run_loop_t benchmark_run_loop = {
+    &benchmark_run_loop_init,
+    &benchmark_run_loop_add_data_source,
+    &benchmark_run_loop_remove_data_source,
+    &benchmark_run_loop_enable_data_source_callbacks,
+    &benchmark_run_loop_disable_data_source_callbacks,
+    &benchmark_run_loop_set_timer,
+    &benchmark_run_loop_add_timer,
+    &benchmark_run_loop_remove_timer,
+    &benchmark_run_loop_execute,
+    &benchmark_run_loop_dump_timer,
+    &benchmark_run_loop_get_time_ms,
+};
+
+static int done_count;
+
+static void done_handler(void){
+    done_count++;
+}
+
+static uint32_t time_us(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t) (tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
+static int benchmark_rng(uint8_t * buffer, unsigned size){
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = read(fd, buffer, size) == (ssize_t) size;
+    close(fd);
+    return ok;
+}
+
+// dispatch engine completions until done handler was called
+static void wait_for_done(int expected_done_count){
+    while (done_count < expected_done_count){
+        fd_set descriptors;
+        FD_ZERO(&descriptors);
+        FD_SET(benchmark_data_source->fd, &descriptors);
+        if (select(benchmark_data_source->fd + 1, &descriptors, NULL, NULL, NULL) <= 0) continue;
+        benchmark_data_source->process(benchmark_data_source, DATA_SOURCE_CALLBACK_READ);
+    }
+}
+
+int main(int argc, const char * argv[]){
+    int iterations = 20;
+    if (argc > 1){
+        iterations = atoi(argv[1]);
+    }
+
+    btstack_run_loop_init(&benchmark_run_loop);
+    const sm_ecdh_engine_t * engine = sm_ecdh_engine_posix_instance();
+    if (!engine){
+        printf("ECDH engine could not be started\n");
+        return 1;
+    }
+
+    uint8_t local_q[64], local_d[32];
+    uint8_t remote_q[64], remote_d[32];
+    uint8_t dhkey[32];
+    if (!sm_ecdh_generate_keypair(local_q, local_d, &benchmark_rng)) return 1;
+    if (!sm_ecdh_generate_keypair(remote_q, remote_d, &benchmark_rng)) return 1;
+
+    // synchronous: run loop blocked for full calculation
+    int i;
+    uint32_t start = time_us();
+    for (i = 0; i < iterations; i++){
+        sm_ecdh_calculate_dhkey(remote_q, local_d, dhkey);
+    }
+    uint32_t sync_us = time_us() - start;
+
+    // engine: run loop only blocked for request and completion
+    uint32_t blocked_us = 0;
+    start = time_us();
+    for (i = 0; i < iterations; i++){
+        uint32_t call_start = time_us();
+        engine->calculate_dhkey(remote_q, local_d, dhkey, &done_handler);
+        blocked_us += time_us() - call_start;
+        wait_for_done(i + 1);
+    }
+    uint32_t engine_us = time_us() - start;
+
+    printf("DHKey: synchronous %u ops/s, %u us run loop blocked per op\n",
+        (unsigned) (iterations * 1000000ULL / sync_us), (unsigned) (sync_us / iterations));
+    printf("DHKey: engine      %u ops/s, %u us run loop blocked per op\n",
+        (unsigned) (iterations * 1000000ULL / engine_us), (unsigned) (blocked_us / iterations));
+
+    sm_ecdh_engine_posix_deinit();
+    return 0;
+}
@@ -0,0 +1,443 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "btstack_config.h"
+#include "btstack_event.h"
+#include "btstack_memory.h"
+#include "btstack_run_loop.h"
+#include "btstack_run_loop_posix.h"
+#include "btstack_util.h"
+#include "hci.h"
+#include "hci_cmd.h"
+#include "hci_transport.h"
+#include "l2cap.h"
+#include "ble/le_device_db.h"
+#include "ble/sm.h"
+#include "rijndael.h"
+
+// LE Secure Connections pairing with SM as responder, peer and controller are simulated.
+// The test ECDH engine queues requests, so the test decides when they complete.
+
+#define MOCK_QUEUE_SIZE   8
+#define MOCK_PACKET_SIZE  (HCI_INCOMING_PRE_BUFFER_SIZE + 260)
+#define MAX_SM_PDUS       8
+#define MAX_ENGINE_OPS    4
+
+#define TEST_CON_HANDLE   0x0040
+
+// controller
+
+static void (*mock_packet_handler)(uint8_t packet_type, uint8_t *packet, uint16_t size);
+static uint8_t  mock_queue_types[MOCK_QUEUE_SIZE];
+static uint16_t mock_queue_lens[MOCK_QUEUE_SIZE];
+static uint8_t  mock_queue_data[MOCK_QUEUE_SIZE][MOCK_PACKET_SIZE];
+static int      mock_queue_count;
+static int      mock_le_encrypt_count;
+
+// SM PDUs sent by host
+static uint8_t  sm_pdus[MAX_SM_PDUS][80];
+static int      sm_pdu_count;
+
+static void mock_enqueue(uint8_t packet_type, const uint8_t * packet, uint16_t size){
+    CHECK(mock_queue_count < MOCK_QUEUE_SIZE);
+    int pos = mock_queue_count++;
+    mock_queue_types[pos] = packet_type;
+    mock_queue_lens[pos]  = size;
+    memcpy(&mock_queue_data[pos][HCI_INCOMING_PRE_BUFFER_SIZE], packet, size);
+}
+
+static void mock_command_complete(uint16_t opcode, const uint8_t * return_parameters, int len){
+    uint8_t event[6 + 64];
+    event[0] = HCI_EVENT_COMMAND_COMPLETE;
+    event[1] = 4 + len;
+    event[2] = 1;
+    little_endian_store_16(event, 3, opcode);
+    event[5] = 0;
+    memcpy(&event[6], return_parameters, len);
+    mock_enqueue(HCI_EVENT_PACKET, event, 6 + len);
+}
+
+static int test_rng(uint8_t * buffer, unsigned size){
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = read(fd, buffer, size) == (ssize_t) size;
+    close(fd);
+    return ok;
+}
+
+static void mock_handle_command(uint8_t * packet){
+    uint16_t opcode = little_endian_read_16(packet, 0);
+    uint8_t  return_parameters[64];
+    uint8_t  features[] = { 0xff, 0xff, 0x8f, 0xfe, 0xdb, 0xff, 0x5b, 0x87 };
+    memset(return_parameters, 0, sizeof(return_parameters));
+    if (opcode == hci_read_bd_addr.opcode){
+        return_parameters[1] = 0x01;
+        mock_command_complete(opcode, return_parameters, 6);
+    } else if (opcode == hci_le_read_buffer_size.opcode){
+        little_endian_store_16(return_parameters, 0, HCI_ACL_PAYLOAD_SIZE);
+        return_parameters[2] = 4;
+        mock_command_complete(opcode, return_parameters, 3);
+    } else if (opcode == hci_read_local_supported_features.opcode){
+        memcpy(return_parameters, features, sizeof(features));
+        mock_command_complete(opcode, return_parameters, sizeof(features));
+    } else if (opcode == hci_read_local_version_information.opcode){
+        little_endian_store_16(return_parameters, 4, 0xffff);
+        mock_command_complete(opcode, return_parameters, 8);
+    } else if (opcode == hci_read_local_supported_commands.opcode){
+        mock_command_complete(opcode, return_parameters, 64);
+    } else if (opcode == hci_le_read_white_list_size.opcode){
+        return_parameters[0] = 8;
+        mock_command_complete(opcode, return_parameters, 1);
+    } else if (opcode == hci_le_rand.opcode){
+        test_rng(&return_parameters[1], 8);
+        mock_command_complete(opcode, return_parameters, 9);
+    } else if (opcode == hci_le_encrypt.opcode){
+        // key and plaintext in little endian
+        uint8_t key[16];
+        uint8_t plaintext[16];
+        uint8_t ciphertext[16];
+        reverse_128(&packet[3], key);
+        reverse_128(&packet[19], plaintext);
+        uint32_t rk[RKLENGTH(KEYBITS)];
+        int nrounds = rijndaelSetupEncrypt(rk, key, KEYBITS);
+        rijndaelEncrypt(rk, nrounds, plaintext, ciphertext);
+        reverse_128(ciphertext, &return_parameters[1]);
+        mock_command_complete(opcode, return_parameters, 17);
+        mock_le_encrypt_count++;
+    } else {
+        mock_command_complete(opcode, return_parameters, 1);
+    }
+}
+
+static void mock_handle_acl(uint8_t * packet, int size){
+    // single fragment L2CAP packets on SM channel
+    if (little_endian_read_16(packet, 6) != L2CAP_CID_SECURITY_MANAGER_PROTOCOL) return;
+    CHECK(sm_pdu_count < MAX_SM_PDUS);
+    memcpy(sm_pdus[sm_pdu_count++], &packet[8], size - 8);
+    // packet sent
+    uint8_t event[] = { HCI_EVENT_NUMBER_OF_COMPLETED_PACKETS, 5, 1, 0, 0, 1, 0};
+    little_endian_store_16(event, 3, little_endian_read_16(packet, 0) & 0x0fff);
+    mock_enqueue(HCI_EVENT_PACKET, event, sizeof(event));
+}
+
+static void mock_register_packet_handler(void (*handler)(uint8_t packet_type, uint8_t *packet, uint16_t size)){
+    mock_packet_handler = handler;
+}
+static int mock_send_packet(uint8_t packet_type, uint8_t * packet, int size){
+    switch (packet_type){
+        case HCI_COMMAND_DATA_PACKET:
+            mock_handle_command(packet);
+            break;
+        case HCI_ACL_DATA_PACKET:
+            mock_handle_acl(packet, size);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+static int mock_open(void){
+    return 0;
+}
+static int mock_close(void){
+    return 0;
+}
+
+static const hci_transport_t mock_transport = {
+    "mock", NULL, &mock_open, &mock_close, &mock_register_packet_handler, NULL, &mock_send_packet, NULL, NULL, NULL
+};
+
+// deliver queued packets until controller is idle
+static void mock_process(void){
+    while (mock_queue_count){
+        uint8_t  packet_type = mock_queue_types[0];
+        uint16_t size = mock_queue_lens[0];
+        uint8_t  packet[MOCK_PACKET_SIZE];
+        memcpy(packet, mock_queue_data[0], sizeof(packet));
+        mock_queue_count--;
+        memmove(&mock_queue_types[0], &mock_queue_types[1], mock_queue_count);
+        memmove(&mock_queue_lens[0],  &mock_queue_lens[1],  mock_queue_count * sizeof(uint16_t));
+        memmove(&mock_queue_data[0],  &mock_queue_data[1],  mock_queue_count * MOCK_PACKET_SIZE);
+        (*mock_packet_handler)(packet_type, &packet[HCI_INCOMING_PRE_BUFFER_SIZE], size);
+    }
+}
+
+static void mock_le_connection_complete(void){
+    uint8_t event[21];
+    memset(event, 0, sizeof(event));
+    event[0] = HCI_EVENT_LE_META;
+    event[1] = sizeof(event) - 2;
+    event[2] = HCI_SUBEVENT_LE_CONNECTION_COMPLETE;
+    little_endian_store_16(event, 4, TEST_CON_HANDLE);
+    event[6] = HCI_ROLE_SLAVE;
+    event[8] = 0x10;
+    little_endian_store_16(event, 14, 6);
+    little_endian_store_16(event, 18, 200);
+    mock_enqueue(HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+static void mock_disconnection_complete(void){
+    uint8_t event[] = { HCI_EVENT_DISCONNECTION_COMPLETE, 4, 0, 0, 0, 0x13};
+    little_endian_store_16(event, 3, TEST_CON_HANDLE);
+    mock_enqueue(HCI_EVENT_PACKET, event, sizeof(event));
+    mock_process();
+}
+
+// peer
+
+static uint8_t peer_q[64];
+static uint8_t peer_d[32];
+
+static void peer_send_pdu(const uint8_t * pdu, uint16_t len){
+    uint8_t packet[8 + 65];
+    little_endian_store_16(packet, 0, TEST_CON_HANDLE | 0x2000);
+    little_endian_store_16(packet, 2, 4 + len);
+    little_endian_store_16(packet, 4, len);
+    little_endian_store_16(packet, 6, L2CAP_CID_SECURITY_MANAGER_PROTOCOL);
+    memcpy(&packet[8], pdu, len);
+    mock_enqueue(HCI_ACL_DATA_PACKET, packet, 8 + len);
+    mock_process();
+}
+
+static void peer_send_pairing_request(void){
+    uint8_t pdu[] = { SM_CODE_PAIRING_REQUEST, IO_CAPABILITY_NO_INPUT_NO_OUTPUT, 0, SM_AUTHREQ_SECURE_CONNECTION, 16, 0, 0 };
+    peer_send_pdu(pdu, sizeof(pdu));
+}
+
+static void peer_send_public_key(void){
+    uint8_t pdu[65];
+    pdu[0] = SM_CODE_PAIRING_PUBLIC_KEY;
+    reverse_256(&peer_q[0],  &pdu[1]);
+    reverse_256(&peer_q[32], &pdu[33]);
+    peer_send_pdu(pdu, sizeof(pdu));
+}
+
+static void peer_send_pairing_random(void){
+    uint8_t pdu[17];
+    pdu[0] = SM_CODE_PAIRING_RANDOM;
+    test_rng(&pdu[1], 16);
+    peer_send_pdu(pdu, sizeof(pdu));
+}
+
+static int sm_pdu_sent(uint8_t code){
+    int i;
+    for (i = 0; i < sm_pdu_count; i++){
+        if (sm_pdus[i][0] == code) return i + 1;
+    }
+    return 0;
+}
+
+static void sm_public_key(uint8_t * public_key){
+    int pos = sm_pdu_sent(SM_CODE_PAIRING_PUBLIC_KEY);
+    CHECK(pos > 0);
+    reverse_256(&sm_pdus[pos - 1][1],  &public_key[0]);
+    reverse_256(&sm_pdus[pos - 1][33], &public_key[32]);
+}
+
+// ECDH engine
+
+typedef struct {
+    int dhkey;
+    uint8_t public_key[64];
+    uint8_t private_key[32];
+    uint8_t * public_key_out;
+    uint8_t * private_key_out;
+    uint8_t * dhkey_out;
+    void (*done)(void);
+} engine_op_t;
+
+static engine_op_t engine_ops[MAX_ENGINE_OPS];
+static int engine_op_count;
+static int engine_keypair_requests;
+static int engine_dhkey_requests;
+
+static void test_engine_generate_keypair(uint8_t * public_key, uint8_t * private_key, void (*done)(void)){
+    CHECK(engine_op_count < MAX_ENGINE_OPS);
+    engine_op_t * op = &engine_ops[engine_op_count++];
+    memset(op, 0, sizeof(engine_op_t));
+    op->public_key_out = public_key;
+    op->private_key_out = private_key;
+    op->done = done;
+    engine_keypair_requests++;
+}
+
+static void test_engine_calculate_dhkey(const uint8_t * public_key, const uint8_t * private_key, uint8_t * dhkey, void (*done)(void)){
+    CHECK(engine_op_count < MAX_ENGINE_OPS);
+    engine_op_t * op = &engine_ops[engine_op_count++];
+    memset(op, 0, sizeof(engine_op_t));
+    op->dhkey = 1;
+    memcpy(op->public_key, public_key, 64);
+    memcpy(op->private_key, private_key, 32);
+    op->dhkey_out = dhkey;
+    op->done = done;
+    engine_dhkey_requests++;
+}
+
+static const sm_ecdh_engine_t test_engine = {
+    &test_engine_generate_keypair,
+    &test_engine_calculate_dhkey,
+};
+
+static void engine_complete(void){
+    CHECK(engine_op_count > 0);
+    engine_op_t op = engine_ops[0];
+    engine_op_count--;
+    memmove(&engine_ops[0], &engine_ops[1], engine_op_count * sizeof(engine_op_t));
+    if (op.dhkey){
+        CHECK_EQUAL(1, sm_ecdh_calculate_dhkey(op.public_key, op.private_key, op.dhkey_out));
+    } else {
+        CHECK_EQUAL(1, sm_ecdh_generate_keypair(op.public_key_out, op.private_key_out, &test_rng));
+    }
+    (*op.done)();
+    mock_process();
+}
+
+// pairing up to DHKey calculation
+static void pair_until_dhkey(void){
+    sm_pdu_count = 0;
+    CHECK_EQUAL(1, sm_ecdh_generate_keypair(peer_q, peer_d, &test_rng));
+    peer_send_pairing_request();
+    CHECK(sm_pdu_sent(SM_CODE_PAIRING_RESPONSE));
+    peer_send_public_key();
+    CHECK(sm_pdu_sent(SM_CODE_PAIRING_PUBLIC_KEY));
+    CHECK(sm_pdu_sent(SM_CODE_PAIRING_CONFIRM));
+    peer_send_pairing_random();
+    CHECK(sm_pdu_sent(SM_CODE_PAIRING_RANDOM));
+}
+
+static btstack_packet_callback_registration_t sm_event_callback_registration;
+
+static void sm_event_handler(uint8_t packet_type, uint16_t channel, uint8_t *packet, uint16_t size){
+    UNUSED(channel);
+    UNUSED(size);
+    if (packet_type != HCI_EVENT_PACKET) return;
+    if (hci_event_packet_get_type(packet) != SM_EVENT_JUST_WORKS_REQUEST) return;
+    sm_just_works_confirm(sm_event_just_works_request_get_handle(packet));
+}
+
+TEST_GROUP(SMECDHEnginePairing){
+    void setup(void){
+        mock_queue_count = 0;
+        mock_le_encrypt_count = 0;
+        sm_pdu_count = 0;
+        engine_op_count = 0;
+        engine_keypair_requests = 0;
+        engine_dhkey_requests = 0;
+
+        btstack_memory_init();
+        hci_init(&mock_transport, NULL);
+        l2cap_init();
+        le_device_db_init();
+        sm_init();
+        sm_set_ecdh_engine(&test_engine);
+        sm_set_io_capabilities(IO_CAPABILITY_NO_INPUT_NO_OUTPUT);
+        sm_set_authentication_requirements(SM_AUTHREQ_SECURE_CONNECTION);
+        sm_event_callback_registration.callback = &sm_event_handler;
+        sm_add_event_handler(&sm_event_callback_registration);
+        hci_power_control(HCI_POWER_ON);
+        mock_process();
+
+        // initial keypair
+        CHECK_EQUAL(1, engine_keypair_requests);
+        engine_complete();
+        mock_le_connection_complete();
+    }
+    void teardown(void){
+        while (engine_op_count){
+            engine_complete();
+        }
+        sm_set_ec_keypair_rotation(0);
+        hci_close();
+    }
+};
+
+TEST(SMECDHEnginePairing, DHKeyCalculatedByEngine){
+    pair_until_dhkey();
+    // SM waits in SM_SC_W4_CALCULATE_DHKEY
+    CHECK_EQUAL(1, engine_dhkey_requests);
+    CHECK_EQUAL(1, engine_op_count);
+    MEMCMP_EQUAL(peer_q, engine_ops[0].public_key, 64);
+    int le_encrypt_count = mock_le_encrypt_count;
+    mock_process();
+    CHECK_EQUAL(le_encrypt_count, mock_le_encrypt_count);
+
+    uint8_t * dhkey = engine_ops[0].dhkey_out;
+    engine_complete();
+
+    // DHKey matches peer's DHKey
+    uint8_t sm_q[64];
+    uint8_t peer_dhkey[32];
+    sm_public_key(sm_q);
+    CHECK_EQUAL(1, sm_ecdh_calculate_dhkey(sm_q, peer_d, peer_dhkey));
+    MEMCMP_EQUAL(peer_dhkey, dhkey, 32);
+
+    // f5 uses AES
+    CHECK(mock_le_encrypt_count > le_encrypt_count);
+}
+
+TEST(SMECDHEnginePairing, DHKeyOfAbortedPairingDropped){
+    pair_until_dhkey();
+    CHECK_EQUAL(1, engine_op_count);
+    uint8_t aborted_peer_q[64];
+    memcpy(aborted_peer_q, peer_q, 64);
+
+    // new connection reuses the connection handle
+    mock_disconnection_complete();
+    mock_le_connection_complete();
+    pair_until_dhkey();
+
+    // new calculation waits for the pending one
+    CHECK_EQUAL(1, engine_dhkey_requests);
+    int le_encrypt_count = mock_le_encrypt_count;
+    engine_complete();
+
+    // result dropped, new calculation started
+    CHECK_EQUAL(le_encrypt_count, mock_le_encrypt_count);
+    CHECK_EQUAL(2, engine_dhkey_requests);
+    CHECK_EQUAL(1, engine_op_count);
+    MEMCMP_EQUAL(peer_q, engine_ops[0].public_key, 64);
+    CHECK(memcmp(aborted_peer_q, engine_ops[0].public_key, 64) != 0);
+
+    engine_complete();
+    CHECK(mock_le_encrypt_count > le_encrypt_count);
+}
+
+TEST(SMECDHEnginePairing, KeypairRotation){
+    sm_set_ec_keypair_rotation(2);
+    uint8_t first_q[64];
+    uint8_t sm_q[64];
+
+    // pairing attempts count once the setup context is released
+    pair_until_dhkey();
+    sm_public_key(first_q);
+    engine_complete();
+    mock_disconnection_complete();
+    CHECK_EQUAL(1, engine_keypair_requests);
+
+    mock_le_connection_complete();
+    pair_until_dhkey();
+    sm_public_key(sm_q);
+    MEMCMP_EQUAL(first_q, sm_q, 64);
+    engine_complete();
+    mock_disconnection_complete();
+
+    // new keypair after second pairing
+    CHECK_EQUAL(2, engine_keypair_requests);
+    engine_complete();
+
+    mock_le_connection_complete();
+    pair_until_dhkey();
+    sm_public_key(sm_q);
+    CHECK(memcmp(first_q, sm_q, 64) != 0);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(btstack_run_loop_posix_get_instance());
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
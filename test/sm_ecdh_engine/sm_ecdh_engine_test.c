@@ -0,0 +1,169 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include "btstack_config.h"
+#include "btstack_run_loop.h"
+#include "btstack_util.h"
+#include "ble/sm.h"
+#include "sm_ecdh_engine_posix.h"
+
+// minimal run loop that lets the test dispatch the engine's data source
+static btstack_data_source_t * test_data_source;
+
+static void test_run_loop_init(void){
+}
+static void test_run_loop_add_data_source(btstack_data_source_t * ds){
+    test_data_source = ds;
+}
+static int test_run_loop_remove_data_source(btstack_data_source_t * ds){
+    if (test_data_source != ds) return 0;
+    test_data_source = NULL;
+    return 1;
+}
+static void test_run_loop_enable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    ds->flags |= callbacks;
+}
+static void test_run_loop_disable_data_source_callbacks(btstack_data_source_t * ds, uint16_t callbacks){
+    ds->flags &= ~callbacks;
+}
+static void test_run_loop_set_timer(btstack_timer_source_t * ts, uint32_t timeout_in_ms){
+    UNUSED(ts);
+    UNUSED(timeout_in_ms);
+}
+static void test_run_loop_add_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+}
+static int test_run_loop_remove_timer(btstack_timer_source_t * ts){
+    UNUSED(ts);
+    return 0;
+}
+static void test_run_loop_execute(void){
+}
+static void test_run_loop_dump_timer(void){
+}
+static uint32_t test_run_loop_get_time_ms(void){
+    return 0;
+}
+
+static const btstack_run_loop_t test_run_loop = {
+    &test_run_loop_init,
+    &test_run_loop_add_data_source,
+    &test_run_loop_remove_data_source,
+    &test_run_loop_enable_data_source_callbacks,
+    &test_run_loop_disable_data_source_callbacks,
+    &test_run_loop_set_timer,
+    &test_run_loop_add_timer,
+    &test_run_loop_remove_timer,
+    &test_run_loop_execute,
+    &test_run_loop_dump_timer,
+    &test_run_loop_get_time_ms,
+};
+
+static int done_count;
+
+static void done_handler(void){
+    done_count++;
+}
+
+static int test_rng(uint8_t * buffer, unsigned size){
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = read(fd, buffer, size) == (ssize_t) size;
+    close(fd);
+    return ok;
+}
+
+// dispatch engine completions until done handler was called
+static void wait_for_done(int expected_done_count){
+    int rounds;
+    for (rounds = 0; rounds < 100 && done_count < expected_done_count; rounds++){
+        CHECK(test_data_source != NULL);
+        fd_set descriptors;
+        FD_ZERO(&descriptors);
+        FD_SET(test_data_source->fd, &descriptors);
+        struct timeval timeout = { 0, 100000 };
+        if (select(test_data_source->fd + 1, &descriptors, NULL, NULL, &timeout) <= 0) continue;
+        test_data_source->process(test_data_source, DATA_SOURCE_CALLBACK_READ);
+    }
+    CHECK_EQUAL(expected_done_count, done_count);
+}
+
+TEST_GROUP(SMECDHEngine){
+    const sm_ecdh_engine_t * engine;
+    void setup(void){
+        done_count = 0;
+        engine = sm_ecdh_engine_posix_instance();
+        CHECK(engine != NULL);
+        sm_ecdh_engine_posix_reset_stats();
+    }
+    void teardown(void){
+        sm_ecdh_engine_posix_deinit();
+        CHECK(test_data_source == NULL);
+    }
+};
+
+TEST(SMECDHEngine, DHKeyMatchesSynchronousCalculation){
+    uint8_t local_q[64], local_d[32];
+    uint8_t remote_q[64], remote_d[32];
+    uint8_t expected_dhkey[32];
+    uint8_t dhkey[32];
+    CHECK_EQUAL(1, sm_ecdh_generate_keypair(local_q, local_d, &test_rng));
+    CHECK_EQUAL(1, sm_ecdh_generate_keypair(remote_q, remote_d, &test_rng));
+    CHECK_EQUAL(1, sm_ecdh_calculate_dhkey(local_q, remote_d, expected_dhkey));
+
+    engine->calculate_dhkey(remote_q, local_d, dhkey, &done_handler);
+    // input is copied, done is only called from run loop
+    memset(remote_q, 0, sizeof(remote_q));
+    memset(local_d, 0, sizeof(local_d));
+    CHECK_EQUAL(0, done_count);
+    wait_for_done(1);
+    MEMCMP_EQUAL(expected_dhkey, dhkey, 32);
+
+    sm_ecdh_engine_posix_stats_t stats;
+    sm_ecdh_engine_posix_get_stats(&stats);
+    CHECK_EQUAL(1, stats.dhkeys_calculated);
+}
+
+TEST(SMECDHEngine, GeneratedKeypairIsValid){
+    uint8_t local_q[64], local_d[32];
+    uint8_t remote_q[64], remote_d[32];
+    uint8_t dhkey_local[32], dhkey_remote[32];
+    engine->generate_keypair(local_q, local_d, &done_handler);
+    CHECK_EQUAL(0, done_count);
+    wait_for_done(1);
+
+    CHECK_EQUAL(1, sm_ecdh_generate_keypair(remote_q, remote_d, &test_rng));
+    CHECK_EQUAL(1, sm_ecdh_calculate_dhkey(remote_q, local_d, dhkey_local));
+    CHECK_EQUAL(1, sm_ecdh_calculate_dhkey(local_q, remote_d, dhkey_remote));
+    MEMCMP_EQUAL(dhkey_local, dhkey_remote, 32);
+}
+
+TEST(SMECDHEngine, KeypairFromPool){
+    uint8_t local_q[64], local_d[32];
+    sm_ecdh_engine_posix_stats_t stats;
+    int rounds;
+    // idle worker fills pool
+    for (rounds = 0; rounds < 500; rounds++){
+        sm_ecdh_engine_posix_get_stats(&stats);
+        if (stats.keypairs_generated >= SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE) break;
+        usleep(10000);
+    }
+    CHECK(stats.keypairs_generated >= SM_ECDH_ENGINE_POSIX_KEYPAIR_POOL_SIZE);
+
+    engine->generate_keypair(local_q, local_d, &done_handler);
+    wait_for_done(1);
+    sm_ecdh_engine_posix_get_stats(&stats);
+    CHECK_EQUAL(1, stats.keypairs_from_pool);
+}
+
+int main (int argc, const char * argv[]){
+    btstack_run_loop_init(&test_run_loop);
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
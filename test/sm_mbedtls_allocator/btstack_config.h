@@ -0,0 +1,21 @@
+//
+// btstack_config.h for mbedtls allocator test, uses sm_mbedtls_allocator instead of malloc
+//
+
+#ifndef __BTSTACK_CONFIG
+#define __BTSTACK_CONFIG
+
+// Port related features
+#define HAVE_POSIX_FILE_IO
+
+// BTstack features that can be enabled
+#define ENABLE_BLE
+#define ENABLE_LE_SECURE_CONNECTIONS
+#define ENABLE_LOG_ERROR
+
+#define USE_MBEDTLS_FOR_ECDH
+
+// BTstack configuration. buffers, sizes, ...
+#define HCI_ACL_PAYLOAD_SIZE 52
+
+#endif
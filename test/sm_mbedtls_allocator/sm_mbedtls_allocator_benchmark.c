@@ -0,0 +1,95 @@
+//
+// Benchmark mbedtls_ecp_mul on P-256 with sm_mbedtls_allocator
+// Build with sm_mbedtls_allocator_first_fit.c to compare with previous allocator
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "btstack_config.h"
+#include "mbedtls/config.h"
+#include "mbedtls/ecp.h"
+#include "ble/sm_mbedtls_allocator.h"
+
+#define ITERATIONS 20
+#define ROUNDS     5
+
+// MBEDTLS_ALLOC_BUFFER_SIZE in sm.c, first-fit allocator is built with its previous size
+#ifndef MBEDTLS_ALLOC_BUFFER_SIZE
+#define MBEDTLS_ALLOC_BUFFER_SIZE (820+18*sizeof(void *))
+#endif
+static uint8_t mbedtls_memory_buffer[MBEDTLS_ALLOC_BUFFER_SIZE];
+
+static const char * private_a_string = "3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd";
+static const char * public_bx_string = "1ea1f0f01faf1d9609592284f19e4c0047b58afd8615a69f559077b22faaa190";
+static const char * public_by_string = "4c55f33e429dad377356703a9ab85160472d1130e28e36765f89aff915b1214a";
+static const char * dh_key_string    = "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698";
+
+static uint32_t time_us(void){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint32_t) (tv.tv_sec * 1000000 + tv.tv_usec);
+}
+
+// da * Pb
+static int calculate_dhkey(mbedtls_ecp_group * grp){
+    int ok;
+    sm_mbedtls_allocator_scope_begin();
+    mbedtls_mpi d;
+    mbedtls_mpi dh_key;
+    mbedtls_ecp_point Q;
+    mbedtls_ecp_point DH;
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&dh_key);
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_ecp_point_init(&DH);
+    mbedtls_mpi_read_string(&d,   16, private_a_string);
+    mbedtls_mpi_read_string(&Q.X, 16, public_bx_string);
+    mbedtls_mpi_read_string(&Q.Y, 16, public_by_string);
+    mbedtls_mpi_lset(&Q.Z, 1);
+    mbedtls_mpi_read_string(&dh_key, 16, dh_key_string);
+    ok = mbedtls_ecp_mul(grp, &DH, &d, &Q, NULL, NULL) == 0 && mbedtls_mpi_cmp_mpi(&DH.X, &dh_key) == 0;
+    mbedtls_ecp_point_free(&DH);
+    mbedtls_ecp_point_free(&Q);
+    mbedtls_mpi_free(&dh_key);
+    mbedtls_mpi_free(&d);
+    sm_mbedtls_allocator_scope_end();
+    return ok;
+}
+
+int main(int argc, const char * argv[]){
+    (void) argc;
+    mbedtls_ecp_group grp;
+    sm_mbedtls_allocator_stats_t stats;
+    int i;
+
+    sm_mbedtls_allocator_init(mbedtls_memory_buffer, sizeof(mbedtls_memory_buffer));
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+
+    // report best round to reduce noise
+    uint32_t duration_us = 0xffffffff;
+    int round;
+    for (round = 0; round < ROUNDS; round++){
+        uint32_t start = time_us();
+        for (i = 0; i < ITERATIONS; i++){
+            if (!calculate_dhkey(&grp)){
+                printf("%s: DHKey calculation failed\n", argv[0]);
+                return 1;
+            }
+        }
+        uint32_t round_us = time_us() - start;
+        if (round_us < duration_us){
+            duration_us = round_us;
+        }
+    }
+
+    sm_mbedtls_allocator_get_stats(&stats);
+    printf("%s: %u us per mbedtls_ecp_mul, %u allocations per operation, peak %u bytes data, %u bytes arena\n",
+        argv[0], (unsigned) (duration_us / ITERATIONS), (unsigned) (stats.allocations_total / (ITERATIONS * ROUNDS)),
+        (unsigned) stats.bytes_max, (unsigned) stats.arena_max);
+    mbedtls_ecp_group_free(&grp);
+    return 0;
+}
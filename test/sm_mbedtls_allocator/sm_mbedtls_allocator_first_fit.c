@@ -0,0 +1,157 @@
+//
+// Previous first-fit allocator with coalescing free list, used as reference by the benchmark
+//
+
+#include "btstack_config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ble/sm_mbedtls_allocator.h"
+#include "btstack_util.h"
+
+typedef struct sm_allocator_node {
+    uint32_t next;  // offset from sm_allocator_buffer, 0 == last item
+    uint32_t size;  // size of free chunk incl. header
+} sm_allocator_node_t;
+
+static uint32_t   sm_allocator_size;
+static uint8_t  * sm_allocator_buffer;
+static sm_mbedtls_allocator_stats_t sm_allocator_stats;
+
+static sm_allocator_node_t * sm_mbedtls_node_for_offset(uint32_t offset){
+    return (sm_allocator_node_t *) (sm_allocator_buffer + offset);
+}
+
+// walk free list to track highest used offset, as done by previous allocator on every allocation
+static void sm_mbedtls_allocator_update_max(void){
+    uint32_t current_pos = 0;
+    sm_allocator_node_t * current = sm_mbedtls_node_for_offset(current_pos);
+    while (1){
+        if (current_pos + 8 > sm_allocator_stats.arena_max) {
+            sm_allocator_stats.arena_max = current_pos + 8;
+        }
+        current_pos = current->next;
+        current = sm_mbedtls_node_for_offset(current_pos);
+        if (current_pos == 0) break;
+    }
+}
+
+static void * sm_mbedtls_allocator_use(uint32_t current_pos, size_t total){
+    sm_allocator_node_t * current = sm_mbedtls_node_for_offset(current_pos);
+    memset(current, 0, total);
+    *(uint32_t*)current = total;
+    sm_mbedtls_allocator_update_max();
+    return &sm_allocator_buffer[current_pos + sizeof(void *)];
+}
+
+void * sm_mbedtls_allocator_calloc(size_t count, size_t size){
+    size_t num_bytes = count * size;
+    size_t total = num_bytes + sizeof(void *);
+    uint32_t prev_pos, current_pos, node_pos;
+    sm_allocator_node_t * prev, * current, * node;
+
+    sm_allocator_stats.bytes_current += num_bytes;
+    sm_allocator_stats.bytes_max = btstack_max(sm_allocator_stats.bytes_max, sm_allocator_stats.bytes_current);
+    sm_allocator_stats.allocations_current++;
+    sm_allocator_stats.allocations_total++;
+
+    // find exact block
+    prev_pos = 0;
+    prev    = sm_mbedtls_node_for_offset(prev_pos);
+    current_pos = prev->next;
+    while (current_pos){
+        current = sm_mbedtls_node_for_offset(current_pos);
+        if (current->size == total){
+            prev->next = current->next;
+            return sm_mbedtls_allocator_use(current_pos, total);
+        }
+        prev = current;
+        current_pos = current->next;
+    }
+    // find first large enough block
+    prev_pos = 0;
+    prev    = sm_mbedtls_node_for_offset(prev_pos);
+    current_pos = prev->next;
+    while (current_pos){
+        current = sm_mbedtls_node_for_offset(current_pos);
+        if (current->size > total){
+            node_pos = current_pos + total;
+            node = sm_mbedtls_node_for_offset(node_pos);
+            node->next = current->next;
+            node->size = current->size - total;
+            prev->next = node_pos;
+            return sm_mbedtls_allocator_use(current_pos, total);
+        }
+        prev = current;
+        current_pos = current->next;
+    }
+    sm_allocator_stats.allocations_failed++;
+    return NULL;
+}
+
+void sm_mbedtls_allocator_free(void * data){
+    uint32_t prev_pos, current_pos, next_pos;
+    sm_allocator_node_t * current, * prev, * next;
+    if (!data) return;
+    current = (sm_allocator_node_t*) (((uint8_t *) data) - sizeof(void *));
+    current_pos = ((uint8_t *) current) - ((uint8_t *) sm_allocator_buffer);
+    size_t total = *(uint32_t*) current;
+    sm_allocator_stats.bytes_current -= total - sizeof(void *);
+    sm_allocator_stats.allocations_current--;
+
+    // find previous node
+    prev_pos = 0;
+    prev = sm_mbedtls_node_for_offset(prev_pos);
+    while (prev->next && prev->next < current_pos){
+        prev_pos = prev->next;
+        prev = sm_mbedtls_node_for_offset(prev_pos);
+    }
+
+    // setup new node
+    current->next = prev->next;
+    current->size = total;
+    prev->next = current_pos;
+
+    // merge with previous ?
+    if (prev_pos + prev->size == current_pos){
+        prev->size += current->size;
+        prev->next  = current->next;
+        current = prev;
+        current_pos = prev_pos;
+    }
+
+    // merge with next node?
+    next_pos = current->next;
+    if (current_pos + current->size == next_pos){
+        next = sm_mbedtls_node_for_offset(next_pos);
+        current->size += next->size;
+        current->next  = next->next;
+    }
+}
+
+void sm_mbedtls_allocator_init(uint8_t * buffer, uint32_t size){
+    sm_allocator_buffer = buffer;
+    sm_allocator_size = size;
+    sm_allocator_node_t * anchor = sm_mbedtls_node_for_offset(0);
+    anchor->next = sizeof(sm_allocator_node_t);
+    anchor->size = 0;
+    sm_allocator_node_t * first = sm_mbedtls_node_for_offset(anchor->next);
+    first->next = 0;
+    first->size = size - sizeof(sm_allocator_node_t);
+    memset(&sm_allocator_stats, 0, sizeof(sm_allocator_stats));
+    sm_allocator_stats.arena_size = sm_allocator_size;
+}
+
+void sm_mbedtls_allocator_scope_begin(void){
+}
+
+void sm_mbedtls_allocator_scope_end(void){
+}
+
+void sm_mbedtls_allocator_get_stats(sm_mbedtls_allocator_stats_t * stats){
+    *stats = sm_allocator_stats;
+}
+
+void sm_mbedtls_allocator_status(void){
+}
@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "btstack_config.h"
+#include "ble/sm_mbedtls_allocator.h"
+#include "mbedtls/config.h"
+#include "mbedtls/ecp.h"
+
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+// matches MBEDTLS_ALLOC_BUFFER_SIZE in sm.c
+static uint8_t mbedtls_memory_buffer[820 + 18 * sizeof(void *)];
+
+#define HEADER_SIZE sizeof(void *)
+
+static uint32_t offset_for_buffer(void * buffer){
+	return (uint8_t*)buffer - mbedtls_memory_buffer;
+}
+
+static sm_mbedtls_allocator_stats_t get_stats(void){
+	sm_mbedtls_allocator_stats_t stats;
+	sm_mbedtls_allocator_get_stats(&stats);
+	return stats;
+}
+
+TEST_GROUP(sm_mbedtls_allocator_test){
+	void setup(void){
+		memset(mbedtls_memory_buffer, 0x55, sizeof(mbedtls_memory_buffer));
+		sm_mbedtls_allocator_init(mbedtls_memory_buffer, sizeof(mbedtls_memory_buffer));
+	}
+};
+
+TEST(sm_mbedtls_allocator_test, init){
+	sm_mbedtls_allocator_stats_t stats = get_stats();
+	CHECK_EQUAL(sizeof(mbedtls_memory_buffer), stats.arena_size);
+	CHECK_EQUAL(HEADER_SIZE, stats.arena_used);
+	CHECK_EQUAL(0, stats.allocations_current);
+}
+
+TEST(sm_mbedtls_allocator_test, alloc_bump){
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,8);
+	void * buffer2 = sm_mbedtls_allocator_calloc(3,4);
+	void * buffer3 = sm_mbedtls_allocator_calloc(1,8);
+	CHECK_EQUAL(2 * HEADER_SIZE, offset_for_buffer(buffer1));
+	CHECK_EQUAL(3 * HEADER_SIZE + 8, offset_for_buffer(buffer2));
+	// rounded up to 16 bytes
+	CHECK_EQUAL(4 * HEADER_SIZE + 24, offset_for_buffer(buffer3));
+	CHECK_EQUAL(3, get_stats().allocations_current);
+	CHECK_EQUAL(32, get_stats().bytes_current);
+}
+
+TEST(sm_mbedtls_allocator_test, calloc_clears){
+	uint8_t zeros[24];
+	memset(zeros, 0, sizeof(zeros));
+	void * buffer1 = sm_mbedtls_allocator_calloc(3,8);
+	memset(buffer1, 0xff, 24);
+	sm_mbedtls_allocator_calloc(1,8);
+	sm_mbedtls_allocator_free(buffer1);
+	void * buffer2 = sm_mbedtls_allocator_calloc(3,8);
+	POINTERS_EQUAL(buffer1, buffer2);
+	MEMCMP_EQUAL(zeros, buffer2, 24);
+}
+
+TEST(sm_mbedtls_allocator_test, free_last_block_returns_to_arena){
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,8);
+	void * buffer2 = sm_mbedtls_allocator_calloc(2,8);
+	sm_mbedtls_allocator_free(buffer2);
+	CHECK_EQUAL(offset_for_buffer(buffer1) + 8, get_stats().arena_used);
+	void * buffer3 = sm_mbedtls_allocator_calloc(1,8);
+	POINTERS_EQUAL(buffer2, buffer3);
+}
+
+TEST(sm_mbedtls_allocator_test, reuse_same_size_class){
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,8);
+	void * buffer2 = sm_mbedtls_allocator_calloc(2,8);
+	void * buffer3 = sm_mbedtls_allocator_calloc(1,8);
+	sm_mbedtls_allocator_free(buffer1);
+	sm_mbedtls_allocator_free(buffer2);
+	// 16 bytes from free list, not from arena
+	uint32_t arena_used = get_stats().arena_used;
+	POINTERS_EQUAL(buffer2, sm_mbedtls_allocator_calloc(2,8));
+	POINTERS_EQUAL(buffer1, sm_mbedtls_allocator_calloc(1,8));
+	CHECK_EQUAL(arena_used, get_stats().arena_used);
+	sm_mbedtls_allocator_free(buffer3);
+}
+
+TEST(sm_mbedtls_allocator_test, larger_block_when_arena_full){
+	void * buffer1 = sm_mbedtls_allocator_calloc(4,8);
+	void * filler = sm_mbedtls_allocator_calloc(1, (sizeof(mbedtls_memory_buffer) - get_stats().arena_used - HEADER_SIZE) & ~7);
+	CHECK(filler != NULL);
+	sm_mbedtls_allocator_free(buffer1);
+	POINTERS_EQUAL(buffer1, sm_mbedtls_allocator_calloc(1,8));
+	POINTERS_EQUAL(NULL, sm_mbedtls_allocator_calloc(1,8));
+	CHECK_EQUAL(1, get_stats().allocations_failed);
+}
+
+TEST(sm_mbedtls_allocator_test, large_blocks){
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,400);
+	void * buffer2 = sm_mbedtls_allocator_calloc(1,8);
+	sm_mbedtls_allocator_free(buffer1);
+	POINTERS_EQUAL(buffer1, sm_mbedtls_allocator_calloc(1,300));
+	sm_mbedtls_allocator_free(buffer2);
+}
+
+TEST(sm_mbedtls_allocator_test, scope_releases_arena){
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,8);
+	uint32_t arena_used = get_stats().arena_used;
+	sm_mbedtls_allocator_scope_begin();
+	void * buffer2 = sm_mbedtls_allocator_calloc(2,8);
+	void * buffer3 = sm_mbedtls_allocator_calloc(1,8);
+	sm_mbedtls_allocator_free(buffer2);
+	sm_mbedtls_allocator_free(buffer1);
+	sm_mbedtls_allocator_free(buffer3);
+	sm_mbedtls_allocator_scope_end();
+	CHECK_EQUAL(arena_used, get_stats().arena_used);
+	// block from before scope still on free list
+	POINTERS_EQUAL(buffer1, sm_mbedtls_allocator_calloc(1,8));
+	// block from scope not on free list anymore
+	CHECK_EQUAL(arena_used + HEADER_SIZE, offset_for_buffer(sm_mbedtls_allocator_calloc(2,8)));
+}
+
+TEST(sm_mbedtls_allocator_test, scope_keeps_live_blocks){
+	sm_mbedtls_allocator_scope_begin();
+	void * buffer1 = sm_mbedtls_allocator_calloc(1,8);
+	void * buffer2 = sm_mbedtls_allocator_calloc(2,8);
+	sm_mbedtls_allocator_free(buffer1);
+	sm_mbedtls_allocator_scope_end();
+	uint32_t arena_used = get_stats().arena_used;
+	CHECK_EQUAL(offset_for_buffer(buffer2) + 16, arena_used);
+	POINTERS_EQUAL(buffer1, sm_mbedtls_allocator_calloc(1,8));
+}
+
+TEST(sm_mbedtls_allocator_test, ecp_mul){
+	// P256 Set 1
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+	uint32_t arena_used = get_stats().arena_used;
+	int i;
+	for (i = 0; i < 3; i++){
+		sm_mbedtls_allocator_scope_begin();
+		mbedtls_mpi d, dh_key;
+		mbedtls_ecp_point Q, DH;
+		mbedtls_mpi_init(&d);
+		mbedtls_mpi_init(&dh_key);
+		mbedtls_ecp_point_init(&Q);
+		mbedtls_ecp_point_init(&DH);
+		mbedtls_mpi_read_string(&d,   16, "3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd");
+		mbedtls_mpi_read_string(&Q.X, 16, "1ea1f0f01faf1d9609592284f19e4c0047b58afd8615a69f559077b22faaa190");
+		mbedtls_mpi_read_string(&Q.Y, 16, "4c55f33e429dad377356703a9ab85160472d1130e28e36765f89aff915b1214a");
+		mbedtls_mpi_lset(&Q.Z, 1);
+		mbedtls_mpi_read_string(&dh_key, 16, "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698");
+		CHECK_EQUAL(0, mbedtls_ecp_mul(&grp, &DH, &d, &Q, NULL, NULL));
+		CHECK_EQUAL(0, mbedtls_mpi_cmp_mpi(&DH.X, &dh_key));
+		mbedtls_ecp_point_free(&DH);
+		mbedtls_ecp_point_free(&Q);
+		mbedtls_mpi_free(&dh_key);
+		mbedtls_mpi_free(&d);
+		sm_mbedtls_allocator_scope_end();
+		CHECK_EQUAL(arena_used, get_stats().arena_used);
+	}
+	sm_mbedtls_allocator_stats_t stats = get_stats();
+	CHECK_EQUAL(0, stats.allocations_failed);
+	printf("\nmbedtls_ecp_mul: peak %u bytes data, %u of %u bytes arena\n",
+		(unsigned) stats.bytes_max, (unsigned) stats.arena_max, (unsigned) stats.arena_size);
+	mbedtls_ecp_group_free(&grp);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,202 @@
+
+// *****************************************************************************
+//
+// vCard parser tests
+//
+// *****************************************************************************
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bluetooth.h"
+#include "classic/vcard_parser.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+#define NUM_BENCHMARK_CONTACTS 10000
+
+static const char * phonebook = 
+    "BEGIN:VCARD\r\n"
+    "VERSION:2.1\r\n"
+    "N:Doe;John\r\n"
+    "FN:John Doe\r\n"
+    "TEL;CELL:+49 123 456\r\n"
+    "END:VCARD\r\n"
+    "BEGIN:VCARD\r\n"
+    "VERSION:3.0\r\n"
+    "FN:Jane\r\n"
+    " Roe\r\n"
+    "NOTE;ENCODING=QUOTED-PRINTABLE:first=\r\n"
+    "second\r\n"
+    "tel;type=HOME:+1 555\r\n"
+    "END:VCARD\r\n";
+
+static const char * expected_events =
+    "<"
+    "VERSION|2.1|"
+    "N|Doe;John|"
+    "FN|John Doe|"
+    "TEL;CELL|+49 123 456|"
+    ">"
+    "<"
+    "VERSION|3.0|"
+    "FN|JaneRoe|"
+    "NOTE;ENCODING=QUOTED-PRINTABLE|firstsecond|"
+    "tel;type=HOME|+1 555|"
+    ">";
+
+static char     events[1000];
+static int      events_len;
+static int      num_truncated;
+static uint32_t num_properties;
+
+static void append(const char * text){
+    int len = strlen(text);
+    if (events_len + len >= (int) sizeof(events)) return;
+    memcpy(&events[events_len], text, len);
+    events_len += len;
+    events[events_len] = 0;
+}
+
+static void vcard_handler(void * context, vcard_parser_event_t event, const vcard_parser_property_t * property){
+    (void) context;
+    switch (event){
+        case VCARD_PARSER_EVENT_CONTACT_START:
+            append("<");
+            break;
+        case VCARD_PARSER_EVENT_PROPERTY:
+            num_properties++;
+            if (property->truncated) num_truncated++;
+            CHECK_EQUAL((int) strlen(property->value), property->value_len);
+            append(property->name);
+            if (*property->params){
+                append(";");
+                append(property->params);
+            }
+            append("|");
+            append(property->value);
+            append("|");
+            break;
+        case VCARD_PARSER_EVENT_CONTACT_END:
+            append(">");
+            break;
+        default:
+            break;
+    }
+}
+
+TEST_GROUP(VCardParser){
+    vcard_parser_t parser;
+    char line_buffer[100];
+
+    void setup(void){
+        events_len = 0;
+        events[0] = 0;
+        num_truncated = 0;
+        num_properties = 0;
+        vcard_parser_init(&parser, line_buffer, sizeof(line_buffer), &vcard_handler, NULL);
+    }
+};
+
+TEST(VCardParser, SingleChunk){
+    vcard_parser_process_data(&parser, (const uint8_t *) phonebook, strlen(phonebook));
+    vcard_parser_finalize(&parser);
+    STRCMP_EQUAL(expected_events, events);
+    CHECK_EQUAL(2, vcard_parser_get_num_contacts(&parser));
+}
+
+TEST(VCardParser, AllChunkSizes){
+    int chunk_size;
+    for (chunk_size = 1; chunk_size < (int) strlen(phonebook); chunk_size++){
+        setup();
+        int pos = 0;
+        int len = strlen(phonebook);
+        while (pos < len){
+            int bytes = len - pos;
+            if (bytes > chunk_size) bytes = chunk_size;
+            vcard_parser_process_data(&parser, (const uint8_t *) &phonebook[pos], bytes);
+            pos += bytes;
+        }
+        vcard_parser_finalize(&parser);
+        STRCMP_EQUAL(expected_events, events);
+    }
+}
+
+TEST(VCardParser, UnixLineEndingsAndMissingFinalLineBreak){
+    const char * data = "BEGIN:VCARD\nFN:A\n B\nEND:VCARD";
+    vcard_parser_process_data(&parser, (const uint8_t *) data, strlen(data));
+    STRCMP_EQUAL("<FN|AB|", events);
+    vcard_parser_finalize(&parser);
+    STRCMP_EQUAL("<FN|AB|>", events);
+}
+
+TEST(VCardParser, IgnorePropertiesOutsideOfContact){
+    const char * data = "FN:outside\r\nbogus line\r\nBEGIN:VCARD\r\nFN:inside\r\nEND:VCARD\r\n";
+    vcard_parser_process_data(&parser, (const uint8_t *) data, strlen(data));
+    vcard_parser_finalize(&parser);
+    STRCMP_EQUAL("<FN|inside|>", events);
+}
+
+TEST(VCardParser, TruncateLongLine){
+    char data[300];
+    strcpy(data, "BEGIN:VCARD\r\nPHOTO;ENCODING=b:");
+    int pos = strlen(data);
+    while (pos < 250) data[pos++] = 'x';
+    data[pos] = 0;
+    strcat(data, "\r\nFN:After\r\nEND:VCARD\r\n");
+    vcard_parser_process_data(&parser, (const uint8_t *) data, strlen(data));
+    vcard_parser_finalize(&parser);
+    CHECK_EQUAL(1, num_truncated);
+    CHECK_EQUAL(2, num_properties);
+    CHECK_EQUAL(1, vcard_parser_get_num_contacts(&parser));
+    CHECK(strstr(events, "FN|After|>") != NULL);
+}
+
+TEST(VCardParser, RejectEmptyLineBuffer){
+    CHECK_EQUAL(ERROR_CODE_INVALID_HCI_COMMAND_PARAMETERS, vcard_parser_init(&parser, line_buffer, 0, &vcard_handler, NULL));
+    vcard_parser_process_data(&parser, (const uint8_t *) phonebook, strlen(phonebook));
+    vcard_parser_finalize(&parser);
+    STRCMP_EQUAL("", events);
+    CHECK_EQUAL(0, vcard_parser_get_num_contacts(&parser));
+}
+
+TEST(VCardParser, Phonebook10k){
+    // synthetic phonebook, processed in chunks of typical OBEX body size
+    static char contact[200];
+    static uint8_t chunk[990];
+    int chunk_len = 0;
+    int i;
+    clock_t start = clock();
+    for (i = 0; i < NUM_BENCHMARK_CONTACTS; i++){
+        int len = snprintf(contact, sizeof(contact),
+            "BEGIN:VCARD\r\nVERSION:3.0\r\nN:Name%05u;Given\r\nFN:Given Name%05u\r\nTEL;TYPE=CELL:+49 170 %07u\r\nEND:VCARD\r\n",
+            i, i, i);
+        int pos = 0;
+        while (pos < len){
+            int bytes = len - pos;
+            if (bytes > (int) sizeof(chunk) - chunk_len) bytes = sizeof(chunk) - chunk_len;
+            memcpy(&chunk[chunk_len], &contact[pos], bytes);
+            chunk_len += bytes;
+            pos += bytes;
+            if (chunk_len == sizeof(chunk)){
+                vcard_parser_process_data(&parser, chunk, chunk_len);
+                chunk_len = 0;
+            }
+        }
+    }
+    vcard_parser_process_data(&parser, chunk, chunk_len);
+    vcard_parser_finalize(&parser);
+    double duration_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    printf("\nvcard_parser: %u contacts in %.1f ms\n", NUM_BENCHMARK_CONTACTS, duration_ms);
+    CHECK_EQUAL(NUM_BENCHMARK_CONTACTS, vcard_parser_get_num_contacts(&parser));
+    CHECK_EQUAL(NUM_BENCHMARK_CONTACTS * 4, num_properties);
+    CHECK_EQUAL(0, num_truncated);
+}
+
+int main (int argc, const char * argv[]){
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,325 @@
+#!/usr/bin/env python
+# BlueKitchen GmbH (c) 2017
+
+import re
+import sys
+import os
+
+program_info = '''
+BTstack HCI Command Builder Generator for BTstack
+Copyright 2017, BlueKitchen GmbH
+'''
+
+copyright = """/*
+ * Copyright (C) 2017 BlueKitchen GmbH
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ * 4. Any redistribution, use, or modification is done solely for
+ *    personal benefit and not for any commercial purpose or for
+ *    monetary gain.
+ *
+ * THIS SOFTWARE IS PROVIDED BY BLUEKITCHEN GMBH AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL MATTHIAS
+ * RINGWALD OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Please inquire about commercial licensing options at
+ * contact@bluekitchen-gmbh.com
+ *
+ */
+"""
+
+hfile_header_begin = """
+
+/*
+ *  hci_cmd_builder.h
+ *
+ *  @brief Typed HCI Command builders
+ *  @note  Don't edit - generated by tool/btstack_hci_cmd_generator.py
+ *
+ *  For each HCI Command in hci_cmd.c, hci_<command>_create() stores the command
+ *  into a buffer without interpreting the format string of the hci_cmd_t template,
+ *  and hci_send_<command>() builds it directly in the outgoing HCI packet buffer.
+ *  The result is identical to hci_send_cmd(&hci_<command>, ...).
+ */
+
+#ifndef __HCI_CMD_BUILDER_H
+#define __HCI_CMD_BUILDER_H
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+#include "btstack_config.h"
+#include "btstack_util.h"
+#include "hci.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* API_START */
+
+"""
+
+hfile_header_end = """
+/* API_END */
+
+#if defined __cplusplus
+}
+#endif
+
+#endif // __HCI_CMD_BUILDER_H
+"""
+
+create_template = '''/**
+ * @brief {description}
+ * @param hci_cmd_buffer{param_docs}
+ * @return size of HCI Command
+ * @note: btstack_type {format}
+ */
+static inline uint16_t {fn_name}(uint8_t * hci_cmd_buffer{params}){{
+    hci_cmd_buffer[0] = 0x{opcode_low:02x};
+    hci_cmd_buffer[1] = 0x{opcode_high:02x};
+    hci_cmd_buffer[2] = {param_len};
+{code}    return {size};
+}}
+'''
+
+send_template = '''/**
+ * @brief Send {command_name}
+ * @return status
+ */
+static inline int {fn_name}({params}){{
+    uint8_t * hci_cmd_buffer = {reserve_call};
+    if (!hci_cmd_buffer) return 0;
+    uint16_t size = {create_fn_name}(hci_cmd_buffer{args});
+    return hci_send_cmd_packet(hci_cmd_buffer, size);
+}}
+'''
+
+param_types = {
+    '1' : 'uint8_t',
+    '2' : 'uint16_t',
+    '3' : 'uint32_t',
+    '4' : 'uint32_t',
+    'H' : 'hci_con_handle_t',
+    'B' : 'const bd_addr_t',
+    'D' : 'const uint8_t *',
+    'E' : 'const uint8_t *',
+    'N' : 'const char *',
+    'P' : 'const uint8_t *',
+    'A' : 'const uint8_t *',
+    'Q' : 'const uint8_t *',
+}
+
+param_sizes = { '1' : 1, '2' : 2, '3' : 3, '4' : 4, 'H' : 2, 'B' : 6, 'D' : 8, 'E' : 240, 'N' : 248, 'P' : 16, 'A' : 31, 'Q' : 32 }
+
+param_store = {
+    '1' : '    hci_cmd_buffer[{offset}] = {name};\n',
+    '2' : '    little_endian_store_16(hci_cmd_buffer, {offset}, {name});\n',
+    'H' : '    little_endian_store_16(hci_cmd_buffer, {offset}, {name});\n',
+    '3' : '    hci_cmd_buffer[{offset}] = {name};\n    little_endian_store_16(hci_cmd_buffer, {next_offset}, {name} >> 8);\n',
+    '4' : '    little_endian_store_32(hci_cmd_buffer, {offset}, {name});\n',
+    'B' : '    reverse_bd_addr({name}, &hci_cmd_buffer[{offset}]);\n',
+    'D' : '    memcpy(&hci_cmd_buffer[{offset}], {name}, 8);\n',
+    'E' : '    memcpy(&hci_cmd_buffer[{offset}], {name}, 240);\n',
+    'P' : '    memcpy(&hci_cmd_buffer[{offset}], {name}, 16);\n',
+    'A' : '    memcpy(&hci_cmd_buffer[{offset}], {name}, 31);\n',
+    'Q' : '    reverse_bytes({name}, &hci_cmd_buffer[{offset}], 32);\n',
+    # name is sent as 248 bytes zero padded field
+    'N' : '''    uint16_t {name}_len = strlen({name});
+    if ({name}_len > 248) {{
+        {name}_len = 248;
+    }}
+    memcpy(&hci_cmd_buffer[{offset}], {name}, {name}_len);
+    memset(&hci_cmd_buffer[{offset} + {name}_len], 0, 248 - {name}_len);
+''',
+}
+
+ogf_values = {
+    'OGF_LINK_CONTROL'             : 0x01,
+    'OGF_LINK_POLICY'              : 0x02,
+    'OGF_CONTROLLER_BASEBAND'      : 0x03,
+    'OGF_INFORMATIONAL_PARAMETERS' : 0x04,
+    'OGF_STATUS_PARAMETERS'        : 0x05,
+    'OGF_TESTING'                  : 0x06,
+    'OGF_LE_CONTROLLER'            : 0x08,
+    'OGF_VENDOR'                   : 0x3f,
+}
+
+def read_defines(infile):
+    defines = dict()
+    with open (infile, 'rt') as fin:
+        for line in fin:
+            parts = re.match('#define\s+(OGF_\w+)\s+(0x[0-9a-fA-F]+)', line)
+            if parts:
+                (key, value) = parts.groups()
+                defines[key] = int(value, 16)
+    return defines
+
+def parse_value(value):
+    if value in ogf_values:
+        return ogf_values[value]
+    return int(value, 0)
+
+# returns list of ('cmd', (name, opcode, format, params, description)) and ('pre', line) entries
+def parse_commands(infile):
+    entries = []
+    params = []
+    description = ''
+    command_name = ''
+    # only #ifdef blocks are mirrored, commands in '#if 0' are skipped
+    conditionals = []
+    with open (infile, 'rt') as fin:
+        for line in fin:
+            preprocessor = re.match('\s*#\s*(ifdef|ifndef|if|else|endif)\\b(.*)', line)
+            if preprocessor:
+                (directive, rest) = preprocessor.groups()
+                if directive in ['ifdef', 'ifndef']:
+                    conditionals.append(True)
+                    entries.append(('pre', '#%s %s' % (directive, rest.strip())))
+                elif directive == 'if':
+                    conditionals.append(False)
+                elif directive == 'else':
+                    if conditionals[-1]:
+                        entries.append(('pre', '#else'))
+                elif directive == 'endif':
+                    if conditionals.pop():
+                        entries.append(('pre', '#endif'))
+                continue
+
+            parts = re.match('.*@param\s*(\w*)\s*', line)
+            if parts:
+                params.append(parts.groups()[0])
+                continue
+
+            parts = re.match('.*@brief\s*(.*)', line)
+            if parts:
+                description = parts.groups()[0].strip()
+                continue
+
+            declaration = re.match('const\s+hci_cmd_t\s+(\w+)[\s=]+', line)
+            if declaration:
+                command_name = declaration.groups()[0]
+                continue
+
+            definition = re.match('\s*OPCODE\\(\s*(\w+)\s*,\s*(\w+)\s*\\)\s*,\s*\\"(\w*)\\".*', line)
+            if definition:
+                (ogf, ocf, format) = definition.groups()
+                if len(params) != len(format):
+                    params = ['arg%u' % (i+1) for i in range(len(format))]
+                if not False in conditionals:
+                    opcode = parse_value(ocf) | (parse_value(ogf) << 10)
+                    entries.append(('cmd', (command_name, opcode, format, params, description)))
+                params = []
+                description = ''
+                continue
+    return entries
+
+def unique_names(params):
+    names = []
+    for param in params:
+        name = param
+        counter = 2
+        while name in names or name in ['hci_cmd_buffer', 'size']:
+            name = '%s_%u' % (param, counter)
+            counter += 1
+        names.append(name)
+    return names
+
+def create_builder(command_name, opcode, format, params, description):
+    base_name = command_name
+    if base_name.startswith('hci_'):
+        base_name = base_name[len('hci_'):]
+    create_fn_name = 'hci_%s_create' % base_name
+    send_fn_name   = 'hci_send_%s' % base_name
+    if not description:
+        description = 'Create %s' % command_name
+
+    for field_type in format:
+        if not field_type in param_store:
+            return '// %s: format %s not supported\n\n' % (command_name, format)
+
+    names = unique_names(params)
+    offset = 3
+    code = ''
+    for field_type, name in zip(format, names):
+        code += param_store[field_type].format(offset=offset, next_offset=offset+1, name=name)
+        offset += param_sizes[field_type]
+
+    param_docs = ''.join(['\n * @param %s' % name for name in names])
+    typed_params = ''.join([', %s %s' % (param_types[field_type], name) for field_type, name in zip(format, names)])
+    args = ''.join([', %s' % name for name in names])
+
+    text = create_template.format(description=description, fn_name=create_fn_name, param_docs=param_docs, params=typed_params,
+        opcode_low=opcode & 0xff, opcode_high=opcode >> 8, param_len=offset-3, code=code, size=offset, format=format)
+    text += '\n'
+    send_params = typed_params[2:]
+    if not send_params:
+        send_params = 'void'
+    # commands for a connection are sent to the controller of the connection
+    if format.startswith('H'):
+        reserve_call = 'hci_reserve_command_packet_buffer_for_con_handle(0x%04x, %s)' % (opcode, names[0])
+    else:
+        reserve_call = 'hci_reserve_command_packet_buffer(0x%04x)' % opcode
+    text += send_template.format(command_name=command_name, fn_name=send_fn_name, params=send_params,
+        reserve_call=reserve_call, create_fn_name=create_fn_name, args=args)
+    text += '\n'
+    return text
+
+def remove_empty_conditionals(entries):
+    result = []
+    for entry in entries:
+        if entry == ('pre', '#endif') and result and result[-1][0] == 'pre' and result[-1][1].startswith('#if'):
+            result.pop()
+            continue
+        result.append(entry)
+    return result
+
+def create_builders(entries):
+    global gen_path
+    with open(gen_path, 'wt') as fout:
+        fout.write(copyright)
+        fout.write(hfile_header_begin)
+        for (entry_type, entry) in entries:
+            if entry_type == 'pre':
+                fout.write(entry + '\n\n')
+                continue
+            (command_name, opcode, format, params, description) = entry
+            fout.write(create_builder(command_name, opcode, format, params, description))
+        fout.write(hfile_header_end)
+
+btstack_root = os.path.abspath(os.path.dirname(sys.argv[0]) + '/..')
+gen_path = btstack_root + '/src/hci_cmd_builder.h'
+
+print(program_info)
+
+ogf_values.update(read_defines(btstack_root + '/src/bluetooth.h'))
+
+# parse commands
+entries = remove_empty_conditionals(parse_commands(btstack_root + '/src/hci_cmd.c'))
+
+# create command builders
+create_builders(entries)
+
+# done
+print('Done!')
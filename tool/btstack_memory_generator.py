@@ -55,6 +55,7 @@ extern "C" {
 #endif
 
 #include "btstack_config.h"
+#include "btstack_memory_pool.h"
     
 // Core
 #include "hci.h"
@@ -66,6 +67,7 @@ extern "C" {
 #include "classic/btstack_link_key_db.h"
 #include "classic/btstack_link_key_db_memory.h"
 #include "classic/rfcomm.h"
+#include "classic/sdp_client.h"
 #include "classic/sdp_server.h"
 #include "classic/avdtp_sink.h"
 #include "classic/avdtp_source.h"
@@ -77,6 +79,27 @@ extern "C" {
 #include "ble/sm.h"
 #endif
 
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+
+#ifndef MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES
+#define MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES 32
+#endif
+
+typedef enum {
+    BTSTACK_MEMORY_TRACE_GET = 0,
+    BTSTACK_MEMORY_TRACE_FREE,
+} btstack_memory_trace_operation_t;
+
+typedef struct {
+    uint32_t     timestamp_ms;
+    const char * type;
+    void       * block;       // NULL for failed allocation
+    void       * call_site;   // return address into caller of get/free, NULL if not supported by compiler
+    uint8_t      operation;   // btstack_memory_trace_operation_t
+} btstack_memory_trace_entry_t;
+
+#endif
+
 /* API_START */
 
 /**
@@ -84,6 +107,36 @@ extern "C" {
  */
 void btstack_memory_init(void);
 
+/**
+ * @brief Get usage statistics of BTstack memory pools
+ * @param stats array for pool statistics
+ * @param max_num_stats size of stats array
+ * @return number of memory pools stored in stats
+ */
+int btstack_memory_get_stats(btstack_memory_pool_stats_t * stats, int max_num_stats);
+
+/**
+ * @brief Log usage statistics of BTstack memory pools to HCI dump
+ */
+void btstack_memory_log_stats(void);
+
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+
+/**
+ * @brief Get allocation trace, oldest entry first
+ * @param entries array for trace entries
+ * @param max_num_entries size of entries array
+ * @return number of trace entries stored in entries
+ */
+int btstack_memory_trace_get_entries(btstack_memory_trace_entry_t * entries, int max_num_entries);
+
+/**
+ * @brief Log allocation trace to HCI dump
+ */
+void btstack_memory_trace_log(void);
+
+#endif
+
 /* API_END */
 """
 
@@ -96,6 +149,9 @@ hfile_header_end = """
 """
 
 cfile_header_begin = """
+#define __BTSTACK_FILE__ "btstack_memory.c"
+
+
 /*
  *  btstack_memory.h
  *
@@ -107,9 +163,66 @@ cfile_header_begin = """
 
 #include "btstack_memory.h"
 #include "btstack_memory_pool.h"
+#include "btstack_debug.h"
 
 #include <stdlib.h>
 
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+#include "btstack_run_loop.h"
+
+#ifdef __GNUC__
+#define BTSTACK_MEMORY_CALL_SITE __builtin_return_address(0)
+#else
+#define BTSTACK_MEMORY_CALL_SITE NULL
+#endif
+
+static btstack_memory_trace_entry_t btstack_memory_trace_entries[MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+static uint16_t btstack_memory_trace_index;
+static uint16_t btstack_memory_trace_num_entries;
+
+static void btstack_memory_trace_add(const char * type, btstack_memory_trace_operation_t operation, void * block, void * call_site){
+    btstack_memory_trace_entry_t * entry = &btstack_memory_trace_entries[btstack_memory_trace_index];
+    entry->timestamp_ms = btstack_run_loop_get_time_ms();
+    entry->type = type;
+    entry->block = block;
+    entry->call_site = call_site;
+    entry->operation = operation;
+    btstack_memory_trace_index++;
+    if (btstack_memory_trace_index == MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES){
+        btstack_memory_trace_index = 0;
+    }
+    if (btstack_memory_trace_num_entries < MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES){
+        btstack_memory_trace_num_entries++;
+    }
+}
+
+// macro to capture return address in the public get/free function itself
+#define BTSTACK_MEMORY_TRACE(type, operation, block) btstack_memory_trace_add(type, operation, block, BTSTACK_MEMORY_CALL_SITE)
+#else
+#define BTSTACK_MEMORY_TRACE(type, operation, block)
+#endif
+
+#ifdef HAVE_MALLOC
+static void * btstack_memory_malloc(btstack_memory_pool_stats_t * stats, size_t size){
+    void * buffer = malloc(size);
+    if (!buffer){
+        stats->num_allocation_failures++;
+        return NULL;
+    }
+    stats->num_used++;
+    if (stats->num_used > stats->max_num_used){
+        stats->max_num_used = stats->num_used;
+    }
+    return buffer;
+}
+
+static void btstack_memory_free(btstack_memory_pool_stats_t * stats, void * buffer){
+    if (!buffer) return;
+    stats->num_used--;
+    free(buffer);
+}
+#endif
+
 """
 
 header_template = """STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void);
@@ -128,11 +241,15 @@ code_template = """
 #ifdef POOL_COUNT
 #if POOL_COUNT > 0
 static STRUCT_TYPE STRUCT_NAME_storage[POOL_COUNT];
+static uint8_t STRUCT_NAME_used_blocks[(POOL_COUNT + 7) / 8];
 static btstack_memory_pool_t STRUCT_NAME_pool;
 STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
-    return (STRUCT_NAME_t *) btstack_memory_pool_get(&STRUCT_NAME_pool);
+    STRUCT_NAME_t * STRUCT_NAME = (STRUCT_NAME_t *) btstack_memory_pool_get(&STRUCT_NAME_pool);
+    BTSTACK_MEMORY_TRACE("STRUCT_NAME", BTSTACK_MEMORY_TRACE_GET, STRUCT_NAME);
+    return STRUCT_NAME;
 }
 void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
+    BTSTACK_MEMORY_TRACE("STRUCT_NAME", BTSTACK_MEMORY_TRACE_FREE, STRUCT_NAME);
     btstack_memory_pool_free(&STRUCT_NAME_pool, STRUCT_NAME);
 }
 #else
@@ -145,17 +262,62 @@ void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
 };
 #endif
 #elif defined(HAVE_MALLOC)
+static btstack_memory_pool_stats_t STRUCT_NAME_stats = { "STRUCT_NAME", 0, 0, 0, 0 };
 STRUCT_NAME_t * btstack_memory_STRUCT_NAME_get(void){
-    return (STRUCT_NAME_t*) malloc(sizeof(STRUCT_TYPE));
+    STRUCT_NAME_t * STRUCT_NAME = (STRUCT_NAME_t*) btstack_memory_malloc(&STRUCT_NAME_stats, sizeof(STRUCT_TYPE));
+    BTSTACK_MEMORY_TRACE("STRUCT_NAME", BTSTACK_MEMORY_TRACE_GET, STRUCT_NAME);
+    return STRUCT_NAME;
 }
 void btstack_memory_STRUCT_NAME_free(STRUCT_NAME_t *STRUCT_NAME){
-    free(STRUCT_NAME);
+    BTSTACK_MEMORY_TRACE("STRUCT_NAME", BTSTACK_MEMORY_TRACE_FREE, STRUCT_NAME);
+    btstack_memory_free(&STRUCT_NAME_stats, STRUCT_NAME);
 }
 #endif
 """
 
 init_template = """#if POOL_COUNT > 0
-    btstack_memory_pool_create(&STRUCT_NAME_pool, STRUCT_NAME_storage, POOL_COUNT, sizeof(STRUCT_TYPE));
+    btstack_memory_pool_create(&STRUCT_NAME_pool, STRUCT_NAME_storage, POOL_COUNT, sizeof(STRUCT_TYPE), STRUCT_NAME_used_blocks);
+#endif"""
+
+stats_template = """#ifdef POOL_COUNT
+#if POOL_COUNT > 0
+    if (num_stats < max_num_stats){
+        btstack_memory_pool_get_stats(&STRUCT_NAME_pool, "STRUCT_NAME", &stats[num_stats++]);
+    }
+#endif
+#elif defined(HAVE_MALLOC)
+    if (num_stats < max_num_stats){
+        stats[num_stats++] = STRUCT_NAME_stats;
+    }
+#endif"""
+
+trace_code = """
+#ifdef ENABLE_BTSTACK_MEMORY_TRACE
+int btstack_memory_trace_get_entries(btstack_memory_trace_entry_t * entries, int max_num_entries){
+    int num_entries = btstack_memory_trace_num_entries;
+    int index;
+    int i;
+    if (num_entries > max_num_entries){
+        num_entries = max_num_entries;
+    }
+    // start with oldest of the most recent num_entries entries
+    index = btstack_memory_trace_index + MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES - num_entries;
+    for (i = 0; i < num_entries; i++){
+        entries[i] = btstack_memory_trace_entries[(index + i) % MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+    }
+    return num_entries;
+}
+
+void btstack_memory_trace_log(void){
+    int num_entries = btstack_memory_trace_num_entries;
+    int index = btstack_memory_trace_index + MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES - num_entries;
+    int i;
+    for (i = 0; i < num_entries; i++){
+        btstack_memory_trace_entry_t * entry = &btstack_memory_trace_entries[(index + i) % MAX_NR_BTSTACK_MEMORY_TRACE_ENTRIES];
+        HCI_DUMP_LOG(LOG_LEVEL_INFO, "%u ms: %s %s %p from %p", (unsigned int) entry->timestamp_ms,
+            entry->operation == BTSTACK_MEMORY_TRACE_GET ? "get" : "free", entry->type, entry->block, entry->call_site);
+    }
+}
 #endif"""
 
 def writeln(f, data):
@@ -178,7 +340,7 @@ list_of_structs = [
     ["btstack_link_key_db_memory_entry"],
     ["bnep_service", "bnep_channel"],
     ["hfp_connection"],
-    ["service_record_item"],
+    ["service_record_item", "sdp_server_connection", "sdp_client_connection"],
     ["avdtp_stream_endpoint"],
     ["avdtp_connection"],
     ["avrcp_connection"]    
@@ -232,5 +394,36 @@ for struct_names in list_of_le_structs:
         writeln(f, replacePlaceholder(init_template, struct_name))
 writeln(f, "#endif")
 writeln(f, "}")
+
+writeln(f, "")
+writeln(f, "// stats")
+writeln(f, "int btstack_memory_get_stats(btstack_memory_pool_stats_t * stats, int max_num_stats){")
+writeln(f, "    int num_stats = 0;")
+for struct_names in list_of_structs:
+    for struct_name in struct_names:
+        writeln(f, replacePlaceholder(stats_template, struct_name))
+writeln(f, "#ifdef ENABLE_BLE")
+for struct_names in list_of_le_structs:
+    for struct_name in struct_names:
+        writeln(f, replacePlaceholder(stats_template, struct_name))
+writeln(f, "#endif")
+writeln(f, "    (void) stats;")
+writeln(f, "    (void) max_num_stats;")
+writeln(f, "    return num_stats;")
+writeln(f, "}")
+
+num_pools = sum(len(struct_names) for struct_names in list_of_structs + list_of_le_structs)
+writeln(f, "")
+writeln(f, "void btstack_memory_log_stats(void){")
+writeln(f, "    btstack_memory_pool_stats_t stats[%u];" % num_pools)
+writeln(f, "    int num_stats = btstack_memory_get_stats(stats, %u);" % num_pools)
+writeln(f, "    int i;")
+writeln(f, "    for (i = 0; i < num_stats; i++){")
+writeln(f, "        // count is 0 for types allocated via malloc")
+writeln(f, "        HCI_DUMP_LOG(LOG_LEVEL_INFO, \"%s: %u of %u used, max %u, %u allocations failed\", stats[i].name,")
+writeln(f, "            stats[i].num_used, stats[i].count, stats[i].max_num_used, stats[i].num_allocation_failures);")
+writeln(f, "    }")
+writeln(f, "}")
+writeln(f, trace_code)
 f.close();
     